@@ -4,6 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "revng/ABI/FunctionType/Support.h"
@@ -153,8 +157,52 @@ public:
     uint64_t Value;
     bool IsNatural;
   };
-  using AlignmentCache = std::unordered_map<const model::TypeDefinition *,
-                                            AlignmentInfo>;
+
+  /// The alignment of the type definitions computed so far, for a single ABI
+  ///
+  /// Entries are keyed by address, hence a cache must not outlive the
+  /// definitions it has seen, nor see them change: keep one for as long as
+  /// the model is not modified (e.g., for the conversion of a prototype or the
+  /// computation of a layout) and `clear()` it, or drop it, afterwards.
+  ///
+  /// It's safe to use the same cache from multiple threads.
+  class AlignmentCache {
+  private:
+    mutable std::shared_mutex Mutex;
+    const Definition *ABI = nullptr;
+    std::unordered_map<const model::TypeDefinition *, AlignmentInfo> Entries;
+
+  public:
+    AlignmentCache() = default;
+    AlignmentCache(const AlignmentCache &) = delete;
+    AlignmentCache &operator=(const AlignmentCache &) = delete;
+
+  public:
+    std::optional<AlignmentInfo>
+    find(const model::TypeDefinition &Type) const {
+      std::shared_lock Lock(Mutex);
+      auto Iterator = Entries.find(&Type);
+      if (Iterator == Entries.end())
+        return std::nullopt;
+      return Iterator->second;
+    }
+
+    void insert(const Definition &ABI,
+                const model::TypeDefinition &Type,
+                AlignmentInfo Info) {
+      std::unique_lock Lock(Mutex);
+      revng_assert(this->ABI == nullptr or this->ABI == &ABI,
+                   "An AlignmentCache cannot be shared among ABIs");
+      this->ABI = &ABI;
+      Entries.insert_or_assign(&Type, Info);
+    }
+
+    void clear() {
+      std::unique_lock Lock(Mutex);
+      ABI = nullptr;
+      Entries.clear();
+    }
+  };
 
   /// Compute the natural alignment of the type in accordance with
   /// the current ABI
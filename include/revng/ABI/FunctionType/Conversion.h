@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+
 #include "revng/Model/Binary.h"
 
 namespace abi::FunctionType {
@@ -21,4 +23,22 @@ tryConvertToCABI(const model::RawFunctionDefinition &Function,
                  std::optional<model::ABI::Values> ABI = std::nullopt,
                  bool UseSoftRegisterStateDeductions = true);
 
+using ReferenceReplacements = std::map<model::DefinitionReference,
+                                       model::DefinitionReference>;
+
+/// Same as the other overload, except the references to \p Function are not
+/// replaced: instead, the replacement is recorded in \p Replacements, and the
+/// old type is left in place.
+///
+/// Replacing the references requires visiting the whole model. When converting
+/// many functions, this overload allows to do that only once, through
+/// `TupleTree::replaceReferences`, after which the caller is responsible for
+/// erasing the old types.
+std::optional<model::UpcastableType>
+tryConvertToCABI(const model::RawFunctionDefinition &Function,
+                 TupleTree<model::Binary> &Binary,
+                 ReferenceReplacements &Replacements,
+                 std::optional<model::ABI::Values> ABI = std::nullopt,
+                 bool UseSoftRegisterStateDeductions = true);
+
 } // namespace abi::FunctionType
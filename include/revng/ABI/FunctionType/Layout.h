@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+
 #include "llvm/ADT/STLExtras.h"
 
 #include "revng/ABI/Definition.h"
@@ -251,4 +253,41 @@ inline UsedRegisters usedRegisters(const model::UpcastableType &FunctionType) {
   return usedRegisters(FunctionType->toPrototype());
 }
 
+/// Memoizes layouts and used registers of prototypes, so that querying the
+/// same prototype over and over (e.g., at each call site) is a lookup.
+///
+/// Results are looked up by the key of the prototype only (which, for CABI
+/// prototypes, also determines the ABI), while they also depend on the types
+/// the prototype refers to. For this reason, the cache must be cleared
+/// whenever the model might have changed. Moreover, a cache hit does not read
+/// the model: when reads are tracked on a per-target basis (e.g., in a
+/// pipeline::FunctionPass), the cache must be cleared before processing each
+/// target, otherwise the target would not register its dependency on the
+/// prototype.
+class LayoutCache {
+private:
+  std::map<model::TypeDefinition::Key, Layout> Layouts;
+  std::map<model::TypeDefinition::Key, UsedRegisters> Registers;
+
+public:
+  const Layout &layout(const model::TypeDefinition &Prototype) {
+    auto [It, Inserted] = Layouts.try_emplace(Prototype.key());
+    if (Inserted)
+      It->second = Layout::make(Prototype);
+    return It->second;
+  }
+
+  const UsedRegisters &usedRegisters(const model::TypeDefinition &Prototype) {
+    auto [It, Inserted] = Registers.try_emplace(Prototype.key());
+    if (Inserted)
+      It->second = abi::FunctionType::usedRegisters(Prototype);
+    return It->second;
+  }
+
+  void clear() {
+    Layouts.clear();
+    Registers.clear();
+  }
+};
+
 } // namespace abi::FunctionType
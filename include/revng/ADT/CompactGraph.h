@@ -0,0 +1,297 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <type_traits>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/GraphTraits.h"
+#include "llvm/ADT/iterator.h"
+
+#include "revng/ADT/GenericGraph.h"
+#include "revng/Support/Assert.h"
+
+/// A node of a CompactGraph, see there
+template<typename OriginalNodeRef>
+class CompactGraphNode {
+private:
+  template<typename>
+  friend class CompactGraph;
+
+public:
+  using NodeRef = const CompactGraphNode *;
+
+private:
+  OriginalNodeRef Original;
+  unsigned Index = 0;
+  const NodeRef *SuccessorsBegin = nullptr;
+  const NodeRef *SuccessorsEnd = nullptr;
+  const NodeRef *PredecessorsBegin = nullptr;
+  const NodeRef *PredecessorsEnd = nullptr;
+
+public:
+  CompactGraphNode(OriginalNodeRef Original, unsigned Index) :
+    Original(Original), Index(Index) {}
+
+public:
+  /// \returns the node of the graph this has been built from
+  OriginalNodeRef original() const { return Original; }
+
+  /// \returns the position of this node in the graph, which is dense and can
+  ///          be used to index side tables
+  unsigned index() const { return Index; }
+
+public:
+  llvm::ArrayRef<NodeRef> successors() const {
+    return { SuccessorsBegin, SuccessorsEnd };
+  }
+
+  llvm::ArrayRef<NodeRef> predecessors() const {
+    return { PredecessorsBegin, PredecessorsEnd };
+  }
+
+  size_t successorCount() const { return SuccessorsEnd - SuccessorsBegin; }
+  size_t predecessorCount() const {
+    return PredecessorsEnd - PredecessorsBegin;
+  }
+
+  bool hasSuccessors() const { return SuccessorsBegin != SuccessorsEnd; }
+  bool hasPredecessors() const { return PredecessorsBegin != PredecessorsEnd; }
+};
+
+/// A frozen copy of the structure of a graph, in compressed sparse row form
+///
+/// All the nodes are stored in a single array, and so are the successors and
+/// predecessors of all the nodes, which makes traversals much more cache
+/// friendly than chasing individually allocated nodes, e.g., in a
+/// GenericGraph. Each node refers back to the node of the original graph it
+/// has been built from.
+///
+/// It can be built from any graph providing llvm::GraphTraits, and it provides
+/// llvm::GraphTraits in turn (for both the forward and the inverse direction),
+/// so it can be used as a drop-in replacement by read-only consumers.
+///
+/// The structure cannot be changed after construction: if the original graph
+/// changes, a new CompactGraph needs to be built.
+template<typename OriginalNodeRef>
+class CompactGraph {
+public:
+  using Node = CompactGraphNode<OriginalNodeRef>;
+  using NodeRef = const Node *;
+  using const_nodes_iterator = typename std::vector<Node>::const_iterator;
+
+private:
+  std::vector<Node> Nodes;
+
+  /// Successors of all the nodes, followed by predecessors of all the nodes
+  std::vector<NodeRef> Edges;
+
+  NodeRef EntryNode = nullptr;
+  llvm::DenseMap<OriginalNodeRef, NodeRef> OriginalToCompact;
+
+public:
+  CompactGraph() = default;
+
+  // Nodes point into Nodes and Edges, moving preserves their buffers
+  CompactGraph(const CompactGraph &) = delete;
+  CompactGraph(CompactGraph &&) = default;
+  CompactGraph &operator=(const CompactGraph &) = delete;
+  CompactGraph &operator=(CompactGraph &&) = default;
+
+public:
+  /// Builds a CompactGraph from \p Graph, preserving the order of nodes and
+  /// the order of the successors of each node
+  template<typename GraphType, typename GT = llvm::GraphTraits<GraphType>>
+  static CompactGraph fromGraph(GraphType Graph) {
+    static_assert(std::is_same_v<typename GT::NodeRef, OriginalNodeRef>);
+
+    CompactGraph Result;
+
+    // Create the nodes
+    auto OriginalNodes = llvm::make_range(GT::nodes_begin(Graph),
+                                          GT::nodes_end(Graph));
+    for (OriginalNodeRef Original : OriginalNodes) {
+      unsigned Index = Result.Nodes.size();
+      Result.Nodes.emplace_back(Original, Index);
+    }
+
+    for (const Node &N : Result.Nodes)
+      Result.OriginalToCompact[N.Original] = &N;
+
+    // Collect successors, in order, and count predecessors
+    std::vector<unsigned> SuccessorsOffsets(Result.Nodes.size() + 1, 0);
+    std::vector<unsigned> PredecessorsCounts(Result.Nodes.size(), 0);
+    std::vector<unsigned> Successors;
+    for (const Node &N : Result.Nodes) {
+      SuccessorsOffsets[N.Index] = Successors.size();
+      auto Children = llvm::make_range(GT::child_begin(N.Original),
+                                       GT::child_end(N.Original));
+      for (OriginalNodeRef Child : Children) {
+        unsigned ChildIndex = Result.at(Child)->Index;
+        Successors.push_back(ChildIndex);
+        ++PredecessorsCounts[ChildIndex];
+      }
+    }
+    SuccessorsOffsets[Result.Nodes.size()] = Successors.size();
+
+    // Lay out the edges: first all the successors, then all the predecessors
+    size_t EdgesCount = Successors.size();
+    Result.Edges.resize(2 * EdgesCount);
+    const NodeRef *EdgesBegin = Result.Edges.data();
+
+    for (unsigned I = 0; I < Successors.size(); ++I)
+      Result.Edges[I] = &Result.Nodes[Successors[I]];
+
+    unsigned PredecessorsOffset = EdgesCount;
+    for (Node &N : Result.Nodes) {
+      N.SuccessorsBegin = EdgesBegin + SuccessorsOffsets[N.Index];
+      N.SuccessorsEnd = EdgesBegin + SuccessorsOffsets[N.Index + 1];
+
+      // PredecessorsEnd is used as an insertion cursor below
+      N.PredecessorsBegin = EdgesBegin + PredecessorsOffset;
+      N.PredecessorsEnd = N.PredecessorsBegin;
+      PredecessorsOffset += PredecessorsCounts[N.Index];
+    }
+
+    for (Node &N : Result.Nodes) {
+      for (NodeRef Successor : N.successors()) {
+        Node &Target = Result.Nodes[Successor->Index];
+        unsigned Offset = Target.PredecessorsEnd - EdgesBegin;
+        Result.Edges[Offset] = &N;
+        ++Target.PredecessorsEnd;
+      }
+    }
+
+    // Record the entry node, if any
+    if constexpr (hasEntryNode<GraphType, GT>()) {
+      if (OriginalNodeRef Entry = GT::getEntryNode(Graph))
+        Result.EntryNode = Result.at(Entry);
+    }
+
+    return Result;
+  }
+
+public:
+  NodeRef getEntryNode() const { return EntryNode; }
+
+  size_t size() const { return Nodes.size(); }
+
+  llvm::iterator_range<const_nodes_iterator> nodes() const {
+    return llvm::make_range(Nodes.begin(), Nodes.end());
+  }
+
+  /// \returns the node built from \p Original
+  NodeRef at(OriginalNodeRef Original) const {
+    auto It = OriginalToCompact.find(Original);
+    revng_assert(It != OriginalToCompact.end());
+    return It->second;
+  }
+
+private:
+  template<typename GraphType, typename GT>
+  static constexpr bool hasEntryNode() {
+    using Pointee = std::remove_cvref_t<std::remove_pointer_t<GraphType>>;
+    if constexpr (SpecializationOfGenericGraph<Pointee>)
+      return Pointee::hasEntryNode;
+    else
+      return requires(GraphType Graph) { GT::getEntryNode(Graph); };
+  }
+};
+
+namespace llvm {
+
+/// Specializes GraphTraits<const CompactGraphNode<...> *>
+template<typename T>
+struct GraphTraits<const CompactGraphNode<T> *> {
+public:
+  using NodeRef = const CompactGraphNode<T> *;
+  using ChildIteratorType = const NodeRef *;
+
+public:
+  static ChildIteratorType child_begin(NodeRef N) {
+    return N->successors().begin();
+  }
+
+  static ChildIteratorType child_end(NodeRef N) {
+    return N->successors().end();
+  }
+
+  static NodeRef getEntryNode(NodeRef N) { return N; };
+};
+
+/// Specializes GraphTraits<llvm::Inverse<const CompactGraphNode<...> *>>
+template<typename T>
+struct GraphTraits<llvm::Inverse<const CompactGraphNode<T> *>> {
+public:
+  using NodeRef = const CompactGraphNode<T> *;
+  using ChildIteratorType = const NodeRef *;
+
+public:
+  static ChildIteratorType child_begin(NodeRef N) {
+    return N->predecessors().begin();
+  }
+
+  static ChildIteratorType child_end(NodeRef N) {
+    return N->predecessors().end();
+  }
+
+  static NodeRef getEntryNode(llvm::Inverse<NodeRef> N) { return N.Graph; };
+};
+
+/// Specializes GraphTraits<const CompactGraph<...> *>
+template<typename T>
+struct GraphTraits<const CompactGraph<T> *>
+  : public GraphTraits<const CompactGraphNode<T> *> {
+  using NodeRef = const CompactGraphNode<T> *;
+  using nodes_iterator = pointer_iterator<
+    typename CompactGraph<T>::const_nodes_iterator>;
+
+  static NodeRef getEntryNode(const CompactGraph<T> *G) {
+    return G->getEntryNode();
+  }
+
+  static nodes_iterator nodes_begin(const CompactGraph<T> *G) {
+    return nodes_iterator(G->nodes().begin());
+  }
+
+  static nodes_iterator nodes_end(const CompactGraph<T> *G) {
+    return nodes_iterator(G->nodes().end());
+  }
+
+  static size_t size(const CompactGraph<T> *G) { return G->size(); }
+};
+
+template<typename T>
+struct GraphTraits<CompactGraph<T> *>
+  : public GraphTraits<const CompactGraph<T> *> {};
+
+/// Specializes GraphTraits<llvm::Inverse<const CompactGraph<...> *>>
+template<typename T>
+struct GraphTraits<llvm::Inverse<const CompactGraph<T> *>>
+  : public GraphTraits<llvm::Inverse<const CompactGraphNode<T> *>> {
+  using NodeRef = const CompactGraphNode<T> *;
+  using nodes_iterator = pointer_iterator<
+    typename CompactGraph<T>::const_nodes_iterator>;
+
+  static NodeRef getEntryNode(llvm::Inverse<const CompactGraph<T> *> Inv) {
+    return Inv.Graph->getEntryNode();
+  }
+
+  static nodes_iterator nodes_begin(llvm::Inverse<const CompactGraph<T> *> I) {
+    return nodes_iterator(I.Graph->nodes().begin());
+  }
+
+  static nodes_iterator nodes_end(llvm::Inverse<const CompactGraph<T> *> I) {
+    return nodes_iterator(I.Graph->nodes().end());
+  }
+
+  static size_t size(llvm::Inverse<const CompactGraph<T> *> I) {
+    return I.Graph->size();
+  }
+};
+
+} // namespace llvm
@@ -4,24 +4,19 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/ConstantRange.h"
+#include "llvm/Support/MathExtras.h"
 
-#include "revng/ADT/ZipMapIterator.h"
 #include "revng/Support/Debug.h"
 
 using APIntVector = llvm::SmallVector<llvm::APInt, 4>;
 
-struct APIntVectorKeyContainer {
-  static int compare(const llvm::APInt &LHS, const llvm::APInt &RHS) {
-    if (LHS == RHS)
-      return 0;
-    if (LHS.ult(RHS))
-      return -1;
-    else
-      return 1;
-  }
-};
+/// Bounds of a ConstantRangeSet at most 64 bits wide
+using NarrowBoundsVector = llvm::SmallVector<uint64_t, 4>;
 
 // Options:
 //
@@ -32,19 +27,31 @@ struct APIntVectorKeyContainer {
 class ConstantRangeSetIterator {
 private:
   llvm::APInt Current;
-  const llvm::APInt *NextBound;
-  const llvm::APInt *const End;
-  bool ToLast;
-  bool Done;
-  const llvm::APInt Max;
+
+  /// Exactly one of these is non-empty, unless the set is empty
+  llvm::ArrayRef<uint64_t> NarrowBounds;
+  llvm::ArrayRef<llvm::APInt> WideBounds;
+
+  uint32_t BitWidth = 0;
+  size_t NextBound = 0;
+  bool ToLast = false;
+  bool Done = true;
 
 public:
-  ConstantRangeSetIterator(const llvm::APInt *Start, const llvm::APInt *End) :
-    NextBound(Start), End(End), ToLast(false), Done(false) {
-    if (Start != End) {
-      Current = *NextBound;
+  /// The end iterator
+  ConstantRangeSetIterator() = default;
+
+  ConstantRangeSetIterator(llvm::ArrayRef<uint64_t> NarrowBounds,
+                           llvm::ArrayRef<llvm::APInt> WideBounds,
+                           uint32_t BitWidth) :
+    NarrowBounds(NarrowBounds),
+    WideBounds(WideBounds),
+    BitWidth(BitWidth),
+    Done(false) {
+    if (boundsCount() != 0) {
+      Current = bound(NextBound);
       ++NextBound;
-      if (NextBound == End)
+      if (NextBound == boundsCount())
         ToLast = true;
     } else {
       Done = true;
@@ -70,12 +77,12 @@ public:
     }
 
     ++Current;
-    if (not ToLast and Current == *NextBound) {
+    if (not ToLast and isBound(NextBound, Current)) {
       ++NextBound;
-      if (NextBound != End) {
-        Current = *NextBound;
+      if (NextBound != boundsCount()) {
+        Current = bound(NextBound);
         ++NextBound;
-        if (NextBound == End)
+        if (NextBound == boundsCount())
           ToLast = true;
       } else {
         Done = true;
@@ -91,6 +98,25 @@ public:
   }
 
   const llvm::APInt *operator->() const { return &**this; }
+
+private:
+  size_t boundsCount() const {
+    return NarrowBounds.size() + WideBounds.size();
+  }
+
+  llvm::APInt bound(size_t Index) const {
+    if (WideBounds.empty())
+      return llvm::APInt(BitWidth, NarrowBounds[Index]);
+    else
+      return WideBounds[Index];
+  }
+
+  bool isBound(size_t Index, const llvm::APInt &Value) const {
+    if (WideBounds.empty())
+      return Value.getZExtValue() == NarrowBounds[Index];
+    else
+      return Value == WideBounds[Index];
+  }
 };
 
 /// A set of ranges
@@ -98,12 +124,17 @@ public:
 /// This class is effectively an extension of llvm::ConstantRange aiming to
 /// represent multiple disjoint ranges.
 ///
-/// It is implemented as a vector of llvm::APInt. Each one of them represents a
+/// It is implemented as a vector of bounds. Each one of them represents a
 /// flip in the status of the range (`ON -> OFF` or `OFF -> ON`), starting from
 /// the initial state `OFF`.
+///
+/// Sets at most 64 bits wide, by far the most common, store their bounds as
+/// plain `uint64_t`, so that the set algebra doesn't go through llvm::APInt.
+/// Wider sets store them as llvm::APInt.
 class ConstantRangeSet {
 private:
-  APIntVector Bounds;
+  NarrowBoundsVector NarrowBounds;
+  APIntVector WideBounds;
   uint32_t BitWidth;
 
 public:
@@ -111,24 +142,24 @@ public:
 
   ConstantRangeSet(uint32_t BitWidth, bool IsFullSet) : BitWidth(BitWidth) {
     if (IsFullSet)
-      Bounds.emplace_back(BitWidth, 0);
+      pushBound(llvm::APInt(BitWidth, 0));
   }
 
   ConstantRangeSet(const llvm::ConstantRange &Range) {
     BitWidth = Range.getBitWidth();
 
     if (Range.isFullSet()) {
-      Bounds.emplace_back(BitWidth, 0);
+      pushBound(llvm::APInt(BitWidth, 0));
     } else if (Range.isEmptySet()) {
       // Nothing to do here
     } else if (Range.isWrappedSet()) {
-      Bounds.emplace_back(BitWidth, 0);
-      Bounds.push_back(Range.getUpper());
-      Bounds.push_back(Range.getLower());
+      pushBound(llvm::APInt(BitWidth, 0));
+      pushBound(Range.getUpper());
+      pushBound(Range.getLower());
     } else {
-      Bounds.push_back(Range.getLower());
+      pushBound(Range.getLower());
       if (Range.getUpper() != llvm::APInt{ BitWidth, 0 })
-        Bounds.push_back(Range.getUpper());
+        pushBound(Range.getUpper());
     }
   }
 
@@ -146,7 +177,17 @@ public:
   }
 
   bool operator==(const ConstantRangeSet &Other) const {
-    return Bounds == Other.Bounds;
+    if (isNarrow() and Other.isNarrow())
+      return NarrowBounds == Other.NarrowBounds;
+
+    if (boundsCount() != Other.boundsCount())
+      return false;
+
+    for (size_t I = 0; I < boundsCount(); ++I)
+      if (bound(I) != Other.bound(I))
+        return false;
+
+    return true;
   }
 
   void setWidth(unsigned NewBitWidth) {
@@ -157,38 +198,53 @@ public:
   }
 
   ConstantRangeSetIterator begin() const {
-    return ConstantRangeSetIterator(&*Bounds.begin(), &*Bounds.end());
+    return ConstantRangeSetIterator(NarrowBounds, WideBounds, BitWidth);
   }
 
-  ConstantRangeSetIterator end() const {
-    return ConstantRangeSetIterator(&*Bounds.end(), &*Bounds.end());
-  }
+  ConstantRangeSetIterator end() const { return ConstantRangeSetIterator(); }
 
   bool isFullSet() const {
-    return Bounds.size() == 1 and Bounds[0].isNullValue();
+    if (isNarrow())
+      return NarrowBounds.size() == 1 and NarrowBounds[0] == 0;
+    else
+      return WideBounds.size() == 1 and WideBounds[0].isNullValue();
   }
-  bool isEmptySet() const { return Bounds.size() == 0; }
+  bool isEmptySet() const { return boundsCount() == 0; }
 
   llvm::APInt size() const {
     using namespace llvm;
 
     auto SizeBitWidth = BitWidth + 1;
 
-    if (Bounds.size() == 0)
+    if (boundsCount() == 0)
       return APInt(SizeBitWidth, 0);
 
+    // The size of a set narrower than 64 bits always fits in 64 bits
+    if (BitWidth < 64) {
+      uint64_t Mask = maskTrailingOnes<uint64_t>(BitWidth);
+      uint64_t Size = 0;
+      for (size_t I = 0; I + 1 < NarrowBounds.size(); I += 2)
+        Size += (NarrowBounds[I + 1] - NarrowBounds[I]) & Mask;
+
+      if (NarrowBounds.size() % 2 != 0)
+        Size += (uint64_t(1) << BitWidth) - NarrowBounds.back();
+
+      return APInt(SizeBitWidth, Size);
+    }
+
     APInt Size(SizeBitWidth, 0);
-    const APInt *Last = nullptr;
-    for (const llvm::APInt &N : Bounds) {
-      if (Last == nullptr) {
-        Last = &N;
+    std::optional<APInt> Last;
+    for (size_t I = 0; I < boundsCount(); ++I) {
+      APInt N = bound(I);
+      if (not Last) {
+        Last = N;
       } else {
         Size += (N - *Last).zext(SizeBitWidth);
-        Last = nullptr;
+        Last.reset();
       }
     }
 
-    if (Last != nullptr) {
+    if (Last) {
       Size += (APInt::getHighBitsSet(SizeBitWidth, 1)
                - Last->zext(SizeBitWidth));
     }
@@ -215,20 +271,42 @@ public:
     uint32_t OldSize = BitWidth;
     if (NewSize == OldSize) {
       return;
-    } else if (NewSize > OldSize) {
-      for (llvm::APInt &Bound : Bounds) {
+    } else if (boundsCount() == 0) {
+      BitWidth = NewSize;
+      return;
+    }
+
+    if (isNarrow() and NewSize <= 64) {
+      uint64_t Mask = llvm::maskTrailingOnes<uint64_t>(NewSize);
+      for (uint64_t &Bound : NarrowBounds) {
+        if (SignExtend and NewSize > OldSize)
+          Bound = llvm::SignExtend64(Bound, OldSize);
+        Bound &= Mask;
+      }
+
+      BitWidth = NewSize;
+      return;
+    }
+
+    APIntVector Bounds;
+    for (size_t I = 0; I < boundsCount(); ++I) {
+      llvm::APInt Bound = bound(I);
+      if (NewSize > OldSize) {
         if (SignExtend)
-          Bound = Bound.sext(NewSize);
+          Bounds.push_back(Bound.sext(NewSize));
         else
-          Bound = Bound.zext(NewSize);
+          Bounds.push_back(Bound.zext(NewSize));
+      } else {
+        revng_assert(NewSize < OldSize);
+        Bounds.push_back(Bound.trunc(NewSize));
       }
-    } else {
-      revng_assert(NewSize < OldSize);
-      for (llvm::APInt &Bound : Bounds)
-        Bound = Bound.trunc(NewSize);
     }
 
+    NarrowBounds.clear();
+    WideBounds.clear();
     BitWidth = NewSize;
+    for (const llvm::APInt &Bound : Bounds)
+      pushBound(Bound);
   }
 
 public:
@@ -251,13 +329,13 @@ public:
     }
 
     bool Open = true;
-    for (const llvm::APInt &N : Bounds) {
+    for (size_t I = 0; I < boundsCount(); ++I) {
       if (Open)
         Output << "[";
       else
         Output << ",";
 
-      Output << Formatter(N);
+      Output << Formatter(bound(I));
 
       if (not Open)
         Output << ") ";
@@ -265,7 +343,7 @@ public:
       Open = not Open;
     }
 
-    if (Bounds.size() == 0) {
+    if (boundsCount() == 0) {
       Output << "[)";
     }
     if (not Open) {
@@ -274,47 +352,95 @@ public:
   }
 
 private:
-  template<bool And>
-  ConstantRangeSet merge(const ConstantRangeSet &Other) const {
-    using namespace llvm;
+  bool isNarrow() const { return BitWidth <= 64; }
 
-    auto ResultBitWidth = std::max(BitWidth, Other.BitWidth);
-    ConstantRangeSet Result(ResultBitWidth, false);
-    revng_assert(BitWidth == 0 or Other.BitWidth == 0
-                 or BitWidth == Other.BitWidth);
+  size_t boundsCount() const {
+    return isNarrow() ? NarrowBounds.size() : WideBounds.size();
+  }
+
+  llvm::APInt bound(size_t Index) const {
+    if (isNarrow())
+      return llvm::APInt(BitWidth, NarrowBounds[Index]);
+    else
+      return WideBounds[Index];
+  }
+
+  void pushBound(const llvm::APInt &Bound) {
+    revng_assert(Bound.getBitWidth() == BitWidth);
+    if (isNarrow())
+      NarrowBounds.push_back(Bound.getZExtValue());
+    else
+      WideBounds.push_back(Bound);
+  }
+
+  static bool lessThan(uint64_t LHS, uint64_t RHS) { return LHS < RHS; }
+
+  static bool lessThan(const llvm::APInt &LHS, const llvm::APInt &RHS) {
+    return LHS.ult(RHS);
+  }
+
+  /// Sweeps the sorted bounds \p Left and \p Right at once, appending to
+  /// \p Result the bounds of their intersection (if \p And) or union
+  template<bool And, typename T>
+  static void mergeBounds(llvm::ArrayRef<T> Left,
+                          llvm::ArrayRef<T> Right,
+                          llvm::SmallVectorImpl<T> &Result) {
+    Result.reserve(Left.size() + Right.size());
 
     bool LastOutput = false;
     bool LeftActive = false;
     bool RightActive = false;
-    auto ZipAPIntVector = zipmap_range<const APIntVector,
-                                       const APIntVector,
-                                       APIntVectorKeyContainer>;
-    for (auto &P : ZipAPIntVector(Bounds, Other.Bounds)) {
-      const llvm::APInt *Left = P.first;
-      const llvm::APInt *Right = P.second;
-
-      if (Left != nullptr) {
-        revng_assert(Left->getBitWidth() == ResultBitWidth);
+    size_t L = 0;
+    size_t R = 0;
+    while (L < Left.size() or R < Right.size()) {
+      const T *Value = nullptr;
+      bool TakeLeft = R == Right.size()
+                      or (L < Left.size() and not lessThan(Right[R], Left[L]));
+      bool TakeRight = L == Left.size()
+                       or (R < Right.size()
+                           and not lessThan(Left[L], Right[R]));
+
+      if (TakeLeft) {
+        Value = &Left[L];
+        ++L;
         LeftActive = not LeftActive;
       }
 
-      if (Right != nullptr) {
-        revng_assert(Right->getBitWidth() == ResultBitWidth);
+      if (TakeRight) {
+        Value = &Right[R];
+        ++R;
         RightActive = not RightActive;
       }
 
-      const llvm::APInt *Value = P.first == nullptr ? P.second : P.first;
       revng_assert(Value != nullptr);
 
       bool NewOutput = And ? (LeftActive and RightActive) :
                              (LeftActive or RightActive);
 
-      if (NewOutput != LastOutput) {
-        Result.Bounds.push_back(*Value);
-      }
+      if (NewOutput != LastOutput)
+        Result.push_back(*Value);
 
       LastOutput = NewOutput;
     }
+  }
+
+  template<bool And>
+  ConstantRangeSet merge(const ConstantRangeSet &Other) const {
+    auto ResultBitWidth = std::max(BitWidth, Other.BitWidth);
+    ConstantRangeSet Result(ResultBitWidth, false);
+    revng_assert(BitWidth == 0 or Other.BitWidth == 0
+                 or BitWidth == Other.BitWidth);
+
+    if (Result.isNarrow()) {
+      mergeBounds<And, uint64_t>(NarrowBounds,
+                                 Other.NarrowBounds,
+                                 Result.NarrowBounds);
+    } else {
+      // A set with no width has no bounds either
+      mergeBounds<And, llvm::APInt>(WideBounds,
+                                    Other.WideBounds,
+                                    Result.WideBounds);
+    }
 
     return Result;
   }
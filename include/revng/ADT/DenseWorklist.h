@@ -0,0 +1,159 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "revng/Support/Assert.h"
+
+/// Assigns to each node a dense ID, i.e., an index in [0, size()), in the
+/// order in which nodes are first met
+///
+/// Nodes can be numbered all at once, e.g., all the llvm::BasicBlock of a
+/// function, or on the fly, which is preferable when only a small portion of a
+/// large graph is going to be visited.
+template<typename T>
+class DenseNumbering {
+private:
+  llvm::DenseMap<T, unsigned> IDs;
+  std::vector<T> Nodes;
+
+public:
+  DenseNumbering() = default;
+
+  /// Number the address of each element of \p Range, e.g., the blocks of a
+  /// llvm::Function
+  template<typename RangeT>
+  explicit DenseNumbering(RangeT &&Range) {
+    for (auto &&Node : Range)
+      getID(&Node);
+  }
+
+public:
+  /// \return the ID of \p Node, assigning it a new one if it doesn't have one
+  unsigned getID(T Node) {
+    auto [It, New] = IDs.try_emplace(Node, Nodes.size());
+    if (New)
+      Nodes.push_back(Node);
+    return It->second;
+  }
+
+  bool contains(T Node) const { return IDs.count(Node) != 0; }
+
+  T operator[](unsigned ID) const { return Nodes[ID]; }
+
+  size_t size() const { return Nodes.size(); }
+
+  void clear() {
+    IDs.clear();
+    Nodes.clear();
+  }
+};
+
+/// Worklist of IDs where an ID cannot be re-inserted if it's already in it
+///
+/// Membership is tracked with a bit vector and the order with a ring buffer as
+/// large as the bit vector: no ID can be in the worklist twice, so it never
+/// overflows. Once it has grown to the number of nodes, inserting and popping
+/// never allocate and take a handful of instructions.
+///
+/// \tparam Once if true, an ID that has been popped cannot be re-inserted
+///         either, i.e., each ID is visited at most once
+/// \tparam LIFO pop the most recently inserted ID first, instead of the least
+///         recently inserted one
+template<bool Once, bool LIFO = false>
+class DenseWorklistImpl {
+private:
+  /// IDs that are in the worklist or, if Once is true, have ever been
+  llvm::BitVector Queued;
+  std::vector<unsigned> Ring;
+  size_t Head = 0;
+  size_t Count = 0;
+
+public:
+  /// \param Size the expected number of IDs, the worklist grows as needed
+  explicit DenseWorklistImpl(size_t Size = 0) : Queued(Size), Ring(Size) {}
+
+public:
+  /// \return true if \p ID has been inserted, false if it already was in
+  bool insert(unsigned ID) {
+    if (ID >= Queued.size())
+      grow(ID + 1);
+    else if (Queued[ID])
+      return false;
+
+    Queued.set(ID);
+    Ring[wrap(Head + Count)] = ID;
+    ++Count;
+    return true;
+  }
+
+  bool empty() const { return Count == 0; }
+
+  size_t size() const { return Count; }
+
+  /// \return true if \p ID is in the worklist or, if Once is true, has ever
+  ///         been
+  bool contains(unsigned ID) const {
+    return ID < Queued.size() and Queued[ID];
+  }
+
+  /// \return the ID that pop() would return
+  unsigned head() const {
+    revng_assert(not empty());
+    return Ring[LIFO ? wrap(Head + Count - 1) : Head];
+  }
+
+  unsigned pop() {
+    unsigned Result = head();
+    if constexpr (not LIFO)
+      Head = wrap(Head + 1);
+    --Count;
+
+    if constexpr (not Once)
+      Queued.reset(Result);
+
+    return Result;
+  }
+
+  /// Reverse the order of the IDs in the worklist
+  void reverse() {
+    for (size_t I = 0, J = Count - 1; I < Count / 2; ++I, --J)
+      std::swap(Ring[wrap(Head + I)], Ring[wrap(Head + J)]);
+  }
+
+  void clear() {
+    Queued.reset();
+    Head = 0;
+    Count = 0;
+  }
+
+private:
+  size_t wrap(size_t Index) const {
+    return Index < Ring.size() ? Index : Index - Ring.size();
+  }
+
+  void grow(size_t MinimumSize) {
+    size_t NewSize = std::max<size_t>(MinimumSize, 2 * Queued.size());
+
+    // Make the IDs contiguous again, starting from the beginning
+    std::vector<unsigned> NewRing(NewSize);
+    for (size_t I = 0; I < Count; ++I)
+      NewRing[I] = Ring[wrap(Head + I)];
+
+    Ring = std::move(NewRing);
+    Head = 0;
+    Queued.resize(NewSize);
+  }
+};
+
+using DenseWorklist = DenseWorklistImpl<false>;
+using DenseOnceWorklist = DenseWorklistImpl<true>;
@@ -5,6 +5,7 @@
 //
 
 #include <algorithm>
+#include <bit>
 #include <climits>
 #include <cstdint>
 #include <cstring>
@@ -16,18 +17,10 @@
 
 // TODO: implement shrinking
 
-// TODO: implement using __builtin_clz if available
 /// Returns the minimum amount of bits required to represent \p Value
 template<typename T>
 inline unsigned requiredBits(T Value) {
-  unsigned Result = 0;
-
-  while (Value != 0) {
-    Result++;
-    Value = Value >> 1;
-  }
-
-  return Result;
+  return std::bit_width(static_cast<std::make_unsigned_t<T>>(Value));
 }
 
 template<typename T, typename A, typename B>
@@ -107,6 +100,38 @@ private:
   static const uintptr_t One = 1;
   static const unsigned IntMax = std::numeric_limits<int32_t>::max();
 
+  /// \name Kernels for the large representation
+  ///
+  /// These work on plain arrays of words, without bounds checks or
+  /// dependencies across iterations, so that the compiler can vectorize them
+  /// (e.g., using AVX2 or NEON) without resorting to intrinsics.
+  /// @{
+
+  template<typename OperationT>
+  static void combine(uintptr_t *__restrict Destination,
+                      const uintptr_t *__restrict Source,
+                      size_t Count,
+                      OperationT &&Operation) {
+    for (size_t I = 0; I < Count; ++I)
+      Destination[I] = Operation(Destination[I], Source[I]);
+  }
+
+  static bool allZero(const uintptr_t *Words, size_t Count) {
+    uintptr_t Result = 0;
+    for (size_t I = 0; I < Count; ++I)
+      Result |= Words[I];
+    return Result == 0;
+  }
+
+  static unsigned popcount(const uintptr_t *Words, size_t Count) {
+    unsigned Result = 0;
+    for (size_t I = 0; I < Count; ++I)
+      Result += std::popcount(Words[I]);
+    return Result;
+  }
+
+  /// @}
+
   struct LargeStorage {
     unsigned wordCount() const { return Capacity / BitsPerPointer; }
     unsigned capacity() const { return Capacity; }
@@ -129,12 +154,20 @@ private:
       return Storage[Index];
     }
 
+    uintptr_t *data() { return Storage; }
+    const uintptr_t *data() const { return Storage; }
+
+    bool isZero(size_t From) const {
+      revng_assert(From <= wordCount());
+      return allZero(data() + From, wordCount() - From);
+    }
+
     void zero(size_t From, size_t Count) {
       revng_assert(From + Count <= wordCount());
-      memset(&at(From), 0, Count * sizeof(uintptr_t));
+      memset(data() + From, 0, Count * sizeof(uintptr_t));
     }
 
-    void zero(size_t From) { zero(From, wordCount()); }
+    void zero(size_t From) { zero(From, wordCount() - From); }
 
     void zero() { zero(0); }
 
@@ -142,7 +175,11 @@ private:
 
     LargeStorage &operator=(const LargeStorage &Other) {
       revng_assert(Capacity >= Other.Capacity);
-      memcpy(&at(0), &Other.at(0), Other.Capacity / sizeof(uintptr_t));
+      if (this == &Other)
+        return *this;
+
+      memcpy(data(), Other.data(), Other.wordCount() * sizeof(uintptr_t));
+      zero(Other.wordCount(), wordCount() - Other.wordCount());
       return *this;
     }
 
@@ -261,14 +298,38 @@ public:
     }
   }
 
-  bool isZero() const { return requiredBits() == 0; }
+  bool isZero() const {
+    if (isSmall())
+      return getSmall() == 0;
+    else
+      return getLarge().isZero(0);
+  }
+
+  /// The number of set bits
+  unsigned count() const {
+    if (isSmall())
+      return std::popcount(getSmall());
+
+    const LargeStorage &Large = getLarge();
+    return popcount(Large.data(), Large.wordCount());
+  }
 
   LazySmallBitVector &operator=(const LazySmallBitVector &Other) {
     if (!(Other.isSmall() || Other.capacity() > 63))
       revng_abort();
 
+    if (this == &Other)
+      return *this;
+
     if (Other.isSmall()) {
-      Storage = Other.Storage;
+      if (isSmall()) {
+        Storage = Other.Storage;
+      } else {
+        // Keep the storage we have
+        LargeStorage &Large = getLarge();
+        Large.zero();
+        Large.at(0) = Other.getSmall();
+      }
     } else {
       if (Other.capacity() > capacity())
         alloc(Other.capacity());
@@ -301,39 +362,28 @@ public:
       const LargeStorage &OtherLarge = Other.getLarge();
       const LargeStorage &ThisLarge = getLarge();
 
-      unsigned Max = std::min(ThisLarge.capacity(), OtherLarge.capacity());
-      Max /= BitsPerPointer;
-
-      for (unsigned I = 0; I < Max; I++)
-        if (ThisLarge.at(I) != OtherLarge.at(I))
-          return false;
+      unsigned Max = std::min(ThisLarge.wordCount(), OtherLarge.wordCount());
+      size_t Size = Max * sizeof(uintptr_t);
+      if (memcmp(ThisLarge.data(), OtherLarge.data(), Size) != 0)
+        return false;
 
-      if (ThisLarge.capacity() > OtherLarge.capacity()) {
-        for (unsigned I = Max; I < ThisLarge.wordCount(); I++)
-          if (ThisLarge.at(I) != 0)
-            return false;
-      } else {
-        for (unsigned I = Max; I < OtherLarge.wordCount(); I++)
-          if (OtherLarge.at(I) != 0)
-            return false;
-      }
+      if (not ThisLarge.isZero(Max) or not OtherLarge.isZero(Max))
+        return false;
 
     } else if (!isSmall() && Other.isSmall()) {
       const LargeStorage &ThisLarge = getLarge();
       if (ThisLarge.at(0) != Other.getSmall())
         return false;
 
-      for (unsigned I = 1; I < ThisLarge.wordCount(); I++)
-        if (ThisLarge.at(I) != 0)
-          return false;
+      if (not ThisLarge.isZero(1))
+        return false;
     } else if (isSmall() && !Other.isSmall()) {
       const LargeStorage &OtherLarge = Other.getLarge();
       if (OtherLarge.at(0) != getSmall())
         return false;
 
-      for (unsigned I = 1; I < OtherLarge.wordCount(); I++)
-        if (OtherLarge.at(I) != 0)
-          return false;
+      if (not OtherLarge.isZero(1))
+        return false;
     }
 
     return true;
@@ -389,60 +439,23 @@ public:
     revng_abort();
   }
 
+  /// \note the compound operators reallocate only if the result has bits set
+  ///       beyond the current capacity
   LazySmallBitVector &operator^=(const LazySmallBitVector &Other) {
-    // Ensure we have at least the same capacity as Other
-    if (Other.capacity() > this->capacity())
-      alloc(Other.capacity());
-
-    // This situation should never happen, since we just ensured we have at
-    // least the same capacity
-    revng_assert(!(isSmall() && !Other.isSmall()));
-
-    if (isSmall() && Other.isSmall()) {
-      Storage = (Storage ^ Other.Storage) | 1;
-    } else if (!isSmall() && !Other.isSmall()) {
-      const LargeStorage &OtherLarge = Other.getLarge();
-      LargeStorage &ThisLarge = getLarge();
-
-      unsigned Max = std::min(ThisLarge.capacity(), OtherLarge.capacity());
-      Max /= BitsPerPointer;
-      for (unsigned I = 0; I < Max; I++)
-        ThisLarge.at(I) = ThisLarge.at(I) ^ OtherLarge.at(I);
-
-    } else if (!isSmall() && Other.isSmall()) {
-      LargeStorage &ThisLarge = getLarge();
-      ThisLarge.at(0) = ThisLarge.at(0) ^ Other.getSmall();
+    if (this == &Other) {
+      zero();
+      return *this;
     }
 
+    merge(Other, [](uintptr_t LHS, uintptr_t RHS) { return LHS ^ RHS; });
     return *this;
   }
 
   LazySmallBitVector &operator|=(const LazySmallBitVector &Other) {
-    // Ensure we have at least the same capacity as Other
-    if (Other.capacity() > this->capacity())
-      alloc(Other.capacity());
-
-    // This situation should never happen, since we just ensured we have at
-    // least the same capacity
-    revng_assert(!(isSmall() && !Other.isSmall()));
-
-    if (isSmall() && Other.isSmall()) {
-      Storage = Storage | Other.Storage;
-    } else if (!isSmall() && !Other.isSmall()) {
-      const LargeStorage &OtherLarge = Other.getLarge();
-      LargeStorage &ThisLarge = getLarge();
-
-      unsigned Max = std::min(ThisLarge.capacity(), OtherLarge.capacity());
-      Max /= BitsPerPointer;
-
-      for (unsigned I = 0; I < Max; I++)
-        ThisLarge.at(I) = ThisLarge.at(I) | OtherLarge.at(I);
-
-    } else if (!isSmall() && Other.isSmall()) {
-      LargeStorage &ThisLarge = getLarge();
-      ThisLarge.at(0) = ThisLarge.at(0) | Other.getSmall();
-    }
+    if (this == &Other)
+      return *this;
 
+    merge(Other, [](uintptr_t LHS, uintptr_t RHS) { return LHS | RHS; });
     return *this;
   }
 
@@ -477,9 +490,14 @@ public:
                      ThisPointersCount - OtherPointersCount);
         }
 
+        if (this == &Other)
+          return *this;
+
         unsigned Max = std::min(OtherPointersCount, ThisPointersCount);
-        for (unsigned I = 0; I < Max; I++)
-          Large.at(I) = Large.at(I) & OtherLarge.at(I);
+        combine(Large.data(),
+                OtherLarge.data(),
+                Max,
+                [](uintptr_t LHS, uintptr_t RHS) { return LHS & RHS; });
       }
     }
 
@@ -628,6 +646,40 @@ private:
   friend iterator;
   friend const_iterator;
 
+  /// Apply \p Operation, which must map zero to zero, to each word of this
+  /// bit vector and the corresponding word of \p Other
+  template<typename OperationT>
+  void merge(const LazySmallBitVector &Other, OperationT &&Operation) {
+    // Grow only if Other has bits we cannot represent
+    unsigned OtherBits = Other.requiredBits();
+    if (OtherBits > capacity())
+      alloc(OtherBits);
+
+    if (Other.isSmall()) {
+      if (isSmall())
+        setSmall(Operation(getSmall(), Other.getSmall()));
+      else
+        getLarge().at(0) = Operation(getLarge().at(0), Other.getSmall());
+      return;
+    }
+
+    const LargeStorage &OtherLarge = Other.getLarge();
+    if (isSmall()) {
+      // All the bits of Other fit in the small representation
+      setSmall(Operation(getSmall(), OtherLarge.at(0)));
+      return;
+    }
+
+    // Words of Other past its required bits are all zero, ignore them
+    LargeStorage &ThisLarge = getLarge();
+    size_t OtherWords = excessDivide(OtherBits, BitsPerPointer);
+    revng_assert(OtherWords <= ThisLarge.wordCount());
+    combine(ThisLarge.data(),
+            OtherLarge.data(),
+            OtherWords,
+            std::forward<OperationT>(Operation));
+  }
+
   uintptr_t getSmall() const {
     revng_assert(isSmall());
     return Storage >> 1;
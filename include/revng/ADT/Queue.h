@@ -4,49 +4,45 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <queue>
 #include <set>
 
+#include "revng/ADT/DenseWorklist.h"
 #include "revng/Support/Assert.h"
 
 /// Queue where an element cannot be re-inserted if it's already in the queue
+///
+/// Elements are numbered as they are first inserted, the queue itself works on
+/// their IDs, see DenseWorklistImpl.
 template<typename T, bool Once>
 class QueueImpl {
 public:
-  void insert(T Element) {
-    if (!Set.contains(Element)) {
-      Set.insert(Element);
-      Queue.push(Element);
-    }
-  }
+  void insert(T Element) { Worklist.insert(Numbering.getID(Element)); }
 
-  bool empty() const { return Queue.empty(); }
+  bool empty() const { return Worklist.empty(); }
 
-  T head() const { return Queue.front(); }
+  T head() const { return Numbering[Worklist.head()]; }
 
-  T pop() {
-    T Result = head();
-    Queue.pop();
-    if (!Once)
-      Set.erase(Result);
-    return Result;
-  }
+  T pop() { return Numbering[Worklist.pop()]; }
 
-  size_t size() const { return Queue.size(); }
+  size_t size() const { return Worklist.size(); }
 
   std::set<T> visited() {
     revng_assert(Once);
-    return std::move(Set);
+    std::set<T> Result;
+    for (unsigned ID = 0; ID < Numbering.size(); ++ID)
+      Result.insert(Numbering[ID]);
+    clear();
+    return Result;
   }
 
   void clear() {
-    std::set<T>().swap(Set);
-    std::queue<T>().swap(Queue);
+    Numbering.clear();
+    Worklist = DenseWorklistImpl<Once>();
   }
 
 private:
-  std::set<T> Set;
-  std::queue<T> Queue;
+  DenseNumbering<T> Numbering;
+  DenseWorklistImpl<Once> Worklist;
 };
 
 template<typename T>
@@ -5,9 +5,13 @@
 //
 
 #include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <optional>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "revng/Support/Assert.h"
 
@@ -16,6 +20,116 @@ struct RecursiveCoroutine;
 
 namespace revng::detail {
 
+/// A per-thread stack of memory chunks hosting the frames of
+/// RecursiveCoroutines
+///
+/// The frame of a callee is always destroyed before the frame of its caller,
+/// so frames are allocated and released in a stack-like fashion: allocating a
+/// frame is a bump of a pointer and the chunks are reused across calls.
+/// Frames released out of order (e.g., a RecursiveCoroutine that has been
+/// moved around) are only reclaimed once all the frames allocated after them
+/// have been released too.
+///
+/// \note a frame must be released by the thread that allocated it.
+class CoroutineFrameArena {
+private:
+  static constexpr size_t Alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+  static constexpr size_t ChunkSize = 256 * 1024;
+
+  /// Frames larger than this are allocated on the heap
+  static constexpr size_t MaxFrameSize = ChunkSize / 4;
+
+  struct alignas(Alignment) Header {
+    /// The frame allocated before this one, nullptr for the first frame
+    Header *Previous = nullptr;
+    size_t Size = 0;
+    uint32_t Chunk = 0;
+    bool OnHeap = false;
+    bool Released = false;
+  };
+
+private:
+  std::vector<std::byte *> Chunks;
+  uint32_t CurrentChunk = 0;
+  std::byte *Next = nullptr;
+  std::byte *End = nullptr;
+  Header *Top = nullptr;
+
+public:
+  CoroutineFrameArena() = default;
+  CoroutineFrameArena(const CoroutineFrameArena &) = delete;
+  CoroutineFrameArena &operator=(const CoroutineFrameArena &) = delete;
+
+  ~CoroutineFrameArena() {
+    for (std::byte *Chunk : Chunks)
+      ::operator delete(Chunk);
+  }
+
+public:
+  static CoroutineFrameArena &get() {
+    thread_local CoroutineFrameArena Arena;
+    return Arena;
+  }
+
+public:
+  // Not inlined: GCC would otherwise warn (-Wfree-nonheap-object) when the
+  // frame is released by the class-specific operator delete of the promise
+  __attribute__((noinline)) void *allocate(size_t Size) {
+    Size = (Size + Alignment - 1) & ~(Alignment - 1);
+    size_t Needed = sizeof(Header) + Size;
+
+    if (Size > MaxFrameSize) {
+      auto *Result = new (::operator new(Needed)) Header;
+      Result->Size = Size;
+      Result->OnHeap = true;
+      return Result + 1;
+    }
+
+    if (Next == nullptr or static_cast<size_t>(End - Next) < Needed)
+      nextChunk();
+
+    auto *Result = new (Next) Header;
+    Result->Previous = Top;
+    Result->Size = Size;
+    Result->Chunk = CurrentChunk;
+    Top = Result;
+    Next += Needed;
+
+    return Result + 1;
+  }
+
+  void release(void *Pointer) {
+    Header *Frame = static_cast<Header *>(Pointer) - 1;
+    if (Frame->OnHeap) {
+      ::operator delete(Frame);
+      return;
+    }
+
+    Frame->Released = true;
+
+    // Pop all the released frames on top of the stack
+    while (Top != nullptr and Top->Released) {
+      Header *Popped = Top;
+      Top = Popped->Previous;
+      CurrentChunk = Popped->Chunk;
+      End = Chunks[CurrentChunk] + ChunkSize;
+      Next = reinterpret_cast<std::byte *>(Popped);
+    }
+  }
+
+private:
+  void nextChunk() {
+    if (Next != nullptr)
+      ++CurrentChunk;
+
+    if (CurrentChunk == Chunks.size())
+      Chunks.push_back(static_cast<std::byte *>(::operator new(ChunkSize)));
+
+    Next = Chunks[CurrentChunk];
+    End = Next + ChunkSize;
+  }
+};
+
 template<typename RetT>
 struct ReturnBase {
 
@@ -63,6 +177,14 @@ struct RecursivePromise : public ReturnBase<ReturnT> {
 
   [[noreturn]] void unhandled_exception() const { std::terminate(); }
 
+  static void *operator new(std::size_t Size) noexcept {
+    return CoroutineFrameArena::get().allocate(Size);
+  }
+
+  static void operator delete(void *Pointer) {
+    CoroutineFrameArena::get().release(Pointer);
+  }
+
   auto initial_suspend() const { return std::suspend_always(); }
 
   auto final_suspend() noexcept {
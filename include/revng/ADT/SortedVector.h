@@ -4,6 +4,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
 #include "llvm/ADT/STLExtras.h"
 
 #include "revng/ADT/KeyedObjectContainer.h"
@@ -28,6 +34,65 @@ unique_last(ForwardIt First, ForwardIt Last, BinaryPredicate Predicate) {
   return ++Result;
 }
 
+/// A read-only copy of a sorted sequence of keys, in Eytzinger layout
+///
+/// The keys are stored as an implicit binary search tree in breadth-first
+/// order: the children of the node in position `I` are in `2 * I` and
+/// `2 * I + 1`. Compared to a binary search over the original sequence, the
+/// first levels of the tree share few cache lines and the search never touches
+/// anything but keys.
+template<typename KeyType, typename Compare>
+class EytzingerIndex {
+private:
+  /// The keys, the node in position `I` is in `Keys[I - 1]`
+  std::vector<KeyType> Keys;
+
+  /// The position in the original sequence of each element of Keys
+  std::vector<uint32_t> Positions;
+
+public:
+  template<typename RangeType, typename KeyGetter>
+  EytzingerIndex(const RangeType &Sorted, const KeyGetter &GetKey) {
+    revng_assert(Sorted.size() <= std::numeric_limits<uint32_t>::max());
+    Positions.resize(Sorted.size());
+    uint32_t Next = 0;
+    fill(1, Next);
+
+    Keys.reserve(Sorted.size());
+    for (uint32_t Position : Positions)
+      Keys.emplace_back(GetKey(Sorted[Position]));
+  }
+
+public:
+  size_t size() const { return Keys.size(); }
+
+  /// \returns the position in the original sequence of the first key not less
+  ///          than \p Key, or size() if there's none
+  template<typename T>
+  size_t lowerBound(const T &Key) const {
+    size_t Size = size();
+    size_t I = 1;
+    while (I <= Size)
+      I = 2 * I + (Compare()(Keys[I - 1], Key) ? 1 : 0);
+
+    // Drop the trailing right turns, and the last left turn
+    I >>= std::countr_one(I) + 1;
+
+    return I == 0 ? Size : Positions[I - 1];
+  }
+
+private:
+  /// Visits the tree in order, assigning increasing positions
+  void fill(size_t I, uint32_t &Next) {
+    if (I > Positions.size())
+      return;
+
+    fill(2 * I, Next);
+    Positions[I - 1] = Next++;
+    fill(2 * I + 1, Next);
+  }
+};
+
 template<KeyedObjectContainerCompatible T,
          class Compare = DefaultKeyObjectComparator<T>>
 class SortedVector {
@@ -57,10 +122,22 @@ public:
 public:
   static constexpr bool KeyedObjectContainerTag = true;
 
+private:
+  using IndexType = EytzingerIndex<std::remove_cvref_t<key_type>, Compare>;
+
+  /// Containers smaller than this are searched directly
+  static constexpr size_t IndexThreshold = 256;
+
 private:
   vector_type TheVector;
   bool BatchInsertInProgress = false;
 
+  /// Side index on the keys, built when a batch insertion is committed and
+  /// dropped whenever the set of keys changes.
+  ///
+  /// It's never changed once it's built, so copies can share it.
+  std::shared_ptr<const IndexType> KeysIndex;
+
 public:
   SortedVector() {}
 
@@ -80,9 +157,13 @@ public:
   void swap(SortedVector &Other) {
     revng_assert(not BatchInsertInProgress);
     TheVector.swap(Other.TheVector);
+    KeysIndex.swap(Other.KeysIndex);
   }
 
-  bool operator==(const SortedVector &) const = default;
+  bool operator==(const SortedVector &Other) const {
+    revng_assert(not BatchInsertInProgress);
+    return TheVector == Other.TheVector;
+  }
 
 public:
   T &at(const key_type &Key) {
@@ -186,6 +267,7 @@ public:
 
   void clear() {
     revng_assert(not BatchInsertInProgress);
+    KeysIndex.reset();
     TheVector.clear();
   }
 
@@ -209,11 +291,13 @@ public:
     auto Key = KeyedObjectTraits<T>::key(Value);
     auto It = lower_bound(Key);
     if (It == end()) {
+      KeysIndex.reset();
       TheVector.emplace_back(std::move(Value));
       return { --end(), true };
     } else if (keysEqual(KeyedObjectTraits<T>::key(*It), Key)) {
       return { It, false };
     } else {
+      KeysIndex.reset();
       return { TheVector.emplace(It, std::move(Value)), true };
     }
   }
@@ -230,23 +314,27 @@ public:
     auto Key = KeyedObjectTraits<T>::key(Value);
     auto It = lower_bound(Key);
     if (It == end()) {
+      KeysIndex.reset();
       TheVector.emplace_back(std::move(Value));
       return { --end(), true };
     } else if (keysEqual(KeyedObjectTraits<T>::key(*It), Key)) {
       *It = std::move(Value);
       return { It, false };
     } else {
+      KeysIndex.reset();
       return { TheVector.emplace(It, std::move(Value)), true };
     }
   }
 
   iterator erase(iterator Pos) {
     revng_assert(not BatchInsertInProgress);
+    KeysIndex.reset();
     return TheVector.erase(Pos);
   }
 
   iterator erase(const_iterator First, const_iterator Last) {
     revng_assert(not BatchInsertInProgress);
+    KeysIndex.reset();
     return TheVector.erase(First, Last);
   }
 
@@ -264,7 +352,11 @@ public:
   template<typename CallableType>
   size_type erase_if(CallableType &&Callable) {
     revng_assert(not BatchInsertInProgress);
-    return std::erase_if(TheVector, std::forward<CallableType>(Callable));
+    size_type Erased = std::erase_if(TheVector,
+                                     std::forward<CallableType>(Callable));
+    if (Erased != 0)
+      KeysIndex.reset();
+    return Erased;
   }
 
   size_type count(const key_type &Key) const {
@@ -298,22 +390,22 @@ public:
 
   iterator lower_bound(const key_type &Key) {
     revng_assert(not BatchInsertInProgress);
-    return std::lower_bound(begin(), end(), KOT::fromKey(Key), compareElements);
+    return begin() + lowerBoundPosition(Key);
   }
 
   const_iterator lower_bound(const key_type &Key) const {
     revng_assert(not BatchInsertInProgress);
-    return std::lower_bound(begin(), end(), KOT::fromKey(Key), compareElements);
+    return begin() + lowerBoundPosition(Key);
   }
 
   iterator upper_bound(const key_type &Key) {
     revng_assert(not BatchInsertInProgress);
-    return std::upper_bound(begin(), end(), KOT::fromKey(Key), compareElements);
+    return std::upper_bound(begin(), end(), Key, compareKeyToElement);
   }
 
   const_iterator upper_bound(const key_type &Key) const {
     revng_assert(not BatchInsertInProgress);
-    return std::upper_bound(begin(), end(), KOT::fromKey(Key), compareElements);
+    return std::upper_bound(begin(), end(), Key, compareKeyToElement);
   }
 
 public:
@@ -354,6 +446,7 @@ public:
     template<typename... Types>
     T &emplaceImpl(Types &&...Values) {
       revng_assert(SV->BatchInsertInProgress);
+      SV->KeysIndex.reset();
       SV->TheVector.emplace_back(std::forward<Types>(Values)...);
       return SV->TheVector.back();
     }
@@ -421,6 +514,35 @@ private:
     return Compare()(LHS, RHS);
   }
 
+  static bool compareElementToKey(const T &LHS, const key_type &RHS) {
+    return compareKeys(KeyedObjectTraits<T>::key(LHS), RHS);
+  }
+
+  static bool compareKeyToElement(const key_type &LHS, const T &RHS) {
+    return compareKeys(LHS, KeyedObjectTraits<T>::key(RHS));
+  }
+
+  size_t lowerBoundPosition(const key_type &Key) const {
+    if (KeysIndex)
+      return KeysIndex->lowerBound(Key);
+
+    auto It = std::lower_bound(TheVector.begin(),
+                               TheVector.end(),
+                               Key,
+                               compareElementToKey);
+    return It - TheVector.begin();
+  }
+
+  void buildIndex() {
+    if (TheVector.size() < IndexThreshold) {
+      KeysIndex.reset();
+      return;
+    }
+
+    auto GetKey = [](const T &Element) { return KOT::key(Element); };
+    KeysIndex = std::make_shared<const IndexType>(TheVector, GetKey);
+  }
+
   static bool elementsEqual(const T &LHS, const T &RHS) {
     return keysEqual(KeyedObjectTraits<T>::key(LHS),
                      KeyedObjectTraits<T>::key(RHS));
@@ -441,6 +563,8 @@ private:
       auto NewEnd = unique_last(begin(), end(), elementsEqual);
       TheVector.erase(NewEnd, end());
     }
+
+    buildIndex();
   }
 };
 
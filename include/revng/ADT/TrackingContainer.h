@@ -79,6 +79,7 @@ public:
   /// @{
 
   void stopTracking() const { TrackingIsActive = false; }
+  bool isTracking() const { return TrackingIsActive; }
   void clearTracking() const {
     Exact.clear();
     NonExisting = {};
@@ -213,8 +214,10 @@ public:
 #ifdef TUPLE_TREE_GENERATOR_EMIT_TRACKING_DEBUG
     onFieldAccess("at", name());
 #endif
-    markExistingKey(Key);
-    return Content.at(Key);
+    auto Iter = Content.find(Key);
+    revng_assert(Iter != Content.end());
+    markExisting(Iter);
+    return *Iter;
   }
 
   value_type &operator[](const key_type &Key) { return Content[Key]; }
@@ -306,17 +309,17 @@ public:
 #ifdef TUPLE_TREE_GENERATOR_EMIT_TRACKING_DEBUG
     onFieldAccess("count", name());
 #endif
-    auto Quantity = Content.count(Key);
-
     if (not TrackingIsActive)
-      return Quantity;
+      return Content.count(Key);
 
-    if (Quantity == 0) {
+    auto Iter = Content.find(Key);
+    if (Iter == Content.end()) {
       NonExisting.back().insert(Key);
-    } else {
-      markExistingKey(Key);
+      return 0;
     }
-    return Quantity;
+
+    markExisting(Iter);
+    return 1;
   }
 
   bool contains(const key_type &Key) const { return count(Key) != 0; }
@@ -329,7 +332,7 @@ public:
       return nullptr;
     }
 
-    markExistingKey(Key);
+    markExisting(Iter);
     return &*Iter;
   }
 
@@ -344,7 +347,7 @@ public:
       return nullptr;
     }
 
-    markExistingKey(Key);
+    markExisting(Iter);
     return &*Iter;
   }
 
@@ -410,14 +413,20 @@ public:
   }
 
 private:
-  void markExistingKey(const key_type &Key) const {
+  void markExisting(const_iterator Iter) const {
     if (not TrackingIsActive)
       return;
-    auto Iter = Content.find(Key);
-    revng_assert(Iter != Content.end());
     revng_assert(Existing.back().size() == Content.size());
 
-    Existing.back()[std::distance(Content.begin(), Iter)] = true;
+    Existing.back().set(std::distance(Content.begin(), Iter));
+  }
+
+  void markExisting(iterator Iter) {
+    if (not TrackingIsActive)
+      return;
+    revng_assert(Existing.back().size() == Content.size());
+
+    Existing.back().set(std::distance(Content.begin(), Iter));
   }
 
   TrackingSet getNonExistingRequestedKeys() const {
@@ -429,15 +438,22 @@ private:
   }
 
   TrackingSet getExistingRequestedKeys() const {
-    TrackingSet Set;
+    // Merge all the levels of the stack first, so that each element is
+    // visited at most once and keys are produced in order
+    llvm::BitVector Accessed(Content.size());
     for (auto &BitVector : Existing) {
       revng_assert(Content.size() == BitVector.size());
-      for (size_t I = 0; I < Content.size(); I++) {
-        if (not BitVector[I])
-          continue;
-        using KOT = KeyedObjectTraits<value_type>;
-        Set.insert(KOT::key(*std::next(Content.begin(), I)));
-      }
+      Accessed |= BitVector;
+    }
+
+    TrackingSet Set;
+    auto Iter = Content.begin();
+    size_t Position = 0;
+    for (unsigned Index : Accessed.set_bits()) {
+      std::advance(Iter, Index - Position);
+      Position = Index;
+      using KOT = KeyedObjectTraits<value_type>;
+      Set.insert(Set.end(), KOT::key(*Iter));
     }
 
     return Set;
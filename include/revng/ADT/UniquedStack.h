@@ -4,39 +4,34 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <algorithm>
-#include <set>
-#include <vector>
-
+#include "revng/ADT/DenseWorklist.h"
 #include "revng/Support/Assert.h"
 
 /// Stack where an element cannot be re-inserted in it's already in the stack
+///
+/// Elements are numbered as they are first inserted, the stack itself works on
+/// their IDs, see DenseWorklistImpl.
 template<typename T>
 class UniquedStack {
 public:
   void insert(T Element) {
-    if (!Set.contains(Element)) {
+    unsigned ID = Numbering.getID(Element);
+    if (not Worklist.contains(ID)) {
       revng_assert(Element->getParent() != nullptr);
-      Set.insert(Element);
-      Queue.push_back(Element);
+      Worklist.insert(ID);
     }
   }
 
-  bool empty() const { return Queue.empty(); }
+  bool empty() const { return Worklist.empty(); }
 
-  T pop() {
-    T Result = Queue.back();
-    Queue.pop_back();
-    Set.erase(Result);
-    return Result;
-  }
+  T pop() { return Numbering[Worklist.pop()]; }
 
   /// Reverses the stack in its current status
-  void reverse() { std::reverse(Queue.begin(), Queue.end()); }
+  void reverse() { Worklist.reverse(); }
 
-  size_t size() const { return Queue.size(); }
+  size_t size() const { return Worklist.size(); }
 
 private:
-  std::set<T> Set;
-  std::vector<T> Queue;
+  DenseNumbering<T> Numbering;
+  DenseWorklistImpl<false, true> Worklist;
 };
@@ -4,8 +4,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
 #include <memory>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Casting.h"
@@ -52,6 +55,104 @@ concept UpcastablePointerLike = Dereferenceable<T> and Upcastable<pointee<T>>;
 template<typename T>
 concept NotUpcastablePointerLike = not UpcastablePointerLike<T>;
 
+namespace revng::detail {
+
+template<typename T>
+using KindOf = std::decay_t<decltype(std::declval<const T &>().Kind())>;
+
+template<typename Base, typename Derived>
+concept HasAssociatedKind = requires {
+  {
+    std::remove_const_t<Derived>::AssociatedKind
+  } -> std::convertible_to<KindOf<Base>>;
+};
+
+template<typename T, typename Tuple>
+inline constexpr bool AllConcreteTypesHaveKind = false;
+
+template<typename T, typename... Types>
+inline constexpr bool AllConcreteTypesHaveKind<T, std::tuple<Types...>> =
+  ((HasAssociatedKind<T, Types>
+    or std::is_same_v<std::remove_const_t<Types>, std::remove_const_t<T>>)
+   and ...);
+
+/// Types whose concrete type can be found by indexing a table with the value
+/// of their `Kind()` field, as the ones emitted by the TupleTree generator
+///
+/// This is worth it only when there are more than two concrete types: with
+/// two, dyn_cast boils down to a single comparison, cheaper than an indirect
+/// call.
+template<typename T>
+concept KindDispatchable = requires(const T &Value) {
+  Value.Kind();
+  KindOf<T>::Count;
+} and AllConcreteTypesHaveKind<T, concrete_types_traits_t<T>>
+  and (std::tuple_size_v<concrete_types_traits_t<T>> > 2);
+
+/// \return for each value of `Kind()`, the index in the concrete types of \p T
+///         of the type to upcast to, the number of concrete types if none
+///
+/// It mirrors the chain of dyn_casts: the first concrete type whose
+/// AssociatedKind matches wins and \p T itself, if concrete, matches all the
+/// kinds.
+template<KindDispatchable T>
+constexpr auto makeKindTable() {
+  using Types = concrete_types_traits_t<T>;
+  constexpr size_t TypesCount = std::tuple_size_v<Types>;
+  constexpr size_t KindsCount = static_cast<size_t>(KindOf<T>::Count) + 1;
+
+  std::array<size_t, KindsCount> Table;
+  Table.fill(TypesCount);
+
+  auto Assign = [&Table]<size_t I>(std::integral_constant<size_t, I>) {
+    using Type = std::remove_const_t<std::tuple_element_t<I, Types>>;
+    if constexpr (std::is_same_v<Type, std::remove_const_t<T>>) {
+      for (size_t &Entry : Table)
+        if (Entry == TypesCount)
+          Entry = I;
+    } else {
+      size_t &Entry = Table[static_cast<size_t>(Type::AssociatedKind)];
+      if (Entry == TypesCount)
+        Entry = I;
+    }
+  };
+
+  [&]<size_t... I>(std::index_sequence<I...>) {
+    (Assign(std::integral_constant<size_t, I>()), ...);
+  }(std::make_index_sequence<TypesCount>());
+
+  return Table;
+}
+
+/// Invoke \p Callable on \p Pointer, upcasted to its concrete type through a
+/// pair of constant tables
+template<typename ReturnT, typename L, KindDispatchable Pointee>
+ReturnT upcastByKind(Pointee *Pointer, const L &Callable) {
+  using Types = concrete_types_traits_t<std::remove_const_t<Pointee>>;
+  using Thunk = ReturnT (*)(Pointee *, const L &);
+  constexpr size_t TypesCount = std::tuple_size_v<Types>;
+
+  static constexpr auto Table = makeKindTable<std::remove_const_t<Pointee>>();
+  static constexpr auto Thunks = []<size_t... I>(std::index_sequence<I...>) {
+    return std::array<Thunk, TypesCount + 1>{
+      +[](Pointee *P, const L &C) -> ReturnT {
+        using Type = std::tuple_element_t<I, Types>;
+        using Target = std::conditional_t<std::is_const_v<Pointee>,
+                                          const Type,
+                                          Type>;
+        return C(*static_cast<Target *>(P));
+      }...,
+      +[](Pointee *, const L &) -> ReturnT { revng_abort(); }
+    };
+  }(std::make_index_sequence<TypesCount>());
+
+  auto Kind = static_cast<size_t>(Pointer->Kind());
+  size_t Index = Kind < Table.size() ? Table[Kind] : TypesCount;
+  return Thunks[Index](Pointer, Callable);
+}
+
+} // namespace revng::detail
+
 template<typename ReturnT, typename L, UpcastablePointerLike P, size_t I = 0>
   requires(not std::is_void_v<ReturnT>)
 ReturnT upcast(P &&Upcastable, const L &Callable, ReturnT &&IfNull) {
@@ -61,7 +162,10 @@ ReturnT upcast(P &&Upcastable, const L &Callable, ReturnT &&IfNull) {
   if (Pointer == nullptr)
     return std::forward<ReturnT>(IfNull);
 
-  if constexpr (I < std::tuple_size_v<concrete_types>) {
+  using Bare = std::remove_const_t<pointee>;
+  if constexpr (I == 0 and revng::detail::KindDispatchable<Bare>) {
+    return revng::detail::upcastByKind<ReturnT>(Pointer, Callable);
+  } else if constexpr (I < std::tuple_size_v<concrete_types>) {
     using type = std::tuple_element_t<I, concrete_types>;
     if (auto *Upcasted = llvm::dyn_cast<type>(Pointer)) {
       return Callable(*Upcasted);
@@ -83,7 +187,11 @@ llvm::Error upcast(P &&Upcastable, const L &Callable, llvm::Error IfNull) {
   if (Pointer == nullptr)
     return IfNull;
 
-  if constexpr (I < std::tuple_size_v<concrete_types>) {
+  using Bare = std::remove_const_t<pointee>;
+  if constexpr (I == 0 and revng::detail::KindDispatchable<Bare>) {
+    llvm::consumeError(std::move(IfNull));
+    return revng::detail::upcastByKind<llvm::Error>(Pointer, Callable);
+  } else if constexpr (I < std::tuple_size_v<concrete_types>) {
     using type = std::tuple_element_t<I, concrete_types>;
     if (auto *Upcasted = llvm::dyn_cast<type>(Pointer)) {
       llvm::consumeError(std::move(IfNull));
@@ -0,0 +1,37 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/IR/PassManager.h"
+
+/// Perform several cleanups of the lifted code in a single sweep over the
+/// instructions of a function
+///
+/// Each cleanup is equivalent to one of the following passes, which would all
+/// traverse the whole function on their own:
+///
+/// * RemoveNewPCCalls: erase the calls to `newpc`;
+/// * RemoveHelperCalls: replace the calls to helpers with opaque calls and
+///   clobbers of the CSVs they write;
+/// * RemoveDbgMetadata: drop the `!dbg` attachments. Differently from
+///   RemoveDbgMetadata, this applies to any function, not only isolated ones.
+class CleanupLiftedCodePass
+  : public llvm::PassInfoMixin<CleanupLiftedCodePass> {
+public:
+  struct Options {
+    bool RemoveNewPCCalls = false;
+    bool RemoveHelperCalls = false;
+    bool RemoveDebugMetadata = false;
+  };
+
+private:
+  Options Actions;
+
+public:
+  CleanupLiftedCodePass(const Options &Actions) : Actions(Actions) {}
+
+  llvm::PreservedAnalyses run(llvm::Function &F,
+                              llvm::FunctionAnalysisManager &FAM);
+};
@@ -10,6 +10,7 @@
 
 #include "llvm/ADT/Any.h"
 #include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/iterator_range.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/GlobalObject.h"
 #include "llvm/IR/PassManager.h"
@@ -44,6 +45,9 @@ class MDNode;
 /// between basic blocks generated due to translation and dispatcher-related
 /// basic blocks.
 class GeneratedCodeBasicInfo {
+public:
+  using JumpTargetsMap = std::map<MetaAddress, llvm::BasicBlock *>;
+
 public:
   GeneratedCodeBasicInfo(const model::Binary &Binary) :
     Binary(&Binary),
@@ -205,6 +209,29 @@ public:
     return It->second;
   }
 
+  /// Return all the jump targets of the root function, sorted by address
+  const JumpTargetsMap &jumpTargets() {
+    parseRoot();
+    return JumpTargets;
+  }
+
+  /// Return the jump targets whose address is in [\p Start, \p End), sorted
+  /// by address
+  llvm::iterator_range<JumpTargetsMap::const_iterator>
+  jumpTargetsInRange(MetaAddress Start, MetaAddress End) {
+    parseRoot();
+    revng_assert(Start <= End);
+    return llvm::make_range(JumpTargets.lower_bound(Start),
+                            JumpTargets.lower_bound(End));
+  }
+
+  /// Record \p BB, a jump target that has been translated after the root
+  /// function has been parsed
+  ///
+  /// This allows to keep using the same instance across translation rounds
+  /// instead of parsing the root function from scratch every time.
+  void registerJumpTarget(llvm::BasicBlock *BB);
+
   bool isJump(llvm::BasicBlock *BB) { return isJump(BB->getTerminator()); }
 
   /// Return true if \p T represents a jump in the input assembly
@@ -324,7 +351,7 @@ private:
   llvm::BasicBlock *DispatcherFail;
   llvm::BasicBlock *AnyPC;
   llvm::BasicBlock *UnexpectedPC;
-  std::map<MetaAddress, llvm::BasicBlock *> JumpTargets;
+  JumpTargetsMap JumpTargets;
   unsigned PCRegSize;
   llvm::Function *RootFunction;
   std::vector<llvm::GlobalVariable *> CSVs;
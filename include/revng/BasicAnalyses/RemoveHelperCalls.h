@@ -4,11 +4,17 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/PassManager.h"
 
 #include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
 #include "revng/Support/OpaqueFunctionsPool.h"
 
+/// Replace each of the helper \p Calls with a call to an opaque function,
+/// followed by stores of opaque values to the CSVs clobbered by the helper
+void replaceHelperCalls(GeneratedCodeBasicInfo &GCBI,
+                        llvm::ArrayRef<llvm::Instruction *> Calls);
+
 class RemoveHelperCallsPass
   : public llvm::PassInfoMixin<RemoveHelperCallsPass> {
   GeneratedCodeBasicInfo *GCBI = nullptr;
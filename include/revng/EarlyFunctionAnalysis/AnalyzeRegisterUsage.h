@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+#include <unordered_map>
+
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
@@ -68,14 +71,43 @@ public:
   void dump(T &Output, const char *Prefix = "") const;
 };
 
-extern template void RUAResults::dump<Logger<true>>(Logger<true> &,
-                                                    const char *) const;
+extern template void RUAResults::dump<Logger<>>(Logger<> &,
+                                                const char *) const;
+
+/// Results of analyzeRegisterUsage, indexed by a fingerprint of the graph the
+/// analyses run on.
+///
+/// DetectABI analyzes the same function multiple times, and often its register
+/// usage didn't change since the previous time: in that case we can skip the
+/// data-flow analyses.
+///
+/// \note the results refer to the CSVs of a specific module, a cache must not
+///       be shared across modules.
+class RUACache {
+private:
+  std::unordered_map<std::string, RUAResults> Results;
+
+public:
+  const RUAResults *lookup(const std::string &Fingerprint) const {
+    auto It = Results.find(Fingerprint);
+    if (It == Results.end())
+      return nullptr;
+    return &It->second;
+  }
+
+  void insert(std::string Fingerprint, const RUAResults &Value) {
+    Results.insert_or_assign(std::move(Fingerprint), Value);
+  }
+
+  void clear() { Results.clear(); }
+};
 
 RUAResults analyzeRegisterUsage(llvm::Function *F,
                                 const GeneratedCodeBasicInfo &,
                                 model::Architecture::Values Architecture,
                                 llvm::Function *,
                                 llvm::Function *,
-                                llvm::Function *);
+                                llvm::Function *,
+                                RUACache *Cache = nullptr);
 
 } // namespace efa
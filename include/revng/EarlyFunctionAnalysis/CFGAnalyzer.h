@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <set>
+
 #include "llvm/ADT/SmallVector.h"
 
 #include "revng/EarlyFunctionAnalysis/CallHandler.h"
@@ -88,6 +91,24 @@ private:
   std::unique_ptr<llvm::raw_ostream> OutputAAWriter;
   std::unique_ptr<llvm::raw_ostream> OutputIBI;
 
+  bool CacheOutlined = false;
+
+  /// A pristine copy of the last outlined version of a function, along with
+  /// the inputs that determined it
+  struct CachedOutlinedFunction {
+    OutlinedFunction Function;
+    CallSiteInputs Inputs;
+    std::optional<std::set<MetaAddress>> ReturnBlocks;
+  };
+
+  /// Outlined functions ready to be handed out again by outline, if the
+  /// inputs they were built from did not change. Only populated if
+  /// CacheOutlined is enabled.
+  ///
+  /// \note this must be the last field, since the cached functions use the
+  ///       hooks and the helpers owned by other fields.
+  std::map<MetaAddress, CachedOutlinedFunction> OutlinedCache;
+
 public:
   CFGAnalyzer(llvm::Module &M,
               GeneratedCodeBasicInfo &GCBI,
@@ -100,6 +121,12 @@ public:
   llvm::Function *retHook() const { return RetHook.get(); }
   const auto &abiCSVs() const { return ABICSVs; }
 
+public:
+  /// Keep a copy of each outlined function, to be reused if the same function
+  /// is outlined again and none of the summaries it depends on changed. Worth
+  /// it for clients outlining the same functions multiple times.
+  void cacheOutlinedFunctions() { CacheOutlined = true; }
+
 public:
   FunctionSummary analyze(const MetaAddress &Entry);
 
@@ -4,9 +4,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <list>
+#include <memory>
+
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 
 #include "revng/EarlyFunctionAnalysis/CFGStringMap.h"
 #include "revng/EarlyFunctionAnalysis/ControlFlowGraph.h"
@@ -17,9 +21,31 @@
 #include "revng/Support/Assert.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/MetaAddress.h"
+#include "revng/Support/Statistics.h"
 #include "revng/Support/YAMLTraits.h"
 #include "revng/TupleTree/TupleTree.h"
 
+extern llvm::cl::opt<uint64_t> ControlFlowGraphCacheBudget;
+
+inline CounterMap<std::string> ControlFlowGraphCacheStatistics("cfg-cache");
+
+/// Process-wide cache of the deserialized CFGs, shared by all the
+/// BasicControlFlowGraphCache instances
+///
+/// Each pipe has its own BasicControlFlowGraphCache, which would parse again
+/// all the CFGs it needs. Here, entries are keyed by their serialized form
+/// (YAML or, with `-cfg-binary-storage`, the binary tuple tree encoding), so
+/// that a CFG that didn't change is parsed only once per process. The least
+/// recently used entries are dropped as soon as their serialized size exceeds
+/// `-cfg-shared-cache-budget`.
+class SharedControlFlowGraphCache {
+public:
+  using Pointer = std::shared_ptr<const TupleTree<efa::ControlFlowGraph>>;
+
+public:
+  static Pointer get(llvm::StringRef Serialized);
+};
+
 template<typename T>
 concept ControlFlowGraphCacheTraits = requires {
   typename T::BasicBlock;
@@ -56,39 +82,103 @@ concept ControlFlowGraphCacheTraits = requires {
 
 /// The BasicControlFlowGraphCache is implemented as a class template customised
 /// via a traits class in order to enable reuse for both LLVM IR and MLIR.
+///
+/// The CFGs deserialized from the CFGMap are kept in a LRU list, which is
+/// trimmed as soon as the size of their YAML representation exceeds the budget.
+/// CFGs provided through set() have no serialized counterpart and are never
+/// evicted. Deserialization goes through SharedControlFlowGraphCache.
+///
+/// \note the reference returned by getControlFlowGraph is guaranteed to stay
+///       valid only until the next invocation of getControlFlowGraph.
 template<ControlFlowGraphCacheTraits Traits>
 class BasicControlFlowGraphCache {
   using BasicBlock = typename Traits::BasicBlock;
   using Function = typename Traits::Function;
   using CallInst = typename Traits::CallInst;
 
+  struct CacheEntry {
+    SharedControlFlowGraphCache::Pointer CFG;
+    bool Evictable = false;
+    size_t Size = 0;
+    std::list<MetaAddress>::iterator LRUPosition;
+  };
+
   const revng::pipes::CFGMap &CFGs;
-  std::map<MetaAddress, TupleTree<efa::ControlFlowGraph>> Deserialized;
+  std::map<MetaAddress, CacheEntry> Deserialized;
+
+  /// Evictable entries, most recently used first
+  std::list<MetaAddress> LRU;
+  size_t EvictableSize = 0;
+
+  /// Maximum size of the evictable entries, 0 means no limit
+  size_t Budget = 0;
 
 public:
-  BasicControlFlowGraphCache(const revng::pipes::CFGMap &CFGs) : CFGs(CFGs) {}
+  BasicControlFlowGraphCache(const revng::pipes::CFGMap &CFGs,
+                             size_t Budget = ControlFlowGraphCacheBudget) :
+    CFGs(CFGs), Budget(Budget) {}
 
 public:
   void set(TupleTree<efa::ControlFlowGraph> &&New) {
-    Deserialized[New->Entry()] = std::move(New);
+    CacheEntry &Entry = Deserialized[New->Entry()];
+    if (Entry.Evictable) {
+      EvictableSize -= Entry.Size;
+      LRU.erase(Entry.LRUPosition);
+    }
+
+    using ConstCFG = const TupleTree<efa::ControlFlowGraph>;
+    Entry.CFG = std::make_shared<ConstCFG>(std::move(New));
+    Entry.Evictable = false;
+    Entry.Size = 0;
   }
 
 public:
   const efa::ControlFlowGraph &getControlFlowGraph(const MetaAddress &Address) {
     auto It = Deserialized.find(Address);
-    if (It != Deserialized.end())
-      return *It->second.get();
+    if (It != Deserialized.end()) {
+      ControlFlowGraphCacheStatistics.push("hits");
+      CacheEntry &Entry = It->second;
+      if (Entry.Evictable)
+        LRU.splice(LRU.begin(), LRU, Entry.LRUPosition);
+      return *Entry.CFG->get();
+    }
+
+    ControlFlowGraphCacheStatistics.push("misses");
+    const std::string &Serialized = CFGs.at(Address);
+    CacheEntry &Result = Deserialized[Address];
+    Result.CFG = SharedControlFlowGraphCache::get(Serialized);
+    Result.Evictable = true;
+    Result.Size = Serialized.size();
+    Result.LRUPosition = LRU.insert(LRU.begin(), Address);
+    EvictableSize += Result.Size;
+
+    evict();
 
-    using TupleTree = TupleTree<efa::ControlFlowGraph>;
-    TupleTree &Result = Deserialized[Address];
-    Result = cantFail(TupleTree::fromString(CFGs.at(Address)));
-    return *Result.get();
+    return *Result.CFG->get();
   }
 
   const efa::ControlFlowGraph &getControlFlowGraph(const Function Function) {
     return getControlFlowGraph(Traits::getFunctionAddress(Function));
   }
 
+private:
+  /// Drop the least recently used entries until we're within budget, always
+  /// preserving the most recently used one
+  void evict() {
+    if (Budget == 0)
+      return;
+
+    while (EvictableSize > Budget and LRU.size() > 1) {
+      ControlFlowGraphCacheStatistics.push("evictions");
+      auto It = Deserialized.find(LRU.back());
+      revng_assert(It != Deserialized.end() and It->second.Evictable);
+      EvictableSize -= It->second.Size;
+      Deserialized.erase(It);
+      LRU.pop_back();
+    }
+  }
+
+public:
   /// Given a Call instruction and the model type of its parent function, return
   /// the edge on the model that represents that call (std::nullopt if this
   /// doesn't exist) and the BasicBlockID associated to the call-site.
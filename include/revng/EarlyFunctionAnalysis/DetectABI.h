@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
 
 #include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
@@ -11,13 +13,44 @@
 
 namespace efa {
 
+/// The targets of the direct calls performed by each function in the root
+///
+/// They depend only on the root, not on which addresses are functions, so
+/// they can be shared by the DetectABIPass instances running on the same
+/// module, e.g., before and after collecting new functions: the approximate
+/// call graph is then rebuilt by scanning only the functions never seen
+/// before.
+class CallTargetsCache {
+public:
+  using TargetsList = llvm::SmallVector<llvm::BasicBlock *, 4>;
+
+private:
+  const llvm::Module *M = nullptr;
+  llvm::DenseMap<llvm::BasicBlock *, TargetsList> Targets;
+
+public:
+  /// \return the call targets of the function starting at \p Entry, in \p M,
+  ///         without duplicates, in the order they are first found
+  ///
+  /// \note the result is valid until the next call.
+  const TargetsList &get(const llvm::Module &M, llvm::BasicBlock *Entry);
+};
+
 class DetectABIPass : public llvm::ModulePass {
 public:
   static char ID;
 
+private:
+  CallTargetsCache *CallTargets = nullptr;
+
 public:
   DetectABIPass() : llvm::ModulePass(ID) {}
 
+  /// \param CallTargets cache shared with other instances of this pass, must
+  ///        outlive it
+  explicit DetectABIPass(CallTargetsCache &CallTargets) :
+    llvm::ModulePass(ID), CallTargets(&CallTargets) {}
+
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
     AU.setPreservesAll();
     AU.addRequired<ControlFlowGraphCachePass>();
@@ -144,11 +144,15 @@ private:
   using CallSiteDescriptor = std::pair<FunctionSummary, bool>;
   std::map<std::pair<MetaAddress, BasicBlockID>, CallSiteDescriptor> CallSites;
 
+  /// Call sites for which the model has been already found to provide no
+  /// override, so that we don't have to look them up again
+  std::set<std::pair<MetaAddress, BasicBlockID>> CallSitesWithoutOverride;
+
   /// Local functions
   std::map<MetaAddress, FunctionSummary> LocalFunctions;
 
   /// Dynamic functions
-  std::map<std::string, FunctionSummary> DynamicFunctions;
+  std::map<std::string, FunctionSummary, std::less<>> DynamicFunctions;
 
   /// Default
   std::optional<FunctionSummary> Default;
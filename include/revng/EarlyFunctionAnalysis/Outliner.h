@@ -4,6 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "llvm/IR/Module.h"
 #include "llvm/Support/ModRef.h"
 #include "llvm/Transforms/Utils/CodeExtractor.h"
@@ -11,6 +15,7 @@
 #include "revng/EarlyFunctionAnalysis/FunctionSummaryOracle.h"
 #include "revng/EarlyFunctionAnalysis/TemporaryOpaqueFunction.h"
 #include "revng/Model/NamedTypedRegister.h"
+#include "revng/Support/BasicBlockID.h"
 #include "revng/Support/OpaqueFunctionsPool.h"
 #include "revng/Support/UniqueValuePtr.h"
 
@@ -74,6 +79,26 @@ public:
   }
 };
 
+/// What the Outliner got from the oracle about a call site. Outlining the same
+/// function again produces the same result as long as the oracle keeps
+/// answering the same for all the call sites consulted the first time.
+struct CallSiteInput {
+  MetaAddress CallerFunction;
+  BasicBlockID CallSite;
+  MetaAddress Callee;
+  std::string CalledSymbol;
+
+  // The parts of the summary affecting the outlined function
+  AttributesSet Attributes;
+  CSVSet ClobberedRegisters;
+  std::optional<int64_t> ElectedFSO;
+  bool IsTailCall = false;
+
+  bool operator==(const CallSiteInput &) const = default;
+};
+
+using CallSiteInputs = std::vector<CallSiteInput>;
+
 /// This class, given an Oracle, can outline functions from root
 class Outliner {
 private:
@@ -90,6 +115,9 @@ private:
 
   llvm::CodeExtractorAnalysisCache CEAC;
 
+  /// If not null, where to record the call sites consulted while outlining
+  CallSiteInputs *Recording = nullptr;
+
 public:
   Outliner(llvm::Module &M,
            GeneratedCodeBasicInfo &GCBI,
@@ -98,7 +126,7 @@ public:
     GCBI(GCBI),
     Oracle(Oracle),
     UnexpectedPCMarker(initializeUnexpectedPCMarker(M)),
-    OpaqueReturnAddress(&M, false),
+    OpaqueReturnAddress(&M, "opaque-return-address"),
     CEAC(*M.getFunction("root")) {
 
     using namespace llvm;
@@ -113,8 +141,15 @@ public:
   }
 
 public:
+  /// \param Inputs if not null, will be populated with what the oracle
+  ///        answered for each call site that has been consulted.
   OutlinedFunction outline(const MetaAddress &EntryAddress,
-                           CallHandler *TheCallHandler);
+                           CallHandler *TheCallHandler,
+                           CallSiteInputs *Inputs = nullptr);
+
+  /// \returns true if the oracle still provides the same information recorded
+  ///          in \p Inputs by a previous invocation of outline.
+  bool isUpToDate(const CallSiteInputs &Inputs);
 
 private:
   static TemporaryOpaqueFunction initializeUnexpectedPCMarker(llvm::Module &M) {
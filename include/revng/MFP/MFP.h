@@ -4,24 +4,34 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <compare>
 #include <cstddef>
 #include <map>
 #include <queue>
 #include <type_traits>
+#include <vector>
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/ADT/Concepts.h"
 #include "revng/ADT/GenericGraph.h"
 #include "revng/ADT/ReversePostOrderTraversal.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/Debug.h"
 
 namespace MFP {
 
+inline Logger<> MFPLog("mfp");
+
 template<typename LatticeElement>
 struct MFPResult {
   LatticeElement InValue;
@@ -50,6 +60,37 @@ concept MonotoneFrameworkInstance = requires(const MFI &I,
   { I.applyTransferFunction(L, E2) } -> std::same_as<LatticeElement>;
 };
 
+/// An instance can optionally provide a way to combine a value into an
+/// existing lattice element, avoiding to build a new one at each step. The
+/// result must be the same as `Target = combineValues(Target, Value)` and the
+/// method must return true if \p Target changed.
+template<typename MFI, typename LatticeElement = typename MFI::LatticeElement>
+concept HasInPlaceCombine = requires(const MFI &I,
+                                     LatticeElement &Target,
+                                     const LatticeElement &Value) {
+  { I.combineValuesInPlace(Target, Value) } -> std::same_as<bool>;
+};
+
+/// If an instance declares `static constexpr bool SparsePropagation = true`,
+/// the successors of a node are considered only if the output value of the
+/// node actually changed since its previous visit. This costs a comparison per
+/// visit, but it's profitable when nodes have many successors or comparisons
+/// against successors are expensive.
+template<typename MFI>
+concept HasSparsePropagation = requires {
+  requires MFI::SparsePropagation;
+};
+
+/// An instance can optionally be notified each time the transfer function of a
+/// node is applied, along with how many times it has been applied so far.
+/// Useful to track down nodes that take many iterations to converge.
+template<typename MFI>
+concept HasIterationHook = requires(const MFI &I,
+                                    typename MFI::Label L,
+                                    unsigned Iterations) {
+  I.onIteration(L, Iterations);
+};
+
 template<typename Label, typename LatticeElement>
 using ResultMap = std::map<Label, MFPResult<LatticeElement>>;
 
@@ -75,20 +116,19 @@ getMaximalFixedPoint(const MFI &Instance,
                      const std::vector<typename MFI::Label> &InitialNodes) {
   using Label = typename MFI::Label;
   using LatticeElement = typename MFI::LatticeElement;
+  using Result = MFPResult<LatticeElement>;
 
-  std::map<Label, LatticeElement> PartialAnalysis;
-  std::map<Label, MFPResult<LatticeElement>> AnalysisResult;
-
-  struct WorklistItem {
-    size_t Priority;
-    Label Item;
+  std::map<Label, Result> AnalysisResult;
 
-    std::strong_ordering operator<=>(const WorklistItem &) const = default;
-  };
-  std::set<WorklistItem> Worklist;
+  // Graphs can have millions of nodes (e.g., data flow graphs), use hash-based
+  // containers for the bookkeeping
+  llvm::DenseSet<Label> Visited;
+  llvm::DenseMap<Label, size_t> LabelPriority;
 
-  llvm::SmallSet<Label, 8> Visited{};
-  std::map<Label, size_t> LabelPriority;
+  // Nodes and their results, indexed by priority, i.e., by position in the
+  // reverse post order
+  std::vector<Label> Nodes;
+  std::vector<Result *> Results;
 
   //
   // Initialize the worklist and extremal labels
@@ -101,37 +141,98 @@ getMaximalFixedPoint(const MFI &Instance,
     if (!Visited.contains(Start)) {
       // Fill the worklist with nodes in reverse post order launching a visit
       // from each remaining node
-      ReversePostOrderTraversalExt<LGT, GT, llvm::SmallSet<Label, 8>>
+      ReversePostOrderTraversalExt<LGT, GT, llvm::DenseSet<Label>>
         RPOTE(Start, Visited);
       for (Label Node : RPOTE) {
-        LabelPriority[Node] = LabelPriority.size();
-        Worklist.insert({ LabelPriority.at(Node), Node });
+        LabelPriority[Node] = Nodes.size();
+        Nodes.push_back(Node);
         // initialize the analysis value for non extremal nodes
-        if (!AnalysisResult.contains(Node))
-          AnalysisResult[Node].InValue = InitialValue;
+        auto [It, New] = AnalysisResult.try_emplace(Node);
+        if (New)
+          It->second.InValue = InitialValue;
+        Results.push_back(&It->second);
       }
     }
   }
 
+  // Resolve the successors once and for all, so that the iteration does not
+  // need to look up priorities
+  std::vector<llvm::SmallVector<size_t, 2>> Successors(Nodes.size());
+  for (size_t Index = 0; Index < Nodes.size(); ++Index)
+    for (Label End : successors<GT>(Nodes[Index])) {
+      auto It = LabelPriority.find(End);
+      revng_assert(It != LabelPriority.end());
+      Successors[Index].push_back(It->second);
+    }
+
+  // The worklist is a bit per node, in reverse post order. Since we always
+  // pick the pending node with the lowest priority, we keep track of a lower
+  // bound of the set bits in order to avoid rescanning from the beginning.
+  llvm::BitVector Worklist(Nodes.size(), true);
+  size_t Lowest = 0;
+  std::vector<unsigned> Iterations(Nodes.size(), 0);
+  size_t TotalIterations = 0;
+
   // Step 2 iteration
-  while (!Worklist.empty()) {
-    WorklistItem First = *Worklist.begin();
-    Label Start = First.Item;
-    Worklist.erase(First);
-    auto &LabelAnalysis = AnalysisResult.at(Start);
-    LabelAnalysis
-      .OutValue = Instance.applyTransferFunction(Start, LabelAnalysis.InValue);
-
-    for (Label End : successors<GT>(Start)) {
-      auto &PartialEnd = AnalysisResult.at(End);
-      if (!Instance.isLessOrEqual(LabelAnalysis.OutValue, PartialEnd.InValue)) {
-        PartialEnd.InValue = Instance.combineValues(PartialEnd.InValue,
-                                                    LabelAnalysis.OutValue);
-        Worklist.insert({ LabelPriority.at(End), End });
+  while (true) {
+    int Next = Worklist.find_first_in(Lowest, Worklist.size());
+    if (Next == -1)
+      break;
+
+    size_t Index = Next;
+    Worklist.reset(Index);
+    Lowest = Index;
+
+    Label Start = Nodes[Index];
+    Result &LabelAnalysis = *Results[Index];
+
+    ++TotalIterations;
+    ++Iterations[Index];
+    if constexpr (HasIterationHook<MFI>)
+      Instance.onIteration(Start, Iterations[Index]);
+
+    if constexpr (HasSparsePropagation<MFI>) {
+      LatticeElement NewOut = Instance.applyTransferFunction(Start,
+                                                             LabelAnalysis
+                                                               .InValue);
+      bool Changed = Iterations[Index] == 1
+                     or !Instance.isLessOrEqual(NewOut,
+                                                LabelAnalysis.OutValue);
+      LabelAnalysis.OutValue = std::move(NewOut);
+      if (!Changed)
+        continue;
+    } else {
+      LabelAnalysis.OutValue = Instance.applyTransferFunction(Start,
+                                                              LabelAnalysis
+                                                                .InValue);
+    }
+
+    for (size_t End : Successors[Index]) {
+      auto &PartialEnd = Results[End]->InValue;
+
+      bool Changed = false;
+      if constexpr (HasInPlaceCombine<MFI>) {
+        Changed = Instance.combineValuesInPlace(PartialEnd,
+                                                LabelAnalysis.OutValue);
+      } else if (!Instance.isLessOrEqual(LabelAnalysis.OutValue, PartialEnd)) {
+        PartialEnd = Instance.combineValues(PartialEnd, LabelAnalysis.OutValue);
+        Changed = true;
+      }
+
+      if (Changed) {
+        Worklist.set(End);
+        Lowest = std::min(Lowest, End);
       }
     }
   }
 
+  if (MFPLog.isEnabled() and !Nodes.empty()) {
+    auto MaxIt = std::max_element(Iterations.begin(), Iterations.end());
+    MFPLog << "Fixed point reached after " << TotalIterations
+           << " iterations over " << Nodes.size() << " nodes, at most "
+           << *MaxIt << " on a single node" << DoLog;
+  }
+
   return AnalysisResult;
 }
 
@@ -294,3 +294,28 @@ public:
 };
 
 #include "revng/Model/Generated/Late/Binary.h"
+
+namespace model {
+
+/// Verify \p Model knowing that it's the result of applying \p Diff to a model
+/// that used to verify.
+///
+/// Only the objects touched by \p Diff are re-checked, along with what depends
+/// on them: the types referencing a changed type (transitively), the
+/// functions and segments using any of those types, the global namespace and
+/// the segment overlap check, if the respective collections changed. Changes
+/// to fields that impact everything else (e.g., `Architecture`) fall back to a
+/// full verification.
+///
+/// \note \p VH can be kept alive across invocations on the same tree: entries
+///       affected by \p Diff are evicted from its caches before verification.
+bool verifyChanges(const model::Binary &Model,
+                   const TupleTreeDiff<model::Binary> &Diff,
+                   VerifyHelper &VH);
+bool verifyChanges(const model::Binary &Model,
+                   const TupleTreeDiff<model::Binary> &Diff,
+                   bool Assert);
+bool verifyChanges(const model::Binary &Model,
+                   const TupleTreeDiff<model::Binary> &Diff);
+
+} // namespace model
@@ -4,6 +4,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Object/Binary.h"
 
 #include "revng/Model/Binary.h"
@@ -15,7 +20,7 @@ private:
   TupleTree<model::Binary> &Model;
   std::vector<std::string> LoadedFiles;
   using DwarfID = std::pair<size_t, size_t>;
-  std::map<DwarfID, model::UpcastableType> DwarfToModel;
+  llvm::DenseMap<DwarfID, model::UpcastableType> DwarfToModel;
 
 public:
   DwarfImporter(TupleTree<model::Binary> &Model) : Model(Model) {}
@@ -27,10 +32,12 @@ public:
                                       model::UpcastableType::empty();
   }
 
+  /// \note the returned reference is invalidated by the next recordType
   model::UpcastableType &recordType(DwarfID ID,
                                     model::UpcastableType &&NewType) {
-    revng_assert(!DwarfToModel.contains(ID));
-    return DwarfToModel.insert({ ID, std::move(NewType) }).first->second;
+    auto [It, Inserted] = DwarfToModel.try_emplace(ID, std::move(NewType));
+    revng_assert(Inserted);
+    return It->second;
   }
 
   TupleTree<model::Binary> &getModel() { return Model; }
@@ -38,6 +45,12 @@ public:
 public:
   void import(llvm::StringRef FileName, const ImporterOptions &Options);
 
+  /// Start fetching, in the background, the debug information of the
+  /// binaries in \p FileNames that is neither embedded nor available on the
+  /// system, so that it's ready, or on its way, when import gets to them
+  static void prefetch(llvm::ArrayRef<std::string> FileNames,
+                       const ImporterOptions &Options);
+
 private:
   void import(const llvm::object::Binary &TheBinary,
               llvm::StringRef FileName,
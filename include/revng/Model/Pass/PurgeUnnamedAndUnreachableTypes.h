@@ -4,13 +4,23 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <set>
+
+#include "llvm/ADT/ArrayRef.h"
+
 #include "revng/Model/Binary.h"
 
 namespace model {
 
+class TypeDependencyIndex;
+
 /// Remove all the types that do not verify.
 void purgeInvalidTypes(TupleTree<model::Binary> &Model);
 
+/// Like the other overload, but use (and keep up to date) an existing index
+void purgeInvalidTypes(TupleTree<model::Binary> &Model,
+                       model::TypeDependencyIndex &Index);
+
 /// Remove all the types that cannot be reached from outside Binary::Types and
 /// have no OriginalName or CustomName
 void purgeUnnamedAndUnreachableTypes(TupleTree<model::Binary> &Model);
@@ -18,4 +28,41 @@ void purgeUnnamedAndUnreachableTypes(TupleTree<model::Binary> &Model);
 /// Remove all the types that cannot be reached from outside Binary::Types
 void purgeUnreachableTypes(TupleTree<model::Binary> &Model);
 
+/// Remove the types that have become unreachable after some edits, assuming
+/// that only \p Candidates, and what they depend on, can have
+///
+/// This is meant to be used after small edits dropping some references (e.g.,
+/// replacing a prototype): \p Candidates are the definitions that have lost a
+/// reference and only them and their dependencies are visited, instead of the
+/// whole type system. A type depended upon by a type that is not affected is
+/// considered reachable. \p Index must be up to date with \p Model and it's
+/// kept up to date.
+///
+/// If \p KeepTypesWithName, types with an OriginalName or a CustomName are
+/// preserved, as in purgeUnnamedAndUnreachableTypes.
+///
+/// \returns the number of purged types
+unsigned
+purgeUnreachableCandidates(TupleTree<model::Binary> &Model,
+                           model::TypeDependencyIndex &Index,
+                           llvm::ArrayRef<const model::TypeDefinition *>
+                             Candidates,
+                           bool KeepTypesWithName = true);
+
+/// Like the other overload, but build the index and take the candidates by
+/// key, ignoring those that are no longer in \p Model
+///
+/// Useful to collect the candidates before the edits, when they might still be
+/// removed.
+unsigned
+purgeUnreachableCandidates(TupleTree<model::Binary> &Model,
+                           const std::set<model::TypeDefinition::Key>
+                             &Candidates,
+                           bool KeepTypesWithName = true);
+
+/// Collect the keys of the definitions that \p Definition directly depends on:
+/// the candidates for purgeUnreachableCandidates, if \p Definition is dropped
+void collectDependencies(const model::TypeDefinition &Definition,
+                         std::set<model::TypeDefinition::Key> &Output);
+
 } // namespace model
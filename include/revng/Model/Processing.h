@@ -12,6 +12,8 @@
 
 namespace model {
 
+class TypeDependencyIndex;
+
 /// Given \p Defs, drop all the types and dynamic functions that depend on them
 ///
 /// Sometimes you create a set of placeholder types in the model, but they end
@@ -23,4 +25,13 @@ unsigned
 dropTypesDependingOnDefinitions(TupleTree<model::Binary> &Binary,
                                 const std::set<const TypeDefinition *> &Defs);
 
+/// Like the other overload, but use (and keep up to date) an existing index,
+/// rather than building a new one
+///
+/// \note \p Index must be up to date with \p Binary.
+unsigned
+dropTypesDependingOnDefinitions(TupleTree<model::Binary> &Binary,
+                                const std::set<const TypeDefinition *> &Defs,
+                                model::TypeDependencyIndex &Index);
+
 } // namespace model
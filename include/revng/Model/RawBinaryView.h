@@ -4,11 +4,18 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #include "revng/Model/Binary.h"
 #include "revng/Support/Generator.h"
@@ -19,16 +26,41 @@ class RawBinaryView {
 private:
   using OverflowSafeInt = OverflowSafeInt<uint64_t>;
 
+private:
+  /// Splits the address space in intervals within which the set of segments
+  /// containing an address does not change, so that the segments that might
+  /// contain an address can be found through a binary search.
+  struct SegmentIndex {
+    /// Number of segments in the model when the index has been built
+    size_t SegmentsCount = 0;
+
+    /// The sorted start addresses of the intervals
+    std::vector<uint64_t> Starts;
+
+    /// The segments overlapping the interval I are in
+    /// Segments[Offsets[I]] to Segments[Offsets[I + 1]]
+    std::vector<uint32_t> Offsets;
+    std::vector<const model::Segment *> Segments;
+  };
+
 private:
   const model::Binary &Binary;
   llvm::ArrayRef<uint8_t> Data;
 
+  /// \note This is built lazily, since importers create the view before
+  ///       populating the segments, and it's rebuilt if the number of segments
+  ///       changes. If the segments do not change after construction, no
+  ///       lookup modifies it.
+  mutable SegmentIndex Index;
+
 public:
   RawBinaryView(const model::Binary &Binary, llvm::StringRef Data) :
     RawBinaryView(Binary, { Data.bytes_begin(), Data.bytes_end() }) {}
 
   RawBinaryView(const model::Binary &Binary, llvm::ArrayRef<uint8_t> Data) :
-    Binary(Binary), Data(Data) {}
+    Binary(Binary), Data(Data) {
+    buildIndex();
+  }
 
 public:
   uint64_t size() { return Data.size(); }
@@ -155,9 +187,9 @@ public:
   }
 
   [[nodiscard]] bool isReadOnly(MetaAddress Address, uint64_t Size) const {
-    for (const model::Segment &Segment : Binary.Segments()) {
-      if (Segment.contains(Address, Size)) {
-        if (!Segment.IsWriteable()) {
+    for (const model::Segment *Segment : candidateSegments(Address)) {
+      if (Segment->contains(Address, Size)) {
+        if (!Segment->IsWriteable()) {
           return true;
         }
       }
@@ -177,11 +209,70 @@ public:
   }
 
 private:
+  void buildIndex() const {
+    Index = SegmentIndex();
+    Index.SegmentsCount = Binary.Segments().size();
+
+    auto End = [](const model::Segment &Segment) {
+      auto Result = OverflowSafeInt(Segment.StartAddress().address())
+                    + Segment.VirtualSize();
+      return Result ? *Result : std::numeric_limits<uint64_t>::max();
+    };
+
+    // Each start and each end of a segment starts a new interval
+    for (const model::Segment &Segment : Binary.Segments()) {
+      Index.Starts.push_back(Segment.StartAddress().address());
+      Index.Starts.push_back(End(Segment));
+    }
+    llvm::sort(Index.Starts);
+    Index.Starts.erase(std::unique(Index.Starts.begin(), Index.Starts.end()),
+                       Index.Starts.end());
+
+    // Assign the segments to the intervals they span
+    std::vector<llvm::SmallVector<const model::Segment *, 1>>
+      Overlapping(Index.Starts.size());
+    for (const model::Segment &Segment : Binary.Segments()) {
+      auto First = llvm::lower_bound(Index.Starts,
+                                     Segment.StartAddress().address());
+      auto Last = llvm::lower_bound(Index.Starts, End(Segment));
+      for (auto It = First; It != Last; ++It)
+        Overlapping[It - Index.Starts.begin()].push_back(&Segment);
+    }
+
+    Index.Offsets.reserve(Overlapping.size() + 1);
+    for (const auto &Segments : Overlapping) {
+      Index.Offsets.push_back(Index.Segments.size());
+      llvm::append_range(Index.Segments, Segments);
+    }
+    Index.Offsets.push_back(Index.Segments.size());
+  }
+
+  /// \returns the segments that might contain \p Address, a superset of the
+  ///          segments that actually contain it.
+  llvm::ArrayRef<const model::Segment *>
+  candidateSegments(MetaAddress Address) const {
+    if (not Address.isValid())
+      return {};
+
+    if (Index.SegmentsCount != Binary.Segments().size())
+      buildIndex();
+
+    auto It = llvm::upper_bound(Index.Starts, Address.address());
+    if (It == Index.Starts.begin())
+      return {};
+
+    size_t Interval = It - Index.Starts.begin() - 1;
+    uint32_t Begin = Index.Offsets[Interval];
+    uint32_t End = Index.Offsets[Interval + 1];
+    llvm::ArrayRef<const model::Segment *> Segments = Index.Segments;
+    return Segments.slice(Begin, End - Begin);
+  }
+
   std::pair<const model::Segment *, uint64_t>
   findOffsetInSegment(MetaAddress Address, uint64_t Size) const {
     const model::Segment *Match = nullptr;
-    for (const model::Segment &Segment : Binary.Segments()) {
-      if (Segment.contains(Address, Size)) {
+    for (const model::Segment *Segment : candidateSegments(Address)) {
+      if (Segment->contains(Address, Size)) {
 
         if (Match != nullptr) {
           // We have more than one match!
@@ -189,7 +280,7 @@ private:
           break;
         }
 
-        Match = &Segment;
+        Match = Segment;
       }
     }
 
@@ -203,3 +294,17 @@ private:
     return { nullptr, 0 };
   }
 };
+
+/// Map the input binary at \p Path in memory, read-only
+///
+/// The input binary is never written and does not need to be NUL-terminated.
+/// Requiring a terminator prevents LLVM from mapping files whose size is a
+/// multiple of the page size, which would then be read in a private copy.
+/// Mapping the file instead lets all the views on it share the page cache.
+inline llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+mapBinary(const llvm::Twine &Path) {
+  using llvm::MemoryBuffer;
+  return MemoryBuffer::getFileOrSTDIN(Path,
+                                      /* IsText = */ false,
+                                      /* RequiresNullTerminator = */ false);
+}
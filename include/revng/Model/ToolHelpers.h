@@ -8,6 +8,7 @@
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
@@ -22,7 +23,10 @@
 
 #include "revng/Model/Binary.h"
 #include "revng/Model/LoadModelPass.h"
+#include "revng/Model/VerifyHelper.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/TupleTreeDiff.h"
 
 namespace ModelOutputType {
 
@@ -148,3 +152,49 @@ inline void writeModel(const model::Binary &Model, llvm::Module &M) {
   NamedMD = M.getOrInsertNamedMetadata(ModelMetadataName);
   NamedMD->addOperand(Tuple);
 }
+
+/// Read \p Path, or the standard input if it's "-", and return its non-empty
+/// lines, trimmed
+inline llvm::Expected<std::vector<std::string>>
+readNonEmptyLines(llvm::StringRef Path) {
+  auto MaybeBuffer = llvm::MemoryBuffer::getFileOrSTDIN(Path);
+  if (not MaybeBuffer)
+    return llvm::errorCodeToError(MaybeBuffer.getError());
+
+  llvm::SmallVector<llvm::StringRef, 16> Lines;
+  (*MaybeBuffer)->getBuffer().split(Lines, '\n', -1, false);
+
+  std::vector<std::string> Result;
+  for (llvm::StringRef Line : Lines) {
+    Line = Line.trim();
+    if (not Line.empty())
+      Result.push_back(Line.str());
+  }
+
+  return Result;
+}
+
+/// Apply the diff in \p DiffPath to \p Model
+///
+/// \param VH if not null, the changes introduced by the diff are verified
+///        incrementally. It can be reused across multiple diffs applied to the
+///        same model.
+inline llvm::Error applyDiff(TupleTree<model::Binary> &Model,
+                             llvm::StringRef DiffPath,
+                             model::VerifyHelper *VH = nullptr) {
+  using TypeDiff = TupleTreeDiff<model::Binary>;
+  auto Diff = fromFileOrSTDIN<TypeDiff>(DiffPath);
+  if (not Diff)
+    return Diff.takeError();
+
+  if (auto Error = Diff->apply(Model))
+    return Error;
+
+  if (VH != nullptr and not model::verifyChanges(*Model, *Diff, *VH)) {
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "The model does not verify after applying "
+                                     + DiffPath.str());
+  }
+
+  return llvm::Error::success();
+}
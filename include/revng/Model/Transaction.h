@@ -0,0 +1,71 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Error.h"
+
+#include "revng/Model/Binary.h"
+#include "revng/Model/TypeBucket.h"
+#include "revng/TupleTree/TupleTree.h"
+#include "revng/TupleTree/TupleTreeDiff.h"
+
+namespace model {
+
+/// A set of edits to a model that are merged and verified together
+///
+/// New type definitions are collected in a TypeBucket (see types()) and new or
+/// replacement functions through recordFunction(). On commit() each of the
+/// two collections is merged into the model with a single batch insertion, and
+/// the model is verified once, incrementally, against the state it was in when
+/// the transaction started. Any other edit can be done directly on the model
+/// in the meantime, and it will be verified all the same.
+///
+/// If the verification fails, the model is restored to its initial state.
+///
+/// \note until the transaction is committed, the types returned by the bucket
+///       refer to definitions that are not in the model yet: they can be
+///       attached to other objects, but not resolved.
+class Transaction {
+private:
+  TupleTree<model::Binary> &Model;
+  model::Binary Initial;
+  TypeBucket Bucket;
+  llvm::SmallVector<model::Function, 16> Functions;
+  bool Done = false;
+
+public:
+  explicit Transaction(TupleTree<model::Binary> &Model);
+  Transaction(const Transaction &) = delete;
+  Transaction &operator=(const Transaction &) = delete;
+  ~Transaction() {
+    revng_assert(Done, "The transaction has to be committed or aborted.");
+  }
+
+public:
+  /// The bucket to create new type definitions in
+  TypeBucket &types() { return Bucket; }
+
+  /// Record \p Function, replacing the one with the same entry, if any
+  void recordFunction(model::Function &&Function) {
+    revng_assert(not Done);
+    Functions.push_back(std::move(Function));
+  }
+
+public:
+  /// Merge all the pending definitions and functions into the model, and
+  /// verify it
+  ///
+  /// \returns the combined diff of all the changes made during the
+  ///          transaction, or an error if the model does not verify, in which
+  ///          case it's restored to its initial state.
+  llvm::Expected<TupleTreeDiff<model::Binary>> commit();
+
+  /// Discard the pending definitions and functions, and restore the model to
+  /// its initial state.
+  void abort();
+};
+
+} // namespace model
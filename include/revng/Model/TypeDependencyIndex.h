@@ -0,0 +1,89 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SetVector.h"
+
+#include "revng/Model/Binary.h"
+
+namespace model {
+
+/// An adjacency index of the type system of a model::Binary
+///
+/// A type definition depends on another one if any of its edges (fields,
+/// arguments, return values, typedef targets...) leads to it, possibly through
+/// arrays and pointers. Each dependency is recorded once, no matter how many
+/// edges lead to it.
+///
+/// The index is built with a single visit of all the definitions, after which
+/// both dependencies and dependents of a definition are available in constant
+/// time. The model does not notify its changes, so whoever edits a definition
+/// that is indexed must call update() (or erase() before removing it) to keep
+/// the index consistent.
+class TypeDependencyIndex {
+public:
+  using Definition = const model::TypeDefinition *;
+
+private:
+  using DependentsSet = llvm::SmallSetVector<Definition, 4>;
+
+private:
+  /// Definitions in the order they have been indexed
+  llvm::SmallSetVector<Definition, 16> Definitions;
+  llvm::DenseMap<Definition, llvm::SmallVector<Definition, 4>> Dependencies;
+  llvm::DenseMap<Definition, DependentsSet> Dependents;
+
+public:
+  TypeDependencyIndex() = default;
+  explicit TypeDependencyIndex(const model::Binary &Binary);
+
+public:
+  /// (Re)compute the dependencies of \p D, adding it to the index if needed
+  void update(const model::TypeDefinition &D);
+
+  /// Drop \p D, and all the edges to and from it, from the index
+  ///
+  /// \note the definitions depending on \p D are not changed, but they will no
+  ///       longer list it among their dependencies.
+  void erase(const model::TypeDefinition &D);
+
+public:
+  bool contains(const model::TypeDefinition &D) const {
+    return Definitions.contains(&D);
+  }
+
+  size_t size() const { return Definitions.size(); }
+
+  /// \returns the definitions \p D directly depends on
+  llvm::ArrayRef<Definition>
+  dependencies(const model::TypeDefinition &D) const;
+
+  /// \returns the definitions directly depending on \p D
+  llvm::ArrayRef<Definition> dependents(const model::TypeDefinition &D) const;
+
+  /// \returns all the definitions that can be reached from \p Roots following
+  ///          dependencies, including \p Roots themselves
+  llvm::DenseSet<Definition>
+  transitiveDependencies(llvm::ArrayRef<Definition> Roots) const;
+
+  /// \returns all the definitions that depend, directly or not, on \p Roots,
+  ///          including \p Roots themselves
+  llvm::DenseSet<Definition>
+  transitiveDependents(llvm::ArrayRef<Definition> Roots) const;
+
+  /// \returns all the indexed definitions, each one after all of its
+  ///          dependencies, except for those it is in a cycle with
+  ///
+  /// The order is deterministic: definitions are visited in the order they
+  /// were indexed.
+  std::vector<Definition> topologicalOrder() const;
+};
+
+} // namespace model
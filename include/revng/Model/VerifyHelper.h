@@ -4,11 +4,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <functional>
 #include <map>
 #include <optional>
 #include <set>
 #include <type_traits>
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -69,14 +71,24 @@ private:
 
   friend class VerifyHelper;
 
+public:
+  using PathGetter = std::function<std::string()>;
+
 private:
   std::set<const model::TypeDefinition *> VerifiedCache;
   std::map<const model::TypeDefinition *, uint64_t> SizeCache;
   std::set<const model::TypeDefinition *> InProgress;
   bool AssertOnFail = false;
-  std::map<model::Identifier, std::string> GlobalSymbols;
+
+  /// Global symbols, each with a way to compute its path in the model, which
+  /// is only needed to report a collision
+  llvm::StringMap<PathGetter> GlobalSymbols;
   bool HasPushedTracking = false;
 
+  /// The helper this one has been forked from, if any, whose global symbols
+  /// are used in place of GlobalSymbols
+  const VerifyHelper *Parent = nullptr;
+
   // TODO: This is a hack for now, but the methods, when the Model does not
   // verify, should return an llvm::Error with the error message found by this.
   std::string ReasonBuffer;
@@ -84,9 +96,31 @@ private:
 public:
   VerifyHelper() = default;
   VerifyHelper(bool AssertOnFail) : AssertOnFail(AssertOnFail) {}
+  VerifyHelper(VerifyHelper &&) = default;
 
   ~VerifyHelper() { revng_assert(InProgress.size() == 0); }
 
+private:
+  explicit VerifyHelper(const VerifyHelper *Parent) :
+    AssertOnFail(Parent->AssertOnFail),
+    HasPushedTracking(Parent->HasPushedTracking),
+    Parent(Parent) {}
+
+public:
+  /// \return a new helper to verify, possibly on another thread, a part of
+  ///         the model this helper is verifying
+  ///
+  /// The new helper starts with empty caches and shares the global symbols of
+  /// this one, which must not change until it is destroyed.
+  VerifyHelper fork() const {
+    revng_assert(hasPushedTracking());
+    return VerifyHelper(this);
+  }
+
+  /// Import what \p Forked has found out: which types verify, their size and,
+  /// if it failed, the reason
+  void join(VerifyHelper &&Forked);
+
 private:
   bool hasPushedTracking() const { return HasPushedTracking; }
 
@@ -110,6 +144,13 @@ public:
     return VerifiedCache.contains(&T);
   }
 
+  /// Forget everything known about \p T, e.g., because it has been changed
+  void invalidate(const model::TypeDefinition &T) {
+    revng_assert(not isVerificationInProgress(T));
+    VerifiedCache.erase(&T);
+    SizeCache.erase(&T);
+  }
+
   const std::string &getReason() const { return ReasonBuffer; }
 
 public:
@@ -144,9 +185,10 @@ public:
   }
 
 public:
+  void clearGlobalSymbols() { GlobalSymbols.clear(); }
   [[nodiscard]] bool isGlobalSymbol(const model::Identifier &Name) const;
   [[nodiscard]] bool registerGlobalSymbol(const model::Identifier &Name,
-                                          const std::string &Path);
+                                          PathGetter &&GetPath);
 
 public:
   bool maybeFail(bool Result) { return maybeFail(Result, {}); }
@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/PTML/Tag.h"
@@ -21,6 +24,8 @@ private:
   // character.
   bool TrailingNewline;
   raw_ostream &OS;
+  /// The rendered indentation of each depth, built upon first use
+  llvm::SmallVector<std::string, 8> Indentations;
 
 public:
   explicit PTMLIndentedOstream(llvm::raw_ostream &OS,
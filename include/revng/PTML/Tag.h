@@ -73,30 +73,75 @@ public:
   }
 
   std::string open() const {
-    if (TheTag.empty())
-      return "";
-
-    llvm::SmallString<128> Out;
-    Out.append({ "<", TheTag });
-    for (auto &Pair : Attributes)
-      Out.append({ " ", Pair.first(), "=\"", Pair.second, "\"" });
-    Out.append({ '>' });
-    return Out.str().str();
+    std::string Out;
+    Out.reserve(openSize());
+    appendOpen(Out);
+    return Out;
   }
 
   std::string close() const {
-    if (TheTag.empty())
-      return "";
-    return "</" + TheTag + ">";
+    std::string Out;
+    Out.reserve(closeSize());
+    appendClose(Out);
+    return Out;
   }
 
-  std::string toString() const { return open() + Content + close(); }
+  std::string toString() const {
+    std::string Out;
+    Out.reserve(openSize() + Content.size() + closeSize());
+    appendOpen(Out);
+    Out += Content;
+    appendClose(Out);
+    return Out;
+  }
 
   void dump() const debug_function { dump(dbg); }
 
   template<typename T>
   void dump(T &Output) const {
-    Output << toString();
+    Output << open() << Content << close();
+  }
+
+private:
+  // Tags are emitted very often, build them in place with a single
+  // allocation, instead of concatenating temporaries.
+
+  size_t openSize() const {
+    if (TheTag.empty())
+      return 0;
+
+    // "<" + TheTag + ">", plus ` Name="Value"` for each attribute
+    size_t Result = TheTag.size() + 2;
+    for (auto &Pair : Attributes)
+      Result += Pair.first().size() + Pair.second.size() + 4;
+    return Result;
+  }
+
+  void appendOpen(std::string &Out) const {
+    if (TheTag.empty())
+      return;
+
+    Out += '<';
+    Out += TheTag;
+    for (auto &Pair : Attributes) {
+      Out += ' ';
+      Out += Pair.first();
+      Out += "=\"";
+      Out += Pair.second;
+      Out += '"';
+    }
+    Out += '>';
+  }
+
+  size_t closeSize() const { return TheTag.empty() ? 0 : TheTag.size() + 3; }
+
+  void appendClose(std::string &Out) const {
+    if (TheTag.empty())
+      return;
+
+    Out += "</";
+    Out += TheTag;
+    Out += '>';
   }
 };
 
@@ -113,7 +158,7 @@ inline std::string operator+(const Tag &LHS, const Tag &RHS) {
 }
 
 inline llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const Tag &TheTag) {
-  OS << TheTag.toString();
+  TheTag.dump(OS);
   return OS;
 }
 
@@ -0,0 +1,97 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+#include "revng/Pipeline/ContainerSet.h"
+#include "revng/Pipeline/Context.h"
+#include "revng/Pipeline/Pipe.h"
+#include "revng/Pipeline/Target.h"
+#include "revng/Storage/Path.h"
+#include "revng/Storage/StorageClient.h"
+
+namespace pipeline {
+
+/// A content-addressed cache of the results of running a pipe.
+///
+/// Each entry is identified by a hash of everything that can affect the
+/// results of an invocation of a pipe: the pipe itself (name, containers and
+/// configuration), the values of its options, the requested targets, the
+/// content of the containers it runs on and the content of all the globals.
+/// Since the key does not depend on the project, results can be reused across
+/// projects and survive the removal of the execution directory.
+///
+/// An entry holds the content of the containers the pipe runs on after its
+/// execution, and the model paths read to produce each committed target, so
+/// that invalidation keeps working for restored targets.
+///
+/// Components other than pipes can store opaque entries too, see loadData.
+///
+/// The cache is enabled with `--artifact-cache=<path or URL>`, and can be
+/// hosted on any backend supported by revng::StorageClient.
+class ArtifactCache {
+private:
+  std::unique_ptr<revng::StorageClient> Client;
+  revng::DirectoryPath Root;
+
+public:
+  explicit ArtifactCache(std::unique_ptr<revng::StorageClient> &&Client) :
+    Client(std::move(Client)), Root(this->Client.get(), "") {}
+
+public:
+  /// \returns the cache configured via command line, or nullptr if the cache
+  ///          is disabled
+  static ArtifactCache *get();
+
+public:
+  /// Compute the key identifying the invocation of \p Pipe on \p Input to
+  /// produce \p Requested.
+  ///
+  /// \returns std::nullopt if some of the involved containers or globals
+  ///          cannot be serialized, which makes this invocation not cacheable.
+  static std::optional<std::string>
+  computeKey(const Context &Context,
+             const PipeWrapper &Pipe,
+             const ContainerSet &Input,
+             const ContainerToTargetsMap &Requested);
+
+  /// Look for an entry for \p Key and, if found, load it into the containers
+  /// of \p Input that \p Pipe runs on, and register the model paths read by
+  /// the restored targets in the invalidation metadata of \p Pipe.
+  ///
+  /// \returns true if the entry was found and restored.
+  llvm::Expected<bool> restore(llvm::StringRef Key,
+                               const Context &Context,
+                               PipeWrapper &Pipe,
+                               ContainerSet &Input);
+
+  /// Record the results of an invocation of \p Pipe, which produced
+  /// \p Requested in \p Output, under \p Key.
+  llvm::Error store(llvm::StringRef Key,
+                    const Context &Context,
+                    const PipeWrapper &Pipe,
+                    const ContainerSet &Output,
+                    const ContainerToTargetsMap &Requested);
+
+public:
+  /// \returns the content of the entry for \p Key stored by storeData, or
+  ///          std::nullopt if there's none.
+  ///
+  /// These entries are meant for the components that cache something other
+  /// than the results of a pipe, e.g., an analysis. Their keys must not
+  /// collide with the ones produced by computeKey.
+  llvm::Expected<std::optional<std::string>> loadData(llvm::StringRef Key);
+
+  /// Record \p Data, which loadData will return, under \p Key
+  llvm::Error storeData(llvm::StringRef Key, llvm::StringRef Data);
+};
+
+} // namespace pipeline
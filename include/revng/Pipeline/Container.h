@@ -126,6 +126,11 @@ public:
   /// Checks that the content of the this container is valid.
   virtual llvm::Error verify() const { return enumerate().verify(*this); }
 
+  /// \returns an estimate of the memory used by this container, in bytes, or 0
+  ///          if unknown. Containers with an unknown size are never evicted
+  ///          to stay within the memory budget (see ContainerSet::evict).
+  virtual uint64_t memoryUsage() const { return 0; }
+
   /// Return the serialized content of the specified non * target
   virtual llvm::Error extractOne(llvm::raw_ostream &OS,
                                  const Target &Target) const = 0;
@@ -12,6 +12,7 @@
 #include <sstream>
 #include <string>
 
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/Module.h"
@@ -36,17 +37,57 @@ namespace pipeline {
 ///
 /// This class contains both the containers and a pointer to a factory that is
 /// used to create that container when it does not exists.
+///
+/// Containers can be loaded lazily: in that case only the list of their
+/// targets is known, and they are deserialized the first time their content is
+/// accessed. Enumerating the targets never triggers deserialization.
+///
+/// The set also tracks which containers are identical to the file they have
+/// last been loaded from or stored to, so that storing again in the same place
+/// only writes the others. A container is considered modified as soon as it's
+/// accessed through a non-const method.
+///
+/// Containers that are unchanged since they have been stored can be evicted
+/// from memory: they become pending again, and are reloaded from where they
+/// have been stored upon the next access.
+///
+/// Containers can be shared with other sets, see shareFrom: a shared container
+/// is copied the first time it's accessed through a non-const method, so that
+/// each set pays only for the containers it changes.
+///
+/// \note a reference to a container obtained from a non-const method must not
+///       be used to modify it after the next store, nor after the next
+///       shareFrom involving this set.
 class ContainerSet {
 private:
-  using Map = llvm::StringMap<std::unique_ptr<ContainerBase>>;
+  using Map = llvm::StringMap<std::shared_ptr<ContainerBase>>;
 
 public:
   using const_iterator = Map::const_iterator;
   using iterator = Map::iterator;
   using value_type = Map::value_type;
 
+  /// Provides the targets of a stored container without deserializing it,
+  /// std::nullopt if they are not known and the container must be loaded
+  using TargetsReader = llvm::function_ref<
+    llvm::Expected<std::optional<TargetsList>>(llvm::StringRef Name)>;
+
+private:
+  /// A stored container which has not been deserialized yet
+  struct PendingContainer {
+    revng::FilePath Path;
+    TargetsList Targets;
+  };
+
 private:
-  Map Content;
+  // Deserializing a pending container does not change the observable state
+  mutable Map Content;
+  mutable llvm::StringMap<PendingContainer> Pending;
+  /// The file each unmodified container has been loaded from or stored to
+  mutable llvm::StringMap<revng::FilePath> Stored;
+  /// When each container has last been accessed, in a clock shared by all the
+  /// sets, to tell apart the cold ones
+  mutable llvm::StringMap<uint64_t> LastAccess;
   llvm::StringMap<const ContainerFactory *> Factories;
 
 public:
@@ -63,13 +104,42 @@ public:
   ~ContainerSet() = default;
 
 public:
-  const_iterator begin() const { return Content.begin(); }
+  /// \note iterating deserializes all the pending containers, see entries()
+  /// @{
+  const_iterator begin() const {
+    materializeAll();
+    return Content.begin();
+  }
   const_iterator end() const { return Content.end(); }
 
-  iterator begin() { return Content.begin(); }
+  iterator begin() {
+    materializeAll();
+    unshareAll();
+    Stored.clear();
+    return Content.begin();
+  }
   iterator end() { return Content.end(); }
+  /// @}
 
-  iterator find(llvm::StringRef Name) { return Content.find(Name); }
+  /// Iterates without deserializing the pending containers, which show up as
+  /// null: suitable only for users interested in names and addresses
+  llvm::iterator_range<const_iterator> entries() const {
+    return llvm::make_range(Content.begin(), Content.end());
+  }
+
+  iterator find(llvm::StringRef Name) {
+    materialize(Name);
+    unshare(Name);
+    Stored.erase(Name);
+    return Content.find(Name);
+  }
+
+  /// Like find, but the container is meant to be only read: this does not
+  /// count as a change and a shared container is not copied
+  const_iterator find(llvm::StringRef Name) const {
+    materialize(Name);
+    return Content.find(Name);
+  }
 
   size_t size() const { return Factories.size(); }
 
@@ -77,8 +147,12 @@ public:
   ContainerSet cloneFiltered(const ContainerToTargetsMap &Targets);
 
   void mergeBack(ContainerSet &&Other) {
+    Other.materializeAll();
     for (auto &Entry : Other.Content) {
       revng_assert(containsOrCanCreate(Entry.first()));
+      materialize(Entry.first());
+      unshare(Entry.first());
+      Stored.erase(Entry.first());
 
       auto &LContainer = Content.find(Entry.first())->second;
       auto &RContainer = Entry.second;
@@ -94,6 +168,9 @@ public:
 
   ContainerBase &operator[](llvm::StringRef Name) {
     revng_assert(containsOrCanCreate(Name));
+    materialize(Name);
+    unshare(Name);
+    Stored.erase(Name);
     if (Content[Name] == nullptr)
       Content[Name] = (*Factories[Name])(Name);
     auto &Pointer = Content.find(Name)->second;
@@ -103,11 +180,15 @@ public:
 
   ContainerBase &at(llvm::StringRef Name) {
     revng_assert(contains(Name));
+    materialize(Name);
+    unshare(Name);
+    Stored.erase(Name);
     return *Content.find(Name)->second;
   }
 
   const ContainerBase &at(llvm::StringRef Name) const {
     revng_assert(contains(Name));
+    materialize(Name);
     return *Content.find(Name)->second;
   }
 
@@ -115,9 +196,18 @@ public:
     return Factories.find(Name) != Factories.end();
   }
 
+  /// \returns the MIME type of the container \p Name, even if it does not
+  ///          exist yet
+  llvm::StringRef mimeType(llvm::StringRef Name) const {
+    revng_assert(isContainerRegistered(Name));
+    return Factories.find(Name)->second->mimeType();
+  }
+
   bool contains(llvm::StringRef Name) const {
     auto Iterator = Content.find(Name);
-    return Iterator != Content.end() and Iterator->second != nullptr;
+    if (Iterator == Content.end())
+      return false;
+    return Iterator->second != nullptr or Pending.count(Name) != 0;
   }
 
   bool containsOrCanCreate(llvm::StringRef Name) const {
@@ -126,11 +216,15 @@ public:
 
   template<typename T>
   const T &get(llvm::StringRef Name) const {
+    materialize(Name);
     return llvm::cast<T>(*Content.find(Name)->second);
   }
 
   template<typename T>
   T &get(llvm::StringRef Name) {
+    materialize(Name);
+    unshare(Name);
+    Stored.erase(Name);
     return llvm::cast<T>(*Content.find(Name)->second);
   }
 
@@ -143,6 +237,9 @@ public:
 
   ContainerToTargetsMap enumerate() const;
 
+  /// \returns the targets in the container \p Name, without deserializing it
+  TargetsList enumerate(llvm::StringRef Name) const;
+
   llvm::Error verify() const;
 
 public:
@@ -150,31 +247,104 @@ public:
            const ContainerFactory &Factory,
            std::unique_ptr<ContainerBase> Container = nullptr) {
     Content.try_emplace(Name, std::move(Container));
+    Stored.erase(Name);
     Factories.try_emplace(Name, &Factory);
   }
 
   llvm::Error remove(const ContainerToTargetsMap &ToRemove);
   void intersect(ContainerToTargetsMap &ToIntersect) const;
 
+  /// Make this set share all the containers of \p Other, which must have the
+  /// same names, replacing its own
+  ///
+  /// Unlike a copy, this costs nothing up front: the first of the two sets
+  /// accessing a container through a non-const method gets a private copy of
+  /// it. The pending containers of \p Other are deserialized, since the file
+  /// they would be loaded from could be overwritten in the meantime.
+  ///
+  /// \note the two sets must not be used concurrently
+  void shareFrom(const ContainerSet &Other);
+
+  /// \returns true if the container \p Name is shared with another set
+  bool isShared(llvm::StringRef Name) const {
+    auto It = Content.find(Name);
+    return It != Content.end() and It->second.use_count() > 1;
+  }
+
 public:
+  /// Store the containers in \p DirectoryPath, skipping those which have not
+  /// been modified since they have been loaded from or stored there
   llvm::Error store(const revng::DirectoryPath &DirectoryPath) const;
+
+  /// \returns true if the container \p Name has not been modified since it has
+  ///          been loaded from or stored to \p DirectoryPath
+  bool isStored(llvm::StringRef Name,
+                const revng::DirectoryPath &DirectoryPath) const {
+    auto It = Stored.find(Name);
+    return It != Stored.end() and It->second == DirectoryPath.getFile(Name);
+  }
+
   llvm::Error load(const revng::DirectoryPath &DirectoryPath);
 
+  /// Like load, but the containers whose targets are provided by \p Read are
+  /// only deserialized upon first access
+  llvm::Error loadLazily(const revng::DirectoryPath &DirectoryPath,
+                         TargetsReader Read);
+
   std::vector<revng::FilePath>
   getWrittenFiles(const revng::DirectoryPath &DirectoryPath) const;
 
+public:
+  /// \returns true if the container \p Name is in memory and can be evicted,
+  ///          i.e., it has not been modified since it has been stored. Shared
+  ///          containers are not evictable, it would not free any memory.
+  bool isEvictable(llvm::StringRef Name) const {
+    auto It = Content.find(Name);
+    return It != Content.end() and It->second != nullptr
+           and It->second.use_count() == 1 and Stored.count(Name) != 0;
+  }
+
+  /// \returns the time of the last access to the container \p Name, the
+  ///          lower the colder
+  uint64_t lastAccess(llvm::StringRef Name) const {
+    auto It = LastAccess.find(Name);
+    return It == LastAccess.end() ? 0 : It->second;
+  }
+
+  /// Drops the container \p Name from memory, it will be loaded again from
+  /// where it has been stored upon the next access
+  void evict(llvm::StringRef Name) const;
+
+  /// Drops the container \p Name and all of its targets, without storing it
+  void drop(llvm::StringRef Name) {
+    revng_assert(containsOrCanCreate(Name));
+    Content.find(Name)->second.reset();
+    Pending.erase(Name);
+    Stored.erase(Name);
+  }
+
 public:
   template<typename OStream>
   void dump(OStream &OS, size_t Indentation = 0) const {
     for (const auto &Entry : Content) {
       indent(OS, Indentation);
       OS << Entry.first().str() << "\n";
-      if (Entry.second != nullptr)
-        Entry.second->enumerate().dump(OS, Indentation + 1);
+      if (contains(Entry.first()))
+        enumerate(Entry.first()).dump(OS, Indentation + 1);
     }
   }
 
   void dump() const debug_function { dump(dbg); }
+
+private:
+  /// Deserializes the container \p Name, if it is pending, and records the
+  /// access to it
+  void materialize(llvm::StringRef Name) const;
+  void materializeAll() const;
+
+  /// Replaces the container \p Name with a private copy, if it's shared
+  void unshare(llvm::StringRef Name);
+  void unshareAll();
 };
 
 } // namespace pipeline
@@ -4,7 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
 #include <initializer_list>
+#include <memory>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
@@ -43,6 +45,14 @@ private:
   llvm::StringMap<const pipeline::ContainerSet::value_type *>
     ReadOnlyContainers;
 
+  /// Held by pointer so that the Context stays movable
+  std::shared_ptr<std::atomic<bool>>
+    CancellationRequested = std::make_shared<std::atomic<bool>>(false);
+
+  /// Whether the reads of the globals by pipes are tracked, see
+  /// disableReadTracking
+  bool ReadTracking = true;
+
 private:
   explicit Context(KindsRegistry Registry) :
     TheKindRegistry(std::move(Registry)) {}
@@ -68,6 +78,24 @@ public:
     Globals.emplace<T>(Name, std::forward<T>(Args)...);
   }
 
+  /// Asks the production in progress, if any, to stop at the next checkpoint
+  ///
+  /// \note this is the only method that can be called from a thread other
+  ///       than the one running the pipeline
+  void requestCancellation() { CancellationRequested->store(true); }
+  void resetCancellation() { CancellationRequested->store(false); }
+  bool isCancellationRequested() const {
+    return CancellationRequested->load(std::memory_order_relaxed);
+  }
+
+  /// Stop tracking which parts of the globals each target depends on
+  ///
+  /// This saves time, but targets will no longer be invalidated when the
+  /// globals change: suitable only for runs that don't outlive their first
+  /// request, see PipelineManager::makeEphemeral.
+  void disableReadTracking() { ReadTracking = false; }
+  bool isTrackingReads() const;
+
   void bumpCommitIndex() { CommitIndex += 1; }
   uint64_t getCommitIndex() const { return CommitIndex; }
 
@@ -128,14 +156,16 @@ public:
   llvm::Error load(const revng::DirectoryPath &Path);
 
 public:
+  /// \note the methods tracking the fields read from globals are no-ops if
+  ///       tracking has been disabled from the command line
+  /// @{
   void collectReadFields(const TargetInContainer &Target,
-                         llvm::StringMap<PathTargetBimap> &Out) const {
-    Globals.collectReadFields(Target, Out);
-  }
+                         llvm::StringMap<PathTargetBimap> &Out) const;
 
-  void clearAndResume() const { Globals.clearAndResume(); }
-  void pushReadFields() const { Globals.pushReadFields(); }
-  void popReadFields() const { Globals.popReadFields(); }
+  void clearAndResume() const;
+  void pushReadFields() const;
+  void popReadFields() const;
   void stopTracking() const { Globals.stopTracking(); }
+  /// @}
 };
 } // namespace pipeline
@@ -51,6 +51,17 @@ public:
   void log(llvm::raw_ostream &OS) const override;
 };
 
+/// Error thrown when a production has been stopped through
+/// Context::requestCancellation
+class CancelledError : public llvm::ErrorInfo<CancelledError> {
+public:
+  static char ID;
+
+public:
+  std::error_code convertToErrorCode() const override;
+  void log(llvm::raw_ostream &OS) const override;
+};
+
 /// Error thrown when one needs to annotate another error with extra data
 class AnnotatedError : public llvm::ErrorInfo<AnnotatedError> {
 public:
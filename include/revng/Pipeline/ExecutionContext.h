@@ -139,6 +139,10 @@ public:
   cppcoro::generator<const T &>
   getAndCommit(const F &Extractor, llvm::StringRef ContainerName) {
     for (const Target &Target : getRequestedTargetsFor(ContainerName)) {
+      // Cancellation checkpoint: Step::run discards the partial results
+      if (getContext().isCancellationRequested())
+        co_return;
+
       getContext().pushReadFields();
       co_yield Extractor(Target);
       commit(Target, ContainerName);
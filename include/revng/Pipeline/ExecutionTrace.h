@@ -0,0 +1,98 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/JSON.h"
+
+#include "revng/Pipeline/ContainerSet.h"
+#include "revng/Pipeline/Target.h"
+
+namespace llvm {
+class Module;
+} // namespace llvm
+
+namespace pipeline {
+
+/// Records how much each pipe invocation costs and emits it in the Chrome
+/// trace-event format, which can be loaded in `chrome://tracing` or Perfetto.
+///
+/// For each pipe invocation we record the wall and CPU time, how much the peak
+/// resident set size grew, the targets consumed and produced, per container,
+/// and the size of the serialized containers after the execution.
+///
+/// Tracing is enabled with `--pipeline-trace=<file>`. The file is (re)written
+/// at the end of each Runner::run with all the events recorded so far.
+class ExecutionTrace {
+private:
+  std::vector<llvm::json::Value> Events;
+  std::chrono::steady_clock::time_point Start;
+
+private:
+  ExecutionTrace() : Start(std::chrono::steady_clock::now()) {}
+
+public:
+  /// \returns the trace configured via command line, or nullptr if tracing is
+  ///          disabled
+  static ExecutionTrace *get();
+
+public:
+  /// Writes the trace to the file specified on the command line
+  llvm::Error write() const;
+
+private:
+  friend class TraceScope;
+  uint64_t microsecondsSinceStart() const;
+  void record(llvm::json::Object &&Event) { Events.push_back(std::move(Event)); }
+};
+
+/// Records a complete ("X") event spanning the lifetime of this object.
+///
+/// If tracing is disabled, constructing a TraceScope costs a single check.
+class TraceScope {
+private:
+  ExecutionTrace *Trace = nullptr;
+  llvm::json::Object Event;
+  llvm::json::Object Arguments;
+  uint64_t StartTime = 0;
+  uint64_t StartCPUTime = 0;
+  int64_t StartPeakRSS = 0;
+
+public:
+  TraceScope(llvm::StringRef Name, llvm::StringRef Category);
+  ~TraceScope();
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+public:
+  bool isEnabled() const { return Trace != nullptr; }
+
+  void addArgument(llvm::StringRef Name, llvm::json::Value &&Value) {
+    if (isEnabled())
+      Arguments[Name] = std::move(Value);
+  }
+
+  /// Records the targets listed in \p Targets, grouped by container
+  void addTargets(llvm::StringRef Name, const ContainerToTargetsMap &Targets);
+
+  /// Records the size of the serialization of the containers of \p Containers
+  /// called \p ContainersNames
+  void addSerializedSize(const ContainerSet &Containers,
+                         llvm::ArrayRef<std::string> ContainersNames);
+
+  /// Records the number of functions, basic blocks, instructions and metadata
+  /// nodes in \p Module, along with the size of its bitcode
+  void addModuleSize(llvm::StringRef Name, const llvm::Module &Module);
+};
+
+} // namespace pipeline
@@ -0,0 +1,114 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+#include "revng/Support/MetaAddress.h"
+
+namespace llvm {
+class Function;
+} // namespace llvm
+
+namespace pipeline {
+
+/// Records how much each function costs to each pipe, so that the functions
+/// that are expensive to analyze can be identified.
+///
+/// For each function and pipe we record the number of invocations, the wall
+/// time and, where applicable, the size of the function: the number of LLVM
+/// instructions before and after the pipe, for pipes working on the IR, and the
+/// number of basic blocks, for pipes working on the CFG.
+///
+/// The report is enabled with `--function-cost-report=<file>`. The file is
+/// (re)written at the end of each Runner::run with all the costs recorded so
+/// far, as JSON, with the functions sorted by decreasing total time.
+class FunctionCostReport {
+public:
+  struct Cost {
+    uint64_t Calls = 0;
+    uint64_t WallTimeNs = 0;
+    uint64_t InstructionsBefore = 0;
+    uint64_t InstructionsAfter = 0;
+    uint64_t Blocks = 0;
+  };
+
+private:
+  std::map<MetaAddress, std::map<std::string, Cost>> Costs;
+  std::string CurrentPipe;
+
+private:
+  FunctionCostReport() = default;
+
+public:
+  /// \returns the report configured via command line, or nullptr if it's
+  ///          disabled
+  static FunctionCostReport *get();
+
+public:
+  /// Writes the report to the file specified on the command line
+  llvm::Error write() const;
+
+private:
+  friend class FunctionCostScope;
+  friend class FunctionCostPipeScope;
+  Cost &costFor(const MetaAddress &Entry) { return Costs[Entry][CurrentPipe]; }
+};
+
+/// Attributes the costs recorded in its lifetime to the pipe \p Name
+class FunctionCostPipeScope {
+private:
+  FunctionCostReport *Report = nullptr;
+  std::string PreviousPipe;
+
+public:
+  explicit FunctionCostPipeScope(llvm::StringRef Name);
+  ~FunctionCostPipeScope();
+
+  FunctionCostPipeScope(const FunctionCostPipeScope &) = delete;
+  FunctionCostPipeScope &operator=(const FunctionCostPipeScope &) = delete;
+};
+
+/// Records the cost of processing the function at \p Entry, spanning the
+/// lifetime of this object, in the current pipe.
+///
+/// If \p F is provided, its size is measured at the beginning and at the end.
+/// If the report is disabled, constructing a FunctionCostScope costs a single
+/// check.
+class FunctionCostScope {
+private:
+  FunctionCostReport *Report = nullptr;
+  MetaAddress Entry;
+  const llvm::Function *F = nullptr;
+  uint64_t InstructionsBefore = 0;
+  uint64_t Blocks = 0;
+  std::chrono::steady_clock::time_point Start;
+
+public:
+  FunctionCostScope(const MetaAddress &Entry,
+                    const llvm::Function *F = nullptr);
+  ~FunctionCostScope();
+
+  FunctionCostScope(const FunctionCostScope &) = delete;
+  FunctionCostScope &operator=(const FunctionCostScope &) = delete;
+
+public:
+  bool isEnabled() const { return Report != nullptr; }
+
+  /// Measure the IR size on \p NewF at the end, for pipes that create the
+  /// function while processing it
+  void setFunction(const llvm::Function *NewF) { F = NewF; }
+
+  /// Record the size of the CFG of the function, in basic blocks
+  void setBlocks(uint64_t Count) { Blocks = Count; }
+};
+
+} // namespace pipeline
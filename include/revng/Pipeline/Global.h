@@ -4,7 +4,9 @@
 //
 
 #include <any>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <type_traits>
 
 #include "llvm/ADT/StringRef.h"
@@ -16,6 +18,7 @@
 #include "revng/Pipeline/PathTargetBimap.h"
 #include "revng/Storage/Path.h"
 #include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/MemoryUsage.h"
 #include "revng/TupleTree/Tracking.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 
@@ -26,22 +29,64 @@ private:
   const char *ID;
   std::string Name;
 
+  /// While recording, a copy of the global taken right before its first
+  /// change, or nullptr if it has not changed yet
+  std::unique_ptr<Global> Before;
+  /// While recording, the diffs applied through applyKnownDiff before Before
+  /// was taken, which are recorded as they are
+  std::optional<GlobalTupleTreeDiff> Journal;
+  bool Recording = false;
+  bool InKnownDiff = false;
+
 public:
   Global(const char *ID, llvm::StringRef Name) : ID(ID), Name(Name.str()) {}
   virtual ~Global() {}
   virtual Global &operator=(const Global &NewGlobal) = 0;
 
 public:
-  Global(const Global &) = default;
+  /// Copies never inherit the recording state
+  Global(const Global &Other) : ID(Other.ID), Name(Other.Name) {}
   Global(Global &&) = default;
   Global &operator=(Global &&) = default;
 
+public:
+  /// Start recording the changes to this global
+  ///
+  /// No copy is made at this point: the global is copied only right before it
+  /// is first changed (see aboutToChange), if ever. This way, getting the diff
+  /// of a global that has not changed costs nothing.
+  void startRecording();
+
+  /// Stop recording
+  ///
+  /// \returns the changes since startRecording
+  GlobalTupleTreeDiff stopRecording();
+
+  bool isRecording() const { return Recording; }
+
+  /// Apply \p Diff, which is known to apply cleanly, e.g., since it has
+  /// already been applied to a copy of this global
+  ///
+  /// While recording, and as long as the global is not changed otherwise,
+  /// \p Diff is recorded as it is, rather than copying the global, so that
+  /// the recorded changes cost as much as the diff itself.
+  void applyKnownDiff(const GlobalTupleTreeDiff &Diff);
+
+protected:
+  /// Derived classes must call this before changing the global or giving out
+  /// write access to it
+  void aboutToChange() {
+    if (Recording and not InKnownDiff and Before == nullptr)
+      Before = clone();
+  }
+
 public:
   const char *getID() const { return ID; }
   llvm::StringRef getName() const { return Name; }
 
 public:
   virtual GlobalTupleTreeDiff diff(const Global &Other) const = 0;
+  virtual GlobalTupleTreeDiff emptyDiff() const = 0;
   virtual llvm::Error applyDiff(const llvm::MemoryBuffer &Diff) = 0;
   virtual llvm::Error applyDiff(const GlobalTupleTreeDiff &Diff) = 0;
 
@@ -51,6 +96,13 @@ public:
   diffFromString(llvm::StringRef String) = 0;
 
   virtual bool verify() const = 0;
+
+  /// Verify the global knowing that it's the result of applying \p Diff to a
+  /// global that used to verify. Implementations can use this to re-check only
+  /// what \p Diff affected, by default the whole global is verified.
+  virtual bool verify(const GlobalTupleTreeDiff &Diff) const {
+    return verify();
+  }
   virtual void clear() = 0;
 
   virtual llvm::Expected<std::unique_ptr<Global>>
@@ -61,6 +113,10 @@ public:
   virtual llvm::Error store(const revng::FilePath &Path) const;
   virtual llvm::Error load(const revng::FilePath &Path);
 
+  /// \returns an estimate of the memory used by this global, in bytes, or 0
+  ///          if unknown
+  virtual uint64_t memoryUsage() const { return 0; }
+
   virtual std::optional<TupleTreePath>
   deserializePath(llvm::StringRef Serialized) const = 0;
 
@@ -114,6 +170,7 @@ public:
   }
 
   void clear() override {
+    aboutToChange();
     Value.evictCachedReferences();
     *Value = Object();
   }
@@ -134,6 +191,7 @@ public:
       return llvm::createStringError(llvm::inconvertibleErrorCode(), Message);
     }
 
+    aboutToChange();
     Value = *MaybeTupleTree;
     return llvm::Error::success();
   }
@@ -148,36 +206,73 @@ public:
 
   bool verify() const override { return Value->verify(); }
 
+  uint64_t memoryUsage() const override { return ::memoryUsage(Value); }
+
+  bool verify(const GlobalTupleTreeDiff &Diff) const override {
+    using DiffType = TupleTreeDiff<Object>;
+    constexpr bool HasIncrementalVerify = requires(const Object &O,
+                                                   const DiffType &D) {
+      { verifyChanges(O, D) } -> std::same_as<bool>;
+    };
+
+    if constexpr (HasIncrementalVerify) {
+      if (const TupleTreeDiff<Object> *Casted = Diff.getAs<Object>())
+        return verifyChanges(*Value, *Casted);
+    }
+
+    return verify();
+  }
+
   GlobalTupleTreeDiff diff(const Global &Other) const override {
     const TupleTreeGlobal &Casted = llvm::cast<TupleTreeGlobal>(Other);
     auto Diff = ::diff(*Value, *Casted.Value);
     return GlobalTupleTreeDiff(std::move(Diff), getName());
   }
 
+  GlobalTupleTreeDiff emptyDiff() const override {
+    return GlobalTupleTreeDiff(TupleTreeDiff<Object>(), getName());
+  }
+
   llvm::Error applyDiff(const llvm::MemoryBuffer &Diff) override {
     auto MaybeDiff = TupleTreeDiff<Object>::fromString(Diff.getBuffer());
     if (not MaybeDiff) {
       return MaybeDiff.takeError();
     }
+    aboutToChange();
     return MaybeDiff->apply(Value);
   }
 
   llvm::Error applyDiff(const TupleTreeDiff<Object> &Diff) {
+    aboutToChange();
     return Diff.apply(Value);
   }
 
   llvm::Error applyDiff(const GlobalTupleTreeDiff &Diff) override {
+    aboutToChange();
     return Diff.getAs<Object>()->apply(Value);
   }
 
   Global &operator=(const Global &Other) override {
     const TupleTreeGlobal &Casted = llvm::cast<TupleTreeGlobal>(Other);
+    aboutToChange();
     Value = Casted.Value;
     return *this;
   }
 
   const TupleTree<Object> &get() const { return Value; }
-  TupleTree<Object> &get() { return Value; }
+
+  /// Write access to the tree, which counts as a change while recording
+  TupleTree<Object> &get() {
+    aboutToChange();
+    return Value;
+  }
+
+  /// Read-only access to the tree, after caching its references, which does
+  /// not count as a change
+  const TupleTree<Object> &getAndCacheReferences() {
+    Value.cacheReferences();
+    return Value;
+  }
 
   std::optional<TupleTreePath>
   deserializePath(llvm::StringRef Serialized) const override {
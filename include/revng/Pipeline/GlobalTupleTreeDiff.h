@@ -5,6 +5,7 @@
 
 #include <any>
 
+#include "revng/Support/Assert.h"
 #include "revng/Support/YAMLTraits.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 
@@ -35,6 +36,10 @@ public:
   virtual bool isEmpty() const = 0;
   llvm::StringRef getGlobalName() const { return GlobalName; }
   virtual llvm::SmallVector<const TupleTreePath *, 4> getPaths() const = 0;
+
+  /// Append the changes of \p Other, which must be a diff of the same type,
+  /// to be applied after the current ones
+  virtual void append(const GlobalTupleTreeDiffBase &Other) = 0;
 };
 
 template<TupleTreeCompatible T>
@@ -83,6 +88,11 @@ public:
     }
     return ToReturn;
   }
+
+  void append(const GlobalTupleTreeDiffBase &Other) override {
+    const auto &Casted = llvm::cast<GlobalTupleTreeDiffImpl>(Other);
+    llvm::append_range(Diff.Changes, Casted.Diff.Changes);
+  }
 };
 
 class GlobalTupleTreeDiff {
@@ -141,6 +151,13 @@ public:
 
   bool isEmpty() const { return Diff.get()->isEmpty(); }
 
+  /// Append the changes of \p Other, a diff of the same global that has to be
+  /// applied after this one
+  void append(const GlobalTupleTreeDiff &Other) {
+    revng_assert(getGlobalName() == Other.getGlobalName());
+    Diff->append(*Other.Diff);
+  }
+
   llvm::StringRef getGlobalName() const { return Diff->getGlobalName(); }
 };
 
@@ -27,6 +27,28 @@ public:
     return ToReturn;
   }
 
+  /// Start recording the changes to all the globals, see Global::startRecording
+  void startRecording() {
+    for (const auto &Pair : Map)
+      Pair.second->startRecording();
+  }
+
+  /// \returns the changes to each global since startRecording
+  DiffMap stopRecording() {
+    DiffMap ToReturn;
+    for (const auto &Pair : Map)
+      ToReturn.try_emplace(Pair.first, Pair.second->stopRecording());
+    return ToReturn;
+  }
+
+  /// \returns a map with an empty diff for each global
+  DiffMap emptyDiffs() const {
+    DiffMap ToReturn;
+    for (const auto &Pair : Map)
+      ToReturn.try_emplace(Pair.first, Pair.second->emptyDiff());
+    return ToReturn;
+  }
+
 private:
   static const Global *
   dereferenceIterator(const MapType::const_iterator::value_type &Pair) {
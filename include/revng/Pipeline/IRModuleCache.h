@@ -0,0 +1,63 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <mutex>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+
+namespace pipeline {
+
+class Context;
+
+/// The IR files parsed in an LLVMContext, such as the QEMU helpers and the
+/// support modules, which are linked in the module of each binary
+///
+/// Every file is parsed only the first time it's requested, later requests get
+/// a clone of the pristine module, which is much cheaper than parsing it again.
+/// This pays off when the same LLVMContext is used to analyze several binaries
+/// in the same process (see `revng-pipeline --batch`).
+class IRModuleCache {
+public:
+  static constexpr auto Name = "IRModuleCache";
+
+private:
+  llvm::LLVMContext &Context;
+  std::mutex Mutex;
+  llvm::StringMap<std::unique_ptr<llvm::Module>> Modules;
+
+public:
+  explicit IRModuleCache(llvm::LLVMContext &Context) : Context(Context) {}
+
+  IRModuleCache(const IRModuleCache &) = delete;
+  IRModuleCache &operator=(const IRModuleCache &) = delete;
+
+public:
+  llvm::LLVMContext &getContext() const { return Context; }
+
+  /// \return a copy of the module in \p Path, nullptr if it can't be parsed,
+  ///         in which case \p Error describes why
+  std::unique_ptr<llvm::Module> parseIRFile(llvm::StringRef Path,
+                                            llvm::SMDiagnostic &Error);
+
+public:
+  /// \return the cache registered in \p PipelineContext, nullptr if none
+  static IRModuleCache *get(const pipeline::Context &PipelineContext);
+
+  /// Parse the IR file in \p Path in \p Context, going through the cache
+  /// registered in \p PipelineContext if it belongs to \p Context
+  static std::unique_ptr<llvm::Module>
+  parseIRFile(const pipeline::Context &PipelineContext,
+              llvm::StringRef Path,
+              llvm::SMDiagnostic &Error,
+              llvm::LLVMContext &Context);
+};
+
+} // namespace pipeline
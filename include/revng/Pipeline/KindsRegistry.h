@@ -6,6 +6,7 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 
 #include "revng/ADT/STLExtras.h"
@@ -17,27 +18,32 @@ namespace pipeline {
 
 /// A KindsRegistry is a simple vector used to keep track of which kinds are
 /// available in a particular pipeline
+///
+/// Kinds are also indexed by name, since they are looked up every time a
+/// target is parsed.
 class KindsRegistry {
 public:
   using Container = llvm::SmallVector<Kind *, 4>;
 
 private:
   Container Kinds;
+  llvm::StringMap<Kind *> ByName;
 
 public:
   KindsRegistry(llvm::SmallVector<Kind *, 4> Kinds = {}) :
     Kinds(std::move(Kinds)) {
-    llvm::sort(Kinds, [](Kind *&LHS, Kind *&RHS) {
-      return LHS->name() < RHS->name();
-    });
+    for (Kind *K : this->Kinds) {
+      bool New = ByName.try_emplace(K->name(), K).second;
+      revng_assert(New);
+    }
+    sort();
   }
 
   void registerKind(Kind &K) {
-    revng_assert(not contains(K.name()));
+    bool New = ByName.try_emplace(K.name(), &K).second;
+    revng_assert(New);
     Kinds.push_back(&K);
-    llvm::sort(Kinds, [](Kind *&LHS, Kind *&RHS) {
-      return LHS->name() < RHS->name();
-    });
+    sort();
   }
 
 public:
@@ -47,12 +53,10 @@ public:
   auto end() const { return revng::dereferenceIterator(Kinds.end()); }
 
   const Kind *find(llvm::StringRef Name) const {
-    auto Iter = llvm::find_if(Kinds, [Name](const auto *Kind) {
-      return Kind->name() == Name;
-    });
-    if (Iter == Kinds.end())
+    auto Iter = ByName.find(Name);
+    if (Iter == ByName.end())
       return nullptr;
-    return *Iter;
+    return Iter->second;
   }
 
   bool contains(llvm::StringRef Name) { return find(Name) != nullptr; }
@@ -67,6 +71,13 @@ public:
   }
 
   void dump() const debug_function { dump(dbg); }
+
+private:
+  void sort() {
+    llvm::sort(Kinds, [](Kind *&LHS, Kind *&RHS) {
+      return LHS->name() < RHS->name();
+    });
+  }
 };
 
 } // namespace pipeline
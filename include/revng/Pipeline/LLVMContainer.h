@@ -4,8 +4,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+
 #include "revng/Pipeline/ContainerEnumerator.h"
 #include "revng/Pipeline/Pipe.h"
+#include "revng/Storage/Path.h"
+#include "revng/Storage/ReadableFile.h"
 #include "revng/Support/ModuleStatistics.h"
 
 inline Logger<> ModuleStatisticsLogger("module-statistics");
@@ -31,6 +35,15 @@ private:
 private:
   std::unique_ptr<llvm::Module> Module;
 
+  /// When the container is loaded from bitcode, function bodies are not
+  /// parsed until Module is first accessed. LazySource holds the bitcode until
+  /// then: if the module is never accessed, store writes it back verbatim.
+  mutable std::unique_ptr<revng::ReadableFile> LazySource;
+
+  /// The file LazySource maps, if any. Storing to it is a no-op: opening it
+  /// for writing would truncate the bitcode the module is still reading from.
+  mutable std::optional<revng::FilePath> LazyPath;
+
 public:
   inline static const llvm::StringRef MIMEType = "text/x.llvm.ir";
   inline static const char *Name = "llvm-container";
@@ -55,8 +68,15 @@ public:
   }
 
 public:
-  const llvm::Module &getModule() const { return *Module; }
-  llvm::Module &getModule() { return *Module; }
+  const llvm::Module &getModule() const {
+    materialize();
+    return *Module;
+  }
+
+  llvm::Module &getModule() {
+    materialize();
+    return *Module;
+  }
 
 public:
   std::unique_ptr<ContainerBase>
@@ -70,13 +90,28 @@ public:
 
   llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) final;
 
+  /// If the module has been loaded from bitcode and never accessed since,
+  /// writes back the original bitcode without materializing it
+  llvm::Error store(const revng::FilePath &Path) const final;
+
+  llvm::Error load(const revng::FilePath &Path) final;
+
+  uint64_t memoryUsage() const final;
+
   void clear() final {
+    LazySource.reset();
+    LazyPath.reset();
     Module = std::make_unique<llvm::Module>("revng.module",
                                             Module->getContext());
   }
 
 private:
   void mergeBackImpl(ThisType &&OtherContainer) final;
+
+  llvm::Error loadLazily(std::unique_ptr<revng::ReadableFile> &&Source);
+
+  /// Parses the bodies of all the functions, if the module is loaded lazily
+  void materialize() const;
 };
 
 } // namespace pipeline
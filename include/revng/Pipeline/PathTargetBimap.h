@@ -11,6 +11,7 @@
 #include "llvm/Support/YAMLTraits.h"
 
 #include "revng/Pipeline/Target.h"
+#include "revng/Support/Assert.h"
 #include "revng/TupleTree/TupleTreePath.h"
 
 namespace pipeline {
@@ -91,8 +92,10 @@ public:
 
   void insert(const TargetInContainer &TargetInContainer,
               const TupleTreePath &Path) {
-    Map[Path].insert(TargetInContainer);
-    ReverseMap[TargetInContainer].push_back(Path);
+    // The same field is usually read again every time a target is produced,
+    // don't record it more than once in the reverse map
+    if (Map[Path].insert(TargetInContainer).second)
+      ReverseMap[TargetInContainer].push_back(Path);
   }
 
   void insert(const Target &Target,
@@ -110,7 +113,11 @@ public:
         continue;
 
       for (auto &Path : Iter->second) {
-        Map.at(Path).erase(ToErase);
+        auto PathIt = Map.find(Path);
+        revng_assert(PathIt != Map.end());
+        PathIt->second.erase(ToErase);
+        if (PathIt->second.empty())
+          Map.erase(PathIt);
       }
 
       ReverseMap.erase(Iter);
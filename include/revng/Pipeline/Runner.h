@@ -42,6 +42,11 @@ private:
   Map Steps;
   Vector ReversePostOrderIndexes;
   llvm::StringMap<AnalysesList> AnalysesLists;
+  /// Where the containers that no longer have consumers are stored before
+  /// being released, see setReleaseDirectory
+  revng::DirectoryPath ReleaseDirectory{ nullptr, "" };
+  /// Whether the containers are never stored, see setEphemeral
+  bool Ephemeral = false;
 
 public:
   template<typename T>
@@ -82,14 +87,16 @@ public:
   const Step &operator[](llvm::StringRef Name) const { return getStep(Name); }
 
   Step &getStep(llvm::StringRef Name) {
-    revng_assert(Steps.find(Name) != Steps.end(),
+    auto It = Steps.find(Name);
+    revng_assert(It != Steps.end(),
                  ("Can't find step " + llvm::Twine(Name)).str().c_str());
-    return Steps.find(Name)->second;
+    return It->second;
   }
 
   const Step &getStep(llvm::StringRef Name) const {
-    revng_assert(Steps.find(Name) != Steps.end());
-    return Steps.find(Name)->second;
+    auto It = Steps.find(Name);
+    revng_assert(It != Steps.end());
+    return It->second;
   }
 
   bool containsAnalysis(llvm::StringRef Name) const {
@@ -162,6 +169,8 @@ public:
   llvm::Error run(llvm::StringRef EndingStepName,
                   const ContainerToTargetsMap &Targets);
 
+  /// Produce all the requested targets, running each required step only once
+  /// even when multiple requests depend on it.
   llvm::Error run(const State &ToProduce);
 
   AnalysisWrapper *findAnalysis(llvm::StringRef AnalysisName) {
@@ -218,9 +227,49 @@ public:
                               const revng::DirectoryPath &DirPath) const;
   llvm::Error load(const revng::DirectoryPath &DirPath);
 
+  /// Start from the state of \p Other, a runner of the same pipeline: the
+  /// globals are copied, while the containers of each step are shared
+  /// copy-on-write, see ContainerSet::shareFrom
+  ///
+  /// \note the two runners must not be run concurrently
+  llvm::Error shareFrom(const Runner &Other);
+
   std::vector<revng::FilePath>
   getWrittenFiles(const revng::DirectoryPath &DirPath) const;
 
+  /// Evicts the containers which are stored and unchanged since, the least
+  /// recently used first, as long as the containers in memory exceed the
+  /// budget set with `--pipeline-memory-budget`
+  void enforceMemoryBudget() const;
+
+  /// \returns the estimate of the memory used by each global and by each
+  ///          container in memory, grouped by step, as a YAML mapping
+  ///
+  /// Containers that are stored but not loaded are not listed, containers
+  /// that cannot estimate their size are listed as 0 (see
+  /// ContainerBase::memoryUsage).
+  std::string serializeMemoryUsage() const;
+
+  /// Forget the plans the steps reuse across requests, see Step::analyzeGoals
+  void dropPlanTemplates();
+
+  /// While running, store in \p DirPath and release from memory the
+  /// containers that none of the steps left to run reads from, e.g., the root
+  /// module once all the functions have been isolated
+  ///
+  /// An invalid \p DirPath, the default, disables the release.
+  void setReleaseDirectory(const revng::DirectoryPath &DirPath) {
+    ReleaseDirectory = DirPath;
+  }
+
+  /// Declare that the containers will never be stored, nor asked for again
+  /// once the steps that read from them have run
+  ///
+  /// The containers that would be released after being stored, see
+  /// setReleaseDirectory, are simply dropped.
+  void setEphemeral() { Ephemeral = true; }
+  bool isEphemeral() const { return Ephemeral; }
+
 public:
   void deduceAllPossibleTargets(State &State) const;
 
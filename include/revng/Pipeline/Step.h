@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
 #include <memory>
 #include <optional>
 #include <set>
@@ -14,7 +15,9 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
@@ -71,6 +74,28 @@ private:
   AnalysisMapType AnalysisMap;
   Context *TheContext = nullptr;
 
+  /// Targets that have been invalidated only because some of the targets they
+  /// have been produced from have been invalidated, see suspend
+  ContainerSet Suspended;
+
+  /// Hash of the content of each invalidated target at the time it has been
+  /// invalidated. Entries are dropped as soon as the target is available again.
+  /// An empty hash means the content could not be hashed.
+  std::map<TargetInContainer, std::string> StaleHashes;
+
+  /// How the pipes satisfy a request whose targets all have the same path,
+  /// reusable for requests of the same kinds with a different path, see
+  /// analyzeGoals
+  struct PlanTemplate {
+    /// The commit index of the context this has been computed at
+    uint64_t CommitIndex = 0;
+    ContainerToTargetsMap Required;
+    std::vector<PipeExecutionEntry> PipesExecutionEntries;
+  };
+
+  /// Plan templates, by the containers and kinds of the request
+  mutable llvm::StringMap<PlanTemplate> PlanTemplates;
+
 public:
   template<typename... PipeWrapperTypes>
   Step(Context &Context,
@@ -120,10 +145,14 @@ public:
     }
 
     for (auto &Container : ToInvalidateMap) {
-      if (Containers.contains(Container.first())) {
-        Container.second = Container.second.intersect(Containers
-                                                        .at(Container.first())
-                                                        .enumerate());
+      llvm::StringRef ContainerName = Container.first();
+      if (Containers.contains(ContainerName)) {
+        // Suspended targets must be invalidated too, or they might be revived
+        // Enumerating doesn't deserialize the pending containers
+        TargetsList Available = Containers.enumerate(ContainerName);
+        if (Suspended.contains(ContainerName))
+          Available.merge(Suspended.enumerate(ContainerName));
+        Container.second = Container.second.intersect(Available);
       }
     }
 
@@ -140,14 +169,30 @@ public:
   }
 
 private:
-  llvm::Error loadInvalidationMetadataImpl(const revng::DirectoryPath &Path,
-                                           ContainerSet::value_type &Pair);
+  llvm::Error
+  loadInvalidationMetadataImpl(const revng::DirectoryPath &Path,
+                               const ContainerSet::value_type &Pair);
+
+  /// Load invalidation metadata stored in the former YAML format
+  llvm::Error
+  loadYAMLInvalidationMetadata(llvm::StringRef Buffer,
+                               const ContainerSet::value_type &Pair);
 
 private:
   llvm::Error loadInvalidationMetadata(const revng::DirectoryPath &Path);
 
   llvm::Error storeInvalidationMetadata(const revng::DirectoryPath &Path) const;
 
+  /// The targets of each container are stored next to it, so that loading a
+  /// step does not require deserializing its containers
+  /// @{
+  llvm::Error storeTargets(const revng::DirectoryPath &Path,
+                           const llvm::StringSet<> &Skip) const;
+  llvm::Expected<std::optional<TargetsList>>
+  loadTargets(const revng::DirectoryPath &Path,
+              llvm::StringRef ContainerName) const;
+  /// @}
+
 public:
   void addAnalysis(llvm::StringRef Name, AnalysisWrapper Analysis) {
     AnalysisMap.try_emplace(Name, std::move(Analysis));
@@ -280,9 +325,18 @@ public:
   /// achieved by the current step and returns the targets that must be loaded
   /// from the containers in the step before this one, as well as a list of for
   /// each pipe.
+  ///
+  /// The work of the pipes only depends on the kinds of the targets, as long as
+  /// their contracts preserve the path of the targets, and on the globals. In
+  /// that case, it's kept and reused for the following requests of the same
+  /// kinds, which typically differ only by the function they are about.
   std::pair<ContainerToTargetsMap, std::vector<PipeExecutionEntry>>
   analyzeGoals(const ContainerToTargetsMap &RequiredGoals) const;
 
+  /// Forget the plans reused by analyzeGoals, must be called whenever the
+  /// globals change without bumping the commit index of the context
+  void dropPlanTemplates() { PlanTemplates.clear(); }
+
   llvm::Error checkPrecondition() const;
 
   /// Returns the predicted state of the Input containers status after the
@@ -296,10 +350,54 @@ public:
   /// status
   llvm::Error invalidate(const ContainerToTargetsMap &ToRemove);
 
+  /// \defgroup Early cutoff
+  ///
+  /// When `--pipeline-early-cutoff` is enabled, the targets that are
+  /// invalidated only because some of the targets they have been produced from
+  /// have been invalidated are not dropped right away, but put aside along
+  /// with their invalidation metadata. If the targets they depend on are then
+  /// produced again with the same content they had before, the suspended
+  /// targets are restored instead of being recomputed.
+  ///
+  /// To tell whether a target changed, the content of each invalidated
+  /// target, as returned by ContainerBase::extractOne, is hashed.
+  /// @{
+
+  /// Puts aside \p ToSuspend, or drops it if early cutoff is disabled
+  llvm::Error suspend(const ContainerToTargetsMap &ToSuspend);
+
+  /// Restores the suspended targets among \p Goals whose inputs are available
+  /// in the previous step and did not change since they have been suspended
+  ///
+  /// \returns true if at least one target has been restored
+  bool reviveSuspended(const ContainerToTargetsMap &Goals);
+
+  /// Compares the targets that have been produced again since they have been
+  /// invalidated with their previous content
+  ///
+  /// \returns the targets that have been produced again with a different
+  ///          content
+  ContainerToTargetsMap settleStaleTargets();
+
+  /// Drops the suspended targets among \p ToDrop
+  void dropSuspended(const ContainerToTargetsMap &ToDrop);
+
+  /// @}
+
+private:
+  void recordStaleHashes(const ContainerToTargetsMap &Targets);
+
+  bool hasStaleTargets(const ContainerToTargetsMap &Targets) const;
+
 public:
   llvm::Error store(const revng::DirectoryPath &DirPath) const;
   llvm::Error load(const revng::DirectoryPath &DirPath);
 
+  /// Take the state of \p Other, which must be the same step of another
+  /// instance of the same pipeline, sharing its containers copy-on-write, see
+  /// ContainerSet::shareFrom
+  void shareFrom(const Step &Other);
+
   std::vector<revng::FilePath>
   getWrittenFiles(const revng::DirectoryPath &DirPath) const;
 
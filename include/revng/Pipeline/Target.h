@@ -199,19 +199,13 @@ public:
 public:
   template<typename... Args>
   void emplace_back(Args &&...A) {
-    Contained.emplace_back(std::forward<Args>(A)...);
-    llvm::sort(Contained);
-    Contained.erase(unique(Contained.begin(), Contained.end()),
-                    Contained.end());
+    insertSorted(Target(std::forward<Args>(A)...));
   }
 
   void merge(const TargetsList &Other);
 
   void push_back(const Target &Target) {
-    Contained.push_back(Target);
-    llvm::sort(Contained);
-    Contained.erase(unique(Contained.begin(), Contained.end()),
-                    Contained.end());
+    insertSorted(pipeline::Target(Target));
   }
 
   template<typename... Args>
@@ -241,6 +235,23 @@ public:
   }
 
 private:
+  /// Inserts \p New in its position, unless it's already present.
+  ///
+  /// Targets are often appended in order (e.g., by appendAllTargets), in which
+  /// case this doesn't need to look for the position at all.
+  void insertSorted(Target &&New) {
+    if (Contained.empty() or Contained.back() < New) {
+      Contained.push_back(std::move(New));
+      return;
+    }
+
+    auto It = std::lower_bound(Contained.begin(), Contained.end(), New);
+    if (It != Contained.end() and not(New < *It))
+      return;
+
+    Contained.insert(It, std::move(New));
+  }
+
   struct Comp {
     bool operator()(const Target &T, const Kind &K) const {
       return &T.getKind() < &K;
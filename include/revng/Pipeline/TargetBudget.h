@@ -0,0 +1,40 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "revng/Support/Deadline.h"
+#include "revng/Support/MetaAddress.h"
+
+namespace pipeline {
+
+/// Bounds the time spent by a pipe on the function at \p Entry, spanning the
+/// lifetime of this object
+///
+/// The budget is set with `--target-time-budget-ms` and is enforced
+/// cooperatively, through revng::DeadlineScope: the algorithms that can take
+/// long on pathological functions poll it and degrade their result rather
+/// than keeping the rest of the step waiting. In particular:
+///
+/// * the ValueMaterializer falls back to the range of the value, as if it ran
+///   out of its own budget;
+/// * the graph layout stops minimizing the edge crossings and sorting the
+///   nodes, producing a valid but less readable layout.
+///
+/// The functions that exceed the budget are reported in the "target-budget"
+/// logger and statistics.
+class TargetBudgetScope {
+private:
+  MetaAddress Entry;
+  revng::DeadlineScope Deadline;
+
+public:
+  explicit TargetBudgetScope(const MetaAddress &Entry);
+  ~TargetBudgetScope();
+
+  TargetBudgetScope(const TargetBudgetScope &) = delete;
+  TargetBudgetScope &operator=(const TargetBudgetScope &) = delete;
+};
+
+} // namespace pipeline
@@ -98,6 +98,14 @@ bool rp_shutdown();
  */
 void rp_string_destroy(char *string);
 
+/**
+ * Can be invoked at any time, even while other rp_* functions are running.
+ *
+ * \return the current value of all the named statistics (see
+ * RunningStatistics and CounterMap), as a YAML mapping.
+ */
+char * /*owning*/ rp_get_statistics();
+
 /**
  * \defgroup rp_manager rp_manager methods
  * \{
@@ -139,6 +147,19 @@ LENGTH_HINT(rp_manager_create_from_string, 3, 2)
  */
 void rp_manager_destroy(rp_manager *manager);
 
+/**
+ * Create a new manager starting from the current state of \p manager, e.g., to
+ * try out a change of the model without affecting it.
+ *
+ * The two managers share all the containers, which are copied only by the
+ * first of the two that changes them. The new manager has no execution
+ * directory, its state is lost once destroyed. The two managers must not be
+ * used concurrently.
+ *
+ * \return the new rp_manager if no error happened, NULL otherwise.
+ */
+rp_manager * /*owning*/ rp_manager_fork(const rp_manager *manager);
+
 /**
  * \param name the container name to fetch
  *
@@ -190,6 +211,38 @@ rp_manager_produce_targets(rp_manager *manager,
                            rp_error *error);
 LENGTH_HINT(rp_manager_produce_targets, 4, 3)
 
+/**
+ * Request the production of targets in several steps and containers at once.
+ * All the requests are scheduled together, so that each step is run at most
+ * once. The produced targets can then be extracted with
+ * rp_container_extract_one.
+ *
+ * \param requests_count must be equal to the size of steps and targets.
+ * \param steps the step each entry of targets should be produced in.
+ * \param targets the targets to produce, for each container.
+ *
+ * \return false if an error was encountered, true otherwise
+ */
+bool rp_manager_produce_targets_batch(rp_manager *manager,
+                                      uint64_t requests_count,
+                                      const rp_step *steps[],
+                                      const rp_container_targets_map *targets[],
+                                      rp_error *error);
+LENGTH_HINT(rp_manager_produce_targets_batch, 2, 1)
+LENGTH_HINT(rp_manager_produce_targets_batch, 3, 1)
+
+/**
+ * Ask the production in progress on the manager, if any, to stop as soon as
+ * possible. The interrupted rp_manager_produce_targets or
+ * rp_manager_produce_targets_batch call will then fail, and the steps that
+ * have not been completed are left as they were before the call.
+ *
+ * \note differently from the other functions, this can be called from a
+ * thread other than the one running the production. If tracing is enabled,
+ * it will wait for the production to end instead.
+ */
+void rp_manager_request_cancellation(rp_manager *manager);
+
 /**
  * Request to run the required analysis
  *
@@ -254,6 +307,12 @@ bool rp_manager_set_storage_credentials(rp_manager *manager,
  */
 uint64_t rp_manager_get_context_commit_index(rp_manager *manager);
 
+/**
+ * \return the estimate of the memory used by each global and by each
+ * container in memory, grouped by step, in bytes, as a YAML mapping.
+ */
+char * /*owning*/ rp_manager_get_memory_usage(const rp_manager *manager);
+
 /** \} */
 
 /**
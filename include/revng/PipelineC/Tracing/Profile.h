@@ -0,0 +1,58 @@
+#pragma once
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace revng::tracing {
+
+/// Time spent replaying the commands of a trace, possibly over multiple runs
+///
+/// Each command is accounted for both under its PipelineC function and, if it
+/// targets one or more steps, under the name of such steps.
+class TraceProfile {
+public:
+  struct Entry {
+    /// Number of calls, summed over all the runs
+    uint64_t Calls = 0;
+    /// Time spent in each run, in nanoseconds
+    std::vector<uint64_t> RunTimes;
+  };
+
+private:
+  std::map<std::string, Entry> Functions;
+  std::map<std::string, Entry> Steps;
+  /// Total time spent in each run, in nanoseconds
+  std::vector<uint64_t> RunTimes;
+
+public:
+  /// Start collecting the timings of a new run
+  void beginRun() { RunTimes.push_back(0); }
+
+  /// Account \p Nanoseconds spent in a call to \p Function targeting \p Step,
+  /// (or no step, if empty) in the current run
+  void record(llvm::StringRef Function,
+              llvm::StringRef Step,
+              uint64_t Nanoseconds);
+
+  size_t runs() const { return RunTimes.size(); }
+
+public:
+  /// Print a human-readable table, sorted by decreasing average time
+  void print(llvm::raw_ostream &Output) const;
+
+  /// Emit all the collected timings as JSON
+  void toJSON(llvm::raw_ostream &Output) const;
+
+private:
+  void recordIn(Entry &Target, uint64_t Nanoseconds);
+};
+
+} // namespace revng::tracing
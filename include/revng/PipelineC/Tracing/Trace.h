@@ -10,6 +10,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/YAMLTraits.h"
 
+#include "revng/PipelineC/Tracing/Profile.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 
@@ -127,6 +128,8 @@ public:
   // Instead of using a temporary directory, the first invocation will use
   // these directory instead and subsequent ones will abort
   std::string ResumeDirectory;
+  // If set, the time taken by each command is recorded here, as a new run
+  TraceProfile *Profile = nullptr;
 };
 
 struct Trace {
@@ -23,6 +23,15 @@ namespace pipeline {
 
 /// Extent this class to implement a transformation of the IR that needs to read
 /// the model and operates function wise.
+///
+/// \note runOnFunction is invoked on one function at a time, in the order of
+///       the requested targets, and each target is committed right after its
+///       function has been processed. This is what allows the pipeline to
+///       associate the model fields read by runOnFunction to the right target.
+///       Running multiple functions concurrently is not possible at this time:
+///       the read-tracking state is global to the model (see
+///       revng::AccessTracker) and all the functions share the same
+///       llvm::LLVMContext, which is not thread-safe.
 class FunctionPassImpl {
 protected:
   llvm::ModulePass *Pass;
@@ -29,8 +29,7 @@ getModelFromContext(const pipeline::Context &Context) {
   using Wrapper = ModelGlobal;
   const auto &Model = llvm::cantFail(Context
                                        .getGlobal<Wrapper>(ModelGlobalName));
-  Model->get().cacheReferences();
-  return Model->get();
+  return Model->getAndCacheReferences();
 }
 
 inline const TupleTree<model::Binary> &
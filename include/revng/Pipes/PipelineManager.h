@@ -12,6 +12,7 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/Pipeline/Context.h"
+#include "revng/Pipeline/IRModuleCache.h"
 #include "revng/Pipeline/Runner.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Storage/Path.h"
@@ -19,6 +20,18 @@
 
 namespace revng::pipes {
 
+/// The LLVMContext of a PipelineManager along with the IR files parsed in it
+///
+/// It can be shared, sequentially, by PipelineManagers analyzing different
+/// binaries in the same process, so that the QEMU helpers and the support
+/// modules are parsed only once.
+struct SharedLLVMContext {
+  llvm::LLVMContext Context;
+  pipeline::IRModuleCache ModuleCache;
+
+  SharedLLVMContext() : ModuleCache(Context) {}
+};
+
 /// This is a "God Object" that can be used when there will be exactly one
 /// Pipeline spawned by this process.
 ///
@@ -28,7 +41,8 @@ class PipelineManager {
 private:
   using Container = pipeline::ContainerSet::value_type;
   explicit PipelineManager(llvm::ArrayRef<std::string> EnablingFlags,
-                           std::unique_ptr<revng::StorageClient> &&Client);
+                           std::unique_ptr<revng::StorageClient> &&Client,
+                           std::shared_ptr<SharedLLVMContext> LLVM);
 
   std::unique_ptr<revng::StorageClient> StorageClient;
   revng::DirectoryPath ExecutionDirectory;
@@ -36,7 +50,7 @@ private:
   /// pointer that go from one to the other are stable, Since there a create
   /// method that returns a expected<PipelineManager>, this is the only way to
   /// ensure this is correct.
-  std::unique_ptr<llvm::LLVMContext> LLVMContext;
+  std::shared_ptr<SharedLLVMContext> LLVM;
   std::unique_ptr<pipeline::Context> PipelineContext;
   std::unique_ptr<pipeline::Loader> Loader;
   std::unique_ptr<pipeline::Runner> Runner;
@@ -45,6 +59,12 @@ private:
            const pipeline::TargetsList *>
     ContainerToEnumeration;
   std::string Description;
+  /// What the pipeline has been created from, to create forks of it
+  std::vector<std::string> PipelineContent;
+  std::vector<std::string> EnablingFlags;
+  /// Hash of the components, the pipelines and the enabling flags, the key of
+  /// the description in the pipeline description cache
+  std::string ConfigurationHash;
 
 public:
   PipelineManager(PipelineManager &&Other) = default;
@@ -60,24 +80,43 @@ public:
   /// Tries to set up a PipelineManager with the provided files pipelines,
   /// enabling flags loaded from the ExecutionDirectory. If anything is invalid
   /// a Error is returned instead.
+  ///
+  /// \param LLVM the LLVMContext to use, a new one if nullptr.
   static llvm::Expected<PipelineManager>
   create(llvm::ArrayRef<std::string> PipelinePath,
          llvm::ArrayRef<std::string> EnablingFlags,
-         llvm::StringRef ExecutionDirectory);
+         llvm::StringRef ExecutionDirectory,
+         std::shared_ptr<SharedLLVMContext> LLVM = nullptr);
 
   /// Exactly like create except the pipeline are not provided as paths but
   /// directly as yaml file buffer in memory.
   static llvm::Expected<PipelineManager>
   createFromMemory(llvm::ArrayRef<std::string> InMemoryPipeline,
                    llvm::ArrayRef<std::string> EnablingFlags,
-                   llvm::StringRef ExecutionDirectory);
+                   llvm::StringRef ExecutionDirectory,
+                   std::shared_ptr<SharedLLVMContext> LLVM = nullptr);
 
   // This works exactly like the one above, but uses the provided StorageClient
   // rather than parsing ExecutionDirectory
   static llvm::Expected<PipelineManager>
   createFromMemory(llvm::ArrayRef<std::string> InMemoryPipeline,
                    llvm::ArrayRef<std::string> EnablingFlags,
-                   std::unique_ptr<revng::StorageClient> &&Client);
+                   std::unique_ptr<revng::StorageClient> &&Client,
+                   std::shared_ptr<SharedLLVMContext> LLVM = nullptr);
+
+  /// Creates a new manager, running the same pipelines, whose state is the
+  /// current state of this one, e.g., to try out a change to the model and
+  /// compare the results
+  ///
+  /// The fork shares the containers with this manager copy-on-write: each of
+  /// the two copies a container only when it changes it, hence a fork costs
+  /// only what it changes. The globals are copied, since the pipes hold
+  /// references to them. The fork has no execution directory, its state is lost
+  /// once it's destroyed.
+  ///
+  /// \note the fork shares the LLVMContext with this manager: the two must not
+  ///       be used concurrently
+  llvm::Expected<PipelineManager> fork() const;
 
   /// Entirelly replaces the container indicated by the mapping with the file
   /// indicated by the mapping
@@ -102,6 +141,16 @@ public:
   /// the Execution directory if omitted.
   llvm::Error storeStepToDisk(llvm::StringRef StepName);
 
+  /// Switches to a mode for one-shot runs, which produce what they have been
+  /// asked for and exit: the reads of the globals are not tracked and the
+  /// containers that no step left to run reads from are dropped, rather than
+  /// kept around
+  ///
+  /// After this, targets are no longer invalidated when the globals change and
+  /// only the containers of the requested steps survive a run. Nothing is
+  /// stored, hence there must be no execution directory.
+  llvm::Error makeEphemeral();
+
   const pipeline::Step::AnalysisValueType &
   getAnalysis(const pipeline::AnalysisReference &Reference) const;
 
@@ -164,6 +213,10 @@ public:
   llvm::Error materializeTargets(const llvm::StringRef StepName,
                                  const pipeline::ContainerToTargetsMap &Map);
 
+  /// Produce the targets requested in several steps at once, so that each
+  /// step is run at most once
+  llvm::Error materializeTargets(const pipeline::Runner::State &Requests);
+
   llvm::Expected<std::unique_ptr<pipeline::ContainerBase>>
   produceTargets(const llvm::StringRef StepName,
                  const Container &TheContainer,
@@ -203,5 +256,7 @@ public:
 private:
   llvm::Error produceAllPossibleTargets(bool ExpandTargets);
   llvm::Error computeDescription();
+  bool loadCachedDescription();
+  void storeCachedDescription() const;
 };
 } // namespace revng::pipes
@@ -4,10 +4,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <ranges>
 #include <utility>
+#include <vector>
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/YAMLTraits.h"
 
 #include "revng/Pipeline/Container.h"
@@ -18,9 +23,12 @@
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Pipes/TypeKind.h"
+#include "revng/Storage/ReadableFile.h"
+#include "revng/Support/GzipStream.h"
 #include "revng/Support/GzipTarFile.h"
 #include "revng/Support/MetaAddress.h"
 #include "revng/Support/MetaAddress/YAMLTraits.h"
+#include "revng/Support/TaskScheduler.h"
 #include "revng/Support/YAMLTraits.h"
 #include "revng/TupleTree/TupleTree.h"
 
@@ -89,7 +97,10 @@ private:
 public:
   using KeyType = RankType::Type;
   using ValueType = std::string;
-  using MapType = typename std::map<KeyType, ValueType>;
+  /// Values are shared between a container and its clones, and copied only
+  /// when they are modified, see detach()
+  using SharedValueType = std::shared_ptr<ValueType>;
+  using MapType = typename std::map<KeyType, SharedValueType>;
   using Iterator = typename MapType::iterator;
   using ConstIterator = typename MapType::const_iterator;
 
@@ -98,7 +109,18 @@ public:
 
 private:
   using OffsetMap = ::detail::OffsetMap<KeyType>;
-  MapType Map;
+
+  /// An entry of an archive that has been loaded but not decompressed yet
+  struct LazyEntry {
+    std::shared_ptr<revng::ReadableFile> Archive;
+    ::detail::DataOffset Offset;
+  };
+  using LazyMapType = std::map<KeyType, LazyEntry>;
+
+  // The two maps have disjoint keys. An entry is moved from LazyMap to Map the
+  // first time it's accessed, which can happen through const methods too.
+  mutable MapType Map;
+  mutable LazyMapType LazyMap;
 
 public:
   inline static char ID = '0';
@@ -118,11 +140,31 @@ public:
   ~GenericStringMap() override = default;
 
 public:
-  void clear() override { Map.clear(); }
+  void clear() override {
+    Map.clear();
+    LazyMap.clear();
+  }
+
+  /// Values shared with other containers are split evenly among them, entries
+  /// which have not been decompressed yet count for their compressed size
+  uint64_t memoryUsage() const override {
+    uint64_t Result = 0;
+    for (const auto &[Key, Value] : Map)
+      Result += sizeof(Key) + Value->capacity() / Value.use_count();
+
+    for (const auto &[Key, Entry] : LazyMap) {
+      const auto &[UncompressedSize, Start, End] = Entry.Offset;
+      Result += sizeof(Key) + (End - Start + 1);
+    }
 
+    return Result;
+  }
+
+  /// The clone shares the values with this container: its cost does not
+  /// depend on the size of the values
   std::unique_ptr<pipeline::ContainerBase>
   cloneFiltered(const pipeline::TargetsList &Targets) const override {
-    auto Clone = std::make_unique<GenericStringMap>(*this);
+    auto Clone = std::make_unique<GenericStringMap>(this->name());
 
     // Returns true if Targets contains a Target that matches the Entry in the
     // Map
@@ -132,8 +174,14 @@ public:
       return Targets.contains(EntryTarget);
     };
 
-    // Drop all the entries in Map that are not in Targets
-    std::erase_if(Clone->Map, std::not_fn(EntryIsInTargets));
+    // Copy only the entries that are in Targets, the keys are sorted in both
+    // maps, so they can be appended at the end
+    for (const auto &Entry : Map)
+      if (EntryIsInTargets(Entry))
+        Clone->Map.emplace_hint(Clone->Map.end(), Entry);
+    for (const auto &Entry : LazyMap)
+      if (EntryIsInTargets(Entry))
+        Clone->LazyMap.emplace_hint(Clone->LazyMap.end(), Entry);
 
     return Clone;
   }
@@ -153,8 +201,16 @@ public:
   }
 
   pipeline::TargetsList enumerate() const override {
-    pipeline::TargetsList::List Result;
+    std::vector<KeyType> Keys;
+    Keys.reserve(Map.size() + LazyMap.size());
     for (const auto &[Key, Value] : Map)
+      Keys.push_back(Key);
+    for (const auto &[Key, Value] : LazyMap)
+      Keys.push_back(Key);
+    std::inplace_merge(Keys.begin(), Keys.begin() + Map.size(), Keys.end());
+
+    pipeline::TargetsList::List Result;
+    for (const KeyType &Key : Keys)
       Result.push_back({ keyToString(Key), *K });
 
     return Result;
@@ -168,10 +224,13 @@ public:
       revng_assert(&T.getKind() == K);
 
       std::string KeyString = T.getPathComponents().back();
-      auto It = Map.find(keyFromString(KeyString));
+      KeyType Key = keyFromString(KeyString);
+      auto It = Map.find(Key);
       if (It != End) {
         Map.erase(It);
         Changed = true;
+      } else if (LazyMap.erase(Key) != 0) {
+        Changed = true;
       }
     }
 
@@ -190,6 +249,21 @@ public:
   }
 
   llvm::Error store(const revng::FilePath &Path) const override {
+    // The entries that have not been decompressed are copied from the archive
+    // they have been loaded from, which is usually Path itself. Opening it for
+    // writing would truncate it before they are read: remove it instead, the
+    // file stays readable through the buffers already referring to it, here
+    // and in the clones of this container.
+    if (not LazyMap.empty()) {
+      auto MaybeExists = Path.exists();
+      if (not MaybeExists)
+        return MaybeExists.takeError();
+
+      if (MaybeExists.get())
+        if (auto Error = Path.remove())
+          return Error;
+    }
+
     auto MaybeWritableFile = Path.getWritableFile(ContentEncoding::Gzip);
     if (not MaybeWritableFile)
       return MaybeWritableFile.takeError();
@@ -214,6 +288,9 @@ public:
     return llvm::Error::success();
   }
 
+  /// If the index written by store is available, the archive is kept in memory
+  /// (memory-mapped, for local files) and each entry is decompressed only the
+  /// first time it's accessed.
   llvm::Error load(const revng::FilePath &Path) override {
     auto MaybeExists = Path.exists();
     if (not MaybeExists)
@@ -224,11 +301,36 @@ public:
       return llvm::Error::success();
     }
 
+    auto MaybeLoaded = loadLazily(Path);
+    if (not MaybeLoaded)
+      return MaybeLoaded.takeError();
+
+    if (MaybeLoaded.get())
+      return llvm::Error::success();
+
     auto MaybeBuffer = Path.getReadableFile();
     if (not MaybeBuffer)
       return MaybeBuffer.takeError();
 
-    GzipTarReader Reader(MaybeBuffer.get()->buffer());
+    // Without the index, rebuild it from the archive itself, so that entries
+    // are still decompressed only when needed
+    std::shared_ptr<revng::ReadableFile> Archive = std::move(*MaybeBuffer);
+    auto MaybeArchiveIndex = GzipTarIndex::create(Archive->buffer());
+    if (MaybeArchiveIndex) {
+      clear();
+      for (const IndexedArchiveEntry &Entry : MaybeArchiveIndex->entries()) {
+        llvm::StringRef Name = Entry.Filename;
+        revng_assert(Name.consume_back(ArchiveSuffix));
+        const OffsetDescriptor &Offsets = Entry.Offsets;
+        LazyMap[keyFromString(Name)] = {
+          Archive, { Entry.Size, Offsets.DataStart, Offsets.PaddingStart - 1 }
+        };
+      }
+      return llvm::Error::success();
+    }
+    llvm::consumeError(MaybeArchiveIndex.takeError());
+
+    GzipTarReader Reader(Archive->buffer());
     deserializeImpl(Reader);
     return llvm::Error::success();
   }
@@ -246,27 +348,56 @@ protected:
     // We first merge this->Map into Other.Map (which keeps Other's version if
     // present), and then we replace this->Map with the newly merged version of
     // Other.Map.
+    for (const auto &[Key, Value] : Other.Map)
+      this->LazyMap.erase(Key);
+    for (const auto &[Key, Value] : Other.LazyMap)
+      this->Map.erase(Key);
+
     Other.Map.merge(std::move(this->Map));
     this->Map = std::move(Other.Map);
+    Other.LazyMap.merge(std::move(this->LazyMap));
+    this->LazyMap = std::move(Other.LazyMap);
   }
 
 public:
   /// std::map-like methods
 
-  std::string &operator[](KeyType M) { return Map[M]; };
+  std::string &operator[](KeyType M) {
+    materialize(M);
+    SharedValueType &Value = Map[M];
+    if (Value == nullptr)
+      Value = std::make_shared<ValueType>();
+    return detach(Value);
+  };
 
-  std::string &at(KeyType M) { return Map.at(M); };
-  const std::string &at(KeyType M) const { return Map.at(M); };
+  std::string &at(KeyType M) {
+    materialize(M);
+    return detach(Map.at(M));
+  };
+  const std::string &at(KeyType M) const {
+    materialize(M);
+    return *Map.at(M);
+  };
 
 private:
+  /// \returns a reference to the value held by \p Value, after making a copy
+  ///          of it if it's shared with other containers
+  static std::string &detach(SharedValueType &Value) {
+    if (Value.use_count() > 1)
+      Value = std::make_shared<ValueType>(*Value);
+    return *Value;
+  }
+
+  // Non-const iterators can only be obtained through begin() and find(), which
+  // detach the values they point to
   using IteratedValue = std::pair<const KeyType &, std::string &>;
   inline constexpr static auto mapIt = [](auto &Iterated) -> IteratedValue {
-    return { Iterated.first, Iterated.second };
+    return { Iterated.first, *Iterated.second };
   };
 
   using IteratedCValue = std::pair<const KeyType &, const std::string &>;
   inline constexpr static auto mapCIt = [](auto &Iterated) -> IteratedCValue {
-    return { Iterated.first, Iterated.second };
+    return { Iterated.first, *Iterated.second };
   };
 
 public:
@@ -280,49 +411,220 @@ public:
   };
 
   auto insert_or_assign(KeyType Key, const std::string &Value) {
-    auto [Iterator, Success] = Map.insert_or_assign(Key, Value);
+    LazyMap.erase(Key);
+    auto Shared = std::make_shared<ValueType>(Value);
+    auto [Iterator, Success] = Map.insert_or_assign(Key, std::move(Shared));
     return std::pair{ revng::map_iterator(Iterator, mapIt), Success };
   };
   auto insert_or_assign(KeyType Key, std::string &&Value) {
-    auto [Iterator, Success] = Map.insert_or_assign(Key, std::move(Value));
+    LazyMap.erase(Key);
+    auto Shared = std::make_shared<ValueType>(std::move(Value));
+    auto [Iterator, Success] = Map.insert_or_assign(Key, std::move(Shared));
     return std::pair{ revng::map_iterator(Iterator, mapIt), Success };
   };
 
-  bool contains(KeyType Key) const { return Map.contains(Key); }
+  bool contains(KeyType Key) const {
+    return Map.contains(Key) or LazyMap.contains(Key);
+  }
 
   auto find(KeyType Key) {
-    return revng::map_iterator(Map.find(Key), this->mapIt);
+    materialize(Key);
+    auto It = Map.find(Key);
+    if (It != Map.end())
+      detach(It->second);
+    return revng::map_iterator(It, this->mapIt);
   }
 
   auto find(KeyType Key) const {
+    materialize(Key);
     return revng::map_iterator(Map.find(Key), this->mapCIt);
   }
 
-  auto begin() { return revng::map_iterator(Map.begin(), this->mapIt); }
+  auto begin() {
+    materializeAll();
+    for (auto &[Key, Value] : Map)
+      detach(Value);
+    return revng::map_iterator(Map.begin(), this->mapIt);
+  }
   auto end() { return revng::map_iterator(Map.end(), this->mapIt); }
 
-  auto begin() const { return revng::map_iterator(Map.begin(), this->mapCIt); }
+  auto begin() const {
+    materializeAll();
+    return revng::map_iterator(Map.begin(), this->mapCIt);
+  }
   auto end() const { return revng::map_iterator(Map.end(), this->mapCIt); }
 
 private:
+  static std::string decompress(const LazyEntry &Entry) {
+    llvm::StringRef Archive = Entry.Archive->buffer().getBuffer();
+    const auto &[UncompressedSize, Start, End] = Entry.Offset;
+
+    std::string Result;
+    Result.reserve(UncompressedSize);
+    llvm::raw_string_ostream OS(Result);
+    gzipDecompress(OS, { Archive.data() + Start, End - Start + 1 });
+    OS.flush();
+    revng_assert(Result.size() == UncompressedSize);
+
+    return Result;
+  }
+
+  void materialize(const KeyType &Key) const {
+    auto It = LazyMap.find(Key);
+    if (It == LazyMap.end())
+      return;
+
+    Map[Key] = std::make_shared<ValueType>(decompress(It->second));
+    LazyMap.erase(It);
+  }
+
+  void materializeAll() const {
+    if (LazyMap.size() <= 1) {
+      for (const auto &[Key, Entry] : LazyMap)
+        Map[Key] = std::make_shared<ValueType>(decompress(Entry));
+      LazyMap.clear();
+      return;
+    }
+
+    // Entries are independent gzip streams of a read-only archive, decompress
+    // them in parallel
+    std::vector<const LazyEntry *> Entries;
+    Entries.reserve(LazyMap.size());
+    for (const auto &[Key, Entry] : LazyMap)
+      Entries.push_back(&Entry);
+
+    std::vector<std::string> Decompressed(Entries.size());
+    {
+      llvm::ThreadPool Pool(llvm::hardware_concurrency());
+      for (size_t Index = 0; Index < Entries.size(); ++Index) {
+        Pool.async([&Entries, &Decompressed, Index]() {
+          Decompressed[Index] = decompress(*Entries[Index]);
+        });
+      }
+      Pool.wait();
+    }
+
+    size_t Index = 0;
+    for (const auto &[Key, Entry] : LazyMap)
+      Map[Key] = std::make_shared<ValueType>(std::move(Decompressed[Index++]));
+    LazyMap.clear();
+  }
+
+  /// Populate LazyMap using the index next to \p Path, returns false if the
+  /// index is not available or does not match the archive
+  llvm::Expected<bool> loadLazily(const revng::FilePath &Path) {
+    revng::FilePath IndexPath = Path.addExtension("idx");
+    auto MaybeIndexExists = IndexPath.exists();
+    if (not MaybeIndexExists)
+      return MaybeIndexExists.takeError();
+
+    if (not MaybeIndexExists.get())
+      return false;
+
+    auto MaybeIndex = IndexPath.getReadableFile();
+    if (not MaybeIndex)
+      return MaybeIndex.takeError();
+
+    llvm::StringRef Index = MaybeIndex.get()->buffer().getBuffer();
+    auto MaybeOffsets = ::fromString<OffsetMap>(Index);
+    if (not MaybeOffsets) {
+      llvm::consumeError(MaybeOffsets.takeError());
+      return false;
+    }
+
+    auto MaybeArchive = Path.getReadableFile();
+    if (not MaybeArchive)
+      return MaybeArchive.takeError();
+
+    std::shared_ptr<revng::ReadableFile> Archive = std::move(*MaybeArchive);
+    size_t ArchiveSize = Archive->buffer().getBufferSize();
+    for (const auto &[Key, Offset] : *MaybeOffsets)
+      if (Offset.Start > Offset.End or Offset.End >= ArchiveSize)
+        return false;
+
+    clear();
+    for (const auto &[Key, Offset] : *MaybeOffsets)
+      LazyMap[Key] = { Archive, Offset };
+
+    return true;
+  }
+
   void deserializeImpl(GzipTarReader &Reader) {
     for (ArchiveEntry &Entry : Reader.entries()) {
       llvm::StringRef Name = Entry.Filename;
       revng_assert(Name.consume_back(ArchiveSuffix));
       KeyType Key = keyFromString(Name);
-      std::string Data = std::string(Entry.Data.data(), Entry.Data.size());
-      Map[Key] = Data;
+      auto Data = std::make_shared<ValueType>(Entry.Data.data(),
+                                              Entry.Data.size());
+      LazyMap.erase(Key);
+      Map[Key] = std::move(Data);
     }
   }
 
   OffsetMap serializeWithOffsets(llvm::raw_ostream &OS) const {
     OffsetMap Result;
     revng::GzipTarWriter Writer(OS);
-    for (auto &[Key, Data] : Map) {
+
+    // Each entry is a stand-alone gzip stream, compress the ones in memory in
+    // parallel, a window at a time, and write them in order. This bounds the
+    // amount of compressed data held in memory.
+    constexpr size_t Window = 1024;
+    std::vector<std::pair<std::string, const std::string *>> ToPrepare;
+    std::vector<PreparedArchiveMember> Prepared;
+    size_t NextPrepared = 0;
+    auto PrepareIt = Map.begin();
+    auto PrepareWindow = [&]() {
+      ToPrepare.clear();
+      for (; PrepareIt != Map.end() and ToPrepare.size() < Window; ++PrepareIt)
+        ToPrepare.emplace_back(keyToString(PrepareIt->first) + ArchiveSuffix,
+                               PrepareIt->second.get());
+
+      Prepared.assign(ToPrepare.size(), {});
+      auto Indices = std::views::iota(size_t(0), ToPrepare.size());
+      revng::parallelForEach(Indices, [&](size_t Index) {
+        const auto &[Name, Data] = ToPrepare[Index];
+        Prepared[Index] = GzipTarWriter::prepare(Name,
+                                                 { Data->data(),
+                                                   Data->size() });
+      });
+      NextPrepared = 0;
+    };
+
+    // Entries that have not been decompressed are copied as they are
+    auto MapIt = Map.begin();
+    auto LazyIt = LazyMap.begin();
+    while (MapIt != Map.end() or LazyIt != LazyMap.end()) {
+      bool TakeLazy = MapIt == Map.end()
+                      or (LazyIt != LazyMap.end()
+                          and LazyIt->first < MapIt->first);
+      const KeyType &Key = TakeLazy ? LazyIt->first : MapIt->first;
       std::string Name = keyToString(Key) + ArchiveSuffix;
-      OffsetDescriptor Offsets = Writer.append(Name,
-                                               { Data.data(), Data.size() });
-      Result[Key] = { .UncompressedSize = Data.size(),
+
+      OffsetDescriptor Offsets;
+      size_t Size = 0;
+      if (TakeLazy) {
+        const auto &[UncompressedSize, Start, End] = LazyIt->second.Offset;
+        llvm::StringRef Archive = LazyIt->second.Archive->buffer().getBuffer();
+        Size = UncompressedSize;
+        Offsets = Writer.appendCompressed(Name,
+                                          { Archive.data() + Start,
+                                            End - Start + 1 },
+                                          Size);
+        ++LazyIt;
+      } else {
+        if (NextPrepared == Prepared.size())
+          PrepareWindow();
+
+        Size = MapIt->second->size();
+        Offsets = Writer.appendPrepared(Name, Prepared[NextPrepared]);
+
+        // Release the memory as soon as possible
+        Prepared[NextPrepared] = {};
+        ++NextPrepared;
+        ++MapIt;
+      }
+
+      Result[Key] = { .UncompressedSize = Size,
                       .Start = Offsets.DataStart,
                       .End = Offsets.PaddingStart - 1 };
     }
@@ -19,6 +19,7 @@ private:
   InputPathOpt ModelOverride;
   llvm::cl::list<std::string> EnablingFlags;
   llvm::cl::opt<std::string> ExecutionDirectory;
+  llvm::cl::opt<bool> Ephemeral;
   llvm::cl::alias A1;
   llvm::cl::alias A2;
 
@@ -38,6 +39,12 @@ public:
                                       "and to which it will be store after "
                                       "everything else"),
                        llvm::cl::cat(Category)),
+    Ephemeral("ephemeral",
+              llvm::cl::desc("One-shot run: do not track what depends on "
+                             "what and drop the containers as soon as "
+                             "they have been consumed. Incompatible with "
+                             "--resume."),
+              llvm::cl::cat(Category)),
     A1("l",
        llvm::cl::desc("Alias for --load"),
        llvm::cl::aliasopt(llvm::LoadOpt),
@@ -55,9 +62,19 @@ public:
   }
 
   llvm::Expected<revng::pipes::PipelineManager> makeManager() {
-    auto Manager = revng::pipes::PipelineManager::create(InputPipeline,
-                                                         EnablingFlags,
-                                                         ExecutionDirectory);
+    return makeManager(ExecutionDirectory, nullptr);
+  }
+
+  /// Like makeManager(), but resuming from \p ExecutionDirectory rather than
+  /// from --resume, in the provided LLVMContext
+  llvm::Expected<revng::pipes::PipelineManager>
+  makeManager(llvm::StringRef ExecutionDirectory,
+              std::shared_ptr<SharedLLVMContext> LLVM) {
+    using revng::pipes::PipelineManager;
+    auto Manager = PipelineManager::create(InputPipeline,
+                                           EnablingFlags,
+                                           ExecutionDirectory,
+                                           std::move(LLVM));
     if (not Manager)
       return Manager;
 
@@ -65,6 +82,10 @@ public:
       if (auto Error = overrideModel(*ModelOverride, *Manager))
         return Error;
 
+    if (Ephemeral)
+      if (auto Error = Manager->makeEphemeral())
+        return Error;
+
     return Manager;
   }
 };
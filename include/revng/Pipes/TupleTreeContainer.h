@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstdint>
 #include <iterator>
 #include <optional>
 #include <utility>
@@ -16,6 +17,7 @@
 #include "revng/Pipeline/Kind.h"
 #include "revng/Pipeline/Target.h"
 #include "revng/Support/Assert.h"
+#include "revng/TupleTree/MemoryUsage.h"
 #include "revng/TupleTree/TupleTree.h"
 
 namespace revng::pipes {
@@ -170,6 +172,10 @@ public:
 
   void clear() override { Content = TupleTree<T>(); }
 
+  uint64_t memoryUsage() const override {
+    return Content ? ::memoryUsage(*Content) : 0;
+  }
+
   llvm::Error extractOne(llvm::raw_ostream &OS,
                          const pipeline::Target &Target) const override {
     if (enumerate().contains(Target))
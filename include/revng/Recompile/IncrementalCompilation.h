@@ -0,0 +1,35 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <functional>
+#include <memory>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+
+using TargetMachineFactory = std::function<
+  std::unique_ptr<llvm::TargetMachine>()>;
+
+/// Compile \p M into a relocatable object at \p OutputPath, one function at a
+/// time, reusing the objects in \p CacheDirectory for the functions whose IR
+/// did not change since they were last compiled
+///
+/// Each function is extracted in a module of its own, along with the
+/// declarations it uses, while all the global variables end up in a single
+/// additional module. Each module is identified by the hash of its bitcode and
+/// of the code generation configuration: on a cache miss it's compiled (on up
+/// to \p Jobs threads) and the object is stored in \p CacheDirectory. Finally,
+/// all the objects are merged with a relocatable link.
+///
+/// \note \p M is not changed: the extraction operates on a copy, where symbols
+///       with local linkage are turned into hidden ones, so that they can be
+///       referenced across objects.
+void compileIncrementally(const llvm::Module &M,
+                          const TargetMachineFactory &CreateTargetMachine,
+                          unsigned Jobs,
+                          llvm::StringRef CacheDirectory,
+                          llvm::StringRef OutputPath);
@@ -46,11 +46,15 @@ public:
     return Result;
   }
 
+  bool combineValuesInPlace(Set &Target, const Set &Value) const {
+    bool Changed = Value.test(Target);
+    Target |= Value;
+    return Changed;
+  }
+
   bool isLessOrEqual(const Set &LHS, const Set &RHS) const {
-    // RHS must contain or be equal to LHS
-    Set Intersection = RHS;
-    Intersection &= LHS;
-    return Intersection == LHS;
+    // RHS must contain or be equal to LHS, i.e., LHS - RHS must be empty
+    return not LHS.test(RHS);
   }
 
   RegisterSet applyTransferFunction(const BlockNode *Block,
@@ -32,6 +32,11 @@ struct RegisterWriters {
     Read &= Other.Read;
     return *this;
   }
+
+  /// \returns true if this is a subset of (or equal to) \p Other
+  bool isSubsetOf(const RegisterWriters &Other) const {
+    return not Reaching.test(Other.Reaching) and not Read.test(Other.Read);
+  }
 };
 
 /// One entry per register
@@ -119,13 +124,21 @@ public:
     return Result;
   }
 
+  bool combineValuesInPlace(WritersSet &Target, const WritersSet &Value) const {
+    bool Changed = false;
+    for (const auto &[TargetEntry, ValueEntry] : zip(Target, Value)) {
+      if (not ValueEntry.isSubsetOf(TargetEntry)) {
+        TargetEntry |= ValueEntry;
+        Changed = true;
+      }
+    }
+    return Changed;
+  }
+
   bool isLessOrEqual(const WritersSet &LHS, const WritersSet &RHS) const {
-    for (const auto &[LHSEntry, RHSEntry] : zip(LHS, RHS)) {
-      auto Intersection = LHSEntry;
-      Intersection &= RHSEntry;
-      if (Intersection != LHSEntry)
+    for (const auto &[LHSEntry, RHSEntry] : zip(LHS, RHS))
+      if (not LHSEntry.isSubsetOf(RHSEntry))
         return false;
-    }
 
     return true;
   }
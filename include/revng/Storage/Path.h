@@ -33,6 +33,8 @@ public:
   }
 
   bool isValid() const { return Client != nullptr; }
+
+  bool operator==(const PathBase &Other) const = default;
 };
 
 class FilePath : public PathBase {
@@ -129,6 +131,26 @@ public:
     return MaybeResult.get() == PathType::Directory;
   }
 
+  /// Check which of the files named \p Filenames exist in this directory,
+  /// querying the storage for all of them at once
+  llvm::Expected<std::vector<bool>>
+  filesExist(llvm::ArrayRef<std::string> Filenames) const {
+    std::vector<std::string> Paths;
+    for (const std::string &Filename : Filenames)
+      Paths.push_back(joinPath(Client->getStyle(), SubPath, Filename));
+
+    auto MaybeTypes = Client->types(Paths);
+    if (not MaybeTypes)
+      return MaybeTypes.takeError();
+
+    std::vector<bool> Result;
+    for (PathType Type : *MaybeTypes) {
+      revng_assert(Type != PathType::Directory);
+      Result.push_back(Type == PathType::File);
+    }
+    return Result;
+  }
+
   llvm::Error create() const { return Client->createDirectory(SubPath); }
 };
 
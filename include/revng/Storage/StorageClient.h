@@ -5,7 +5,10 @@
 //
 
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
@@ -50,6 +53,11 @@ enum class PathType {
 /// * Once all writes are done, a final ::commit must be
 ///   issued, otherwise all changes might be lost
 ///
+/// Backends might only schedule the write in WritableFile::commit and perform
+/// it in the background (currently, S3 does), in which case errors are
+/// reported by the next operation that depends on it, or, at the latest, by
+/// ::commit, which waits for all the pending writes.
+///
 /// Example:
 /// \code{.cpp}
 /// llvm::Error serialize() {
@@ -90,6 +98,21 @@ public:
   }
 
   virtual llvm::Expected<PathType> type(llvm::StringRef Path) = 0;
+
+  /// Batched version of ::type, backends where each query is a round trip can
+  /// override it to perform them all at once
+  virtual llvm::Expected<std::vector<PathType>>
+  types(llvm::ArrayRef<std::string> Paths) {
+    std::vector<PathType> Result;
+    for (const std::string &Path : Paths) {
+      auto MaybeType = type(Path);
+      if (not MaybeType)
+        return MaybeType.takeError();
+      Result.push_back(*MaybeType);
+    }
+    return Result;
+  }
+
   virtual llvm::Error createDirectory(llvm::StringRef Path) = 0;
   virtual llvm::Error remove(llvm::StringRef Path) = 0;
   virtual llvm::sys::path::Style getStyle() const = 0;
@@ -38,7 +38,12 @@ public:
     Counter &= ~0x1;
     IsTracking = true;
   }
-  void access() { Counter |= (0x1 & IsTracking); }
+  void access() {
+    // Don't write when not tracking, so that an untracked object can be read
+    // from multiple threads
+    if (IsTracking)
+      Counter |= 0x1;
+  }
   void push() {
     bool HasLeadingZeroes = llvm::countLeadingZeros(Counter) != 0;
     revng_assert(HasLeadingZeroes, "More than 8 pushes have been performed");
@@ -49,6 +54,7 @@ public:
   bool peak() const { return Counter & 0x1; }
   bool isSet() const { return Counter; }
   void stopTracking() { IsTracking = false; }
+  bool isTracking() const { return IsTracking; }
 };
 
 } // namespace revng
@@ -8,3 +8,6 @@
 
 // Options used by many users
 extern llvm::cl::opt<bool> DebugNames;
+
+/// Number of threads to use, 0 means as many as the available cores
+extern llvm::cl::opt<unsigned> Jobs;
@@ -0,0 +1,52 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <chrono>
+
+namespace revng {
+
+/// Sets a wall-clock deadline for the current thread for the lifetime of this
+/// object
+///
+/// Long-running algorithms can poll DeadlineScope::expired() and, once the
+/// deadline has passed, stop refining their result and return what they have
+/// so far. Scopes nest: the deadline of an inner scope never extends the one of
+/// the outer scope.
+class DeadlineScope {
+public:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  inline static thread_local Clock::time_point
+    Current = Clock::time_point::max();
+
+private:
+  Clock::time_point Previous;
+
+public:
+  /// \param Budget the time available from now on, zero means no deadline
+  explicit DeadlineScope(Clock::duration Budget) : Previous(Current) {
+    if (Budget != Clock::duration::zero())
+      Current = std::min(Current, Clock::now() + Budget);
+  }
+
+  ~DeadlineScope() { Current = Previous; }
+
+  DeadlineScope(const DeadlineScope &) = delete;
+  DeadlineScope &operator=(const DeadlineScope &) = delete;
+
+public:
+  /// \return the deadline of the innermost scope of the current thread,
+  ///         Clock::time_point::max() if there's none
+  static Clock::time_point current() { return Current; }
+
+  static bool expired() {
+    return Current != Clock::time_point::max() and Clock::now() >= Current;
+  }
+};
+
+} // namespace revng
@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
 #include <sstream>
 
 #include "llvm/ADT/StringRef.h"
@@ -33,15 +34,29 @@ struct LogTerminator {
 };
 #define DoLog (LogTerminator{ __FILE__, __LINE__ })
 
+/// Whether loggers are enabled by default, see REVNG_DISABLE_DEBUG_LOGGERS
+///
+/// When the flag is defined, Logger<> is Logger<false>: its isEnabled() is a
+/// compile-time false and everything streamed into it is discarded without
+/// being evaluated, except for side effects in the arguments themselves (use
+/// revng_log to avoid evaluating those too). Loggers that must always be
+/// available, such as ReleaseLog, have to be declared as Logger<true>.
+#ifdef REVNG_DISABLE_DEBUG_LOGGERS
+inline constexpr bool DebugLoggersEnabled = false;
+#else
+inline constexpr bool DebugLoggersEnabled = true;
+#endif
+
 /// Logger that self-registers itself, can be disabled, has a name and follows
 /// the global indentation level
 ///
 /// The typical usage of this class is to be a static global variable in a
 /// translation unit.
-template<bool StaticEnabled = true>
+template<bool StaticEnabled = DebugLoggersEnabled>
 class Logger {
 private:
-  static unsigned IndentLevel;
+  /// The indentation level, one for each thread
+  static thread_local unsigned IndentLevel;
 
 public:
   Logger(llvm::StringRef Name) : Name(Name), Enabled(false) { init(); }
@@ -81,22 +96,30 @@ public:
   friend void writeToLog(Logger<X> &This, const T Other, LowPrio Ignore);
 
   std::unique_ptr<llvm::raw_ostream> getAsLLVMStream() {
-    if (Enabled)
-      return std::make_unique<llvm::raw_os_ostream>(Buffer);
+    if (isEnabled())
+      return std::make_unique<llvm::raw_os_ostream>(buffer());
     return std::make_unique<llvm::raw_null_ostream>();
   }
 
 private:
   void init();
 
+  /// \return the line being composed by the current thread
+  ///
+  /// Each thread has its own buffer, so that lines written concurrently to the
+  /// same logger do not interleave.
+  std::stringstream &buffer() {
+    thread_local std::map<const Logger *, std::stringstream> Buffers;
+    return Buffers[this];
+  }
+
 private:
   llvm::StringRef Name;
-  std::stringstream Buffer;
   bool Enabled;
 };
 
 /// Indent all loggers within the scope of this object
-template<bool StaticEnabled = true>
+template<bool StaticEnabled = DebugLoggersEnabled>
 class LoggerIndent {
 public:
   LoggerIndent(Logger<StaticEnabled> &L) : L(L) { L.indent(); }
@@ -111,7 +134,7 @@ private:
 /// You can create an instance of this object associated to a Logger, so that
 /// when the object goes out of scope (typically, on return), the emit method
 /// will be invoked.
-template<bool StaticEnabled = true>
+template<bool StaticEnabled = DebugLoggersEnabled>
 class LogOnReturn {
 public:
   LogOnReturn(Logger<StaticEnabled> &L) : L(L) {}
@@ -137,8 +160,10 @@ private:
 /// For an example see the next specialization.
 template<bool X, typename T, typename LowPrio>
 inline void writeToLog(Logger<X> &This, const T Other, LowPrio) {
-  if (This.isEnabled())
-    This.Buffer << Other;
+  if constexpr (X) {
+    if (This.isEnabled())
+      This.buffer() << Other;
+  }
 }
 
 /// Specialization of writeToLog to emit a message
@@ -205,7 +230,7 @@ private:
 
 extern Logger<> NRALog;
 extern Logger<> PassesLog;
-extern Logger<> ReleaseLog;
-extern Logger<> VerifyLog;
+extern Logger<true> ReleaseLog;
+extern Logger<true> VerifyLog;
 
 void writeToFile(llvm::StringRef What, llvm::StringRef Path) debug_function;
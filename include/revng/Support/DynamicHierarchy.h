@@ -112,6 +112,12 @@ public:
     return Start;
   }
 
+  /// \returns one past the largest id() among this node and its descendants
+  entry_t endId() const {
+    init();
+    return End;
+  }
+
   llvm::StringRef name() const { return Name; }
 
 public:
@@ -0,0 +1,62 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/FileSystem.h"
+
+/// What has been parsed from files, meant to be shared by the whole process
+///
+/// Entries are keyed on the absolute path of the file, and the file is parsed
+/// again if its modification time changes.
+template<typename ValueT>
+class FileParseCache {
+private:
+  using ValuePointer = std::shared_ptr<const ValueT>;
+  using Entry = std::pair<llvm::sys::TimePoint<>, ValuePointer>;
+
+private:
+  std::mutex Mutex;
+  llvm::StringMap<Entry> Entries;
+
+public:
+  /// \returns the result of \p Parse on \p Path, or nullptr if \p Path cannot
+  ///          be accessed
+  template<typename CallableT>
+  ValuePointer get(llvm::StringRef Path, CallableT &&Parse) {
+    using namespace llvm::sys;
+
+    fs::file_status Status;
+    if (fs::status(Path, Status) or not fs::exists(Status))
+      return nullptr;
+    TimePoint<> ModificationTime = Status.getLastModificationTime();
+
+    llvm::SmallString<128> AbsolutePath(Path);
+    if (fs::make_absolute(AbsolutePath))
+      return nullptr;
+
+    {
+      std::lock_guard Lock(Mutex);
+      auto It = Entries.find(AbsolutePath);
+      if (It != Entries.end() and It->second.first == ModificationTime)
+        return It->second.second;
+    }
+
+    // Parse without holding the lock, multiple threads might race to parse the
+    // same file, but they will produce the same result
+    auto Result = std::make_shared<const ValueT>(Parse(Path));
+
+    std::lock_guard Lock(Mutex);
+    Entries[AbsolutePath] = { ModificationTime, Result };
+    return Result;
+  }
+};
@@ -7,6 +7,7 @@
 #include <set>
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/GlobalObject.h"
 #include "llvm/IR/GlobalVariable.h"
@@ -49,10 +50,19 @@ public:
   bool operator==(const TagsSet &Other) const = default;
 
 public:
-  static TagsSet from(const Taggable auto *V) {
-    return from(V->getMetadata(TagsMetadataName));
-  }
-  static TagsSet from(const llvm::MDNode *MD);
+  static TagsSet from(const Taggable auto *V) { return from(bitsOf(V)); }
+  static TagsSet from(const llvm::MDNode *MD) { return from(bitsOf(MD)); }
+
+  /// \returns the tags of \p V as a bit vector indexed by Tag::id()
+  ///
+  /// The bit vectors are cached by metadata node. Uniqued metadata nodes never
+  /// change, and rewriting the tags of \p V attaches a different node, so
+  /// there's nothing to invalidate: each query costs the lookup of the
+  /// metadata attachment and of the node in the cache.
+  ///
+  /// \note the result is only valid until the next call.
+  static const llvm::SmallBitVector &bitsOf(const llvm::GlobalObject *V);
+  static const llvm::SmallBitVector &bitsOf(const llvm::MDNode *MD);
 
 public:
   auto begin() const { return Tags.begin(); }
@@ -76,6 +86,7 @@ public:
 
 private:
   llvm::MDNode *getMetadata(llvm::LLVMContext &C) const;
+  static TagsSet from(const llvm::SmallBitVector &Bits);
 };
 
 /// Represents a tag that can be attached to a
@@ -96,11 +107,14 @@ public:
 
 public:
   bool isTagOf(const Taggable auto *I) const {
-    return TagsSet::from(I).contains(*this);
+    // Any tag in the subtree rooted in this one
+    return anyIn(TagsSet::bitsOf(I), id(), endId());
   }
 
   bool isExactTagOf(const Taggable auto *I) const {
-    return TagsSet::from(I).containsExactly(*this);
+    // This tag, but none of its descendants
+    const llvm::SmallBitVector &Bits = TagsSet::bitsOf(I);
+    return Bits.test(id()) and not anyIn(Bits, id() + 1, endId());
   }
 
   auto functions(llvm::Module *M) const {
@@ -150,6 +164,15 @@ public:
     auto Filter = [this](const GlobalVariable &G) { return isExactTagOf(&G); };
     return make_filter_range(M->globals(), Filter);
   }
+
+private:
+  /// \returns true if any of the bits in [\p Begin, \p End) is set
+  static bool anyIn(const llvm::SmallBitVector &Bits,
+                    entry_t Begin,
+                    entry_t End) {
+    int Next = Begin == 0 ? Bits.find_first() : Bits.find_next(Begin - 1);
+    return Next != -1 and static_cast<entry_t>(Next) < End;
+  }
 };
 
 inline bool TagsSet::containsExactly(const Tag &Target) const {
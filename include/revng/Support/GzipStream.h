@@ -11,10 +11,13 @@ void gzipCompress(llvm::raw_ostream &OS,
                   llvm::ArrayRef<uint8_t> Buffer,
                   int CompressionLevel = 3);
 
-inline void gzipCompress(llvm::raw_ostream &OS, llvm::ArrayRef<char> Buffer) {
+inline void gzipCompress(llvm::raw_ostream &OS,
+                         llvm::ArrayRef<char> Buffer,
+                         int CompressionLevel = 3) {
   return gzipCompress(OS,
                       { reinterpret_cast<const uint8_t *>(Buffer.data()),
-                        Buffer.size() });
+                        Buffer.size() },
+                      CompressionLevel);
 }
 
 void gzipDecompress(llvm::raw_ostream &OS, llvm::ArrayRef<uint8_t> Buffer);
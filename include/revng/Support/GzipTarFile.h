@@ -4,6 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -29,6 +33,15 @@ struct OffsetDescriptor {
   size_t paddingSize() { return End - PaddingStart; }
 };
 
+/// A file compressed by GzipTarWriter::prepare, with its header and padding,
+/// ready to be appended to an archive
+struct PreparedArchiveMember {
+  llvm::SmallVector<char, 0> Bytes;
+  /// Offsets of the data and of the padding within Bytes
+  size_t DataStart = 0;
+  size_t PaddingStart = 0;
+};
+
 /// Class that allows writing a '.tar.gz' file conforming to the PAX archive
 /// format. The archive is created with these additional properties:
 /// * The header of each file is a stand-alone gzip stream
@@ -68,6 +81,27 @@ public:
   GzipTarWriter &operator=(GzipTarWriter &&Other) = default;
 
   OffsetDescriptor append(llvm::StringRef Name, llvm::ArrayRef<char> Data);
+
+  /// Same as append, but \p Compressed is a stand-alone gzip stream holding
+  /// the \p Size bytes of the file, which is copied as-is into the archive.
+  OffsetDescriptor appendCompressed(llvm::StringRef Name,
+                                    llvm::ArrayRef<char> Compressed,
+                                    size_t Size);
+
+  /// Compress \p Data the same way append does, so that appendCompressed
+  /// produces the same archive. It does not touch the archive, hence it can be
+  /// used to compress multiple files concurrently.
+  static llvm::SmallVector<char, 0> compress(llvm::ArrayRef<char> Data);
+
+  /// Compress \p Data, the header and the padding of the file \p Name. Like
+  /// compress, it does not touch the archive. Appending the result through
+  /// appendPrepared produces the same archive as append.
+  static PreparedArchiveMember prepare(llvm::StringRef Name,
+                                       llvm::ArrayRef<char> Data);
+
+  OffsetDescriptor appendPrepared(llvm::StringRef Name,
+                                  const PreparedArchiveMember &Member);
+
   void close();
 };
 
@@ -95,4 +129,50 @@ public:
   cppcoro::generator<ArchiveEntry> entries();
 };
 
+/// An entry of an archive that has been located, but not decompressed, by
+/// GzipTarIndex
+struct IndexedArchiveEntry {
+  std::string Filename;
+  /// Size of the file once decompressed
+  size_t Size = 0;
+  /// Position of the gzip streams of this entry in the archive
+  OffsetDescriptor Offsets;
+};
+
+/// Random-access reader for archives produced by GzipTarWriter
+///
+/// Since each header, file and padding is a stand-alone gzip stream, the
+/// archive is indexed up front, decompressing the headers and only skimming
+/// through the file contents to find where they end, without keeping them.
+/// Then each file can be decompressed on request, straight from the (possibly
+/// memory-mapped) archive.
+///
+/// The archive is never modified, therefore read can be invoked concurrently
+/// from multiple threads.
+class GzipTarIndex {
+private:
+  llvm::ArrayRef<char> Archive;
+  std::vector<IndexedArchiveEntry> Entries;
+
+private:
+  GzipTarIndex(llvm::ArrayRef<char> Archive) : Archive(Archive) {}
+
+public:
+  /// Index \p Archive, fails if it has not been produced by GzipTarWriter.
+  /// \p Archive must outlive the returned object.
+  static llvm::Expected<GzipTarIndex> create(llvm::ArrayRef<char> Archive);
+  static llvm::Expected<GzipTarIndex> create(const llvm::MemoryBuffer &Buffer) {
+    return create({ Buffer.getBufferStart(), Buffer.getBufferSize() });
+  }
+
+public:
+  llvm::ArrayRef<IndexedArchiveEntry> entries() const { return Entries; }
+
+  /// Decompress the contents of \p Entry
+  llvm::SmallVector<char, 0> read(const IndexedArchiveEntry &Entry) const;
+
+  /// Decompress all the entries, in parallel, in archive order
+  std::vector<ArchiveEntry> readAll() const;
+};
+
 } // namespace revng
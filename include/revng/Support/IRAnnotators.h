@@ -9,11 +9,22 @@
 namespace llvm {
 class Module;
 class AssemblyAnnotationWriter;
+class raw_ostream;
 } // namespace llvm
 
+/// Attach to each instruction a debug location pointing to its line in the
+/// textual IR of \p M, annotated by \p InnerAAW, which is printed to \p Output
 void createSelfReferencingDebugInfo(llvm::Module *M,
                                     llvm::StringRef SourcePath,
-                                    llvm::AssemblyAnnotationWriter *InnerAAW);
+                                    llvm::AssemblyAnnotationWriter *InnerAAW,
+                                    llvm::raw_ostream &Output);
+
+/// Attach to each instruction a debug location with a distinct line number,
+/// assigned in order through a traversal of \p M, without printing it
+///
+/// Each basic block label and each instruction takes a line, so lines grow
+/// like they do in the textual IR, but they do not match it.
+void createSequentialDebugInfo(llvm::Module *M, llvm::StringRef SourcePath);
 void createPTCDebugInfo(llvm::Module *M, llvm::StringRef SourcePath);
 void createOriginalAssemblyDebugInfo(llvm::Module *M,
                                      llvm::StringRef SourcePath);
@@ -83,6 +83,10 @@ constexpr const char *FunctionEntryMDName = "revng.function.entry";
 constexpr const char *JTReasonMDName = "revng.jt.reasons";
 constexpr const char *ControlFlowGraphMDName = "revng.function.metadata";
 
+/// Name of the table of the function dispatcher, if it has been emitted as a
+/// table instead of a switch
+constexpr const char *FunctionDispatcherTableName = "function_dispatcher_table";
+
 template<typename T>
 inline bool contains(T Range, typename T::value_type V) {
   return std::find(std::begin(Range), std::end(Range), V) != std::end(Range);
@@ -500,9 +504,9 @@ inline llvm::BasicBlock *blockByName(llvm::Function *F, const char *Name) {
 }
 
 /// Specialization of writeToLog for llvm::Value-derived types
-template<typename T>
+template<bool X, typename T>
   requires std::derived_from<llvm::Value, std::remove_const_t<T>>
-inline void writeToLog(Logger<true> &This, T *I, int) {
+inline void writeToLog(Logger<X> &This, T *I, int) {
   if (I != nullptr)
     This << getName(I);
   else
@@ -1236,6 +1240,57 @@ inline bool replaceAllUsesInFunctionWith(llvm::Function *F,
   return Changed;
 }
 
+/// Replace, in \p F, all the uses of the global variables in \p Replacements
+/// with the corresponding value, also when used through a cast constant
+/// expression.
+///
+/// Unlike calling replaceAllUsesInFunctionWith for each global, this only goes
+/// through the instructions of \p F once and never visits the uses of the
+/// globals in other functions.
+///
+/// \return true if it changes something, false otherwise.
+template<typename MapType>
+inline bool replaceGlobalsInFunction(llvm::Function &F,
+                                     const MapType &Replacements) {
+  using namespace llvm;
+
+  bool Changed = false;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      for (Use &U : I.operands()) {
+        if (auto *Global = dyn_cast<GlobalVariable>(U.get())) {
+          auto It = Replacements.find(Global);
+          if (It != Replacements.end()) {
+            U.set(It->second);
+            Changed = true;
+          }
+        } else if (auto *CE = dyn_cast<ConstantExpr>(U.get())) {
+          if (not CE->isCast())
+            continue;
+
+          auto *Global = dyn_cast<GlobalVariable>(CE->getOperand(0));
+          if (Global == nullptr)
+            continue;
+
+          auto It = Replacements.find(Global);
+          if (It == Replacements.end())
+            continue;
+
+          // The constant expression might be used elsewhere, materialize it as
+          // an instruction using the replacement instead
+          Instruction *Cast = CE->getAsInstruction();
+          Cast->replaceUsesOfWith(Global, It->second);
+          Cast->insertBefore(&I);
+          U.set(Cast);
+          Changed = true;
+        }
+      }
+    }
+  }
+
+  return Changed;
+}
+
 /// Checks if \p I is a marker
 ///
 /// A marker a function call to an empty function acting as meta-information,
@@ -0,0 +1,82 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+
+#include "revng/Support/MetaAddress.h"
+
+namespace llvm {
+class raw_ostream;
+} // namespace llvm
+
+/// Where `-record-asm` and `-record-ptc` store their annotations, instead of
+/// attaching them to the IR, if not empty
+extern llvm::cl::opt<std::string> AnnotationsPath;
+
+/// Textual annotations of the instructions of the input program, e.g., their
+/// disassembly, kept out of the IR
+///
+/// Attaching this information to the IR as metadata multiplies the size of the
+/// root module, and of each of its clones. Here, instead, all the text is
+/// stored once, in a single buffer, indexed by the address of the instruction
+/// it describes. Consumers join it with the IR through the calls to newpc.
+class InstructionAnnotations {
+public:
+  enum Kind : uint8_t {
+    Assembly,
+    PTC,
+    KindsCount
+  };
+
+private:
+  struct Entry {
+    MetaAddress Address;
+    uint32_t Offset = 0;
+    uint32_t Size = 0;
+  };
+
+private:
+  std::array<std::vector<Entry>, KindsCount> Entries;
+  std::string Text;
+  bool Sorted = true;
+
+public:
+  bool empty() const {
+    for (const std::vector<Entry> &KindEntries : Entries)
+      if (not KindEntries.empty())
+        return false;
+    return true;
+  }
+
+  /// Record \p NewText as the annotation of kind \p K of \p Address
+  ///
+  /// If an address is recorded more than once, e.g., because an instruction
+  /// has been translated again, the first annotation wins.
+  void record(Kind K, const MetaAddress &Address, llvm::StringRef NewText);
+
+  /// \return the annotation of kind \p K of \p Address, an empty string if
+  ///         there's none
+  llvm::StringRef get(Kind K, const MetaAddress &Address) const;
+
+public:
+  void serialize(llvm::raw_ostream &OS);
+  static llvm::Expected<InstructionAnnotations>
+  deserialize(llvm::StringRef Buffer);
+
+  llvm::Error save(llvm::StringRef Path);
+  static llvm::Expected<InstructionAnnotations> load(llvm::StringRef Path);
+
+private:
+  /// Sort the entries by address, dropping the duplicated ones
+  void sort();
+};
@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <limits>
+
+#include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 
@@ -472,6 +475,15 @@ public:
   /// Create an invalid MetaAddress
   static constexpr MetaAddress invalid() { return MetaAddress(); }
 
+  /// Create a MetaAddress different from all the valid and invalid ones, to
+  /// be used as a special key, e.g., in a DenseMap
+  static constexpr MetaAddress sentinel(uint64_t Address) {
+    MetaAddress Result;
+    Result.Epoch = std::numeric_limits<uint32_t>::max();
+    Result.Address = Address;
+    return Result;
+  }
+
   /// Create a MetaAddress from a pointer to \p Arch code
   static constexpr MetaAddress fromPC(llvm::Triple::ArchType Arch,
                                       uint64_t PC,
@@ -578,9 +590,29 @@ public:
   }
 
 public:
+  /// \returns all the fields packed in 128 bits, laid out so that comparing
+  ///          the packed values orders MetaAddresses by epoch, address space,
+  ///          type and address, in this order
+  constexpr unsigned __int128 packed() const {
+    uint64_t High = (static_cast<uint64_t>(Epoch) << 32)
+                    | (static_cast<uint64_t>(AddressSpace) << 16) | Type;
+    return (static_cast<unsigned __int128>(High) << 64) | Address;
+  }
+
+  /// A hash of all the fields, mixing the two halves of packed()
+  constexpr uint64_t hash() const {
+    unsigned __int128 Packed = packed();
+    uint64_t High = static_cast<uint64_t>(Packed >> 64);
+    uint64_t Low = static_cast<uint64_t>(Packed);
+    uint64_t Result = (High * 0x9E3779B97F4A7C15) ^ Low;
+    Result = (Result ^ (Result >> 33)) * 0xFF51AFD7ED558CCD;
+    return Result ^ (Result >> 33);
+  }
+
+  /// \note comparisons are performed on packed(), which requires no branches
   /// @{
   constexpr bool operator==(const MetaAddress &Other) const {
-    return tie() == Other.tie();
+    return packed() == Other.packed();
   }
 
   constexpr bool operator!=(const MetaAddress &Other) const {
@@ -588,16 +620,16 @@ public:
   }
 
   constexpr bool operator<(const MetaAddress &Other) const {
-    return tie() < Other.tie();
+    return packed() < Other.packed();
   }
   constexpr bool operator<=(const MetaAddress &Other) const {
-    return tie() <= Other.tie();
+    return packed() <= Other.packed();
   }
   constexpr bool operator>(const MetaAddress &Other) const {
-    return tie() > Other.tie();
+    return packed() > Other.packed();
   }
   constexpr bool operator>=(const MetaAddress &Other) const {
-    return tie() >= Other.tie();
+    return packed() >= Other.packed();
   }
 
   /// @}
@@ -941,14 +973,6 @@ public:
   std::string toString(std::optional<llvm::Triple::ArchType> Arch = {}) const;
   static MetaAddress fromString(llvm::StringRef Text);
 
-private:
-  using Tied = std::tuple<const uint32_t &,
-                          const uint16_t &,
-                          const uint16_t &,
-                          const uint64_t &>;
-  constexpr Tied tie() const {
-    return std::tie(Epoch, AddressSpace, Type, Address);
-  }
 };
 
 static_assert(sizeof(MetaAddress) <= 128 / 8,
@@ -973,10 +997,26 @@ template<>
 class hash<MetaAddress> {
 public:
   uint64_t operator()(const MetaAddress &Address) const {
-    return hash_combine(Address.arch(),
-                        Address.address(),
-                        Address.epoch(),
-                        Address.addressSpace());
+    return Address.hash();
   }
 };
 } // namespace std
+
+template<>
+struct llvm::DenseMapInfo<MetaAddress> {
+  static constexpr MetaAddress getEmptyKey() {
+    return MetaAddress::sentinel(std::numeric_limits<uint64_t>::max());
+  }
+
+  static constexpr MetaAddress getTombstoneKey() {
+    return MetaAddress::sentinel(std::numeric_limits<uint64_t>::max() - 1);
+  }
+
+  static unsigned getHashValue(const MetaAddress &Address) {
+    return Address.hash();
+  }
+
+  static bool isEqual(const MetaAddress &LHS, const MetaAddress &RHS) {
+    return LHS == RHS;
+  }
+};
@@ -5,6 +5,7 @@
 //
 
 #include <cmath>
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -131,3 +132,17 @@ public:
             unsigned Indent,
             const ModuleStatistics *Old = nullptr) const;
 };
+
+/// A summary of the size of a module, cheap enough to be taken before and after
+/// each pipe, to track how the IR grows along the pipeline
+struct ModuleSize {
+  uint64_t FunctionsCount = 0;
+  uint64_t BasicBlocksCount = 0;
+  uint64_t InstructionsCount = 0;
+
+  /// The distinct metadata nodes reachable from the module, e.g., debug info
+  uint64_t MetadataNodesCount = 0;
+
+  /// \note declarations are not counted as functions
+  static ModuleSize measure(const llvm::Module &M);
+};
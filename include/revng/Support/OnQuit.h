@@ -6,12 +6,15 @@
 
 #include <cstddef>
 #include <functional>
+#include <mutex>
 #include <vector>
 
 #include "llvm/Support/ManagedStatic.h"
 
 class OnQuitRegistry {
 private:
+  /// Recursive, so that a signal interrupting add doesn't deadlock in quit
+  std::recursive_mutex Mutex;
   std::vector<std::function<void()>> Registry;
 
 public:
@@ -20,6 +23,7 @@ public:
   /// Registers an object for having its onQuit method called upon program
   /// termination
   void add(std::function<void()> &&Handler) {
+    std::lock_guard Lock(Mutex);
     Registry.push_back(std::move(Handler));
   }
 
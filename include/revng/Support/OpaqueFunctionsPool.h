@@ -5,12 +5,16 @@
 //
 
 #include <map>
+#include <mutex>
+#include <string>
+#include <utility>
 
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/ModRef.h"
 
 #include "revng/ADT/Concepts.h"
@@ -22,12 +26,37 @@ template<typename T>
 concept PointerToLLVMTypeOrDerived = std::derived_from<std::remove_pointer_t<T>,
                                                        llvm::Type>;
 
+namespace detail {
+
+template<typename KeyT>
+using OpaqueFunctionsIndex = std::map<KeyT, llvm::WeakVH>;
+
+/// Return the index shared by all the pools of \p M for \p Purpose
+///
+/// The index outlives the pools, so that a pass can find the functions created
+/// by the passes that ran before it without scanning the module again. Its
+/// entries are weak handles: the functions that have been erased in the
+/// meantime are simply ignored.
+template<typename KeyT>
+inline OpaqueFunctionsIndex<KeyT> &
+sharedOpaqueFunctionsIndex(const llvm::Module *M, llvm::StringRef Purpose) {
+  using Key = std::pair<const llvm::Module *, std::string>;
+  static std::mutex Lock;
+  static std::map<Key, OpaqueFunctionsIndex<KeyT>> Registry;
+
+  std::lock_guard Guard(Lock);
+  return Registry[{ M, Purpose.str() }];
+}
+
+} // namespace detail
+
 template<typename KeyT>
 class OpaqueFunctionsPool {
 private:
   llvm::Module *M;
   const bool PurgeOnDestruction;
   std::map<KeyT, llvm::Function *> Pool;
+  detail::OpaqueFunctionsIndex<KeyT> *Shared = nullptr;
   llvm::AttributeList AttributeSets;
   llvm::MemoryEffects MemoryEffects = llvm::MemoryEffects::none();
   FunctionTags::TagsSet Tags;
@@ -36,6 +65,17 @@ public:
   OpaqueFunctionsPool(llvm::Module *M, bool PurgeOnDestruction) :
     M(M), PurgeOnDestruction(PurgeOnDestruction) {}
 
+  /// Create a pool sharing its functions with all the other pools of \p M
+  /// created for the same \p Purpose, even if they are no longer alive
+  ///
+  /// \note all the functions relevant to \p Purpose need to be created through
+  ///       such pools, since after the first initialization the initialize*
+  ///       methods no longer scan the module.
+  OpaqueFunctionsPool(llvm::Module *M, const char *Purpose) :
+    M(M),
+    PurgeOnDestruction(false),
+    Shared(&detail::sharedOpaqueFunctionsIndex<KeyT>(M, Purpose)) {}
+
   ~OpaqueFunctionsPool() {
     if (PurgeOnDestruction) {
       for (auto &[Key, F] : Pool) {
@@ -68,6 +108,51 @@ public:
       Pool[Key] = F;
     else
       revng_assert(It->second == F);
+
+    if (Shared != nullptr)
+      (*Shared)[Key] = F;
+  }
+
+private:
+  /// Return the function for \p Key in the shared index, if any
+  llvm::Function *lookupShared(const KeyT &Key) {
+    if (Shared == nullptr)
+      return nullptr;
+
+    auto It = Shared->find(Key);
+    if (It == Shared->end())
+      return nullptr;
+
+    llvm::Value *V = It->second;
+    auto *F = llvm::cast_or_null<llvm::Function>(V);
+    if (F == nullptr or F->getParent() != M) {
+      Shared->erase(It);
+      return nullptr;
+    }
+
+    return F;
+  }
+
+  /// Populate the pool from the shared index
+  ///
+  /// \returns false if the shared index has nothing to offer, in which case
+  ///          the module has to be scanned.
+  bool initializeFromShared() {
+    if (Shared == nullptr)
+      return false;
+
+    for (auto It = Shared->begin(); It != Shared->end();) {
+      llvm::Value *V = It->second;
+      auto *F = llvm::cast_or_null<llvm::Function>(V);
+      if (F == nullptr or F->getParent() != M) {
+        It = Shared->erase(It);
+      } else {
+        Pool[It->first] = F;
+        ++It;
+      }
+    }
+
+    return not Pool.empty();
   }
 
 public:
@@ -79,12 +164,16 @@ public:
     auto It = Pool.find(Key);
     if (It != Pool.end()) {
       F = It->second;
+    } else if ((F = lookupShared(Key)) != nullptr) {
+      Pool.insert(It, { Key, F });
     } else {
       F = Function::Create(FT, GlobalValue::ExternalLinkage, Name, M);
       F->setAttributes(AttributeSets);
       F->setMemoryEffects(MemoryEffects);
       Tags.set(F);
       Pool.insert(It, { Key, F });
+      if (Shared != nullptr)
+        (*Shared)[Key] = F;
     }
 
     // Ensure the function we're returning is as expected
@@ -110,6 +199,9 @@ public:
     requires std::derived_from<std::remove_pointer_t<KeyT>, llvm::Type>
   {
     using TypeLike = std::remove_pointer_t<KeyT>;
+    if (initializeFromShared())
+      return;
+
     for (llvm::Function &F : TheTag.functions(M)) {
       auto *RetType = F.getFunctionType()->getReturnType();
       if (auto *KeyType = dyn_cast<TypeLike>(RetType))
@@ -123,6 +215,9 @@ public:
     requires std::derived_from<std::remove_pointer_t<KeyT>, llvm::Type>
   {
     using TypeLike = std::remove_pointer_t<KeyT>;
+    if (initializeFromShared())
+      return;
+
     for (llvm::Function &F : TheTag.functions(M)) {
       auto ArgType = F.getFunctionType()->getParamType(ArgNo);
       if (auto *KeyType = dyn_cast<TypeLike>(ArgType))
@@ -135,6 +230,9 @@ public:
   void initializeFromName(const FunctionTags::Tag &TheTag)
     requires std::is_same_v<KeyT, std::string>
   {
+    if (initializeFromShared())
+      return;
+
     for (llvm::Function &F : TheTag.functions(M))
       record(F.getName().str(), &F);
   }
@@ -21,7 +21,10 @@ private:
 
 public:
   OpaqueRegisterUser(llvm::Module *M) :
-    M(M), Clobberers(M, false), Writers(M, false), Readers(M, false) {
+    M(M),
+    Clobberers(M, "clobberers"),
+    Writers(M, "writers"),
+    Readers(M, "readers") {
     using namespace llvm;
 
     Clobberers.setMemoryEffects(MemoryEffects::readOnly());
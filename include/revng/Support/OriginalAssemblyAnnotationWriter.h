@@ -7,12 +7,21 @@
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/LLVMContext.h"
 
+class InstructionAnnotations;
+
 /// AssemblyAnnotationWriter decorating the output original assembly/PTC
+///
+/// The annotations are read from the metadata attached to each instruction
+/// and, if available, from \p Annotations, in which case they are printed
+/// at the call to newpc of the corresponding input instruction.
 class OriginalAssemblyAnnotationWriter : public llvm::AssemblyAnnotationWriter {
 public:
-  OriginalAssemblyAnnotationWriter(llvm::LLVMContext &Context) :
+  OriginalAssemblyAnnotationWriter(llvm::LLVMContext &Context,
+                                   const InstructionAnnotations *Annotations =
+                                     nullptr) :
     OriginalInstrMDKind(Context.getMDKindID("oi")),
-    PTCInstrMDKind(Context.getMDKindID("pi")) {}
+    PTCInstrMDKind(Context.getMDKindID("pi")),
+    Annotations(Annotations) {}
 
   ~OriginalAssemblyAnnotationWriter() override = default;
 
@@ -23,4 +32,5 @@ public:
 private:
   unsigned OriginalInstrMDKind;
   unsigned PTCInstrMDKind;
+  const InstructionAnnotations *Annotations = nullptr;
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <type_traits>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include "revng/Support/TaskScheduler.h"
+
+/// Compute \p Function on each element of \p Inputs, using all the available
+/// jobs (see revng::TaskGroup)
+///
+/// The inputs are split in contiguous chunks, each of which is processed in
+/// order by a single worker. The results are returned in the same order as the
+/// inputs. If there are too few inputs to be worth it, everything runs on the
+/// current thread.
+///
+/// \note \p Function must be safe to run concurrently, in particular it must
+///       not change the IR or create new constants.
+template<typename InputT, typename CallableT>
+auto parallelMap(llvm::ArrayRef<InputT> Inputs, CallableT &&Function) {
+  using ResultT = std::invoke_result_t<CallableT &, const InputT &>;
+  std::vector<ResultT> Result;
+  Result.reserve(Inputs.size());
+
+  unsigned Threads = revng::jobs();
+  if (Threads <= 1 or Inputs.size() < 2 * Threads) {
+    for (const InputT &Input : Inputs)
+      Result.push_back(Function(Input));
+    return Result;
+  }
+
+  size_t PerChunk = Inputs.size() / (4 * Threads) + 1;
+  std::vector<std::vector<ResultT>> Chunks((Inputs.size() + PerChunk - 1)
+                                           / PerChunk);
+  {
+    revng::TaskGroup Group;
+    for (size_t I = 0; I < Chunks.size(); ++I) {
+      Group.spawn([&, I]() {
+        auto Chunk = Inputs.slice(I * PerChunk).take_front(PerChunk);
+        Chunks[I].reserve(Chunk.size());
+        for (const InputT &Input : Chunk)
+          Chunks[I].push_back(Function(Input));
+      });
+    }
+    Group.wait();
+  }
+
+  for (std::vector<ResultT> &Chunk : Chunks)
+    for (ResultT &Element : Chunk)
+      Result.push_back(std::move(Element));
+
+  return Result;
+}
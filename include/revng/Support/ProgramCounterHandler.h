@@ -119,6 +119,49 @@ public:
     setPC(Builder, Address);
   }
 
+  /// Like setPC, but doesn't store epoch, address space and type if they are
+  /// the same as in \p Known, the PC that has been stored last, if valid
+  void setPC(llvm::IRBuilderBase &Builder,
+             MetaAddress NewPC,
+             const MetaAddress &Known) const {
+    revng_assert(NewPC.isValid() and NewPC.isCode());
+    store(Builder, AddressCSV, NewPC.address());
+    if (not Known.isValid() or Known.epoch() != NewPC.epoch())
+      store(Builder, EpochCSV, NewPC.epoch());
+    if (not Known.isValid() or Known.addressSpace() != NewPC.addressSpace())
+      store(Builder, AddressSpaceCSV, NewPC.addressSpace());
+    if (not Known.isValid() or Known.type() != NewPC.type())
+      store(Builder, TypeCSV, NewPC.type());
+  }
+
+  /// Before each call to newpc in \p F, store in the PC the MetaAddress
+  /// returned by \p GetPC for such call
+  ///
+  /// Within a basic block, epoch, address space and type are stored only if
+  /// they differ from the previous newpc and nothing wrote them in between,
+  /// which is the common case.
+  template<typename CallableType>
+  void expandNewPCs(llvm::Function &F, CallableType &&GetPC) const {
+    using namespace llvm;
+    IRBuilder<> Builder(F.getContext());
+    for (BasicBlock &BB : F) {
+      MetaAddress Known = MetaAddress::invalid();
+      for (Instruction &I : BB) {
+        if (auto *Store = dyn_cast<StoreInst>(&I)) {
+          Value *Pointer = Store->getPointerOperand();
+          if (Pointer == EpochCSV or Pointer == AddressSpaceCSV
+              or Pointer == TypeCSV)
+            Known = MetaAddress::invalid();
+        } else if (auto *Call = getCallTo(&I, "newpc")) {
+          MetaAddress NewPC = GetPC(Call);
+          Builder.SetInsertPoint(Call);
+          setPC(Builder, NewPC, Known);
+          Known = NewPC;
+        }
+      }
+    }
+  }
+
   void setCurrentPCPlainMetaAddress(llvm::IRBuilderBase &Builder) const;
   void setLastPCPlainMetaAddress(llvm::IRBuilderBase &Builder,
                                  const MetaAddress &Address) const;
@@ -4,18 +4,39 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 
+namespace llvm {
+class ThreadPool;
+} // namespace llvm
+
 class ProgramRunner {
+public:
+  struct Result {
+    int ExitCode = -1;
+
+    /// The output of the program, only if it has been requested to be captured
+    std::string Stdout;
+    std::string Stderr;
+  };
+
 private:
   llvm::SmallVector<std::string, 64> Paths;
 
+  /// Bounds the number of programs running concurrently through runAsync
+  std::unique_ptr<llvm::ThreadPool> Pool;
+  std::mutex PoolMutex;
+
 public:
   ProgramRunner();
+  ~ProgramRunner();
 
   /// Returns true if the program could be found.
   bool isProgramAvailable(llvm::StringRef ProgramName);
@@ -23,6 +44,23 @@ public:
   /// returns the exit code of the program.
   [[nodiscard]] int run(llvm::StringRef ProgramName,
                         llvm::ArrayRef<std::string> Args);
+
+  /// Runs the program in the background, along with at most
+  /// `-program-runner-jobs` other programs.
+  ///
+  /// \param CaptureOutput whether to collect stdout and stderr of the program
+  ///        in the result, instead of inheriting them.
+  ///
+  /// \returns a future that becomes ready when the program has terminated.
+  [[nodiscard]] std::shared_future<Result>
+  runAsync(llvm::StringRef ProgramName,
+           llvm::ArrayRef<std::string> Args,
+           bool CaptureOutput = false);
+
+private:
+  Result runImpl(llvm::StringRef ProgramName,
+                 llvm::ArrayRef<std::string> Args,
+                 bool CaptureOutput);
 };
 
 extern ProgramRunner Runner;
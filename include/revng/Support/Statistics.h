@@ -4,11 +4,19 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "revng/Support/Debug.h"
 #include "revng/Support/OnQuit.h"
@@ -29,25 +37,132 @@ inline size_t digitsCount(T Value) {
   return Digits;
 }
 
+/// Base class of the statistics that are registered by name
+///
+/// A named statistic is dumped at exit if -statistics is passed and, while the
+/// program is running, its current value can be obtained at any time (e.g.,
+/// from PipelineC) through serializeStatistics.
+class NamedStatistic {
+protected:
+  std::string Name;
+
+public:
+  NamedStatistic(llvm::StringRef Name);
+  virtual ~NamedStatistic();
+
+  NamedStatistic(const NamedStatistic &) = delete;
+  NamedStatistic &operator=(const NamedStatistic &) = delete;
+
+public:
+  llvm::StringRef name() const { return Name; }
+
+  /// Print the current value as the body of a YAML mapping, indented by two
+  /// spaces
+  virtual void serialize(llvm::raw_ostream &OS) const = 0;
+};
+
+/// \returns a YAML mapping from the name of each registered statistic to its
+///          current value
+std::string serializeStatistics();
+
+namespace detail {
+
+/// \returns a new slot in the thread-local tables of shards
+size_t allocateStatisticSlot();
+
+/// \returns the table of the shards of the current thread, indexed by slot
+std::vector<void *> &localStatisticShards();
+
+/// A collection of per-thread instances (shards) of ShardT
+///
+/// Each thread updates its own shard only, which it finds through a
+/// thread-local table, so that updates on different threads never contend.
+/// Shards are owned by this object, so that they outlive their thread, and
+/// they are only aggregated upon request.
+template<typename ShardT>
+class ShardedStatistic {
+private:
+  size_t Slot = allocateStatisticSlot();
+  mutable std::mutex Mutex;
+  std::vector<std::unique_ptr<ShardT>> Shards;
+
+public:
+  ShardT &local() {
+    std::vector<void *> &Table = localStatisticShards();
+    if (Table.size() <= Slot)
+      Table.resize(Slot + 1, nullptr);
+
+    if (Table[Slot] == nullptr) {
+      std::lock_guard Lock(Mutex);
+      Table[Slot] = Shards.emplace_back(std::make_unique<ShardT>()).get();
+    }
+
+    return *static_cast<ShardT *>(Table[Slot]);
+  }
+
+  template<typename CallableType>
+  void forEach(CallableType &&Callable) const {
+    std::lock_guard Lock(Mutex);
+    for (const std::unique_ptr<ShardT> &Shard : Shards)
+      Callable(*Shard);
+  }
+};
+
+} // namespace detail
+
 template<typename K, typename T = uint64_t>
-class CounterMap {
+class CounterMap : public NamedStatistic {
 private:
   using Container = std::map<K, T>;
-  Container Map;
-  std::string Name;
+
+  /// The counters of a single thread, the mutex is contended only while the
+  /// counters are being aggregated
+  struct Shard {
+    std::mutex Mutex;
+    Container Map;
+  };
+
+  mutable detail::ShardedStatistic<Shard> Shards;
 
 public:
-  CounterMap(const llvm::StringRef Name) : Name(Name.str()) {
+  CounterMap(const llvm::StringRef Name) : NamedStatistic(Name) {
     OnQuit->add([this] {
       if (Statistics)
         dump();
     });
   }
 
-  void push(K Key) { Map[Key]++; }
-  void push(K Key, T Value) { Map[Key] += Value; }
-  void clear(K Key) { Map.erase(Key); }
-  void clear() { Map.clear(); }
+  void push(K Key) { push(Key, 1); }
+  void push(K Key, T Value) {
+    Shard &Local = Shards.local();
+    std::lock_guard Lock(Local.Mutex);
+    Local.Map[Key] += Value;
+  }
+
+  void clear(K Key) {
+    Shards.forEach([&Key](Shard &S) {
+      std::lock_guard Lock(S.Mutex);
+      S.Map.erase(Key);
+    });
+  }
+
+  void clear() {
+    Shards.forEach([](Shard &S) {
+      std::lock_guard Lock(S.Mutex);
+      S.Map.clear();
+    });
+  }
+
+  /// \returns the sum of the counters of all the threads
+  Container aggregate() const {
+    Container Result;
+    Shards.forEach([&Result](Shard &S) {
+      std::lock_guard Lock(S.Mutex);
+      for (const auto &[Key, Value] : S.Map)
+        Result[Key] += Value;
+    });
+    return Result;
+  }
 
   template<typename O>
   void dump(size_t Max, O &Output) {
@@ -55,6 +170,7 @@ public:
       Output << Name << ":\n";
 
     using Pair = std::pair<K, T>;
+    Container Map = aggregate();
     std::vector<Pair> Sorted;
     Sorted.reserve(Map.size());
     std::copy(Map.begin(), Map.end(), std::back_inserter(Sorted));
@@ -83,6 +199,11 @@ public:
 
   void dump(size_t Max) { dump(Max, dbg); }
   void dump() { dump(MaxCounterMapDump, dbg); }
+
+  void serialize(llvm::raw_ostream &OS) const override {
+    for (const auto &[Key, Value] : aggregate())
+      OS << "  \"" << llvm::yaml::escape(Key) << "\": " << Value << "\n";
+  }
 };
 
 /// Collect mean and variance about a certain event.
@@ -93,67 +214,121 @@ public:
 ///
 /// If a name is provided, the results will be registered for printing at
 /// program termination.
-class RunningStatistics {
+///
+/// push can be called from multiple threads at the same time: each thread
+/// accumulates in a shard of its own, without locking, and the shards are
+/// merged when the results are requested.
+class RunningStatistics : public NamedStatistic {
 private:
-  std::string Name;
-  int N = 0;
-  double OldM = 0.0;
-  double NewM = 0.0;
-  double OldS = 0.0;
-  double NewS = 0.0;
-  double Sum = 0.0;
+  /// The values recorded by a single thread. Only the owning thread writes it,
+  /// other threads can read it while aggregating, hence the atomics.
+  struct Shard {
+    std::atomic<uint64_t> N = 0;
+    std::atomic<double> Mean = 0.0;
+    std::atomic<double> M2 = 0.0;
+    std::atomic<double> Sum = 0.0;
+  };
+
+  struct Aggregate {
+    uint64_t N = 0;
+    double Mean = 0.0;
+    double M2 = 0.0;
+    double Sum = 0.0;
+  };
+
+  mutable detail::ShardedStatistic<Shard> Shards;
 
 public:
-  RunningStatistics() = default;
+  RunningStatistics() : NamedStatistic("") {}
 
-  RunningStatistics(const llvm::StringRef Name) : Name(Name.str()) {
+  RunningStatistics(const llvm::StringRef Name) : NamedStatistic(Name) {
     OnQuit->add([this] {
       if (Statistics)
         dump();
     });
   }
 
-  void clear() { N = 0; }
+  void clear() {
+    Shards.forEach([](Shard &S) {
+      S.N.store(0, std::memory_order_relaxed);
+      S.Mean.store(0.0, std::memory_order_relaxed);
+      S.M2.store(0.0, std::memory_order_relaxed);
+      S.Sum.store(0.0, std::memory_order_relaxed);
+    });
+  }
 
   // TODO: make a template
   /// Record a new value
   void push(double X) {
-    N++;
-    Sum += X;
+    constexpr auto Relaxed = std::memory_order_relaxed;
+    Shard &Local = Shards.local();
+    uint64_t N = Local.N.load(Relaxed) + 1;
+    double OldMean = Local.Mean.load(Relaxed);
 
     // See Knuth TAOCP vol 2, 3rd edition, page 232
-    if (N == 1) {
-      OldM = NewM = X;
-      OldS = 0.0;
-    } else {
-      NewM = OldM + (X - OldM) / N;
-      NewS = OldS + (X - OldM) * (X - NewM);
-
-      // Set up for next iteration
-      OldM = NewM;
-      OldS = NewS;
-    }
+    double NewMean = OldMean + (X - OldMean) / N;
+    Local.M2.store(Local.M2.load(Relaxed) + (X - OldMean) * (X - NewMean),
+                   Relaxed);
+    Local.Mean.store(NewMean, Relaxed);
+    Local.Sum.store(Local.Sum.load(Relaxed) + X, Relaxed);
+    Local.N.store(N, Relaxed);
   }
 
   /// \return the total number of recorded values.
-  int size() const { return N; }
+  int size() const { return aggregate().N; }
 
-  double mean() const { return (N > 0) ? NewM : 0.0; }
+  double mean() const { return aggregate().Mean; }
 
-  double variance() const { return ((N > 1) ? NewS / (N - 1) : 0.0); }
+  double variance() const { return variance(aggregate()); }
 
   double standardDeviation() const { return sqrt(variance()); }
 
-  double sum() const { return Sum; }
+  double sum() const { return aggregate().Sum; }
 
   template<typename T>
   void dump(T &Output) {
+    Aggregate Total = aggregate();
     Output << Name << ": "
-           << "{ s: " << sum() << " "
-           << "n: " << size() << " "
-           << "u: " << mean() << " "
-           << "o: " << variance() << " }\n";
+           << "{ s: " << Total.Sum << " "
+           << "n: " << Total.N << " "
+           << "u: " << Total.Mean << " "
+           << "o: " << variance(Total) << " }\n";
   }
 
   void dump() { dump(dbg); }
+
+  void serialize(llvm::raw_ostream &OS) const override {
+    Aggregate Total = aggregate();
+    OS << "  Sum: " << Total.Sum << "\n"
+       << "  Count: " << Total.N << "\n"
+       << "  Mean: " << Total.Mean << "\n"
+       << "  Variance: " << variance(Total) << "\n";
+  }
+
+private:
+  static double variance(const Aggregate &Total) {
+    return Total.N > 1 ? Total.M2 / (Total.N - 1) : 0.0;
+  }
+
+  /// Merge the shards, see Chan et al., "Updating Formulae and a Pairwise
+  /// Algorithm for Computing Sample Variances"
+  Aggregate aggregate() const {
+    constexpr auto Relaxed = std::memory_order_relaxed;
+    Aggregate Result;
+    Shards.forEach([&Result](const Shard &S) {
+      uint64_t N = S.N.load(Relaxed);
+      if (N == 0)
+        return;
+
+      double Mean = S.Mean.load(Relaxed);
+      uint64_t Total = Result.N + N;
+      double Delta = Mean - Result.Mean;
+      Result.Mean += Delta * N / Total;
+      Result.M2 += S.M2.load(Relaxed)
+                   + Delta * Delta * Result.N * N / Total;
+      Result.Sum += S.Sum.load(Relaxed);
+      Result.N = Total;
+    });
+    return Result;
+  }
 };
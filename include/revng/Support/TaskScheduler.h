@@ -0,0 +1,104 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ranges>
+
+namespace revng {
+
+namespace detail {
+
+/// The tasks of a TaskGroup, shared with the workers of the scheduler
+///
+/// Workers might still hold a reference to the state after the TaskGroup has
+/// been destroyed, hence it's reference counted.
+struct TaskGroupState {
+  std::mutex Mutex;
+  std::condition_variable Done;
+  std::deque<std::function<void()>> Queue;
+  /// Number of tasks that have been spawned and are not over yet
+  size_t Pending = 0;
+
+  /// Run one of the queued tasks, if any, on the current thread
+  ///
+  /// \return false if there was nothing to run
+  bool runOne();
+};
+
+} // namespace detail
+
+/// \return the number of threads tasks run on, as configured by `-j`,
+///         including the thread waiting on a TaskGroup
+unsigned jobs();
+
+/// A set of tasks running on the process-wide pool of worker threads
+///
+/// The pool has `jobs() - 1` workers, created the first time a task is
+/// spawned. A thread waiting for a group doesn't block: it runs the tasks of
+/// such group that no worker picked up yet. As a consequence, tasks can spawn
+/// and wait for nested groups without deadlocking, even if all the workers are
+/// busy, and with `-j 1` everything runs on the waiting thread, in order.
+///
+/// \note the destructor waits for all the tasks to complete.
+class TaskGroup {
+private:
+  std::shared_ptr<detail::TaskGroupState> State;
+
+public:
+  TaskGroup() : State(std::make_shared<detail::TaskGroupState>()) {}
+  ~TaskGroup() { wait(); }
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+public:
+  void spawn(std::function<void()> Task);
+
+  /// Run the queued tasks on the current thread and then wait for the ones
+  /// running on the workers
+  void wait();
+};
+
+/// Call \p Callable on each element of \p Range, using all the available jobs
+///
+/// The elements are split in contiguous chunks, each of which is processed in
+/// order by a single task. \p Range can be, e.g., a TargetsList or a
+/// SortedVector.
+///
+/// \note \p Callable must be safe to run concurrently, in particular it must
+///       not change the IR or create new constants.
+template<std::ranges::random_access_range RangeT, typename CallableT>
+void parallelForEach(RangeT &&Range, CallableT &&Callable) {
+  auto Begin = std::ranges::begin(Range);
+  auto Size = std::ranges::distance(Range);
+
+  unsigned Threads = jobs();
+  if (Threads <= 1 or Size < 2 * static_cast<decltype(Size)>(Threads)) {
+    for (auto &&Element : Range)
+      Callable(Element);
+    return;
+  }
+
+  decltype(Size) PerChunk = Size / (4 * Threads) + 1;
+  TaskGroup Group;
+  for (decltype(Size) Start = 0; Start < Size; Start += PerChunk) {
+    auto ChunkBegin = Begin + Start;
+    auto ChunkEnd = Begin + std::min(Size, Start + PerChunk);
+    Group.spawn([ChunkBegin, ChunkEnd, &Callable]() {
+      for (auto It = ChunkBegin; It != ChunkEnd; ++It)
+        Callable(*It);
+    });
+  }
+  Group.wait();
+}
+
+} // namespace revng
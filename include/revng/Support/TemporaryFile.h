@@ -10,6 +10,11 @@
 
 #include "revng/Support/Debug.h"
 
+/// A file that is removed when this object is destroyed, or on a signal
+///
+/// If possible, temporary files are created on a memory-backed file system,
+/// see `-in-memory-temporary-directory`, otherwise in the system temporary
+/// directory.
 class TemporaryFile {
 private:
   llvm::SmallString<32> Path;
@@ -20,16 +25,14 @@ private:
 
 public:
   TemporaryFile(const llvm::Twine &Prefix, llvm::StringRef Suffix = "") {
-    cantFail(llvm::sys::fs::createTemporaryFile(Prefix, Suffix, Path));
+    cantFail(create(Prefix, Suffix, Path));
     llvm::sys::RemoveFileOnSignal(Path);
   }
 
   static llvm::ErrorOr<TemporaryFile> make(const llvm::Twine &Prefix,
                                            llvm::StringRef Suffix = "") {
-    using llvm::sys::fs::createTemporaryFile;
     llvm::SmallString<32> TempPath;
-    int FD;
-    if (auto EC = createTemporaryFile(Prefix, Suffix, FD, TempPath); EC)
+    if (auto EC = create(Prefix, Suffix, TempPath); EC)
       return EC;
 
     return TemporaryFile(TempPath, 0);
@@ -66,5 +69,11 @@ public:
   }
 
 private:
+  /// Create a new empty file, preferably in memory, and store its path in
+  /// \p Path
+  static std::error_code create(const llvm::Twine &Prefix,
+                                llvm::StringRef Suffix,
+                                llvm::SmallVectorImpl<char> &Path);
+
   static void cantFail(std::error_code EC) { revng_assert(!EC); }
 };
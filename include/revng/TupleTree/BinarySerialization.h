@@ -0,0 +1,321 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/ADT/KeyedObjectContainer.h"
+#include "revng/ADT/STLExtras.h"
+#include "revng/ADT/UpcastablePointer.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/TupleLikeTraits.h"
+
+/// \file BinarySerialization.h
+///
+/// A compact binary encoding for tuple trees, meant as an alternative to YAML
+/// for storing large trees (e.g., the model) on disk.
+///
+/// The encoding is driven entirely by the traits the TupleTree generator
+/// already emits (TupleLikeTraits and `get<I>`), so every tuple tree type
+/// supports it for free:
+///
+/// * booleans are a single byte;
+/// * integers and enumerations are (S)LEB128-encoded;
+/// * strings are a LEB128 length followed by the raw bytes;
+/// * any other scalar (MetaAddress, TupleTreeReference, composite keys...)
+///   is encoded as the string produced by its YAML ScalarTraits;
+/// * upcastable pointers are the LEB128 index, plus one, of the concrete type
+///   in `concrete_types_traits_t` (zero means empty), followed by the object;
+/// * tuple-like objects are their fields, in declaration order;
+/// * sequences are a LEB128 element count followed by the elements, each of
+///   them prefixed by its size in bytes, so that a reader can skip entries of
+///   a KeyedObjectContainer without decoding them.
+///
+/// The whole buffer starts with a magic which can never appear at the
+/// beginning of a YAML document, see `isBinaryTupleTree`.
+
+namespace tupletree::binary {
+
+inline constexpr llvm::StringLiteral Magic("\0RTT", 4);
+inline constexpr uint8_t Version = 1;
+
+namespace detail {
+
+template<typename T>
+concept Sequence = KeyedObjectContainer<T>
+                   or StrictSpecializationOf<T, std::vector>;
+
+class Reader {
+private:
+  const uint8_t *Cursor = nullptr;
+  const uint8_t *End = nullptr;
+  bool Failed = false;
+
+public:
+  explicit Reader(llvm::StringRef Buffer) :
+    Cursor(Buffer.bytes_begin()), End(Buffer.bytes_end()) {}
+
+public:
+  bool failed() const { return Failed; }
+  bool atEnd() const { return Cursor == End; }
+  void fail() { Failed = true; }
+
+  uint64_t readULEB128() {
+    if (Failed)
+      return 0;
+
+    unsigned Length = 0;
+    const char *Error = nullptr;
+    uint64_t Result = llvm::decodeULEB128(Cursor, &Length, End, &Error);
+    if (Error != nullptr) {
+      Failed = true;
+      return 0;
+    }
+
+    Cursor += Length;
+    return Result;
+  }
+
+  int64_t readSLEB128() {
+    if (Failed)
+      return 0;
+
+    unsigned Length = 0;
+    const char *Error = nullptr;
+    int64_t Result = llvm::decodeSLEB128(Cursor, &Length, End, &Error);
+    if (Error != nullptr) {
+      Failed = true;
+      return 0;
+    }
+
+    Cursor += Length;
+    return Result;
+  }
+
+  llvm::StringRef readBytes(uint64_t Size) {
+    if (Failed or Size > static_cast<uint64_t>(End - Cursor)) {
+      Failed = true;
+      return {};
+    }
+
+    llvm::StringRef Result(reinterpret_cast<const char *>(Cursor), Size);
+    Cursor += Size;
+    return Result;
+  }
+
+  llvm::StringRef readString() { return readBytes(readULEB128()); }
+};
+
+template<typename T>
+void write(llvm::raw_ostream &OS, const T &Value);
+
+template<typename T>
+void read(Reader &Input, T &Value);
+
+inline void writeString(llvm::raw_ostream &OS, llvm::StringRef String) {
+  llvm::encodeULEB128(String.size(), OS);
+  OS << String;
+}
+
+template<UpcastablePointerLike P, size_t I = 0>
+void writeUpcastable(llvm::raw_ostream &OS, const P &Pointer) {
+  using concrete_types = concrete_types_traits_t<pointee<P>>;
+
+  if (Pointer.isEmpty()) {
+    llvm::encodeULEB128(0, OS);
+    return;
+  }
+
+  if constexpr (I < std::tuple_size_v<concrete_types>) {
+    using type = std::tuple_element_t<I, concrete_types>;
+    if (auto *Upcasted = llvm::dyn_cast<type>(Pointer.get())) {
+      llvm::encodeULEB128(I + 1, OS);
+      write(OS, *Upcasted);
+    } else {
+      writeUpcastable<P, I + 1>(OS, Pointer);
+    }
+  } else {
+    revng_abort();
+  }
+}
+
+template<UpcastablePointerLike P, size_t I = 0>
+void readUpcastable(Reader &Input, P &Pointer, uint64_t Index) {
+  using concrete_types = concrete_types_traits_t<pointee<P>>;
+
+  if constexpr (I < std::tuple_size_v<concrete_types>) {
+    using type = std::tuple_element_t<I, concrete_types>;
+    if (Index == I + 1) {
+      auto *Object = new type;
+      Pointer.reset(Object);
+      read(Input, *Object);
+    } else {
+      readUpcastable<P, I + 1>(Input, Pointer, Index);
+    }
+  } else {
+    // Unknown concrete type
+    Input.fail();
+  }
+}
+
+template<size_t I = 0, TraitedTupleLike T>
+void writeFields(llvm::raw_ostream &OS, const T &Object) {
+  if constexpr (I < std::tuple_size_v<T>) {
+    write(OS, get<I>(Object));
+    writeFields<I + 1>(OS, Object);
+  }
+}
+
+template<size_t I = 0, TraitedTupleLike T>
+void readFields(Reader &Input, T &Object) {
+  if constexpr (I < std::tuple_size_v<T>) {
+    read(Input, get<I>(Object));
+    readFields<I + 1>(Input, Object);
+  }
+}
+
+template<typename T>
+void write(llvm::raw_ostream &OS, const T &Value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    OS << static_cast<char>(Value ? 1 : 0);
+  } else if constexpr (std::is_integral_v<T>) {
+    if constexpr (std::is_signed_v<T>)
+      llvm::encodeSLEB128(static_cast<int64_t>(Value), OS);
+    else
+      llvm::encodeULEB128(static_cast<uint64_t>(Value), OS);
+  } else if constexpr (std::is_enum_v<T>) {
+    write(OS, static_cast<std::underlying_type_t<T>>(Value));
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    writeString(OS, Value);
+  } else if constexpr (HasScalarTraits<T>) {
+    writeString(OS, getNameFromYAMLScalar(Value));
+  } else if constexpr (UpcastablePointerLike<T>) {
+    writeUpcastable(OS, Value);
+  } else if constexpr (Sequence<T>) {
+    llvm::encodeULEB128(Value.size(), OS);
+    llvm::SmallString<64> Buffer;
+    for (const auto &Element : Value) {
+      Buffer.clear();
+      llvm::raw_svector_ostream ElementStream(Buffer);
+      write(ElementStream, Element);
+      writeString(OS, Buffer);
+    }
+  } else if constexpr (TraitedTupleLike<T>) {
+    writeFields(OS, Value);
+  } else {
+    static_assert(type_always_false_v<T>);
+  }
+}
+
+template<typename T>
+void read(Reader &Input, T &Value) {
+  if (Input.failed())
+    return;
+
+  if constexpr (std::is_same_v<T, bool>) {
+    llvm::StringRef Byte = Input.readBytes(1);
+    if (not Input.failed())
+      Value = Byte[0] != 0;
+  } else if constexpr (std::is_integral_v<T>) {
+    if constexpr (std::is_signed_v<T>)
+      Value = static_cast<T>(Input.readSLEB128());
+    else
+      Value = static_cast<T>(Input.readULEB128());
+  } else if constexpr (std::is_enum_v<T>) {
+    std::underlying_type_t<T> Underlying{};
+    read(Input, Underlying);
+    Value = static_cast<T>(Underlying);
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    Value = Input.readString().str();
+  } else if constexpr (HasScalarTraits<T>) {
+    llvm::StringRef String = Input.readString();
+    if (not Input.failed())
+      Value = getValueFromYAMLScalar<T>(String);
+  } else if constexpr (UpcastablePointerLike<T>) {
+    uint64_t Index = Input.readULEB128();
+    if (Index == 0)
+      Value.reset();
+    else
+      readUpcastable(Input, Value, Index);
+  } else if constexpr (Sequence<T>) {
+    using value_type = typename T::value_type;
+    uint64_t Count = Input.readULEB128();
+
+    auto ReadElement = [&Input](value_type &Element) {
+      Reader ElementInput(Input.readString());
+      read(ElementInput, Element);
+      if (ElementInput.failed() or not ElementInput.atEnd())
+        Input.fail();
+    };
+
+    if constexpr (KeyedObjectContainer<T>) {
+      using KOT = KeyedObjectTraits<value_type>;
+      using key_type = decltype(KOT::key(std::declval<value_type>()));
+
+      auto Inserter = Value.batch_insert();
+      for (uint64_t I = 0; I < Count and not Input.failed(); ++I) {
+        value_type Element = KOT::fromKey(key_type());
+        ReadElement(Element);
+        if (not Input.failed())
+          Inserter.insert(Element);
+      }
+    } else {
+      Value.clear();
+      for (uint64_t I = 0; I < Count and not Input.failed(); ++I)
+        ReadElement(Value.emplace_back());
+    }
+  } else if constexpr (TraitedTupleLike<T>) {
+    readFields(Input, Value);
+  } else {
+    static_assert(type_always_false_v<T>);
+  }
+}
+
+} // namespace detail
+
+/// Returns true if \p Buffer starts with the binary tuple tree magic
+inline bool isBinaryTupleTree(llvm::StringRef Buffer) {
+  return Buffer.startswith(Magic);
+}
+
+template<typename T>
+void serialize(llvm::raw_ostream &OS, const T &Object) {
+  OS << Magic;
+  OS << static_cast<char>(Version);
+  detail::write(OS, Object);
+}
+
+template<typename T>
+llvm::Error deserialize(llvm::StringRef Buffer, T &Object) {
+  if (not isBinaryTupleTree(Buffer))
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "Not a binary tuple tree");
+  Buffer = Buffer.drop_front(Magic.size());
+
+  if (Buffer.empty() or static_cast<uint8_t>(Buffer.front()) != Version)
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "Unsupported binary tuple tree version");
+  Buffer = Buffer.drop_front(1);
+
+  detail::Reader Input(Buffer);
+  detail::read(Input, Object);
+
+  if (Input.failed() or not Input.atEnd())
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "Malformed binary tuple tree");
+
+  return llvm::Error::success();
+}
+
+} // namespace tupletree::binary
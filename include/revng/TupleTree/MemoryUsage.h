@@ -0,0 +1,72 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <type_traits>
+
+#include "revng/ADT/Concepts.h"
+#include "revng/ADT/KeyedObjectContainer.h"
+#include "revng/ADT/UpcastablePointer.h"
+#include "revng/TupleTree/TupleLikeTraits.h"
+#include "revng/TupleTree/TupleTree.h"
+#include "revng/TupleTree/Visits.h"
+
+template<typename T>
+uint64_t heapMemoryUsage(const T &Value);
+
+namespace revng::detail {
+
+template<size_t I = 0, typename T>
+uint64_t tupleHeapMemoryUsage(const T &Value) {
+  if constexpr (I < std::tuple_size_v<T>)
+    return heapMemoryUsage(get<I>(Value)) + tupleHeapMemoryUsage<I + 1>(Value);
+  else
+    return 0;
+}
+
+} // namespace revng::detail
+
+/// \returns an estimate of the memory allocated by \p Value, which can be any
+///          TupleTree object, not including `sizeof(Value)`
+///
+/// This is meant to report where memory goes, not to be accurate: it ignores
+/// the overhead of the allocator and of the nodes of the containers, and
+/// references only account for their object, not for their path.
+template<typename T>
+uint64_t heapMemoryUsage(const T &Value) {
+  using namespace revng::detail;
+
+  if constexpr (StrictSpecializationOf<T, UpcastablePointer>) {
+    if (Value.isEmpty())
+      return 0;
+
+    uint64_t Result = 0;
+    Value.upcast([&Result](auto &Upcasted) {
+      Result = sizeof(Upcasted) + heapMemoryUsage(Upcasted);
+    });
+    return Result;
+  } else if constexpr (TupleSizeCompatible<T>) {
+    return tupleHeapMemoryUsage(Value);
+  } else if constexpr (revng::SetOrKOC<T>) {
+    uint64_t Result = 0;
+    for (const auto &Element : Value)
+      Result += sizeof(Element) + heapMemoryUsage(Element);
+    return Result;
+  } else if constexpr (requires { Value.capacity(); *Value.data(); }) {
+    // Strings, including the llvm::SmallString ones, and vectors of scalars.
+    // Short ones are usually stored inline.
+    uint64_t Bytes = Value.capacity() * sizeof(*Value.data());
+    return Bytes <= sizeof(T) ? 0 : Bytes;
+  } else {
+    return 0;
+  }
+}
+
+/// \returns an estimate of the memory used by \p Tree, see heapMemoryUsage
+template<TupleTreeCompatible T>
+uint64_t memoryUsage(const TupleTree<T> &Tree) {
+  return sizeof(T) + heapMemoryUsage(*Tree);
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include "revng/ADT/KeyedObjectContainer.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/TupleLikeTraits.h"
+
+namespace revng::detail {
+
+/// Documents smaller than this are parsed on a single thread
+inline constexpr size_t ParallelYAMLThreshold = 8 * 1024 * 1024;
+
+/// A top-level block sequence of a YAML document
+struct YAMLSequenceSection {
+  /// The range of the document covered by the sequence, including its key
+  size_t Begin = 0;
+  size_t End = 0;
+
+  /// The offset of the beginning of each element
+  std::vector<size_t> Elements;
+};
+
+/// Looks for the top-level key \p Key of \p Document and, if its value is a
+/// block sequence in the form produced by llvm::yaml::Output, finds where each
+/// of its elements starts
+///
+/// The scan is purely based on indentation: the key has to be on a line of its
+/// own at column 0, each element has to start with `  - ` and all of its other
+/// lines have to be indented further. Anything else is conservatively
+/// rejected, and the whole document will be parsed sequentially.
+inline std::optional<YAMLSequenceSection>
+findTopLevelSequence(llvm::StringRef Document, llvm::StringRef Key) {
+  using llvm::StringRef;
+
+  // Find the key at the beginning of a line
+  size_t KeyOffset = 0;
+  while (true) {
+    KeyOffset = Document.find(Key, KeyOffset);
+    if (KeyOffset == StringRef::npos)
+      return std::nullopt;
+
+    bool AtLineStart = KeyOffset == 0 or Document[KeyOffset - 1] == '\n';
+    StringRef After = Document.substr(KeyOffset + Key.size());
+    if (AtLineStart and After.consume_front(":")
+        and After.take_until([](char C) { return C == '\n'; }).rtrim().empty())
+      break;
+
+    KeyOffset += Key.size();
+  }
+
+  YAMLSequenceSection Result;
+  Result.Begin = KeyOffset;
+
+  size_t Offset = Document.find('\n', KeyOffset);
+  if (Offset == StringRef::npos)
+    return std::nullopt;
+  ++Offset;
+
+  while (Offset < Document.size()) {
+    size_t LineEnd = Document.find('\n', Offset);
+    if (LineEnd == StringRef::npos)
+      LineEnd = Document.size();
+    StringRef Line = Document.slice(Offset, LineEnd);
+
+    if (not Line.empty() and Line[0] != ' ')
+      break;
+
+    if (Line.startswith("  - ") or Line.rtrim() == "  -") {
+      Result.Elements.push_back(Offset);
+    } else if (Line.trim().empty() or Line.startswith("   ")) {
+      // Blank line or continuation of the current element
+      if (Result.Elements.empty() and not Line.trim().empty())
+        return std::nullopt;
+    } else {
+      return std::nullopt;
+    }
+
+    Offset = LineEnd + 1;
+  }
+
+  if (Result.Elements.empty())
+    return std::nullopt;
+
+  Result.End = std::min(Offset, Document.size());
+  return Result;
+}
+
+/// Parses the large top-level keyed containers of \p Document on multiple
+/// threads, and the rest of it on the current one
+///
+/// \returns std::nullopt if \p Document is smaller than \p Threshold or not
+///          suitable for parallel parsing
+template<TraitedTupleLike T>
+std::optional<llvm::Expected<T>>
+parallelFromYAML(llvm::StringRef Document,
+                 size_t Threshold = ParallelYAMLThreshold) {
+  if (Document.size() < Threshold)
+    return std::nullopt;
+
+  struct Chunk {
+    size_t Field = 0;
+    llvm::StringRef Text;
+  };
+
+  // Find the sections to parse in parallel and their chunks
+  unsigned Threads = llvm::hardware_concurrency().compute_thread_count();
+  std::vector<YAMLSequenceSection> Sections;
+  std::vector<Chunk> Chunks;
+  std::vector<size_t> SectionFields;
+  auto FindSections = [&]<size_t I>(auto &Self) {
+    if constexpr (I < std::tuple_size_v<T>) {
+      using FieldType = std::tuple_element_t<I, T>;
+      if constexpr (KeyedObjectContainer<FieldType>) {
+        llvm::StringRef Name = TupleLikeTraits<T>::FieldNames[I];
+        auto MaybeSection = findTopLevelSequence(Document, Name);
+        if (MaybeSection and MaybeSection->Elements.size() >= 2 * Threads) {
+          const auto &Elements = MaybeSection->Elements;
+          size_t PerChunk = Elements.size() / (4 * Threads) + 1;
+          for (size_t J = 0; J < Elements.size(); J += PerChunk) {
+            size_t Begin = Elements[J];
+            size_t End = J + PerChunk < Elements.size() ?
+                           Elements[J + PerChunk] :
+                           MaybeSection->End;
+            Chunks.push_back({ I, Document.slice(Begin, End) });
+          }
+          Sections.push_back(std::move(*MaybeSection));
+          SectionFields.push_back(I);
+        }
+      }
+
+      Self.template operator()<I + 1>(Self);
+    }
+  };
+  FindSections.template operator()<0>(FindSections);
+
+  if (Sections.empty())
+    return std::nullopt;
+
+  // Replace the sections with empty sequences, preserving their keys, which
+  // might be required
+  std::vector<size_t> Order(Sections.size());
+  for (size_t I = 0; I < Order.size(); ++I)
+    Order[I] = I;
+  llvm::sort(Order, [&Sections](size_t LHS, size_t RHS) {
+    return Sections[LHS].Begin < Sections[RHS].Begin;
+  });
+
+  std::string Rest;
+  Rest.reserve(Document.size());
+  size_t Last = 0;
+  for (size_t Index : Order) {
+    const YAMLSequenceSection &Section = Sections[Index];
+    revng_assert(Section.Begin >= Last);
+    Rest += Document.slice(Last, Section.Begin);
+    Rest += TupleLikeTraits<T>::FieldNames[SectionFields[Index]];
+    Rest += ": []\n";
+    Last = Section.End;
+  }
+  Rest += Document.substr(Last);
+
+  // Parse everything
+  std::optional<llvm::Expected<T>> Root;
+  std::vector<std::optional<llvm::Error>> Errors(Chunks.size());
+  std::vector<std::function<void(T &)>> Mergers(Chunks.size());
+  {
+    llvm::ThreadPool Pool(llvm::hardware_concurrency());
+
+    auto ParseChunk = [&]<size_t I>(auto &Self, size_t Index) {
+      if constexpr (I < std::tuple_size_v<T>) {
+        using FieldType = std::tuple_element_t<I, T>;
+        if constexpr (KeyedObjectContainer<FieldType>) {
+          if (Chunks[Index].Field == I) {
+            using revng::detail::fromStringImpl;
+            auto MaybeParsed = fromStringImpl<FieldType>(Chunks[Index].Text);
+            if (not MaybeParsed) {
+              Errors[Index] = MaybeParsed.takeError();
+              return;
+            }
+
+            auto Parsed = std::make_shared<FieldType>(std::move(*MaybeParsed));
+            Mergers[Index] = [Parsed](T &Root) {
+              auto Inserter = get<I>(Root).batch_insert();
+              for (auto &Element : *Parsed)
+                Inserter.emplace(std::move(Element));
+            };
+            return;
+          }
+        }
+
+        Self.template operator()<I + 1>(Self, Index);
+      }
+    };
+
+    for (size_t Index = 0; Index < Chunks.size(); ++Index) {
+      Pool.async([&ParseChunk, Index]() {
+        ParseChunk.template operator()<0>(ParseChunk, Index);
+      });
+    }
+
+    Root.emplace(revng::detail::fromStringImpl<T>(Rest));
+    Pool.wait();
+  }
+
+  llvm::Error Result = llvm::Error::success();
+  if (not *Root)
+    Result = llvm::joinErrors(std::move(Result), Root->takeError());
+  for (std::optional<llvm::Error> &Error : Errors)
+    if (Error)
+      Result = llvm::joinErrors(std::move(Result), std::move(*Error));
+
+  if (Result)
+    return llvm::Expected<T>(std::move(Result));
+
+  // Merge the chunks in order
+  T &Parsed = **Root;
+  for (const std::function<void(T &)> &Merge : Mergers)
+    Merge(Parsed);
+
+  return std::move(*Root);
+}
+
+} // namespace revng::detail
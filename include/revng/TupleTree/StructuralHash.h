@@ -0,0 +1,106 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <set>
+#include <type_traits>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/xxhash.h"
+
+#include "revng/ADT/Concepts.h"
+#include "revng/ADT/KeyedObjectContainer.h"
+#include "revng/ADT/STLExtras.h"
+#include "revng/ADT/UpcastablePointer.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/TupleLikeTraits.h"
+#include "revng/TupleTree/Visits.h"
+
+template<typename T>
+uint64_t structuralHash(const T &Value);
+
+namespace revng::detail {
+
+inline uint64_t mixHash(uint64_t Value) {
+  Value ^= Value >> 33;
+  Value *= 0xff51afd7ed558ccdULL;
+  Value ^= Value >> 33;
+  Value *= 0xc4ceb9fe1a85ec53ULL;
+  Value ^= Value >> 33;
+  return Value;
+}
+
+inline uint64_t combineHash(uint64_t Seed, uint64_t Value) {
+  return mixHash(Seed ^ (Value + 0x9e3779b97f4a7c15ULL + (Seed << 6)
+                         + (Seed >> 2)));
+}
+
+template<typename T>
+uint64_t leafHash(const T &Value) {
+  if constexpr (std::is_integral_v<T> or std::is_enum_v<T>) {
+    return mixHash(static_cast<uint64_t>(Value));
+  } else if constexpr (std::is_convertible_v<const T &, llvm::StringRef>) {
+    return llvm::xxHash64(llvm::StringRef(Value));
+  } else if constexpr (requires {
+                         { Value.hash() } -> std::convertible_to<uint64_t>;
+                       }) {
+    return Value.hash();
+  } else if constexpr (requires { Value.path(); Value.toString(); }) {
+    // A reference: hash its path, not what it points to
+    return llvm::xxHash64(Value.toString());
+  } else if constexpr (HasScalarOrEnumTraits<T>) {
+    return llvm::xxHash64(getNameFromYAMLScalar(Value));
+  } else {
+    static_assert(type_always_false_v<T>, "Cannot hash this type");
+  }
+}
+
+template<size_t I = 0, typename T>
+uint64_t tupleHash(const T &Value, uint64_t Seed) {
+  if constexpr (I < std::tuple_size_v<T>) {
+    Seed = combineHash(Seed, structuralHash(get<I>(Value)));
+    return tupleHash<I + 1>(Value, Seed);
+  } else {
+    return Seed;
+  }
+}
+
+} // namespace revng::detail
+
+/// \returns a hash of all the contents of \p Value, which can be any
+///          TupleTree object, down to the leaves
+///
+/// Two objects that compare equal field by field (not just by key) have the
+/// same hash. The hash only depends on the contents, so it is stable across
+/// runs and can be used to identify the same object in different trees, e.g.,
+/// to deduplicate types or to reuse artifacts.
+///
+/// \note the hash is not cached, since TupleTree objects do not track their
+///       changes: each call visits the whole subtree.
+template<typename T>
+uint64_t structuralHash(const T &Value) {
+  using namespace revng::detail;
+
+  if constexpr (StrictSpecializationOf<T, UpcastablePointer>) {
+    if (Value.isEmpty())
+      return mixHash(0);
+
+    uint64_t Result = 0;
+    Value.upcast([&Result](auto &Upcasted) {
+      Result = structuralHash(Upcasted);
+    });
+    return Result;
+  } else if constexpr (TupleSizeCompatible<T>) {
+    return tupleHash(Value, mixHash(std::tuple_size_v<T>));
+  } else if constexpr (revng::SetOrKOC<T>) {
+    uint64_t Result = mixHash(Value.size());
+    for (const auto &Element : Value)
+      Result = combineHash(Result, structuralHash(Element));
+    return Result;
+  } else {
+    return leafHash(Value);
+  }
+}
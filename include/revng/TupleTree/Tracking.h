@@ -38,6 +38,10 @@ struct Tracking {
 
   template<typename M>
   static void stop(const M &LHS);
+
+  /// \return true if the accesses to any part of \p LHS are being tracked
+  template<typename M>
+  static bool isActive(const M &LHS);
 };
 
 } // namespace revng
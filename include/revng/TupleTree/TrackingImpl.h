@@ -123,6 +123,47 @@ struct TrackingImpl {
   static void
   collectImpl(const T &LHS, TupleTreePath &Stack, ReadFields &Info) {}
 
+  template<typename M, size_t I = 0, typename T>
+  static bool isActiveTuple(const T &LHS) {
+    if constexpr (I < std::tuple_size_v<T>) {
+      return LHS.template getTracker<I>().isTracking()
+             or isActiveImpl<M>(LHS.template untrackedGet<I>())
+             or isActiveTuple<M, I + 1>(LHS);
+    } else {
+      return false;
+    }
+  }
+
+  template<typename M, StrictSpecializationOf<UpcastablePointer> T>
+  static bool isActiveImpl(const T &UP) {
+    bool Result = false;
+    if (!UP.isEmpty())
+      UP.upcast([&](auto &Upcasted) { Result = isActiveImpl<M>(Upcasted); });
+    return Result;
+  }
+
+  template<typename M, TupleSizeCompatible T>
+  static bool isActiveImpl(const T &LHS) {
+    return isActiveTuple<M>(LHS);
+  }
+
+  template<typename M, revng::SetOrKOC T>
+  static bool isActiveImpl(const T &LHS) {
+    if (LHS.isTracking())
+      return true;
+
+    for (auto &LHSElement : LHS.Content)
+      if (isActiveImpl<M>(LHSElement))
+        return true;
+
+    return false;
+  }
+
+  template<typename M, NotTupleTreeCompatible T>
+  static bool isActiveImpl(const T &LHS) {
+    return false;
+  }
+
   template<typename M, typename Visitor, size_t I = 0, typename T>
   static void visitTuple(const T &LHS) {
     if constexpr (I < std::tuple_size_v<T>) {
@@ -190,4 +231,9 @@ void Tracking::stop(const M &LHS) {
   TrackingImpl::visitTuple<M, TrackingImpl::StopTrackingVisitor>(LHS);
 }
 
+template<typename M>
+bool Tracking::isActive(const M &LHS) {
+  return TrackingImpl::isActiveTuple<M>(LHS);
+}
+
 } // namespace revng
@@ -25,6 +25,8 @@
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/BinarySerialization.h"
+#include "revng/TupleTree/ParallelYAML.h"
 #include "revng/TupleTree/Tracking.h"
 #include "revng/TupleTree/TupleTreeCompatible.h"
 #include "revng/TupleTree/TupleTreePath.h"
@@ -149,10 +151,22 @@ public:
   }
 
 public:
+  /// \note Buffers produced by serializeBinary are detected and accepted too
+  /// \note Large documents have their top-level keyed containers parsed in
+  ///       parallel, see revng::detail::parallelFromYAML
   static llvm::Expected<TupleTree> fromString(llvm::StringRef YAMLString) {
+    if (tupletree::binary::isBinaryTupleTree(YAMLString))
+      return fromBinary(YAMLString);
+
     TupleTree Result{};
 
-    auto MaybeRoot = revng::detail::fromStringImpl<T>(YAMLString);
+    std::optional<llvm::Expected<T>> MaybeParsed;
+    if constexpr (TraitedTupleLike<T>)
+      MaybeParsed = revng::detail::parallelFromYAML<T>(YAMLString);
+    if (not MaybeParsed)
+      MaybeParsed.emplace(revng::detail::fromStringImpl<T>(YAMLString));
+
+    llvm::Expected<T> &MaybeRoot = *MaybeParsed;
     if (not MaybeRoot)
       return MaybeRoot.takeError();
 
@@ -164,6 +178,18 @@ public:
     return Result;
   }
 
+  static llvm::Expected<TupleTree> fromBinary(llvm::StringRef Buffer) {
+    TupleTree Result{};
+
+    if (auto Error = tupletree::binary::deserialize(Buffer, *Result.Root))
+      return std::move(Error);
+
+    // Update references to root
+    Result.initializeReferences();
+
+    return Result;
+  }
+
   static llvm::Expected<TupleTree>
   fromFileOrSTDIN(const llvm::StringRef &Path) {
     auto MaybeBuffer = llvm::MemoryBuffer::getFileOrSTDIN(Path);
@@ -198,6 +224,13 @@ public:
     serialize(Stream);
   }
 
+  /// Serialize using the compact encoding described in BinarySerialization.h
+  void serializeBinary(llvm::raw_ostream &Stream) const {
+    revng_assert(Root);
+
+    tupletree::binary::serialize(Stream, *Root);
+  }
+
 public:
   const T *get() const noexcept { return Root.get(); }
   T *get() noexcept {
@@ -5,6 +5,7 @@
 //
 
 #include <any>
+#include <concepts>
 #include <optional>
 #include <set>
 #include <utility>
@@ -318,17 +319,89 @@ struct llvm::yaml::MappingTraits<T> {
 //
 namespace tupletreediff::detail {
 
-template<typename M>
-struct Diff {
-  TupleTreePath Stack;
-  TupleTreeDiff<M> Result;
+/// Deep comparison of two subtrees
+///
+/// Unlike operator==, which only compares the keys of keyed objects, this
+/// compares all of their fields.
+template<typename T>
+bool structurallyEqual(const T &LHS, const T &RHS);
+
+template<size_t I = 0, typename T>
+bool tupleStructurallyEqual(const T &LHS, const T &RHS) {
+  if constexpr (I < std::tuple_size_v<T>) {
+    if (not structurallyEqual(get<I>(LHS), get<I>(RHS)))
+      return false;
 
-  TupleTreeDiff<M> diff(const M &LHS, const M &RHS) {
-    diffImpl(LHS, RHS);
+    return tupleStructurallyEqual<I + 1>(LHS, RHS);
+  } else {
+    return true;
+  }
+}
+
+template<typename T>
+bool structurallyEqual(const T &LHS, const T &RHS) {
+  if constexpr (StrictSpecializationOf<T, UpcastablePointer>) {
+    if (LHS.isEmpty() or RHS.isEmpty())
+      return LHS.isEmpty() == RHS.isEmpty();
+
+    bool Result = false;
+    LHS.upcast([&](auto &LHSUpcasted) {
+      RHS.upcast([&](auto &RHSUpcasted) {
+        using LHSType = std::remove_cvref_t<decltype(LHSUpcasted)>;
+        using RHSType = std::remove_cvref_t<decltype(RHSUpcasted)>;
+        if constexpr (std::is_same_v<LHSType, RHSType>)
+          Result = structurallyEqual(LHSUpcasted, RHSUpcasted);
+      });
+    });
     return Result;
+  } else if constexpr (TupleSizeCompatible<T>) {
+    return tupleStructurallyEqual(LHS, RHS);
+  } else if constexpr (revng::SetOrKOC<T>) {
+    if (LHS.size() != RHS.size())
+      return false;
+
+    auto RHSIt = RHS.begin();
+    for (const auto &LHSElement : LHS) {
+      if (not structurallyEqual(LHSElement, *RHSIt))
+        return false;
+      ++RHSIt;
+    }
+
+    return true;
+  } else {
+    return LHS == RHS;
   }
+}
+
+/// Computes the differences between two trees, feeding each of them to
+/// \p SinkT as soon as it's found
+template<typename M, typename SinkT>
+struct Diff {
+  using Change = ::Change<M>;
+
+  TupleTreePath Stack;
+  SinkT Sink;
+
+  explicit Diff(SinkT Sink) : Sink(std::move(Sink)) {}
+
+  void diff(const M &LHS, const M &RHS) { diffImpl(LHS, RHS); }
 
 private:
+  template<typename ToAdd>
+  void add(const ToAdd &What) {
+    Sink(Change::createAddition(Stack, What));
+  }
+
+  template<typename ToRemove>
+  void remove(const ToRemove &What) {
+    Sink(Change::createRemoval(Stack, What));
+  }
+
+  template<typename ToChange>
+  void change(const ToChange &From, const ToChange &To) {
+    Sink(Change::createChange(Stack, From, To));
+  }
+
   template<size_t I = 0, typename T>
   void diffTuple(const T &LHS, const T &RHS) {
     if constexpr (I < std::tuple_size_v<T>) {
@@ -346,7 +419,7 @@ private:
   void diffImpl(const T &LHS, const T &RHS) {
     if (LHS.isEmpty() || RHS.isEmpty()) {
       if (LHS != RHS)
-        Result.change(Stack, LHS, RHS);
+        change(LHS, RHS);
     } else {
       LHS.upcast([&](auto &LHSUpcasted) {
         RHS.upcast([&](auto &RHSUpcasted) {
@@ -357,7 +430,7 @@ private:
             diffImpl(LHSUpcasted, RHSUpcasted);
             Stack.pop_back();
           } else {
-            Result.change(Stack, LHS, RHS);
+            change(LHS, RHS);
           }
         });
       });
@@ -374,12 +447,14 @@ private:
     for (auto [LHSElement, RHSElement] : zipmap_range(LHS, RHS)) {
       if (LHSElement == nullptr) {
         // Added
-        Result.add(Stack, *RHSElement);
+        add(*RHSElement);
       } else if (RHSElement == nullptr) {
         // Removed
-        Result.remove(Stack, *LHSElement);
-      } else {
-        // Identical
+        remove(*LHSElement);
+      } else if (not structurallyEqual(*LHSElement, *RHSElement)) {
+        // Same key, different content: recur.
+        // Identical entries are skipped without building any path, which is
+        // the common case by far.
         using value_type = typename T::value_type;
         Stack.push_back(KeyedObjectTraits<value_type>::key(*LHSElement));
         diffImpl(*LHSElement, *RHSElement);
@@ -391,16 +466,30 @@ private:
   template<NotTupleTreeCompatible T>
   void diffImpl(const T &LHS, const T &RHS) {
     if (LHS != RHS) {
-      Result.change(Stack, LHS, RHS);
+      change(LHS, RHS);
     }
   }
 };
 
 } // namespace tupletreediff::detail
 
+/// Computes the differences between \p LHS and \p RHS, invoking
+/// \p OnChange on each of them as it is found, without collecting them
+template<TupleTreeRootLike M, typename CallableType>
+  requires std::invocable<CallableType, Change<M> &&>
+void diff(const M &LHS, const M &RHS, CallableType &&OnChange) {
+  using SinkType = std::remove_cvref_t<CallableType>;
+  using Differ = tupletreediff::detail::Diff<M, SinkType>;
+  Differ(std::forward<CallableType>(OnChange)).diff(LHS, RHS);
+}
+
 template<TupleTreeRootLike M>
 TupleTreeDiff<M> diff(const M &LHS, const M &RHS) {
-  return tupletreediff::detail::Diff<M>().diff(LHS, RHS);
+  TupleTreeDiff<M> Result;
+  diff(LHS, RHS, [&Result](Change<M> &&C) {
+    Result.Changes.push_back(std::move(C));
+  });
+  return Result;
 }
 
 //
@@ -479,10 +568,15 @@ public:
     size_t OldSize = M.size();
     if (C->Old != std::nullopt) {
       key_type Key = KOT::key(std::get<value_type>(*C->Old));
-      auto End = M.end();
-      auto CompareKeys = [Key](value_type &V) { return KOT::key(V) == Key; };
-      auto FirstToDelete = std::remove_if(M.begin(), End, CompareKeys);
-      M.erase(FirstToDelete, End);
+      if constexpr (requires { M.erase(Key); }) {
+        // Look up the entry by key instead of scanning the whole container
+        M.erase(Key);
+      } else {
+        auto End = M.end();
+        auto CompareKeys = [Key](value_type &V) { return KOT::key(V) == Key; };
+        auto FirstToDelete = std::remove_if(M.begin(), End, CompareKeys);
+        M.erase(FirstToDelete, End);
+      }
       if (OldSize - 1 != M.size())
         generateError("Subtree removal failed",
                       revng::DiffLocation::KindType::Old);
@@ -5,7 +5,13 @@
 //
 
 #include <compare>
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
 
 #include "revng/ADT/STLExtras.h"
@@ -17,9 +23,52 @@ char *typeID() {
   return &ID;
 };
 
+namespace detail {
+
+inline uint64_t mixKeyHash(uint64_t Value) {
+  Value = (Value ^ (Value >> 33)) * 0xFF51AFD7ED558CCD;
+  return Value ^ (Value >> 33);
+}
+
+/// Hash a key of a TupleTreePath
+///
+/// Keys are integers, enums, MetaAddresses, strings or tuples of them. Other
+/// types all hash to the same value, which is correct, albeit slow.
+template<typename T>
+uint64_t hashKey(const T &Key) {
+  if constexpr (std::is_integral_v<T> or std::is_enum_v<T>) {
+    return mixKeyHash(static_cast<uint64_t>(Key) * 0x9E3779B97F4A7C15);
+  } else if constexpr (requires { uint64_t(Key.hash()); }) {
+    return Key.hash();
+  } else if constexpr (std::is_convertible_v<const T &, llvm::StringRef>) {
+    return llvm::hash_value(llvm::StringRef(Key));
+  } else if constexpr (requires { std::tuple_size<T>::value; }) {
+    return std::apply(
+      [](const auto &...Elements) {
+        uint64_t Result = 0;
+        ((Result = mixKeyHash(Result * 31 + hashKey(Elements))), ...);
+        return Result;
+      },
+      Key);
+  } else {
+    return 0;
+  }
+}
+
+} // namespace detail
+
+/// A type-erased key of a TupleTreePath
+///
+/// Keys that are small enough, such as field indices, MetaAddresses, and most
+/// of the tuple keys, are stored inline and don't require an allocation.
 class TupleTreeKeyWrapper {
 protected:
+  static constexpr size_t InlineSize = 2 * sizeof(uint64_t);
+
+protected:
+  /// Points to the key, which is either in Inline or on the heap
   void *Pointer;
+  alignas(uint64_t) std::byte Inline[InlineSize];
 
 protected:
   TupleTreeKeyWrapper(void *Pointer) : Pointer(Pointer) {}
@@ -66,6 +115,11 @@ public:
     return nullptr;
   }
 
+  virtual uint64_t hash() const {
+    revng_assert(Pointer == nullptr);
+    return 0;
+  }
+
   virtual void clone(TupleTreeKeyWrapper *Target) const {
     revng_assert(Pointer == nullptr);
   }
@@ -92,21 +146,30 @@ public:
   }
 };
 
-// TODO: optimize integral types
 template<typename T, bool LastFieldIsKind = false>
 class ConcreteTupleTreeKeyWrapper : public TupleTreeKeyWrapper {
 private:
   static char ID;
+  static constexpr bool IsInline = sizeof(T) <= InlineSize
+                                   and alignof(T) <= alignof(uint64_t);
 
 public:
   T *get() const { return reinterpret_cast<T *>(Pointer); }
 
 public:
   template<typename... Args>
-  ConcreteTupleTreeKeyWrapper(Args... A) : TupleTreeKeyWrapper(new T(A...)) {}
+  ConcreteTupleTreeKeyWrapper(Args... A) : TupleTreeKeyWrapper(nullptr) {
+    if constexpr (IsInline)
+      Pointer = new (Inline) T(A...);
+    else
+      Pointer = new T(A...);
+  }
 
   ~ConcreteTupleTreeKeyWrapper() override {
-    delete reinterpret_cast<T *>(Pointer);
+    if constexpr (IsInline)
+      get()->~T();
+    else
+      delete get();
   }
 
   bool operator==(const TupleTreeKeyWrapper &Other) const override {
@@ -153,6 +216,8 @@ public:
 
   char *id() const override { return typeID<T>(); }
 
+  uint64_t hash() const override { return detail::hashKey(*get()); }
+
   void clone(TupleTreeKeyWrapper *Target) const override {
     Target->~TupleTreeKeyWrapper();
     new (Target) ConcreteTupleTreeKeyWrapper(*get());
@@ -161,7 +226,11 @@ public:
 
 class TupleTreePath {
 private:
-  std::vector<TupleTreeKeyWrapper> Storage;
+  /// Most of the paths of the model are shorter than this, keep them inline
+  static constexpr unsigned InlineKeys = 4;
+
+private:
+  llvm::SmallVector<TupleTreeKeyWrapper, InlineKeys> Storage;
 
 public:
   TupleTreePath() = default;
@@ -229,8 +298,24 @@ public:
     return true;
   }
 
+  /// \note consistent with operator==, but not across runs, since it depends
+  ///       on the address of the type of each key
+  uint64_t hash() const {
+    uint64_t Result = Storage.size();
+    for (const TupleTreeKeyWrapper &Key : Storage) {
+      auto ID = reinterpret_cast<uintptr_t>(Key.id());
+      Result = detail::mixKeyHash((Result * 31 + ID) ^ Key.hash());
+    }
+    return Result;
+  }
+
 public:
   size_t size() const { return Storage.size(); }
 
   bool empty() const { return Storage.empty(); }
 };
+
+template<>
+struct std::hash<TupleTreePath> {
+  size_t operator()(const TupleTreePath &Path) const { return Path.hash(); }
+};
@@ -4,9 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <map>
 #include <optional>
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 
@@ -21,8 +21,9 @@ struct InstructionResults {
   unsigned Result = 0;
 };
 
-using BitLivenessAnalysisResults = std::map<llvm::Instruction *,
-                                            InstructionResults>;
+/// Results, in the order in which instructions appear in the function
+using BitLivenessAnalysisResults = llvm::MapVector<llvm::Instruction *,
+                                                   InstructionResults>;
 
 class BitLivenessWrapperPass : public llvm::FunctionPass {
 public:
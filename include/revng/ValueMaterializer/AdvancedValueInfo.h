@@ -50,6 +50,9 @@ public:
   LatticeElement combineValues(const LatticeElement &LHS,
                                const LatticeElement &RHS) const;
 
+  bool combineValuesInPlace(LatticeElement &Target,
+                            const LatticeElement &Value) const;
+
   bool isLessOrEqual(const LatticeElement &LHS,
                      const LatticeElement &RHS) const;
 
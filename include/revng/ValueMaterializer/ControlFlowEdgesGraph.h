@@ -10,7 +10,7 @@
 #include "revng/ADT/GenericGraph.h"
 #include "revng/Support/Debug.h"
 
-class ControlFlowEdgesNode {
+class ControlFlowEdgesNode : public ArenaAllocatedNode {
 public:
   llvm::BasicBlock *Source = nullptr;
   llvm::BasicBlock *Destination = nullptr;
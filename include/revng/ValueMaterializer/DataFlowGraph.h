@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <chrono>
 #include <optional>
 
 #include "llvm/IR/Constants.h"
@@ -17,7 +18,7 @@
 #include "revng/ValueMaterializer/Helpers.h"
 #include "revng/ValueMaterializer/MemoryOracle.h"
 
-class DataFlowNode {
+class DataFlowNode : public ArenaAllocatedNode {
 public:
   static constexpr uint64_t
     MaxSizeLowerBound = std::numeric_limits<uint64_t>::max();
@@ -73,6 +74,44 @@ public:
   std::string valueToString() const;
 };
 
+/// Limits on the work performed by a single materialization
+class MaterializationBudget {
+public:
+  using Clock = std::chrono::steady_clock;
+
+public:
+  /// Maximum number of values each node can materialize
+  uint64_t MaxValues = 1 << 16;
+
+  /// Materialization gives up if it's still running at this point in time
+  Clock::time_point Deadline = Clock::time_point::max();
+
+private:
+  bool TimeExhausted = false;
+  bool ValuesExhausted = false;
+
+public:
+  MaterializationBudget() = default;
+  MaterializationBudget(uint64_t MaxValues, Clock::time_point Deadline) :
+    MaxValues(MaxValues), Deadline(Deadline) {}
+
+public:
+  /// \return false if the deadline has passed
+  bool checkTime() {
+    if (not TimeExhausted and Deadline != Clock::time_point::max())
+      TimeExhausted = Clock::now() >= Deadline;
+    return not TimeExhausted;
+  }
+
+  void exhaustValues() { ValuesExhausted = true; }
+
+  bool timeExhausted() const { return TimeExhausted; }
+  bool valuesExhausted() const { return ValuesExhausted; }
+};
+
+/// Materialize all the values in \p Range as constants
+MaterializedValues materializeRange(const ConstantRangeSet &Range);
+
 class DataFlowGraph : public GenericGraph<BidirectionalNode<DataFlowNode>> {
 public:
   using Node = BidirectionalNode<DataFlowNode>;
@@ -126,9 +165,17 @@ public:
   // a list of values and a list of read memory areas
   std::optional<MaterializedValues> materialize(Node *N,
                                                 MemoryOracle &MO) const {
+    MaterializationBudget Budget;
+    return materialize(N, MO, Budget);
+  }
+
+  /// \note if \p Budget is exhausted, materialization fails and \p Budget
+  ///       records the reason
+  std::optional<MaterializedValues>
+  materialize(Node *N, MemoryOracle &MO, MaterializationBudget &Budget) const {
     using Map = std::map<Node *, std::optional<MaterializedValues>>;
     Map Results;
-    return materializeImpl(N, MO, Results);
+    return materializeImpl(N, MO, Budget, Results);
   }
 
   std::optional<MaterializedValue>
@@ -146,7 +193,11 @@ public:
     N->OracleRange = { InputValue };
     N->UseOracle = true;
 
-    std::optional<MaterializedValues> Values = materializeImpl(N, MO, Results);
+    MaterializationBudget Budget;
+    std::optional<MaterializedValues> Values = materializeImpl(N,
+                                                               MO,
+                                                               Budget,
+                                                               Results);
 
     // Restore the oracle range.
     N->OracleRange = CurrentRange;
@@ -166,7 +217,10 @@ public:
 
 private:
   RecursiveCoroutine<std::optional<MaterializedValues>>
-  materializeImpl(Node *N, MemoryOracle &MO, NodeValuesMap &Results) const;
+  materializeImpl(Node *N,
+                  MemoryOracle &MO,
+                  MaterializationBudget &Budget,
+                  NodeValuesMap &Results) const;
 
   /// \param Limits best effort limits for the creation of the data-flow graph.
   ///        In order to reliably enforce these limits, invoke enforceLimits at
@@ -49,6 +49,12 @@ private:
   DataFlowGraph::Limits TheLimits;
   Oracle::Values Oracle;
 
+  /// Holds the nodes of the graphs below, it must outlive them
+  NodeArena Arena;
+
+  /// Limits on the work of this query, configured via command line
+  MaterializationBudget Budget;
+
   //
   // Outputs
   //
@@ -60,6 +66,13 @@ private:
   std::optional<MaterializedValues> Values;
   ControlFlowEdgesGraph CFEG;
 
+  /// The query ran out of nodes or time before completing
+  bool OutOfBudget = false;
+
+  /// Values have been obtained from the oracle's range for V, instead of
+  /// materializing the data-flow graph
+  bool Degraded = false;
+
 private:
   ValueMaterializer(llvm::Instruction *Context,
                     llvm::Value *V,
@@ -96,6 +109,12 @@ public:
   const auto &values() const { return Values; }
   const auto &cfeg() const { return CFEG; }
 
+  /// \return true if the query has been cut short by the budget, in which case
+  ///         values() might be less precise than it could be or empty, and the
+  ///         query is worth retrying later
+  bool budgetExhausted() const { return OutOfBudget; }
+  bool degraded() const { return Degraded; }
+
 private:
   void run();
 
@@ -106,4 +125,6 @@ private:
   void computeSizeLowerBound();
 
   void electMaterializationStartingPoints();
+
+  void degrade();
 };
@@ -34,7 +34,8 @@ public:
                               const RawBinaryView &BinaryView,
                               const model::Binary &Binary);
 
-private:
+  /// \returns the disassembler for the instructions of type \p AddressType,
+  ///          creating it the first time it's requested
   LLVMDisassemblerInterface &
   getDisassemblerFor(MetaAddressType::Values AddressType,
                      const model::DisassemblyConfiguration &);
@@ -5,11 +5,15 @@
 //
 
 #include <memory>
+#include <unordered_map>
+
+#include "llvm/ADT/SmallVector.h"
 
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCDisassembler/MCDisassembler.h"
 #include "llvm/MC/MCInstPrinter.h"
+#include "llvm/MC/MCInstrAnalysis.h"
 #include "llvm/MC/MCInstrInfo.h"
 #include "llvm/MC/MCObjectFileInfo.h"
 #include "llvm/MC/MCRegisterInfo.h"
@@ -27,6 +31,7 @@ private:
   std::unique_ptr<llvm::MCObjectFileInfo> ObjectFileInformation;
   std::unique_ptr<llvm::MCContext> Context;
   std::unique_ptr<llvm::MCInstrInfo> InstructionInformation;
+  std::unique_ptr<llvm::MCInstrAnalysis> InstructionAnalysis;
 
   std::unique_ptr<llvm::MCDisassembler> Disassembler;
   std::unique_ptr<llvm::MCInstPrinter> Printer;
@@ -48,9 +53,42 @@ public:
     bool HasDelaySlot = false;
     uint64_t Size = 0;
   };
+
+  /// How an instruction affects the control flow, as far as LLVM can tell
+  /// without looking at the surrounding code
+  struct ControlFlowInformation {
+    /// Zero if the instruction could not be decoded
+    uint64_t Size = 0;
+
+    bool IsBranch = false;
+    bool IsConditional = false;
+    bool IsCall = false;
+    bool IsReturn = false;
+    bool HasDelaySlot = false;
+
+    /// The destination of a branch or of a call, if it's direct
+    MetaAddress Target = MetaAddress::invalid();
+  };
+
+private:
+  /// Instructions that have already been decoded successfully, along with the
+  /// bytes they have been decoded from
+  ///
+  /// The same instruction is often disassembled more than once, e.g., when a
+  /// basic block belongs to multiple functions.
+  using CachedInstruction = std::pair<llvm::SmallVector<uint8_t, 16>,
+                                      Disassembled>;
+  std::unordered_map<MetaAddress, CachedInstruction> Cache;
+
+public:
   Disassembled instruction(const MetaAddress &Where,
                            llvm::ArrayRef<uint8_t> RawBytes);
 
+  /// Decode the instruction at \p Where without printing it, which is much
+  /// cheaper than instruction if we're only interested in the control flow
+  ControlFlowInformation controlFlow(const MetaAddress &Where,
+                                     llvm::ArrayRef<uint8_t> RawBytes);
+
 public:
   inline llvm::StringRef getCommentString() const {
     return AssemblyInformation->getCommentString();
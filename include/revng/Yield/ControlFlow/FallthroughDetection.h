@@ -4,8 +4,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <memory>
+
 #include "llvm/ADT/SmallVector.h"
 
+#include "revng/Support/BasicBlockID.h"
+
 namespace model {
 class Binary;
 }
@@ -25,4 +30,21 @@ labeledBlock(const yield::BasicBlock &BasicBlock,
              const yield::Function &Function,
              const model::Binary &Binary);
 
+/// The block each block of a function falls through to, see detectFallthrough
+using FallthroughMap = std::map<BasicBlockID, BasicBlockID>;
+
+/// \returns the fallthrough of every block of \p Function
+///
+/// The result is cached by the control flow of the function, rendering it
+/// again, e.g., after a rename, does not go through its edges again.
+std::shared_ptr<const FallthroughMap>
+detectFallthroughs(const yield::Function &Function,
+                   const model::Binary &Binary);
+
+/// Like labeledBlock above, but using the result of detectFallthroughs
+llvm::SmallVector<const yield::BasicBlock *, 8>
+labeledBlock(const yield::BasicBlock &BasicBlock,
+             const yield::Function &Function,
+             const FallthroughMap &Fallthroughs);
+
 } // namespace yield::cfg
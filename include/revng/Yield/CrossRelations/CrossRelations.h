@@ -7,6 +7,7 @@
 #include "revng/ADT/GenericGraph.h"
 #include "revng/EarlyFunctionAnalysis/ControlFlowGraph.h"
 #include "revng/Model/Binary.h"
+#include "revng/Support/Generator.h"
 #include "revng/Yield/CallGraphs/Graph.h"
 #include "revng/Yield/CrossRelations/RelationDescription.h"
 
@@ -28,10 +29,18 @@ class CrossRelations : public generated::CrossRelations {
 private:
   using Node = BidirectionalNode<std::string>;
 
+public:
+  /// Produces the CFG of each function, the CFG can be released as soon as
+  /// the next one is requested
+  using CFGGenerator = cppcoro::generator<const efa::ControlFlowGraph &>;
+
 public:
   CrossRelations() = default;
-  CrossRelations(const SortedVector<efa::ControlFlowGraph> &Metadata,
-                 const model::Binary &Binary);
+
+  /// \param Metadata the CFGs of all the functions of \p Binary, in any order.
+  ///        They are visited only once, hence they don't need to be all in
+  ///        memory at the same time.
+  CrossRelations(CFGGenerator Metadata, const model::Binary &Binary);
 
   GenericGraph<Node, 16, true> toCallGraph() const;
   yield::calls::PreLayoutGraph toYieldGraph() const;
@@ -0,0 +1,45 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <array>
+
+#include "revng/EarlyFunctionAnalysis/CFGStringMap.h"
+#include "revng/Pipeline/Contract.h"
+#include "revng/Pipeline/Target.h"
+#include "revng/Pipes/FileContainer.h"
+#include "revng/Pipes/Kinds.h"
+
+namespace revng::pipes {
+
+/// Recover the CFG of each function by decoding its instructions directly,
+/// without lifting the binary
+///
+/// The result is less accurate than the one of `collect-cfg`: indirect jumps
+/// are not resolved and the effects of calls on the stack are not known. On
+/// the other hand, it's orders of magnitude faster, which makes it suitable to
+/// let the user navigate the disassembly while the full analysis is running.
+class PreviewCFG {
+public:
+  static constexpr const auto Name = "preview-cfg";
+
+public:
+  inline std::array<pipeline::ContractGroup, 1> getContract() const {
+    using namespace pipeline;
+
+    return { ContractGroup(kinds::Binary,
+                           0,
+                           kinds::CFG,
+                           1,
+                           InputPreservation::Preserve) };
+  }
+
+public:
+  void run(pipeline::ExecutionContext &Context,
+           const BinaryFileContainer &SourceBinary,
+           CFGMap &Output);
+};
+
+} // namespace revng::pipes
@@ -4,11 +4,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
 #include <string>
 
 #include "revng/PTML/Tag.h"
+#include "revng/Support/BasicBlockID.h"
+#include "revng/Yield/ControlFlow/Graph.h"
 
-class BasicBlockID;
 namespace model {
 class Binary;
 }
@@ -38,6 +40,28 @@ using CrossRelations = yield::crossrelations::CrossRelations;
 std::string controlFlowGraph(const ::ptml::PTMLBuilder &B,
                              const yield::Function &InternalFunction,
                              const model::Binary &Binary);
+
+/// Everything the control flow graph of a function needs from the model: the
+/// graph, the size of its nodes and their contents
+///
+/// Laying out and emitting the graph, which is where most of the time goes,
+/// only reads this, hence it can run concurrently for different functions,
+/// while the model can only be read from one thread.
+struct ControlFlowGraphInputs {
+  cfg::PreLayoutGraph Graph;
+  std::map<BasicBlockID, std::string> Contents;
+};
+
+ControlFlowGraphInputs
+prepareControlFlowGraph(const ::ptml::PTMLBuilder &B,
+                        const yield::Function &InternalFunction,
+                        const model::Binary &Binary);
+
+/// Lay out and emit a graph prepared by prepareControlFlowGraph, without
+/// accessing the model
+std::string controlFlowGraph(const ::ptml::PTMLBuilder &B,
+                             const ControlFlowGraphInputs &Inputs);
+
 std::string callGraph(const ::ptml::PTMLBuilder &B,
                       const detail::CrossRelations &CrossRelationTree,
                       const model::Binary &Binary);
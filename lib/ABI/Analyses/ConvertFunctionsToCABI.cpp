@@ -4,12 +4,16 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <set>
+
 #include "revng/ABI/FunctionType/Conversion.h"
 #include "revng/ABI/FunctionType/Support.h"
 #include "revng/ADT/UpcastablePointer.h"
 #include "revng/Model/Binary.h"
 #include "revng/Model/Pass/PurgeUnnamedAndUnreachableTypes.h"
 #include "revng/Model/RawFunctionDefinition.h"
+#include "revng/Model/Transaction.h"
 #include "revng/Model/TypeDefinition.h"
 #include "revng/Model/VerifyHelper.h"
 #include "revng/Pipeline/Analysis.h"
@@ -249,7 +253,28 @@ public:
     auto ToConvert = filterTypes<RawFD>(Model->TypeDefinitions(),
                                         TypesToIgnore);
 
-    // And convert them.
+    // When logging, list the functions using each of the prototypes. Collect
+    // them once, rather than scanning all the functions for each prototype.
+    std::map<model::TypeDefinition::Key, std::string> Users;
+    if (Log.isEnabled()) {
+      for (model::Function &Function : Model->Functions()) {
+        if (const auto *Prototype = Function.prototype()) {
+          std::string &Message = Users[Prototype->key()];
+          if (!Message.empty())
+            Message += ", ";
+          Message += "'" + Function.name().str().str() + "'";
+        }
+      }
+    }
+
+    // All the changes are verified together once they're done
+    model::Transaction Transaction(Model);
+
+    // And convert them. The references to the converted types are replaced
+    // all at once at the end, in order to visit the model only once.
+    namespace FT = abi::FunctionType;
+    FT::ReferenceReplacements Replacements;
+    std::set<const model::TypeDefinition *> ToErase;
     for (model::RawFunctionDefinition *Old : ToConvert) {
       auto &DT = llvm::cast<model::DefinedType>(*Model->makeType(Old->key()));
       if (!checkVectorRegisterSupport(VectorVH, *Old)) {
@@ -263,25 +288,19 @@ public:
 
       revng_log(Log, "Converting a function: " << toString(DT.Definition()));
       if (Log.isEnabled()) {
-        std::string Message = "";
-        for (model::Function &Function : Model->Functions())
-          if (Function.prototype() && Function.prototype()->key() == Old->key())
-            Message += "'" + Function.name().str().str() + "', ";
-
-        if (!Message.empty()) {
-          Message.resize(Message.size() - 2);
-          revng_log(Log, "It's a prototype of " << Message);
-        }
+        auto It = Users.find(Old->key());
+        if (It != Users.end())
+          revng_log(Log, "It's a prototype of " << It->second);
       }
 
-      namespace FT = abi::FunctionType;
-      if (auto New = FT::tryConvertToCABI(*Old, Model, ABI, SoftDeductions)) {
-        // If the conversion succeeds, make sure the returned type is valid,
+      if (auto New = FT::tryConvertToCABI(*Old,
+                                          Model,
+                                          Replacements,
+                                          ABI,
+                                          SoftDeductions)) {
+        // If the conversion succeeds, make sure the returned type is valid.
         revng_assert(!New->isEmpty());
-
-        // and verifies
-        if (VerifyLog.isEnabled())
-          New->get()->verify(true);
+        ToErase.insert(Old);
 
         revng_log(Log, "Function Conversion Successful: " << toString(*New));
       } else {
@@ -292,8 +311,30 @@ public:
       }
     }
 
+    // Only what the converted types used can be left unreachable
+    std::set<model::TypeDefinition::Key> Candidates;
+    for (const model::TypeDefinition *Old : ToErase)
+      model::collectDependencies(*Old, Candidates);
+
+    // Make all the references point to the new types, and drop the old ones
+    Model.replaceReferences(Replacements);
+    llvm::erase_if(Model->TypeDefinitions(),
+                   [&ToErase](model::UpcastableTypeDefinition &P) {
+                     return ToErase.contains(P.get());
+                   });
+
     // Don't forget to clean up any possible remainders of removed types.
-    purgeUnnamedAndUnreachableTypes(Model);
+    model::purgeUnreachableCandidates(Model, Candidates);
+
+    // If the result does not verify, the transaction restores the original
+    // model, where the functions still use their `RawFunctionDefinition`s.
+    auto MaybeDiff = Transaction.commit();
+    if (not MaybeDiff) {
+      std::string Message = llvm::toString(MaybeDiff.takeError());
+      if (VerifyLog.isEnabled())
+        revng_abort(Message.c_str());
+      revng_log(Log, "Conversion discarded: " << Message);
+    }
   }
 };
 
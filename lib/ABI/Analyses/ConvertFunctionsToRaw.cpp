@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <set>
+
 #include "revng/ABI/FunctionType/Layout.h"
 #include "revng/ABI/FunctionType/Support.h"
 #include "revng/Model/Binary.h"
@@ -28,6 +30,12 @@ public:
     using abi::FunctionType::filterTypes;
     using CABIFD = model::CABIFunctionDefinition;
     auto ToConvert = filterTypes<CABIFD>(Model->TypeDefinitions());
+
+    // Only what the converted types used can be left unreachable
+    std::set<model::TypeDefinition::Key> Candidates;
+    for (model::CABIFunctionDefinition *Old : ToConvert)
+      model::collectDependencies(*Old, Candidates);
+
     for (model::CABIFunctionDefinition *Old : ToConvert) {
       model::UpcastableType New = abi::FunctionType::convertToRaw(*Old, Model);
       revng_assert(!New.isEmpty());
@@ -35,7 +43,7 @@ public:
     }
 
     // Don't forget to clean up any possible remainders of removed types.
-    purgeUnnamedAndUnreachableTypes(Model);
+    model::purgeUnreachableCandidates(Model, Candidates);
   }
 };
 
@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <mutex>
 #include <span>
 #include <unordered_map>
 
@@ -167,10 +168,15 @@ static std::string translateABIName(model::ABI::Values ABI) {
   return "share/revng/abi/" + model::ABI::getName(ABI).str() + ".yml";
 }
 
+static std::mutex DefinitionCacheMutex;
 static std::unordered_map<model::ABI::Values, Definition> DefinitionCache;
 const Definition &Definition::get(model::ABI::Values ABI) {
   revng_assert(ABI != model::ABI::Invalid);
 
+  // References to the elements of an unordered_map are never invalidated, it's
+  // only the lookup that needs to be serialized
+  std::lock_guard Lock(DefinitionCacheMutex);
+
   auto CacheIterator = DefinitionCache.find(ABI);
   if (CacheIterator != DefinitionCache.end()) {
     // This ABI was already loaded, grab it from the cache.
@@ -247,8 +253,8 @@ static RecursiveCoroutine<std::optional<AlignmentInfo>>
 naturalAlignment(const abi::Definition &ABI,
                  const model::TypeDefinition &Type,
                  abi::Definition::AlignmentCache &Cache) {
-  if (auto Iterator = Cache.find(&Type); Iterator != Cache.end())
-    rc_return Iterator->second;
+  if (std::optional<AlignmentInfo> Cached = Cache.find(Type))
+    rc_return *Cached;
 
   AlignmentInfo Result = { 0, true };
 
@@ -305,7 +311,7 @@ naturalAlignment(const abi::Definition &ABI,
     revng_abort();
   }
 
-  Cache[&Type] = Result;
+  Cache.insert(ABI, Type, Result);
   rc_return Result;
 }
 
@@ -141,6 +141,31 @@ tryConvertToCABI(const model::RawFunctionDefinition &FunctionType,
                  TupleTree<model::Binary> &Binary,
                  std::optional<model::ABI::Values> MaybeABI,
                  bool UseSoftRegisterStateDeductions) {
+  ReferenceReplacements Replacements;
+  auto Result = tryConvertToCABI(FunctionType,
+                                 Binary,
+                                 Replacements,
+                                 MaybeABI,
+                                 UseSoftRegisterStateDeductions);
+  if (!Result.has_value())
+    return std::nullopt;
+
+  // To finish up the conversion, remove all the references to the old type by
+  // carefully replacing them with references to the new one.
+  replaceTypeDefinition(FunctionType.key(), **Result, Binary);
+
+  // And don't forget to remove the old type.
+  Binary->TypeDefinitions().erase(FunctionType.key());
+
+  return Result;
+}
+
+std::optional<model::UpcastableType>
+tryConvertToCABI(const model::RawFunctionDefinition &FunctionType,
+                 TupleTree<model::Binary> &Binary,
+                 ReferenceReplacements &Replacements,
+                 std::optional<model::ABI::Values> MaybeABI,
+                 bool UseSoftRegisterStateDeductions) {
   if (!MaybeABI.has_value())
     MaybeABI = Binary->DefaultABI();
 
@@ -196,12 +221,10 @@ tryConvertToCABI(const model::RawFunctionDefinition &FunctionType,
     }
   }
 
-  // To finish up the conversion, remove all the references to the old type by
-  // carefully replacing them with references to the new one.
-  replaceTypeDefinition(FunctionType.key(), *Type, Binary);
-
-  // And don't forget to remove the old type.
-  Binary->TypeDefinitions().erase(FunctionType.key());
+  // Record that the references to the old type need to point to the new one
+  auto OldReference = Binary->getDefinitionReference(FunctionType.key());
+  auto &NewType = llvm::cast<model::DefinedType>(*Type);
+  Replacements[OldReference] = NewType.Definition();
 
   return std::move(Type);
 }
@@ -367,7 +390,8 @@ bool canBeNext(ArgumentDistributor &Distributor,
   std::optional<uint64_t> Size = CurrentType.size();
   revng_assert(Size.has_value() && Size.value() != 0);
 
-  uint64_t Alignment = *ABI.alignment(CurrentType);
+  auto &Alignments = *Distributor.Alignments;
+  uint64_t Alignment = *ABI.alignment(CurrentType, Alignments);
   revng_assert(llvm::isPowerOf2_64(Alignment));
   if (!verifyAlignment(ABI,
                        CurrentOffset,
@@ -398,7 +422,7 @@ bool canBeNext(ArgumentDistributor &Distributor,
 
     // Compute the next stack offset
     uint64_t NextStackOffset = ABI.alignedOffset(Distributor.UsedStackOffset,
-                                                 CurrentType);
+                                                 Alignment);
     NextStackOffset += ABI.paddedSizeOnStack(*Size);
     uint64_t SizeWithPadding = NextStackOffset - Distributor.UsedStackOffset;
     if (Distributed.SizeOnStack != SizeWithPadding) {
@@ -424,7 +448,8 @@ TCC::tryConvertingStackArguments(const model::UpcastableType &StackStruct,
     return llvm::SmallVector<model::Argument, 8>{};
   }
   auto &Stack = StackStruct->toStruct();
-  uint64_t AdjustedAlignment = std::max(*ABI.alignment(Stack),
+  auto &Alignments = *Distributor.Alignments;
+  uint64_t AdjustedAlignment = std::max(*ABI.alignment(Stack, Alignments),
                                         ABI.MinimumStackArgumentSize());
   uint64_t StackSize = paddedSizeOnStack(Stack.Size(), AdjustedAlignment);
 
@@ -446,7 +471,8 @@ TCC::tryConvertingStackArguments(const model::UpcastableType &StackStruct,
     if (Stack.Fields().empty()) {
       revng_log(Log, "Stack struct has no fields.");
     } else {
-      uint64_t FirstAlignment = *ABI.alignment(*Stack.Fields().begin()->Type());
+      const auto &FirstType = *Stack.Fields().begin()->Type();
+      uint64_t FirstAlignment = *ABI.alignment(FirstType, Alignments);
       revng_assert(llvm::isPowerOf2_64(FirstAlignment));
     }
 
@@ -460,10 +486,11 @@ TCC::tryConvertingStackArguments(const model::UpcastableType &StackStruct,
     while (CurrentRange.size() > 1) {
       auto [CurrentArgument, TheNextOne] = takeAsTuple<2>(CurrentRange);
 
-      uint64_t NextAlignment = *ABI.alignment(*TheNextOne.Type());
+      const auto &NextType = *TheNextOne.Type();
+      uint64_t NextAlignment = *ABI.alignment(NextType, Alignments);
       revng_assert(llvm::isPowerOf2_64(NextAlignment));
 
-      if (!*ABI.hasNaturalAlignment(*TheNextOne.Type())) {
+      if (!*ABI.hasNaturalAlignment(NextType, Alignments)) {
         revng_assert(NextAlignment == 1);
         NextAlignment = ABI.MinimumStackArgumentSize();
       }
@@ -533,8 +560,10 @@ TCC::tryConvertingStackArguments(const model::UpcastableType &StackStruct,
                 "Some fields were converted successfully, try to slot in the "
                 "rest as a struct.");
       const model::StructField &LastSuccess = *std::prev(CurrentRange.begin());
-      uint64_t CurrentAlignment = *ABI.alignment(*LastSuccess.Type());
-      uint64_t NextAlignment = *ABI.alignment(*CurrentRange.begin()->Type());
+      const auto &NextType = *CurrentRange.begin()->Type();
+      uint64_t CurrentAlignment = *ABI.alignment(*LastSuccess.Type(),
+                                                 Alignments);
+      uint64_t NextAlignment = *ABI.alignment(NextType, Alignments);
 
       uint64_t Offset = LastSuccess.Offset();
       if (ABI.PackStackArguments() && !NextAlignment) {
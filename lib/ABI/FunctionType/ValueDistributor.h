@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <memory>
+
 #include "llvm/ADT/SmallVector.h"
 
 #include "revng/ABI/Definition.h"
@@ -85,9 +87,15 @@ public:
   uint64_t LastAddedStackPadding = 0;
   uint64_t ArgumentIndex = 0;
 
+  /// Alignments computed while distributing the values of a prototype, shared
+  /// by the copies of this distributor
+  std::shared_ptr<abi::Definition::AlignmentCache> Alignments;
+
 protected:
   explicit ValueDistributor(const abi::Definition &ABI) :
-    ABI(ABI), UsedStackOffset(ABI.StackBytesAllocatedForRegisterArguments()) {
+    ABI(ABI),
+    UsedStackOffset(ABI.StackBytesAllocatedForRegisterArguments()),
+    Alignments(std::make_shared<abi::Definition::AlignmentCache>()) {
 
     revng_assert(ABI.verify());
   }
@@ -127,10 +135,9 @@ protected:
              uint64_t OccupiedRegisterCount,
              uint64_t AllowedRegisterLimit,
              bool ForbidSplittingBetweenRegistersAndStack) {
-    abi::Definition::AlignmentCache Cache;
     return distribute(*Type.size(),
-                      *ABI.alignment(Type, Cache),
-                      *ABI.hasNaturalAlignment(Type, Cache),
+                      *ABI.alignment(Type, *Alignments),
+                      *ABI.hasNaturalAlignment(Type, *Alignments),
                       Registers,
                       OccupiedRegisterCount,
                       AllowedRegisterLimit,
@@ -165,9 +172,8 @@ public:
     if (ABI.ArgumentsArePositionBased()) {
       return positionBased(Type.isFloatPrimitive(), *Type.size());
     } else {
-      abi::Definition::AlignmentCache Cache;
-      uint64_t Alignment = *ABI.alignment(Type, Cache);
-      bool IsNatural = *ABI.hasNaturalAlignment(Type, Cache);
+      uint64_t Alignment = *ABI.alignment(Type, *Alignments);
+      bool IsNatural = *ABI.hasNaturalAlignment(Type, *Alignments);
       return nonPositionBased(Type.isScalar(),
                               Type.isFloatPrimitive(),
                               *Type.size(),
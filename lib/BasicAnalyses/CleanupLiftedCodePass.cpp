@@ -0,0 +1,57 @@
+/// \file CleanupLiftedCodePass.cpp
+/// Perform several cleanups of the lifted code in a single sweep.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include "revng/BasicAnalyses/CleanupLiftedCodePass.h"
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
+#include "revng/BasicAnalyses/RemoveHelperCalls.h"
+#include "revng/Support/IRHelpers.h"
+
+using namespace llvm;
+
+PreservedAnalyses CleanupLiftedCodePass::run(Function &F,
+                                             FunctionAnalysisManager &FAM) {
+  SmallVector<Instruction *, 16> NewPCCalls;
+  SmallVector<Instruction *, 16> HelperCalls;
+  bool Changed = false;
+
+  if (Actions.RemoveDebugMetadata and F.getMetadata(LLVMContext::MD_dbg)) {
+    F.setMetadata(LLVMContext::MD_dbg, nullptr);
+    Changed = true;
+  }
+
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (Actions.RemoveDebugMetadata and I.getDebugLoc()) {
+        I.setMetadata(LLVMContext::MD_dbg, nullptr);
+        Changed = true;
+      }
+
+      if (not isa<CallInst>(&I))
+        continue;
+
+      if (Actions.RemoveNewPCCalls and isCallTo(&I, "newpc"))
+        NewPCCalls.push_back(&I);
+      else if (Actions.RemoveHelperCalls and isCallToHelper(&I))
+        HelperCalls.push_back(&I);
+    }
+  }
+
+  for (Instruction *I : NewPCCalls)
+    I->eraseFromParent();
+
+  if (not HelperCalls.empty()) {
+    auto &GCBI = FAM.getResult<GeneratedCodeBasicInfoAnalysis>(F);
+    replaceHelperCalls(GCBI, HelperCalls);
+  }
+
+  Changed = Changed or not NewPCCalls.empty() or not HelperCalls.empty();
+  return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
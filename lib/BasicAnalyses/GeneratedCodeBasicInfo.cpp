@@ -106,6 +106,20 @@ void GeneratedCodeBasicInfo::parseRoot() {
   }
 }
 
+void GeneratedCodeBasicInfo::registerJumpTarget(BasicBlock *BB) {
+  revng_assert(BB->getParent() == RootFunction);
+  revng_assert(isJumpTarget(BB));
+
+  // If the root function has not been parsed yet, BB will be found then
+  if (not RootParsed)
+    return;
+
+  auto *Call = cast<CallInst>(&*BB->begin());
+  revng_assert(getCalledFunction(Call) == NewPC);
+  auto [It, New] = JumpTargets.try_emplace(addressFromNewPC(Call), BB);
+  revng_assert(New or It->second == BB);
+}
+
 SmallVector<std::pair<BasicBlock *, bool>, 4>
 GeneratedCodeBasicInfo::blocksByPCRange(MetaAddress Start, MetaAddress End) {
   SmallVector<std::pair<BasicBlock *, bool>, 4> Result;
@@ -17,7 +17,7 @@ private:
   OpaqueFunctionsPool<std::string> Clobberers;
 
 public:
-  OpaqueRegisterUser(llvm::Module *M) : M(M), Clobberers(M, false) {
+  OpaqueRegisterUser(llvm::Module *M) : M(M), Clobberers(M, "clobberers") {
     using namespace llvm;
     Clobberers.setMemoryEffects(MemoryEffects::readOnly());
     Clobberers.addFnAttribute(Attribute::NoUnwind);
@@ -42,39 +42,28 @@ public:
   }
 };
 
-llvm::PreservedAnalyses
-RemoveHelperCallsPass::run(llvm::Function &F,
-                           llvm::FunctionAnalysisManager &FAM) {
+void replaceHelperCalls(GeneratedCodeBasicInfo &GCBI,
+                        llvm::ArrayRef<llvm::Instruction *> Calls) {
   using namespace llvm;
 
-  // Get the result of the GCBI analysis
-  GCBI = &(FAM.getResult<GeneratedCodeBasicInfoAnalysis>(F));
-  revng_assert(GCBI != nullptr);
+  if (Calls.empty())
+    return;
 
-  SmallVector<Instruction *, 16> ToReplace;
-  for (auto &BB : F)
-    for (auto &I : BB)
-      if (isCallToHelper(&I))
-        ToReplace.push_back(&I);
-
-  bool Changed = not ToReplace.empty();
-  if (!Changed)
-    return PreservedAnalyses::all();
-
-  OpaqueRegisterUser Clobberer(F.getParent());
-  OpaqueFunctionsPool<Type *> OFPOriginalHelper(F.getParent(), false);
+  Module *M = Calls.front()->getModule();
+  OpaqueRegisterUser Clobberer(M);
+  OpaqueFunctionsPool<Type *> OFPOriginalHelper(M, false);
   OFPOriginalHelper.setMemoryEffects(MemoryEffects::readOnly());
   OFPOriginalHelper.addFnAttribute(Attribute::NoUnwind);
   OFPOriginalHelper.addFnAttribute(Attribute::WillReturn);
   OFPOriginalHelper.setTags({ &FunctionTags::UniquedByPrototype });
 
-  IRBuilder<> Builder(F.getContext());
-  for (auto *I : ToReplace) {
+  IRBuilder<> Builder(M->getContext());
+  for (auto *I : Calls) {
     Builder.SetInsertPoint(I);
 
     // Assumption: helpers do not leave the stack altered, thus we can save the
     // stack pointer and restore it back later.
-    auto *SP = createLoad(Builder, GCBI->spReg());
+    auto *SP = createLoad(Builder, GCBI.spReg());
 
     auto *RetTy = cast<CallInst>(I)->getFunctionType()->getReturnType();
     auto *OriginalHelperMarker = OFPOriginalHelper.get(RetTy,
@@ -90,11 +79,32 @@ RemoveHelperCallsPass::run(llvm::Function &F,
       Clobberer.clobber(Builder, CSV);
 
     // Restore stack pointer back.
-    Builder.CreateStore(SP, GCBI->spReg());
+    Builder.CreateStore(SP, GCBI.spReg());
 
     I->replaceAllUsesWith(NewHelper);
     I->eraseFromParent();
   }
+}
+
+llvm::PreservedAnalyses
+RemoveHelperCallsPass::run(llvm::Function &F,
+                           llvm::FunctionAnalysisManager &FAM) {
+  using namespace llvm;
+
+  // Get the result of the GCBI analysis
+  GCBI = &(FAM.getResult<GeneratedCodeBasicInfoAnalysis>(F));
+  revng_assert(GCBI != nullptr);
+
+  SmallVector<Instruction *, 16> ToReplace;
+  for (auto &BB : F)
+    for (auto &I : BB)
+      if (isCallToHelper(&I))
+        ToReplace.push_back(&I);
+
+  if (ToReplace.empty())
+    return PreservedAnalyses::all();
+
+  replaceHelperCalls(*GCBI, ToReplace);
 
   return PreservedAnalyses::none();
 }
@@ -32,8 +32,8 @@ static Logger<> Log("rua-analyses");
 
 namespace efa {
 
-template void RUAResults::dump<Logger<true>>(Logger<true> &,
-                                             const char *) const;
+template void RUAResults::dump<Logger<>>(Logger<> &,
+                                         const char *) const;
 
 struct CallSite {
   using Node = rua::Function::Node;
@@ -129,7 +129,8 @@ fromLLVMFunction(llvm::Function &F,
   for (llvm::BasicBlock *BB : llvm::depth_first(&F)) {
     // Create the node for the basic block
     auto *NewNode = Function.addNode();
-    NewNode->Label = BB->getName();
+    if (Log.isEnabled())
+      NewNode->Label = BB->getName();
     BlocksMap[BB] = NewNode;
 
     auto &Operations = NewNode->Operations;
@@ -222,6 +223,52 @@ fromLLVMFunction(llvm::Function &F,
   return Result;
 }
 
+/// Serialize everything the analyses depend upon: the nodes with their
+/// operations and successors, the special nodes and the call sites
+static std::string fingerprint(const FunctionToAnalyze &ToAnalyze) {
+  using Node = rua::Function::Node;
+  const rua::Function &Function = ToAnalyze.Function;
+
+  DenseMap<const Node *, uint32_t> Indices;
+  for (const Node *N : Function.nodes())
+    Indices[N] = Indices.size();
+
+  std::string Result;
+  raw_string_ostream Stream(Result);
+  auto Write = [&Stream](uint32_t Value) {
+    Stream.write(reinterpret_cast<const char *>(&Value), sizeof(Value));
+  };
+  auto WriteString = [&Stream, &Write](const std::string &String) {
+    Write(String.size());
+    Stream << String;
+  };
+
+  for (const Node *N : Function.nodes()) {
+    Write(N->Operations.size());
+    for (const rua::Operation &Operation : N->Operations) {
+      Write(Operation.Type);
+      Write(Function.registerByIndex(Operation.Target));
+    }
+
+    Write(N->successorCount());
+    for (const Node *Successor : N->successors())
+      Write(Indices.lookup(Successor));
+  }
+
+  Write(Indices.lookup(Function.getEntryNode()));
+  Write(Indices.lookup(ToAnalyze.ReturnNode));
+  Write(Indices.lookup(ToAnalyze.SinkNode));
+
+  for (const auto &[PC, CallSite] : ToAnalyze.CallSites) {
+    WriteString(PC.toString());
+    WriteString(CallSite.Callee.toString());
+    Write(Indices.lookup(CallSite.Block));
+  }
+
+  Stream.flush();
+  return Result;
+}
+
 // Run the ABI analyses on the outlined function F. This function must have all
 // the original function calls replaced with a basic block starting with a call
 // to `precall_hook` followed by a summary of the side effects of the function
@@ -232,10 +279,10 @@ RUAResults analyzeRegisterUsage(Function *F,
                                 model::Architecture::Values Architecture,
                                 Function *PreCallSiteHook,
                                 Function *PostCallSiteHook,
-                                Function *RetHook) {
+                                Function *RetHook,
+                                RUACache *Cache) {
   RUAResults FinalResults;
 
-  // TODO: can we avoid recreating this each time?
   revng_log(Log, "Building graph for " << F->getName());
   auto Function = fromLLVMFunction(*F,
                                    Architecture,
@@ -248,6 +295,16 @@ RUAResults analyzeRegisterUsage(Function *F,
     Log << DoLog;
   }
 
+  // If we already analyzed an identical graph, reuse the results
+  std::string Fingerprint;
+  if (Cache != nullptr) {
+    Fingerprint = fingerprint(Function);
+    if (const RUAResults *Cached = Cache->lookup(Fingerprint)) {
+      revng_log(Log, "Reusing the results of an identical graph");
+      return *Cached;
+    }
+  }
+
   auto GetRegisterName = model::Register::getRegisterName;
 
   auto *M = F->getParent();
@@ -355,6 +412,9 @@ RUAResults analyzeRegisterUsage(Function *F,
     }
   }
 
+  if (Cache != nullptr)
+    Cache->insert(std::move(Fingerprint), FinalResults);
+
   return FinalResults;
 }
 
@@ -4,7 +4,9 @@
 ///
 /// This pass visits each function into reverse post order and, each time it
 /// finds a call to newpc, updates the "current location". While doing the visit
-/// we attach the "current location" to each instruction we meet.
+/// we attach the "current location" to each instruction we meet. The block
+/// containing each program counter is looked up in a table built once per
+/// function from its CFG, and each location is created only once.
 ///
 /// The debug location we attach refers to a program specific to that program
 /// counter which has been virtually inlined into another subprogram that
@@ -20,7 +22,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/Function.h"
@@ -46,6 +52,7 @@ private:
   llvm::Module &M;
   DIBuilder DIB;
   DICompileUnit *CU = nullptr;
+  DISubroutineType *SubroutineType = nullptr;
 
 public:
   AttachDebugInfo(llvm::ModulePass &Pass,
@@ -74,72 +81,112 @@ static bool isTrue(const llvm::Value *V) {
   return getLimitedValue(V) != 0;
 }
 
+/// The blocks of a function, sorted by inlining index and start address, so
+/// that the block containing an address can be found with a binary search
+class BlockTable {
+private:
+  using Key = std::pair<uint64_t, MetaAddress>;
+  using Entry = std::pair<Key, const efa::BasicBlock *>;
+
+private:
+  std::vector<Entry> Table;
+
+public:
+  explicit BlockTable(const efa::ControlFlowGraph &CFG) {
+    Table.reserve(CFG.Blocks().size());
+    for (const efa::BasicBlock &Block : CFG.Blocks()) {
+      const BasicBlockID &ID = Block.ID();
+      Table.emplace_back(Key(ID.inliningIndex(), ID.start()), &Block);
+    }
+    llvm::sort(Table, llvm::less_first());
+  }
+
+public:
+  /// \return the block containing \p Address, nullptr if there's none
+  const efa::BasicBlock *find(const BasicBlockID &Address) const {
+    Key Needle(Address.inliningIndex(), Address.start());
+    auto It = llvm::upper_bound(Table, Needle, [](const Key &LHS,
+                                                  const Entry &RHS) {
+      return LHS < RHS.first;
+    });
+    if (It == Table.begin())
+      return nullptr;
+
+    const efa::BasicBlock *Block = std::prev(It)->second;
+    return Block->contains(Address) ? Block : nullptr;
+  }
+};
+
+static DILocation *createLocation(DIBuilder &DIB,
+                                  DISubroutineType *Type,
+                                  DILocation *InlinedAt,
+                                  const efa::ControlFlowGraph &FM,
+                                  const BlockTable &Blocks,
+                                  llvm::CallBase *Call) {
+  namespace ranks = revng::ranks;
+
+  BasicBlockID Address = blockIDFromNewPC(Call);
+  const efa::BasicBlock *Block = Blocks.find(Address);
+  revng_assert(Block != nullptr);
+
+  // A jump target starts a block, unless it has been merged into another one
+  if (isTrue(Call->getArgOperand(NewPCArguments::IsJumpTarget))
+      and FM.Blocks().contains(Address))
+    revng_assert(Block->ID() == Address);
+
+  auto SPFlags = DISubprogram::toSPFlags(false, /* isLocalToUnit */
+                                         true, /* isDefinition*/
+                                         false /* isOptimized */);
+
+  // Let's make the debug location that points back to the binary.
+  std::string NewDebugLocation = toString(ranks::Instruction,
+                                          FM.Entry(),
+                                          Block->ID(),
+                                          Address.start());
+  DISubprogram *TheSubprogram = InlinedAt->getScope()->getSubprogram();
+  auto Subprogram = DIB.createFunction(TheSubprogram->getFile(), // Scope
+                                       NewDebugLocation, // Name
+                                       StringRef(), // LinkageName
+                                       TheSubprogram->getFile(), // File
+                                       1, // LineNo
+                                       Type, // Ty (subroutine type)
+                                       1, // ScopeLine
+                                       DINode::FlagPrototyped, // Flags
+                                       SPFlags);
+  DIB.finalizeSubprogram(Subprogram);
+
+  // Represent debug info for all the isolated functions as if they were
+  // inlined in the root.
+  return DILocation::get(Call->getContext(), 0, 0, Subprogram, InlinedAt);
+}
+
 static void handleFunction(DIBuilder &DIB,
+                           DISubroutineType *Type,
                            llvm::Function &F,
                            DISubprogram *TheSubprogram,
-                           efa::ControlFlowGraph &FM,
+                           const efa::ControlFlowGraph &FM,
                            GeneratedCodeBasicInfo &GCBI) {
-  namespace ranks = revng::ranks;
-
   LLVMContext &Context = F.getParent()->getContext();
+  const BlockTable Blocks(FM);
+  auto *InlinedAt = DILocation::get(Context, 0, 0, TheSubprogram, nullptr);
+
+  // The same instruction can be reached through several calls to newpc, e.g.,
+  // due to code duplication: give them the same location. Instruction IDs are
+  // constants, hence uniqued, so there's no need to parse them for lookup.
+  llvm::DenseMap<const llvm::Value *, DILocation *> Locations;
+
   DILocation *CurrentDebugLocation = nullptr;
-  BasicBlockID LastJumpTarget;
   for (auto *BB : ReversePostOrderTraversal(&F)) {
     if (not GCBI.isTranslated(BB))
       continue;
 
     for (auto &I : *BB) {
       if (auto *Call = getCallTo(&I, "newpc")) {
-        BasicBlockID Address = blockIDFromNewPC(Call);
-
-        if (isTrue(Call->getArgOperand(NewPCArguments::IsJumpTarget))) {
-          const auto &CFG = FM.Blocks();
-          if (CFG.contains(Address)) {
-            LastJumpTarget = Address;
-          } else {
-            revng_assert(CFG.at(LastJumpTarget).contains(Address));
-          }
-        }
-
-        revng_assert(LastJumpTarget.isValid());
-        revng_assert(Address.inliningIndex() == LastJumpTarget.inliningIndex());
-
-        auto SPFlags = DISubprogram::toSPFlags(false, /* isLocalToUnit */
-                                               true, /* isDefinition*/
-                                               false /* isOptimized */);
-        auto Type = DIB.createSubroutineType(DIB.getOrCreateTypeArray({}));
-
-        // Let's make the debug location that points back to the binary.
-        std::string NewDebugLocation = toString(ranks::Instruction,
-                                                FM.Entry(),
-                                                LastJumpTarget,
-                                                Address.start());
-        auto Subprogram = DIB.createFunction(TheSubprogram->getFile(), // Scope
-                                             NewDebugLocation, // Name
-                                             StringRef(), // LinkageName
-                                             TheSubprogram->getFile(), // File
-                                             1, // LineNo
-                                             Type, // Ty (subroutine type)
-                                             1, // ScopeLine
-                                             DINode::FlagPrototyped, // Flags
-                                             SPFlags);
-        DIB.finalizeSubprogram(Subprogram);
-
-        auto InlineLocationForMetaAddress = DILocation::get(Context,
-                                                            0,
-                                                            0,
-                                                            TheSubprogram,
-                                                            nullptr);
-
-        // Represent debug info for all the isolated functions as if they were
-        // inlined in the root.
-        auto InlineLoc = DILocation::get(Context,
-                                         0,
-                                         0,
-                                         Subprogram,
-                                         InlineLocationForMetaAddress);
-
-        CurrentDebugLocation = InlineLoc;
+        auto *ID = Call->getArgOperand(NewPCArguments::InstructionID);
+        DILocation *&Location = Locations[ID];
+        if (Location == nullptr)
+          Location = createLocation(DIB, Type, InlinedAt, FM, Blocks, Call);
+        CurrentDebugLocation = Location;
       }
 
       I.setDebugLoc(CurrentDebugLocation);
@@ -160,6 +207,8 @@ bool AttachDebugInfo::prologue() {
                              0 // RV
   );
 
+  SubroutineType = DIB.createSubroutineType(DIB.getOrCreateTypeArray({}));
+
   return true;
 }
 
@@ -176,7 +225,7 @@ bool AttachDebugInfo::runOnFunction(const model::Function &ModelFunction,
   // Skip declarations
   revng_assert(not F.isDeclaration());
 
-  auto FM = Cache->getControlFlowGraph(&F);
+  const efa::ControlFlowGraph &FM = Cache->getControlFlowGraph(&F);
   revng_log(Log,
             "Metadata for Function " << F.getName() << ":"
                                      << FM.Entry().toString());
@@ -186,21 +235,19 @@ bool AttachDebugInfo::runOnFunction(const model::Function &ModelFunction,
                                          true, // isDefinition
                                          false // isOptimized
   );
-  auto SPType = DIB.createSubroutineType(DIB.getOrCreateTypeArray({}));
-
   DISubprogram
     *TheSubprogram = DIB.createFunction(CU->getFile(), // Scope
                                         F.getName(), // Name
                                         StringRef(), // LinkageName
                                         CU->getFile(), // File
                                         1, // LineNo
-                                        SPType, // Ty (subroutine type)
+                                        SubroutineType, // Ty (subroutine type)
                                         1, // ScopeLine
                                         DINode::FlagPrototyped, // Flags
                                         SPFlags);
   DIB.finalizeSubprogram(TheSubprogram);
 
-  handleFunction(DIB, F, TheSubprogram, FM, GCBI);
+  handleFunction(DIB, SubroutineType, F, TheSubprogram, FM, GCBI);
 
   return true;
 }
@@ -22,10 +22,10 @@
 #include "llvm/Transforms/Scalar/MergedLoadStoreMotion.h"
 #include "llvm/Transforms/Scalar/SROA.h"
 #include "llvm/Transforms/Scalar/SimplifyCFG.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include "revng/ADT/Queue.h"
-#include "revng/BasicAnalyses/RemoveHelperCalls.h"
-#include "revng/BasicAnalyses/RemoveNewPCCalls.h"
+#include "revng/BasicAnalyses/CleanupLiftedCodePass.h"
 #include "revng/EarlyFunctionAnalysis/AAWriterPass.h"
 #include "revng/EarlyFunctionAnalysis/BasicBlock.h"
 #include "revng/EarlyFunctionAnalysis/CFGAnalyzer.h"
@@ -55,6 +55,12 @@ static opt<std::string> IndirectBranchInfoSummaryPath("indirect-branch-info-"
                                                            "of SA2 on disk."),
                                                       value_desc("filename"));
 
+static opt<bool> DisableOutlinedCache("efa-disable-outlined-functions-cache",
+                                      desc("Never reuse outlined functions, "
+                                           "even if the summaries they depend "
+                                           "on did not change."),
+                                      init(false));
+
 static Logger<> Log("cfg-analyzer");
 
 static MetaAddress getFinalAddressOfBasicBlock(llvm::BasicBlock *BB) {
@@ -149,6 +155,26 @@ CFGAnalyzer::CFGAnalyzer(llvm::Module &M,
   *OutputIBI << "\n";
 }
 
+static OutlinedFunction clone(const OutlinedFunction &Original) {
+  // The marker is created after outlining
+  revng_assert(Original.IndirectBranchInfoMarker.get() == nullptr);
+
+  ValueToValueMapTy VMap;
+  OutlinedFunction Result;
+  Result.Address = Original.Address;
+  Function *Cloned = CloneFunction(Original.Function.get(), VMap);
+  Result.Function = UniqueValuePtr<Function>(Cloned);
+
+  auto MapBlock = [&VMap](llvm::BasicBlock *BB) -> llvm::BasicBlock * {
+    return BB == nullptr ? nullptr : cast<llvm::BasicBlock>(VMap[BB]);
+  };
+  Result.AnyPCCloned = MapBlock(Original.AnyPCCloned);
+  Result.UnexpectedPCCloned = MapBlock(Original.UnexpectedPCCloned);
+  Result.InlinedFunctionsByIndex = Original.InlinedFunctionsByIndex;
+
+  return Result;
+}
+
 OutlinedFunction CFGAnalyzer::outline(const MetaAddress &Entry) {
   auto &CFG = Oracle.getLocalFunction(Entry).CFG;
   bool HasCFG = CFG.size() != 0;
@@ -160,6 +186,28 @@ OutlinedFunction CFGAnalyzer::outline(const MetaAddress &Entry) {
         if (Successor->Type() == efa::FunctionEdgeType::Return)
           ReturnBlocks.insert(Block.ID().start());
 
+  // Besides the call sites, the outlined function depends on the return
+  // blocks of the current CFG, if any
+  std::optional<std::set<MetaAddress>> ReturnBlocksKey;
+  if (HasCFG)
+    ReturnBlocksKey = std::set<MetaAddress>(ReturnBlocks.begin(),
+                                            ReturnBlocks.end());
+
+  bool UseCache = CacheOutlined and not DisableOutlinedCache;
+  if (UseCache) {
+    auto It = OutlinedCache.find(Entry);
+    if (It != OutlinedCache.end()) {
+      CachedOutlinedFunction Cached = std::move(It->second);
+      OutlinedCache.erase(It);
+
+      if (Cached.ReturnBlocks == ReturnBlocksKey
+          and Outliner.isUpToDate(Cached.Inputs)) {
+        revng_log(Log, "Reusing outlined function for " << Entry.toString());
+        return std::move(Cached.Function);
+      }
+    }
+  }
+
   CallSummarizer Summarizer(&M,
                             PreCallHook.get(),
                             PostCallHook.get(),
@@ -167,13 +215,29 @@ OutlinedFunction CFGAnalyzer::outline(const MetaAddress &Entry) {
                             GCBI.spReg(),
                             HasCFG ? &ReturnBlocks : nullptr);
 
-  OutlinedFunction Result = Outliner.outline(Entry, &Summarizer);
+  CallSiteInputs Inputs;
+  OutlinedFunction Result = Outliner.outline(Entry,
+                                             &Summarizer,
+                                             UseCache ? &Inputs : nullptr);
+
+  // Note: we look for the calls in the outlined function, instead of going
+  //       through the users of the callee, since nearly all of them are in
+  //       root (and in the cached outlined functions)
+  llvm::Function *F = Result.Function.get();
+  auto CallsTo = [F](llvm::Function *Callee) {
+    llvm::SmallVector<llvm::CallBase *, 16> Result;
+    for (llvm::Instruction &I : llvm::instructions(F))
+      if (auto *Call = dyn_cast<llvm::CallBase>(&I))
+        if (Call->getCalledOperand()->stripPointerCasts() == Callee)
+          Result.push_back(Call);
+    return Result;
+  };
 
   // Make sure we start a new block before a PreCallHook
   auto IsFirst = [](llvm::Instruction *I) {
     return I->getParent()->getFirstNonPHI() == I;
   };
-  for (llvm::CallBase *Call : callers(PreCallHook.get()))
+  for (llvm::CallBase *Call : CallsTo(PreCallHook.get()))
     if (not IsFirst(Call))
       Call->getParent()->splitBasicBlock(Call);
 
@@ -182,10 +246,17 @@ OutlinedFunction CFGAnalyzer::outline(const MetaAddress &Entry) {
     auto IsJumpTarget = NewPCArguments::IsJumpTarget;
     return getLimitedValue(&*Call->getArgOperand(IsJumpTarget)) == 1;
   };
-  for (llvm::CallBase *Call : callers(M.getFunction("newpc")))
+  for (llvm::CallBase *Call : CallsTo(M.getFunction("newpc")))
     if (IsJumpTarget(Call) and not IsFirst(Call))
       Call->getParent()->splitBasicBlock(Call);
 
+  // Callers are going to transform the function, keep a pristine copy
+  if (UseCache) {
+    OutlinedCache[Entry] = CachedOutlinedFunction{ clone(Result),
+                                                   std::move(Inputs),
+                                                   std::move(ReturnBlocksKey) };
+  }
+
   return Result;
 }
 
@@ -580,15 +651,8 @@ void CFGAnalyzer::materializePCValues(llvm::Function *F,
                                       llvm::IRBuilder<> &IRB) {
   using namespace llvm;
 
-  for (auto &BB : *F) {
-    for (auto &I : BB) {
-      if (auto *Call = getCallTo(&I, "newpc")) {
-        MetaAddress NewPC = blockIDFromNewPC(Call).start();
-        IRB.SetInsertPoint(Call);
-        PCH->setPC(IRB, NewPC);
-      }
-    }
-  }
+  auto GetPC = [](CallInst *Call) { return blockIDFromNewPC(Call).start(); };
+  PCH->expandNewPCs(*F, GetPC);
 }
 
 void CFGAnalyzer::runOptimizationPipeline(llvm::Function *F) {
@@ -613,8 +677,8 @@ void CFGAnalyzer::runOptimizationPipeline(llvm::Function *F) {
     // First stage: simplify the IR, promote the CSVs to local variables,
     // compute subexpressions elimination and resolve redundant expressions in
     // order to compute the stack height.
-    FPM.addPass(RemoveNewPCCallsPass());
-    FPM.addPass(RemoveHelperCallsPass());
+    FPM.addPass(CleanupLiftedCodePass({ .RemoveNewPCCalls = true,
+                                        .RemoveHelperCalls = true }));
     FPM.addPass(PromoteGlobalToLocalPass());
     FPM.addPass(SimplifyCFGPass());
     FPM.addPass(SROAPass(SROAOptions::ModifyCFG));
@@ -954,7 +1018,7 @@ FunctionSummary CFGAnalyzer::milkInfo(OutlinedFunction *OutlinedFunction,
       Log << Prefix << CSV->getName();
       Prefix = ", ";
     }
-    Log << "}" << DoLog;
+    revng_log(Log, "}");
 
     Log << "IBIResults:\n";
     for (const auto &[Call, Edge] : IBIResult) {
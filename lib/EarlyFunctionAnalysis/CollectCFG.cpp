@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 
 #include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
@@ -13,16 +14,27 @@
 #include "revng/EarlyFunctionAnalysis/FunctionSummaryOracle.h"
 #include "revng/Model/Binary.h"
 #include "revng/Pipeline/Contract.h"
+#include "revng/Pipeline/FunctionCostReport.h"
 #include "revng/Pipeline/RegisterContainerFactory.h"
 #include "revng/Pipeline/RegisterPipe.h"
+#include "revng/Pipeline/TargetBudget.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Pipes/StringMap.h"
 #include "revng/Support/CommonOptions.h"
 #include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/BinarySerialization.h"
 
 using namespace llvm;
 
+static cl::opt<bool> BinaryStorage("cfg-binary-storage",
+                                   cl::desc("Store CFGs using the binary tuple "
+                                            "tree encoding instead of YAML. "
+                                            "CFGs are then faster to load, but "
+                                            "the cfg artifact is no longer "
+                                            "human readable."),
+                                   cl::init(false));
+
 namespace revng::pipes {
 
 class CollectCFGPipe {
@@ -58,16 +70,16 @@ public:
     for (const model::Function &Function :
          getFunctionsAndCommit(Context, CFGs.name())) {
       MetaAddress EntryAddress = Function.Entry();
+      pipeline::FunctionCostScope Cost(EntryAddress);
+      pipeline::TargetBudgetScope Budget(EntryAddress);
 
       // Recover the control-flow graph of the function
       efa::ControlFlowGraph New;
       New.Entry() = EntryAddress;
       New.Blocks() = std::move(Analyzer.analyze(EntryAddress).CFG);
 
-      if (DebugNames) {
-        auto Function = Binary->Functions().at(EntryAddress);
+      if (DebugNames)
         New.OriginalName() = Function.OriginalName();
-      }
 
       revng_assert(New.Blocks().contains(BasicBlockID(New.Entry())));
 
@@ -75,9 +87,18 @@ public:
       New.simplify(*Binary);
 
       revng_assert(New.Blocks().contains(BasicBlockID(New.Entry())));
+      Cost.setBlocks(New.Blocks().size());
 
       // TODO: we'd need a function-wise TupleTreeContainer
-      CFGs[EntryAddress] = toString(New);
+      if (BinaryStorage) {
+        std::string Serialized;
+        llvm::raw_string_ostream Stream(Serialized);
+        tupletree::binary::serialize(Stream, New);
+        Stream.flush();
+        CFGs[EntryAddress] = std::move(Serialized);
+      } else {
+        CFGs[EntryAddress] = toString(New);
+      }
     }
   }
 };
@@ -59,17 +59,12 @@ private:
 
   void collectFunctionsFromUnusedAddresses() {
     using namespace llvm;
-    Function &Root = *M.getFunction("root");
 
-    for (BasicBlock &BB : Root) {
-      if (getType(&BB) != BlockType::JumpTargetBlock)
-        continue;
-
-      MetaAddress Entry = getBasicBlockAddress(getJumpTargetBlock(&BB));
+    for (const auto &[Entry, BB] : GCBI.jumpTargets()) {
       if (Binary.Functions().tryGet(Entry) != nullptr)
         continue;
 
-      uint32_t Reasons = GCBI.getJTReasons(&BB);
+      uint32_t Reasons = GCBI.getJTReasons(BB);
       bool IsUnusedGlobalData = hasReason(Reasons, JTReason::UnusedGlobalData);
       bool IsDirectJump = hasReason(Reasons, JTReason::DirectJump);
       bool IsMemoryStore = hasReason(Reasons, JTReason::MemoryStore);
@@ -112,7 +107,7 @@ private:
           Binary.Functions()[Entry];
           revng_log(Log,
                     "Found function from unused addresses: "
-                      << BB.getName().str());
+                      << BB->getName().str());
         }
       }
     }
@@ -2,8 +2,101 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <list>
+#include <mutex>
+
+#include "llvm/ADT/StringMap.h"
+
 #include "revng/EarlyFunctionAnalysis/ControlFlowGraphCache.h"
 
+using namespace llvm;
+
+cl::opt<uint64_t> ControlFlowGraphCacheBudget("cfg-cache-budget",
+                                              cl::desc("maximum size, in bytes "
+                                                       "of YAML, of the "
+                                                       "deserialized CFGs to "
+                                                       "keep in memory. 0 "
+                                                       "means no limit."),
+                                              cl::init(0));
+
+static cl::opt<uint64_t> SharedBudget("cfg-shared-cache-budget",
+                                      cl::desc("maximum size, in bytes of "
+                                               "YAML, of the deserialized CFGs "
+                                               "shared across pipes. 0 means "
+                                               "no limit."),
+                                      cl::init(256 * 1024 * 1024));
+
+namespace {
+
+struct SharedEntry {
+  SharedControlFlowGraphCache::Pointer CFG;
+  std::list<StringRef>::iterator LRUPosition;
+};
+
+struct SharedState {
+  std::mutex Mutex;
+  /// Keyed by the YAML of the CFG
+  StringMap<SharedEntry> Entries;
+  /// Keys of Entries, most recently used first
+  std::list<StringRef> LRU;
+  size_t Size = 0;
+
+  /// Drop the least recently used entries until we're within budget, always
+  /// preserving the most recently used one
+  void evict() {
+    if (SharedBudget == 0)
+      return;
+
+    while (Size > SharedBudget and LRU.size() > 1) {
+      ControlFlowGraphCacheStatistics.push("shared-evictions");
+      Size -= LRU.back().size();
+      Entries.erase(LRU.back());
+      LRU.pop_back();
+    }
+  }
+};
+
+} // namespace
+
+static SharedState &getSharedState() {
+  static SharedState State;
+  return State;
+}
+
+SharedControlFlowGraphCache::Pointer
+SharedControlFlowGraphCache::get(StringRef Serialized) {
+  SharedState &State = getSharedState();
+
+  {
+    std::lock_guard Lock(State.Mutex);
+    auto It = State.Entries.find(Serialized);
+    if (It != State.Entries.end()) {
+      ControlFlowGraphCacheStatistics.push("shared-hits");
+      State.LRU.splice(State.LRU.begin(), State.LRU, It->second.LRUPosition);
+      return It->second.CFG;
+    }
+  }
+
+  // Parse without holding the lock, multiple threads might race to parse the
+  // same CFG, but they will produce the same result
+  using CFGTree = TupleTree<efa::ControlFlowGraph>;
+  CFGTree Parsed = cantFail(CFGTree::fromString(Serialized));
+  auto Result = std::make_shared<const CFGTree>(std::move(Parsed));
+
+  std::lock_guard Lock(State.Mutex);
+  auto [It, New] = State.Entries.try_emplace(Serialized);
+  if (not New)
+    return It->second.CFG;
+
+  ControlFlowGraphCacheStatistics.push("shared-misses");
+  It->second.CFG = Result;
+  It->second.LRUPosition = State.LRU.insert(State.LRU.begin(), It->first());
+  State.Size += Serialized.size();
+  State.evict();
+
+  return Result;
+}
+
 char ControlFlowGraphCachePass::ID = '_';
 
 llvm::AnalysisKey ControlFlowGraphCacheAnalysis::Key;
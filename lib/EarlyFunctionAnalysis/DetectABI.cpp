@@ -12,6 +12,7 @@
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetOperations.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Instruction.h"
@@ -35,8 +36,10 @@
 #include "revng/Model/Binary.h"
 #include "revng/Model/Pass/PromoteOriginalName.h"
 #include "revng/Model/Register.h"
+#include "revng/Pipeline/FunctionCostReport.h"
 #include "revng/Pipeline/Pipe.h"
 #include "revng/Pipeline/RegisterAnalysis.h"
+#include "revng/Pipeline/TargetBudget.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Support/BasicBlockID.h"
@@ -107,9 +110,10 @@ public:
     Manager.add(new LoadModelWrapperPass(ModelWrapper(Global->get())));
     Manager.add(new CollectFunctionsFromCalleesWrapperPass());
     Manager.add(new ControlFlowGraphCachePass(CFGs));
-    Manager.add(new efa::DetectABIPass());
+    efa::CallTargetsCache CallTargets;
+    Manager.add(new efa::DetectABIPass(CallTargets));
     Manager.add(new CollectFunctionsFromUnusedAddressesWrapperPass());
-    Manager.add(new efa::DetectABIPass());
+    Manager.add(new efa::DetectABIPass(CallTargets));
     Manager.run(ModuleContainer.getModule());
   }
 };
@@ -149,9 +153,11 @@ private:
   TupleTree<model::Binary> &Binary;
   FunctionSummaryOracle &Oracle;
   CFGAnalyzer &Analyzer;
+  CallTargetsCache &CallTargets;
 
   CallGraph ApproximateCallGraph;
   BasicBlockToNodeMap BasicBlockNodeMap;
+  RUACache RegisterUsageCache;
 
 public:
   DetectABI(llvm::Module &M,
@@ -159,14 +165,16 @@ public:
             ControlFlowGraphCache &FMC,
             TupleTree<model::Binary> &Binary,
             FunctionSummaryOracle &Oracle,
-            CFGAnalyzer &Analyzer) :
+            CFGAnalyzer &Analyzer,
+            CallTargetsCache &CallTargets) :
     M(M),
     Context(M.getContext()),
     GCBI(GCBI),
     FMC(FMC),
     Binary(Binary),
     Oracle(Oracle),
-    Analyzer(Analyzer) {}
+    Analyzer(Analyzer),
+    CallTargets(CallTargets) {}
 
 public:
   void run() {
@@ -241,11 +249,59 @@ private:
   bool getRegisterState(model::Register::Values, const CSVSet &);
 };
 
-void DetectABI::computeApproximateCallGraph() {
+const CallTargetsCache::TargetsList &
+CallTargetsCache::get(const llvm::Module &M, llvm::BasicBlock *Entry) {
   using llvm::BasicBlock;
 
-  // Temporary worklist to collect the function entrypoints
+  // The cache is bound to a single module
+  if (this->M != &M) {
+    this->M = &M;
+    Targets.clear();
+  }
+
+  auto [It, New] = Targets.try_emplace(Entry);
+  TargetsList &Result = It->second;
+  if (not New)
+    return Result;
+
+  llvm::SmallPtrSet<BasicBlock *, 8> Found;
+  llvm::SmallSet<BasicBlock *, 8> Visited;
   llvm::SmallVector<BasicBlock *, 8> Worklist;
+  Worklist.emplace_back(Entry);
+
+  while (!Worklist.empty()) {
+    BasicBlock *Current = Worklist.pop_back_val();
+    Visited.insert(Current);
+
+    if (hasMarker(Current, "function_call")) {
+      // Indirect calls have no target
+      if (BasicBlock *Callee = getFunctionCallCallee(Current))
+        if (Found.insert(Callee).second)
+          Result.push_back(Callee);
+
+      BasicBlock *Next = getFallthrough(Current);
+      revng_assert(Next != nullptr);
+
+      if (!Visited.contains(Next))
+        Worklist.push_back(Next);
+
+    } else {
+
+      for (BasicBlock *Successor : successors(Current)) {
+        if (not isPartOfRootDispatcher(Successor)
+            && !Visited.contains(Successor)) {
+          revng_assert(Successor != nullptr);
+          Worklist.push_back(Successor);
+        }
+      }
+    }
+  }
+
+  return Result;
+}
+
+void DetectABI::computeApproximateCallGraph() {
+  using llvm::BasicBlock;
 
   // Create an over-approximated call graph
   for (const auto &Function : Binary->Functions()) {
@@ -255,48 +311,18 @@ void DetectABI::computeApproximateCallGraph() {
     BasicBlockNodeMap[Entry] = GraphNode;
   }
 
+  // Connect each function to the call targets which are functions too
   for (const auto &Function : Binary->Functions()) {
-    llvm::SmallSet<BasicBlock *, 8> Visited;
     auto *Entry = GCBI.getBlockAt(Function.Entry());
     revng_assert(Entry != nullptr);
 
     BasicBlockNode *StartNode = BasicBlockNodeMap[Entry];
     revng_assert(StartNode != nullptr);
-    Worklist.emplace_back(Entry);
-
-    while (!Worklist.empty()) {
-      BasicBlock *Current = Worklist.pop_back_val();
-      Visited.insert(Current);
-
-      if (hasMarker(Current, "function_call")) {
-        // If not an indirect call, add the node to the CG
-        if (BasicBlock *Callee = getFunctionCallCallee(Current)) {
-          BasicBlockNode *GraphNode = nullptr;
-          auto It = BasicBlockNodeMap.find(Callee);
-          if (It != BasicBlockNodeMap.end()) {
-            auto IsCurrentSuccessor = [&It](auto &Successor) {
-              return Successor == It->second;
-            };
-            if (not any_of(StartNode->successors(), IsCurrentSuccessor))
-              StartNode->addSuccessor(It->second);
-          }
-        }
-        BasicBlock *Next = getFallthrough(Current);
-        revng_assert(Next != nullptr);
-
-        if (!Visited.contains(Next))
-          Worklist.push_back(Next);
 
-      } else {
-
-        for (BasicBlock *Successor : successors(Current)) {
-          if (not isPartOfRootDispatcher(Successor)
-              && !Visited.contains(Successor)) {
-            revng_assert(Successor != nullptr);
-            Worklist.push_back(Successor);
-          }
-        }
-      }
+    for (BasicBlock *Callee : CallTargets.get(M, Entry)) {
+      auto It = BasicBlockNodeMap.find(Callee);
+      if (It != BasicBlockNodeMap.end())
+        StartNode->addSuccessor(It->second);
     }
   }
 
@@ -355,7 +381,10 @@ void DetectABI::preliminaryFunctionAnalysis() {
     revng_log(Log, "Analyzing " << EntryPointAddress.toString());
     LoggerIndent<> Indent(Log);
 
+    pipeline::FunctionCostScope Cost(EntryPointAddress);
+    pipeline::TargetBudgetScope Budget(EntryPointAddress);
     FunctionSummary AnalysisResult = Analyzer.analyze(EntryNode->Address);
+    Cost.setBlocks(AnalysisResult.CFG.size());
 
     if (Log.isEnabled()) {
       AnalysisResult.dump(Log);
@@ -468,9 +497,24 @@ void DetectABI::analyzeABI() {
   // TODO: this really needs to become a monotone framework
   Task.advance("Run fixed-point analyses");
   llvm::Task FixedPointTask({}, "Fixed-point analysis");
-  UniquedQueue<model::Function *> ToAnalyze;
+
+  // Always analyze first the function that comes first in post-order on the
+  // approximate call graph: this way, callees are (re)analyzed before their
+  // callers and, except within strongly connected components, callers see the
+  // final version of the summaries of their callees. This greatly reduces the
+  // number of times each function needs to be reanalyzed.
+  std::map<MetaAddress, unsigned> PostOrderIndex;
+  for (auto *Node : llvm::post_order(&ApproximateCallGraph))
+    if (Node != ApproximateCallGraph.getEntryNode())
+      PostOrderIndex[Node->Address] = PostOrderIndex.size();
+
+  std::map<unsigned, model::Function *> ToAnalyze;
+  auto Enqueue = [&ToAnalyze, &PostOrderIndex](model::Function &Function) {
+    ToAnalyze.emplace(PostOrderIndex.at(Function.Entry()), &Function);
+  };
+
   for (model::Function &Function : Binary->Functions())
-    ToAnalyze.insert(&Function);
+    Enqueue(Function);
 
   // Change the oracle default prototype to have no arguments nor return values
   {
@@ -482,7 +526,9 @@ void DetectABI::analyzeABI() {
 
   unsigned Runs = 0;
   while (not ToAnalyze.empty()) {
-    model::Function &Function = *ToAnalyze.pop();
+    model::Function &Function = *ToAnalyze.begin()->second;
+    ToAnalyze.erase(ToAnalyze.begin());
+    ++Runs;
     revng_log(Log, "Analyzing " << Function.Entry().toString());
     FixedPointTask.advance(Function.name());
     OutlinedFunction &OutlinedFunction = *Functions.at(Function.Entry());
@@ -499,7 +545,7 @@ void DetectABI::analyzeABI() {
       for (auto &CallerNode : FunctionNode->predecessors()) {
         if (CallerNode->Address.isValid()) {
           revng_log(Log, CallerNode->Address.toString());
-          ToAnalyze.insert(&Binary->Functions().at(CallerNode->Address));
+          Enqueue(Binary->Functions().at(CallerNode->Address));
         }
       }
     }
@@ -509,9 +555,14 @@ void DetectABI::analyzeABI() {
     for (const MetaAddress &ToReanalyze : Changes.Callees) {
       revng_assert(ToReanalyze.isValid());
       revng_log(Log, "Re-enqueing callee " << ToReanalyze.toString());
-      ToAnalyze.insert(&Binary->Functions().at(ToReanalyze));
+      Enqueue(Binary->Functions().at(ToReanalyze));
     }
   }
+
+  revng_log(Log,
+            "Fixed-point reached after " << Runs << " analyses of "
+                                         << Binary->Functions().size()
+                                         << " functions");
 }
 
 Changes DetectABI::analyzeFunctionABI(const model::Function &Function,
@@ -1006,7 +1057,8 @@ Changes DetectABI::runAnalyses(MetaAddress EntryAddress,
                                     Binary->Architecture(),
                                     Analyzer.preCallHook(),
                                     Analyzer.postCallHook(),
-                                    Analyzer.retHook());
+                                    Analyzer.retHook(),
+                                    &RegisterUsageCache);
 
   // We say that a register is callee-saved when, besides being preserved by
   // the callee, there is at least a write onto this register.
@@ -1081,7 +1133,16 @@ bool DetectABIPass::runOnModule(Module &M) {
   FSOracle Oracle = FSOracle::importFullPrototypes(M, GCBI, *Binary);
   CFGAnalyzer Analyzer(M, GCBI, Binary, Oracle);
 
-  DetectABI ABIDetector(M, GCBI, FMC, Binary, Oracle, Analyzer);
+  // Functions are outlined again in analyzeABI, and during the preliminary
+  // analysis when a callee changes
+  Analyzer.cacheOutlinedFunctions();
+
+  // Without a shared cache, call targets are collected from scratch
+  CallTargetsCache LocalCallTargets;
+  CallTargetsCache &Targets = CallTargets != nullptr ? *CallTargets :
+                                                       LocalCallTargets;
+
+  DetectABI ABIDetector(M, GCBI, FMC, Binary, Oracle, Analyzer, Targets);
 
   ABIDetector.run();
 
@@ -133,7 +133,7 @@ bool FunctionSummaryOracle::registerLocalFunction(MetaAddress PC,
 
 bool FunctionSummaryOracle::registerDynamicFunction(llvm::StringRef Name,
                                                     FunctionSummary &&New) {
-  auto It = DynamicFunctions.find(Name.str());
+  auto It = DynamicFunctions.find(Name);
   if (It != DynamicFunctions.end()) {
     auto &Recorded = It->second;
     bool Changed = not New.containedOrEqual(Recorded);
@@ -153,62 +153,69 @@ const FunctionSummary &FunctionSummaryOracle::getDefault() {
 }
 
 FunctionSummary &FunctionSummaryOracle::getLocalFunction(MetaAddress PC) {
-  if (not LocalFunctions.contains(PC)) {
-    const model::Function &Function = Binary.Functions().at(PC);
-    AttributesSet Attributes;
-    for (auto &ToCopy : Function.Attributes())
-      Attributes.insert(ToCopy);
+  auto It = LocalFunctions.find(PC);
+  if (It != LocalFunctions.end())
+    return It->second;
 
-    const auto *Prototype = Binary.prototypeOrDefault(Function.prototype());
-    auto Summary = Importer.prototype(Attributes, Prototype);
-    registerLocalFunction(Function.Entry(), std::move(Summary));
-  }
+  const model::Function &Function = Binary.Functions().at(PC);
+  AttributesSet Attributes;
+  for (auto &ToCopy : Function.Attributes())
+    Attributes.insert(ToCopy);
 
+  const auto *Prototype = Binary.prototypeOrDefault(Function.prototype());
+  auto Summary = Importer.prototype(Attributes, Prototype);
+  registerLocalFunction(Function.Entry(), std::move(Summary));
   return LocalFunctions.at(PC);
 }
 
 const FunctionSummary &
 FunctionSummaryOracle::getDynamicFunction(llvm::StringRef Name) {
-  if (not DynamicFunctions.contains(Name.str())) {
-    const auto &DynamicFunction = Binary.ImportedDynamicFunctions()
-                                    .at(Name.str());
-    auto *Prototype = Binary.prototypeOrDefault(DynamicFunction.prototype());
+  auto It = DynamicFunctions.find(Name);
+  if (It != DynamicFunctions.end())
+    return It->second;
 
-    AttributesSet Attributes;
-    for (auto &ToCopy : DynamicFunction.Attributes())
-      Attributes.insert(ToCopy);
+  const auto &DynamicFunction = Binary.ImportedDynamicFunctions()
+                                  .at(Name.str());
+  auto *Prototype = Binary.prototypeOrDefault(DynamicFunction.prototype());
 
-    registerDynamicFunction(DynamicFunction.OriginalName(),
-                            Importer.prototype(Attributes, Prototype));
-  }
-  return DynamicFunctions.at(Name.str());
+  AttributesSet Attributes;
+  for (auto &ToCopy : DynamicFunction.Attributes())
+    Attributes.insert(ToCopy);
+
+  auto Summary = Importer.prototype(Attributes, Prototype);
+  return DynamicFunctions.emplace(Name.str(), std::move(Summary)).first->second;
 }
 
 std::pair<FunctionSummary *, bool>
 FunctionSummaryOracle::getExactCallSite(MetaAddress Entry,
                                         BasicBlockID CallSiteAddress) {
-  auto It = CallSites.find({ Entry, CallSiteAddress });
-  if (It == CallSites.end()) {
-    // Note: in case of absence we're doing the lookup every time, not super
-    // efficient.
-
-    const model::Function &Function = Binary.Functions().at(Entry);
-
-    // TODO: should CallSitePrototypes be index by BasicBlockID?
-    if (auto *CallSite = Function.CallSitePrototypes()
-                           .tryGet(CallSiteAddress.start())) {
-
-      AttributesSet Attributes;
-      for (auto &ToCopy : CallSite->Attributes())
-        Attributes.insert(ToCopy);
-      registerCallSite(Function.Entry(),
-                       BasicBlockID(CallSite->CallerBlockAddress()),
-                       Importer.prototype(Attributes, CallSite->prototype()),
-                       CallSite->IsTailCall());
-    }
+  std::pair<MetaAddress, BasicBlockID> Key = { Entry, CallSiteAddress };
+  auto It = CallSites.find(Key);
+  if (It != CallSites.end())
+    return { &It->second.first, It->second.second };
+
+  // Don't look up the model again for call sites known to have no override
+  if (CallSitesWithoutOverride.contains(Key))
+    return { nullptr, false };
+
+  const model::Function &Function = Binary.Functions().at(Entry);
+
+  // TODO: should CallSitePrototypes be index by BasicBlockID?
+  if (auto *CallSite = Function.CallSitePrototypes()
+                         .tryGet(CallSiteAddress.start())) {
+
+    AttributesSet Attributes;
+    for (auto &ToCopy : CallSite->Attributes())
+      Attributes.insert(ToCopy);
+    registerCallSite(Function.Entry(),
+                     BasicBlockID(CallSite->CallerBlockAddress()),
+                     Importer.prototype(Attributes, CallSite->prototype()),
+                     CallSite->IsTailCall());
   }
-  It = CallSites.find({ Entry, CallSiteAddress });
+
+  It = CallSites.find(Key);
   if (It == CallSites.end()) {
+    CallSitesWithoutOverride.insert(Key);
     return { nullptr, false };
   } else {
     return { &It->second.first, It->second.second };
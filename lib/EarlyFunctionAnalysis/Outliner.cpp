@@ -538,9 +538,14 @@ private:
 };
 
 OutlinedFunction Outliner::outline(const MetaAddress &Entry,
-                                   CallHandler *Handler) {
+                                   CallHandler *Handler,
+                                   CallSiteInputs *Inputs) {
   using namespace llvm;
 
+  Recording = Inputs;
+  if (Recording != nullptr)
+    Recording->clear();
+
   OutlinedFunction Result;
   OutlinedFunctionsMap FunctionsToInline(&M);
 
@@ -551,6 +556,8 @@ OutlinedFunction Outliner::outline(const MetaAddress &Entry,
 
     // Restart isolating functions
     FunctionsToInline.clear();
+    if (Recording != nullptr)
+      Recording->clear();
 
     // Outline functions but do not perform inlining
     Result = outlineFunctionInternal(Handler, Entry, FunctionsToInline);
@@ -613,9 +620,48 @@ OutlinedFunction Outliner::outline(const MetaAddress &Entry,
 
   createAnyPCHooks(Handler, &Result);
 
+  Recording = nullptr;
+
   return Result;
 }
 
+static CallSiteInput makeCallSiteInput(MetaAddress CallerFunction,
+                                       BasicBlockID CallSite,
+                                       MetaAddress Callee,
+                                       llvm::StringRef CalledSymbol,
+                                       const FunctionSummary &Summary,
+                                       bool IsTailCall) {
+  CallSiteInput Result;
+  Result.CallerFunction = CallerFunction;
+  Result.CallSite = CallSite;
+  Result.Callee = Callee;
+  Result.CalledSymbol = CalledSymbol.str();
+  Result.Attributes = Summary.Attributes;
+  Result.ClobberedRegisters = Summary.ClobberedRegisters;
+  Result.ElectedFSO = Summary.ElectedFSO;
+  Result.IsTailCall = IsTailCall;
+  return Result;
+}
+
+bool Outliner::isUpToDate(const CallSiteInputs &Inputs) {
+  for (const CallSiteInput &Input : Inputs) {
+    auto [Summary, IsTailCall] = Oracle.getCallSite(Input.CallerFunction,
+                                                    Input.CallSite,
+                                                    Input.Callee,
+                                                    Input.CalledSymbol);
+    if (makeCallSiteInput(Input.CallerFunction,
+                          Input.CallSite,
+                          Input.Callee,
+                          Input.CalledSymbol,
+                          *Summary,
+                          IsTailCall)
+        != Input)
+      return false;
+  }
+
+  return true;
+}
+
 llvm::Function *
 Outliner::createFunctionToInline(CallHandler *TheCallHandler,
                                  const MetaAddress &Entry,
@@ -670,10 +716,21 @@ Outliner::getCallSiteInfo(MetaAddress CallerFunction,
     CalledSymbol = extractFromConstantStringPtr(JumpToSymbol->getArgOperand(0));
   }
 
-  return Oracle.getCallSite(CallerFunction,
-                            CallSiteAddress,
-                            Callee,
-                            CalledSymbol);
+  auto Result = Oracle.getCallSite(CallerFunction,
+                                   CallSiteAddress,
+                                   Callee,
+                                   CalledSymbol);
+
+  if (Recording != nullptr) {
+    Recording->push_back(makeCallSiteInput(CallerFunction,
+                                           CallSiteAddress,
+                                           Callee,
+                                           CalledSymbol,
+                                           *Result.first,
+                                           Result.second));
+  }
+
+  return Result;
 }
 
 } // namespace efa
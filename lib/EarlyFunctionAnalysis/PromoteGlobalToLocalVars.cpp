@@ -35,16 +35,18 @@ PromoteGlobalToLocalPass::run(llvm::Function &F,
     }
   }
 
-  // Create an equivalent local variable, replace all the uses of the CSV.
+  // Create an equivalent local variable for each CSV
   IRBuilder<> Builder(&F.getEntryBlock().front());
   for (GlobalVariable *CSV : toSortedByName(llvm::make_first_range(CSVMap))) {
     auto *CSVTy = CSV->getValueType();
-    auto *Alloca = Builder.CreateAlloca(CSVTy, nullptr, CSV->getName());
-    replaceAllUsesInFunctionWith(&F, CSV, Alloca);
-
-    CSVMap[CSV] = Alloca;
+    CSVMap[CSV] = Builder.CreateAlloca(CSVTy, nullptr, CSV->getName());
   }
 
+  // Replace all the uses of the CSVs in a single pass over F. Replacing them
+  // one at a time would go through the uses of each CSV in the whole module,
+  // for each function.
+  replaceGlobalsInFunction(F, CSVMap);
+
   // Load all the CSVs and store their value onto the local variables.
   for (const auto &[CSV, Alloca] : CSVMap)
     Builder.CreateStore(createLoad(Builder, CSV), Alloca);
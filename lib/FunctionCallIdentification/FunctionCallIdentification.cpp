@@ -6,9 +6,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+#include <vector>
+
 #include "revng/FunctionCallIdentification/FunctionCallIdentification.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/FunctionTags.h"
+#include "revng/Support/ParallelMap.h"
 
 using namespace llvm;
 
@@ -21,6 +25,251 @@ static RegisterPass<FunctionCallIdentification> X("fci",
 
 static Logger<> FilteredCFGLog("filtered-cfg");
 
+namespace {
+
+/// To be a function call we need to find:
+///
+/// * a call to "newpc"
+/// * a store of the next PC
+/// * a store to the PC
+struct Visitor
+  : public BFSVisitorBase<false, Visitor, SmallVector<BasicBlock *, 4>> {
+public:
+  using SuccessorsType = SmallVector<BasicBlock *, 4>;
+
+public:
+  BasicBlock *BB = nullptr;
+  const GeneratedCodeBasicInfo &GCBI;
+  bool SaveRAFound;
+  bool StorePCFound;
+  Constant *LinkRegister = nullptr;
+  const MetaAddress ReturnPC;
+  MetaAddress LastPC;
+
+  // We can meet calls up to newpc up to (1 + "size of the delay slot")
+  // times
+  uint64_t NewPCLeft;
+  Constant *StackLinkRegister = nullptr;
+
+public:
+  Visitor(BasicBlock *BB,
+          const GeneratedCodeBasicInfo &GCBI,
+          MetaAddress ReturnPC,
+          Constant *StackLinkRegister) :
+    BB(BB),
+    GCBI(GCBI),
+    SaveRAFound(false),
+    StorePCFound(false),
+    LinkRegister(nullptr),
+    ReturnPC(ReturnPC),
+    LastPC(ReturnPC),
+    NewPCLeft(1),
+    StackLinkRegister(StackLinkRegister) {}
+
+public:
+  VisitAction visit(instruction_range Range) {
+    for (Instruction &I : Range) {
+      if (auto *Store = dyn_cast<StoreInst>(&I)) {
+        Value *V = Store->getValueOperand();
+        Value *Pointer = skipCasts(Store->getPointerOperand());
+        auto *TargetCSV = dyn_cast<GlobalVariable>(Pointer);
+
+        if (GCBI.isPCReg(TargetCSV)) {
+          if (TargetCSV != nullptr)
+            StorePCFound = true;
+        } else if (TargetCSV != nullptr
+                   and not GCBI.isABIRegister(TargetCSV)) {
+          // Ignore writes to non-ABI registers
+        } else if (auto *Constant = dyn_cast<ConstantInt>(V)) {
+          revng_assert(LastPC.isValid());
+
+          // Note that we willingly ignore stores to the PC here
+          uint64_t StoredValue = Constant->getLimitedValue();
+          auto StoredMA = MetaAddress::fromPC(LastPC, StoredValue);
+          if (StoredMA == ReturnPC) {
+            if (SaveRAFound) {
+              SaveRAFound = false;
+              return StopNow;
+            }
+            SaveRAFound = true;
+
+            // Find where the return address is being stored
+            revng_assert(LinkRegister == nullptr);
+            if (TargetCSV != nullptr) {
+              // The return address is being written to a register
+              LinkRegister = TargetCSV;
+            } else {
+              // The return address is likely being written on the stack, we
+              // have to check the last value on the stack and check if
+              // we're writing there. This should cover basically all the
+              // cases, and, if not, expanding this should be
+              // straightforward
+
+              // Reference example:
+              //
+              // %1 = load i64, i64* @rsp
+              // %2 = sub i64 %1, 8
+              // %3 = inttoptr i64 %2 to i64*
+              // store i64 4194694, i64* %3
+              // store i64 %2, i64* @rsp
+              // store i64 4194704, i64* @pc
+
+              // Find the last write to the stack pointer
+              Value *LastStackPointer = nullptr;
+              for (Instruction &I : make_range(BB->rbegin(), BB->rend())) {
+                if (auto *S = dyn_cast<StoreInst>(&I)) {
+                  Value *Pointer = skipCasts(S->getPointerOperand());
+                  auto *P = dyn_cast<GlobalVariable>(Pointer);
+                  if (P != nullptr && GCBI.isSPReg(P)) {
+                    LastStackPointer = Store->getPointerOperand();
+                    break;
+                  }
+                }
+              }
+              revng_assert(LastStackPointer != nullptr);
+              revng_assert(skipCasts(LastStackPointer) == Pointer);
+
+              // If LinkRegister is nullptr it means the return address is
+              // being pushed on the top of the stack
+              LinkRegister = StackLinkRegister;
+            }
+          }
+        }
+      } else if (auto *Call = dyn_cast<CallInst>(&I)) {
+        auto *Callee = getCalledFunction(Call);
+        if (Callee != nullptr && Callee->getName() == "newpc") {
+          revng_assert(NewPCLeft > 0);
+
+          Value *PCOperand = Call->getOperand(0);
+          auto ProgramCounter = MetaAddress::fromValue(PCOperand);
+          uint64_t InstructionSize = getLimitedValue(Call->getOperand(1));
+
+          // Check that, w.r.t. to the last newpc, we're looking at the
+          // immediately preceding instruction, if not fail.
+          if (ProgramCounter + InstructionSize != LastPC)
+            return StopNow;
+
+          // Update the last seen PC
+          LastPC = ProgramCounter;
+
+          NewPCLeft--;
+          if (NewPCLeft == 0)
+            return StopNow;
+        }
+      }
+    }
+
+    return Continue;
+  }
+
+  SuccessorsType successors(BasicBlock *BB) {
+    SuccessorsType Successors;
+    for (BasicBlock *Successor : make_range(pred_begin(BB), pred_end(BB)))
+      if (not BB->empty() and GCBI.isTranslated(Successor))
+        Successors.push_back(Successor);
+    return Successors;
+  }
+};
+
+
+/// What has been found out about a basic block terminated by a call
+struct CallSite {
+  BasicBlock *BB = nullptr;
+  MetaAddress ReturnPC;
+
+  /// If false, the call has been identified by a previous run
+  bool New = false;
+
+  BasicBlock *ReturnBB = nullptr;
+
+  /// nullptr if the callee is not known
+  BasicBlock *Callee = nullptr;
+
+  Constant *LinkRegister = nullptr;
+};
+
+} // namespace
+
+/// Detect whether \p BB ends with a function call
+///
+/// This only inspects the IR, so it can run concurrently on different basic
+/// blocks.
+static std::optional<CallSite> analyzeBlock(BasicBlock *BB,
+                                            GeneratedCodeBasicInfo &GCBI,
+                                            Constant *StackLinkRegister) {
+  if (BB->empty() or not GCBI.isTranslated(BB))
+    return std::nullopt;
+
+  // Consider the basic block only if it's terminator is an actual jump and it
+  // hasn't been already marked as a function call
+  Instruction *Terminator = BB->getTerminator();
+
+  if (Terminator != nullptr) {
+    if (CallInst *Call = getMarker(Terminator, "function_call")) {
+      CallSite Result;
+      Result.BB = BB;
+      Result.ReturnPC = MetaAddress::fromValue(Call->getOperand(2));
+      return Result;
+    }
+  }
+
+  if (not GCBI.isJump(Terminator))
+    return std::nullopt;
+
+  MetaAddress ReturnPC = GCBI.getNextPC(Terminator);
+  Visitor V(BB, GCBI, ReturnPC, StackLinkRegister);
+  V.run(Terminator);
+
+  BasicBlock *ReturnBB = GCBI.getBlockAt(ReturnPC);
+  if (not(V.SaveRAFound and V.StorePCFound and V.NewPCLeft == 0
+          and ReturnBB != nullptr))
+    return std::nullopt;
+
+  // It's a function call
+
+  // If there is a single successor it can be anypc or an actual callee
+  // basic block, both cases are fine. If there's more than one successor,
+  // we want to register only the default successor of the switch statement
+  // (typically anypc).
+  // TODO: register in the call to function_call multiple call targets
+  unsigned SuccessorsCount = Terminator->getNumSuccessors();
+  BasicBlock *Callee = nullptr;
+
+  if (SuccessorsCount == 1) {
+    auto *Succ = Terminator->getSuccessor(0);
+
+    if (Succ == GCBI.unexpectedPC())
+      return std::nullopt;
+
+    if (GCBI.isTranslated(Succ))
+      Callee = Succ;
+  } else if (SuccessorsCount > 1) {
+    // If there are multiple successors, at least one should not be a jump
+    // target
+    bool Found = false;
+    for (BasicBlock *Successor : successors(BB)) {
+      if (not isJumpTarget(Successor)) {
+        // There should be only one non-jump target successor (i.e., anypc
+        // or unepxectedpc).
+        revng_assert(!Found);
+        Found = true;
+      }
+    }
+    revng_assert(Found);
+
+    // It's an indirect call
+  }
+
+  CallSite Result;
+  Result.BB = BB;
+  Result.ReturnPC = ReturnPC;
+  Result.New = true;
+  Result.ReturnBB = ReturnBB;
+  Result.Callee = Callee;
+  Result.LinkRegister = V.LinkRegister;
+  return Result;
+}
+
 bool FunctionCallIdentification::runOnModule(llvm::Module &M) {
   revng_log(PassesLog, "Starting FunctionCallIdentification");
 
@@ -52,240 +301,55 @@ bool FunctionCallIdentification::runOnModule(llvm::Module &M) {
     revng_assert(FunctionCall->user_begin() == FunctionCall->user_end());
   }
 
-  // Collect function calls
-  for (BasicBlock &BB : F) {
+  // Collect function calls. The analysis of each basic block only reads the
+  // IR, so it's performed in parallel, making sure the root function has
+  // already been parsed and the constants we need already exist. The IR is
+  // then updated in the original order of the basic blocks.
+  GCBI.root();
+  auto *StackLinkRegister = ConstantPointerNull::get(PCPtrTy);
+  std::vector<BasicBlock *> Blocks;
+  Blocks.reserve(F.size());
+  for (BasicBlock &BB : F)
+    Blocks.push_back(&BB);
+
+  auto Analyze = [&GCBI, StackLinkRegister](BasicBlock *BB) {
+    return analyzeBlock(BB, GCBI, StackLinkRegister);
+  };
+  auto CallSites = parallelMap(ArrayRef<BasicBlock *>(Blocks), Analyze);
 
-    if (BB.empty() or not GCBI.isTranslated(&BB))
+  for (const std::optional<CallSite> &MaybeCallSite : CallSites) {
+    if (not MaybeCallSite)
       continue;
 
-    // Consider the basic block only if it's terminator is an actual jump and it
-    // hasn't been already marked as a function call
-    Instruction *Terminator = BB.getTerminator();
-
-    if (Terminator != nullptr) {
-      if (CallInst *Call = getMarker(Terminator, "function_call")) {
-        auto Address = MetaAddress::fromValue(Call->getOperand(2));
-        FallthroughAddresses.insert(Address);
-        continue;
-      }
-    }
-
-    if (not GCBI.isJump(Terminator))
+    const CallSite &Call = *MaybeCallSite;
+    FallthroughAddresses.insert(Call.ReturnPC);
+    if (not Call.New)
       continue;
 
-    // To be a function call we need to find:
-    //
-    // * a call to "newpc"
-    // * a store of the next PC
-    // * a store to the PC
-    struct Visitor
-      : public BFSVisitorBase<false, Visitor, SmallVector<BasicBlock *, 4>> {
-    public:
-      using SuccessorsType = SmallVector<BasicBlock *, 4>;
-
-    public:
-      BasicBlock *BB = nullptr;
-      const GeneratedCodeBasicInfo &GCBI;
-      bool SaveRAFound;
-      bool StorePCFound;
-      Constant *LinkRegister = nullptr;
-      const MetaAddress ReturnPC;
-      MetaAddress LastPC;
-
-      // We can meet calls up to newpc up to (1 + "size of the delay slot")
-      // times
-      uint64_t NewPCLeft;
-      PointerType *PCPtrTy = nullptr;
-
-    public:
-      Visitor(BasicBlock *BB,
-              const GeneratedCodeBasicInfo &GCBI,
-              MetaAddress ReturnPC,
-              PointerType *PCPtrTy) :
-        BB(BB),
-        GCBI(GCBI),
-        SaveRAFound(false),
-        StorePCFound(false),
-        LinkRegister(nullptr),
-        ReturnPC(ReturnPC),
-        LastPC(ReturnPC),
-        NewPCLeft(1),
-        PCPtrTy(PCPtrTy) {}
-
-    public:
-      VisitAction visit(instruction_range Range) {
-        for (Instruction &I : Range) {
-          if (auto *Store = dyn_cast<StoreInst>(&I)) {
-            Value *V = Store->getValueOperand();
-            Value *Pointer = skipCasts(Store->getPointerOperand());
-            auto *TargetCSV = dyn_cast<GlobalVariable>(Pointer);
-
-            if (GCBI.isPCReg(TargetCSV)) {
-              if (TargetCSV != nullptr)
-                StorePCFound = true;
-            } else if (TargetCSV != nullptr
-                       and not GCBI.isABIRegister(TargetCSV)) {
-              // Ignore writes to non-ABI registers
-            } else if (auto *Constant = dyn_cast<ConstantInt>(V)) {
-              revng_assert(LastPC.isValid());
-
-              // Note that we willingly ignore stores to the PC here
-              uint64_t StoredValue = Constant->getLimitedValue();
-              auto StoredMA = MetaAddress::fromPC(LastPC, StoredValue);
-              if (StoredMA == ReturnPC) {
-                if (SaveRAFound) {
-                  SaveRAFound = false;
-                  return StopNow;
-                }
-                SaveRAFound = true;
-
-                // Find where the return address is being stored
-                revng_assert(LinkRegister == nullptr);
-                if (TargetCSV != nullptr) {
-                  // The return address is being written to a register
-                  LinkRegister = TargetCSV;
-                } else {
-                  // The return address is likely being written on the stack, we
-                  // have to check the last value on the stack and check if
-                  // we're writing there. This should cover basically all the
-                  // cases, and, if not, expanding this should be
-                  // straightforward
-
-                  // Reference example:
-                  //
-                  // %1 = load i64, i64* @rsp
-                  // %2 = sub i64 %1, 8
-                  // %3 = inttoptr i64 %2 to i64*
-                  // store i64 4194694, i64* %3
-                  // store i64 %2, i64* @rsp
-                  // store i64 4194704, i64* @pc
-
-                  // Find the last write to the stack pointer
-                  Value *LastStackPointer = nullptr;
-                  for (Instruction &I : make_range(BB->rbegin(), BB->rend())) {
-                    if (auto *S = dyn_cast<StoreInst>(&I)) {
-                      Value *Pointer = skipCasts(S->getPointerOperand());
-                      auto *P = dyn_cast<GlobalVariable>(Pointer);
-                      if (P != nullptr && GCBI.isSPReg(P)) {
-                        LastStackPointer = Store->getPointerOperand();
-                        break;
-                      }
-                    }
-                  }
-                  revng_assert(LastStackPointer != nullptr);
-                  revng_assert(skipCasts(LastStackPointer) == Pointer);
-
-                  // If LinkRegister is nullptr it means the return address is
-                  // being pushed on the top of the stack
-                  LinkRegister = ConstantPointerNull::get(PCPtrTy);
-                }
-              }
-            }
-          } else if (auto *Call = dyn_cast<CallInst>(&I)) {
-            auto *Callee = getCalledFunction(Call);
-            if (Callee != nullptr && Callee->getName() == "newpc") {
-              revng_assert(NewPCLeft > 0);
-
-              Value *PCOperand = Call->getOperand(0);
-              auto ProgramCounter = MetaAddress::fromValue(PCOperand);
-              uint64_t InstructionSize = getLimitedValue(Call->getOperand(1));
-
-              // Check that, w.r.t. to the last newpc, we're looking at the
-              // immediately preceding instruction, if not fail.
-              if (ProgramCounter + InstructionSize != LastPC)
-                return StopNow;
-
-              // Update the last seen PC
-              LastPC = ProgramCounter;
-
-              NewPCLeft--;
-              if (NewPCLeft == 0)
-                return StopNow;
-            }
-          }
-        }
-
-        return Continue;
-      }
+    // Emit a call to "function_call" with three parameters: the first is the
+    // callee basic block, the second the return basic block and the third is
+    // the return address
+    Value *Callee = Int8NullPtr;
+    if (Call.Callee != nullptr)
+      Callee = BlockAddress::get(Call.Callee);
 
-      SuccessorsType successors(BasicBlock *BB) {
-        SuccessorsType Successors;
-        for (BasicBlock *Successor : make_range(pred_begin(BB), pred_end(BB)))
-          if (not BB->empty() and GCBI.isTranslated(Successor))
-            Successors.push_back(Successor);
-        return Successors;
-      }
+    Value *ReturnPCValue = Call.ReturnPC.toValue(&M);
+    const std::initializer_list<Value *> Args{
+      Callee, BlockAddress::get(Call.ReturnBB), ReturnPCValue, Call.LinkRegister
     };
 
-    MetaAddress ReturnPC = GCBI.getNextPC(Terminator);
-    Visitor V(&BB, GCBI, ReturnPC, PCPtrTy);
-    V.run(Terminator);
-
-    BasicBlock *ReturnBB = GCBI.getBlockAt(ReturnPC);
-    if (V.SaveRAFound and V.StorePCFound and V.NewPCLeft == 0
-        and ReturnBB != nullptr) {
-      // It's a function call, register it
-
-      // Emit a call to "function_call" with three parameters: the first is the
-      // callee basic block, the second the return basic block and the third is
-      // the return address
-
-      // If there is a single successor it can be anypc or an actual callee
-      // basic block, both cases are fine. If there's more than one successor,
-      // we want to register only the default successor of the switch statement
-      // (typically anypc).
-      // TODO: register in the call to function_call multiple call targets
-      unsigned SuccessorsCount = Terminator->getNumSuccessors();
-      Value *Callee = nullptr;
-
-      if (SuccessorsCount == 0) {
-        Callee = Int8NullPtr;
-      } else if (SuccessorsCount == 1) {
-        auto *Succ = Terminator->getSuccessor(0);
-
-        if (Succ == GCBI.unexpectedPC())
-          continue;
-
-        bool IsTranslated = GCBI.isTranslated(Succ);
-        Callee = IsTranslated ? static_cast<Value *>(BlockAddress::get(Succ)) :
-                                static_cast<Value *>(Int8NullPtr);
-      } else {
-        // If there are multiple successors, at least one should not be a jump
-        // target
-        bool Found = false;
-        for (BasicBlock *Successor : successors(Terminator->getParent())) {
-          if (not isJumpTarget(Successor)) {
-            // There should be only one non-jump target successor (i.e., anypc
-            // or unepxectedpc).
-            revng_assert(!Found);
-            Found = true;
-          }
-        }
-        revng_assert(Found);
-
-        // It's an indirect call
-        Callee = Int8NullPtr;
-      }
-
-      Value *ReturnPCValue = ReturnPC.toValue(getModule(ReturnBB));
-      const std::initializer_list<Value *> Args{
-        Callee, BlockAddress::get(ReturnBB), ReturnPCValue, V.LinkRegister
-      };
-
-      FallthroughAddresses.insert(ReturnPC);
-
-      // If the instruction before the terminator is a call to exitTB, inject
-      // the call to function_call before it, so it doesn't get purged
-      auto It = Terminator->getIterator();
-      if (It != Terminator->getParent()->begin()) {
-        auto PrevIt = It;
-        PrevIt--;
-        if (isCallTo(&*PrevIt, "exitTB"))
-          It = PrevIt;
-      }
-
-      CallInst::Create(FunctionCall, Args, "", &*It);
+    // If the instruction before the terminator is a call to exitTB, inject
+    // the call to function_call before it, so it doesn't get purged
+    Instruction *Terminator = Call.BB->getTerminator();
+    auto It = Terminator->getIterator();
+    if (It != Call.BB->begin()) {
+      auto PrevIt = It;
+      PrevIt--;
+      if (isCallTo(&*PrevIt, "exitTB"))
+        It = PrevIt;
     }
+
+    CallInst::Create(FunctionCall, Args, "", &*It);
   }
 
   buildFilteredCFG(F);
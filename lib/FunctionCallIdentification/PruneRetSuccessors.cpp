@@ -5,8 +5,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
 #include "revng/FunctionCallIdentification/PruneRetSuccessors.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/ParallelMap.h"
 
 using namespace llvm;
 
@@ -48,27 +55,32 @@ struct SuccessorsList {
   }
 };
 
+/// \param Visited if not null, will be populated with the basic blocks that
+///        have been explored.
 static SuccessorsList getSuccessors(GeneratedCodeBasicInfo &GCBI,
-                                    BasicBlock *BB) {
+                                    BasicBlock *BB,
+                                    SmallPtrSetImpl<BasicBlock *> *Visited) {
   bool IsRoot = BB->getParent() == GCBI.root();
 
   SuccessorsList Result;
 
-  df_iterator_default_set<BasicBlock *> Visited;
+  df_iterator_default_set<BasicBlock *> LocalVisited;
+  if (Visited == nullptr)
+    Visited = &LocalVisited;
 
   if (IsRoot) {
-    Visited.insert(GCBI.anyPC());
-    Visited.insert(GCBI.unexpectedPC());
+    Visited->insert(GCBI.anyPC());
+    Visited->insert(GCBI.unexpectedPC());
   }
 
-  for (BasicBlock *Block : depth_first_ext(BB, Visited)) {
+  for (BasicBlock *Block : depth_first_ext(BB, *Visited)) {
     for (BasicBlock *Successor : successors(Block)) {
       revng_assert(Successor != GCBI.dispatcher());
 
       MetaAddress Address = getBasicBlockID(Successor).start();
       const auto IBDHB = BlockType::IndirectBranchDispatcherHelperBlock;
       if (Address.isValid()) {
-        Visited.insert(Successor);
+        Visited->insert(Successor);
         Result.Addresses.insert(Address);
       } else if (IsRoot and Successor == GCBI.anyPC()) {
         Result.AnyPC = true;
@@ -85,33 +97,65 @@ static SuccessorsList getSuccessors(GeneratedCodeBasicInfo &GCBI,
   return Result;
 }
 
+/// Check whether the terminator of \p BB can be replaced by a jump to anypc
+static bool canPrune(const SuccessorsList &Successors,
+                     const FunctionCallIdentification &FCI) {
+  if (not Successors.UnexpectedPC or Successors.Other)
+    return false;
+
+  revng_assert(not Successors.AnyPC);
+  for (MetaAddress SuccessorMA : Successors.Addresses)
+    if (not FCI.isFallthrough(SuccessorMA))
+      return false;
+
+  return true;
+}
+
 bool PruneRetSuccessors::runOnModule(llvm::Module &M) {
   auto &GCBI = getAnalysis<GeneratedCodeBasicInfoWrapperPass>().getGCBI();
   auto &FCI = getAnalysis<FunctionCallIdentification>();
 
-  for (BasicBlock &BB : *GCBI.root()) {
-    if (not GCBI.isTranslated(&BB)
-        or BB.getTerminator()->getNumSuccessors() < 2)
+  // Look for the candidates in parallel, on the unchanged IR, recording the
+  // basic blocks explored to reach a decision
+  struct Candidate {
+    BasicBlock *BB = nullptr;
+    SmallPtrSet<BasicBlock *, 8> Visited;
+  };
+
+  std::vector<BasicBlock *> Blocks;
+  for (BasicBlock &BB : *GCBI.root())
+    if (GCBI.isTranslated(&BB) and BB.getTerminator()->getNumSuccessors() >= 2)
+      Blocks.push_back(&BB);
+
+  auto Analyze = [&GCBI, &FCI](BasicBlock *BB) -> std::optional<Candidate> {
+    Candidate Result;
+    Result.BB = BB;
+    if (not canPrune(getSuccessors(GCBI, BB, &Result.Visited), FCI))
+      return std::nullopt;
+    return Result;
+  };
+  auto Candidates = parallelMap(ArrayRef<BasicBlock *>(Blocks), Analyze);
+
+  // Prune the candidates in their original order. If a candidate reached a
+  // basic block which has been pruned in the meantime, the outcome might have
+  // changed: in that case, analyze it again.
+  SmallPtrSet<BasicBlock *, 16> Pruned;
+  for (std::optional<Candidate> &MaybeCandidate : Candidates) {
+    if (not MaybeCandidate)
       continue;
 
-    auto Successors = getSuccessors(GCBI, &BB);
-    if (not Successors.UnexpectedPC or Successors.Other)
+    BasicBlock &BB = *MaybeCandidate->BB;
+    bool Stale = llvm::any_of(MaybeCandidate->Visited, [&](BasicBlock *Block) {
+      return Pruned.contains(Block);
+    });
+    if (Stale and not canPrune(getSuccessors(GCBI, &BB, nullptr), FCI))
       continue;
 
-    revng_assert(not Successors.AnyPC);
-    bool AllFallthrough = true;
-    for (MetaAddress SuccessorMA : Successors.Addresses) {
-      if (not FCI.isFallthrough(SuccessorMA)) {
-        AllFallthrough = false;
-      }
-    }
-
-    if (AllFallthrough) {
-      Instruction *OldTerminator = BB.getTerminator();
-      auto *NewTerminator = BranchInst::Create(GCBI.anyPC(), &BB);
-      NewTerminator->copyMetadata(*OldTerminator);
-      eraseFromParent(OldTerminator);
-    }
+    Instruction *OldTerminator = BB.getTerminator();
+    auto *NewTerminator = BranchInst::Create(GCBI.anyPC(), &BB);
+    NewTerminator->copyMetadata(*OldTerminator);
+    eraseFromParent(OldTerminator);
+    Pruned.insert(&BB);
   }
 
   return true;
@@ -6,6 +6,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/CFG.h"
@@ -53,8 +54,14 @@ private:
 private:
   const model::Binary &Binary;
   llvm::Module &M;
-  std::map<Function *, Function *> OldToNew;
+  llvm::DenseMap<Function *, Function *> OldToNew;
   std::vector<Function *> OldFunctions;
+  /// CSV of each register, nullptr if it does not exist in the module
+  std::map<model::Register::Values, GlobalVariable *> CSVs;
+
+  /// Registers used by the prototypes, cleared for each function so that each
+  /// of them reads the prototypes it depends upon
+  abi::FunctionType::LayoutCache Layouts;
   Function *FunctionDispatcher = nullptr;
   StructInitializers Initializers;
   ControlFlowGraphCache &Cache;
@@ -95,6 +102,14 @@ private:
   void createPrologue(Function *NewFunction,
                       const UsedRegisters &UsedRegisters);
 
+  GlobalVariable *tryGetCSV(model::Register::Values Register);
+
+  Value *loadCSVOrUndef(IRBuilder<> &Builder,
+                        model::Register::Values Register);
+
+  std::pair<Type *, Constant *>
+  getCSVOrUndef(model::Register::Values Register);
+
   void handleRegularFunctionCall(const MetaAddress &CallerAddress,
                                  CallInst *Call);
   CallInst *generateCall(IRBuilder<> &Builder,
@@ -134,7 +149,7 @@ bool EnforceABI::prologue() {
 
     const auto *ProtoT = Binary.prototypeOrDefault(FunctionModel.prototype());
     revng_assert(ProtoT != nullptr);
-    auto UsedRegisters = abi::FunctionType::usedRegisters(*ProtoT);
+    const auto &UsedRegisters = Layouts.usedRegisters(*ProtoT);
     Function *NewFunction = recreateFunction(*OldFunction, UsedRegisters);
 
     // EnforceABI currently does not support execution
@@ -152,12 +167,14 @@ bool EnforceABI::prologue() {
 bool EnforceABI::runOnFunction(const model::Function &FunctionModel,
                                llvm::Function &OldFunction) {
   revng_assert(not FunctionModel.name().empty());
+  Layouts.clear();
+
   auto OldFunctionName = getLLVMFunctionName(FunctionModel);
 
   // Recreate the function with the right prototype and the function prologue
   const auto *ProtoT = Binary.prototypeOrDefault(FunctionModel.prototype());
   revng_assert(ProtoT != nullptr);
-  auto UsedRegisters = abi::FunctionType::usedRegisters(*ProtoT);
+  const auto &UsedRegisters = Layouts.usedRegisters(*ProtoT);
   Function *NewFunction = getOrCreateNewFunction(OldFunction, UsedRegisters);
 
   // Collect function calls
@@ -184,6 +201,13 @@ bool EnforceABI::runOnFunction(const model::Function &FunctionModel,
 }
 
 bool EnforceABI::epilogue() {
+  // The table of the function dispatcher, if any, refers to the old functions
+  if (auto *Table = M.getGlobalVariable(FunctionDispatcherTableName, true)) {
+    if (FunctionDispatcher != nullptr)
+      FunctionDispatcher->dropAllReferences();
+    eraseFromParent(Table);
+  }
+
   // Drop all the old functions, after we stole all of its blocks
   for (Function *OldFunction : OldFunctions)
     eraseFromParent(OldFunction);
@@ -209,7 +233,7 @@ getLLVMReturnTypeAndArguments(llvm::Module *M, const UsedRegisters &Registers) {
     return IntegerType::getIntNTy(Context, 8 * model::Register::getSize(V));
   };
 
-  auto [ArgumentRegisters, ReturnValueRegisters] = Registers;
+  const auto &[ArgumentRegisters, ReturnValueRegisters] = Registers;
   std::ranges::copy(ArgumentRegisters | std::views::transform(IntoLLVMType),
                     std::back_inserter(ArgumentsTypes));
   std::ranges::copy(ReturnValueRegisters | std::views::transform(IntoLLVMType),
@@ -266,31 +290,37 @@ Function *EnforceABI::recreateFunction(Function &OldFunction,
   return Result;
 }
 
-static GlobalVariable *tryGetCSV(Module *M, model::Register::Values Register) {
-  auto Name = model::Register::getCSVName(Register);
-  return M->getGlobalVariable(Name, true);
+/// Looking up a CSV requires building its name, and it happens for each
+/// argument and return value of each call site: cache the results
+GlobalVariable *EnforceABI::tryGetCSV(model::Register::Values Register) {
+  auto [It, New] = CSVs.try_emplace(Register, nullptr);
+  if (New) {
+    auto Name = model::Register::getCSVName(Register);
+    It->second = M.getGlobalVariable(Name, true);
+  }
+
+  return It->second;
 }
 
-static Value *loadCSVOrUndef(IRBuilder<> &Builder,
-                             Module *M,
-                             model::Register::Values Register) {
-  GlobalVariable *CSV = tryGetCSV(M, Register);
+Value *EnforceABI::loadCSVOrUndef(IRBuilder<> &Builder,
+                                  model::Register::Values Register) {
+  GlobalVariable *CSV = tryGetCSV(Register);
   if (CSV == nullptr) {
     auto Size = model::Register::getSize(Register);
-    auto *Type = IntegerType::get(M->getContext(), Size * 8);
+    auto *Type = IntegerType::get(M.getContext(), Size * 8);
     return UndefValue::get(Type);
   } else {
     return createLoad(Builder, CSV);
   }
 }
 
-static std::pair<Type *, Constant *>
-getCSVOrUndef(Module *M, model::Register::Values Register) {
-  GlobalVariable *CSV = tryGetCSV(M, Register);
+std::pair<Type *, Constant *>
+EnforceABI::getCSVOrUndef(model::Register::Values Register) {
+  GlobalVariable *CSV = tryGetCSV(Register);
   if (CSV == nullptr) {
     auto Size = model::Register::getSize(Register);
-    auto *Type = IntegerType::get(M->getContext(), Size * 8);
-    return { Type, UndefValue::get(PointerType::get(M->getContext(), 0)) };
+    auto *Type = IntegerType::get(M.getContext(), Size * 8);
+    return { Type, UndefValue::get(PointerType::get(M.getContext(), 0)) };
   } else {
     return { CSV->getValueType(), CSV };
   }
@@ -303,11 +333,11 @@ void EnforceABI::createPrologue(Function *NewFunction,
   SmallVector<std::pair<Type *, Constant *>, 8> ReturnCSVs;
 
   // We sort arguments by their CSV name
-  auto [ArgumentRegisters, ReturnValueRegisters] = UsedRegisters;
+  const auto &[ArgumentRegisters, ReturnValueRegisters] = UsedRegisters;
   for (model::Register::Values Register : ArgumentRegisters)
-    ArgumentCSVs.push_back(getCSVOrUndef(&M, Register).second);
+    ArgumentCSVs.push_back(getCSVOrUndef(Register).second);
   for (model::Register::Values Register : ReturnValueRegisters)
-    ReturnCSVs.push_back(getCSVOrUndef(&M, Register));
+    ReturnCSVs.push_back(getCSVOrUndef(Register));
 
   // Store arguments to CSVs
   BasicBlock &Entry = NewFunction->getEntryBlock();
@@ -361,13 +391,15 @@ void EnforceABI::handleRegularFunctionCall(const MetaAddress &CallerAddress,
   bool IsDirect = (Callee != FunctionDispatcher);
   bool IsDynamic = not CallSite->DynamicFunction().empty();
   if (IsDynamic) {
-    Callee = OldToNew.at(Callee);
+    auto It = OldToNew.find(Callee);
+    revng_assert(It != OldToNew.end());
+    Callee = It->second;
   } else if (IsDirect) {
     MetaAddress CalleeAddress = CallSite->Destination().notInlinedAddress();
     const model::Function &ModelFunc = Binary.Functions().at(CalleeAddress);
     const auto *Prototype = Binary.prototypeOrDefault(ModelFunc.prototype());
     revng_assert(Prototype != nullptr);
-    auto UsedRegisters = abi::FunctionType::usedRegisters(*Prototype);
+    const auto &UsedRegisters = Layouts.usedRegisters(*Prototype);
     Callee = getOrCreateNewFunction(*Callee, UsedRegisters);
   }
 
@@ -432,7 +464,7 @@ CallInst *EnforceABI::generateCall(IRBuilder<> &Builder,
 
   auto *Prototype = getPrototype(Binary, Entry, CallSiteBlock.ID(), CallSite);
   revng_assert(Prototype != nullptr);
-  auto Registers = abi::FunctionType::usedRegisters(*Prototype);
+  const auto &Registers = Layouts.usedRegisters(*Prototype);
 
   bool IsIndirect = (Callee.getCallee() == FunctionDispatcher);
   if (IsIndirect) {
@@ -453,10 +485,10 @@ CallInst *EnforceABI::generateCall(IRBuilder<> &Builder,
   // Collect arguments and returns
   //
   for (model::Register::Values Register : Registers.Arguments)
-    Arguments.push_back(loadCSVOrUndef(Builder, &M, Register));
+    Arguments.push_back(loadCSVOrUndef(Builder, Register));
 
   for (model::Register::Values Register : Registers.ReturnValues)
-    ReturnCSVs.push_back(getCSVOrUndef(&M, Register).second);
+    ReturnCSVs.push_back(getCSVOrUndef(Register).second);
 
   //
   // Produce the call
@@ -10,6 +10,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
 #include "revng/ADT/Queue.h"
@@ -25,89 +26,128 @@ char InlineHelpersPass::ID = 0;
 using Register = RegisterPass<InlineHelpersPass>;
 static Register X("inline-helpers", "Inline Helpers Pass", true, true);
 
+static cl::opt<unsigned> MaxHelperSize("inline-helpers-max-size",
+                                       cl::desc("do not inline helpers "
+                                                "with more than this many "
+                                                "instructions, 0 means no "
+                                                "limit"),
+                                       cl::init(0));
+
+static void dropDebugOrPseudoInst(Function *F) {
+  SmallVector<Instruction *, 16> ToErase;
+  for (BasicBlock &BB : *F) {
+    for (Instruction &I : BB) {
+      if (I.isDebugOrPseudoInst()) {
+        ToErase.push_back(&I);
+      }
+    }
+  }
+
+  for (Instruction *I : ToErase) {
+    I->eraseFromParent();
+  }
+}
+
+/// Inline the helpers in the revng_inline section into isolated functions
+///
+/// Each helper is prepared once: a copy of it is made, all the helpers it
+/// calls are inlined in it and the debug and pseudo instructions are dropped.
+/// Every call site is then served by inlining the prepared copy, which
+/// requires no further inlining nor cleanup.
 class InlineHelpers {
 private:
-  LLVMContext &C;
-  SmallDenseSet<Function *, 8> Recursive;
+  SmallDenseMap<Function *, Function *, 16> Prepared;
 
 public:
-  InlineHelpers(Module &M) : C(M.getContext()) {
+  InlineHelpers(Module &M) {
     using namespace llvm;
     llvm::CallGraph CG(M);
+
+    // scc_iterator visits callees before callers, i.e., the order in which the
+    // helpers need to be prepared. Recursive helpers are never inlined.
+    SmallVector<Function *, 16> Helpers;
     for (auto It = scc_begin(&CG), End = scc_end(&CG); It != End; ++It)
-      if (It.hasCycle())
+      if (not It.hasCycle())
         for (auto &Node : *It)
-          if (Function *F = Node->getFunction())
-            Recursive.insert(F);
+          if (Function *F = Node->getFunction(); isCandidate(F))
+            Helpers.push_back(F);
+
+    for (Function *F : Helpers)
+      prepare(F);
+  }
+
+  ~InlineHelpers() {
+    for (auto &[Helper, Copy] : Prepared) {
+      revng_assert(Copy->use_empty());
+      Copy->eraseFromParent();
+    }
   }
 
   void run(Function *F);
 
 private:
-  void doInline(CallInst *Call) const;
-  bool doInline(Function *F) const;
-  CallInst *getCallToInline(Instruction *I) const;
-  bool shouldInline(Function *F) const;
+  void prepare(Function *F);
+  bool inlineCalls(Function *F) const;
+  bool isCandidate(Function *F) const;
 };
 
-bool InlineHelpers::shouldInline(Function *F) const {
-  if (F == nullptr)
+bool InlineHelpers::isCandidate(Function *F) const {
+  if (F == nullptr or F->isDeclaration())
     return false;
 
-  if (Recursive.count(F) != 0)
+  if (F->getSection() != "revng_inline")
     return false;
 
-  return F->getSection() == "revng_inline";
-}
-
-CallInst *InlineHelpers::getCallToInline(Instruction *I) const {
-  if (auto *Call = dyn_cast<CallInst>(I)) {
-    if (shouldInline(getCalledFunction(Call))) {
-      return Call;
-    }
-  }
-
-  return nullptr;
-}
+  // Cold helpers are not worth the size increase
+  if (F->hasFnAttribute(Attribute::Cold))
+    return false;
 
-void InlineHelpers::doInline(CallInst *Call) const {
-  InlineFunctionInfo IFI;
-  auto Result = InlineFunction(*Call, IFI, false, nullptr, false);
-  revng_assert(Result.isSuccess(), Result.getFailureReason());
+  return true;
 }
 
-bool InlineHelpers::doInline(Function *F) const {
-  SmallVector<CallInst *, 8> ToInline;
+void InlineHelpers::prepare(Function *F) {
+  ValueToValueMapTy Map;
+  Function *Copy = CloneFunction(F, Map);
+  Copy->setLinkage(GlobalValue::InternalLinkage);
 
-  for (BasicBlock &BB : *F)
-    for (Instruction &I : BB)
-      if (auto *Call = getCallToInline(&I))
-        ToInline.push_back(Call);
+  inlineCalls(Copy);
+  dropDebugOrPseudoInst(Copy);
 
-  for (CallInst *Call : ToInline)
-    doInline(Call);
+  if (MaxHelperSize != 0 and Copy->getInstructionCount() > MaxHelperSize) {
+    Copy->eraseFromParent();
+    return;
+  }
 
-  return ToInline.size() > 0;
+  Prepared[F] = Copy;
 }
-static void dropDebugOrPseudoInst(Function *F) {
-  SmallVector<Instruction *, 16> ToErase;
+
+bool InlineHelpers::inlineCalls(Function *F) const {
+  SmallVector<std::pair<CallInst *, Function *>, 8> ToInline;
+
   for (BasicBlock &BB : *F) {
     for (Instruction &I : BB) {
-      if (I.isDebugOrPseudoInst()) {
-        ToErase.push_back(&I);
+      if (auto *Call = dyn_cast<CallInst>(&I)) {
+        auto It = Prepared.find(getCalledFunction(Call));
+        if (It != Prepared.end())
+          ToInline.emplace_back(Call, It->second);
       }
     }
   }
 
-  for (Instruction *I : ToErase) {
-    I->eraseFromParent();
+  for (auto &[Call, Copy] : ToInline) {
+    Call->setCalledFunction(Copy);
+    InlineFunctionInfo IFI;
+    auto Result = InlineFunction(*Call, IFI, false, nullptr, false);
+    revng_assert(Result.isSuccess(), Result.getFailureReason());
   }
+
+  return ToInline.size() > 0;
 }
 
 void InlineHelpers::run(Function *F) {
-  // Fixed-point inlining
-  while (doInline(F))
-    ;
+  // The prepared helpers contain no calls to other helpers to inline, a
+  // single round is enough
+  inlineCalls(F);
 
   dropDebugOrPseudoInst(F);
 }
@@ -118,10 +158,11 @@ bool InlineHelpersPass::runOnModule(llvm::Module &M) {
     if (FunctionTags::Isolated.isTagOf(&F))
       Isolated.push_back(&F);
 
+  InlineHelpers IH(M);
+
   llvm::Task T(Isolated.size(), "Inline helpers");
   for (Function *F : Isolated) {
     T.advance(F->getName());
-    InlineHelpers IH(*F->getParent());
     IH.run(F);
   }
 
@@ -4,6 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <utility>
+#include <vector>
+
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -62,6 +66,11 @@ class InvokeIsolatedFunctions {
 private:
   using FunctionInfo = tuple<const model::Function *, BasicBlock *, Function *>;
   using FunctionMap = std::map<MetaAddress, FunctionInfo>;
+  using CSVList = std::vector<GlobalVariable *>;
+
+  /// What the invocation of an isolated function needs: its type and the
+  /// CSVs to pass as arguments
+  using Shape = std::pair<FunctionType *, CSVList>;
 
 private:
   const model::Binary &Binary;
@@ -71,6 +80,12 @@ private:
   GeneratedCodeBasicInfo &GCBI;
   FunctionMap Map;
 
+  /// The arguments of the functions using each prototype
+  std::map<const model::TypeDefinition *, CSVList> Arguments;
+
+  /// The thunk marshalling the arguments of the functions of each shape
+  std::map<Shape, Function *> Thunks;
+
 public:
   InvokeIsolatedFunctions(const model::Binary &Binary,
                           Function *RootFunction,
@@ -145,6 +160,57 @@ public:
     return CatchBB;
   }
 
+  /// \returns the CSVs to load, in order, to call a function using
+  ///          \p Prototype
+  const CSVList &argumentsOf(const model::TypeDefinition &Prototype) {
+    auto [It, New] = Arguments.try_emplace(&Prototype);
+    if (not New)
+      return It->second;
+
+    auto Layout = abi::FunctionType::Layout::make(Prototype);
+    for (const auto &ArgumentLayout : Layout.Arguments) {
+      for (model::Register::Values Register : ArgumentLayout.Registers) {
+        auto Name = model::Register::getCSVName(Register);
+        GlobalVariable *CSV = M->getGlobalVariable(Name, true);
+        revng_assert(CSV != nullptr);
+        It->second.push_back(CSV);
+      }
+    }
+
+    return It->second;
+  }
+
+  /// \returns a function taking an isolated function of shape \p TheShape and
+  ///          calling it with the current value of the CSVs of the shape
+  ///
+  /// The thunk is shared by all the functions of the same shape, so that the
+  /// root only needs a single instruction to invoke each of them.
+  Function *getThunk(const Shape &TheShape) {
+    auto [It, New] = Thunks.try_emplace(TheShape, nullptr);
+    if (not New)
+      return It->second;
+
+    auto &[CalleeType, CSVs] = TheShape;
+    Type *PointerToCallee = PointerType::getUnqual(CalleeType);
+    auto *ThunkType = FunctionType::get(Type::getVoidTy(Context),
+                                        { PointerToCallee },
+                                        false);
+    Function *Thunk = Function::Create(ThunkType,
+                                       GlobalValue::InternalLinkage,
+                                       "invoke_isolated_function",
+                                       M);
+
+    IRBuilder<> Builder(BasicBlock::Create(Context, "", Thunk));
+    SmallVector<Value *, 8> Loaded;
+    for (GlobalVariable *CSV : CSVs)
+      Loaded.push_back(createLoad(Builder, CSV));
+    Builder.CreateCall(CalleeType, Thunk->getArg(0), Loaded);
+    Builder.CreateRetVoid();
+
+    It->second = Thunk;
+    return Thunk;
+  }
+
   void run() {
     // Get the unexpectedpc block of the root function
     BasicBlock *UnexpectedPC = GCBI.unexpectedPC();
@@ -181,26 +247,21 @@ public:
 
       IRBuilder<> Builder(NewBB);
 
-      // In case the isolated functions has arguments, provide them
-      SmallVector<Value *, 4> Arguments;
+      // In case the isolated functions has arguments, invoke it through the
+      // thunk providing them
+      FunctionCallee Callee = F;
+      SmallVector<Value *, 1> ThunkArguments;
       if (F->getFunctionType()->getNumParams() > 0) {
         auto ThePrototype = Binary.prototypeOrDefault(ModelF->prototype());
-        auto Layout = abi::FunctionType::Layout::make(*ThePrototype);
-        for (const auto &ArgumentLayout : Layout.Arguments) {
-          for (model::Register::Values Register : ArgumentLayout.Registers) {
-            auto Name = model::Register::getCSVName(Register);
-            GlobalVariable *CSV = M->getGlobalVariable(Name, true);
-            revng_assert(CSV != nullptr);
-            Arguments.push_back(createLoad(Builder, CSV));
-          }
-        }
+        Callee = getThunk({ F->getFunctionType(), argumentsOf(*ThePrototype) });
+        ThunkArguments.push_back(F);
       }
 
       // Emit the invoke instruction, propagating debug info
-      auto *NewInvoke = Builder.CreateInvoke(F,
+      auto *NewInvoke = Builder.CreateInvoke(Callee,
                                              InvokeReturnBlock,
                                              CatchBB,
-                                             Arguments);
+                                             ThunkArguments);
       NewInvoke->setDebugLoc(BB->front().getDebugLoc());
     }
 
@@ -19,6 +19,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -44,6 +45,8 @@
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipeline/Contract.h"
 #include "revng/Pipeline/ExecutionContext.h"
+#include "revng/Pipeline/FunctionCostReport.h"
+#include "revng/Pipeline/TargetBudget.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Pipes/RootKind.h"
@@ -56,6 +59,20 @@
 
 using namespace llvm;
 
+static cl::opt<unsigned> DispatcherTableThreshold("function-dispatcher-table-"
+                                                  "threshold",
+                                                  cl::desc("Emit the function "
+                                                           "dispatcher as a "
+                                                           "sorted table, "
+                                                           "searched through "
+                                                           "binary search, if "
+                                                           "there are at least "
+                                                           "this many "
+                                                           "functions. 0 means "
+                                                           "always use a "
+                                                           "switch."),
+                                                  cl::init(0));
+
 class IsolateFunctionsImpl;
 
 static Logger<> TheLogger("isolation");
@@ -251,12 +268,60 @@ private:
   /// Populate the function_dispatcher, needed to handle the indirect calls
   void populateFunctionDispatcher();
 
+  /// Emit in the function_dispatcher a binary search over a table sorted by
+  /// MetaAddress of the functions in \p Targets
+  void buildTableDispatcher(const std::map<MetaAddress, Function *> &Targets,
+                            BasicBlock *Dispatcher,
+                            BasicBlock *Unexpected);
+
   void handleUnexpectedPCCloned(efa::OutlinedFunction &Outlined);
   void handleAnyPCJumps(efa::OutlinedFunction &Outlined,
                         const efa::ControlFlowGraph &FM);
 };
 
 void IFI::populateFunctionDispatcher() {
+  // The module might come with the dispatcher populated by a previous run, in
+  // which case only some of the functions have been isolated in this run.
+  // Preserve the entries of the functions isolated back then and rebuild the
+  // dispatcher, so that it can still reach all of them.
+  std::map<MetaAddress, Function *> Dispatched;
+  for (BasicBlock &BB : *FunctionDispatcher) {
+    for (Instruction &I : BB) {
+      auto *Call = dyn_cast<CallInst>(&I);
+      if (Call == nullptr)
+        continue;
+
+      Function *Callee = Call->getCalledFunction();
+      if (Callee == nullptr or not FunctionTags::Isolated.isTagOf(Callee))
+        continue;
+
+      auto Entry = getMetaAddressMetadata(Callee, FunctionEntryMDName);
+      revng_assert(Entry.isValid());
+      Dispatched[Entry] = Callee;
+    }
+  }
+
+  auto *Table = TheModule->getGlobalVariable(FunctionDispatcherTableName, true);
+  if (Table != nullptr) {
+    auto *Entries = cast<ConstantArray>(Table->getInitializer());
+    for (Use &Entry : Entries->operands()) {
+      auto *Callee = cast<Function>(cast<ConstantStruct>(Entry)->getOperand(2));
+      auto Address = getMetaAddressMetadata(Callee, FunctionEntryMDName);
+      revng_assert(Address.isValid());
+      Dispatched[Address] = Callee;
+    }
+  }
+
+  for (BasicBlock &BB : *FunctionDispatcher)
+    BB.dropAllReferences();
+  while (not FunctionDispatcher->empty())
+    FunctionDispatcher->begin()->eraseFromParent();
+
+  if (Table != nullptr)
+    eraseFromParent(Table);
+
+  for (auto &[Address, F] : IsolatedFunctionsMap)
+    Dispatched[Address] = F;
 
   BasicBlock *Dispatcher = BasicBlock::Create(Context,
                                               "function_dispatcher",
@@ -271,11 +336,17 @@ void IFI::populateFunctionDispatcher() {
   emitUnreachable(Unexpected, "An unexpected function has been called", Dbg);
   setBlockType(Unexpected->getTerminator(), BlockType::UnexpectedPCBlock);
 
+  if (DispatcherTableThreshold != 0
+      and Dispatched.size() >= DispatcherTableThreshold) {
+    buildTableDispatcher(Dispatched, Dispatcher, Unexpected);
+    return;
+  }
+
   IRBuilder<> Builder(Context);
 
   // Create all the entries of the dispatcher
   ProgramCounterHandler::DispatcherTargets Targets;
-  for (auto &[Address, F] : IsolatedFunctionsMap) {
+  for (auto &[Address, F] : Dispatched) {
     BasicBlock *Trampoline = BasicBlock::Create(Context,
                                                 F->getName() + "_trampoline",
                                                 FunctionDispatcher,
@@ -295,6 +366,113 @@ void IFI::populateFunctionDispatcher() {
                                                 {});
 }
 
+void IFI::buildTableDispatcher(const std::map<MetaAddress, Function *> &Targets,
+                               BasicBlock *Dispatcher,
+                               BasicBlock *Unexpected) {
+  // Each entry of the table is composed by two keys and the function to call.
+  // The first key packs epoch, address space and type, the second one is the
+  // address. Comparing the entries by the keys, in order, they are sorted the
+  // same way MetaAddress is.
+  auto *Int64 = Type::getInt64Ty(Context);
+  auto *FunctionPointer = IsolatedFunctionType->getPointerTo();
+  auto *EntryType = StructType::get(Context, { Int64, Int64, FunctionPointer });
+
+  auto PackHigh = [](const MetaAddress &Address) -> uint64_t {
+    return (static_cast<uint64_t>(Address.epoch()) << 32)
+           | (static_cast<uint64_t>(Address.addressSpace()) << 16)
+           | static_cast<uint64_t>(Address.type());
+  };
+
+  using Key = std::pair<uint64_t, uint64_t>;
+  std::vector<std::pair<Key, Function *>> Sorted;
+  for (auto &[Address, F] : Targets)
+    Sorted.push_back({ { PackHigh(Address), Address.address() }, F });
+  llvm::sort(Sorted, [](const auto &LHS, const auto &RHS) {
+    return LHS.first < RHS.first;
+  });
+
+  SmallVector<Constant *, 16> Entries;
+  Entries.reserve(Sorted.size());
+  for (auto &[Key, F] : Sorted) {
+    Entries.push_back(ConstantStruct::get(EntryType,
+                                          ConstantInt::get(Int64, Key.first),
+                                          ConstantInt::get(Int64, Key.second),
+                                          F));
+  }
+
+  auto *TableType = ArrayType::get(EntryType, Entries.size());
+  auto *Table = new GlobalVariable(*TheModule,
+                                   TableType,
+                                   true,
+                                   GlobalValue::InternalLinkage,
+                                   ConstantArray::get(TableType, Entries),
+                                   FunctionDispatcherTableName);
+
+  auto *Loop = BasicBlock::Create(Context,
+                                  "dispatcher_loop",
+                                  FunctionDispatcher);
+  auto *Body = BasicBlock::Create(Context,
+                                  "dispatcher_body",
+                                  FunctionDispatcher);
+  auto *Step = BasicBlock::Create(Context,
+                                  "dispatcher_step",
+                                  FunctionDispatcher);
+  auto *Found = BasicBlock::Create(Context,
+                                   "dispatcher_found",
+                                   FunctionDispatcher);
+
+  // Compute the keys of the current program counter
+  IRBuilder<> Builder(Dispatcher);
+  auto *PCH = GCBI.programCounterHandler();
+  auto [EpochCSV, AddressSpaceCSV, TypeCSV, AddressCSV] = PCH->pcCSVs();
+  auto LoadAsInt64 = [&Builder, Int64](GlobalVariable *CSV) {
+    return Builder.CreateZExtOrTrunc(createLoad(Builder, CSV), Int64);
+  };
+  Value *Epoch = Builder.CreateShl(LoadAsInt64(EpochCSV), 32);
+  Value *AddressSpace = Builder.CreateShl(LoadAsInt64(AddressSpaceCSV), 16);
+  Value *High = Builder.CreateOr(Builder.CreateOr(Epoch, AddressSpace),
+                                 LoadAsInt64(TypeCSV));
+  Value *Low = LoadAsInt64(AddressCSV);
+  Builder.CreateBr(Loop);
+
+  // Look for the entry in [Begin, End)
+  Builder.SetInsertPoint(Loop);
+  PHINode *Begin = Builder.CreatePHI(Int64, 2, "begin");
+  PHINode *End = Builder.CreatePHI(Int64, 2, "end");
+  Begin->addIncoming(ConstantInt::get(Int64, 0), Dispatcher);
+  End->addIncoming(ConstantInt::get(Int64, Entries.size()), Dispatcher);
+  Builder.CreateCondBr(Builder.CreateICmpUGE(Begin, End), Unexpected, Body);
+
+  Builder.SetInsertPoint(Body);
+  Value *Middle = Builder.CreateLShr(Builder.CreateAdd(Begin, End), 1);
+  auto EntryField = [&](unsigned Index) -> Value * {
+    Value *Indices[] = { ConstantInt::get(Int64, 0),
+                         Middle,
+                         Builder.getInt32(Index) };
+    return Builder.CreateInBoundsGEP(TableType, Table, Indices);
+  };
+  Value *EntryHigh = Builder.CreateLoad(Int64, EntryField(0));
+  Value *EntryLow = Builder.CreateLoad(Int64, EntryField(1));
+  Value *HighEqual = Builder.CreateICmpEQ(EntryHigh, High);
+  Value *Equal = Builder.CreateAnd(HighEqual,
+                                   Builder.CreateICmpEQ(EntryLow, Low));
+  Builder.CreateCondBr(Equal, Found, Step);
+
+  Builder.SetInsertPoint(Step);
+  Value *LowLess = Builder.CreateICmpULT(EntryLow, Low);
+  Value *Less = Builder.CreateOr(Builder.CreateICmpULT(EntryHigh, High),
+                                 Builder.CreateAnd(HighEqual, LowLess));
+  Value *Next = Builder.CreateAdd(Middle, ConstantInt::get(Int64, 1));
+  Begin->addIncoming(Builder.CreateSelect(Less, Next, Begin), Step);
+  End->addIncoming(Builder.CreateSelect(Less, End, Middle), Step);
+  Builder.CreateBr(Loop);
+
+  Builder.SetInsertPoint(Found);
+  Value *Callee = Builder.CreateLoad(FunctionPointer, EntryField(2));
+  Builder.CreateCall(IsolatedFunctionType, Callee);
+  Builder.CreateRetVoid();
+}
+
 template<typename T, typename F>
 static bool
 allOrNone(const T &Range, const F &Predicate, bool Default = false) {
@@ -510,11 +688,15 @@ void IsolateFunctionsImpl::run() {
   revng_assert(UnreachableFunction != nullptr);
   FunctionTags::Exceptional.addTo(UnreachableFunction);
 
-  FunctionDispatcher = Function::Create(createFunctionType<void>(Context),
-                                        GlobalValue::ExternalLinkage,
-                                        "function_dispatcher",
-                                        TheModule);
-  FunctionTags::FunctionDispatcher.addTo(FunctionDispatcher);
+  // Reuse the dispatcher, if a previous run left one in the module
+  FunctionDispatcher = TheModule->getFunction("function_dispatcher");
+  if (FunctionDispatcher == nullptr) {
+    FunctionDispatcher = Function::Create(createFunctionType<void>(Context),
+                                          GlobalValue::ExternalLinkage,
+                                          "function_dispatcher",
+                                          TheModule);
+    FunctionTags::FunctionDispatcher.addTo(FunctionDispatcher);
+  }
 
   //
   // Create the dynamic functions
@@ -528,10 +710,21 @@ void IsolateFunctionsImpl::run() {
        Binary.ImportedDynamicFunctions()) {
     StringRef Name = Function.OriginalName();
     DynamicFunctionsTask.advance(Name, true);
-    auto *NewFunction = Function::Create(IsolatedFunctionType,
-                                         GlobalValue::ExternalLinkage,
-                                         "dynamic_" + Function.OriginalName(),
-                                         TheModule);
+
+    // Dynamic functions do not depend on the CFG: reuse the ones created by a
+    // previous run, if any
+    std::string LLVMName = ("dynamic_" + Name).str();
+    auto *NewFunction = TheModule->getFunction(LLVMName);
+    if (NewFunction != nullptr and not NewFunction->isDeclaration()) {
+      DynamicFunctionsMap[Name] = NewFunction;
+      continue;
+    }
+
+    if (NewFunction == nullptr)
+      NewFunction = Function::Create(IsolatedFunctionType,
+                                     GlobalValue::ExternalLinkage,
+                                     LLVMName,
+                                     TheModule);
     FunctionTags::DynamicFunction.addTo(NewFunction);
     NewFunction->addFnAttr(Attribute::NoMerge);
 
@@ -574,10 +767,14 @@ void IsolateFunctionsImpl::run() {
     Context.getContext().pushReadFields();
 
     auto Entry = MetaAddress::fromString(Target.getPathComponents()[0]);
+    pipeline::FunctionCostScope Cost(Entry);
+    pipeline::TargetBudgetScope Budget(Entry);
     const efa::ControlFlowGraph &FM = Cache->getControlFlowGraph(Entry);
+    Cost.setBlocks(FM.Blocks().size());
 
     // Get or create the llvm::Function
     Function *F = getLocalFunction(Entry);
+    Cost.setFunction(F);
 
     // Decorate the function as appropriate
     F->addFnAttr(Attribute::NullPointerIsValid);
@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
@@ -288,7 +289,6 @@ void PromoteCSVs::promoteCSVs(Function *F) {
   QuickMetadata QMD(F->getParent()->getContext());
 
   // Get/create initializers
-  std::map<Function *, GlobalVariable *> CSVForInitializer;
   std::map<GlobalVariable *, Function *> InitializerForCSV;
   for (GlobalVariable *CSV : CSVs) {
     // Initialize all allocas with opaque, CSV-specific values
@@ -307,7 +307,6 @@ void PromoteCSVs::promoteCSVs(Function *F) {
                                  QMD.tuple(getName(Register)));
       }
 
-      CSVForInitializer[Initializer] = CSV;
       InitializerForCSV[CSV] = Initializer;
     }
   }
@@ -321,38 +320,34 @@ void PromoteCSVs::promoteCSVs(Function *F) {
   auto *Separator = InitializersBuilder.CreateUnreachable();
   IRBuilder<> AllocaBuilder(&Entry, Entry.begin());
 
-  // For each GlobalVariable representing a CSV used in F, create a dedicated
-  // alloca and save it in CSVMaps.
-  std::map<GlobalVariable *, AllocaInst *> CSVAllocas;
+  // For each GlobalVariable representing a CSV, create a dedicated alloca and
+  // save it in CSVAllocas.
+  DenseMap<GlobalVariable *, AllocaInst *> CSVAllocas;
+  CSVAllocas.reserve(CSVs.size());
   for (GlobalVariable *CSV : CSVs) {
-    AllocaInst *Alloca = nullptr;
+    // Create the alloca
+    Type *CSVType = CSV->getValueType();
+    auto *Alloca = AllocaBuilder.CreateAlloca(CSVType, nullptr, CSV->getName());
 
-    auto It = CSVAllocas.find(CSV);
-    if (It != CSVAllocas.end()) {
-      Alloca = It->second;
-    } else {
-      // Create the alloca
-      Type *CSVType = CSV->getValueType();
-      Alloca = AllocaBuilder.CreateAlloca(CSVType, nullptr, CSV->getName());
-
-      // Check if already have an initializer
-      Value *Initializer = nullptr;
-      auto It = InitializerForCSV.find(CSV);
-      if (It != InitializerForCSV.end()) {
-        Function *InitializerFunction = InitializerForCSV.at(CSV);
-        Initializer = InitializersBuilder.CreateCall(InitializerFunction);
-      } else {
-        Initializer = CSV->getInitializer();
-      }
+    // Check if already have an initializer
+    Value *Initializer = nullptr;
+    auto It = InitializerForCSV.find(CSV);
+    if (It != InitializerForCSV.end())
+      Initializer = InitializersBuilder.CreateCall(It->second);
+    else
+      Initializer = CSV->getInitializer();
 
-      // Initialize the alloca
-      InitializersBuilder.CreateStore(Initializer, Alloca);
-    }
+    // Initialize the alloca
+    InitializersBuilder.CreateStore(Initializer, Alloca);
 
-    // Replace users
-    replaceAllUsesInFunctionWith(F, CSV, Alloca);
+    CSVAllocas[CSV] = Alloca;
   }
 
+  // Replace users. We look at the operands of the instructions in F instead of
+  // using replaceAllUsesInFunctionWith on each CSV, which would go through the
+  // uses of the CSV in all the other functions too, for each function.
+  replaceGlobalsInFunction(F, CSVAllocas);
+
   // Drop separators
   eraseFromParent(Separator);
 
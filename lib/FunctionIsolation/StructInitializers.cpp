@@ -12,7 +12,7 @@ using namespace llvm;
 const char *StructInitializerPrefix = "struct_initializer";
 
 StructInitializers::StructInitializers(llvm::Module *M) :
-  Pool(M, false), Context(M->getContext()) {
+  Pool(M, "struct-initializers"), Context(M->getContext()) {
   Pool.setMemoryEffects(MemoryEffects::none());
   Pool.addFnAttribute(Attribute::NoUnwind);
   Pool.addFnAttribute(Attribute::WillReturn);
@@ -253,10 +253,9 @@ RankContainer partitionLongEdges(InternalGraph &Graph,
             Visited.insert(Successor);
       }
 
-      for (NodeView Node : ToRemove) {
+      for (NodeView Node : ToRemove)
         Ranks.erase(Node);
-        Graph.removeNode(Node);
-      }
+      Graph.removeNodes(ToRemove);
     }
   }
 
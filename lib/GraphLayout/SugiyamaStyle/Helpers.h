@@ -136,8 +136,12 @@ using LayoutContainer = std::unordered_map<NodeView, LogicalPosition>;
 /// used to route edges.
 struct LaneContainer {
   /// Stores edges that require a horizontal section grouped by layer.
+  /// Lanes start from 1, edges that don't overlap horizontally can share one.
   std::vector<std::map<EdgeView, Rank>> Horizontal;
 
+  /// Stores the number of lanes each layer uses for horizontal edges.
+  std::vector<Rank> HorizontalLaneCount;
+
   /// Stores edges entering a node groped by the node they enter.
   std::unordered_map<NodeView, std::map<EdgeDestinationView, Rank>> Entries;
 
@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <vector>
+
 #include "InternalCompute.h"
 
 struct SortableEdge {
@@ -52,6 +55,148 @@ public:
   }
 };
 
+/// Maps each of a set of horizontal intervals to the highest lane already
+/// taken somewhere in it
+///
+/// It's a segment tree over the (compressed) ends of the intervals, where
+/// taking a lane over an interval assigns it to the whole interval: lanes are
+/// only taken above all the ones already taken in the same interval.
+class LaneTree {
+private:
+  std::vector<float> Ends;
+  std::vector<Rank> Maximum;
+  std::vector<Rank> Pending;
+
+public:
+  explicit LaneTree(std::vector<float> &&Points) : Ends(std::move(Points)) {
+    std::sort(Ends.begin(), Ends.end());
+    Ends.erase(std::unique(Ends.begin(), Ends.end()), Ends.end());
+    Maximum.resize(4 * Ends.size(), 0);
+    Pending.resize(4 * Ends.size(), 0);
+  }
+
+public:
+  /// \return the highest lane taken in [\p Left, \p Right]
+  Rank highest(float Left, float Right) {
+    return highest(1, 0, Ends.size() - 1, index(Left), index(Right));
+  }
+
+  /// Take \p Lane over [\p Left, \p Right], it must be higher than all the
+  /// lanes taken there
+  void take(float Left, float Right, Rank Lane) {
+    take(1, 0, Ends.size() - 1, index(Left), index(Right), Lane);
+  }
+
+private:
+  size_t index(float Point) const {
+    auto It = std::lower_bound(Ends.begin(), Ends.end(), Point);
+    revng_assert(It != Ends.end() && *It == Point);
+    return It - Ends.begin();
+  }
+
+  void push(size_t Node) {
+    if (Pending[Node] == 0)
+      return;
+
+    for (size_t Child : { 2 * Node, 2 * Node + 1 }) {
+      Maximum[Child] = Pending[Node];
+      Pending[Child] = Pending[Node];
+    }
+    Pending[Node] = 0;
+  }
+
+  Rank highest(size_t Node, size_t Begin, size_t End, size_t L, size_t R) {
+    if (R < Begin || End < L)
+      return 0;
+    if (L <= Begin && End <= R)
+      return Maximum[Node];
+
+    push(Node);
+    size_t Middle = (Begin + End) / 2;
+    return std::max(highest(2 * Node, Begin, Middle, L, R),
+                    highest(2 * Node + 1, Middle + 1, End, L, R));
+  }
+
+  void
+  take(size_t Node, size_t Begin, size_t End, size_t L, size_t R, Rank Lane) {
+    if (R < Begin || End < L)
+      return;
+    if (L <= Begin && End <= R) {
+      Maximum[Node] = Lane;
+      Pending[Node] = Lane;
+      return;
+    }
+
+    push(Node);
+    size_t Middle = (Begin + End) / 2;
+    take(2 * Node, Begin, Middle, L, R, Lane);
+    take(2 * Node + 1, Middle + 1, End, L, R, Lane);
+    Maximum[Node] = std::max(Maximum[2 * Node], Maximum[2 * Node + 1]);
+  }
+};
+
+static void extend(std::pair<float, float> &Extent, const InternalNode &Node) {
+  Extent.first = std::min(Extent.first, Node.Center.X - Node.Size.W / 2);
+  Extent.second = std::max(Extent.second, Node.Center.X + Node.Size.W / 2);
+}
+
+/// The horizontal extent of the lane an edge needs, including the room its
+/// vertical segments might be moved by to separate them from the others
+/// entering or leaving the same node.
+///
+/// Virtual nodes are moved again when routing backwards corners, and long
+/// edges are aligned with their neighbors, so their neighbors are included.
+static std::pair<float, float> extent(const EdgeView &Edge) {
+  std::pair<float, float> Result{ Edge.From->Center.X, Edge.From->Center.X };
+  for (NodeView End : { Edge.From, Edge.To }) {
+    extend(Result, *End);
+    if (not End->IsVirtual)
+      continue;
+
+    for (const InternalNode *Neighbor : End->successors())
+      extend(Result, *Neighbor);
+    for (const InternalNode *Neighbor : End->predecessors())
+      extend(Result, *Neighbor);
+  }
+
+  return Result;
+}
+
+/// Assign a lane, starting from 1, to each of the edges of \p Edges, which
+/// are sorted from the outermost to the innermost one
+///
+/// Each edge is placed right outside all the inner edges it overlaps with, so
+/// that edges that don't overlap share lanes, without changing the relative
+/// order of the ones that do. The ends of the intervals are closed: edges that
+/// touch each other never share a lane.
+///
+/// \return the number of lanes used
+static Rank packLanes(llvm::ArrayRef<SortableEdge> Edges,
+                      std::map<EdgeView, Rank> &Lanes) {
+  if (Edges.empty())
+    return 0;
+
+  std::vector<float> Ends;
+  Ends.reserve(2 * Edges.size());
+  for (const SortableEdge &Edge : Edges) {
+    auto [Left, Right] = extent(Edge.view());
+    Ends.push_back(Left);
+    Ends.push_back(Right);
+  }
+
+  LaneTree Tree(std::move(Ends));
+  Rank LaneCount = 0;
+  for (const SortableEdge &Edge : llvm::reverse(Edges)) {
+    auto [Left, Right] = extent(Edge.view());
+    Rank Lane = Tree.highest(Left, Right) + 1;
+    Tree.take(Left, Right, Lane);
+    Lanes[Edge.view()] = Lane;
+    LaneCount = std::max(LaneCount, Lane);
+  }
+
+  return LaneCount;
+}
+
 struct EdgeDestination {
   NodeView Neighbor;
   InternalEdge *Label = nullptr;
@@ -137,6 +282,7 @@ LaneContainer assignLanes(InternalGraph &Graph,
 
   // Sort horizontal lanes
   Result.Horizontal.resize(Horizontal.size());
+  Result.HorizontalLaneCount.resize(Horizontal.size());
   for (size_t Index = 0; Index < Horizontal.size(); ++Index) {
     auto &CurrentLane = Horizontal[Index];
     // The edges going to the left and the edges going to the right are
@@ -145,8 +291,8 @@ LaneContainer assignLanes(InternalGraph &Graph,
     // "left-to-right" edges need to be layered from the closest to the most
     // distant one, while "right-to-left" edges - in the opposite order.
     std::sort(CurrentLane.begin(), CurrentLane.end());
-    for (size_t I = 0; I < CurrentLane.size(); I++)
-      Result.Horizontal[Index][CurrentLane[I].view()] = CurrentLane.size() - I;
+    Result.HorizontalLaneCount[Index] = packLanes(CurrentLane,
+                                                  Result.Horizontal[Index]);
   }
 
   return Result;
@@ -5,8 +5,13 @@
 //
 
 #include <map>
+#include <vector>
 
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include "revng/Support/Deadline.h"
 
 #include "InternalCompute.h"
 
@@ -21,6 +26,8 @@ static LayerContainer optimizeLayers(InternalGraph &Graph,
     Layers[Rank].emplace_back(Node);
   }
 
+  // Nodes are disconnected right away, but destroyed all at once at the end
+  std::vector<InternalNode *> Removed;
   for (auto Iterator = Layers.begin(); Iterator != Layers.end();) {
     bool IsLayerRequired = false;
     for (auto Node : *Iterator) {
@@ -58,7 +65,8 @@ static LayerContainer optimizeLayers(InternalGraph &Graph,
         auto *Label = Node->successor_edges().begin()->Label;
         Predecessor->addSuccessor(Successor, std::move(*Label));
         Ranks.erase(Node);
-        Graph.removeNode(Node);
+        Node->disconnect();
+        Removed.push_back(Node);
       }
 
       Iterator = Layers.erase(Iterator);
@@ -67,6 +75,8 @@ static LayerContainer optimizeLayers(InternalGraph &Graph,
     }
   }
 
+  Graph.removeNodes(Removed);
+
   // Update ranks
   for (size_t Index = 0; Index < Layers.size(); ++Index)
     for (auto Node : Layers[Index])
@@ -91,25 +101,62 @@ public:
   RankContainer &Permutation; // A view onto a current permutation.
 
 private:
-  /// Counts the number of edge crossings given two nodes and
-  /// a map that represents which nodes in an adjacent layer
-  /// are connected to one of the given nodes.
-  static Rank countImpl(NodeView KNode,
-                        NodeView LNode,
-                        const std::map<Rank, bool> &SortedLayer,
-                        const RankContainer &Permutation) {
+  /// Sorted positions of the neighbors of a node lying in an adjacent layer.
+  using NeighborPositions = llvm::SmallVector<Rank, 4>;
+
+  /// Positions of the nodes of an adjacent layer connected to one of the two
+  /// nodes being considered, sorted, each paired with a flag which is set if
+  /// the node is connected to the first one.
+  using SortedLayer = llvm::SmallVector<std::pair<Rank, bool>, 8>;
+
+  template<typename RangeType>
+  NeighborPositions collect(Rank NeighborRank, RangeType &&Neighbors) const {
+    NeighborPositions Result;
+    for (auto *Neighbor : Neighbors)
+      if (Ranks.at(Neighbor) == NeighborRank)
+        Result.push_back(Permutation.at(Neighbor));
+
+    llvm::sort(Result);
+    Result.erase(std::unique(Result.begin(), Result.end()), Result.end());
+    return Result;
+  }
+
+  /// Merges the neighbors of the two nodes. If a node is a neighbor of both,
+  /// it's considered to be connected to the second one.
+  static SortedLayer merge(const NeighborPositions &KNeighbors,
+                           const NeighborPositions &LNeighbors) {
+    SortedLayer Result;
+    auto KIt = KNeighbors.begin();
+    auto LIt = LNeighbors.begin();
+    while (KIt != KNeighbors.end() or LIt != LNeighbors.end()) {
+      if (LIt == LNeighbors.end()
+          or (KIt != KNeighbors.end() and *KIt < *LIt)) {
+        Result.emplace_back(*KIt++, true);
+      } else {
+        if (KIt != KNeighbors.end() and *KIt == *LIt)
+          ++KIt;
+        Result.emplace_back(*LIt++, false);
+      }
+    }
+
+    return Result;
+  }
+
+  /// Counts the number of edge crossings given two nodes, the first of which
+  /// is on the left, and a sorted layer representing which nodes in an
+  /// adjacent layer are connected to one of the given nodes.
+  static Rank countImpl(const SortedLayer &Layer) {
     Rank CrossingCount = 0;
-    if (SortedLayer.size() > 0) {
-      bool KSide = SortedLayer.begin()->second;
-      bool KLeft = Permutation.at(KNode) < Permutation.at(LNode);
+    if (Layer.size() > 0) {
+      bool KSide = Layer.begin()->second;
       int64_t PreviousSegmentSize = 0;
       int64_t CurrentSegmentSize = 0;
 
-      for (auto &[Position, Side] : SortedLayer) {
+      for (auto &[Position, Side] : Layer) {
         if (Side == KSide) {
           CurrentSegmentSize += 1;
         } else {
-          if (KSide && KLeft)
+          if (KSide)
             CrossingCount += PreviousSegmentSize * CurrentSegmentSize;
 
           PreviousSegmentSize = CurrentSegmentSize;
@@ -118,7 +165,7 @@ private:
         }
       }
 
-      if (KSide && KLeft)
+      if (KSide)
         CrossingCount += PreviousSegmentSize * CurrentSegmentSize;
     }
 
@@ -126,56 +173,38 @@ private:
   }
 
 public:
-  // Counts the crossings.
-  Rank countCrossings(Rank CurrentRank, NodeView KNode, NodeView LNode) {
+  /// Counts, for each pair of nodes in the layer with rank \p CurrentRank,
+  /// the crossings of their edges when the first one is on the left.
+  ///
+  /// The result is indexed by `K * LayerSize + L`, where `K` and `L` are
+  /// indices into the layer. Swapping two nodes of this layer doesn't affect
+  /// the result, since the adjacent layers don't change. It's the swap
+  /// between the left and the right node that does: the crossings counted
+  /// here disappear when the left node of the pair is moved to the right.
+  std::vector<Rank> countCrossings(Rank CurrentRank) const {
     revng_assert(CurrentRank < Layers.size());
+    const auto &Layer = Layers[CurrentRank];
+    size_t LayerSize = Layer.size();
 
-    Rank CrossingCount = 0;
-
-    if (CurrentRank != 0) {
-      std::map<Rank, bool> SortedLayer;
-      for (auto *Predecessor : KNode->predecessors())
-        if (Ranks.at(Predecessor) == CurrentRank - 1)
-          SortedLayer[Permutation.at(Predecessor)] = true;
-
-      for (auto *Predecessor : LNode->predecessors())
-        if (Ranks.at(Predecessor) == CurrentRank - 1)
-          SortedLayer[Permutation.at(Predecessor)] = false;
-
-      CrossingCount += countImpl(KNode, LNode, SortedLayer, Permutation);
+    std::vector<NeighborPositions> Predecessors(LayerSize);
+    std::vector<NeighborPositions> Successors(LayerSize);
+    for (size_t I = 0; I < LayerSize; ++I) {
+      if (CurrentRank != 0)
+        Predecessors[I] = collect(CurrentRank - 1, Layer[I]->predecessors());
+      if (CurrentRank != Layers.size() - 1)
+        Successors[I] = collect(CurrentRank + 1, Layer[I]->successors());
     }
 
-    if (CurrentRank != Layers.size() - 1) {
-      std::map<Rank, bool> SortedLayer;
-      for (auto *Successor : KNode->successors())
-        if (Ranks.at(Successor) == CurrentRank + 1)
-          SortedLayer[Permutation.at(Successor)] = true;
-
-      for (auto *Successor : LNode->successors())
-        if (Ranks.at(Successor) == CurrentRank + 1)
-          SortedLayer[Permutation.at(Successor)] = false;
-
-      CrossingCount += countImpl(KNode, LNode, SortedLayer, Permutation);
+    std::vector<Rank> Result(LayerSize * LayerSize, 0);
+    for (size_t K = 0; K < LayerSize; ++K) {
+      for (size_t L = K + 1; L < LayerSize; ++L) {
+        Rank &Count = Result[K * LayerSize + L];
+        Count += countImpl(merge(Predecessors[K], Predecessors[L]));
+        Count += countImpl(merge(Successors[K], Successors[L]));
+      }
     }
 
-    return CrossingCount;
-  }
-
-  /// Computes the difference in the crossing count
-  /// based on the node positions (e.g. how much better/worse the crossing
-  /// count becomes if a permutation were to be applied).
-  RankDelta computeDelta(Rank CurrentRank, NodeView KNode, NodeView LNode) {
-    auto KIterator = Permutation.find(KNode);
-    auto LIterator = Permutation.find(LNode);
-    revng_assert(KIterator != Permutation.end());
-    revng_assert(LIterator != Permutation.end());
-
-    auto OriginalCrossingCount = countCrossings(CurrentRank, KNode, LNode);
-    std::swap(KIterator->second, LIterator->second);
-    auto NewCrossingCount = countCrossings(CurrentRank, KNode, LNode);
-    std::swap(KIterator->second, LIterator->second);
-
-    return RankDelta(NewCrossingCount) - RankDelta(OriginalCrossingCount);
+    return Result;
   }
 };
 
@@ -246,6 +275,10 @@ LayerContainer minimizeCrossingCount(const RankContainer &Ranks,
         for (size_t NodeIndex = 0; NodeIndex < CurrentLayerSize; ++NodeIndex)
           Permutation[Layers[Index][NodeIndex]] = NodeIndex;
 
+        // The crossings between each pair only depend on the adjacent
+        // layers, compute them once for all the repetitions below.
+        auto Crossings = Calculator.countCrossings(Index);
+
         // Minimize WRT of the previous layer
         // This can be expensive so we limit the number of times we repeat it.
         for (size_t NodeIndex = 0; NodeIndex < CurrentLayerSize; ++NodeIndex) {
@@ -256,7 +289,9 @@ LayerContainer minimizeCrossingCount(const RankContainer &Ranks,
             for (size_t L = K + 1; L < CurrentLayerSize; ++L) {
               auto KNode = Layers[Index][K];
               auto LNode = Layers[Index][L];
-              auto Delta = Calculator.computeDelta(Index, KNode, LNode);
+              auto Count = RankDelta(Crossings[K * CurrentLayerSize + L]);
+              bool KLeft = Permutation.at(KNode) < Permutation.at(LNode);
+              auto Delta = KLeft ? -Count : Count;
               if (Delta < ChoosenDelta) {
                 ChoosenDelta = Delta;
                 ChoosenNodes = { K, L };
@@ -279,7 +314,8 @@ LayerContainer minimizeCrossingCount(const RankContainer &Ranks,
       }
     }
 
-    if (!DidAnySwaps)
+    // Out of time: settle for the crossings removed so far
+    if (!DidAnySwaps || revng::DeadlineScope::expired())
       break;
   }
 
@@ -374,6 +410,10 @@ LayerContainer sortNodes(const RankContainer &Ranks,
 
   RankContainer Positions;
   for (size_t Iteration = 0; Iteration < IterationCount; Iteration++) {
+    // Out of time: the current order is valid, just less refined
+    if (Iteration != 0 && revng::DeadlineScope::expired())
+      break;
+
     for (size_t Index = 0; Index < Layers.size(); ++Index) {
       for (size_t Counter = 0; auto Node : Layers[Index])
         Positions[Node] = Counter++;
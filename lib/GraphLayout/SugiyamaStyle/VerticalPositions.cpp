@@ -20,8 +20,8 @@ void setVerticalCoordinates(const LayerContainer &Layers,
       Node->Center.Y = LastY - Node->Size.H / 2;
     }
 
-    auto LaneCount = Index < Lanes.Horizontal.size() ?
-                       Lanes.Horizontal.at(Index).size() :
+    auto LaneCount = Index < Lanes.HorizontalLaneCount.size() ?
+                       Lanes.HorizontalLaneCount.at(Index) :
                        0;
     LastY -= MaxHeight + EdgeDistance * LaneCount + MarginSize * 2;
   }
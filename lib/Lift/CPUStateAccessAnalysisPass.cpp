@@ -6,6 +6,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
 #include <sstream>
 #include <stack>
 #include <string>
@@ -253,8 +254,8 @@ forwardTaintAnalysis(const Module *M,
   };
 
   if (TaintLog.isEnabled()) {
-    TaintLog << "MODULE:" << DoLog;
-    TaintLog << dumpToString(M) << DoLog;
+    revng_log(TaintLog, "MODULE:");
+    revng_log(TaintLog, dumpToString(M));
   }
 
   // 1. Iterate on the users of `CPUStatePtr`
@@ -300,8 +301,8 @@ forwardTaintAnalysis(const Module *M,
     const Function *F = Load->getFunction();
     if (Load->getNumUses() != 0 and ReachableFunctions.contains(F)) {
       if (TaintLog.isEnabled()) {
-        TaintLog << "Tainted origin: " << Load << DoLog;
-        TaintLog << dumpToString(Load) << DoLog;
+        revng_log(TaintLog, "Tainted origin: " << Load);
+        revng_log(TaintLog, dumpToString(Load));
         TaintLog.indent();
       }
       ToTaintWorkList.push(&*Load->use_begin());
@@ -315,8 +316,8 @@ forwardTaintAnalysis(const Module *M,
       auto *TheUser = cast<Instruction>(TheUse->getUser());
       const auto OpCode = TheUser->getOpcode();
       if (TaintLog.isEnabled()) {
-        TaintLog << "Inst: " << TheUser << DoLog;
-        TaintLog << dumpToString(TheUser) << DoLog;
+        revng_log(TaintLog, "Inst: " << TheUser);
+        revng_log(TaintLog, dumpToString(TheUser));
       }
 
       const size_t Size = ToTaintWorkList.size();
@@ -330,26 +331,26 @@ forwardTaintAnalysis(const Module *M,
       unsigned OperandNo = TheUse->getOperandNo();
       switch (OpCode) {
       case Instruction::Load: {
-        TaintLog << "LOAD" << DoLog;
+        revng_log(TaintLog, "LOAD");
 
         revng_assert(OperandNo == LoadInst::getPointerOperandIndex());
         auto *L = cast<LoadInst>(TheUser);
         if (TheUse->get() == L->getPointerOperand()) {
           if (TaintLog.isEnabled()) {
-            TaintLog << "TAINT: " << TheUser << DoLog;
-            TaintLog << dumpToString(TheUser) << DoLog;
+            revng_log(TaintLog, "TAINT: " << TheUser);
+            revng_log(TaintLog, dumpToString(TheUser));
           }
           Results.TaintedLoads.insert(TheUser);
         }
       } break;
       case Instruction::Store: {
-        TaintLog << "STORE" << DoLog;
+        revng_log(TaintLog, "STORE");
         revng_assert(OperandNo == StoreInst::getPointerOperandIndex());
         auto *S = cast<StoreInst>(TheUser);
         if (TheUse->get() == S->getPointerOperand()) {
           if (TaintLog.isEnabled()) {
-            TaintLog << "TAINT: " << TheUser << DoLog;
-            TaintLog << dumpToString(TheUser) << DoLog;
+            revng_log(TaintLog, "TAINT: " << TheUser);
+            revng_log(TaintLog, dumpToString(TheUser));
           }
           Results.TaintedStores.insert(TheUser);
         }
@@ -363,7 +364,7 @@ forwardTaintAnalysis(const Module *M,
       case Instruction::GetElementPtr:
       case Instruction::PHI:
       case Instruction::Add: {
-        TaintLog << "OP" << DoLog;
+        revng_log(TaintLog, "OP");
         auto OperandId = GetElementPtrInst::getPointerOperandIndex();
         revng_assert(OpCode != Instruction::GetElementPtr
                      or TheUse->getOperandNo() == OperandId);
@@ -372,15 +373,15 @@ forwardTaintAnalysis(const Module *M,
         // on the ToTaintWorkList its first use that is not tainted
         bool JustTainted = Results.TaintedValues.insert(TheUser).second;
         if (TaintLog.isEnabled()) {
-          TaintLog << "TAINT: " << TheUser << DoLog;
-          TaintLog << dumpToString(TheUser) << DoLog;
+          revng_log(TaintLog, "TAINT: " << TheUser);
+          revng_log(TaintLog, dumpToString(TheUser));
         }
         if (JustTainted) {
-          TaintLog << "Just Tainted" << DoLog;
+          revng_log(TaintLog, "Just Tainted");
           for (const Use &U : TheUser->uses()) {
-            TaintLog << "User: " << U.getUser() << DoLog;
+            revng_log(TaintLog, "User: " << U.getUser());
             if (!Results.TaintedValues.contains(U.getUser())) {
-              TaintLog << "PUSH" << DoLog;
+              revng_log(TaintLog, "PUSH");
               ToTaintWorkList.push(&U);
               TaintLog.indent();
               break;
@@ -389,7 +390,7 @@ forwardTaintAnalysis(const Module *M,
         }
       } break;
       case Instruction::Call: {
-        TaintLog << "CALL" << DoLog;
+        revng_log(TaintLog, "CALL");
         auto *TheCall = cast<CallInst>(TheUser);
 
         // If this call has already been decorated with LoadMDKind or
@@ -400,7 +401,7 @@ forwardTaintAnalysis(const Module *M,
         if (Lazy) {
           if (TheCall->getMetadata(LoadMDKind) != nullptr
               or TheCall->getMetadata(StoreMDKind) != nullptr) {
-            TaintLog << "Decorated in a previous run" << DoLog;
+            revng_log(TaintLog, "Decorated in a previous run");
             break;
           }
         }
@@ -414,7 +415,7 @@ forwardTaintAnalysis(const Module *M,
         // Intrinsic::memcpy with non-constant size are considered illegal,
         // because we cannot know how they will affect the CPU State
         if (Callee == nullptr) {
-          TaintLog << "Illegal -- indirect call" << DoLog;
+          revng_log(TaintLog, "Illegal -- indirect call");
           Results.IllegalCalls.insert(TheCall);
           break;
         }
@@ -424,25 +425,25 @@ forwardTaintAnalysis(const Module *M,
           if (isa<ConstantInt>(TheCall->getArgOperand(2))) {
             if (OpNo == 0) {
               if (TaintLog.isEnabled()) {
-                TaintLog << "TAINT: " << TheUser << DoLog;
-                TaintLog << dumpToString(TheUser) << DoLog;
+                revng_log(TaintLog, "TAINT: " << TheUser);
+                revng_log(TaintLog, dumpToString(TheUser));
               }
               Results.TaintedStores.insert(TheUser);
             }
             if (OpNo == 1) {
               if (TaintLog.isEnabled()) {
-                TaintLog << "TAINT: " << TheUser << DoLog;
-                TaintLog << dumpToString(TheUser) << DoLog;
+                revng_log(TaintLog, "TAINT: " << TheUser);
+                revng_log(TaintLog, dumpToString(TheUser));
               }
               Results.TaintedLoads.insert(TheUser);
             }
           } else {
-            TaintLog << "Illegal -- unknown size memcpy" << DoLog;
+            revng_log(TaintLog, "Illegal -- unknown size memcpy");
             Results.IllegalCalls.insert(TheCall);
           }
           break;
         } else if (Callee->empty()) {
-          TaintLog << "Illegal -- no body" << DoLog;
+          revng_log(TaintLog, "Illegal -- no body");
           Results.IllegalCalls.insert(TheCall);
           break;
         }
@@ -458,25 +459,25 @@ forwardTaintAnalysis(const Module *M,
             break;
           }
         }
-        TaintLog << "Found Argument" << DoLog;
+        revng_log(TaintLog, "Found Argument");
         revng_assert(FormalArgument != nullptr);
 
         // Taint the Argument, and if this is the first time we taint it we
         // also push on the ToTaintWorkList its first use that is not tainted.
         if (TaintLog.isEnabled()) {
-          TaintLog << "Argument: " << FormalArgument << DoLog;
-          TaintLog << dumpToString(FormalArgument) << DoLog;
+          revng_log(TaintLog, "Argument: " << FormalArgument);
+          revng_log(TaintLog, dumpToString(FormalArgument));
         }
         bool JustTainted = Results.TaintedValues.insert(FormalArgument).second;
         if (JustTainted) {
-          TaintLog << "Just Tainted" << DoLog;
+          revng_log(TaintLog, "Just Tainted");
           for (const Use &U : FormalArgument->uses()) {
             if (TaintLog.isEnabled()) {
-              TaintLog << "User: " << U.getUser() << DoLog;
-              TaintLog << dumpToString(U.getUser()) << DoLog;
+              revng_log(TaintLog, "User: " << U.getUser());
+              revng_log(TaintLog, dumpToString(U.getUser()));
             }
             if (!Results.TaintedValues.contains(U.getUser())) {
-              TaintLog << "PUSH" << DoLog;
+              revng_log(TaintLog, "PUSH");
               ToTaintWorkList.push(&U);
               TaintLog.indent();
 
@@ -495,15 +496,15 @@ forwardTaintAnalysis(const Module *M,
           // users if any.
           bool JustTainted = Results.TaintedValues.insert(TheUser).second;
           if (TaintLog.isEnabled()) {
-            TaintLog << "TAINT: " << TheUser << DoLog;
-            TaintLog << dumpToString(TheUser) << DoLog;
+            revng_log(TaintLog, "TAINT: " << TheUser);
+            revng_log(TaintLog, dumpToString(TheUser));
           }
           if (JustTainted) {
-            TaintLog << "Just Tainted" << DoLog;
+            revng_log(TaintLog, "Just Tainted");
             for (const Use &U : TheUser->uses()) {
-              TaintLog << "User: " << U.getUser() << DoLog;
+              revng_log(TaintLog, "User: " << U.getUser());
               if (!Results.TaintedValues.contains(U.getUser())) {
-                TaintLog << "PUSH" << DoLog;
+                revng_log(TaintLog, "PUSH");
                 ToTaintWorkList.push(&U);
                 TaintLog.indent();
                 break;
@@ -517,15 +518,15 @@ forwardTaintAnalysis(const Module *M,
         // 3(b) If the next `Use` to explore is a `RetInst` the taint is
         // propagated interprocedurally to the Function.
         // (propagation from the callee to all call sites)
-        TaintLog << "RET" << DoLog;
+        revng_log(TaintLog, "RET");
         revng_assert(not CallSiteInfos.empty());
 
         // Taint the return instruction, then, if this is the first time that we
         // taint also the call site, so that it's marked for propagation of the
         // taint analysis to its uses.
         if (TaintLog.isEnabled()) {
-          TaintLog << "TAINT: " << TheUser << DoLog;
-          TaintLog << dumpToString(TheUser) << DoLog;
+          revng_log(TaintLog, "TAINT: " << TheUser);
+          revng_log(TaintLog, dumpToString(TheUser));
         }
         bool JustTainted = Results.TaintedValues.insert(TheUser).second;
         if (JustTainted) {
@@ -537,8 +538,8 @@ forwardTaintAnalysis(const Module *M,
           FunctionArgTaintsReturn.insert({ Callee, CSInfo.Arg });
 
           if (TaintLog.isEnabled()) {
-            TaintLog << "TAINT: " << CSInfo.CallSite << DoLog;
-            TaintLog << dumpToString(CallSiteInfos.top().CallSite) << DoLog;
+            revng_log(TaintLog, "TAINT: " << CSInfo.CallSite);
+            revng_log(TaintLog, dumpToString(CallSiteInfos.top().CallSite));
             llvm::StringRef Name = getCallee(CSInfo.CallSite)->getName();
             TaintLog << "pair: < " << Name << ", " << CSInfo.ArgNo << " > "
                      << DoLog;
@@ -558,20 +559,20 @@ forwardTaintAnalysis(const Module *M,
       // exploring its uses until we reach a leaf.
       if (Size < ToTaintWorkList.size())
         continue;
-      TaintLog << "not grown" << DoLog;
+      revng_log(TaintLog, "not grown");
 
       // 4. If we didn't push anything on the WorkList we can start exploring
       // the other `Use`s of the item that is currently on top of the WorkList
       if (Size == ToTaintWorkList.size()) {
         Use *NextUse = TheUse->getNext();
         if (NextUse != nullptr) {
-          TaintLog << "advance" << DoLog;
+          revng_log(TaintLog, "advance");
           ToTaintWorkList.top() = NextUse;
           continue;
         }
       }
 
-      TaintLog << "Done" << DoLog;
+      revng_log(TaintLog, "Done");
 
       // 5. If we didn't push anything on the WorkList we can start popping
       //    `Use`s from the WorkList, until we reach a `Value` that still has
@@ -584,12 +585,12 @@ forwardTaintAnalysis(const Module *M,
       while (not ToTaintWorkList.empty() and UnexploredUse == nullptr) {
         const Use *PoppedTopUse = ToTaintWorkList.top();
         if (TaintLog.isEnabled()) {
-          TaintLog << "POP : " << PoppedTopUse->get() << DoLog;
-          TaintLog << dumpToString(PoppedTopUse->get()) << DoLog;
+          revng_log(TaintLog, "POP : " << PoppedTopUse->get());
+          revng_log(TaintLog, dumpToString(PoppedTopUse->get()));
         }
         if (TaintLog.isEnabled()) {
-          TaintLog << "PoppedUser : " << PoppedTopUse->getUser() << DoLog;
-          TaintLog << dumpToString(PoppedTopUse->getUser()) << DoLog;
+          revng_log(TaintLog, "PoppedUser : " << PoppedTopUse->getUser());
+          revng_log(TaintLog, dumpToString(PoppedTopUse->getUser()));
         }
         ToTaintWorkList.pop();
         TaintLog.unindent();
@@ -600,7 +601,7 @@ forwardTaintAnalysis(const Module *M,
           // finished analyzing the uses of that argument. We have to make sure
           // that, if the taint reached the return instructions in the function,
           // the taint is propagated to the call sites.
-          TaintLog << "Finish Argument" << DoLog;
+          revng_log(TaintLog, "Finish Argument");
 
           const CallSiteInfo &CSInfo = CallSiteInfos.top();
           revng_assert(CSInfo.Arg == Arg);
@@ -613,8 +614,8 @@ forwardTaintAnalysis(const Module *M,
           const Function *Callee = getCallee(CallSite);
 
           if (TaintLog.isEnabled()) {
-            TaintLog << "CallSite: " << CallSite << DoLog;
-            TaintLog << dumpToString(CallSite) << DoLog;
+            revng_log(TaintLog, "CallSite: " << CallSite);
+            revng_log(TaintLog, dumpToString(CallSite));
           }
 
           // If the CallSite was tainted it means that the taint analysis
@@ -635,7 +636,7 @@ forwardTaintAnalysis(const Module *M,
           // Argument for which we just popped the PoppedTopUse.
           CallSiteInfos.pop();
         } else {
-          TaintLog << "NOT Finished or NOT Argument" << DoLog;
+          revng_log(TaintLog, "NOT Finished or NOT Argument");
           UnexploredUse = PoppedTopUse->getNext();
         }
       }
@@ -646,8 +647,8 @@ forwardTaintAnalysis(const Module *M,
       // If we have a new UnexploredUse we push it and we continue
       // because that's the new use that must be analyzed.
       if (UnexploredUse != nullptr) {
-        TaintLog << "PUSH: " << UnexploredUse->get() << DoLog;
-        TaintLog << "User: " << UnexploredUse->getUser() << DoLog;
+        revng_log(TaintLog, "PUSH: " << UnexploredUse->get());
+        revng_log(TaintLog, "User: " << UnexploredUse->getUser());
         ToTaintWorkList.push(UnexploredUse);
         TaintLog.indent();
       }
@@ -821,13 +822,13 @@ public:
   }
 
 public:
-  friend inline void writeToLog(Logger<true> &L, const WorkItem &I, int) {
-    L << "Value: " << I.val() << " : " << dumpToString(I.val()) << DoLog;
-    L << "Sources = {" << DoLog;
+  friend inline void writeToLog(Logger<> &L, const WorkItem &I, int) {
+    revng_log(L, "Value: " << I.val() << " : " << dumpToString(I.val()));
+    revng_log(L, "Sources = {");
     L.indent();
     for (const Use *U : I.sources())
-      L << U->get() << " : " << dumpToString(U->get()) << DoLog;
-    L << "}" << DoLog;
+      revng_log(L, U->get() << " : " << dumpToString(U->get()));
+    revng_log(L, "}");
     L << "Curr Src Id: " << I.SourceIndex;
     L.unindent();
   }
@@ -1011,7 +1012,7 @@ public:
 
     if (CSVAccessLog.isEnabled())
       for (const CallInst *C : CallSites)
-        CSVAccessLog << "C: " << C << " : " << dumpToString(C) << DoLog;
+        revng_log(CSVAccessLog, "C: " << C << " : " << dumpToString(C));
 
     // Check that each source has all the callsites or nullptr
     for (const auto &CSOffsets : SrcCallSiteOffsetsPtrs) {
@@ -2248,12 +2249,47 @@ void CPUSAOA::computeAggregatedOffsets() {
                                                 CallSiteStoreOffsets;
   AccessOffsetMap &AccessOffsets = IsLoad ? LoadOffsets : StoreOffsets;
 
+  const DataLayout &DL = M.getDataLayout();
+
+  // The same coarse offsets, accessed with the same size, show up for many
+  // accesses and many call sites in root: refine each of them only once.
+  using CoarseAccess = std::pair<int64_t, int64_t>;
+  std::map<CoarseAccess, std::vector<int64_t>> RefinedOffsets;
+  auto Refine = [this, &DL, &RefinedOffsets](int64_t Coarse,
+                                             int64_t AccessSize)
+    -> const std::vector<int64_t> & {
+    auto [It, New] = RefinedOffsets.try_emplace({ Coarse, AccessSize });
+    if (not New)
+      return It->second;
+
+    std::vector<int64_t> &Result = It->second;
+    int64_t Refined = Coarse;
+    int64_t End = Coarse + AccessSize;
+    while (Refined < End) {
+      unsigned InternalOffset = 0;
+      GlobalVariable *AccessedVar = nullptr;
+      std::tie(AccessedVar,
+               InternalOffset) = Variables->getByEnvOffset(Refined);
+      int64_t SizeAtOffset = 0;
+      if (AccessedVar != nullptr) {
+        Type *AccessedTy = AccessedVar->getValueType();
+        SizeAtOffset = DL.getTypeAllocSize(AccessedTy) - InternalOffset;
+        revng_assert(SizeAtOffset > 0);
+        Result.push_back(Refined - InternalOffset);
+      } else {
+        // Skip padding one byte at a time, without adding offsets
+        SizeAtOffset = 1;
+      }
+      revng_assert(SizeAtOffset != 0);
+      Refined += SizeAtOffset;
+    }
+    return Result;
+  };
+
   for (std::pair<Value *const, CallSiteOffsetMap> &ACSO : AccessCSOffsets) {
     // This is the load/store that actually accesses the CPU State
     Value *I = ACSO.first;
 
-    auto DL = M.getDataLayout();
-
     bool IsInstr = isa<Instruction>(I);
     bool IsCorrectAccessType = IsLoad ? isa<LoadInst>(I) : isa<StoreInst>(I);
     bool IsCallToBuiltinMemcpy = callsBuiltinMemcpy(dyn_cast<Instruction>(I));
@@ -2308,27 +2344,10 @@ void CPUSAOA::computeAggregatedOffsets() {
           std::set<int64_t> FineGrainedOffsets;
           // Now compute the fine-grained offsets
           for (const int64_t Coarse : O) {
-            int64_t Refined = Coarse;
-            int64_t End = Coarse + AccessSize;
-            while (Refined < End) {
-              unsigned InternalOffset = 0;
-              GlobalVariable *AccessedVar = nullptr;
-              std::tie(AccessedVar,
-                       InternalOffset) = Variables->getByEnvOffset(Refined);
-              int64_t SizeAtOffset = 0;
-              if (AccessedVar != nullptr) {
-                Type *AccessedTy = AccessedVar->getValueType();
-                SizeAtOffset = DL.getTypeAllocSize(AccessedTy) - InternalOffset;
-                revng_assert(SizeAtOffset > 0);
-                FineGrainedOffsets.insert(Refined - InternalOffset);
-                CSVAccessLog << "Value: " << I << DoLog;
-                CSVAccessLog << "Insert Refined: " << Refined << DoLog;
-              } else {
-                // Skip padding one byte at a time, without adding offsets
-                SizeAtOffset = 1;
-              }
-              revng_assert(SizeAtOffset != 0);
-              Refined += SizeAtOffset;
+            for (const int64_t Refined : Refine(Coarse, AccessSize)) {
+              FineGrainedOffsets.insert(Refined);
+              revng_log(CSVAccessLog, "Value: " << I);
+              revng_log(CSVAccessLog, "Insert Refined: " << Refined);
             }
           }
           New = CSVOffsets(O.getKind(), FineGrainedOffsets);
@@ -2356,8 +2375,8 @@ bool CPUSAOA::run() {
     TaintLog << "== ACCESS ANALYSIS RESULTS ==\n";
     TaintLog << "== Loads ==\n";
     for (Instruction *LoadOrStore : TaintedAccesses.TaintedLoads) {
-      TaintLog << "INSTRUCTION: " << LoadOrStore << DoLog;
-      TaintLog << dumpToString(LoadOrStore) << DoLog;
+      revng_log(TaintLog, "INSTRUCTION: " << LoadOrStore);
+      revng_log(TaintLog, dumpToString(LoadOrStore));
       TaintLog.indent(4);
       for (const auto &CSO : LoadCallSiteOffsets.at(LoadOrStore)) {
         TaintLog << "CallSite: " << CSO.first << '\n';
@@ -2371,8 +2390,8 @@ bool CPUSAOA::run() {
     }
     TaintLog << "== Stores ==\n";
     for (Instruction *LoadOrStore : TaintedAccesses.TaintedStores) {
-      TaintLog << "INSTRUCTION: " << LoadOrStore << DoLog;
-      TaintLog << dumpToString(LoadOrStore) << DoLog;
+      revng_log(TaintLog, "INSTRUCTION: " << LoadOrStore);
+      revng_log(TaintLog, dumpToString(LoadOrStore));
       TaintLog.indent(4);
       for (const auto &CSO : StoreCallSiteOffsets.at(LoadOrStore)) {
         TaintLog << "CallSite: " << CSO.first << '\n';
@@ -2712,9 +2731,9 @@ void CPUStateAccessFixer::correctCPUStateAccesses() {
   auto &OtherCSVAccessOffsetMap = IsLoad ? CSVStoreOffsetMap : CSVLoadOffsetMap;
 
   if (IsLoad)
-    FixAccessLog << "######## Fixing Loads ########" << DoLog;
+    revng_log(FixAccessLog, "######## Fixing Loads ########");
   else
-    FixAccessLog << "######## Fixing Stores ########" << DoLog;
+    revng_log(FixAccessLog, "######## Fixing Stores ########");
 
   Type *CharTy = IntegerType::getInt8Ty(M.getContext());
   for (const Pair &IOff : CSVAccessOffsetMap) {
@@ -2834,7 +2853,7 @@ void CPUStateAccessFixer::fixAccess(const Pair &IOff) {
 
     if (IsLoad) {
       if (LoadedType != nullptr and LoadedType->isPointerTy()) {
-        FixAccessLog << "REPLACE!" << DoLog;
+        revng_log(FixAccessLog, "REPLACE!");
         Constant *NullPtr = Constant::getNullValue(LoadedType);
         AccessToFix->replaceAllUsesWith(NullPtr);
         break; // out from the big switch to the verify and cleanup code
@@ -2842,7 +2861,7 @@ void CPUStateAccessFixer::fixAccess(const Pair &IOff) {
       // TODO: Handle memcpy, not necessary for now
     } else {
       if (StoredType != nullptr and StoredType->isPointerTy()) {
-        FixAccessLog << "REPLACE!" << DoLog;
+        revng_log(FixAccessLog, "REPLACE!");
         break; // out from the big switch to the verify and cleanup code
       }
       // TODO: Handle memcpy, not necessary for now
@@ -3010,13 +3029,13 @@ void CPUStateAccessFixer::fixAccess(const Pair &IOff) {
     if (FixAccessLog.isEnabled()) {
       FixAccessLog << "Queuing for erasure AccessToFix: " << AccessToFix
                    << DoLog;
-      FixAccessLog << dumpToString(AccessToFix) << DoLog;
+      revng_log(FixAccessLog, dumpToString(AccessToFix));
     }
     InstructionsToRemove.push_back(AccessToFix);
   }
   if (FixAccessLog.isEnabled()) {
-    FixAccessLog << "Queuing for erasure Instr: " << Instr << DoLog;
-    FixAccessLog << dumpToString(Instr) << DoLog;
+    revng_log(FixAccessLog, "Queuing for erasure Instr: " << Instr);
+    revng_log(FixAccessLog, dumpToString(Instr));
   }
   InstructionsToRemove.push_back(Instr);
 }
@@ -3039,14 +3058,14 @@ bool CPUStateAccessFixer::run() {
   InstructionsToRemove.clear();
 
   if (FixAccessLog.isEnabled()) {
-    FixAccessLog << "Num Unknowns: " << NumUnknown << DoLog;
+    revng_log(FixAccessLog, "Num Unknowns: " << NumUnknown);
 
     for (const auto &Fun2Num : FunToNumUnknown)
-      FixAccessLog << Fun2Num.first << ": " << Fun2Num.second << DoLog;
+      revng_log(FixAccessLog, Fun2Num.first << ": " << Fun2Num.second);
 
     for (const auto &Fun2Unknowns : FunToUnknowns)
       for (const auto &U : Fun2Unknowns.second)
-        FixAccessLog << Fun2Unknowns.first << ": " << U << DoLog;
+        revng_log(FixAccessLog, Fun2Unknowns.first << ": " << U);
   }
   return true;
 }
@@ -3117,14 +3136,14 @@ static void addAccessMetadata(const CallSiteOffsetMap &OffsetMap,
     OffsetMetadata.reserve(Offsets.size());
     std::set<GlobalVariable *> AccessedVars;
     if (Offsets.isUnknownInPtr()) {
-      CSVAccessLog << "Unknown access to CSV" << DoLog;
+      revng_log(CSVAccessLog, "Unknown access to CSV");
       UnknownAccess = QMD.get((uint32_t) 1);
       AccessedVariablesTuple = QMD.tuple(OffsetMetadata);
     } else {
       UnknownAccess = QMD.get((uint32_t) 0);
       for (const int64_t O : Offsets) {
-        CSVAccessLog << "CallSite: " << CallSite << DoLog;
-        CSVAccessLog << "Refined: " << O << DoLog;
+        revng_log(CSVAccessLog, "CallSite: " << CallSite);
+        revng_log(CSVAccessLog, "Refined: " << O);
         GlobalVariable *AccessedVar = Variables->getByEnvOffset(O).first;
         bool NewlyInserted = AccessedVars.insert(AccessedVar).second;
         if (NewlyInserted) {
@@ -3187,14 +3206,14 @@ bool CPUStateAccessAnalysis::run() {
 
   // Start with a forward taint analysis, to detect all the tainted Values,
   // and all the tainted loads and stores.
-  CSVAccessLog << "Before Taint Analysis" << DoLog;
+  revng_log(CSVAccessLog, "Before Taint Analysis");
   const auto TaintResults = forwardTaintAnalysis(&M,
                                                  CPUStatePtr,
                                                  ReachedFunctions,
                                                  LoadMDKind,
                                                  StoreMDKind,
                                                  Lazy);
-  CSVAccessLog << "After Taint Analysis" << DoLog;
+  revng_log(CSVAccessLog, "After Taint Analysis");
 
   // If there are no tainted loads and stores we don't need to run the CPUSAOA.
   if (TaintResults.TaintedLoads.empty()
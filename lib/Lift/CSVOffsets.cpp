@@ -8,7 +8,7 @@
 
 #include "CSVOffsets.h"
 
-void writeToLog(Logger<true> &L, const CSVOffsets &O, int /*Ignore*/) {
+void writeToLog(Logger<> &L, const CSVOffsets &O, int /*Ignore*/) {
   L << "Kind: " << CSVOffsets::toString(O.OffsetKind);
   L << " Offsets = { ";
   for (const auto &Offset : O)
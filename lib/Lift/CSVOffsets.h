@@ -72,7 +72,7 @@ public:
   }
 
 public:
-  friend void writeToLog(Logger<true> &L, const CSVOffsets &O, int /*Ignore*/);
+  friend void writeToLog(Logger<> &L, const CSVOffsets &O, int /*Ignore*/);
 
 private:
   explicit operator Kind() const { return OffsetKind; }
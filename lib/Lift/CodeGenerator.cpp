@@ -44,9 +44,11 @@
 #include "revng/Model/Architecture.h"
 #include "revng/Model/Importer/DebugInfo/DwarfImporter.h"
 #include "revng/Model/RawBinaryView.h"
+#include "revng/Pipeline/IRModuleCache.h"
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/FunctionTags.h"
+#include "revng/Support/InstructionAnnotations.h"
 #include "revng/Support/ProgramCounterHandler.h"
 
 #include "CodeGenerator.h"
@@ -131,10 +133,15 @@ public:
 // Outline the destructor for the sake of privacy in the header
 CodeGenerator::~CodeGenerator() = default;
 
-static std::unique_ptr<Module> parseIR(StringRef Path, LLVMContext &Context) {
+static std::unique_ptr<Module> parseIR(StringRef Path,
+                                       LLVMContext &Context,
+                                       pipeline::IRModuleCache *Cache) {
   std::unique_ptr<Module> Result;
   SMDiagnostic Errors;
-  Result = parseIRFile(Path, Errors, Context);
+  if (Cache != nullptr and &Cache->getContext() == &Context)
+    Result = Cache->parseIRFile(Path, Errors);
+  else
+    Result = parseIRFile(Path, Errors, Context);
 
   if (Result.get() == nullptr) {
     Errors.print("revng", dbgs());
@@ -149,7 +156,8 @@ CodeGenerator::CodeGenerator(const RawBinaryView &RawBinary,
                              const TupleTree<model::Binary> &Model,
                              std::string Helpers,
                              std::string EarlyLinked,
-                             model::Architecture::Values TargetArchitecture) :
+                             model::Architecture::Values TargetArchitecture,
+                             pipeline::IRModuleCache *ModuleCache) :
   RawBinary(RawBinary),
   TheModule(TheModule),
   Context(TheModule->getContext()),
@@ -159,7 +167,7 @@ CodeGenerator::CodeGenerator(const RawBinaryView &RawBinary,
   OriginalInstrMDKind = Context.getMDKindID("oi");
   PTCInstrMDKind = Context.getMDKindID("pi");
 
-  HelpersModule = parseIR(Helpers, Context);
+  HelpersModule = parseIR(Helpers, Context, ModuleCache);
 
   TheModule->setDataLayout(HelpersModule->getDataLayout());
 
@@ -180,7 +188,7 @@ CodeGenerator::CodeGenerator(const RawBinaryView &RawBinary,
       FunctionTags::Exceptional.addTo(&F);
   }
 
-  EarlyLinkedModule = parseIR(EarlyLinked, Context);
+  EarlyLinkedModule = parseIR(EarlyLinked, Context, ModuleCache);
   for (llvm::Function &F : *EarlyLinkedModule) {
     if (F.isIntrinsic())
       continue;
@@ -863,12 +871,28 @@ void CodeGenerator::translate(optional<uint64_t> RawVirtualAddress) {
   Task LiftTask({}, "Lifting");
   LiftTask.advance("Initial address peeking", false);
 
+  // If requested, record the annotations in a side table, instead of the IR
+  InstructionAnnotations Annotations;
+  InstructionAnnotations *SideTable = nullptr;
+  if (not AnnotationsPath.empty())
+    SideTable = &Annotations;
+
+  // The PTC of the instruction being translated, when using the side table
+  MetaAddress PTCAddress = MetaAddress::invalid();
+  std::string PTCText;
+  auto FlushPTC = [&]() {
+    if (PTCAddress.isValid() and not PTCText.empty())
+      Annotations.record(InstructionAnnotations::PTC, PTCAddress, PTCText);
+    PTCText.clear();
+  };
+
   InstructionTranslator Translator(Builder,
                                    Variables,
                                    JumpTargets,
                                    Blocks,
                                    EndianessMismatch,
-                                   PCH.get());
+                                   PCH.get(),
+                                   SideTable);
 
   std::tie(VirtualAddress, Entry) = JumpTargets.peek();
 
@@ -935,7 +959,7 @@ void CodeGenerator::translate(optional<uint64_t> RawVirtualAddress) {
     if (PTCLog.isEnabled()) {
       std::stringstream Stream;
       dumpTranslation(VirtualAddress, Stream, InstructionList.get());
-      PTCLog << Stream.str() << DoLog;
+      revng_log(PTCLog, Stream.str());
     }
 
     Variables.newFunction(InstructionList.get());
@@ -1065,8 +1089,17 @@ void CodeGenerator::translate(optional<uint64_t> RawVirtualAddress) {
         std::stringstream PTCStringStream;
         dumpInstruction(PTCStringStream, InstructionList.get(), J);
         std::string PTCString = PTCStringStream.str() + "\n";
-        MDString *MDPTCString = MDString::get(Context, PTCString);
-        MDPTCInstr = MDNode::getDistinct(Context, MDPTCString);
+        if (SideTable != nullptr) {
+          // Collect all the PTC of the current input instruction
+          if (PC != PTCAddress) {
+            FlushPTC();
+            PTCAddress = PC;
+          }
+          PTCText += PTCString;
+        } else {
+          MDString *MDPTCString = MDString::get(Context, PTCString);
+          MDPTCInstr = MDNode::getDistinct(Context, MDPTCString);
+        }
       }
 
       // Set metadata for all the new instructions
@@ -1106,6 +1139,12 @@ void CodeGenerator::translate(optional<uint64_t> RawVirtualAddress) {
 
   LiftTask.complete();
 
+  if (SideTable != nullptr) {
+    FlushPTC();
+    if (auto Error = Annotations.save(AnnotationsPath))
+      revng_abort(toString(std::move(Error)).c_str());
+  }
+
   OI.drop();
 
   // Reorder basic blocks in RPOT
@@ -26,18 +26,26 @@ class DataLayout;
 
 }; // namespace llvm
 
+namespace pipeline {
+class IRModuleCache;
+} // namespace pipeline
+
 /// Translator from binary code to LLVM IR.
 class CodeGenerator {
 public:
   /// Create a new code generator translating code from an architecture to
   /// another, writing the corresponding LLVM IR and other useful information to
   /// the specified paths.
+  ///
+  /// \param ModuleCache if not nullptr, where to get \p Helpers and
+  ///        \p EarlyLinked from, instead of parsing them again.
   CodeGenerator(const RawBinaryView &RawBinary,
                 llvm::Module *TheModule,
                 const TupleTree<model::Binary> &Model,
                 std::string Helpers,
                 std::string EarlyLinked,
-                model::Architecture::Values TargetArchitecture);
+                model::Architecture::Values TargetArchitecture,
+                pipeline::IRModuleCache *ModuleCache = nullptr);
 
   ~CodeGenerator();
 
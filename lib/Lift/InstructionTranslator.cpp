@@ -23,6 +23,7 @@
 #include "revng/Support/Assert.h"
 #include "revng/Support/FunctionTags.h"
 #include "revng/Support/IRHelpers.h"
+#include "revng/Support/InstructionAnnotations.h"
 #include "revng/Support/RandomAccessIterator.h"
 #include "revng/Support/Range.h"
 
@@ -469,7 +470,8 @@ IT::InstructionTranslator(IRBuilder<> &Builder,
                           JumpTargetManager &JumpTargets,
                           std::vector<BasicBlock *> Blocks,
                           bool EndianessMismatch,
-                          ProgramCounterHandler *PCH) :
+                          ProgramCounterHandler *PCH,
+                          InstructionAnnotations *Annotations) :
   Builder(Builder),
   Variables(Variables),
   JumpTargets(JumpTargets),
@@ -479,7 +481,8 @@ IT::InstructionTranslator(IRBuilder<> &Builder,
   EndianessMismatch(EndianessMismatch),
   NewPCMarker(nullptr),
   LastPC(MetaAddress::invalid()),
-  PCH(PCH) {
+  PCH(PCH),
+  Annotations(Annotations) {
 
   auto &Context = TheModule.getContext();
   using FT = FunctionType;
@@ -651,14 +654,21 @@ IT::newInstruction(PTCInstruction *Instr,
     disassemble(OriginalStringStream, PC, *(NextPC - PC));
     std::string OriginalString = OriginalStringStream.str();
 
-    // We don't deduplicate this string since performing a lookup each time is
-    // increasingly expensive and we should have relatively few collisions
-    std::string AddressName = JumpTargets.nameForAddress(PC);
-    String = getUniqueString(&TheModule, OriginalString);
+    if (Annotations != nullptr) {
+      // Keep the disassembly out of the IR
+      Annotations->record(InstructionAnnotations::Assembly,
+                          PC,
+                          OriginalString);
+      String = ConstantPointerNull::get(Int8PtrTy);
+    } else {
+      // We don't deduplicate this string since performing a lookup each time
+      // is increasingly expensive and we should have relatively few collisions
+      String = getUniqueString(&TheModule, OriginalString);
 
-    auto *MDOriginalString = ConstantAsMetadata::get(String);
-    auto *MDPC = ConstantAsMetadata::get(PC.toValue(&TheModule));
-    MDOriginalInstr = MDNode::get(Context, { MDOriginalString, MDPC });
+      auto *MDOriginalString = ConstantAsMetadata::get(String);
+      auto *MDPC = ConstantAsMetadata::get(PC.toValue(&TheModule));
+      MDOriginalInstr = MDNode::get(Context, { MDOriginalString, MDPC });
+    }
   } else {
     String = ConstantPointerNull::get(Int8PtrTy);
   }
@@ -750,7 +760,7 @@ IT::TranslationResult
 IT::translate(PTCInstruction *Instr, MetaAddress PC, MetaAddress NextPC) {
   const PTC::Instruction TheInstruction(Instr);
 
-  std::vector<Value *> InArgs;
+  SmallVector<Value *, 4> InArgs;
   for (uint64_t TemporaryId : TheInstruction.InArguments) {
     auto *Load = Variables.load(Builder, TemporaryId);
     if (Load == nullptr)
@@ -758,11 +768,10 @@ IT::translate(PTCInstruction *Instr, MetaAddress PC, MetaAddress NextPC) {
     InArgs.push_back(Load);
   }
 
-  auto ConstArgs = TheInstruction.ConstArguments;
+  SmallVector<uint64_t, 4> ConstArgs(TheInstruction.ConstArguments.begin(),
+                                     TheInstruction.ConstArguments.end());
   LastPC = PC;
-  auto Result = translateOpcode(TheInstruction.opcode(),
-                                ConstArgs.toVector(),
-                                InArgs);
+  auto Result = translateOpcode(TheInstruction.opcode(), ConstArgs, InArgs);
 
   // Check if there was an error while translating the instruction
   if (!Result)
@@ -810,10 +819,17 @@ void IT::registerDirectJumps() {
   ExitBlocks.clear();
 }
 
+Function *IT::getBSwap(Type *Type) {
+  Function *&Result = BSwapDeclarations[Type];
+  if (Result == nullptr)
+    Result = Intrinsic::getDeclaration(&TheModule, Intrinsic::bswap, { Type });
+  return Result;
+}
+
 ErrorOr<std::vector<Value *>>
 IT::translateOpcode(PTCOpcode Opcode,
-                    std::vector<uint64_t> ConstArguments,
-                    std::vector<Value *> InArguments) {
+                    ArrayRef<uint64_t> ConstArguments,
+                    ArrayRef<Value *> InArguments) {
   LLVMContext &Context = TheModule.getContext();
   unsigned RegisterSize = getRegisterSize(Opcode);
   Type *RegisterType = nullptr;
@@ -891,9 +907,7 @@ IT::translateOpcode(PTCOpcode Opcode,
     //       template-parametric w.r.t. endianness mismatch
     Function *BSwapFunction = nullptr;
     if (MemoryType != Builder.getInt8Ty() and EndianessMismatch)
-      BSwapFunction = Intrinsic::getDeclaration(&TheModule,
-                                                Intrinsic::bswap,
-                                                { MemoryType });
+      BSwapFunction = getBSwap(MemoryType);
 
     bool SignExtend = ptc_is_sign_extended_load(MemoryAccess.type);
 
@@ -1291,9 +1305,7 @@ IT::translateOpcode(PTCOpcode Opcode,
 
     Value *Truncated = Builder.CreateTrunc(InArguments[0], SwapType);
 
-    Function *BSwapFunction = Intrinsic::getDeclaration(&TheModule,
-                                                        Intrinsic::bswap,
-                                                        { SwapType });
+    Function *BSwapFunction = getBSwap(SwapType);
     Value *Swapped = Builder.CreateCall(BSwapFunction, Truncated);
 
     return v{ Builder.CreateZExt(Swapped, RegisterType) };
@@ -8,6 +8,8 @@
 #include <map>
 #include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Pass.h"
@@ -27,6 +29,7 @@ class MDNode;
 class Module;
 } // namespace llvm
 
+class InstructionAnnotations;
 class JumpTargetManager;
 class VariableManager;
 
@@ -42,12 +45,15 @@ public:
   /// \param Blocks reference to a `vector` of `BasicBlock`s used to keep track
   ///        on which `BasicBlock`s the InstructionTranslator worked on, for
   ///        further processing.
+  /// \param Annotations if not nullptr, where to record the disassembly of
+  ///        the instructions, instead of the IR.
   InstructionTranslator(llvm::IRBuilder<> &Builder,
                         VariableManager &Variables,
                         JumpTargetManager &JumpTargets,
                         std::vector<llvm::BasicBlock *> Blocks,
                         bool EndianessMismatch,
-                        ProgramCounterHandler *PCH);
+                        ProgramCounterHandler *PCH,
+                        InstructionAnnotations *Annotations = nullptr);
 
   // Emit a call to newpc
   llvm::CallInst *emitNewPCCall(llvm::IRBuilder<> &Builder,
@@ -123,8 +129,11 @@ public:
 private:
   llvm::ErrorOr<std::vector<llvm::Value *>>
   translateOpcode(PTCOpcode Opcode,
-                  std::vector<uint64_t> ConstArguments,
-                  std::vector<llvm::Value *> InArguments);
+                  llvm::ArrayRef<uint64_t> ConstArguments,
+                  llvm::ArrayRef<llvm::Value *> InArguments);
+
+  /// \return the declaration of the bswap intrinsic for \p Type
+  llvm::Function *getBSwap(llvm::Type *Type);
 
 private:
   llvm::IRBuilder<> &Builder;
@@ -143,5 +152,10 @@ private:
   MetaAddress LastPC;
 
   ProgramCounterHandler *PCH = nullptr;
+  InstructionAnnotations *Annotations = nullptr;
   llvm::SmallVector<llvm::BasicBlock *, 4> ExitBlocks;
+
+  /// Cache of the bswap intrinsic declarations, which would otherwise be
+  /// mangled and looked up in the module for every memory access
+  llvm::DenseMap<llvm::Type *, llvm::Function *> BSwapDeclarations;
 };
@@ -6,7 +6,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <ranges>
+#include <vector>
+
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/Progress.h"
 #include "llvm/Transforms/Scalar.h"
@@ -15,6 +19,7 @@
 #include "revng/Model/VerifyHelper.h"
 #include "revng/Support/MetaAddress.h"
 #include "revng/Support/Statistics.h"
+#include "revng/Support/TaskScheduler.h"
 
 #include "JumpTargetManager.h"
 #include "RootAnalyzer.h"
@@ -35,6 +40,42 @@ RegisterPass<TranslateDirectBranchesPass> X("translate-db",
                                             false,
                                             false);
 
+/// The executable ranges as plain integers, to quickly discard the values that
+/// cannot be code pointers without building a MetaAddress for each of them
+class CodePointerFilter {
+private:
+  /// Start and size of each executable range
+  llvm::SmallVector<std::pair<uint64_t, uint64_t>, 8> Ranges;
+  /// Bits of a value that are part of the address it points to
+  uint64_t AddressMask = std::numeric_limits<uint64_t>::max();
+
+public:
+  CodePointerFilter(const MetaAddressRangeSet &Executable,
+                    llvm::Triple::ArchType Architecture) {
+    for (const auto &[Start, End] : Executable) {
+      revng_assert(Start.addressLowerThanOrEqual(End));
+      Ranges.emplace_back(Start.address(), End.address() - Start.address());
+    }
+
+    // On ARM the LSB selects Thumb and is not part of the address
+    if (Architecture == llvm::Triple::arm)
+      AddressMask = ~static_cast<uint64_t>(1);
+  }
+
+public:
+  /// \return false if \p Value certainly doesn't point to executable code
+  ///
+  /// There are no branches depending on \p Value: ranges are few and usually
+  /// nothing matches.
+  bool mayPointToCode(uint64_t Value) const {
+    Value &= AddressMask;
+    bool Result = false;
+    for (const auto &[Start, Size] : Ranges)
+      Result |= (Value - Start) < Size;
+    return Result;
+  }
+};
+
 } // namespace
 
 char TranslateDirectBranchesPass::ID = 0;
@@ -495,7 +536,7 @@ void JumpTargetManager::harvestGlobalData() {
 
   revng_log(JTCountLog,
             "JumpTargets found in global data: " << std::dec
-                                                 << Unexplored.size());
+                                                 << UnexploredBlocks.size());
 }
 
 template<typename value_type, unsigned endian>
@@ -515,17 +556,44 @@ void JumpTargetManager::findCodePointers(MetaAddress StartVirtualAddress,
   if (Misalignment != 0)
     Cursor += Step - Misalignment;
 
-  for (; Cursor < End - Step; Cursor += Step) {
-    auto Read = read<value_type, static_cast<endianness>(endian), 1>;
-    uint64_t RawValue = Read(Cursor);
-    MetaAddress Value = fromPC(RawValue);
-    if (Value.isInvalid())
-      continue;
+  // All the words starting before the last Step bytes are considered
+  ptrdiff_t Available = (End - Cursor) - static_cast<ptrdiff_t>(Step);
+  if (Available <= 0)
+    return;
+  size_t Words = (Available + Step - 1) / Step;
+
+  // Find in parallel, one chunk at a time, the words that might be code
+  // pointers. Then, register them in address order, as registering changes
+  // the IR and the order in which jump targets are met has to be
+  // deterministic.
+  using namespace model::Architecture;
+  CodePointerFilter Filter(ExecutableRanges,
+                           toLLVMArchitecture(Model->Architecture()));
+  auto Read = read<value_type, static_cast<endianness>(endian), 1>;
+
+  constexpr size_t WordsPerChunk = 64 * 1024;
+  size_t Chunks = (Words + WordsPerChunk - 1) / WordsPerChunk;
+  std::vector<std::vector<size_t>> Candidates(Chunks);
+  auto FindCandidates = [&](size_t Chunk) {
+    size_t Last = std::min(Words, (Chunk + 1) * WordsPerChunk);
+    for (size_t I = Chunk * WordsPerChunk; I < Last; ++I)
+      if (Filter.mayPointToCode(Read(Cursor + I * Step)))
+        Candidates[Chunk].push_back(I);
+  };
+  revng::parallelForEach(std::views::iota(size_t(0), Chunks), FindCandidates);
+
+  for (const std::vector<size_t> &ChunkCandidates : Candidates) {
+    for (size_t I : ChunkCandidates) {
+      const unsigned char *Word = Cursor + I * Step;
+      MetaAddress Value = fromPC(Read(Word));
+      if (Value.isInvalid())
+        continue;
 
-    BasicBlock *Result = registerJT(Value, JTReason::GlobalData);
+      BasicBlock *Result = registerJT(Value, JTReason::GlobalData);
 
-    if (Result != nullptr)
-      UnusedCodePointers.insert(StartVirtualAddress + (Cursor - Start));
+      if (Result != nullptr)
+        UnusedCodePointers.insert(StartVirtualAddress + (Word - Start));
+    }
   }
 }
 
@@ -545,33 +613,29 @@ BasicBlock *JumpTargetManager::newPC(MetaAddress PC, bool &ShouldContinue) {
   revng_assert(PC.isValid());
 
   // Did we already meet this PC?
-  auto JTIt = JumpTargets.find(PC);
-  if (JTIt != JumpTargets.end()) {
+  if (JumpTarget *JT = findJT(PC)) {
     // If it was planned to explore it in the future, just to do it now
-    for (auto UnexploredIt = Unexplored.begin();
-         UnexploredIt != Unexplored.end();
-         UnexploredIt++) {
-
-      if (UnexploredIt->first == PC) {
-        BasicBlock *Result = UnexploredIt->second;
-
-        // Check if we already have a translation for that
-        ShouldContinue = Result->empty();
-        if (ShouldContinue) {
-          // We don't, OK let's explore it next
-          Unexplored.erase(UnexploredIt);
-        } else {
-          // We do, it will be purged at the next `peek`
-          revng_assert(ToPurge.contains(Result));
-        }
-
-        return Result;
+    auto UnexploredIt = UnexploredBlocks.find(PC);
+    if (UnexploredIt != UnexploredBlocks.end()) {
+      BasicBlock *Result = UnexploredIt->second;
+
+      // Check if we already have a translation for that
+      ShouldContinue = Result->empty();
+      if (ShouldContinue) {
+        // We don't, OK let's explore it next. The corresponding entry in
+        // `Unexplored` will be dropped by `peek`.
+        UnexploredBlocks.erase(UnexploredIt);
+      } else {
+        // We do, it will be purged at the next `peek`
+        revng_assert(ToPurge.contains(Result));
       }
+
+      return Result;
     }
 
     // It wasn't planned to visit it, so we've already been there, just jump
     // there
-    BasicBlock *BB = JTIt->second.head();
+    BasicBlock *BB = JT->head();
     revng_assert(!BB->empty());
     ShouldContinue = false;
     return BB;
@@ -778,19 +842,27 @@ JumpTargetManager::BlockWithAddress JumpTargetManager::peek() {
   // If we just harvested new branches, keep exploring
   do {
     harvest();
-  } while (Unexplored.empty() and NewBranches != 0);
+  } while (UnexploredBlocks.empty() and NewBranches != 0);
 
   // Purge all the partial translations we know might be wrong
   for (BasicBlock *BB : ToPurge)
     purgeTranslation(BB);
   ToPurge.clear();
 
-  if (Unexplored.empty()) {
+  if (UnexploredBlocks.empty()) {
+    Unexplored.clear();
     revng_log(JTCountLog, "We're done looking for jump targets");
     return NoMoreTargets;
   } else {
-    BlockWithAddress Result = Unexplored.back();
-    Unexplored.pop_back();
+    // Skip the entries that have been explored in the meantime by `newPC`
+    BlockWithAddress Result;
+    do {
+      revng_assert(not Unexplored.empty());
+      Result = Unexplored.back();
+      Unexplored.pop_back();
+    } while (not UnexploredBlocks.contains(Result.first));
+
+    UnexploredBlocks.erase(Result.first);
     return Result;
   }
 }
@@ -798,9 +870,9 @@ JumpTargetManager::BlockWithAddress JumpTargetManager::peek() {
 BasicBlock *JumpTargetManager::getBlockAt(MetaAddress PC) {
   revng_assert(PC.isValid());
 
-  auto TargetIt = JumpTargets.find(PC);
-  revng_assert(TargetIt != JumpTargets.end());
-  return TargetIt->second.head();
+  JumpTarget *JT = findJT(PC);
+  revng_assert(JT != nullptr);
+  return JT->head();
 }
 
 /// Check if among \p BB's predecessors there's \p Target
@@ -875,11 +947,10 @@ BasicBlock *JumpTargetManager::registerJT(MetaAddress PC,
                               << JTReason::getName(Reason));
 
   // Do we already have a BasicBlock for this PC?
-  BlockMap::iterator TargetIt = JumpTargets.find(PC);
-  if (TargetIt != JumpTargets.end()) {
+  if (JumpTarget *JT = findJT(PC)) {
     // Case 1: there's already a BasicBlock for that address, return it
-    BasicBlock *BB = TargetIt->second.head();
-    TargetIt->second.setReason(Reason);
+    BasicBlock *BB = JT->head();
+    JT->setReason(Reason);
     return BB;
   }
 
@@ -912,6 +983,7 @@ BasicBlock *JumpTargetManager::registerJT(MetaAddress PC,
   }
 
   Unexplored.push_back(BlockWithAddress(PC, NewBlock));
+  UnexploredBlocks[PC] = NewBlock;
 
   std::stringstream Name;
   Name << "bb." << nameForAddress(PC);
@@ -928,6 +1000,7 @@ BasicBlock *JumpTargetManager::registerJT(MetaAddress PC,
   // Associate the PC with the chosen basic block
   auto &NewJumpTarget = JumpTargets[PC];
   NewJumpTarget = JumpTarget(NewBlock, Reason);
+  JumpTargetsIndex[PC] = &NewJumpTarget;
 
   if (AftedAddingFunctionEntries)
     NewJumpTarget.setReason(JTReason::DependsOnModelFunction);
@@ -1264,7 +1337,8 @@ void JumpTargetManager::harvest() {
     setCFGForm(CFGForm::SemanticPreserving);
 
     if (JTCountLog.isEnabled()) {
-      JTCountLog << std::dec << Unexplored.size() << " new jump targets and "
+      JTCountLog << std::dec << UnexploredBlocks.size()
+                 << " new jump targets and "
                  << NewBranches << " new branches were found" << DoLog;
     }
   }
@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <map>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -29,6 +30,8 @@
 #include "revng/Support/MetaAddress/MetaAddressRangeSet.h"
 #include "revng/Support/ProgramCounterHandler.h"
 
+#include "ValueMaterializerPass.h"
+
 // Forward declarations
 namespace llvm {
 class BasicBlock;
@@ -271,7 +274,7 @@ public:
   BlockWithAddress peek();
 
   /// Return true if no unexplored jump targets are available
-  bool empty() { return Unexplored.empty(); }
+  bool empty() { return UnexploredBlocks.empty(); }
 
   /// Return true if the whole [\p Start,\p End) range is in an executable
   /// segment
@@ -304,7 +307,7 @@ public:
   /// Return true if the given PC is a jump target
   bool isJumpTarget(MetaAddress PC) const {
     revng_assert(PC.isValid());
-    return JumpTargets.contains(PC);
+    return JumpTargetsIndex.contains(PC);
   }
 
   /// Return true if the given basic block corresponds to a jump target
@@ -345,7 +348,7 @@ public:
 
   bool hasJT(MetaAddress PC) {
     revng_assert(PC.isValid());
-    return JumpTargets.contains(PC);
+    return JumpTargetsIndex.contains(PC);
   }
 
   BlockMap::const_iterator begin() const { return JumpTargets.begin(); }
@@ -364,8 +367,8 @@ public:
     bool Result = false;
     revng_assert(PC.isValid());
 
-    if (isJumpTarget(PC)) {
-      Result = not JumpTargets.at(PC).hasReason(Reason);
+    if (JumpTarget *JT = findJT(PC)) {
+      Result = not JT->hasReason(Reason);
       registerJT(PC, Reason);
     }
 
@@ -424,6 +427,11 @@ public:
     ValueMaterializerPCWhiteList.clear();
   }
 
+  /// Results of ValueMaterializer in the previous harvesting round
+  ValueMaterializerCache &valueMaterializerCache() {
+    return ValueMaterializerResults;
+  }
+
   /// Finalizes information about the jump targets
   ///
   /// Call this function once no more jump targets can be discovered.  It will
@@ -538,6 +546,12 @@ public:
   llvm::DenseSet<llvm::BasicBlock *> computeUnreachable() const;
 
 private:
+  /// \return the jump target at \p PC, or nullptr if there's none
+  JumpTarget *findJT(MetaAddress PC) {
+    auto It = JumpTargetsIndex.find(PC);
+    return It == JumpTargetsIndex.end() ? nullptr : It->second;
+  }
+
   void fixPostHelperPC();
 
   /// Translate the non-constant jumps into jumps to the dispatcher
@@ -577,7 +591,7 @@ private:
   llvm::CallInst *getJumpTarget(llvm::BasicBlock *Target);
 
 private:
-  using InstructionMap = std::map<MetaAddress, llvm::Instruction *>;
+  using InstructionMap = std::unordered_map<MetaAddress, llvm::Instruction *>;
 
   llvm::Module &TheModule;
   llvm::LLVMContext &Context;
@@ -587,8 +601,20 @@ private:
   InstructionMap OriginalInstructionAddresses;
   /// Holds the association between a PC and a BasicBlock.
   BlockMap JumpTargets;
+  /// Index of JumpTargets, for the lookups performed for each instruction
+  ///
+  /// \note Jump targets are never removed and std::map does not move its
+  ///       elements, so the pointers stay valid.
+  std::unordered_map<MetaAddress, JumpTarget *> JumpTargetsIndex;
   /// Queue of program counters we still have to translate.
+  ///
+  /// \note It might contain entries that have already been explored: the
+  ///       program counters still to be translated are the ones in
+  ///       UnexploredBlocks.
   std::vector<BlockWithAddress> Unexplored;
+  /// Index of the entries in Unexplored still to be translated, so that newPC
+  /// does not need to scan the whole queue.
+  std::unordered_map<MetaAddress, llvm::BasicBlock *> UnexploredBlocks;
 
   llvm::Function *ExitTB;
   MetaAddressRangeSet ExecutableRanges;
@@ -612,6 +638,7 @@ private:
   ProgramCounterHandler *PCH = nullptr;
 
   MetaAddressSet ValueMaterializerPCWhiteList;
+  ValueMaterializerCache ValueMaterializerResults;
   const TupleTree<model::Binary> &Model;
   const RawBinaryView &BinaryView;
   bool AftedAddingFunctionEntries = false;
@@ -5,6 +5,7 @@
 //
 
 #include "revng/Lift/Lift.h"
+#include "revng/Pipeline/IRModuleCache.h"
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/ResourceFinder.h"
 
@@ -130,12 +131,14 @@ bool LiftPass::runOnModule(llvm::Module &M) {
   RawBinaryView &RawBinary = getAnalysis<LoadBinaryWrapperPass>().get();
 
   T.advance("Construct CodeGenerator", false);
+  auto *EC = getAnalysis<pipeline::LoadExecutionContextPass>().get();
   CodeGenerator Generator(RawBinary,
                           &M,
                           Model,
                           LibHelpersPath,
                           EarlyLinkedPath,
-                          model::Architecture::x86_64);
+                          model::Architecture::x86_64,
+                          pipeline::IRModuleCache::get(EC->getContext()));
 
   std::optional<uint64_t> EntryPointAddressOptional;
   if (EntryPointAddress.getNumOccurrences() != 0)
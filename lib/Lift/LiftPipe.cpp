@@ -36,9 +36,8 @@ void Lift::run(ExecutionContext &EC,
 
   const TupleTree<model::Binary> &Model = getModelFromContext(EC);
 
-  auto BufferOrError = MemoryBuffer::getFileOrSTDIN(*SourceBinary.path());
+  auto BufferOrError = mapBinary(*SourceBinary.path());
   auto Buffer = cantFail(errorOrToExpected(std::move(BufferOrError)));
-  RawBinaryView RawBinary(*Model, Buffer->getBuffer());
 
   // Perform lifting
   llvm::legacy::PassManager PM;
@@ -4,6 +4,7 @@
 //
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
+#include <array>
 #include <string>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -16,6 +17,7 @@
 #include "revng/Model/Architecture.h"
 #include "revng/Model/Binary.h"
 #include "revng/Pipeline/AllRegistries.h"
+#include "revng/Pipeline/IRModuleCache.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Pipes/RootKind.h"
@@ -33,6 +35,17 @@ static opt<bool> Tracing("link-trace",
                          init(false),
                          desc("enable tracing when linking support"));
 
+static opt<bool> LinkWholeSupport("link-whole-support",
+                                  cat(MainCategory),
+                                  init(false),
+                                  desc("link all the support module, instead "
+                                       "of what the module actually uses"));
+
+/// The functions of the support module that are always linked, despite not
+/// being used by the lifted code, since they are the entry points of the
+/// recompiled program
+static constexpr std::array<const char *, 1> SupportRoots = { "main" };
+
 static llvm::StringRef getSupportName(model::Architecture::Values V) {
   using namespace model::Architecture;
   switch (V) {
@@ -82,14 +95,28 @@ void revng::pipes::LinkSupport::run(ExecutionContext &EC,
 
   std::string SupportPath = getSupportPath(EC.getContext());
 
+  llvm::Module &Destination = ModuleContainer.getModule();
   llvm::SMDiagnostic Err;
-  auto Module = llvm::parseIRFile(SupportPath,
-                                  Err,
-                                  ModuleContainer.getModule().getContext());
+  auto Module = IRModuleCache::parseIRFile(EC.getContext(),
+                                           SupportPath,
+                                           Err,
+                                           Destination.getContext());
   revng_assert(Module != nullptr);
 
-  auto Failed = llvm::Linker::linkModules(ModuleContainer.getModule(),
-                                          std::move(Module));
+  unsigned Flags = llvm::Linker::Flags::None;
+  if (not LinkWholeSupport) {
+    // Only link the definitions the module refers to, along with what they
+    // transitively use. Declaring the roots in the destination module makes
+    // the linker pull them in too.
+    Flags = llvm::Linker::Flags::LinkOnlyNeeded;
+    for (const char *Name : SupportRoots)
+      if (llvm::Function *Root = Module->getFunction(Name))
+        Destination.getOrInsertFunction(Name, Root->getFunctionType());
+  }
+
+  auto Failed = llvm::Linker::linkModules(Destination,
+                                          std::move(Module),
+                                          Flags);
 
   EC.commitAllFor(ModuleContainer);
 
@@ -512,16 +512,48 @@ RootAnalyzer::promoteCSVsToAlloca(Function *OptimizedFunction) {
   IRBuilder<> AllocaBuilder(&*EntryBB->begin());
   IRBuilder<> InitializeBuilder(EntryBB->getTerminator());
 
-  for (GlobalVariable *CSV : toSortedByName(NonPCCSVs)) {
+  auto SortedCSVs = toSortedByName(NonPCCSVs);
+  for (GlobalVariable *CSV : SortedCSVs) {
     Type *CSVType = CSV->getValueType();
     auto *Alloca = AllocaBuilder.CreateAlloca(CSVType, nullptr, CSV->getName());
     CSVMap[CSV] = Alloca;
+  }
 
-    // Replace all uses of the CSV within OptimizedFunction with the alloca
-    replaceAllUsesInFunctionWith(OptimizedFunction, CSV, Alloca);
+  // Replace all uses of the CSVs within OptimizedFunction with the allocas.
+  // Note: we walk OptimizedFunction once instead of walking the uses of each
+  //       CSV, since those are mostly in the root function, which keeps growing
+  //       while OptimizedFunction only contains the code to harvest.
+  for (Instruction &I : instructions(OptimizedFunction)) {
+    for (Use &U : I.operands()) {
+      if (auto *CSV = dyn_cast<GlobalVariable>(U.get())) {
+        auto It = CSVMap.find(CSV);
+        if (It != CSVMap.end())
+          U.set(It->second);
+      } else if (auto *CE = dyn_cast<ConstantExpr>(U.get())) {
+        // Casts of a CSV might be used elsewhere: materialize them in here
+        if (not CE->isCast())
+          continue;
+
+        auto *CSV = dyn_cast<GlobalVariable>(CE->getOperand(0));
+        if (CSV == nullptr)
+          continue;
+
+        auto It = CSVMap.find(CSV);
+        if (It == CSVMap.end())
+          continue;
+
+        Instruction *Cast = CE->getAsInstruction();
+        Cast->replaceUsesOfWith(CSV, It->second);
+        Cast->insertBefore(&I);
+        U.set(Cast);
+      }
+    }
+  }
 
-    // Initialize the alloca
-    InitializeBuilder.CreateStore(createLoad(InitializeBuilder, CSV), Alloca);
+  // Initialize the allocas
+  for (GlobalVariable *CSV : SortedCSVs) {
+    Value *Initial = createLoad(InitializeBuilder, CSV);
+    InitializeBuilder.CreateStore(Initial, CSVMap[CSV]);
   }
 
   return CSVMap;
@@ -621,7 +653,7 @@ SummaryCallsBuilder RootAnalyzer::optimize(llvm::Function *OptimizedFunction,
     FPM.addPass(DropRangeMetadataPass());
 
     // Run ValueMaterializer!
-    FPM.addPass(ValueMaterializerPass(MO));
+    FPM.addPass(ValueMaterializerPass(MO, &JTM.valueMaterializerCache()));
 
     FunctionAnalysisManager FAM;
     FAM.registerPass([]() { return TypeShrinking::BitLivenessPass(); });
@@ -828,12 +860,13 @@ void RootAnalyzer::cloneOptimizeAndHarvest(Function *TheFunction) {
   promoteHelpersToIntrinsics(OptimizedFunction, Builder);
 
   // Replace calls to newpc with stores to the PC
+  auto GetPC = [](CallBase *Call) { return addressFromNewPC(Call); };
+  JTM.programCounterHandler()->expandNewPCs(*OptimizedFunction, GetPC);
+
   SmallVector<CallBase *, 16> ToErase;
   for (CallBase *Call :
-       callersIn(TheModule.getFunction("newpc"), OptimizedFunction)) {
-    JTM.programCounterHandler()->expandNewPC(Call);
+       callersIn(TheModule.getFunction("newpc"), OptimizedFunction))
     ToErase.push_back(Call);
-  }
 
   for (CallBase *Call : ToErase)
     eraseFromParent(Call);
@@ -4,13 +4,18 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/KnownBits.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
 #include "revng/Support/Debug.h"
+#include "revng/Support/Statistics.h"
 #include "revng/ValueMaterializer/ValueMaterializer.h"
 
 #include "JumpTargetManager.h"
@@ -21,6 +26,15 @@ using namespace llvm;
 cl::list<uint64_t> DumpValueMaterializerAt("dump-vm-at", cl::ZeroOrMore);
 cl::opt<bool> DumpValueMaterializer("dump-all-vm");
 
+static cl::opt<bool> DisableVMCache("disable-vm-cache",
+                                    cl::desc("Run ValueMaterializer on all "
+                                             "the markers, even if the part "
+                                             "of the CFG leading to them did "
+                                             "not change since the previous "
+                                             "harvesting round"));
+
+static RunningStatistics ReusedVMResults("reused-vm-results");
+
 using SDMO = StaticDataMemoryOracle;
 
 SDMO::StaticDataMemoryOracle(const DataLayout &DL,
@@ -39,6 +53,166 @@ MaterializedValue StaticDataMemoryOracle::load(uint64_t LoadAddress,
   return JTM.readFromPointer(Address, LoadSize, IsLittleEndian);
 }
 
+namespace {
+
+/// A MemoryOracle recording all the loads forwarded to another MemoryOracle
+class RecordingMemoryOracle final : public MemoryOracle {
+private:
+  MemoryOracle &MO;
+  std::vector<std::pair<uint64_t, unsigned>> &Loads;
+
+public:
+  RecordingMemoryOracle(MemoryOracle &MO,
+                        std::vector<std::pair<uint64_t, unsigned>> &Loads) :
+    MO(MO), Loads(Loads) {}
+  ~RecordingMemoryOracle() final = default;
+
+  MaterializedValue load(uint64_t LoadAddress, unsigned LoadSize) final {
+    Loads.emplace_back(LoadAddress, LoadSize);
+    return MO.load(LoadAddress, LoadSize);
+  }
+};
+
+/// Computes a structural hash of basic blocks which does not depend on the
+/// address of the instructions: instructions are identified by the name of
+/// their block and their position in it. This way, the hash of a block can be
+/// compared with the one of its counterpart in a different copy of the
+/// function.
+class BlockHasher {
+private:
+  Function *Marker = nullptr;
+  DenseMap<const Instruction *, unsigned> Positions;
+
+public:
+  BlockHasher(Function &F, Function *Marker) : Marker(Marker) {
+    for (BasicBlock &BB : F) {
+      unsigned Position = 0;
+      for (Instruction &I : BB)
+        Positions[&I] = Position++;
+    }
+  }
+
+public:
+  unsigned position(const Instruction *I) const { return Positions.lookup(I); }
+
+  hash_code hash(const BasicBlock &BB) const {
+    hash_code Result = hash_value(BB.getName());
+
+    for (const Instruction &I : BB)
+      Result = hash_combine(Result, hash(I));
+
+    // Predecessors affect the dominator tree and LazyValueInfo
+    SmallVector<StringRef, 4> Predecessors;
+    for (const BasicBlock *Predecessor : predecessors(&BB))
+      Predecessors.push_back(Predecessor->getName());
+    llvm::sort(Predecessors);
+
+    return hash_combine(Result,
+                        hash_combine_range(Predecessors.begin(),
+                                           Predecessors.end()));
+  }
+
+private:
+  hash_code hash(const Instruction &I) const {
+    hash_code Result = hash_combine(I.getOpcode(),
+                                    I.getType(),
+                                    I.getRawSubclassOptionalData());
+
+    if (auto *Compare = dyn_cast<CmpInst>(&I)) {
+      Result = hash_combine(Result, Compare->getPredicate());
+    } else if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+      Result = hash_combine(Result, GEP->getSourceElementType());
+    } else if (auto *Alloca = dyn_cast<AllocaInst>(&I)) {
+      Result = hash_combine(Result, Alloca->getAllocatedType());
+    } else if (auto *Load = dyn_cast<LoadInst>(&I)) {
+      Result = hash_combine(Result, Load->isVolatile(), Load->getOrdering());
+    } else if (auto *Store = dyn_cast<StoreInst>(&I)) {
+      Result = hash_combine(Result, Store->isVolatile(), Store->getOrdering());
+    } else if (auto *Call = dyn_cast<CallBase>(&I)) {
+      Result = hash_combine(Result,
+                            Call->getFunctionType(),
+                            Call->getAttributes().getRawPointer());
+    } else if (auto *Phi = dyn_cast<PHINode>(&I)) {
+      for (const BasicBlock *Incoming : Phi->blocks())
+        Result = hash_combine(Result, Incoming->getName());
+    } else if (auto *Extract = dyn_cast<ExtractValueInst>(&I)) {
+      Result = hash_combine(Result,
+                            hash_combine_range(Extract->idx_begin(),
+                                               Extract->idx_end()));
+    } else if (auto *Insert = dyn_cast<InsertValueInst>(&I)) {
+      Result = hash_combine(Result,
+                            hash_combine_range(Insert->idx_begin(),
+                                               Insert->idx_end()));
+    } else if (auto *Shuffle = dyn_cast<ShuffleVectorInst>(&I)) {
+      ArrayRef<int> Mask = Shuffle->getShuffleMask();
+      Result = hash_combine(Result,
+                            hash_combine_range(Mask.begin(), Mask.end()));
+    }
+
+    unsigned OperandsCount = I.getNumOperands();
+
+    // The last argument of a marker is an identifier assigned in order of
+    // registration, which does not affect the results: ignore it
+    if (auto *Call = dyn_cast<CallBase>(&I))
+      if (Marker != nullptr and Call->getCalledFunction() == Marker)
+        OperandsCount = Call->arg_size() - 1;
+
+    for (unsigned Index = 0; Index < OperandsCount; ++Index)
+      Result = hash_combine(Result, hash(I.getOperand(Index)));
+
+    return Result;
+  }
+
+  hash_code hash(const Value *V) const {
+    if (auto *I = dyn_cast<Instruction>(V))
+      return hash_combine(1, I->getParent()->getName(), position(I));
+
+    if (auto *Argument = dyn_cast<llvm::Argument>(V))
+      return hash_combine(2, Argument->getArgNo());
+
+    if (auto *BB = dyn_cast<BasicBlock>(V))
+      return hash_combine(3, BB->getName());
+
+    if (auto *C = dyn_cast<Constant>(V))
+      return hash(C);
+
+    return hash_combine(4, V->getValueID(), V->getType());
+  }
+
+  hash_code hash(const Constant *C) const {
+    hash_code Result = hash_combine(C->getValueID(), C->getType());
+
+    if (auto *GV = dyn_cast<GlobalValue>(C))
+      return hash_combine(Result, GV->getName(), GV->getValueType());
+
+    if (auto *Integer = dyn_cast<ConstantInt>(C))
+      return hash_combine(Result, Integer->getValue());
+
+    if (auto *Float = dyn_cast<ConstantFP>(C))
+      return hash_combine(Result, Float->getValueAPF().bitcastToAPInt());
+
+    if (auto *Data = dyn_cast<ConstantDataSequential>(C))
+      return hash_combine(Result, Data->getRawDataValues());
+
+    if (auto *Expression = dyn_cast<ConstantExpr>(C)) {
+      Result = hash_combine(Result,
+                            Expression->getOpcode(),
+                            Expression->getRawSubclassOptionalData());
+      if (Expression->isCompare())
+        Result = hash_combine(Result, Expression->getPredicate());
+      if (auto *GEP = dyn_cast<GEPOperator>(Expression))
+        Result = hash_combine(Result, GEP->getSourceElementType());
+    }
+
+    for (const Use &Operand : C->operands())
+      Result = hash_combine(Result, hash(Operand.get()));
+
+    return Result;
+  }
+};
+
+} // namespace
+
 static void demoteOrToAdd(Function &F) {
   using namespace llvm;
 
@@ -69,6 +243,26 @@ static void demoteOrToAdd(Function &F) {
   }
 }
 
+/// Create a revng.avi metadata containing all the possible values we
+/// identified
+static void setMaterializedValues(CallBase *Call,
+                                  const MaterializedValues &Values) {
+  QuickMetadata QMD(getContext(Call));
+  std::vector<Metadata *> ValuesMD;
+  ValuesMD.reserve(Values.size());
+  for (const MaterializedValue &V : Values) {
+    // TODO: we are we ignoring those with symbols
+    auto Offset = V.value();
+    std::string SymbolName;
+    if (V.hasSymbol())
+      SymbolName = V.symbolName();
+
+    ValuesMD.push_back(QMD.tuple({ QMD.get(SymbolName), QMD.get(Offset) }));
+  }
+
+  Call->setMetadata("revng.avi", QMD.tuple(ValuesMD));
+}
+
 PreservedAnalyses ValueMaterializerPass::run(Function &F,
                                              FunctionAnalysisManager &FAM) {
   using namespace llvm;
@@ -89,6 +283,50 @@ PreservedAnalyses ValueMaterializerPass::run(Function &F,
   SwitchInst *Terminator = cast<SwitchInst>(Entry->getTerminator());
   BasicBlock *Dispatcher = Terminator->getDefaultDest();
 
+  //
+  // Identify the blocks reachable from a block that changed since the previous
+  // run: markers in all the other blocks can reuse the previous results
+  //
+  bool UseCache = Cache != nullptr and not DumpValueMaterializer
+                  and not DisableVMCache;
+  if (UseCache and Cache->Features != MO.features()) {
+    Cache->BlockSignatures.clear();
+    Cache->Results.clear();
+  }
+
+  std::optional<BlockHasher> Hasher;
+  StringMap<size_t> BlockSignatures;
+  SmallPtrSet<BasicBlock *, 16> Dirty;
+  if (UseCache) {
+    Hasher.emplace(F, Marker);
+
+    SmallVector<BasicBlock *, 16> Worklist;
+    for (BasicBlock &BB : F) {
+      if (not BB.hasName()) {
+        Worklist.push_back(&BB);
+        continue;
+      }
+
+      size_t Signature = Hasher->hash(BB);
+      BlockSignatures[BB.getName()] = Signature;
+
+      auto It = Cache->BlockSignatures.find(BB.getName());
+      if (It == Cache->BlockSignatures.end() or It->second != Signature)
+        Worklist.push_back(&BB);
+    }
+
+    while (not Worklist.empty()) {
+      BasicBlock *BB = Worklist.pop_back_val();
+      if (Dirty.insert(BB).second)
+        for (BasicBlock *Successor : successors(BB))
+          Worklist.push_back(Successor);
+    }
+  }
+
+  std::map<std::pair<std::string, unsigned>, ValueMaterializerCache::Entry>
+    NewResults;
+  unsigned Reused = 0;
+
   auto GetConstantArgument = [](CallBase *Call, unsigned Index) {
     return cast<ConstantInt>(Call->getArgOperand(Index))->getLimitedValue();
   };
@@ -108,11 +346,39 @@ PreservedAnalyses ValueMaterializerPass::run(Function &F,
     revng_assert(Address.isValid());
     uint64_t CurrentAddress = Address.address();
 
+    bool Dump = DumpValueMaterializer
+                or count(DumpValueMaterializerAt, CurrentAddress) > 0;
+
+    BasicBlock *BB = Call->getParent();
+    bool Cacheable = UseCache and BB->hasName() and not Dump;
+    std::pair<std::string, unsigned> Key;
+    if (Cacheable)
+      Key = { BB->getName().str(), Hasher->position(Call) };
+
+    if (Cacheable and not Dirty.contains(BB)) {
+      auto It = Cache->Results.find(Key);
+      if (It != Cache->Results.end()) {
+        ValueMaterializerCache::Entry &Entry = It->second;
+
+        // Replay the loads, they have side effects on JumpTargetManager
+        for (const auto &[LoadAddress, LoadSize] : Entry.Loads)
+          MO.load(LoadAddress, LoadSize);
+
+        setMaterializedValues(Call, Entry.Values);
+        NewResults[Key] = std::move(Entry);
+        ++Reused;
+        continue;
+      }
+    }
+
+    ValueMaterializerCache::Entry Entry;
+    RecordingMemoryOracle RecordingMO(MO, Entry.Loads);
+
     MaterializedValues Values;
     DataFlowGraph::Limits Limits(MaxPhiLike, MaxLoad);
     auto Results = ValueMaterializer::getValuesFor(Call,
                                                    ToTrack,
-                                                   MO,
+                                                   RecordingMO,
                                                    LVI,
                                                    DT,
                                                    Limits,
@@ -120,8 +386,7 @@ PreservedAnalyses ValueMaterializerPass::run(Function &F,
     if (Results.values())
       Values = std::move(*Results.values());
 
-    if (DumpValueMaterializer
-        or count(DumpValueMaterializerAt, CurrentAddress) > 0) {
+    if (Dump) {
       // User asked to dump information about this address
       dbg << "Values produced by ValueMaterializer for " << getName(ToTrack)
           << " at " << Address.toString() << ":\n";
@@ -136,24 +401,21 @@ PreservedAnalyses ValueMaterializerPass::run(Function &F,
       AdvancedValueInfoMFI::dump(&Results.cfeg(), Results.mfiResult());
     }
 
-    //
-    // Create a revng.avi metadata containing the type of instruction and
-    // all the possible values we identified
-    //
-    QuickMetadata QMD(getContext(&F));
-    std::vector<Metadata *> ValuesMD;
-    ValuesMD.reserve(Values.size());
-    for (const MaterializedValue &V : Values) {
-      // TODO: we are we ignoring those with symbols
-      auto Offset = V.value();
-      std::string SymbolName;
-      if (V.hasSymbol())
-        SymbolName = V.symbolName();
-
-      ValuesMD.push_back(QMD.tuple({ QMD.get(SymbolName), QMD.get(Offset) }));
+    setMaterializedValues(Call, Values);
+
+    // Do not cache the results of queries cut short by the budget, so that the
+    // next harvesting round tries them again
+    if (Cacheable and not Results.budgetExhausted()) {
+      Entry.Values = std::move(Values);
+      NewResults[Key] = std::move(Entry);
     }
+  }
 
-    Call->setMetadata("revng.avi", QMD.tuple(ValuesMD));
+  if (UseCache) {
+    ReusedVMResults.push(Reused);
+    Cache->Features = MO.features();
+    Cache->BlockSignatures = std::move(BlockSignatures);
+    Cache->Results = std::move(NewResults);
   }
 
   return PreservedAnalyses::all();
@@ -4,6 +4,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/PassManager.h"
 
 #include "revng/BasicAnalyses/MaterializedValue.h"
@@ -29,16 +36,52 @@ public:
   ~StaticDataMemoryOracle() final = default;
 
   MaterializedValue load(uint64_t LoadAddress, unsigned LoadSize) final;
+
+  const MetaAddress::Features &features() const { return Features; }
+};
+
+/// Results of the last run of ValueMaterializerPass, in a form that survives
+/// the destruction of the function it ran on.
+///
+/// The results for a marker only depend on the blocks from which the marker
+/// can be reached: they contain all the definitions ValueMaterializer and
+/// LazyValueInfo can look at, and determine the dominator tree of the
+/// marker's block. Therefore, if none of these blocks changed since the
+/// previous run, the previous results can be reused.
+///
+/// Blocks are identified by name, and considered changed if their content or
+/// their predecessors changed, or if they have no name.
+class ValueMaterializerCache {
+public:
+  struct Entry {
+    MaterializedValues Values;
+
+    /// Loads issued to the memory oracle, which are replayed upon reuse so
+    /// that its side effects are preserved
+    std::vector<std::pair<uint64_t, unsigned>> Loads;
+  };
+
+private:
+  friend class ValueMaterializerPass;
+
+  std::optional<MetaAddress::Features> Features;
+  llvm::StringMap<size_t> BlockSignatures;
+
+  /// Results by (block name, position of the marker in the block)
+  std::map<std::pair<std::string, unsigned>, Entry> Results;
 };
 
 class ValueMaterializerPass
   : public llvm::PassInfoMixin<ValueMaterializerPass> {
 private:
   StaticDataMemoryOracle &MO;
+  ValueMaterializerCache *Cache = nullptr;
   static constexpr const char *MarkerName = "revng_avi";
 
 public:
-  ValueMaterializerPass(StaticDataMemoryOracle &MO) : MO(MO) {}
+  ValueMaterializerPass(StaticDataMemoryOracle &MO,
+                        ValueMaterializerCache *Cache = nullptr) :
+    MO(MO), Cache(Cache) {}
 
   llvm::PreservedAnalyses run(llvm::Function &F,
                               llvm::FunctionAnalysisManager &);
@@ -460,6 +460,14 @@ GlobalVariable *VariableManager::getByCPUStateOffset(intptr_t Offset,
   return Result;
 }
 
+std::pair<IntegerType *, unsigned>
+VariableManager::typeAtOffset(intptr_t Offset) {
+  auto [It, Inserted] = TypesAtOffset.try_emplace(Offset);
+  if (Inserted)
+    It->second = getTypeAtOffset(ModuleLayout, CPUStateType, Offset);
+  return It->second;
+}
+
 std::pair<GlobalVariable *, unsigned>
 VariableManager::getByCPUStateOffsetInternal(intptr_t Offset,
                                              std::string Name) {
@@ -470,8 +478,7 @@ VariableManager::getByCPUStateOffsetInternal(intptr_t Offset,
           && It->second->getName().startswith(UnknownCSVPref))) {
     Type *VariableType = nullptr;
     unsigned Remaining;
-    std::tie(VariableType,
-             Remaining) = getTypeAtOffset(ModuleLayout, CPUStateType, Offset);
+    std::tie(VariableType, Remaining) = typeAtOffset(Offset);
 
     // Unsupported type, let the caller handle the situation
     if (VariableType == nullptr)
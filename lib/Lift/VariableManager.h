@@ -8,6 +8,8 @@
 #include <map>
 #include <string>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Pass.h"
 
@@ -113,14 +115,10 @@ public:
 
   void setDataLayout(const llvm::DataLayout *NewLayout) {
     ModuleLayout = NewLayout;
+    TypesAtOffset.clear();
   }
 
-  std::vector<llvm::AllocaInst *> locals() {
-    std::vector<llvm::AllocaInst *> Locals;
-    for (auto Pair : LocalTemporaries)
-      Locals.push_back(Pair.second);
-    return Locals;
-  }
+  auto locals() const { return llvm::make_second_range(LocalTemporaries); }
 
   llvm::Value *loadFromEnvOffset(llvm::IRBuilder<> &Builder,
                                  unsigned LoadSize,
@@ -174,6 +172,11 @@ private:
   std::pair<llvm::GlobalVariable *, unsigned>
   getByCPUStateOffsetInternal(intptr_t Offset, std::string Name = "");
 
+  /// \return the integer type of the CPU state field containing \p Offset and
+  ///          the offset within such field, or `{ nullptr, 0 }` if \p Offset
+  ///          does not belong to an integer field
+  std::pair<llvm::IntegerType *, unsigned> typeAtOffset(intptr_t Offset);
+
 private:
   llvm::Module &TheModule;
   llvm::IRBuilder<> AllocaBuilder;
@@ -181,12 +184,22 @@ private:
   using GlobalsMap = std::map<intptr_t, llvm::GlobalVariable *>;
   GlobalsMap CPUStateGlobals;
   GlobalsMap OtherGlobals;
-  TemporariesMap Temporaries;
+
+  /// Basic block-level temporaries, cleared for each input instruction
+  llvm::SmallDenseMap<unsigned int, llvm::AllocaInst *, 16> Temporaries;
+
+  /// \note This is ordered, since it determines the order of the arguments of
+  ///       the calls to newpc
   TemporariesMap LocalTemporaries;
   PTCInstructionList *Instructions = nullptr;
 
   llvm::StructType *CPUStateType;
   const llvm::DataLayout *ModuleLayout;
+
+  /// Memoized results of typeAtOffset, which otherwise walks the layout of the
+  /// CPU state for every access to an offset with no CSV starting there
+  llvm::DenseMap<intptr_t, std::pair<llvm::IntegerType *, unsigned>>
+    TypesAtOffset;
   unsigned EnvOffset;
 
   llvm::GlobalVariable *Env;
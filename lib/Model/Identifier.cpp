@@ -4,13 +4,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/StringSet.h"
+
 #include "revng/Model/Identifier.h"
 
 using namespace model;
 
 const Identifier Identifier::Empty = Identifier("");
 
-const std::set<llvm::StringRef> ReservedKeywords = {
+const llvm::StringSet<> ReservedKeywords = {
   // reserved keywords for primitive types
   "void",
   "pointer_or_number8_t",
@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+#include <string>
+
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/COFF.h"
@@ -20,9 +23,10 @@
 
 using namespace llvm;
 
-Error importBinary(TupleTree<model::Binary> &Model,
-                   llvm::object::ObjectFile &ObjectFile,
-                   const ImporterOptions &Options) {
+static Error importObjectFile(TupleTree<model::Binary> &Model,
+                              llvm::object::ObjectFile &ObjectFile,
+                              const ImporterOptions &Options,
+                              uint64_t SliceOffset) {
   using namespace llvm::object;
   using namespace model::Architecture;
 
@@ -42,7 +46,7 @@ Error importBinary(TupleTree<model::Binary> &Model,
   else if (auto *TheBinary = dyn_cast<COFFObjectFile>(&ObjectFile))
     Result = importPECOFF(Model, *TheBinary, Options);
   else if (auto *TheBinary = dyn_cast<MachOObjectFile>(&ObjectFile))
-    Result = importMachO(Model, *TheBinary, Options);
+    Result = importMachO(Model, *TheBinary, Options, SliceOffset);
   else
     return createError("Unsupported binary format");
 
@@ -56,6 +60,46 @@ Error importBinary(TupleTree<model::Binary> &Model,
   return Result;
 }
 
+Error importBinary(TupleTree<model::Binary> &Model,
+                   llvm::object::ObjectFile &ObjectFile,
+                   const ImporterOptions &Options) {
+  return importObjectFile(Model, ObjectFile, Options, 0);
+}
+
+/// Import the slice of \p Universal selected by Options.MachOSlice
+///
+/// Only the load commands of the selected slice are parsed, the other slices
+/// are never touched.
+static Error importUniversal(TupleTree<model::Binary> &Model,
+                             const object::MachOUniversalBinary &Universal,
+                             const ImporterOptions &Options) {
+  using ObjectForArch = object::MachOUniversalBinary::ObjectForArch;
+
+  std::optional<ObjectForArch> Slice;
+  if (not Options.MachOSlice.empty()) {
+    auto MaybeSlice = Universal.getObjectForArch(Options.MachOSlice);
+    if (not MaybeSlice)
+      return MaybeSlice.takeError();
+    Slice = *MaybeSlice;
+  } else if (Universal.getNumberOfObjects() == 1) {
+    Slice = *Universal.begin_objects();
+  } else {
+    std::string Architectures;
+    for (const ObjectForArch &Object : Universal.objects())
+      Architectures += " " + Object.getArchFlagName();
+    return createStringError(inconvertibleErrorCode(),
+                             "MachO universal binary with multiple slices, "
+                             "select one with --macho-slice:"
+                               + Architectures);
+  }
+
+  auto MaybeObject = Slice->getAsObjectFile();
+  if (not MaybeObject)
+    return MaybeObject.takeError();
+
+  return importObjectFile(Model, **MaybeObject, Options, Slice->getOffset());
+}
+
 Error importBinary(TupleTree<model::Binary> &Model,
                    llvm::StringRef Path,
                    const ImporterOptions &Options) {
@@ -64,9 +108,8 @@ Error importBinary(TupleTree<model::Binary> &Model,
     return BinaryOrError.takeError();
 
   auto *Binary = BinaryOrError->getBinary();
-  if (isa<object::MachOUniversalBinary>(Binary)) {
-    return createStringError(inconvertibleErrorCode(),
-                             "Unsupported format: MachO universal binary.");
+  if (auto *Universal = dyn_cast<object::MachOUniversalBinary>(Binary)) {
+    return importUniversal(Model, *Universal, Options);
   } else if (isa<llvm::object::Archive>(Binary)) {
     return createStringError(inconvertibleErrorCode(),
                              "Unsupported format: archive.");
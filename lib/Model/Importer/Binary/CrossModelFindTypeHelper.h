@@ -8,6 +8,8 @@
 #include <memory>
 #include <set>
 
+#include "llvm/ADT/StringMap.h"
+
 #include "revng/Model/Importer/TypeCopier.h"
 #include "revng/Model/Processing.h"
 
@@ -90,4 +92,55 @@ findPrototype(llvm::StringRef Function, ModelMap &ModelsOfDynamicLibraries) {
 
   return std::nullopt;
 }
+
+/// Index of the prototypes of the functions of a set of models by name
+///
+/// Looking up a function is equivalent to findPrototype, but doesn't go
+/// through all the functions of all the models for each lookup.
+class PrototypeIndex {
+private:
+  llvm::StringMap<FunctionInfo> Index;
+
+public:
+  explicit PrototypeIndex(ModelMap &ModelsOfDynamicLibraries) {
+    // Register the functions in the order findPrototype would visit them, the
+    // first one wins
+    for (const auto &[Module, Model] : ModelsOfDynamicLibraries) {
+      for (auto &Function : Model->Functions()) {
+        const model::TypeDefinition *Prototype = Function.prototype();
+        if (Prototype == nullptr)
+          continue;
+
+        FunctionInfo Info{ .Prototype = *Prototype,
+                           .Attributes = Function.Attributes(),
+                           .ModuleName = Module };
+        if (Function.ExportedNames().size()) {
+          for (const std::string &Name : Function.ExportedNames())
+            Index.try_emplace(Name, Info);
+        } else if (not Function.OriginalName().empty()) {
+          Index.try_emplace(Function.OriginalName(), Info);
+        }
+      }
+
+      for (auto &DynamicFunction : Model->ImportedDynamicFunctions()) {
+        const model::TypeDefinition *Prototype = DynamicFunction.prototype();
+        if (Prototype == nullptr or DynamicFunction.OriginalName().empty())
+          continue;
+
+        FunctionInfo Info{ .Prototype = *Prototype,
+                           .Attributes = DynamicFunction.Attributes(),
+                           .ModuleName = Module };
+        Index.try_emplace(DynamicFunction.OriginalName(), Info);
+      }
+    }
+  }
+
+public:
+  std::optional<FunctionInfo> find(llvm::StringRef Function) const {
+    auto It = Index.find(Function);
+    if (It == Index.end())
+      return std::nullopt;
+    return It->second;
+  }
+};
 } // namespace
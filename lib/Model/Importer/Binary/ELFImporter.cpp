@@ -6,6 +6,9 @@
 
 #include <cstdint>
 #include <optional>
+#include <ranges>
+#include <string>
+#include <vector>
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Object/ELF.h"
@@ -24,6 +27,7 @@
 #include "revng/Model/RawBinaryView.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/LDDTree.h"
+#include "revng/Support/TaskScheduler.h"
 
 #include "CrossModelFindTypeHelper.h"
 #include "DwarfReader.h"
@@ -278,10 +282,10 @@ Error ELFImporter<T, HasAddend>::import(const ImporterOptions &Options) {
   parseProgramHeaders(TheELF);
 
   std::optional<uint64_t> FDEsCount;
+  std::vector<MetaAddress> FDEs;
   if (EHFrameHdrAddress) {
-    MetaAddress Address = MetaAddress::invalid();
-
-    std::tie(Address, FDEsCount) = ehFrameFromEhFrameHdr();
+    EHFrameIndex Index = ehFrameFromEhFrameHdr();
+    MetaAddress Address = Index.EHFrame;
     if (Address.isValid()) {
       if (EHFrameAddress and *EHFrameAddress != Address) {
         revng_log(ELFImporterLog,
@@ -291,12 +295,18 @@ Error ELFImporter<T, HasAddend>::import(const ImporterOptions &Options) {
       }
 
       EHFrameAddress = Address;
+      FDEsCount = Index.FDEsCount;
+      FDEs = std::move(Index.FDEs);
     }
   }
 
+  // Thanks to the .eh_frame_hdr table, FDEs can be decoded independently of
+  // each other, otherwise we have to walk the whole .eh_frame
   Task.advance("Parse .eh_frame", true);
-  if (EHFrameAddress and EHFrameAddress->isValid())
-    parseEHFrame(*EHFrameAddress, FDEsCount, EHFrameSize);
+  if (EHFrameAddress and EHFrameAddress->isValid()) {
+    if (FDEs.empty() or not parseIndexedEHFrame(*EHFrameAddress, FDEs))
+      parseEHFrame(*EHFrameAddress, FDEsCount, EHFrameSize);
+  }
 
   // Parse the .dynamic table
   Task.advance("Parse .dynamic", true);
@@ -356,6 +366,7 @@ Error ELFImporter<T, HasAddend>::import(const ImporterOptions &Options) {
 
       for (Elf_Sym Symbol : Symbols)
         parseDynamicSymbol(Symbol, Dynstr);
+      commitNewFunctions();
 
       using Elf_Rel = llvm::object::Elf_Rel_Impl<T, HasAddend>;
       if (ReldynPortion->isAvailable()) {
@@ -409,6 +420,18 @@ Error ELFImporter<T, HasAddend>::import(const ImporterOptions &Options) {
   if (AdjustedOptions.DebugInfo != DebugInfoLevel::No) {
     Task.advance("Parse debug info", true);
 
+    // Start fetching the missing debug info of the binary and of the
+    // dependencies findMissingTypes will look into, while we parse what's
+    // already available
+    std::vector<std::string> ToPrefetch = { TheBinary.getFileName().str() };
+    if (AdjustedOptions.DebugInfo == DebugInfoLevel::Yes) {
+      LDDTree Dependencies;
+      lddtree(Dependencies, ToPrefetch.front(), 1);
+      for (const auto &[Library, Needed] : Dependencies)
+        llvm::append_range(ToPrefetch, Needed);
+    }
+    DwarfImporter::prefetch(ToPrefetch, AdjustedOptions);
+
     // Import Dwarf
     DwarfImporter Importer(Model);
     Importer.import(TheBinary.getFileName(), AdjustedOptions);
@@ -435,6 +458,7 @@ void ELFImporter<T, HasAddend>::findMissingTypes(object::ELFFile<T> &TheELF,
 
   // TODO: disclose a way to modify this value with
   //       the `ImporterOptions::DebugInfo`, if the need ever arises.
+  // Note: keep it in sync with the prefetching in import.
   unsigned MaximumRecursionDepth = 1;
 
   LDDTree Dependencies;
@@ -482,6 +506,8 @@ void ELFImporter<T, HasAddend>::findMissingTypes(object::ELFFile<T> &TheELF,
     }
   }
 
+  PrototypeIndex Prototypes(ModelsOfLibraries);
+
   auto GetOrMakeACopier = [&](llvm::StringRef Name) -> TypeCopier & {
     if (auto It = TypeCopiers.find(Name.str()); It != TypeCopiers.end())
       return *It->second;
@@ -500,7 +526,7 @@ void ELFImporter<T, HasAddend>::findMissingTypes(object::ELFFile<T> &TheELF,
     if (not Fn.Prototype().isEmpty() or Fn.OriginalName().size() == 0)
       continue;
 
-    if (auto Found = findPrototype(Fn.OriginalName(), ModelsOfLibraries)) {
+    if (auto Found = Prototypes.find(Fn.OriginalName())) {
       revng_assert(!Found->ModuleName.empty());
       revng_assert(Found->Prototype.verify(true));
 
@@ -657,23 +683,66 @@ void ELFImporter<T, HasAddend>::parseSymbols(object::ELFFile<T> &TheELF,
 
     if (IsCode) {
       revng_assert(Address.isValid());
-      if (Model->Functions().tryGet(Address) == nullptr) {
-        model::Function &Function = Model->Functions()[Address];
-        if (MaybeName and MaybeName->size() > 0) {
-          Function.OriginalName() = *MaybeName;
-          // Insert Original name into exported ones, since it is by default
-          // true.
-          Function.ExportedNames().insert((*MaybeName).str());
-        }
+      auto [Function, IsNew] = getOrStageFunction(Address);
+      if (IsNew and MaybeName and MaybeName->size() > 0) {
+        Function->OriginalName() = *MaybeName;
+        // Insert Original name into exported ones, since it is by default
+        // true.
+        Function->ExportedNames().insert((*MaybeName).str());
       }
     } else if (IsDataObject and Size > 0) {
-      auto IsSameAddress = [Address](const auto &E) {
-        return Address == E.Address;
-      };
-      if (llvm::count_if(DataSymbols, IsSameAddress) == 0)
-        DataSymbols.emplace_back(Address, Size, *MaybeName);
+      recordDataSymbol({ Address, Size, *MaybeName }, true);
     }
   }
+
+  commitNewFunctions();
+}
+
+template<typename T, bool HasAddend>
+std::pair<model::Function *, bool>
+ELFImporter<T, HasAddend>::getOrStageFunction(MetaAddress Address) {
+  if (model::Function *Existing = Model->Functions().tryGet(Address))
+    return { Existing, false };
+
+  auto [It, IsNew] = NewFunctions.try_emplace(Address, Address);
+  return { &It->second, IsNew };
+}
+
+template<typename T, bool HasAddend>
+void ELFImporter<T, HasAddend>::commitNewFunctions() {
+  {
+    auto Inserter = Model->Functions().batch_insert();
+    for (auto &[Address, Function] : NewFunctions)
+      Inserter.emplace(std::move(Function));
+  }
+  NewFunctions.clear();
+
+  auto &DynamicFunctions = Model->ImportedDynamicFunctions();
+  std::erase_if(NewDynamicFunctions, [&DynamicFunctions](const auto &Name) {
+    return DynamicFunctions.contains(Name);
+  });
+
+  {
+    auto Inserter = DynamicFunctions.batch_insert();
+    for (const std::string &Name : NewDynamicFunctions)
+      Inserter.emplace(Name);
+  }
+  NewDynamicFunctions.clear();
+}
+
+template<typename T, bool HasAddend>
+void ELFImporter<T, HasAddend>::recordDataSymbol(const DataSymbol &Symbol,
+                                                 bool AnyAtAddress) {
+  auto &AtAddress = DataSymbolsByAddress[Symbol.Address];
+  if (AnyAtAddress and not AtAddress.empty())
+    return;
+
+  for (unsigned Index : AtAddress)
+    if (DataSymbols[Index] == Symbol)
+      return;
+
+  AtAddress.push_back(DataSymbols.size());
+  DataSymbols.push_back(Symbol);
 }
 
 template<typename T, bool HasAddend>
@@ -801,7 +870,7 @@ void ELFImporter<T, HasAddend>::parseDynamicSymbol(Elf_Sym_Impl<T> &Symbol,
   if (Symbol.st_shndx == ELF::SHN_UNDEF) {
     if (IsCode) {
       // Create dynamic function symbol
-      Model->ImportedDynamicFunctions()[Name.str()];
+      NewDynamicFunctions.insert(Name.str());
     } else {
       // TODO: create dynamic global variable
     }
@@ -812,30 +881,23 @@ void ELFImporter<T, HasAddend>::parseDynamicSymbol(Elf_Sym_Impl<T> &Symbol,
     if (IsCode) {
       Address = relocate(fromPC(Symbol.st_value));
       // TODO: record model::Function::IsDynamic = true
-      model::Function *Function = nullptr;
       revng_assert(Address.isValid());
-      auto It = Model->Functions().find(Address);
-      if (It != Model->Functions().end()) {
-        Function = &*It;
-      } else {
-        Function = &Model->Functions()[Address];
+      auto [Function, IsNew] = getOrStageFunction(Address);
+      if (IsNew)
         Function->OriginalName() = Name;
-      }
 
       if (Name.size() > 0)
         Function->ExportedNames().insert(Name.str());
     } else {
       Address = relocate(fromGeneric(Symbol.st_value));
-      if (not llvm::is_contained(DataSymbols,
-                                 DataSymbol{ Address, Size, Name }))
-        if (IsDataObject and Size > 0)
-          DataSymbols.emplace_back(Address, Size, Name);
+      if (IsDataObject and Size > 0)
+        recordDataSymbol({ Address, Size, Name }, false);
     }
   }
 }
 
 template<typename T, bool HasAddend>
-std::pair<MetaAddress, uint64_t>
+typename ELFImporter<T, HasAddend>::EHFrameIndex
 ELFImporter<T, HasAddend>::ehFrameFromEhFrameHdr() {
   revng_assert(EHFrameHdrAddress);
 
@@ -843,7 +905,7 @@ ELFImporter<T, HasAddend>::ehFrameFromEhFrameHdr() {
   if (not MaybeEHFrameHdr) {
     revng_log(ELFImporterLog,
               ".eh_frame_hdr section not available in any segment");
-    return { MetaAddress::invalid(), 0 };
+    return {};
   }
   ArrayRef<uint8_t> EHFrameHdr = *MaybeEHFrameHdr;
 
@@ -856,7 +918,7 @@ ELFImporter<T, HasAddend>::ehFrameFromEhFrameHdr() {
   if (VersionNumber != 1) {
     revng_log(ELFImporterLog,
               "Unexpected version number in .eh_frame: " << VersionNumber);
-    return { MetaAddress::invalid(), 0 };
+    return {};
   }
 
   // ExceptionFrameEncoding
@@ -866,23 +928,51 @@ ELFImporter<T, HasAddend>::ehFrameFromEhFrameHdr() {
   unsigned FDEsCountEncoding = EHFrameHdrReader.readNextU8();
 
   // LookupTableEncoding
-  EHFrameHdrReader.readNextU8();
+  unsigned LookupTableEncoding = EHFrameHdrReader.readNextU8();
 
   Pointer EHFramePointer = EHFrameHdrReader.readPointer(ExceptionFrameEncoding);
   auto MaybeFDEsCount = EHFrameHdrReader.readUnsignedValue(FDEsCountEncoding);
 
   if (not MaybeFDEsCount) {
     revng_log(ELFImporterLog, "FDE count unavailable in .eh_frame_hdr");
-    return { MetaAddress::invalid(), 0 };
+    return {};
   }
 
   MetaAddress Address = getGenericPointer(EHFramePointer);
   if (Address.isInvalid()) {
     revng_log(ELFImporterLog, "Invalid address of .eh_frame in .eh_frame_hdr");
-    return { MetaAddress::invalid(), 0 };
+    return {};
   }
 
-  return { Address, *MaybeFDEsCount };
+  EHFrameIndex Result{ Address, *MaybeFDEsCount, {} };
+
+  // The binary search table lists, sorted by initial location, the address
+  // of each FDE, relative to the start of .eh_frame_hdr. Everybody emits it
+  // as pairs of sdata4, we do not bother with other encodings.
+  using namespace llvm::dwarf;
+  if (LookupTableEncoding != (DW_EH_PE_datarel | DW_EH_PE_sdata4)) {
+    revng_log(ELFImporterLog,
+              "Unsupported .eh_frame_hdr table encoding: "
+                << LookupTableEncoding);
+    return Result;
+  }
+
+  uint64_t Available = EHFrameHdr.size() - EHFrameHdrReader.offset();
+  if (*MaybeFDEsCount > Available / 8) {
+    revng_log(ELFImporterLog, ".eh_frame_hdr table is truncated");
+    return Result;
+  }
+
+  Result.FDEs.reserve(*MaybeFDEsCount);
+  for (uint64_t I = 0; I < *MaybeFDEsCount; ++I) {
+    // InitialLocation
+    EHFrameHdrReader.readNextU32();
+
+    auto FDEOffset = static_cast<int32_t>(EHFrameHdrReader.readNextU32());
+    Result.FDEs.push_back(*EHFrameHdrAddress + static_cast<int64_t>(FDEOffset));
+  }
+
+  return Result;
 }
 
 template<typename T, bool HasAddend>
@@ -906,15 +996,6 @@ void ELFImporter<T, HasAddend>::parseEHFrame(MetaAddress EHFrameAddress,
 
   DwarfReader<T> EHFrameReader(Architecture, EHFrame, EHFrameAddress);
 
-  // A few fields of the CIE are used when decoding the FDE's.  This struct
-  // will cache those fields we need so that we don't have to decode it
-  // repeatedly for each FDE that references it.
-  struct DecodedCIE {
-    std::optional<uint32_t> FDEPointerEncoding;
-    std::optional<uint32_t> LSDAPointerEncoding;
-    bool HasAugmentationLength;
-  };
-
   // Map from the start offset of the CIE to the cached data for that CIE.
   DenseMap<uint64_t, DecodedCIE> CachedCIEs;
   unsigned FDEIndex = 0;
@@ -946,97 +1027,12 @@ void ELFImporter<T, HasAddend>::parseEHFrame(MetaAddress EHFrameAddress,
     uint32_t ID = EHFrameReader.readNextU32();
     if (ID == 0) {
       // This is a CIE
-
-      // Ensure the version is the one we expect
-      uint32_t Version = EHFrameReader.readNextU8();
-      if (Version != 1) {
-        revng_log(ELFImporterLog, "Unexpected version: " << Version);
+      std::optional<DecodedCIE> CIE = parseCIE(EHFrameReader);
+      if (not CIE)
         return;
-      }
-
-      // Parse a null terminated augmentation string
-      SmallString<8> AugmentationString;
-      for (uint8_t Char = EHFrameReader.readNextU8(); Char != 0;
-           Char = EHFrameReader.readNextU8())
-        AugmentationString.push_back(Char);
-
-      // Optionally parse the EH data if the augmentation string says it's
-      // there
-      if (StringRef(AugmentationString).contains("eh"))
-        EHFrameReader.readNextU();
-
-      // CodeAlignmentFactor
-      EHFrameReader.readULEB128();
-
-      // DataAlignmentFactor
-      EHFrameReader.readULEB128();
-
-      // ReturnAddressRegister
-      EHFrameReader.readNextU8();
-
-      std::optional<uint64_t> AugmentationLength;
-      std::optional<uint32_t> LSDAPointerEncoding;
-      std::optional<uint32_t> PersonalityEncoding;
-      std::optional<uint32_t> FDEPointerEncoding;
-      if (!AugmentationString.empty() && AugmentationString.front() == 'z') {
-        AugmentationLength = EHFrameReader.readULEB128();
-
-        // Walk the augmentation string to get all the augmentation data.
-        for (unsigned I = 1, E = AugmentationString.size(); I != E; ++I) {
-          char Char = AugmentationString[I];
-          switch (Char) {
-          case 'e':
-            if (not((I + 1) != E and AugmentationString[I + 1] == 'h')) {
-              revng_log(ELFImporterLog, "Expected 'eh' in augmentation string");
-              return;
-            }
-            break;
-          case 'L':
-            // This is the only information we really care about, all the
-            // rest is processed just so we can get here
-            if (not LSDAPointerEncoding)
-              LSDAPointerEncoding = EHFrameReader.readNextU8();
-            else
-              revng_log(ELFImporterLog, "Duplicate LSDA encoding. Ignoroing.");
-
-            break;
-          case 'P': {
-            if (PersonalityEncoding) {
-              revng_log(ELFImporterLog, "Duplicate personality. Ignoring.");
-              break;
-            }
-            PersonalityEncoding = EHFrameReader.readNextU8();
-            // Personality
-            Pointer Personality;
-            Personality = EHFrameReader.readPointer(*PersonalityEncoding);
-            auto PersonalityPtr = getCodePointer(Personality);
-            logAddress(ELFImporterLog,
-                       "Personality function: ",
-                       PersonalityPtr);
-
-            // Register in the model for exploration
-            Model->ExtraCodeAddresses().insert(PersonalityPtr);
-            break;
-          }
-          case 'R':
-            if (FDEPointerEncoding) {
-              revng_log(ELFImporterLog, "Duplicate FDE encoding. Ignoring.");
-              break;
-            }
-            FDEPointerEncoding = EHFrameReader.readNextU8();
-            break;
-          case 'z':
-            revng_log(ELFImporterLog,
-                      "'z' must be first in the augmentation string");
-            return;
-          }
-        }
-      }
 
       // Cache this entry
-      CachedCIEs[StartOffset] = { FDEPointerEncoding,
-                                  LSDAPointerEncoding,
-                                  AugmentationLength.has_value() };
+      CachedCIEs[StartOffset] = *CIE;
 
     } else {
       // This is an FDE
@@ -1062,26 +1058,263 @@ void ELFImporter<T, HasAddend>::parseEHFrame(MetaAddress EHFrameAddress,
         return;
       }
 
-      // PCBegin
-      auto PCBeginPointer = EHFrameReader.readPointer(*CIE.FDEPointerEncoding);
-      MetaAddress PCBegin = getGenericPointer(PCBeginPointer);
+      auto [PCBegin, LSDA] = parseFDE(EHFrameReader, CIE);
+      if (LSDA.isValid())
+        parseLSDA(PCBegin, LSDA);
+    }
+
+    // Skip all the remaining parts
+    EHFrameReader.moveTo(EndOffset);
+  }
+}
+
+template<typename T, bool HasAddend>
+bool ELFImporter<T, HasAddend>::parseIndexedEHFrame(MetaAddress
+                                                      EHFrameAddress,
+                                                    ArrayRef<MetaAddress>
+                                                      FDEs) {
+  auto MaybeEHFrame = File.getFromAddressOn(EHFrameAddress);
+  if (not MaybeEHFrame)
+    return true;
+  llvm::ArrayRef<uint8_t> EHFrame = *MaybeEHFrame;
+
+  using namespace model::Architecture;
+  auto Architecture = toLLVMArchitecture(Model->Architecture());
 
-      // PCRange
-      EHFrameReader.readPointer(*CIE.FDEPointerEncoding);
+  // Where each FDE starts and which CIE it references, as offsets in
+  // .eh_frame
+  struct FDEEntry {
+    uint64_t Start = 0;
+    uint64_t CIE = 0;
+  };
+  std::vector<FDEEntry> Entries(FDEs.size());
 
-      if (CIE.HasAugmentationLength)
-        EHFrameReader.readULEB128();
+  for (auto &&[Entry, Address] : llvm::zip(Entries, FDEs)) {
+    std::optional<uint64_t> Offset;
+    if (Address.isValid() and EHFrameAddress.addressLowerThanOrEqual(Address))
+      Offset = Address - EHFrameAddress;
 
-      // Decode the LSDA if the CIE augmentation string said we should.
-      if (CIE.LSDAPointerEncoding) {
-        auto LSDAPointer = EHFrameReader.readPointer(*CIE.LSDAPointerEncoding);
-        parseLSDA(PCBegin, getGenericPointer(LSDAPointer));
+    if (not Offset or *Offset + 8 > EHFrame.size()) {
+      revng_log(ELFImporterLog,
+                "FDE at " << Address.toString() << " is not in .eh_frame");
+      return false;
+    }
+    Entry.Start = *Offset;
+  }
+
+  // Read the header of each FDE, this only needs to read a few bytes
+  auto Indices = std::views::iota(size_t(0), FDEs.size());
+  std::vector<uint8_t> IsFDE(FDEs.size(), 0);
+  revng::parallelForEach(Indices, [&](size_t I) {
+    DwarfReader<T> Reader(Architecture, EHFrame, EHFrameAddress);
+    Reader.moveTo(Entries[I].Start);
+    uint32_t Length = Reader.readNextU32();
+    if (Length == 0 or Length == 0xffffffff)
+      return;
+
+    uint64_t OffsetAfterLength = Reader.offset();
+    if (OffsetAfterLength + Length > EHFrame.size())
+      return;
+
+    uint32_t ID = Reader.readNextU32();
+    if (ID == 0 or ID > OffsetAfterLength)
+      return;
+
+    Entries[I].CIE = OffsetAfterLength - ID;
+    IsFDE[I] = 1;
+  });
+
+  // Few CIEs are shared by all the FDEs: decode them sequentially, since
+  // they register the personality functions in the model
+  DenseMap<uint64_t, std::optional<DecodedCIE>> CIEs;
+  for (auto &&[Entry, Ok] : llvm::zip(Entries, IsFDE)) {
+    if (not Ok) {
+      revng_log(ELFImporterLog,
+                "Entry at offset " << Entry.Start
+                                   << " of .eh_frame is not an FDE");
+      return false;
+    }
+
+    auto [It, New] = CIEs.try_emplace(Entry.CIE);
+    if (not New)
+      continue;
+
+    DwarfReader<T> Reader(Architecture, EHFrame, EHFrameAddress);
+    if (Entry.CIE + 8 > EHFrame.size())
+      return false;
+    Reader.moveTo(Entry.CIE);
+
+    uint32_t Length = Reader.readNextU32();
+    if (Length == 0 or Length == 0xffffffff)
+      return false;
+
+    if (Reader.readNextU32() != 0) {
+      revng_log(ELFImporterLog,
+                "Couldn't find CIE at offset in to __eh_frame section");
+      return false;
+    }
+
+    It->second = parseCIE(Reader);
+    if (not It->second)
+      return false;
+
+    if (not It->second->FDEPointerEncoding) {
+      revng_log(ELFImporterLog,
+                "FDE references CIE which did not set pointer encoding");
+      return false;
+    }
+  }
+
+  // Decode the FDEs and their LSDAs, collecting the landing pads
+  std::vector<SmallVector<MetaAddress, 2>> LandingPads(FDEs.size());
+  std::vector<MetaAddress> MissingLSDAs(FDEs.size(), MetaAddress::invalid());
+  revng::parallelForEach(Indices, [&](size_t I) {
+    DwarfReader<T> Reader(Architecture, EHFrame, EHFrameAddress);
+    // Skip the length and the CIE pointer
+    Reader.moveTo(Entries[I].Start + 8);
+
+    const DecodedCIE &CIE = *CIEs.find(Entries[I].CIE)->second;
+    auto [PCBegin, LSDA] = parseFDE(Reader, CIE);
+    if (LSDA.isInvalid())
+      return;
+
+    if (not collectLandingPads(PCBegin, LSDA, LandingPads[I]))
+      MissingLSDAs[I] = LSDA;
+  });
+
+  auto &ExtraCodeAddresses = Model->ExtraCodeAddresses();
+  for (auto &&[Pads, MissingLSDA] : llvm::zip(LandingPads, MissingLSDAs)) {
+    if (MissingLSDA.isValid()) {
+      logAddress(ELFImporterLog, "LSDAAddress: ", MissingLSDA);
+      revng_log(ELFImporterLog, "LSDA not available in any segment");
+    }
+
+    for (MetaAddress LandingPad : Pads) {
+      if (!ExtraCodeAddresses.contains(LandingPad))
+        logAddress(ELFImporterLog, "New landing pad found: ", LandingPad);
+
+      ExtraCodeAddresses.insert(LandingPad);
+    }
+  }
+
+  return true;
+}
+
+template<typename T, bool HasAddend>
+std::optional<typename ELFImporter<T, HasAddend>::DecodedCIE>
+ELFImporter<T, HasAddend>::parseCIE(DwarfReader<T> &EHFrameReader) {
+  // Ensure the version is the one we expect
+  uint32_t Version = EHFrameReader.readNextU8();
+  if (Version != 1) {
+    revng_log(ELFImporterLog, "Unexpected version: " << Version);
+    return std::nullopt;
+  }
+
+  // Parse a null terminated augmentation string
+  SmallString<8> AugmentationString;
+  for (uint8_t Char = EHFrameReader.readNextU8(); Char != 0;
+       Char = EHFrameReader.readNextU8())
+    AugmentationString.push_back(Char);
+
+  // Optionally parse the EH data if the augmentation string says it's there
+  if (StringRef(AugmentationString).contains("eh"))
+    EHFrameReader.readNextU();
+
+  // CodeAlignmentFactor
+  EHFrameReader.readULEB128();
+
+  // DataAlignmentFactor
+  EHFrameReader.readULEB128();
+
+  // ReturnAddressRegister
+  EHFrameReader.readNextU8();
+
+  std::optional<uint64_t> AugmentationLength;
+  std::optional<uint32_t> LSDAPointerEncoding;
+  std::optional<uint32_t> PersonalityEncoding;
+  std::optional<uint32_t> FDEPointerEncoding;
+  if (!AugmentationString.empty() && AugmentationString.front() == 'z') {
+    AugmentationLength = EHFrameReader.readULEB128();
+
+    // Walk the augmentation string to get all the augmentation data.
+    for (unsigned I = 1, E = AugmentationString.size(); I != E; ++I) {
+      char Char = AugmentationString[I];
+      switch (Char) {
+      case 'e':
+        if (not((I + 1) != E and AugmentationString[I + 1] == 'h')) {
+          revng_log(ELFImporterLog, "Expected 'eh' in augmentation string");
+          return std::nullopt;
+        }
+        break;
+      case 'L':
+        // This is the only information we really care about, all the rest is
+        // processed just so we can get here
+        if (not LSDAPointerEncoding)
+          LSDAPointerEncoding = EHFrameReader.readNextU8();
+        else
+          revng_log(ELFImporterLog, "Duplicate LSDA encoding. Ignoroing.");
+
+        break;
+      case 'P': {
+        if (PersonalityEncoding) {
+          revng_log(ELFImporterLog, "Duplicate personality. Ignoring.");
+          break;
+        }
+        PersonalityEncoding = EHFrameReader.readNextU8();
+        // Personality
+        Pointer Personality;
+        Personality = EHFrameReader.readPointer(*PersonalityEncoding);
+        auto PersonalityPtr = getCodePointer(Personality);
+        logAddress(ELFImporterLog, "Personality function: ", PersonalityPtr);
+
+        // Register in the model for exploration
+        Model->ExtraCodeAddresses().insert(PersonalityPtr);
+        break;
+      }
+      case 'R':
+        if (FDEPointerEncoding) {
+          revng_log(ELFImporterLog, "Duplicate FDE encoding. Ignoring.");
+          break;
+        }
+        FDEPointerEncoding = EHFrameReader.readNextU8();
+        break;
+      case 'z':
+        revng_log(ELFImporterLog,
+                  "'z' must be first in the augmentation string");
+        return std::nullopt;
       }
     }
+  }
 
-    // Skip all the remaining parts
-    EHFrameReader.moveTo(EndOffset);
+  return DecodedCIE{ FDEPointerEncoding,
+                     LSDAPointerEncoding,
+                     AugmentationLength.has_value() };
+}
+
+template<typename T, bool HasAddend>
+std::pair<MetaAddress, MetaAddress>
+ELFImporter<T, HasAddend>::parseFDE(DwarfReader<T> &EHFrameReader,
+                                    const DecodedCIE &CIE) const {
+  revng_assert(CIE.FDEPointerEncoding);
+
+  // PCBegin
+  auto PCBeginPointer = EHFrameReader.readPointer(*CIE.FDEPointerEncoding);
+  MetaAddress PCBegin = getGenericPointer(PCBeginPointer);
+
+  // PCRange
+  EHFrameReader.readPointer(*CIE.FDEPointerEncoding);
+
+  if (CIE.HasAugmentationLength)
+    EHFrameReader.readULEB128();
+
+  // Decode the LSDA if the CIE augmentation string said we should.
+  MetaAddress LSDA = MetaAddress::invalid();
+  if (CIE.LSDAPointerEncoding) {
+    auto LSDAPointer = EHFrameReader.readPointer(*CIE.LSDAPointerEncoding);
+    LSDA = getGenericPointer(LSDAPointer);
   }
+
+  return { PCBegin, LSDA };
 }
 
 template<typename T, bool HasAddend>
@@ -1089,11 +1322,29 @@ void ELFImporter<T, HasAddend>::parseLSDA(MetaAddress FDEStart,
                                           MetaAddress LSDAAddress) {
   logAddress(ELFImporterLog, "LSDAAddress: ", LSDAAddress);
 
-  auto MaybeLSDA = File.getFromAddressOn(LSDAAddress);
-  if (not MaybeLSDA) {
+  SmallVector<MetaAddress, 4> LandingPads;
+  if (not collectLandingPads(FDEStart, LSDAAddress, LandingPads)) {
     revng_log(ELFImporterLog, "LSDA not available in any segment");
     return;
   }
+
+  auto &ExtraCodeAddresses = Model->ExtraCodeAddresses();
+  for (MetaAddress LandingPad : LandingPads) {
+    if (!ExtraCodeAddresses.contains(LandingPad))
+      logAddress(ELFImporterLog, "New landing pad found: ", LandingPad);
+
+    ExtraCodeAddresses.insert(LandingPad);
+  }
+}
+
+template<typename T, bool HasAddend>
+bool ELFImporter<T, HasAddend>::collectLandingPads(MetaAddress FDEStart,
+                                                   MetaAddress LSDAAddress,
+                                                   SmallVectorImpl<MetaAddress>
+                                                     &LandingPads) const {
+  auto MaybeLSDA = File.getFromAddressOn(LSDAAddress);
+  if (not MaybeLSDA)
+    return false;
   llvm::ArrayRef<uint8_t> LSDA = *MaybeLSDA;
 
   using namespace model::Architecture;
@@ -1109,8 +1360,6 @@ void ELFImporter<T, HasAddend>::parseLSDA(MetaAddress FDEStart,
     LandingPadBase = FDEStart;
   }
 
-  logAddress(ELFImporterLog, "LandingPadBase: ", LandingPadBase);
-
   uint32_t TypeTableEncoding = LSDAReader.readNextU8();
   if (TypeTableEncoding != dwarf::DW_EH_PE_omit)
     LSDAReader.readULEB128();
@@ -1134,14 +1383,11 @@ void ELFImporter<T, HasAddend>::parseLSDA(MetaAddress FDEStart,
     // Action
     LSDAReader.readULEB128();
 
-    if (LandingPad.isValid()) {
-      auto &ExtraCodeAddresses = Model->ExtraCodeAddresses();
-      if (!ExtraCodeAddresses.contains(LandingPad))
-        logAddress(ELFImporterLog, "New landing pad found: ", LandingPad);
-
-      ExtraCodeAddresses.insert(LandingPad);
-    }
+    if (LandingPad.isValid())
+      LandingPads.push_back(LandingPad);
   }
+
+  return true;
 }
 
 template<typename T, bool HasAddend>
@@ -4,6 +4,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
 #include "llvm/Object/ELFObjectFile.h"
 
 #include "revng/Model/Importer/Binary/BinaryImporterHelper.h"
@@ -71,6 +76,19 @@ private:
 private:
   llvm::SmallVector<DataSymbol, 32> DataSymbols;
 
+  /// Indexes of the entries of DataSymbols, by address
+  std::map<MetaAddress, llvm::SmallVector<unsigned, 1>> DataSymbolsByAddress;
+
+  /// Functions found in the symbol table being parsed and not yet in the model
+  ///
+  /// Symbol tables are not sorted by address, inserting them one by one in the
+  /// model would shift the underlying SortedVector every time. Instead, they
+  /// are staged here and moved in the model at once by commitNewFunctions.
+  std::map<MetaAddress, model::Function> NewFunctions;
+
+  /// Same as NewFunctions, but for dynamic functions
+  std::set<std::string> NewDynamicFunctions;
+
 protected:
   std::optional<uint64_t> SymbolsCount;
   std::unique_ptr<FilePortion> DynstrPortion;
@@ -114,13 +132,26 @@ private:
     return this->getGenericPointer(Ptr).toPC(toLLVMArchitecture(Architecture));
   }
 
-  /// Parse the .eh_frame_hdr section to obtain the address and the number of
-  /// FDEs in .eh_frame
-  ///
-  /// \return a pair containing a (possibly invalid) pointer to the .eh_frame
-  ///         section and the count of FDEs in the .eh_frame_hdr section (which
-  ///         should match the number of FDEs in .eh_frame)
-  std::pair<MetaAddress, uint64_t> ehFrameFromEhFrameHdr();
+  /// What .eh_frame_hdr tells about .eh_frame
+  struct EHFrameIndex {
+    /// The (possibly invalid) address of the .eh_frame section
+    MetaAddress EHFrame = MetaAddress::invalid();
+    /// The count of FDEs, which should match the number of FDEs in .eh_frame
+    uint64_t FDEsCount = 0;
+    /// The address of each FDE, from the binary search table, if available
+    std::vector<MetaAddress> FDEs;
+  };
+
+  /// The fields of a CIE needed to decode the FDEs referencing it
+  struct DecodedCIE {
+    std::optional<uint32_t> FDEPointerEncoding;
+    std::optional<uint32_t> LSDAPointerEncoding;
+    bool HasAugmentationLength = false;
+  };
+
+  /// Parse the .eh_frame_hdr section to obtain the address and the FDEs of
+  /// .eh_frame
+  EHFrameIndex ehFrameFromEhFrameHdr();
 
   /// Parse the .eh_frame section to collect all the landing pads
   ///
@@ -133,6 +164,26 @@ private:
                     std::optional<uint64_t> FDEsCount,
                     std::optional<uint64_t> EHFrameSize);
 
+  /// Collect all the landing pads of the FDEs at \p FDEs, as listed by the
+  /// .eh_frame_hdr binary search table, decoding them in parallel
+  ///
+  /// \return false if \p FDEs cannot be used, in which case the caller should
+  ///         walk the whole section with parseEHFrame
+  bool parseIndexedEHFrame(MetaAddress EHFrameAddress,
+                           llvm::ArrayRef<MetaAddress> FDEs);
+
+  /// Parse the body of a CIE, i.e., what follows its ID, registering its
+  /// personality function in the model
+  ///
+  /// \return std::nullopt if the CIE is malformed
+  std::optional<DecodedCIE> parseCIE(DwarfReader<T> &Reader);
+
+  /// Parse the body of an FDE, i.e., what follows its CIE pointer
+  ///
+  /// \return the start of the FDE and the address of its LSDA, if any
+  std::pair<MetaAddress, MetaAddress> parseFDE(DwarfReader<T> &Reader,
+                                               const DecodedCIE &CIE) const;
+
   /// Parse an LSDA to collect its landing pads
   ///
   /// \param FDEStart the start address of the FDE to which this LSDA is
@@ -140,6 +191,15 @@ private:
   /// \param LSDAAddress the address of the target LSDA
   void parseLSDA(MetaAddress FDEStart, MetaAddress LSDAAddress);
 
+  /// Append to \p LandingPads the landing pads of the LSDA at \p LSDAAddress,
+  /// without touching the model
+  ///
+  /// \return false if the LSDA is not available in any segment
+  bool
+  collectLandingPads(MetaAddress FDEStart,
+                     MetaAddress LSDAAddress,
+                     llvm::SmallVectorImpl<MetaAddress> &LandingPads) const;
+
   void parseSymbols(llvm::object::ELFFile<T> &TheELF,
                     ConstElf_Shdr *SectionHeader);
 
@@ -148,6 +208,19 @@ private:
   void parseDynamicSymbol(llvm::object::Elf_Sym_Impl<T> &Symbol,
                           llvm::StringRef Dynstr);
 
+  /// \returns the function at \p Address, either from the model or from
+  ///          NewFunctions, and whether it has just been created
+  std::pair<model::Function *, bool> getOrStageFunction(MetaAddress Address);
+
+  /// Move NewFunctions and NewDynamicFunctions into the model
+  void commitNewFunctions();
+
+  /// Record a new data symbol, unless an identical one is already present
+  ///
+  /// \param AnyAtAddress if true, discard the symbol if any symbol has been
+  ///        already recorded at the same address
+  void recordDataSymbol(const DataSymbol &Symbol, bool AnyAtAddress);
+
   void findMissingTypes(llvm::object::ELFFile<T> &TheELF,
                         const ImporterOptions &Options);
 
@@ -4,18 +4,137 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/BinaryFormat/Magic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
 #include "revng/Model/Binary.h"
 #include "revng/Model/Importer/Binary/BinaryImporter.h"
 #include "revng/Model/Importer/Binary/ImportBinaryAnalysis.h"
 #include "revng/Model/Importer/Binary/Options.h"
 #include "revng/Model/Importer/DebugInfo/DwarfImporter.h"
+#include "revng/Pipeline/ArtifactCache.h"
 #include "revng/Pipeline/RegisterAnalysis.h"
 #include "revng/Pipes/ModelGlobal.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/LDDTree.h"
 #include "revng/Support/ResourceFinder.h"
 #include "revng/TupleTree/TupleTree.h"
 
 using namespace revng::pipes;
 
+static Logger<> Log("import-binary-cache");
+
+static bool hashFile(llvm::SHA1 &Hasher, llvm::StringRef Path) {
+  auto MaybeBuffer = llvm::MemoryBuffer::getFile(Path);
+  if (not MaybeBuffer) {
+    revng_log(Log, "Cannot read " << Path);
+    return false;
+  }
+
+  Hasher.update(Path);
+  Hasher.update((*MaybeBuffer)->getBuffer());
+  return true;
+}
+
+/// \returns the key identifying the import of \p Path into \p Model, i.e.,
+///          a hash of the binary, of the options and of the files the
+///          importers are going to read, or std::nullopt if the results
+///          depend on something we cannot hash.
+///
+/// \note the debug information found in the global debug directories, e.g.,
+///       through `.gnu_debuglink`, is not part of the key.
+static std::optional<std::string>
+computeKey(const TupleTree<model::Binary> &Model,
+           llvm::StringRef Path,
+           const ImporterOptions &Options) {
+  // What's available remotely can change at any time
+  if (Options.EnableRemoteDebugInfo)
+    return std::nullopt;
+
+  llvm::SHA1 Hasher;
+  Hasher.update(ImportBinaryAnalysis::Name);
+  Hasher.update(revng::getComponentsHash());
+
+  std::string Buffer;
+  {
+    llvm::raw_string_ostream OS(Buffer);
+    OS << Options.BaseAddress << "\n";
+    OS << static_cast<int>(Options.DebugInfo) << "\n";
+    OS << Options.MachOSlice << "\n";
+
+    // The importers start from the current model, which is usually empty
+    Model.serializeBinary(OS);
+  }
+  Hasher.update(Buffer);
+
+  auto MaybeBinary = llvm::MemoryBuffer::getFile(Path);
+  if (not MaybeBinary)
+    return std::nullopt;
+  llvm::StringRef Binary = (*MaybeBinary)->getBuffer();
+  Hasher.update(Binary);
+
+  for (const std::string &DebugInfoPath : Options.AdditionalDebugInfoPaths)
+    if (not hashFile(Hasher, DebugInfoPath))
+      return std::nullopt;
+
+  // The ELF importer looks for types in the direct dependencies found on the
+  // system, using lddtree the same way. The PE/COFF importer has its own
+  // logic, don't try to replicate it.
+  if (Options.DebugInfo == DebugInfoLevel::Yes) {
+    switch (llvm::identify_magic(Binary)) {
+    case llvm::file_magic::pecoff_executable:
+    case llvm::file_magic::coff_object:
+      return std::nullopt;
+
+    default:
+      break;
+    }
+
+    LDDTree Dependencies;
+    lddtree(Dependencies, Path.str(), 1);
+    for (const auto &[Library, Needed] : Dependencies)
+      for (const std::string &Dependency : Needed)
+        if (not hashFile(Hasher, Dependency))
+          return std::nullopt;
+  }
+
+  return llvm::toHex(Hasher.final(), true);
+}
+
+/// \returns true if the results of an identical import have been found in
+///          the artifact cache and loaded into \p Model
+static bool restore(pipeline::ArtifactCache &Cache,
+                    llvm::StringRef Key,
+                    TupleTree<model::Binary> &Model) {
+  auto MaybeEntry = Cache.loadData(Key);
+  if (not MaybeEntry) {
+    revng_log(Log,
+              "Cannot load from the artifact cache: "
+                << llvm::toString(MaybeEntry.takeError()));
+    return false;
+  }
+
+  if (not MaybeEntry->has_value())
+    return false;
+
+  auto MaybeModel = TupleTree<model::Binary>::fromString(**MaybeEntry);
+  if (not MaybeModel) {
+    revng_log(Log,
+              "Invalid entry in the artifact cache: "
+                << llvm::toString(MaybeModel.takeError()));
+    return false;
+  }
+
+  Model = std::move(*MaybeModel);
+  return true;
+}
+
 llvm::Error ImportBinaryAnalysis::run(pipeline::ExecutionContext &Context,
                                       const BinaryFileContainer &SourceBinary) {
   if (not SourceBinary.exists())
@@ -25,6 +144,16 @@ llvm::Error ImportBinaryAnalysis::run(pipeline::ExecutionContext &Context,
 
   const ImporterOptions &Options = importerOptions();
 
+  // The same binary, e.g., a given build of busybox, is often imported over
+  // and over in different projects: look for the results in the cache
+  pipeline::ArtifactCache *Cache = pipeline::ArtifactCache::get();
+  std::optional<std::string> CacheKey;
+  if (Cache != nullptr) {
+    CacheKey = computeKey(Model, *SourceBinary.path(), Options);
+    if (CacheKey and restore(*Cache, *CacheKey, Model))
+      return llvm::Error::success();
+  }
+
   llvm::Task T(2, "Import binary");
   T.advance("Import main binary", true);
 
@@ -42,6 +171,20 @@ llvm::Error ImportBinaryAnalysis::run(pipeline::ExecutionContext &Context,
     }
   }
 
+  if (CacheKey.has_value()) {
+    std::string Buffer;
+    {
+      llvm::raw_string_ostream OS(Buffer);
+      Model.serializeBinary(OS);
+    }
+
+    if (llvm::Error Error = Cache->storeData(*CacheKey, Buffer)) {
+      revng_log(Log,
+                "Cannot store into the artifact cache: "
+                  << llvm::toString(std::move(Error)));
+    }
+  }
+
   return llvm::Error::success();
 }
 
@@ -25,9 +25,13 @@ llvm::Error importELF(TupleTree<model::Binary> &Model,
 llvm::Error importPECOFF(TupleTree<model::Binary> &Model,
                          const llvm::object::COFFObjectFile &TheBinary,
                          const ImporterOptions &Options);
+
+/// \param SliceOffset the offset of \p TheBinary in the file it comes from, in
+///        case it's a slice of a universal binary. Segments refer to such file.
 llvm::Error importMachO(TupleTree<model::Binary> &Model,
                         llvm::object::MachOObjectFile &TheBinary,
-                        const ImporterOptions &Options);
+                        const ImporterOptions &Options,
+                        uint64_t SliceOffset = 0);
 
 template<typename... Ts>
 llvm::Error createError(char const *Fmt, const Ts &...Vals) {
@@ -167,15 +167,19 @@ private:
   RawBinaryView File;
   TupleTree<model::Binary> &Model;
   object::MachOObjectFile &TheBinary;
+  /// Offset of TheBinary in the universal binary it's a slice of, if any
+  uint64_t SliceOffset = 0;
 
 public:
   MachOImporter(TupleTree<model::Binary> &Model,
                 object::MachOObjectFile &TheBinary,
-                uint64_t BaseAddress) :
+                uint64_t BaseAddress,
+                uint64_t SliceOffset) :
     BinaryImporterHelper(Model->Architecture(), BaseAddress),
     File(*Model, toArrayRef(TheBinary.getData())),
     Model(Model),
-    TheBinary(TheBinary) {}
+    TheBinary(TheBinary),
+    SliceOffset(SliceOffset) {}
 
   llvm::Error import();
 
@@ -265,7 +269,7 @@ Error MachOImporter::import() {
   if (EntryPointOffset) {
     using namespace model::Architecture;
     auto LLVMArchitecture = toLLVMArchitecture(Model->Architecture());
-    Model->EntryPoint() = File.offsetToAddress(*EntryPointOffset)
+    Model->EntryPoint() = File.offsetToAddress(SliceOffset + *EntryPointOffset)
                             .toPC(LLVMArchitecture);
   }
 
@@ -297,15 +301,17 @@ void MachOImporter::parseMachOSegment(ArrayRef<uint8_t> RawDataRef,
   MetaAddress Start = fromGeneric(SegmentCommand.vmaddr);
   Segment Segment({ Start, SegmentCommand.vmsize });
 
-  Segment.StartOffset() = SegmentCommand.fileoff;
-  auto MaybeEndOffset = OverflowSafeInt<uint64_t>(SegmentCommand.fileoff)
-                        + SegmentCommand.filesize;
+  // Segments refer to the whole file, not to the slice
+  auto MaybeStartOffset = OverflowSafeInt<uint64_t>(SliceOffset)
+                          + SegmentCommand.fileoff;
+  auto MaybeEndOffset = MaybeStartOffset + SegmentCommand.filesize;
   if (not MaybeEndOffset) {
     revng_log(Log,
               "Invalid MachO segment found: overflow in computing end offset");
     return;
   }
 
+  Segment.StartOffset() = *MaybeStartOffset;
   Segment.OriginalName() = SegmentCommand.segname;
   Segment.FileSize() = SegmentCommand.filesize;
 
@@ -365,7 +371,8 @@ void MachOImporter::registerBindEntry(const object::MachOBindEntry *Entry) {
 
 Error importMachO(TupleTree<model::Binary> &Model,
                   object::MachOObjectFile &TheBinary,
-                  const ImporterOptions &Options) {
-  MachOImporter Importer(Model, TheBinary, Options.BaseAddress);
+                  const ImporterOptions &Options,
+                  uint64_t SliceOffset) {
+  MachOImporter Importer(Model, TheBinary, Options.BaseAddress, SliceOffset);
   return Importer.import();
 }
@@ -57,9 +57,18 @@ cl::opt<bool> EnableRemoteDebugInfo("enable-remote-debug-info",
                                     cl::cat(MainCategory),
                                     cl::init(false));
 
+constexpr SR DescSlice = "Architecture of the slice to import from a Mach-O "
+                         "universal binary.";
+cl::opt<std::string> MachOSlice("macho-slice",
+                                cl::desc(DescSlice),
+                                cl::value_desc("architecture"),
+                                cl::cat(MainCategory),
+                                cl::init(""));
+
 const ImporterOptions importerOptions() {
   return ImporterOptions{ .BaseAddress = BaseAddress,
                           .DebugInfo = DebugInfo,
                           .EnableRemoteDebugInfo = EnableRemoteDebugInfo,
-                          .AdditionalDebugInfoPaths = ImportDebugInfo };
+                          .AdditionalDebugInfoPaths = ImportDebugInfo,
+                          .MachOSlice = MachOSlice };
 }
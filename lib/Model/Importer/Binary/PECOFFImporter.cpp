@@ -4,9 +4,19 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "llvm/Object/COFF.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
 
 #include "revng/ABI/DefaultFunctionPrototype.h"
 #include "revng/Model/Binary.h"
@@ -16,6 +26,8 @@
 #include "revng/Model/Importer/DebugInfo/PDBImporter.h"
 #include "revng/Model/Pass/AllPasses.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/FileParseCache.h"
+#include "revng/Support/TaskScheduler.h"
 
 #include "CrossModelFindTypeHelper.h"
 #include "Importers.h"
@@ -56,8 +68,8 @@ private:
   /// Parse delay dynamic symbols from the file.
   void parseDelayImportedSymbols();
 
-  /// Resolve dependent DLLs.
-  void getDependencies(PELDDTree Dependencies, unsigned Level);
+  /// Resolve dependent DLLs, up to \p Level levels of the tree.
+  PELDDTree getDependencies(unsigned Level) const;
   /// Try to find prototypes in the Models of dynamic libraries.
   void findMissingTypes(const ImporterOptions &Options);
 
@@ -310,23 +322,29 @@ void PECOFFImporter::parseDelayImportedSymbols() {
   }
 }
 
-/// \note For the PE/COFF, we are assuming that the libraries are in the current
-/// directory.
-static RecursiveCoroutine<void> getDependenciesHelper(StringRef FileName,
-                                                      PELDDTree Dependencies,
-                                                      unsigned CurrentLevel,
-                                                      unsigned Level) {
-  auto BinaryOrErr = object::createBinary(FileName);
+/// The names of the DLLs imported by a PE/COFF, lower-cased
+struct DLLImports {
+  bool IsCOFF = false;
+  std::vector<std::string> Libraries;
+};
+
+static DLLImports parseDLLImports(StringRef Path) {
+  DLLImports Result;
+
+  auto BinaryOrErr = object::createBinary(Path);
   if (not BinaryOrErr) {
     revng_log(Log,
-              "Can't create object for " << FileName << " due to "
+              "Can't create object for " << Path << " due to "
                                          << toString(BinaryOrErr.takeError()));
     llvm::consumeError(BinaryOrErr.takeError());
-    rc_return;
+    return Result;
   }
 
-  auto Object = cast<object::ObjectFile>(BinaryOrErr->getBinary());
-  auto COFFObject = cast<COFFObjectFile>(Object);
+  auto *COFFObject = dyn_cast<COFFObjectFile>(BinaryOrErr->getBinary());
+  if (COFFObject == nullptr)
+    return Result;
+
+  Result.IsCOFF = true;
   for (const ImportDirectoryEntryRef &I : COFFObject->import_directories()) {
     StringRef LibraryName;
     if (Error E = I.getName(LibraryName)) {
@@ -353,27 +371,139 @@ static RecursiveCoroutine<void> getDependenciesHelper(StringRef FileName,
               LibraryNameAsString.end(),
               LibraryNameAsString.begin(),
               ::tolower);
-    Dependencies[FileName.str()].push_back(LibraryNameAsString);
+    Result.Libraries.push_back(LibraryNameAsString);
   }
 
-  if (CurrentLevel == Level)
-    rc_return;
+  return Result;
+}
 
-  ++CurrentLevel;
-  for (auto &Library : Dependencies) {
-    revng_log(Log, "Dependencies for " << Library.first << ":\n");
-    for (auto &DependingLibrary : Library.second)
-      if (!Dependencies.contains(DependingLibrary))
-        rc_recur getDependenciesHelper(DependingLibrary,
-                                       Dependencies,
-                                       CurrentLevel,
-                                       Level);
+/// \returns the absolute path of \p Path and its modification time, or
+///          std::nullopt if it cannot be accessed
+static std::optional<std::pair<std::string, sys::TimePoint<>>>
+getCacheKey(StringRef Path) {
+  sys::fs::file_status Status;
+  if (sys::fs::status(Path, Status) or not sys::fs::exists(Status))
+    return std::nullopt;
+
+  SmallString<128> AbsolutePath(Path);
+  if (sys::fs::make_absolute(AbsolutePath))
+    return std::nullopt;
+
+  return std::pair{ AbsolutePath.str().str(),
+                    Status.getLastModificationTime() };
+}
+
+/// \returns the DLLs imported by the PE/COFF at \p Path, or nullptr if it
+///          cannot be accessed
+static std::shared_ptr<const DLLImports> getDLLImports(StringRef Path) {
+  static FileParseCache<DLLImports> Cache;
+  return Cache.get(Path, parseDLLImports);
+}
+
+/// \note For the PE/COFF, we are assuming that the libraries are in the current
+/// directory.
+PELDDTree PECOFFImporter::getDependencies(unsigned Level) const {
+  PELDDTree Dependencies;
+
+  // Visit the tree level by level, the DLLs of a level are parsed in parallel
+  std::vector<std::string> CurrentLevel = { TheBinary.getFileName().str() };
+  std::set<std::string> Visited(CurrentLevel.begin(), CurrentLevel.end());
+  for (unsigned Depth = 0; Depth < Level and not CurrentLevel.empty();
+       ++Depth) {
+    std::vector<std::shared_ptr<const DLLImports>> Imports(CurrentLevel.size());
+    auto Indices = std::views::iota(size_t(0), CurrentLevel.size());
+    revng::parallelForEach(Indices, [&](size_t Index) {
+      Imports[Index] = getDLLImports(CurrentLevel[Index]);
+    });
+
+    std::vector<std::string> NextLevel;
+    for (size_t Index = 0; Index < CurrentLevel.size(); ++Index) {
+      const std::string &FileName = CurrentLevel[Index];
+      if (Imports[Index] == nullptr or not Imports[Index]->IsCOFF) {
+        revng_log(Log, "Can't find a PE/COFF for " << FileName);
+        continue;
+      }
+
+      revng_log(Log, "Dependencies for " << FileName << ":");
+      auto &Libraries = Dependencies[FileName];
+      for (const std::string &Library : Imports[Index]->Libraries) {
+        revng_log(Log, "  " << Library);
+        Libraries.push_back(Library);
+        if (Visited.insert(Library).second)
+          NextLevel.push_back(Library);
+      }
+    }
+
+    CurrentLevel = std::move(NextLevel);
   }
+
+  return Dependencies;
 }
 
-void PECOFFImporter::getDependencies(PELDDTree Dependencies, unsigned Level) {
-  if (Level > 0)
-    getDependenciesHelper(TheBinary.getFileName(), Dependencies, 1, Level);
+/// \returns the model of the DLL at \p Path imported with \p Options, or
+///          nullptr if it cannot be imported
+///
+/// Models are cached for the whole process, so that importing many binaries
+/// linking the same system DLLs parses their debug info only once.
+static std::shared_ptr<const TupleTree<model::Binary>>
+getDLLModel(StringRef Path,
+            model::Architecture::Values Architecture,
+            const ImporterOptions &Options) {
+  using ModelPointer = std::shared_ptr<const TupleTree<model::Binary>>;
+  using Entry = std::pair<sys::TimePoint<>, ModelPointer>;
+  static std::mutex Mutex;
+  static std::map<std::string, Entry> Cache;
+
+  auto Key = getCacheKey(Path);
+  if (not Key)
+    return nullptr;
+  auto &[AbsolutePath, ModificationTime] = *Key;
+
+  // Everything affecting the outcome of the import is part of the key
+  std::string CacheKey;
+  {
+    raw_string_ostream Stream(CacheKey);
+    Stream << AbsolutePath << '\0'
+           << model::Architecture::getName(Architecture) << '\0'
+           << Options.BaseAddress << '\0' << Options.EnableRemoteDebugInfo;
+    for (const std::string &DebugInfoPath : Options.AdditionalDebugInfoPaths)
+      Stream << '\0' << DebugInfoPath;
+  }
+
+  {
+    std::lock_guard Lock(Mutex);
+    auto It = Cache.find(CacheKey);
+    if (It != Cache.end() and It->second.first == ModificationTime)
+      return It->second.second;
+  }
+
+  auto BinaryOrErr = llvm::object::createBinary(Path);
+  if (not BinaryOrErr) {
+    revng_log(Log,
+              "Can't create object for " << Path << " due to "
+                                         << toString(BinaryOrErr.takeError()));
+    llvm::consumeError(BinaryOrErr.takeError());
+    return nullptr;
+  }
+
+  auto *TheBinary = dyn_cast<COFFObjectFile>(BinaryOrErr->getBinary());
+  if (!TheBinary)
+    return nullptr;
+
+  TupleTree<model::Binary> DepModel;
+  DepModel->Architecture() = Architecture;
+  if (auto E = importPECOFF(DepModel, *TheBinary, Options)) {
+    revng_log(Log, "Can't import model for " << Path << " due to " << E);
+    llvm::consumeError(std::move(E));
+    return nullptr;
+  }
+
+  using ConstModel = const TupleTree<model::Binary>;
+  auto Result = std::make_shared<ConstModel>(std::move(DepModel));
+
+  std::lock_guard Lock(Mutex);
+  Cache[CacheKey] = { ModificationTime, Result };
+  return Result;
 }
 
 void PECOFFImporter::findMissingTypes(const ImporterOptions &Opts) {
@@ -384,55 +514,44 @@ void PECOFFImporter::findMissingTypes(const ImporterOptions &Opts) {
   //       the `ImporterOptions::DebugInfo`, if the need ever arises.
   unsigned MaximumRecursionDepth = 1;
 
-  PELDDTree Dependencies;
-  getDependencies(Dependencies, MaximumRecursionDepth);
+  PELDDTree Dependencies = getDependencies(MaximumRecursionDepth);
 
   ModelMap ModelsOfLibraries;
   TypeCopierMap TypeCopiers;
 
+  ImporterOptions AdjustedOptions{
+    .BaseAddress = Opts.BaseAddress,
+    .DebugInfo = DebugInfoLevel::IgnoreLibraries,
+    .EnableRemoteDebugInfo = Opts.EnableRemoteDebugInfo,
+    .AdditionalDebugInfoPaths = Opts.AdditionalDebugInfoPaths
+  };
+
   for (auto &Library : Dependencies) {
     revng_log(Log,
               "Importing Models for dependencies of " << Library.first << ":");
     for (auto &DependencyLibrary : Library.second) {
       if (ModelsOfLibraries.contains(DependencyLibrary))
         continue;
-      revng_log(Log, " Importing Model for: " << DependencyLibrary);
-      auto BinaryOrErr = llvm::object::createBinary(DependencyLibrary);
-      if (not BinaryOrErr) {
-        revng_log(Log,
-                  "Can't create object for "
-                    << DependencyLibrary << " due to "
-                    << toString(BinaryOrErr.takeError()));
-        llvm::consumeError(BinaryOrErr.takeError());
-        continue;
-      }
 
-      auto &File = *cast<llvm::object::ObjectFile>(BinaryOrErr->getBinary());
-      auto *TheBinary = dyn_cast<COFFObjectFile>(&File);
-      if (!TheBinary)
+      // Skip DLLs we already know we can't open
+      auto Imports = getDLLImports(DependencyLibrary);
+      if (Imports == nullptr or not Imports->IsCOFF)
         continue;
 
-      ModelsOfLibraries[DependencyLibrary] = TupleTree<model::Binary>();
-      auto &DepModel = ModelsOfLibraries[DependencyLibrary];
-      DepModel->Architecture() = Model->Architecture();
-
-      ImporterOptions AdjustedOptions{
-        .BaseAddress = Opts.BaseAddress,
-        .DebugInfo = DebugInfoLevel::IgnoreLibraries,
-        .EnableRemoteDebugInfo = Opts.EnableRemoteDebugInfo,
-        .AdditionalDebugInfoPaths = Opts.AdditionalDebugInfoPaths
-      };
-      if (auto E = importPECOFF(DepModel, *TheBinary, AdjustedOptions)) {
-        revng_log(Log,
-                  "Can't import model for " << DependencyLibrary << " due to "
-                                            << E);
-        llvm::consumeError(std::move(E));
-        ModelsOfLibraries.erase(DependencyLibrary);
+      revng_log(Log, " Importing Model for: " << DependencyLibrary);
+      auto DepModel = getDLLModel(DependencyLibrary,
+                                  Model->Architecture(),
+                                  AdjustedOptions);
+      if (DepModel == nullptr)
         continue;
-      }
+
+      // TypeCopier needs a model of its own
+      ModelsOfLibraries[DependencyLibrary] = *DepModel;
     }
   }
 
+  PrototypeIndex Prototypes(ModelsOfLibraries);
+
   auto GetOrMakeACopier = [&](llvm::StringRef Name) -> TypeCopier & {
     if (auto It = TypeCopiers.find(Name.str()); It != TypeCopiers.end())
       return *It->second;
@@ -452,7 +571,7 @@ void PECOFFImporter::findMissingTypes(const ImporterOptions &Opts) {
       continue;
 
     revng_log(Log, "Searching for prototype for " << Fn.OriginalName());
-    if (auto Found = findPrototype(Fn.OriginalName(), ModelsOfLibraries)) {
+    if (auto Found = Prototypes.find(Fn.OriginalName())) {
       revng_assert(!Found->ModuleName.empty());
       revng_assert(Found->Prototype.verify(true));
 
@@ -5,10 +5,15 @@
 //
 
 #include <csignal>
+#include <future>
+#include <mutex>
 #include <optional>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/BinaryFormat/Dwarf.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
@@ -29,6 +34,7 @@
 #include "revng/Model/Importer/DebugInfo/DwarfImporter.h"
 #include "revng/Model/Pass/AllPasses.h"
 #include "revng/Model/Processing.h"
+#include "revng/Model/TypeDependencyIndex.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/PathList.h"
@@ -47,21 +53,20 @@ class ScopedSetElement {
 private:
   M &Set;
   typename M::value_type ToInsert;
+  bool Inserted = false;
 
 public:
   ScopedSetElement(M &Set, typename M::value_type ToInsert) :
     Set(Set), ToInsert(ToInsert) {}
-  ~ScopedSetElement() { Set.erase(ToInsert); }
+  ~ScopedSetElement() {
+    if (Inserted)
+      Set.erase(ToInsert);
+  }
 
 public:
   bool insert() {
-    auto It = Set.find(ToInsert);
-    if (It != Set.end()) {
-      return false;
-    } else {
-      Set.insert(It, ToInsert);
-      return true;
-    }
+    Inserted = Set.insert(ToInsert).second;
+    return Inserted;
   }
 };
 
@@ -169,9 +174,11 @@ private:
   size_t AltIndex;
   size_t TypesWithIdentityCount;
   DWARFContext &Context;
-  std::map<size_t, const model::TypeDefinition *> Placeholders;
-  std::set<const model::TypeDefinition *> InvalidPrimitives;
-  std::set<const DWARFDie *> InProgressDies;
+  llvm::DenseMap<uint64_t, const model::TypeDefinition *> Placeholders;
+  llvm::DenseSet<const model::TypeDefinition *> InvalidPrimitives;
+
+  /// Offsets of the DIEs being resolved, used to detect loops
+  llvm::DenseSet<uint64_t> InProgressDies;
 
 public:
   DwarfToModelConverter(DwarfImporter &Importer,
@@ -668,7 +675,7 @@ private:
   resolveType(const DWARFDie &Die, bool ResolveIfHasIdentity) {
     // Ensure there are no loops in the dies we're exploring
     using ScopedSetElement = ScopedSetElement<decltype(InProgressDies)>;
-    ScopedSetElement InProgressDie(InProgressDies, &Die);
+    ScopedSetElement InProgressDie(InProgressDies, Die.getOffset());
     if (not InProgressDie.insert()) {
       reportIgnoredDie(Die, "Recursive die");
       rc_return model::UpcastableType::empty();
@@ -903,12 +910,14 @@ private:
     }
   }
 
-  void purgeUnresolvedPlaceholders() {
+  void purgeUnresolvedPlaceholders(model::TypeDependencyIndex &Index) {
     std::set<const model::TypeDefinition *> ToDrop;
     for (const auto [_, Type] : Placeholders)
       ToDrop.insert(Type);
 
-    unsigned DroppedTypes = dropTypesDependingOnDefinitions(Model, ToDrop);
+    unsigned DroppedTypes = dropTypesDependingOnDefinitions(Model,
+                                                            ToDrop,
+                                                            Index);
     revng_log(DILogger,
               "Purging " << DroppedTypes << " types (out of "
                          << TypesWithIdentityCount << ") due to "
@@ -927,9 +936,11 @@ public:
     T.advance("Create model functions", true);
     createFunctions();
     T.advance("Remove types that depend on unresolved placeholders", true);
-    purgeUnresolvedPlaceholders();
+    // Both the following steps only drop types and fields: share the index
+    model::TypeDependencyIndex Index(*Model);
+    purgeUnresolvedPlaceholders(Index);
     T.advance("Remove types that couldn't be imported fully", true);
-    purgeInvalidTypes(Model);
+    purgeInvalidTypes(Model, Index);
     T.advance("Deduplicate equivalent types", true);
     deduplicateEquivalentTypes(Model);
     T.advance("Promote OriginalName", true);
@@ -1151,6 +1162,89 @@ findDebugInfoFileByName(StringRef FileName,
   return std::nullopt;
 }
 
+/// \note Split DWARF is not supported yet, `.debug_info.dwo` does not count
+static bool hasDebugInfo(const object::ObjectFile *Object) {
+  using namespace llvm::object;
+  for (const SectionRef &Section : Object->sections()) {
+    StringRef SectionName;
+    if (Expected<StringRef> NameOrErr = Section.getName()) {
+      SectionName = *NameOrErr;
+    } else {
+      llvm::consumeError(NameOrErr.takeError());
+      continue;
+    }
+
+    if (SectionName == ".debug_info")
+      return true;
+  }
+  return false;
+}
+
+/// Runs of `fetch-debuginfo` started by DwarfImporter::prefetch, by the path
+/// of the binary they're fetching the debug information of
+static std::mutex PendingFetchesMutex;
+static StringMap<std::shared_future<ProgramRunner::Result>> PendingFetches;
+
+/// \returns the exit code of `fetch-debuginfo` for \p FileName, waiting for
+///          the run started by DwarfImporter::prefetch, if any
+static int fetchDebugInfo(StringRef FileName) {
+  std::optional<std::shared_future<ProgramRunner::Result>> Pending;
+  {
+    std::lock_guard Lock(PendingFetchesMutex);
+    auto It = PendingFetches.find(FileName);
+    if (It != PendingFetches.end()) {
+      Pending = std::move(It->second);
+      PendingFetches.erase(It);
+    }
+  }
+
+  if (not Pending.has_value())
+    return runFetchDebugInfo(FileName);
+
+  revng_log(DILogger, "Waiting for the prefetch of " << FileName);
+  const ProgramRunner::Result &Result = Pending->get();
+  if (Result.ExitCode != 0)
+    revng_log(DILogger, Result.Stdout << Result.Stderr);
+  return Result.ExitCode;
+}
+
+void DwarfImporter::prefetch(ArrayRef<std::string> FileNames,
+                             const ImporterOptions &Options) {
+  if (Options.DebugInfo == DebugInfoLevel::No
+      or not ::Runner.isProgramAvailable("revng"))
+    return;
+
+  // Checking what's missing only takes a look at the headers and at the file
+  // system, fetching is what takes time
+  for (const std::string &FileName : FileNames) {
+    {
+      std::lock_guard Lock(PendingFetchesMutex);
+      if (PendingFetches.count(FileName) != 0)
+        continue;
+    }
+
+    auto MaybeBinary = object::createBinary(FileName);
+    if (not MaybeBinary) {
+      llvm::consumeError(MaybeBinary.takeError());
+      continue;
+    }
+
+    auto *ELF = dyn_cast<object::ELFObjectFileBase>(MaybeBinary->getBinary());
+    if (ELF == nullptr or hasDebugInfo(ELF))
+      continue;
+
+    StringRef DebugFile = getDebugFileName(ELF);
+    if (DebugFile.empty() or findDebugInfoFileByName(FileName, DebugFile, ELF))
+      continue;
+
+    revng_log(DILogger, "Prefetching the debug info of " << FileName);
+    auto Future = runFetchDebugInfoAsync(FileName);
+
+    std::lock_guard Lock(PendingFetchesMutex);
+    PendingFetches.try_emplace(FileName, std::move(Future));
+  }
+}
+
 void DwarfImporter::import(StringRef FileName, const ImporterOptions &Options) {
   Task T(3,
          "Importing DWARF information for "
@@ -1178,29 +1272,6 @@ void DwarfImporter::import(StringRef FileName, const ImporterOptions &Options) {
     return;
   }
 
-  // Find Debugging Information.
-  // If the file has debug info sections within itself, no need for finding
-  // it on the device.
-  // TODO: When we add support for Split DWARF, this will need additional
-  // improvement.
-  auto HasDebugInfo = [](ObjectFile *Object) {
-    for (const SectionRef &Section : Object->sections()) {
-      StringRef SectionName;
-      if (Expected<StringRef> NameOrErr = Section.getName()) {
-        SectionName = *NameOrErr;
-      } else {
-        llvm::consumeError(NameOrErr.takeError());
-        continue;
-      }
-
-      // TODO: When adding support for Split dwarf, there will be
-      // .debug_info.dwo section, so we need to handle it.
-      if (SectionName == ".debug_info")
-        return true;
-    }
-    return false;
-  };
-
   auto PerformImport = [this, &T, &Options](StringRef FilePath,
                                             StringRef TheDebugFile) {
     auto ExpectedBinary = object::createBinary(FilePath);
@@ -1216,8 +1287,13 @@ void DwarfImporter::import(StringRef FileName, const ImporterOptions &Options) {
     }
   };
 
+  // Find Debugging Information.
+  // If the file has debug info sections within itself, no need for finding
+  // it on the device.
+  // TODO: When we add support for Split DWARF, this will need additional
+  // improvement.
   if (auto *ELF = dyn_cast<ObjectFile>(MaybeBinary->get())) {
-    if (Options.DebugInfo != DebugInfoLevel::No && !HasDebugInfo(ELF)) {
+    if (Options.DebugInfo != DebugInfoLevel::No && !hasDebugInfo(ELF)) {
       // There are no .debug_* sections in the file itself, let's try to find it
       // on the device, otherwise find it on web by using the `fetch-debuginfo`
       // tool.
@@ -1234,7 +1310,7 @@ void DwarfImporter::import(StringRef FileName, const ImporterOptions &Options) {
           return;
         }
 
-        int ExitCode = runFetchDebugInfo(FileName);
+        int ExitCode = fetchDebugInfo(FileName);
         if (ExitCode != 0) {
           revng_log(DILogger,
                     "Failed to find debug info with `revng model "
@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <future>
+
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 
@@ -18,4 +20,12 @@ inline int runFetchDebugInfo(llvm::StringRef InputFileName) {
                       { "model", "fetch-debuginfo", InputFileName.str() });
 }
 
+inline std::shared_future<ProgramRunner::Result>
+runFetchDebugInfoAsync(llvm::StringRef InputFileName) {
+  revng_assert(::Runner.isProgramAvailable("revng"));
+  return ::Runner.runAsync("revng",
+                           { "model", "fetch-debuginfo", InputFileName.str() },
+                           true);
+}
+
 } // namespace
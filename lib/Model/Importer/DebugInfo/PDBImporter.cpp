@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <chrono>
 #include <optional>
 
 #include "llvm/DebugInfo/CodeView/CVSymbolVisitor.h"
@@ -92,13 +93,13 @@ class PDBImporterTypeVisitor : public TypeVisitorCallbacks {
   TpiStream &Tpi;
 
   TypeIndex CurrentTypeIndex = TypeIndex::None();
-  std::map<TypeIndex, SmallVector<DataMemberRecord, 8>> InProgressMemberTypes;
-  std::map<TypeIndex, SmallVector<EnumeratorRecord, 8>>
+  DenseMap<TypeIndex, SmallVector<DataMemberRecord, 8>> InProgressMemberTypes;
+  DenseMap<TypeIndex, SmallVector<EnumeratorRecord, 8>>
     InProgressEnumeratorTypes;
-  std::map<TypeIndex, ArgListRecord> InProgressArgumentsTypes;
+  DenseMap<TypeIndex, ArgListRecord> InProgressArgumentsTypes;
 
   // Methods of a Class type. It references concrete MemberFunctionRecord.
-  std::map<TypeIndex, SmallVector<OneMethodRecord, 8>>
+  DenseMap<TypeIndex, SmallVector<OneMethodRecord, 8>>
     InProgressFunctionMemberTypes;
   DenseMap<TypeIndex, MemberFunctionRecord>
     InProgressConcreteFunctionMemberTypes;
@@ -170,13 +171,8 @@ public:
 } // namespace
 
 void PDBImporterImpl::populateTypes() {
-  auto MaybeInputFile = InputFile::open(Importer.getPDBFile()->getFilePath());
-  if (not MaybeInputFile) {
-    revng_log(Log, "Unable to open PDB file " << MaybeInputFile.takeError());
-    consumeError(MaybeInputFile.takeError());
-    return;
-  }
-
+  // Note: visit the type collection of the TPI stream of the PDB we already
+  //       loaded, rather than opening (and mapping) the PDB file once more
   auto MaybeTpiStream = Importer.getPDBFile()->getPDBTpiStream();
   if (not MaybeTpiStream) {
     revng_log(Log,
@@ -187,15 +183,30 @@ void PDBImporterImpl::populateTypes() {
 
   // Those will be processed after all the types are visited.
   DenseMap<TypeIndex, TypeIndex> ForwardReferencedTypes;
+  LazyRandomTypeCollection &Types = MaybeTpiStream->typeCollection();
   PDBImporterTypeVisitor TypeVisitor(Importer.getModel(),
-                                     MaybeInputFile->types(),
+                                     Types,
                                      ProcessedTypes,
                                      ForwardReferencedTypes,
                                      *MaybeTpiStream);
-  if (auto Error = visitTypeStream(MaybeInputFile->types(), TypeVisitor)) {
+
+  auto Start = std::chrono::steady_clock::now();
+  if (auto Error = visitTypeStream(Types, TypeVisitor)) {
     revng_log(Log, "Error during visiting types: " << Error);
     consumeError(std::move(Error));
   }
+
+  if (Log.isEnabled()) {
+    using namespace std::chrono;
+    auto Elapsed = duration_cast<milliseconds>(steady_clock::now() - Start);
+    uint64_t Records = MaybeTpiStream->getNumTypeRecords();
+    uint64_t Milliseconds = std::max<uint64_t>(Elapsed.count(), 1);
+    revng_log(Log,
+              "Visited " << Records << " type records in " << Milliseconds
+                         << " ms (" << (Records * 1000 / Milliseconds)
+                         << " records/s), " << ProcessedTypes.size()
+                         << " of them have been imported");
+  }
 }
 
 class PDBSymbolHandler {
@@ -671,7 +682,8 @@ Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
 
   TypeIndex FieldsTypeIndex = Class.getFieldList();
   bool WasReferenced = ForwardReferencedTypes.count(CurrentTypeIndex) != 0;
-  if (InProgressMemberTypes.count(FieldsTypeIndex) != 0) {
+  auto MembersIt = InProgressMemberTypes.find(FieldsTypeIndex);
+  if (MembersIt != InProgressMemberTypes.end()) {
     model::StructDefinition *Struct = nullptr;
     auto NewDefinition = makeTypeDefinition<model::StructDefinition>();
     if (not WasReferenced) {
@@ -684,7 +696,7 @@ Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
       Struct = &ProcessedTypes[ForwardRef]->toStruct();
     }
 
-    auto &TheFields = InProgressMemberTypes[FieldsTypeIndex];
+    const auto &TheFields = MembersIt->second;
     uint64_t MaxOffset = 0;
 
     for (const auto &Field : TheFields) {
@@ -744,15 +756,17 @@ Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
   }
 
   // Process methods. Create C-like function prototype for it.
-  if (InProgressFunctionMemberTypes.contains(FieldsTypeIndex)) {
-    auto &TheFunctions = InProgressFunctionMemberTypes[FieldsTypeIndex];
-    for (auto &Function : TheFunctions) {
+  auto FunctionsIt = InProgressFunctionMemberTypes.find(FieldsTypeIndex);
+  if (FunctionsIt != InProgressFunctionMemberTypes.end()) {
+    for (auto &Function : FunctionsIt->second) {
       TypeIndex FnTypeIndex = Function.getType();
-      if (InProgressConcreteFunctionMemberTypes.count(FnTypeIndex) == 0)
+      auto MemberFunctionIt = InProgressConcreteFunctionMemberTypes.find(
+        FnTypeIndex);
+      if (MemberFunctionIt == InProgressConcreteFunctionMemberTypes.end())
         continue;
 
       // Get the proper LF_MFUNCTION.
-      auto &MemberFunction = InProgressConcreteFunctionMemberTypes[FnTypeIndex];
+      auto &MemberFunction = MemberFunctionIt->second;
       TypeIndex ReturnTypeIndex = MemberFunction.ReturnType;
       auto ModelReturnType = makeModelTypeForIndex(ReturnTypeIndex);
       if (ModelReturnType.isEmpty()) {
@@ -771,10 +785,10 @@ Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
         Prototype.ReturnType() = std::move(ModelReturnType);
 
       TypeIndex ArgListTyIndex = MemberFunction.getArgumentList();
-      revng_assert(InProgressArgumentsTypes.contains(ArgListTyIndex));
-      auto ArgList = InProgressArgumentsTypes[ArgListTyIndex];
+      auto ArgListIt = InProgressArgumentsTypes.find(ArgListTyIndex);
+      revng_assert(ArgListIt != InProgressArgumentsTypes.end());
 
-      auto Indices = ArgList.getIndices();
+      ArrayRef<TypeIndex> Indices = ArgListIt->second.getIndices();
       uint32_t Size = Indices.size();
 
       // Add `this` pointer as an argument if the method is not marked
@@ -843,11 +857,11 @@ Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
 
   NewEnum.UnderlyingType() = std::move(UnderlyingModelType);
 
-  auto &TheFields = InProgressEnumeratorTypes[FieldsTypeIndex];
-  if (TheFields.empty())
+  auto FieldsIt = InProgressEnumeratorTypes.find(FieldsTypeIndex);
+  if (FieldsIt == InProgressEnumeratorTypes.end() or FieldsIt->second.empty())
     return Error::success();
 
-  for (const auto &Entry : TheFields) {
+  for (const auto &Entry : FieldsIt->second) {
     auto &EnumEntry = NewEnum.Entries()[Entry.getValue().getExtValue()];
     EnumEntry.OriginalName() = Entry.getName().str();
   }
@@ -936,9 +950,11 @@ Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
       Prototype->ReturnType() = std::move(ModelReturnType);
 
     TypeIndex ArgListTyIndex = Proc.getArgumentList();
-    auto ArgumentList = InProgressArgumentsTypes[ArgListTyIndex];
+    ArrayRef<TypeIndex> Indices;
+    auto ArgListIt = InProgressArgumentsTypes.find(ArgListTyIndex);
+    if (ArgListIt != InProgressArgumentsTypes.end())
+      Indices = ArgListIt->second.getIndices();
 
-    auto Indices = ArgumentList.getIndices();
     uint32_t Size = Indices.size();
     for (uint32_t I = 0; I < Size; ++I) {
       TypeIndex ArgumentTypeIndex = Indices[I];
@@ -981,8 +997,8 @@ Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
 Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
                                                UnionRecord &Union) {
   TypeIndex FieldsTypeIndex = Union.getFieldList();
-  auto &TheFields = InProgressMemberTypes[FieldsTypeIndex];
-  if (TheFields.size() == 0) {
+  auto FieldsIt = InProgressMemberTypes.find(FieldsTypeIndex);
+  if (FieldsIt == InProgressMemberTypes.end() or FieldsIt->second.empty()) {
     // Handle an empty union, similar to 0-sized structs.
     // Typedef it to void.
     model::UpcastableType Void = model::PrimitiveType::makeVoid();
@@ -998,7 +1014,7 @@ Error PDBImporterTypeVisitor::visitKnownRecord(CVType &Record,
   NewUnion.OriginalName() = Union.getName().str();
 
   bool GeneratedAtLeastOneField = false;
-  for (const auto &Field : TheFields) {
+  for (const auto &Field : FieldsIt->second) {
     // Create new field.
     auto FieldModelType = makeModelTypeForIndex(Field.getType());
     if (FieldModelType.isEmpty()) {
@@ -4,40 +4,53 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <mutex>
+
+#include "llvm/ADT/StringMap.h"
+
 #include "revng/Model/Binary.h"
 #include "revng/Model/Importer/TypeCopier.h"
 #include "revng/Pipeline/RegisterAnalysis.h"
 #include "revng/Pipes/ModelGlobal.h"
+#include "revng/Support/ParallelMap.h"
 #include "revng/Support/ResourceFinder.h"
 
 namespace revng::pipes {
 
-class WellKnownFunctionKey {
-public:
-  model::Architecture::Values Architecture;
-  model::ABI::Values ABI;
-  std::string Name;
-
-private:
-  auto tie() const { return std::tie(Architecture, ABI, Name); }
-
-public:
-  bool operator<(const WellKnownFunctionKey &Other) const {
-    return tie() < Other.tie();
-  }
-};
-
 class WellKnownModel {
 public:
-  TupleTree<model::Binary> FromModel;
+  TupleTree<model::Binary> &FromModel;
   TypeCopier Copier;
 
 public:
-  WellKnownModel(TupleTree<model::Binary> &&FromModel,
+  WellKnownModel(TupleTree<model::Binary> &FromModel,
                  TupleTree<model::Binary> &DestinationModel) :
-    FromModel(FromModel), Copier(this->FromModel, DestinationModel) {}
+    FromModel(FromModel), Copier(FromModel, DestinationModel) {}
 };
 
+/// \return all the well-known models, parsed only the first time they are
+///         requested in the process
+///
+/// The models are never modified: TypeCopier only reads from them.
+static std::vector<TupleTree<model::Binary>> &getWellKnownModels() {
+  static std::once_flag Once;
+  static std::vector<TupleTree<model::Binary>> Models;
+
+  std::call_once(Once, [] {
+    const char *Directory = "share/revng/well-known-models";
+    std::vector<std::string> Paths = revng::ResourceFinder.list(Directory,
+                                                                ".yml");
+    auto Parse = [](const std::string &Path) {
+      auto MaybeModel = TupleTree<model::Binary>::fromFile(Path);
+      revng_assert(MaybeModel);
+      return std::move(*MaybeModel);
+    };
+    Models = parallelMap(llvm::ArrayRef(Paths), Parse);
+  });
+
+  return Models;
+}
+
 class ImportWellKnownModelsAnalysis {
 public:
   static constexpr auto Name = "import-well-known-models";
@@ -48,43 +61,31 @@ public:
 public:
   llvm::Error run(pipeline::ExecutionContext &Context) {
     std::vector<std::unique_ptr<WellKnownModel>> WellKnownModels;
-    std::map<WellKnownFunctionKey,
-             std::pair<WellKnownModel *, model::Function *>>
+    llvm::StringMap<std::pair<WellKnownModel *, model::Function *>>
       WellKnownFunctions;
     TupleTree<model::Binary> &Model = getWritableModelFromContext(Context);
 
-    // Load all well-known models
-    for (const std::string &Path :
-         revng::ResourceFinder.list("share/revng/well-known-models", ".yml")) {
-      auto MaybeModel = TupleTree<model::Binary>::fromFile(Path);
-      revng_assert(MaybeModel);
+    // Consider only the well-known models matching the architecture and the
+    // ABI of the model, and create an index of their functions by name
+    for (TupleTree<model::Binary> &FromModel : getWellKnownModels()) {
+      if (FromModel->Architecture() != Model->Architecture()
+          or FromModel->DefaultABI() != Model->DefaultABI())
+        continue;
+
       using namespace std;
-      auto NewWKM = make_unique<WellKnownModel>(std::move(*MaybeModel), Model);
-      WellKnownModels.push_back(std::move(NewWKM));
-    }
+      auto NewWKM = make_unique<WellKnownModel>(FromModel, Model);
 
-    // Create an index of well-known functions
-    for (auto &WellKnownModel : WellKnownModels) {
-      auto &Model = WellKnownModel->FromModel;
       // Collect exported functions
-      for (model::Function &F : Model->Functions()) {
-        for (const std::string &ExportedName : F.ExportedNames()) {
-          WellKnownFunctions[{
-            Model->Architecture(), Model->DefaultABI(), ExportedName }] = {
-            WellKnownModel.get(), &F
-          };
-        }
-      }
+      for (model::Function &F : FromModel->Functions())
+        for (const std::string &ExportedName : F.ExportedNames())
+          WellKnownFunctions[ExportedName] = { NewWKM.get(), &F };
+
+      WellKnownModels.push_back(std::move(NewWKM));
     }
 
     for (model::DynamicFunction &F : Model->ImportedDynamicFunctions()) {
-      // Compose the key
-      WellKnownFunctionKey Key = { Model->Architecture(),
-                                   Model->DefaultABI(),
-                                   F.OriginalName() };
-
       // See if it's a well-known function
-      auto It = WellKnownFunctions.find(Key);
+      auto It = WellKnownFunctions.find(F.OriginalName());
       if (It != WellKnownFunctions.end()) {
         model::Function *WellKnownFunction = It->second.second;
 
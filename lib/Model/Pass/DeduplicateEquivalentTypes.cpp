@@ -5,6 +5,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/PostOrderIterator.h"
@@ -14,6 +15,8 @@
 #include "revng/Model/Pass/DeduplicateEquivalentTypes.h"
 #include "revng/Model/Pass/RegisterModelPass.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/ParallelMap.h"
+#include "revng/TupleTree/StructuralHash.h"
 
 using namespace llvm;
 using namespace model;
@@ -40,6 +43,30 @@ static void compareAll(SmallVector<model::TypeDefinition *> &ToTest,
   }
 }
 
+using HashMap = DenseMap<const model::TypeDefinition *, uint64_t>;
+
+/// Split \p ToTest in buckets of types with the same hash, preserving their
+/// order, and run compareAll on each of them.
+///
+/// This is equivalent to running compareAll on the whole of \p ToTest, as long
+/// as types that are not in the same bucket can never be equivalent.
+/// \returns the number of non-equivalent types that have been left
+static size_t compareAllBucketed(ArrayRef<model::TypeDefinition *> ToTest,
+                                 const HashMap &Hashes,
+                                 std::function<Comparator> Compare) {
+  std::map<uint64_t, SmallVector<model::TypeDefinition *>> Buckets;
+  for (model::TypeDefinition *T : ToTest)
+    Buckets[Hashes.lookup(T)].push_back(T);
+
+  size_t Result = 0;
+  for (auto &[Hash, Bucket] : Buckets) {
+    compareAll(Bucket, Compare);
+    Result += Bucket.size();
+  }
+
+  return Result;
+}
+
 class TypeSystemDeduplicator {
 private:
   struct TypeNode {
@@ -56,6 +83,18 @@ private:
   std::map<const model::TypeDefinition *, Node *> TypeToNode;
   std::vector<model::TypeDefinition *> VisitOrder;
 
+  /// The hash of the local part of each type, see localHash
+  HashMap LocalHashes;
+
+  /// A hash of each type and of what it can reach, up to a certain depth. Types
+  /// that deepCompare considers equivalent always have the same StrongHash.
+  HashMap StrongHashes;
+
+  /// Number of times the StrongHashes are refined by mixing in the hashes of
+  /// the successors: each round makes the hashes sensitive to one more level
+  /// of the type graph
+  static constexpr unsigned StrongHashRounds = 4;
+
 private:
   TypeSystemDeduplicator(TupleTree<model::Binary> &Model) {
     for (auto &T : Model->TypeDefinitions())
@@ -66,14 +105,28 @@ public:
   static EquivalenceClasses<model::TypeDefinition *>
   run(TupleTree<model::Binary> &Model) {
     TypeSystemDeduplicator Helper(Model);
+    Helper.computeLocalHashes();
     Helper.computeWeakEquivalenceClasses();
     Helper.createTypeGraph();
+    Helper.computeStrongHashes();
     Helper.computeVisitOrder();
     Helper.computeStrongEquivalenceClasses();
     return std::move(Helper.StrongEquivalence);
   }
 
 private:
+  void computeLocalHashes() {
+    revng_log(Log, "Computing local hashes");
+
+    auto Hashes = parallelMap(ArrayRef(Types),
+                              [](model::TypeDefinition *T) -> uint64_t {
+                                return T->localHash();
+                              });
+
+    for (auto [T, Hash] : zip(Types, Hashes))
+      LocalHashes[T] = Hash;
+  }
+
   void computeWeakEquivalenceClasses() {
     revng_log(Log, "Computing weak equivalence classes");
     LoggerIndent Indent(Log);
@@ -137,10 +190,11 @@ private:
           }
         };
 
-        compareAll(ToTest, Compare);
+        // Only types with the same local hash can be locally equivalent
+        size_t Remaining = compareAllBucketed(ToTest, LocalHashes, Compare);
 
         revng_log(Log,
-                  GroupName << " has " << ToTest.size()
+                  GroupName << " has " << Remaining
                             << " non-weakly equivalent types");
       }
 
@@ -162,6 +216,31 @@ private:
         addEdge(*Type, *EdgeType);
   }
 
+  /// Compute StrongHashes, starting from the local hashes and then, for a
+  /// fixed number of rounds, mixing in the hashes of the successors.
+  ///
+  /// deepCompare only matches pairs of types that are locally equivalent and
+  /// whose successors, in order, are pairwise matched too: by induction on the
+  /// number of rounds, matched types always end up with the same hash.
+  void computeStrongHashes() {
+    revng_log(Log, "Computing strong hashes");
+
+    StrongHashes = LocalHashes;
+    for (unsigned Round = 0; Round < StrongHashRounds; ++Round) {
+      auto Refine = [this](model::TypeDefinition *T) -> uint64_t {
+        using namespace revng::detail;
+        uint64_t Result = LocalHashes.lookup(T);
+        for (Node *Successor : TypeToNode.at(T)->successors())
+          Result = combineHash(Result, StrongHashes.lookup(Successor->T));
+        return Result;
+      };
+      auto Hashes = parallelMap(ArrayRef(Types), Refine);
+
+      for (auto [T, Hash] : zip(Types, Hashes))
+        StrongHashes[T] = Hash;
+    }
+  }
+
   /// Compute a visit order: post order in the leaders of WeakEquivalence
   void computeVisitOrder() {
     revng_log(Log, "Computing visit order");
@@ -216,7 +295,10 @@ private:
         return Result;
       };
 
-      compareAll(ToTest, Compare);
+      // Only types with the same strong hash can be strongly equivalent.
+      // Note: the classes are processed sequentially since, in visit order,
+      // each of them relies on the StrongEquivalence of the previous ones.
+      compareAllBucketed(ToTest, StrongHashes, Compare);
     }
   }
 
@@ -4,11 +4,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <set>
+#include <ranges>
 #include <string>
+#include <vector>
+
+#include "llvm/ADT/StringSet.h"
 
 #include "revng/Model/Pass/PromoteOriginalName.h"
 #include "revng/Model/Pass/RegisterModelPass.h"
+#include "revng/Support/TaskScheduler.h"
 
 using namespace llvm;
 using namespace model;
@@ -20,13 +24,13 @@ static RegisterModelPass R("promote-original-name",
 
 class SymbolPromoter {
 private:
-  std::set<Identifier> GlobalSymbols;
-  std::set<Identifier> TakenLocalSymbols;
+  llvm::StringSet<> GlobalSymbols;
+  llvm::StringSet<> TakenLocalSymbols;
 
 public:
   void dump() const debug_function {
-    for (const Identifier &ID : GlobalSymbols)
-      dbg << ID.str().str() << "\n";
+    for (const auto &Entry : GlobalSymbols)
+      dbg << Entry.getKey().str() << "\n";
   }
 
 public:
@@ -53,33 +57,51 @@ public:
   }
 
   void promoteLocalSymbols(auto &Collection, auto Unwrap) {
-    std::set<Identifier> LocalBucket;
+    llvm::StringSet<> LocalBucket;
     promoteSymbolsImpl(Collection, Unwrap, LocalBucket, GlobalSymbols);
   }
 
 private:
   void promoteSymbolsImpl(auto &Collection,
                           auto Unwrap,
-                          std::set<Identifier> &Namespace,
-                          const std::set<Identifier> &Taken) {
+                          llvm::StringSet<> &Namespace,
+                          const llvm::StringSet<> &Taken) {
+    using EntryPointer = decltype(Unwrap(*Collection.begin()));
+
     // TODO: collapse uint8_t typedefs into the primitive type
+    std::vector<EntryPointer> ToPromote;
+    std::vector<llvm::StringRef> OriginalNames;
     for (auto &Wrapped : Collection) {
       auto *Entry = Unwrap(Wrapped);
       if (Entry->CustomName().empty() and not Entry->OriginalName().empty()) {
         // We have an OriginalName but not CustomName
-        auto Name = Identifier::fromString(Entry->OriginalName());
-
-        while (Taken.contains(Name) or Namespace.contains(Name))
-          Name += "_";
-
-        // Assign name
-        Entry->CustomName() = Name;
-
-        // Record new name as taken in the current namespace
-        auto [_, Inserted] = Namespace.insert(Name);
-        revng_assert(Inserted);
+        ToPromote.push_back(Entry);
+        OriginalNames.push_back(Entry->OriginalName());
       }
     }
+
+    // Sanitizing long (e.g., mangled) names is the expensive part, and each
+    // name is independent from the others
+    std::vector<Identifier> Names(ToPromote.size());
+    auto Indices = std::views::iota(size_t(0), ToPromote.size());
+    revng::parallelForEach(Indices, [&](size_t I) {
+      Names[I] = Identifier::fromString(OriginalNames[I]);
+    });
+
+    // Resolve collisions in the order of the collection, so that the outcome
+    // does not depend on the scheduling
+    for (size_t I = 0; I < ToPromote.size(); ++I) {
+      Identifier &Name = Names[I];
+      while (Taken.contains(Name) or Namespace.contains(Name))
+        Name += "_";
+
+      // Assign name
+      ToPromote[I]->CustomName() = Name;
+
+      // Record new name as taken in the current namespace
+      auto [_, Inserted] = Namespace.insert(Name);
+      revng_assert(Inserted);
+    }
   }
 };
 
@@ -4,13 +4,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
-#include "revng/ADT/GenericGraph.h"
 #include "revng/Model/Filters.h"
 #include "revng/Model/Pass/PurgeUnnamedAndUnreachableTypes.h"
 #include "revng/Model/Pass/RegisterModelPass.h"
 #include "revng/Model/Processing.h"
+#include "revng/Model/TypeDependencyIndex.h"
 
 using namespace llvm;
 
@@ -55,6 +55,12 @@ static RecursiveCoroutine<void> fixConstArrays(model::Type &Type) {
 }
 
 void model::purgeInvalidTypes(TupleTree<model::Binary> &Model) {
+  model::TypeDependencyIndex Index(*Model);
+  purgeInvalidTypes(Model, Index);
+}
+
+void model::purgeInvalidTypes(TupleTree<model::Binary> &Model,
+                              model::TypeDependencyIndex &Index) {
   model::VerifyHelper VH;
 
   // Ensure there are no const arrays, since we explicitly disallow those.
@@ -68,11 +74,14 @@ void model::purgeInvalidTypes(TupleTree<model::Binary> &Model) {
     return !Field.Type()->verify(VH) && MaybeSize.has_value();
   };
   for (auto &&Struct : Model->TypeDefinitions() | model::filter::Struct)
-    Struct.Fields().erase_if(IsFieldInvalid);
+    if (Struct.Fields().erase_if(IsFieldInvalid) != 0)
+      Index.update(Struct);
   for (auto &&Union : Model->TypeDefinitions() | model::filter::Union) {
     size_t ErasedCount = Union.Fields().erase_if(IsFieldInvalid);
 
     if (ErasedCount != 0) {
+      Index.update(Union);
+
       // We have removed some entries, so we need to update their indices.
       //
       // Note: changing the key of an element in a sorted container shouldn't
@@ -91,7 +100,9 @@ void model::purgeInvalidTypes(TupleTree<model::Binary> &Model) {
   auto ToDrop = Model->TypeDefinitions() | std::views::filter(IsTypeInvalid)
                 | std::views::transform([](const auto &T) { return T.get(); })
                 | revng::to<std::set<const model::TypeDefinition *>>();
-  unsigned DroppedCount = dropTypesDependingOnDefinitions(Model, ToDrop);
+  unsigned DroppedCount = dropTypesDependingOnDefinitions(Model,
+                                                          ToDrop,
+                                                          Index);
   revng_log(Log, "Purging " << DroppedCount << " types.");
 }
 
@@ -136,55 +147,124 @@ void model::purgeUnreachableTypes(TupleTree<model::Binary> &Model) {
   purgeTypesImpl(Model, false);
 }
 
-static void model::purgeTypesImpl(TupleTree<model::Binary> &Model,
-                                  bool KeepTypesWithName) {
-  struct NodeData {
-    const model::TypeDefinition *T;
-  };
-  using Node = ForwardNode<NodeData>;
-  using Graph = GenericGraph<Node>;
-
-  Graph TypeGraph;
-  std::map<const model::TypeDefinition *, Node *> TypeToNode;
-
-  llvm::SmallPtrSet<const model::TypeDefinition *, 16> ToKeep;
-
-  // Remember those types we want to preserve.
-  for (const model::UpcastableTypeDefinition &T : Model->TypeDefinitions()) {
-    if (KeepTypesWithName)
-      if (not T->CustomName().empty() or not T->OriginalName().empty())
-        ToKeep.insert(T.get());
-
-    TypeToNode[T.get()] = TypeGraph.addNode(NodeData{ T.get() });
-  }
+static bool isNamed(const model::TypeDefinition &T) {
+  return not T.CustomName().empty() or not T.OriginalName().empty();
+}
 
-  // Create type system edges
-  for (const model::UpcastableTypeDefinition &D : Model->TypeDefinitions())
-    for (const model::Type *Edge : D->edges())
-      if (const model::TypeDefinition *Definition = Edge->skipToDefinition())
-        TypeToNode.at(D.get())->addSuccessor(TypeToNode.at(Definition));
+using DefinitionSet = llvm::SmallPtrSet<const model::TypeDefinition *, 16>;
 
-  // Record references to types *outside* of Model->Types
+/// Collect the definitions referenced from *outside* of Model->Types
+static DefinitionSet
+collectExternalReferences(TupleTree<model::Binary> &Model) {
+  DefinitionSet Result;
   auto VisitBinary = [&](auto &Field) {
     auto Visitor = [&](auto &Element) {
       using type = std::decay_t<decltype(Element)>;
       if constexpr (std::is_same_v<type, DefinitionReference>)
         if (Element.isValid())
-          ToKeep.insert(Element.get());
+          Result.insert(Element.get());
     };
     visitTupleTree(Field, Visitor, [](auto) {});
   };
   visitTupleExcept(VisitBinary, *Model, &Model->TypeDefinitions());
+  return Result;
+}
+
+static void model::purgeTypesImpl(TupleTree<model::Binary> &Model,
+                                  bool KeepTypesWithName) {
+  DefinitionSet ToKeep = collectExternalReferences(Model);
+
+  // Remember those types we want to preserve.
+  if (KeepTypesWithName)
+    for (const model::UpcastableTypeDefinition &T : Model->TypeDefinitions())
+      if (isNamed(*T))
+        ToKeep.insert(T.get());
 
-  // Visit all the nodes reachable from ToKeep
-  df_iterator_default_set<Node *> Visited;
-  for (const model::TypeDefinition *T : ToKeep)
-    for (Node *N : depth_first_ext(TypeToNode.at(T), Visited))
-      ;
+  // Visit all the definitions reachable from ToKeep
+  model::TypeDependencyIndex Index(*Model);
+  llvm::SmallVector<const model::TypeDefinition *, 16> Roots(ToKeep.begin(),
+                                                            ToKeep.end());
+  auto Reachable = Index.transitiveDependencies(Roots);
 
   // Purge the non-visited
   llvm::erase_if(Model->TypeDefinitions(),
                  [&](const model::UpcastableTypeDefinition &P) {
-                   return not Visited.contains(TypeToNode.at(P.get()));
+                   return not Reachable.contains(P.get());
                  });
 }
+
+unsigned
+model::purgeUnreachableCandidates(TupleTree<model::Binary> &Model,
+                                  model::TypeDependencyIndex &Index,
+                                  ArrayRef<const model::TypeDefinition *>
+                                    Candidates,
+                                  bool KeepTypesWithName) {
+  // Only the candidates, and what they depend on, can have become unreachable
+  auto Affected = Index.transitiveDependencies(Candidates);
+
+  // Among the affected types, the roots are those that are used from outside
+  // the type system, those that are named (if we keep them) and those used by
+  // types that are not affected
+  DefinitionSet External = collectExternalReferences(Model);
+  auto IsAffected = [&Affected](const model::TypeDefinition *T) {
+    return Affected.contains(T);
+  };
+  llvm::SmallVector<const model::TypeDefinition *, 16> Roots;
+  for (const model::TypeDefinition *T : Affected) {
+    if (External.contains(T) or (KeepTypesWithName and isNamed(*T))
+        or not llvm::all_of(Index.dependents(*T), IsAffected))
+      Roots.push_back(T);
+  }
+
+  // Affected is closed under dependencies, so is what the roots reach
+  auto Reachable = Index.transitiveDependencies(Roots);
+  std::set<const model::TypeDefinition *> ToErase;
+  for (const model::TypeDefinition *T : Affected)
+    if (not Reachable.contains(T))
+      ToErase.insert(T);
+
+  revng_log(Log,
+            "Purging " << ToErase.size() << " types out of " << Affected.size()
+                       << " affected ones.");
+  if (ToErase.empty())
+    return 0;
+
+  for (const model::TypeDefinition *T : ToErase)
+    Index.erase(*T);
+
+  llvm::erase_if(Model->TypeDefinitions(),
+                 [&](const model::UpcastableTypeDefinition &P) {
+                   return ToErase.contains(P.get());
+                 });
+
+  return ToErase.size();
+}
+
+unsigned
+model::purgeUnreachableCandidates(TupleTree<model::Binary> &Model,
+                                  const std::set<model::TypeDefinition::Key>
+                                    &Candidates,
+                                  bool KeepTypesWithName) {
+  llvm::SmallVector<const model::TypeDefinition *, 16> Definitions;
+  for (const model::TypeDefinition::Key &Key : Candidates) {
+    auto It = Model->TypeDefinitions().find(Key);
+    if (It != Model->TypeDefinitions().end())
+      Definitions.push_back(It->get());
+  }
+
+  if (Definitions.empty())
+    return 0;
+
+  model::TypeDependencyIndex Index(*Model);
+  return purgeUnreachableCandidates(Model,
+                                    Index,
+                                    Definitions,
+                                    KeepTypesWithName);
+}
+
+void model::collectDependencies(const model::TypeDefinition &Definition,
+                                std::set<model::TypeDefinition::Key> &Output) {
+  for (const model::Type *Edge : Definition.edges())
+    if (const model::TypeDefinition *Target = Edge->skipToDefinition())
+      Output.insert(Target->key());
+}
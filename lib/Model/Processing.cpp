@@ -6,10 +6,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include "llvm/ADT/DepthFirstIterator.h"
-
-#include "revng/ADT/GenericGraph.h"
 #include "revng/Model/Processing.h"
+#include "revng/Model/TypeDependencyIndex.h"
 #include "revng/Support/Debug.h"
 
 using namespace llvm;
@@ -27,44 +25,31 @@ void purgeFunctions(T &Functions,
 using DefinitionPointerSet = std::set<const model::TypeDefinition *>;
 unsigned dropTypesDependingOnDefinitions(TupleTree<model::Binary> &Model,
                                          const DefinitionPointerSet &Types) {
+  model::TypeDependencyIndex Index(*Model);
+  return dropTypesDependingOnDefinitions(Model, Types, Index);
+}
+
+unsigned dropTypesDependingOnDefinitions(TupleTree<model::Binary> &Model,
+                                         const DefinitionPointerSet &Types,
+                                         model::TypeDependencyIndex &Index) {
   // TODO: in case we reach a StructField or UnionField, we should drop the
   //       field and not proceed any further
-  struct TypeNode {
-    const model::TypeDefinition *T;
-  };
-
-  using Graph = GenericGraph<ForwardNode<TypeNode>>;
-
-  Graph ReverseDependencyGraph;
 
-  // Create nodes in reverse dependency graph
-  std::map<const model::TypeDefinition *, ForwardNode<TypeNode> *> TypeToNode;
-  for (model::UpcastableTypeDefinition &T : Model->TypeDefinitions())
-    TypeToNode[T.get()] = ReverseDependencyGraph.addNode(TypeNode{ T.get() });
-
-  // Register edges
-  for (model::UpcastableTypeDefinition &T : Model->TypeDefinitions()) {
-    // Ignore dependencies of types we need to drop
-    if (Types.contains(T.get()))
-      continue;
-
-    for (const model::Type *E : T->edges())
-      if (const model::TypeDefinition *Definition = E->skipToDefinition())
-        TypeToNode.at(Definition)->addSuccessor(TypeToNode.at(T.get()));
-  }
-
-  // Prepare for deletion all the nodes reachable from Types
+  // Prepare for deletion all the definitions depending on Types
+  llvm::SmallVector<const model::TypeDefinition *, 16> Roots(Types.begin(),
+                                                            Types.end());
   std::set<const model::TypeDefinition *> ToDelete;
-  for (const model::TypeDefinition *Type : Types) {
-    for (const auto *Node : depth_first(TypeToNode.at(Type))) {
-      ToDelete.insert(Node->T);
-    }
-  }
+  for (const model::TypeDefinition *Type : Index.transitiveDependents(Roots))
+    ToDelete.insert(Type);
 
   // Purge both dynamic and local functions depending on Types
   purgeFunctions(Model->ImportedDynamicFunctions(), ToDelete);
   purgeFunctions(Model->Functions(), ToDelete);
 
+  // Keep the index in sync, while the pointers are still valid
+  for (const model::TypeDefinition *Type : ToDelete)
+    Index.erase(*Type);
+
   // Purge types depending on unresolved Types
   for (auto It = Model->TypeDefinitions().begin();
        It != Model->TypeDefinitions().end();) {
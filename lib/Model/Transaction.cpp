@@ -0,0 +1,55 @@
+/// \file Transaction.cpp
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "revng/Model/Transaction.h"
+#include "revng/Model/VerifyHelper.h"
+
+using namespace llvm;
+
+model::Transaction::Transaction(TupleTree<model::Binary> &Model) :
+  Model(Model), Initial(*Model), Bucket(*Model) {}
+
+Expected<TupleTreeDiff<model::Binary>> model::Transaction::commit() {
+  revng_assert(not Done);
+  Done = true;
+
+  // Definitions might have also been recorded directly in the model, in which
+  // case the bucket must be empty, since its IDs are no longer available
+  if (not Bucket.empty())
+    Bucket.commit();
+
+  if (not Functions.empty()) {
+    auto Inserter = Model->Functions().batch_insert_or_assign();
+    for (model::Function &Function : Functions)
+      Inserter.emplace_or_assign(std::move(Function));
+    Functions.clear();
+  }
+
+  Model.evictCachedReferences();
+
+  TupleTreeDiff<model::Binary> Diff = diff(Initial, *Model);
+  model::VerifyHelper VH;
+  if (not model::verifyChanges(*Model, Diff, VH)) {
+    *Model = std::move(Initial);
+    Model.initializeReferences();
+    return createStringError(inconvertibleErrorCode(),
+                             "The model does not verify after committing the "
+                             "transaction, it has been rolled back");
+  }
+
+  return Diff;
+}
+
+void model::Transaction::abort() {
+  revng_assert(not Done);
+  Done = true;
+
+  Bucket.drop();
+  Functions.clear();
+
+  *Model = std::move(Initial);
+  Model.initializeReferences();
+}
@@ -0,0 +1,143 @@
+/// \file TypeDependencyIndex.cpp
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/STLExtras.h"
+
+#include "revng/Model/TypeDependencyIndex.h"
+
+using namespace llvm;
+
+using Definition = model::TypeDependencyIndex::Definition;
+
+model::TypeDependencyIndex::TypeDependencyIndex(const model::Binary &Binary) {
+  for (const model::UpcastableTypeDefinition &D : Binary.TypeDefinitions())
+    update(*D);
+}
+
+void model::TypeDependencyIndex::update(const model::TypeDefinition &D) {
+  Definitions.insert(&D);
+
+  // Forget the old dependencies
+  auto &Targets = Dependencies[&D];
+  for (Definition Target : Targets) {
+    auto It = Dependents.find(Target);
+    if (It != Dependents.end())
+      It->second.remove(&D);
+  }
+  Targets.clear();
+
+  // Record the new ones, once each
+  for (const model::Type *Edge : D.edges()) {
+    if (const model::TypeDefinition *Target = Edge->skipToDefinition()) {
+      if (not is_contained(Targets, Target)) {
+        Targets.push_back(Target);
+        Dependents[Target].insert(&D);
+      }
+    }
+  }
+}
+
+void model::TypeDependencyIndex::erase(const model::TypeDefinition &D) {
+  if (not Definitions.remove(&D))
+    return;
+
+  auto DependenciesIt = Dependencies.find(&D);
+  if (DependenciesIt != Dependencies.end()) {
+    for (Definition Target : DependenciesIt->second) {
+      auto It = Dependents.find(Target);
+      if (It != Dependents.end())
+        It->second.remove(&D);
+    }
+    Dependencies.erase(DependenciesIt);
+  }
+
+  auto DependentsIt = Dependents.find(&D);
+  if (DependentsIt != Dependents.end()) {
+    for (Definition Source : DependentsIt->second)
+      erase_value(Dependencies[Source], &D);
+    Dependents.erase(DependentsIt);
+  }
+}
+
+ArrayRef<Definition>
+model::TypeDependencyIndex::dependencies(const model::TypeDefinition &D) const {
+  auto It = Dependencies.find(&D);
+  if (It == Dependencies.end())
+    return {};
+  return It->second;
+}
+
+ArrayRef<Definition>
+model::TypeDependencyIndex::dependents(const model::TypeDefinition &D) const {
+  auto It = Dependents.find(&D);
+  if (It == Dependents.end())
+    return {};
+  return It->second.getArrayRef();
+}
+
+template<typename SuccessorsGetter>
+static DenseSet<Definition>
+reachable(ArrayRef<Definition> Roots, SuccessorsGetter &&GetSuccessors) {
+  DenseSet<Definition> Result;
+  SmallVector<Definition, 16> Worklist;
+  for (Definition Root : Roots)
+    if (Result.insert(Root).second)
+      Worklist.push_back(Root);
+
+  while (not Worklist.empty()) {
+    Definition Current = Worklist.pop_back_val();
+    for (Definition Successor : GetSuccessors(*Current))
+      if (Result.insert(Successor).second)
+        Worklist.push_back(Successor);
+  }
+
+  return Result;
+}
+
+DenseSet<Definition> model::TypeDependencyIndex::transitiveDependencies(
+  ArrayRef<Definition> Roots) const {
+  return reachable(Roots, [this](const model::TypeDefinition &D) {
+    return dependencies(D);
+  });
+}
+
+DenseSet<Definition> model::TypeDependencyIndex::transitiveDependents(
+  ArrayRef<Definition> Roots) const {
+  return reachable(Roots, [this](const model::TypeDefinition &D) {
+    return dependents(D);
+  });
+}
+
+std::vector<Definition> model::TypeDependencyIndex::topologicalOrder() const {
+  std::vector<Definition> Result;
+  Result.reserve(Definitions.size());
+
+  // Iterative post-order visit: a definition is emitted once all of its
+  // dependencies have been
+  DenseSet<Definition> Visited;
+  SmallVector<std::pair<Definition, unsigned>, 16> Stack;
+  for (Definition Root : Definitions) {
+    if (not Visited.insert(Root).second)
+      continue;
+
+    Stack.push_back({ Root, 0 });
+    while (not Stack.empty()) {
+      auto &[Current, NextIndex] = Stack.back();
+      ArrayRef<Definition> Targets = dependencies(*Current);
+      if (NextIndex == Targets.size()) {
+        Result.push_back(Current);
+        Stack.pop_back();
+        continue;
+      }
+
+      Definition Target = Targets[NextIndex++];
+      if (Definitions.contains(Target) and Visited.insert(Target).second)
+        Stack.push_back({ Target, 0 });
+    }
+  }
+
+  return Result;
+}
@@ -4,9 +4,17 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <ranges>
+#include <set>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallVector.h"
 
-#include "revng/Model/Binary.h"
+#include "revng/Model/Model.h"
+#include "revng/Support/TaskScheduler.h"
 
 using namespace llvm;
 
@@ -17,17 +25,21 @@ namespace model {
 //
 
 bool VerifyHelper::isGlobalSymbol(const model::Identifier &Name) const {
-  return GlobalSymbols.count(Name) > 0;
+  if (Parent != nullptr)
+    return Parent->isGlobalSymbol(Name);
+
+  return GlobalSymbols.count(Name.str()) > 0;
 }
 
 bool VerifyHelper::registerGlobalSymbol(const model::Identifier &Name,
-                                        const std::string &Path) {
+                                        PathGetter &&GetPath) {
+  revng_assert(Parent == nullptr);
+
   if (Name.empty())
     return true;
 
-  auto It = GlobalSymbols.find(Name);
-  if (It == GlobalSymbols.end()) {
-    GlobalSymbols.insert({ Name, Path });
+  auto [It, New] = GlobalSymbols.try_emplace(Name.str(), std::move(GetPath));
+  if (New) {
     return true;
   } else {
     std::string Message;
@@ -35,12 +47,21 @@ bool VerifyHelper::registerGlobalSymbol(const model::Identifier &Name,
     Message += Name.str().str();
     Message += "\":\n\n";
 
-    Message += "  " + It->second + "\n";
-    Message += "  " + Path + "\n";
+    Message += "  " + It->second() + "\n";
+    Message += "  " + GetPath() + "\n";
     return fail(Message);
   }
 }
 
+void VerifyHelper::join(VerifyHelper &&Forked) {
+  revng_assert(Forked.Parent == this);
+  revng_assert(Forked.InProgress.empty());
+
+  VerifiedCache.merge(Forked.VerifiedCache);
+  SizeCache.merge(Forked.SizeCache);
+  ReasonBuffer += Forked.ReasonBuffer;
+}
+
 template<typename T>
 static std::string key(const T &Object) {
   return getNameFromYAMLScalar(KeyedObjectTraits<T>::key(Object));
@@ -80,31 +101,38 @@ bool model::Binary::verifyGlobalNamespace(VerifyHelper &VH) const {
   //
   // Verify needs to verify that each namespace has no internal clashes.
   // Also, the global namespace clashes with everything.
+  //
+  // Paths are only computed in case of collision.
   for (const Function &F : Functions()) {
-    if (not VH.registerGlobalSymbol(F.CustomName(), path(F)))
+    if (not VH.registerGlobalSymbol(F.CustomName(), [&F] { return path(F); }))
       return VH.fail("Duplicate name", F);
   }
 
   // Verify DynamicFunctions
   for (const DynamicFunction &DF : ImportedDynamicFunctions()) {
-    if (not VH.registerGlobalSymbol(DF.CustomName(), path(DF)))
+    auto Path = [&DF] { return path(DF); };
+    if (not VH.registerGlobalSymbol(DF.CustomName(), Path))
       return VH.fail();
   }
 
   // Verify types and enum entries
   for (const model::UpcastableTypeDefinition &Def : TypeDefinitions()) {
-    if (not VH.registerGlobalSymbol(Def->CustomName(), path(*Def)))
+    const model::TypeDefinition &D = *Def;
+    if (not VH.registerGlobalSymbol(D.CustomName(), [&D] { return path(D); }))
       return VH.fail();
 
-    if (auto *Enum = dyn_cast<model::EnumDefinition>(Def.get()))
-      for (auto &Entry : Enum->Entries())
-        if (not VH.registerGlobalSymbol(Entry.CustomName(), path(*Enum, Entry)))
+    if (auto *Enum = dyn_cast<model::EnumDefinition>(Def.get())) {
+      for (auto &Entry : Enum->Entries()) {
+        auto Path = [Enum, &Entry] { return path(*Enum, Entry); };
+        if (not VH.registerGlobalSymbol(Entry.CustomName(), Path))
           return VH.fail();
+      }
+    }
   }
 
   // Verify Segments
   for (const Segment &S : Segments()) {
-    if (not VH.registerGlobalSymbol(S.CustomName(), path(S)))
+    if (not VH.registerGlobalSymbol(S.CustomName(), [&S] { return path(S); }))
       return VH.fail();
   }
 
@@ -752,40 +780,141 @@ RecursiveCoroutine<bool> TypeDefinition::verify(VerifyHelper &VH) const {
   rc_return VH.maybeFail(Result);
 }
 
-bool Binary::verifyTypeDefinitions(VerifyHelper &VH) const {
-  auto Guard = VH.suspendTracking(*this);
+static bool verifyArchitecture(VerifyHelper &VH,
+                               const model::Binary &Model,
+                               const model::TypeDefinition &Definition) {
+  using CFT = model::CABIFunctionDefinition;
+  using RFT = model::RawFunctionDefinition;
+  if (const auto *T = llvm::dyn_cast<CFT>(&Definition)) {
+    if (getArchitecture(T->ABI()) != Model.Architecture())
+      return VH.fail("Function type architecture differs from the binary "
+                     "architecture");
+  } else if (const auto *T = llvm::dyn_cast<RFT>(&Definition)) {
+    if (T->Architecture() != Model.Architecture())
+      return VH.fail("Function type architecture differs from the binary "
+                     "architecture");
+  }
 
-  std::set<Identifier> Names;
-  for (const model::UpcastableTypeDefinition &Definition : TypeDefinitions()) {
-    // All types on their own should verify
-    if (not Definition.get()->verify(VH))
-      return VH.fail();
+  return true;
+}
 
-    // Ensure the names are unique
+static bool verifyTypeNames(VerifyHelper &VH, const model::Binary &Model) {
+  std::set<Identifier> Names;
+  for (const model::UpcastableTypeDefinition &Definition :
+       Model.TypeDefinitions()) {
     auto Name = Definition->name();
     if (not Names.insert(Name).second)
       return VH.fail(Twine("Multiple types with the following name: ") + Name);
+  }
+
+  return true;
+}
+
+//
+// Parallel verification
+//
+
+/// \returns true if the objects of \p Model can be verified on multiple
+///          threads, i.e., if reading it does not record anything
+static bool canVerifyInParallel(const model::Binary &Model) {
+  if constexpr (model::Binary::HasTracking)
+    return not revng::Tracking::isActive(Model);
+  else
+    return true;
+}
+
+/// Verify each element of \p Range with \p Verify, stopping at the first
+/// failure
+///
+/// If \p Parallel is true, the elements are split in contiguous chunks, each
+/// verified by a task with its own fork of \p VH. The forks are then joined
+/// up to the first one that failed, so that \p VH ends up with the same
+/// reason a serial verification would have given.
+template<typename RangeT, typename CallableT>
+static bool verifyEach(VerifyHelper &VH,
+                       bool Parallel,
+                       const RangeT &Range,
+                       CallableT &&Verify) {
+  size_t Size = Range.size();
+  size_t ChunksCount = std::min<size_t>(Size, 4 * revng::jobs());
+  if (not Parallel or revng::jobs() < 2 or ChunksCount < 2) {
+    for (const auto &Element : Range)
+      if (not Verify(VH, Element))
+        return false;
+    return true;
+  }
 
-    using CFT = model::CABIFunctionDefinition;
-    using RFT = model::RawFunctionDefinition;
-    if (const auto *T = llvm::dyn_cast<CFT>(Definition.get())) {
-      if (getArchitecture(T->ABI()) != Architecture())
-        return VH.fail("Function type architecture differs from the binary "
-                       "architecture");
-    } else if (const auto *T = llvm::dyn_cast<RFT>(Definition.get())) {
-      if (T->Architecture() != Architecture())
-        return VH.fail("Function type architecture differs from the binary "
-                       "architecture");
+  std::vector<VerifyHelper> Forks;
+  Forks.reserve(ChunksCount);
+  for (size_t Chunk = 0; Chunk < ChunksCount; ++Chunk)
+    Forks.push_back(VH.fork());
+
+  // Not a std::vector<bool>, since each task writes its own element
+  std::vector<uint8_t> Verified(ChunksCount, true);
+  auto Begin = Range.begin();
+  auto VerifyChunk = [&](size_t Chunk) {
+    size_t End = (Chunk + 1) * Size / ChunksCount;
+    for (size_t Index = Chunk * Size / ChunksCount; Index < End; ++Index) {
+      if (not Verify(Forks[Chunk], *(Begin + Index))) {
+        Verified[Chunk] = false;
+        return;
+      }
     }
+  };
+  revng::parallelForEach(std::views::iota(size_t(0), ChunksCount),
+                         VerifyChunk);
+
+  for (size_t Chunk = 0; Chunk < ChunksCount; ++Chunk) {
+    VH.join(std::move(Forks[Chunk]));
+    if (not Verified[Chunk])
+      return false;
   }
 
   return true;
 }
 
+bool Binary::verifyTypeDefinitions(VerifyHelper &VH) const {
+  auto Guard = VH.suspendTracking(*this);
+
+  auto VerifyDefinition = [this](VerifyHelper &Helper,
+                                 const UpcastableTypeDefinition &Definition) {
+    // All types on their own should verify
+    if (not Definition.get()->verify(Helper))
+      return Helper.fail();
+
+    if (not verifyArchitecture(Helper, *this, *Definition))
+      return Helper.fail();
+
+    return true;
+  };
+  if (not verifyEach(VH,
+                     canVerifyInParallel(*this),
+                     TypeDefinitions(),
+                     VerifyDefinition))
+    return VH.fail();
+
+  // Ensure the names are unique
+  return verifyTypeNames(VH, *this);
+}
+
 //
 // Binary
 //
 
+static bool verifySegmentsDoNotOverlap(VerifyHelper &VH,
+                                       const model::Binary &Model) {
+  for (const auto &[LHS, RHS] : zip_pairs(Model.Segments())) {
+    revng_assert(LHS.StartAddress() <= RHS.StartAddress());
+    if (LHS.endAddress() > RHS.StartAddress()) {
+      std::string Error = "Overlapping segments:\n" + ::toString(LHS) + "and\n"
+                          + ::toString(RHS);
+      return VH.fail(Error);
+    }
+  }
+
+  return true;
+}
+
 bool Binary::verify(VerifyHelper &VH) const {
   auto Guard = VH.suspendTracking(*this);
 
@@ -794,30 +923,28 @@ bool Binary::verify(VerifyHelper &VH) const {
   if (not verifyGlobalNamespace(VH))
     return VH.fail();
 
+  // The objects are independent of each other: unless we're tracking the
+  // accesses to the model, verify them in parallel
+  bool Parallel = canVerifyInParallel(*this);
+  auto VerifyOne = [](VerifyHelper &Helper, const auto &Object) {
+    return Object.verify(Helper);
+  };
+
   // Verify individual functions
-  for (const Function &F : Functions())
-    if (not F.verify(VH))
-      return VH.fail();
+  if (not verifyEach(VH, Parallel, Functions(), VerifyOne))
+    return VH.fail();
 
   // Verify DynamicFunctions
-  for (const DynamicFunction &DF : ImportedDynamicFunctions())
-    if (not DF.verify(VH))
-      return VH.fail();
+  if (not verifyEach(VH, Parallel, ImportedDynamicFunctions(), VerifyOne))
+    return VH.fail();
 
   // Verify Segments
-  for (const Segment &S : Segments())
-    if (not S.verify(VH))
-      return VH.fail();
+  if (not verifyEach(VH, Parallel, Segments(), VerifyOne))
+    return VH.fail();
 
   // Make sure no segments overlap
-  for (const auto &[LHS, RHS] : zip_pairs(Segments())) {
-    revng_assert(LHS.StartAddress() <= RHS.StartAddress());
-    if (LHS.endAddress() > RHS.StartAddress()) {
-      std::string Error = "Overlapping segments:\n" + ::toString(LHS) + "and\n"
-                          + ::toString(RHS);
-      return VH.fail(Error);
-    }
-  }
+  if (not verifySegmentsDoNotOverlap(VH, *this))
+    return VH.fail();
 
   //
   // Verify the type system
@@ -825,6 +952,310 @@ bool Binary::verify(VerifyHelper &VH) const {
   return verifyTypeDefinitions(VH);
 }
 
+//
+// Incremental verification
+//
+
+/// \returns true if \p T refers to a definition that does not exist
+static bool isDangling(const model::Type &T) {
+  const model::DefinedType *Defined = T.skipToDefinedType();
+  return Defined != nullptr and not Defined->Definition().isValid();
+}
+
+using DefinitionSet = std::set<const model::TypeDefinition *>;
+
+/// \returns true if \p T refers to a definition in \p Definitions or to a
+///          definition that does not exist anymore
+static bool dependsOn(const model::UpcastableType &T,
+                      const DefinitionSet &Definitions) {
+  if (T.isEmpty())
+    return false;
+
+  if (isDangling(*T))
+    return true;
+
+  return Definitions.contains(T->skipToDefinition());
+}
+
+static bool dependsOn(const model::Function &F,
+                      const DefinitionSet &Definitions) {
+  if (dependsOn(F.Prototype(), Definitions)
+      or dependsOn(F.StackFrameType(), Definitions))
+    return true;
+
+  for (const model::CallSitePrototype &CallSite : F.CallSitePrototypes())
+    if (dependsOn(CallSite.Prototype(), Definitions))
+      return true;
+
+  return false;
+}
+
+static bool dependsOn(const model::DynamicFunction &F,
+                      const DefinitionSet &Definitions) {
+  return dependsOn(F.Prototype(), Definitions);
+}
+
+static bool dependsOn(const model::Segment &S,
+                      const DefinitionSet &Definitions) {
+  return dependsOn(S.Type(), Definitions);
+}
+
+using BinaryChange = TupleTreeDiff<model::Binary>::Change;
+
+/// Collect the keys of the entries of the \p Container top-level collection
+/// affected by \p Change.
+///
+/// \returns false if the affected entries could not be determined.
+template<typename ContainerType>
+static bool collectKeys(const ContainerType &,
+                        const BinaryChange &Change,
+                        std::set<typename ContainerType::key_type> &Keys) {
+  using key_type = typename ContainerType::key_type;
+  using value_type = typename ContainerType::value_type;
+  using KOT = KeyedObjectTraits<value_type>;
+
+  const TupleTreePath &Path = Change.Path;
+  if (Path.size() > 1) {
+    // The change is within an entry
+    if (const key_type *Key = Path[1].tryGet<key_type>()) {
+      Keys.insert(*Key);
+      return true;
+    }
+
+    return false;
+  }
+
+  // Addition or removal of an entry of the collection
+  bool Found = false;
+  for (const auto *Entry : { &Change.Old, &Change.New }) {
+    if (not Entry->has_value())
+      continue;
+
+    if (const auto *Element = std::get_if<value_type>(&**Entry)) {
+      Keys.insert(KOT::key(*Element));
+      Found = true;
+    }
+  }
+
+  return Found;
+}
+
+/// Verify the entries of \p Container that are in \p Changed or that depend on
+/// any of the definitions in \p Affected
+///
+/// \param TypesChanged whether any type definition has been changed or
+///        removed, in which case all the entries need to be inspected.
+template<typename ContainerType>
+static bool
+verifyIfAffected(VerifyHelper &VH,
+                 const ContainerType &Container,
+                 const std::set<typename ContainerType::key_type> &Changed,
+                 bool TypesChanged,
+                 const DefinitionSet &Affected) {
+  using value_type = typename ContainerType::value_type;
+  using KOT = KeyedObjectTraits<value_type>;
+
+  if (not TypesChanged) {
+    // Only look at what changed, removed entries are simply not found
+    for (const auto &Key : Changed)
+      if (const value_type *Object = Container.tryGet(Key))
+        if (not Object->verify(VH))
+          return VH.fail();
+
+    return true;
+  }
+
+  for (const value_type &Object : Container)
+    if (Changed.contains(KOT::key(Object)) or dependsOn(Object, Affected))
+      if (not Object.verify(VH))
+        return VH.fail();
+
+  return true;
+}
+
+/// Collect all the type definitions whose verification might be affected by a
+/// change to the definitions in \p ChangedKeys, that is, the changed
+/// definitions themselves and all the definitions referencing them, directly
+/// or indirectly. Definitions referencing removed definitions are included too.
+static DefinitionSet
+affectedDefinitions(const model::Binary &Model,
+                    const std::set<model::TypeDefinition::Key> &ChangedKeys) {
+  DefinitionSet Result;
+  if (ChangedKeys.empty())
+    return Result;
+
+  using KOT = KeyedObjectTraits<model::UpcastableTypeDefinition>;
+  std::map<const model::TypeDefinition *,
+           llvm::SmallVector<const model::TypeDefinition *, 2>>
+    Users;
+  llvm::SmallVector<const model::TypeDefinition *, 16> Worklist;
+
+  for (const model::UpcastableTypeDefinition &Definition :
+       Model.TypeDefinitions()) {
+    const model::TypeDefinition *Current = Definition.get();
+    if (ChangedKeys.contains(KOT::key(Definition)))
+      Worklist.push_back(Current);
+
+    for (const model::Type *Edge : Current->edges()) {
+      if (isDangling(*Edge))
+        Worklist.push_back(Current);
+      else if (const auto *Target = Edge->skipToDefinition())
+        Users[Target].push_back(Current);
+    }
+  }
+
+  while (not Worklist.empty()) {
+    const model::TypeDefinition *Current = Worklist.pop_back_val();
+    if (not Result.insert(Current).second)
+      continue;
+
+    auto It = Users.find(Current);
+    if (It != Users.end())
+      llvm::append_range(Worklist, It->second);
+  }
+
+  return Result;
+}
+
+/// \returns false if \p Change certainly doesn't affect the global namespace,
+///          i.e., it changes a field other than CustomName of an existing
+///          entry of a collection of \p ValueType
+template<typename ValueType>
+static bool mightAffectNamespace(const BinaryChange &Change) {
+  using Fields = typename TupleLikeTraits<ValueType>::Fields;
+
+  const TupleTreePath &Path = Change.Path;
+  if (Path.size() < 3)
+    return true;
+
+  const size_t *Field = Path[2].tryGet<size_t>();
+  return Field == nullptr or static_cast<Fields>(*Field) == Fields::CustomName;
+}
+
+bool verifyChanges(const model::Binary &Model,
+                   const TupleTreeDiff<model::Binary> &Diff,
+                   VerifyHelper &VH) {
+  auto Guard = VH.suspendTracking(Model);
+
+  using Fields = TupleLikeTraits<model::Binary>::Fields;
+
+  std::set<model::Function::Key> ChangedFunctions;
+  std::set<model::DynamicFunction::Key> ChangedDynamicFunctions;
+  std::set<model::Segment::Key> ChangedSegments;
+  std::set<model::TypeDefinition::Key> ChangedTypes;
+  bool FullVerification = false;
+  bool NamespaceChanged = false;
+  bool SegmentsChanged = false;
+
+  for (const BinaryChange &Change : Diff.Changes) {
+    revng_assert(not Change.Path.empty());
+
+    bool Collected = true;
+    switch (static_cast<Fields>(Change.Path[0].get<size_t>())) {
+    case Fields::Functions:
+      Collected = collectKeys(Model.Functions(), Change, ChangedFunctions);
+      NamespaceChanged |= mightAffectNamespace<model::Function>(Change);
+      break;
+
+    case Fields::ImportedDynamicFunctions:
+      Collected = collectKeys(Model.ImportedDynamicFunctions(),
+                              Change,
+                              ChangedDynamicFunctions);
+      NamespaceChanged |= mightAffectNamespace<model::DynamicFunction>(Change);
+      break;
+
+    case Fields::Segments:
+      Collected = collectKeys(Model.Segments(), Change, ChangedSegments);
+      NamespaceChanged |= mightAffectNamespace<model::Segment>(Change);
+      SegmentsChanged = true;
+      break;
+
+    case Fields::TypeDefinitions:
+      Collected = collectKeys(Model.TypeDefinitions(), Change, ChangedTypes);
+      NamespaceChanged = true;
+      break;
+
+    // Fields that are not inspected by Binary::verify
+    case Fields::EntryPoint:
+    case Fields::DefaultABI:
+    case Fields::DefaultPrototype:
+    case Fields::Configuration:
+    case Fields::ExtraCodeAddresses:
+    case Fields::ImportedLibraries:
+      break;
+
+    default:
+      FullVerification = true;
+      break;
+    }
+
+    if (not Collected)
+      FullVerification = true;
+
+    if (FullVerification)
+      break;
+  }
+
+  if (FullVerification) {
+    for (const model::UpcastableTypeDefinition &Definition :
+         Model.TypeDefinitions())
+      VH.invalidate(*Definition);
+    VH.clearGlobalSymbols();
+    return Model.verify(VH);
+  }
+
+  if (NamespaceChanged) {
+    VH.clearGlobalSymbols();
+    if (not Model.verifyGlobalNamespace(VH))
+      return VH.fail();
+  }
+
+  // Forget about all the definitions that might have changed before verifying
+  // any of them, since they might depend on each other
+  DefinitionSet Affected = affectedDefinitions(Model, ChangedTypes);
+  for (const model::TypeDefinition *Definition : Affected)
+    VH.invalidate(*Definition);
+
+  for (const model::TypeDefinition *Definition : Affected) {
+    if (not Definition->verify(VH))
+      return VH.fail();
+
+    if (not verifyArchitecture(VH, Model, *Definition))
+      return VH.fail();
+  }
+
+  bool TypesChanged = not ChangedTypes.empty();
+  if (TypesChanged and not verifyTypeNames(VH, Model))
+    return VH.fail();
+
+  if (not verifyIfAffected(VH,
+                           Model.Functions(),
+                           ChangedFunctions,
+                           TypesChanged,
+                           Affected))
+    return VH.fail();
+
+  if (not verifyIfAffected(VH,
+                           Model.ImportedDynamicFunctions(),
+                           ChangedDynamicFunctions,
+                           TypesChanged,
+                           Affected))
+    return VH.fail();
+
+  if (not verifyIfAffected(VH,
+                           Model.Segments(),
+                           ChangedSegments,
+                           TypesChanged,
+                           Affected))
+    return VH.fail();
+
+  // Make sure no segments overlap
+  if (SegmentsChanged and not verifySegmentsDoNotOverlap(VH, Model))
+    return VH.fail();
+
+  return true;
+}
+
 //
 // And the wrappers
 //
@@ -949,4 +1380,15 @@ bool Binary::verify() const {
   return verify(false);
 }
 
+bool verifyChanges(const model::Binary &Model,
+                   const TupleTreeDiff<model::Binary> &Diff,
+                   bool Assert) {
+  VerifyHelper VH(Assert);
+  return verifyChanges(Model, Diff, VH);
+}
+bool verifyChanges(const model::Binary &Model,
+                   const TupleTreeDiff<model::Binary> &Diff) {
+  return verifyChanges(Model, Diff, false);
+}
+
 } // namespace model
@@ -4,12 +4,19 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <mutex>
+#include <unordered_map>
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/xxhash.h"
+
 #include "revng/ABI/FunctionType/Layout.h"
 #include "revng/Model/Binary.h"
 #include "revng/PTML/Constants.h"
 #include "revng/PTML/Doxygen.h"
 #include "revng/Pipeline/Location.h"
 #include "revng/Pipes/Ranks.h"
+#include "revng/TupleTree/StructuralHash.h"
 
 namespace ptml::tokens {
 
@@ -265,6 +272,13 @@ gatherArgumentComments(const model::Binary &Binary,
 
   llvm::SmallVector<DoxygenLine, 16> Result;
   if (auto *FT = Function.cabiPrototype()) {
+    // The layout is only needed to describe the arguments with a comment
+    auto HasComment = [](const model::Argument &Argument) {
+      return not Argument.Comment().empty();
+    };
+    if (llvm::none_of(FT->Arguments(), HasComment))
+      return {};
+
     abi::FunctionType::Layout Layout(*FT);
     // Using layout here lets us put detailed register/stack information into
     // the comments. Consider that the same comments are used for disassembly
@@ -531,12 +545,12 @@ gatherReturnValueComments(const model::Binary &Binary,
   return Result;
 }
 
-std::string ptml::functionComment(const ::ptml::PTMLBuilder &PTML,
-                                  const model::Function &Function,
-                                  const model::Binary &Binary,
-                                  llvm::StringRef CommentIndicator,
-                                  size_t Indentation,
-                                  size_t WrapAt) {
+static std::string renderFunctionComment(const ::ptml::PTMLBuilder &PTML,
+                                         const model::Function &Function,
+                                         const model::Binary &Binary,
+                                         llvm::StringRef CommentIndicator,
+                                         size_t Indentation,
+                                         size_t WrapAt) {
   llvm::SmallVector<DoxygenLine, 16> Result;
   if (!Function.Comment().empty()) {
     DoxygenToken Tag{ .Type = DoxygenToken::Types::Untagged,
@@ -569,3 +583,121 @@ std::string ptml::functionComment(const ::ptml::PTMLBuilder &PTML,
   CommentBuilder Builder(PTML, CommentIndicator, Indentation, WrapAt);
   return Builder.emit(std::move(Result));
 }
+
+/// \returns the definition \p Type stores by value, if any, skipping arrays
+///
+/// The definitions behind pointers do not affect the layout of the prototype.
+static const model::TypeDefinition *storedDefinition(const model::Type &Type) {
+  const model::Type *Current = &Type;
+  while (auto *Array = llvm::dyn_cast<model::ArrayType>(Current))
+    Current = Array->ElementType().get();
+
+  if (auto *Defined = llvm::dyn_cast<model::DefinedType>(Current))
+    return &Defined->unwrap();
+
+  return nullptr;
+}
+
+/// \returns a hash of everything the comment of \p Function depends on
+///
+/// This includes the prototype and all the definitions it stores by value,
+/// since their sizes determine where each argument goes.
+static uint64_t fingerprint(const ::ptml::PTMLBuilder &PTML,
+                            const model::Function &Function,
+                            const model::Binary &Binary,
+                            llvm::StringRef CommentIndicator,
+                            size_t Indentation,
+                            size_t WrapAt) {
+  using revng::detail::combineHash;
+
+  uint64_t Result = llvm::xxHash64(Function.Entry().toString());
+  Result = combineHash(Result, structuralHash(Function.Comment()));
+  Result = combineHash(Result, structuralHash(Function.Prototype()));
+  Result = combineHash(Result, structuralHash(Binary.Architecture()));
+  Result = combineHash(Result, llvm::xxHash64(CommentIndicator));
+  Result = combineHash(Result, Indentation);
+  Result = combineHash(Result, WrapAt);
+  Result = combineHash(Result, PTML.isGenerateTagLessPTML());
+
+  if (Function.Prototype().isEmpty())
+    return Result;
+
+  llvm::SmallVector<const model::TypeDefinition *, 8> Worklist;
+  llvm::SmallPtrSet<const model::TypeDefinition *, 8> Visited;
+  if (auto *Prototype = storedDefinition(*Function.Prototype()))
+    Worklist.push_back(Prototype);
+
+  while (not Worklist.empty()) {
+    const model::TypeDefinition *Definition = Worklist.pop_back_val();
+    if (not Visited.insert(Definition).second)
+      continue;
+
+    Result = combineHash(Result, structuralHash(*Definition));
+    for (const model::Type *Edge : Definition->edges())
+      if (const model::TypeDefinition *Stored = storedDefinition(*Edge))
+        Worklist.push_back(Stored);
+  }
+
+  return Result;
+}
+
+namespace {
+
+/// The rendered comments, by fingerprint, shared by all the artifacts
+///
+/// A function whose comment inputs did not change, e.g., after an unrelated
+/// edit of the model, gets its comment back without computing the layout of
+/// its prototype or formatting it again.
+class FunctionCommentCache {
+private:
+  static constexpr size_t MaxEntries = 1 << 16;
+
+private:
+  std::mutex Mutex;
+  std::unordered_map<uint64_t, std::string> Entries;
+
+public:
+  template<typename CallableT>
+  std::string get(uint64_t Key, CallableT &&Render) {
+    {
+      std::lock_guard Lock(Mutex);
+      auto It = Entries.find(Key);
+      if (It != Entries.end())
+        return It->second;
+    }
+
+    std::string Result = Render();
+
+    std::lock_guard Lock(Mutex);
+    if (Entries.size() >= MaxEntries)
+      Entries.clear();
+    Entries.try_emplace(Key, Result);
+    return Result;
+  }
+};
+
+} // namespace
+
+static FunctionCommentCache CommentCache;
+
+std::string ptml::functionComment(const ::ptml::PTMLBuilder &PTML,
+                                  const model::Function &Function,
+                                  const model::Binary &Binary,
+                                  llvm::StringRef CommentIndicator,
+                                  size_t Indentation,
+                                  size_t WrapAt) {
+  uint64_t Key = fingerprint(PTML,
+                             Function,
+                             Binary,
+                             CommentIndicator,
+                             Indentation,
+                             WrapAt);
+  return CommentCache.get(Key, [&]() {
+    return renderFunctionComment(PTML,
+                                 Function,
+                                 Binary,
+                                 CommentIndicator,
+                                 Indentation,
+                                 WrapAt);
+  });
+}
@@ -2,6 +2,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstring>
+
 #include "llvm/Support/ErrorHandling.h"
 
 #include "revng/PTML/Constants.h"
@@ -15,38 +17,47 @@ uint64_t PTMLIndentedOstream::current_pos() const {
 }
 
 void PTMLIndentedOstream::write_impl(const char *Ptr, size_t Size) {
-  llvm::StringRef Str(Ptr, Size);
-  llvm::SmallVector<llvm::StringRef> Lines;
-  Str.split(Lines, '\n');
-
-  bool EndsInNewLine = Str.endswith("\n");
-  if (EndsInNewLine)
-    Lines.pop_back();
-
   if (TrailingNewline)
     writeIndent();
 
-  for (auto &Line : llvm::make_range(Lines.begin(), std::prev(Lines.end()))) {
-    OS << Line << '\n';
-    writeIndent();
-  }
+  // Copy whole lines at once, emitting the indentation after each newline but
+  // the last one: it's delayed until the next character is written
+  const char *End = Ptr + Size;
+  while (Ptr != End) {
+    const void *NewLine = std::memchr(Ptr, '\n', End - Ptr);
+    if (NewLine == nullptr) {
+      OS.write(Ptr, End - Ptr);
+      return;
+    }
 
-  OS << Lines.pop_back_val();
-  if (EndsInNewLine)
-    OS << '\n';
+    const char *LineEnd = static_cast<const char *>(NewLine) + 1;
+    OS.write(Ptr, LineEnd - Ptr);
+    Ptr = LineEnd;
 
-  TrailingNewline = EndsInNewLine;
+    if (Ptr == End)
+      TrailingNewline = true;
+    else
+      writeIndent();
+  }
 }
 
 void PTMLIndentedOstream::writeIndent() {
   if (IndentDepth > 0) {
-    Tag IndentTag = B.getTag(tags::Span,
-                             std::string(IndentSize * IndentDepth, ' '));
+    if (Indentations.size() <= static_cast<size_t>(IndentDepth))
+      Indentations.resize(IndentDepth + 1);
+
+    std::string &Indentation = Indentations[IndentDepth];
+    if (Indentation.empty()) {
+      Tag IndentTag = B.getTag(tags::Span,
+                               std::string(IndentSize * IndentDepth, ' '));
+
+      if (not B.isGenerateTagLessPTML())
+        IndentTag.addAttribute(attributes::Token, ptml::tokens::Indentation);
 
-    if (not B.isGenerateTagLessPTML())
-      IndentTag.addAttribute(attributes::Token, ptml::tokens::Indentation);
+      Indentation = IndentTag.toString();
+    }
 
-    OS << IndentTag.toString();
+    OS << Indentation;
   }
   TrailingNewline = false;
 }
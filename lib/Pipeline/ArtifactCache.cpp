@@ -0,0 +1,434 @@
+/// \file ArtifactCache.cpp
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <map>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Pipeline/ArtifactCache.h"
+#include "revng/Pipeline/CLOption.h"
+#include "revng/Pipeline/Global.h"
+#include "revng/Pipeline/PathTargetBimap.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/GzipTarFile.h"
+#include "revng/Support/ResourceFinder.h"
+#include "revng/Support/YAMLTraits.h"
+
+using namespace pipeline;
+
+static Logger<> Log("artifact-cache");
+
+static llvm::cl::opt<std::string> ArtifactCachePath("artifact-cache",
+                                                    llvm::cl::desc("Path or "
+                                                                   "URL of a "
+                                                                   "content-"
+                                                                   "addressed "
+                                                                   "cache of "
+                                                                   "the "
+                                                                   "results of "
+                                                                   "pipes"),
+                                                    llvm::cl::init(""));
+
+static constexpr const char *ReadPathsFilename = "read-paths.yml";
+static constexpr const char *ContainersDirectory = "containers/";
+
+namespace pipeline {
+
+/// The model paths read to produce a target, as stored in a cache entry
+struct CachedReadPaths {
+  std::string Global;
+  std::string Container;
+  std::string Target;
+  std::vector<std::string> Paths;
+};
+
+} // namespace pipeline
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(pipeline::CachedReadPaths);
+
+template<>
+struct llvm::yaml::MappingTraits<pipeline::CachedReadPaths> {
+  static void mapping(IO &IO, pipeline::CachedReadPaths &Entry) {
+    IO.mapRequired("Global", Entry.Global);
+    IO.mapRequired("Container", Entry.Container);
+    IO.mapRequired("Target", Entry.Target);
+    IO.mapRequired("Paths", Entry.Paths);
+  }
+};
+
+namespace {
+
+/// A raw_ostream feeding everything written to it to a SHA1 hasher, so that
+/// large containers can be hashed without materializing their serialization
+class HashingOStream : public llvm::raw_ostream {
+private:
+  llvm::SHA1 &Hasher;
+  uint64_t Position = 0;
+
+public:
+  explicit HashingOStream(llvm::SHA1 &Hasher) : Hasher(Hasher) {}
+  ~HashingOStream() override { flush(); }
+
+private:
+  void write_impl(const char *Pointer, size_t Size) override {
+    Hasher.update(llvm::StringRef(Pointer, Size));
+    Position += Size;
+  }
+
+  uint64_t current_pos() const override { return Position; }
+};
+
+} // namespace
+
+static std::string entryName(llvm::StringRef Key) {
+  return Key.str() + ".tar.gz";
+}
+
+static std::string dataEntryName(llvm::StringRef Key) {
+  return Key.str() + ".bin";
+}
+
+static void hashOptions(llvm::raw_ostream &OS, const PipeWrapper &Pipe) {
+  std::string PipeName = Pipe.Pipe->getName();
+  std::vector<std::string> Names = Pipe.Pipe->getOptionsNames();
+  std::vector<std::string> Types = Pipe.Pipe->getOptionsTypes();
+  for (const auto &[Name, Type] : llvm::zip(Names, Types)) {
+    std::string FullName = PipeName + "-" + Name;
+    OS << FullName << "=";
+
+    if (Type == "string") {
+      OS << CLOptionBase::getOption<std::string>(FullName).get();
+
+      // Options can also be provided through a file
+      auto &PathOption = CLOptionBase::getOption<std::string>(FullName
+                                                              + "-path");
+      if (not PathOption.get().empty()) {
+        auto MaybeBuffer = llvm::MemoryBuffer::getFile(PathOption.get());
+        revng_assert(MaybeBuffer);
+        OS << MaybeBuffer->get()->getBuffer();
+      }
+    } else if (Type == "int") {
+      OS << CLOptionBase::getOption<int>(FullName).get();
+    } else if (Type == "uint64_t") {
+      OS << CLOptionBase::getOption<uint64_t>(FullName).get();
+    } else {
+      revng_abort("Unexpected option type");
+    }
+
+    OS << "\n";
+  }
+}
+
+ArtifactCache *ArtifactCache::get() {
+  static std::unique_ptr<ArtifactCache> Cache;
+  static bool Initialized = false;
+
+  if (not Initialized) {
+    Initialized = true;
+
+    if (not ArtifactCachePath.empty()) {
+      auto MaybeClient = revng::StorageClient::fromPathOrURL(ArtifactCachePath);
+      if (not MaybeClient) {
+        revng_log(Log,
+                  "Cannot open the artifact cache: "
+                    << llvm::toString(MaybeClient.takeError()));
+      } else {
+        Cache = std::make_unique<ArtifactCache>(std::move(MaybeClient.get()));
+      }
+    }
+  }
+
+  return Cache.get();
+}
+
+std::optional<std::string>
+ArtifactCache::computeKey(const Context &Context,
+                          const PipeWrapper &Pipe,
+                          const ContainerSet &Input,
+                          const ContainerToTargetsMap &Requested) {
+  llvm::SHA1 Hasher;
+
+  {
+    HashingOStream OS(Hasher);
+
+    // The version of the components, the implementation of pipes might change
+    OS << revng::getComponentsHash() << "\n";
+
+    // The pipe and its configuration
+    std::stringstream PipeDescription;
+    Pipe.Pipe->dump(PipeDescription, 0);
+    OS << PipeDescription.str() << "\n";
+    hashOptions(OS, Pipe);
+
+    // What we've been asked to produce
+    // Note: sort the containers, StringMap does not guarantee a stable order
+    std::vector<llvm::StringRef> ContainerNames;
+    for (const auto &Pair : Requested)
+      ContainerNames.push_back(Pair.first());
+    llvm::sort(ContainerNames);
+    for (llvm::StringRef ContainerName : ContainerNames) {
+      OS << ContainerName << ":\n";
+      for (const Target &Target : Requested.at(ContainerName))
+        OS << Target.toString() << "\n";
+    }
+
+    // The containers the pipe runs on
+    for (const std::string &ContainerName :
+         Pipe.Pipe->getRunningContainersNames()) {
+      OS << ContainerName << "\n";
+      if (not Input.contains(ContainerName))
+        continue;
+
+      if (llvm::Error Error = Input.at(ContainerName).serialize(OS)) {
+        revng_log(Log,
+                  "Cannot serialize " << ContainerName << ": "
+                                      << llvm::toString(std::move(Error)));
+        return std::nullopt;
+      }
+      OS << "\n";
+    }
+
+    // All the globals, since we cannot know in advance what the pipe will read
+    for (const Global *TheGlobal : Context.getGlobals()) {
+      OS << TheGlobal->getName() << "\n";
+      if (llvm::Error Error = TheGlobal->serialize(OS)) {
+        revng_log(Log,
+                  "Cannot serialize " << TheGlobal->getName() << ": "
+                                      << llvm::toString(std::move(Error)));
+        return std::nullopt;
+      }
+      OS << "\n";
+    }
+  }
+
+  return llvm::toHex(Hasher.final(), true);
+}
+
+llvm::Expected<bool> ArtifactCache::restore(llvm::StringRef Key,
+                                            const Context &Context,
+                                            PipeWrapper &Pipe,
+                                            ContainerSet &Input) {
+  revng::FilePath Entry = Root.getFile(entryName(Key));
+
+  auto MaybeExists = Entry.exists();
+  if (not MaybeExists)
+    return MaybeExists.takeError();
+
+  if (not *MaybeExists) {
+    revng_log(Log, "Miss for " << Pipe.Pipe->getName() << ": " << Key);
+    return false;
+  }
+
+  auto MaybeFile = Entry.getReadableFile();
+  if (not MaybeFile)
+    return MaybeFile.takeError();
+
+  std::vector<CachedReadPaths> ReadPaths;
+  llvm::StringMap<llvm::SmallVector<char>> Contents;
+  // Entries are decompressed in parallel, unless the archive does not have
+  // the layout produced by GzipTarWriter
+  const llvm::MemoryBuffer &Buffer = MaybeFile.get()->buffer();
+  std::vector<revng::ArchiveEntry> ArchiveEntries;
+  if (auto MaybeIndex = revng::GzipTarIndex::create(Buffer)) {
+    ArchiveEntries = MaybeIndex->readAll();
+  } else {
+    llvm::consumeError(MaybeIndex.takeError());
+    revng::GzipTarReader Reader(Buffer);
+    for (revng::ArchiveEntry &ArchiveEntry : Reader.entries())
+      ArchiveEntries.push_back(std::move(ArchiveEntry));
+  }
+
+  for (revng::ArchiveEntry &ArchiveEntry : ArchiveEntries) {
+    llvm::StringRef Filename = ArchiveEntry.Filename;
+    if (Filename == ReadPathsFilename) {
+      llvm::StringRef YAML(ArchiveEntry.Data.data(), ArchiveEntry.Data.size());
+      auto MaybeReadPaths = ::fromString<std::vector<CachedReadPaths>>(YAML);
+      if (not MaybeReadPaths)
+        return MaybeReadPaths.takeError();
+      ReadPaths = std::move(*MaybeReadPaths);
+    } else if (Filename.consume_front(ContainersDirectory)) {
+      Contents[Filename] = std::move(ArchiveEntry.Data);
+    }
+  }
+
+  // Parse the invalidation metadata before touching any container, so that we
+  // do not restore an entry partially
+  using ParsedEntry = std::pair<std::string,
+                                std::pair<TargetInContainer, TupleTreePath>>;
+  std::vector<ParsedEntry> ParsedReadPaths;
+  for (const CachedReadPaths &Entry : ReadPaths) {
+    auto MaybeGlobal = Context.getGlobals().get(Entry.Global);
+    if (not MaybeGlobal)
+      return MaybeGlobal.takeError();
+
+    TargetsList Targets;
+    if (llvm::Error Error = parseTarget(Context,
+                                        Entry.Target,
+                                        Context.getKindsRegistry(),
+                                        Targets))
+      return std::move(Error);
+
+    for (const std::string &SerializedPath : Entry.Paths) {
+      std::optional<TupleTreePath>
+        MaybePath = (*MaybeGlobal)->deserializePath(SerializedPath);
+      if (not MaybePath)
+        return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                       "could not parse " + SerializedPath);
+
+      for (const Target &Target : Targets) {
+        TargetInContainer ToInsert(Target, Entry.Container);
+        ParsedReadPaths.emplace_back(Entry.Global,
+                                     std::pair{ ToInsert, *MaybePath });
+      }
+    }
+  }
+
+  for (const std::string &ContainerName :
+       Pipe.Pipe->getRunningContainersNames()) {
+    auto It = Contents.find(ContainerName);
+    if (It == Contents.end())
+      continue;
+
+    llvm::StringRef Data(It->second.data(), It->second.size());
+    auto Buffer = llvm::MemoryBuffer::getMemBuffer(Data, ContainerName, false);
+    ContainerBase &Container = Input[ContainerName];
+    Container.clear();
+    if (llvm::Error Error = Container.deserialize(*Buffer))
+      return std::move(Error);
+  }
+
+  for (auto &[GlobalName, Entry] : ParsedReadPaths) {
+    auto &[Target, Path] = Entry;
+    Pipe.InvalidationMetadata.getPathCache(GlobalName).insert(Target, Path);
+  }
+
+  revng_log(Log, "Hit for " << Pipe.Pipe->getName() << ": " << Key);
+  return true;
+}
+
+llvm::Error ArtifactCache::store(llvm::StringRef Key,
+                                 const Context &Context,
+                                 const PipeWrapper &Pipe,
+                                 const ContainerSet &Output,
+                                 const ContainerToTargetsMap &Requested) {
+  // Collect the paths read by the targets we have just produced
+  std::vector<CachedReadPaths> ReadPaths;
+  for (const auto &Pair : Pipe.InvalidationMetadata.getPathCache()) {
+    llvm::StringRef GlobalName = Pair.first();
+    auto MaybeGlobal = Context.getGlobals().get(GlobalName);
+    if (not MaybeGlobal)
+      return MaybeGlobal.takeError();
+
+    std::map<std::pair<std::string, std::string>, std::vector<std::string>>
+      Collected;
+    for (const auto &[Path, Targets] : Pair.second) {
+      for (const TargetInContainer &Target : Targets) {
+        auto It = Requested.find(Target.getContainerName());
+        if (It == Requested.end() or not It->second.contains(Target.getTarget()))
+          continue;
+
+        std::optional<std::string>
+          SerializedPath = (*MaybeGlobal)->serializePath(Path);
+        revng_check(SerializedPath.has_value());
+
+        auto CollectedKey = std::pair{ Target.getContainerName().str(),
+                                       Target.getTarget().toString() };
+        Collected[CollectedKey].push_back(*SerializedPath);
+      }
+    }
+
+    for (auto &[ContainerAndTarget, Paths] : Collected) {
+      ReadPaths.push_back({ GlobalName.str(),
+                            ContainerAndTarget.first,
+                            ContainerAndTarget.second,
+                            std::move(Paths) });
+    }
+  }
+
+  revng::FilePath Entry = Root.getFile(entryName(Key));
+  auto MaybeFile = Entry.getWritableFile(revng::ContentEncoding::Gzip);
+  if (not MaybeFile)
+    return MaybeFile.takeError();
+
+  {
+    revng::GzipTarWriter Writer(MaybeFile.get()->os());
+
+    for (const std::string &ContainerName :
+         Pipe.Pipe->getRunningContainersNames()) {
+      if (not Output.contains(ContainerName))
+        continue;
+
+      std::string Buffer;
+      llvm::raw_string_ostream Stream(Buffer);
+      if (llvm::Error Error = Output.at(ContainerName).serialize(Stream))
+        return Error;
+      Stream.flush();
+
+      Writer.append(ContainersDirectory + ContainerName,
+                    { Buffer.data(), Buffer.size() });
+    }
+
+    std::string Buffer;
+    llvm::raw_string_ostream Stream(Buffer);
+    ::serialize(Stream, ReadPaths);
+    Stream.flush();
+    Writer.append(ReadPathsFilename, { Buffer.data(), Buffer.size() });
+
+    Writer.close();
+  }
+
+  if (llvm::Error Error = MaybeFile.get()->commit())
+    return Error;
+
+  revng_log(Log, "Stored " << Pipe.Pipe->getName() << ": " << Key);
+  return Client->commit();
+}
+
+llvm::Expected<std::optional<std::string>>
+ArtifactCache::loadData(llvm::StringRef Key) {
+  revng::FilePath Entry = Root.getFile(dataEntryName(Key));
+
+  auto MaybeExists = Entry.exists();
+  if (not MaybeExists)
+    return MaybeExists.takeError();
+
+  if (not *MaybeExists) {
+    revng_log(Log, "Miss: " << Key);
+    return std::nullopt;
+  }
+
+  auto MaybeFile = Entry.getReadableFile();
+  if (not MaybeFile)
+    return MaybeFile.takeError();
+
+  revng_log(Log, "Hit: " << Key);
+  return MaybeFile.get()->buffer().getBuffer().str();
+}
+
+llvm::Error ArtifactCache::storeData(llvm::StringRef Key,
+                                     llvm::StringRef Data) {
+  revng::FilePath Entry = Root.getFile(dataEntryName(Key));
+  auto MaybeFile = Entry.getWritableFile();
+  if (not MaybeFile)
+    return MaybeFile.takeError();
+
+  MaybeFile.get()->os() << Data;
+  if (llvm::Error Error = MaybeFile.get()->commit())
+    return Error;
+
+  revng_log(Log, "Stored: " << Key);
+  return Client->commit();
+}
@@ -5,6 +5,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
@@ -18,6 +22,7 @@ using namespace std;
 
 ContainerSet ContainerSet::cloneFiltered(const ContainerToTargetsMap &Targets) {
   ContainerSet ToReturn;
+  const ContainerSet &AsConst = *this;
   for (const auto &Pair : Content) {
     const auto &ContainerName = Pair.first();
     const auto &Container = Pair.second;
@@ -26,9 +31,13 @@ ContainerSet ContainerSet::cloneFiltered(const ContainerToTargetsMap &Targets) {
                             Targets.at(ContainerName) :
                             TargetsList();
 
-    auto Cloned = Container != nullptr ?
-                    Container->cloneFiltered(ExtractedNames) :
-                    nullptr;
+    // Don't deserialize a pending container if nothing is requested from it.
+    // Cloning only reads the container: if it's shared, it stays shared.
+    std::unique_ptr<ContainerBase> Cloned;
+    if (Pending.count(ContainerName) != 0 and ExtractedNames.empty())
+      Cloned = (*Factories[ContainerName])(ContainerName);
+    else if (contains(ContainerName))
+      Cloned = AsConst.at(ContainerName).cloneFiltered(ExtractedNames);
 
     ToReturn.add(ContainerName, *Factories[Pair.first()], std::move(Cloned));
   }
@@ -37,8 +46,9 @@ ContainerSet ContainerSet::cloneFiltered(const ContainerToTargetsMap &Targets) {
 }
 
 bool ContainerSet::contains(const Target &Target) const {
-  return llvm::any_of(Content, [&Target](const auto &Container) {
-    return Container.second->enumerate().contains(Target);
+  return llvm::any_of(Content, [this, &Target](const auto &Container) {
+    return contains(Container.first())
+           and enumerate(Container.first()).contains(Target);
   });
 }
 
@@ -58,6 +68,37 @@ Error ContainerSet::remove(const ContainerToTargetsMap &ToRemove) {
   return Error::success();
 }
 
+void ContainerSet::shareFrom(const ContainerSet &Other) {
+  Other.materializeAll();
+
+  Pending.clear();
+  Stored.clear();
+  for (const auto &Entry : Other.Factories)
+    Factories.try_emplace(Entry.first(), Entry.second);
+
+  // Assign the existing entries, rather than replacing the map, since users
+  // might be holding pointers to them
+  for (auto &Entry : Content)
+    Entry.second = nullptr;
+  for (const auto &Entry : Other.Content)
+    Content[Entry.first()] = Entry.second;
+}
+
+void ContainerSet::unshare(llvm::StringRef Name) {
+  auto It = Content.find(Name);
+  if (It == Content.end() or It->second.use_count() <= 1)
+    return;
+
+  // Someone else is still using this container, make a copy of our own
+  std::shared_ptr<ContainerBase> &Container = It->second;
+  Container = Container->cloneFiltered(Container->enumerate());
+}
+
+void ContainerSet::unshareAll() {
+  for (auto &Entry : Content)
+    unshare(Entry.first());
+}
+
 void ContainerSet::intersect(ContainerToTargetsMap &ToIntersect) const {
   for (auto &ContainerStatus : ToIntersect) {
     const auto &ContainerName = ContainerStatus.first();
@@ -68,8 +109,7 @@ void ContainerSet::intersect(ContainerToTargetsMap &ToIntersect) const {
       continue;
     }
 
-    const auto &Container = at(ContainerName);
-    auto Enumerated = Container.enumerate();
+    auto Enumerated = enumerate(ContainerName);
     erase_if(Names, [&Enumerated](const Target &Target) {
       return not Enumerated.contains(Target);
     });
@@ -79,34 +119,140 @@ void ContainerSet::intersect(ContainerToTargetsMap &ToIntersect) const {
 llvm::Error ContainerSet::store(const revng::DirectoryPath &Directory) const {
   for (const auto &Pair : Content) {
     revng::FilePath Filename = Directory.getFile(Pair.first());
+
+    // Skip the containers which are unchanged since they have been loaded
+    // from, or stored to, there. This includes all the pending containers.
+    if (isStored(Pair.first(), Directory))
+      continue;
+
+    materialize(Pair.first());
     const auto &Container = Pair.second;
     if (Container == nullptr)
       continue;
 
     if (auto Error = Container->store(Filename); !!Error)
       return Error;
+
+    Stored.insert_or_assign(Pair.first(), Filename);
   }
   return Error::success();
 }
 
+/// \returns the names of the containers in \p Content which have been stored in
+///          \p Directory, querying the storage for all of them at once
+template<typename MapType>
+static llvm::Expected<llvm::StringSet<>>
+storedContainers(const MapType &Content,
+                 const revng::DirectoryPath &Directory) {
+  std::vector<std::string> Names;
+  for (const auto &Pair : Content)
+    Names.push_back(Pair.first().str());
+
+  auto MaybeExist = Directory.filesExist(Names);
+  if (not MaybeExist)
+    return MaybeExist.takeError();
+
+  llvm::StringSet<> Result;
+  for (const auto &[Name, Exists] : llvm::zip(Names, *MaybeExist))
+    if (Exists)
+      Result.insert(Name);
+  return Result;
+}
+
 llvm::Error ContainerSet::load(const revng::DirectoryPath &Directory) {
+  Pending.clear();
+  Stored.clear();
+  auto MaybeStored = storedContainers(Content, Directory);
+  if (not MaybeStored)
+    return MaybeStored.takeError();
+
   for (auto &Pair : Content) {
     revng::FilePath Filename = Directory.getFile(Pair.first());
-    auto MaybeExists = Filename.exists();
-    if (!MaybeExists)
-      return MaybeExists.takeError();
+    // Don't copy a shared container just to overwrite it
+    if (isShared(Pair.first()))
+      Pair.second = nullptr;
 
-    if (not MaybeExists.get()) {
+    if (not MaybeStored->contains(Pair.first())) {
       Pair.second = nullptr;
       continue;
     }
 
     if (auto Error = (*this)[Pair.first()].load(Filename); !!Error)
       return Error;
+
+    Stored.insert_or_assign(Pair.first(), Filename);
   }
   return Error::success();
 }
 
+llvm::Error ContainerSet::loadLazily(const revng::DirectoryPath &Directory,
+                                     TargetsReader Read) {
+  Pending.clear();
+  Stored.clear();
+  auto MaybeStored = storedContainers(Content, Directory);
+  if (not MaybeStored)
+    return MaybeStored.takeError();
+
+  for (auto &Pair : Content) {
+    revng::FilePath Filename = Directory.getFile(Pair.first());
+    Pair.second = nullptr;
+    if (not MaybeStored->contains(Pair.first()))
+      continue;
+
+    auto MaybeTargets = Read(Pair.first());
+    if (not MaybeTargets)
+      return MaybeTargets.takeError();
+
+    if (MaybeTargets->has_value()) {
+      Pending.try_emplace(Pair.first(),
+                          PendingContainer{ Filename,
+                                            std::move(**MaybeTargets) });
+    } else if (auto Error = (*this)[Pair.first()].load(Filename); !!Error) {
+      return Error;
+    }
+
+    Stored.insert_or_assign(Pair.first(), Filename);
+  }
+  return Error::success();
+}
+
+/// The clock of the accesses to the containers, see ContainerSet::LastAccess
+///
+/// Different sets can be accessed concurrently, e.g., by different steps.
+static std::atomic<uint64_t> AccessClock = 0;
+
+void ContainerSet::materialize(llvm::StringRef Name) const {
+  LastAccess[Name] = ++AccessClock;
+
+  auto It = Pending.find(Name);
+  if (It == Pending.end())
+    return;
+
+  auto Container = (*Factories.find(Name)->second)(Name);
+  if (auto Error = Container->load(It->second.Path)) {
+    std::string Message = "Cannot load container " + Name.str() + ": "
+                          + toString(std::move(Error));
+    revng_abort(Message.c_str());
+  }
+
+  Content[Name] = std::move(Container);
+  Pending.erase(It);
+}
+
+void ContainerSet::evict(llvm::StringRef Name) const {
+  revng_assert(isEvictable(Name));
+  auto &Container = Content.find(Name)->second;
+  Pending.try_emplace(Name,
+                      PendingContainer{ Stored.find(Name)->second,
+                                        Container->enumerate() });
+  Container.reset();
+}
+
+void ContainerSet::materializeAll() const {
+  while (not Pending.empty())
+    materialize(Pending.begin()->first());
+}
+
 std::vector<revng::FilePath>
 ContainerSet::getWrittenFiles(const revng::DirectoryPath &Directory) const {
   std::vector<revng::FilePath> Result;
@@ -120,6 +266,7 @@ ContainerSet::getWrittenFiles(const revng::DirectoryPath &Directory) const {
 }
 
 llvm::Error ContainerSet::verify() const {
+  // Pending containers are not checked, they have not changed since stored
   for (const auto &Pair : Content) {
     if (Pair.second == nullptr)
       continue;
@@ -133,16 +280,22 @@ llvm::Error ContainerSet::verify() const {
 ContainerToTargetsMap ContainerSet::enumerate() const {
   ContainerToTargetsMap Status;
 
-  for (const auto &Pair : *this) {
+  for (const auto &Pair : Content) {
     const auto &Name = Pair.first();
-    const auto &MaybeCont = Pair.second;
-
-    if (MaybeCont != nullptr)
-      Status[Name] = MaybeCont->enumerate();
+    if (contains(Name))
+      Status[Name] = enumerate(Name);
   }
   return Status;
 }
 
+TargetsList ContainerSet::enumerate(llvm::StringRef Name) const {
+  revng_assert(contains(Name));
+  if (auto It = Pending.find(Name); It != Pending.end())
+    return It->second.Targets;
+
+  return Content.find(Name)->second->enumerate();
+}
+
 llvm::Error ContainerBase::store(const revng::FilePath &Path) const {
   auto MaybeWritableFile = Path.getWritableFile();
   if (not MaybeWritableFile) {
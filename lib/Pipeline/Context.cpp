@@ -9,6 +9,7 @@
 #include <cstdlib>
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
 
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipeline/Context.h"
@@ -18,9 +19,48 @@ using namespace pipeline;
 Logger<> pipeline::ExplanationLogger("pipeline");
 Logger<> pipeline::CommandLogger("commands");
 
+using namespace llvm::cl;
+
+static opt<bool> DisableReadTracking("disable-read-tracking",
+                                     desc("Do not track which parts of the "
+                                          "globals are read by pipes. This "
+                                          "speeds up one-shot runs, but "
+                                          "targets will not be invalidated "
+                                          "when globals change."),
+                                     init(false));
+
 Context::Context() : TheKindRegistry(Registry::registerAllKinds()) {
 }
 
+bool Context::isTrackingReads() const {
+  return ReadTracking and not DisableReadTracking;
+}
+
+void Context::collectReadFields(const TargetInContainer &Target,
+                                llvm::StringMap<PathTargetBimap> &Out) const {
+  if (not isTrackingReads())
+    return;
+  Globals.collectReadFields(Target, Out);
+}
+
+void Context::clearAndResume() const {
+  if (not isTrackingReads())
+    return;
+  Globals.clearAndResume();
+}
+
+void Context::pushReadFields() const {
+  if (not isTrackingReads())
+    return;
+  Globals.pushReadFields();
+}
+
+void Context::popReadFields() const {
+  if (not isTrackingReads())
+    return;
+  Globals.popReadFields();
+}
+
 llvm::Error Context::store(const revng::DirectoryPath &Path) const {
   if (auto Error = Globals.store(Path))
     return Error;
@@ -42,6 +42,16 @@ std::error_code UnknownTargetError::convertToErrorCode() const {
   return inconvertibleErrorCode();
 }
 
+char CancelledError::ID;
+
+void CancelledError::log(raw_ostream &OS) const {
+  OS << "The production has been cancelled";
+}
+
+std::error_code CancelledError::convertToErrorCode() const {
+  return inconvertibleErrorCode();
+}
+
 char AnnotatedError::ID;
 
 void AnnotatedError::log(raw_ostream &OS) const {
@@ -0,0 +1,196 @@
+/// \file ExecutionTrace.cpp
+/// Implementation of the Chrome trace-event recorder of pipe executions.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <sys/resource.h>
+
+#include <memory>
+
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Pipeline/ExecutionTrace.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/ModuleStatistics.h"
+
+using namespace pipeline;
+
+static llvm::cl::opt<std::string> TracePath("pipeline-trace",
+                                            llvm::cl::desc("Record the cost "
+                                                           "of each pipe "
+                                                           "invocation in "
+                                                           "this file, in "
+                                                           "the Chrome "
+                                                           "trace-event "
+                                                           "format"),
+                                            llvm::cl::init(""));
+
+namespace {
+
+/// A raw_ostream that only counts the bytes written to it
+class CountingOStream : public llvm::raw_ostream {
+private:
+  uint64_t Size = 0;
+
+public:
+  CountingOStream() { SetUnbuffered(); }
+
+  uint64_t size() const { return Size; }
+
+private:
+  void write_impl(const char *, size_t Count) override { Size += Count; }
+  uint64_t current_pos() const override { return Size; }
+};
+
+struct ResourceUsage {
+  uint64_t CPUTime = 0;
+  int64_t PeakRSS = 0;
+};
+
+} // namespace
+
+static ResourceUsage getResourceUsage() {
+  struct rusage Usage;
+  revng_check(getrusage(RUSAGE_SELF, &Usage) == 0);
+
+  auto ToMicroseconds = [](const struct timeval &Time) -> uint64_t {
+    return Time.tv_sec * 1000000 + Time.tv_usec;
+  };
+
+  // ru_maxrss is in kilobytes on Linux
+  return { ToMicroseconds(Usage.ru_utime) + ToMicroseconds(Usage.ru_stime),
+           Usage.ru_maxrss * 1024 };
+}
+
+ExecutionTrace *ExecutionTrace::get() {
+  if (TracePath.empty())
+    return nullptr;
+
+  static std::unique_ptr<ExecutionTrace> Trace(new ExecutionTrace());
+  return Trace.get();
+}
+
+uint64_t ExecutionTrace::microsecondsSinceStart() const {
+  using namespace std::chrono;
+  auto Elapsed = steady_clock::now() - Start;
+  return duration_cast<microseconds>(Elapsed).count();
+}
+
+llvm::Error ExecutionTrace::write() const {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(TracePath, EC, llvm::sys::fs::OF_Text);
+  if (EC)
+    return llvm::createStringError(EC,
+                                   "Could not open trace file "
+                                     + TracePath.getValue());
+
+  llvm::json::Array TraceEvents(Events);
+  llvm::json::Object Root{ { "traceEvents", std::move(TraceEvents) },
+                           { "displayTimeUnit", "ms" } };
+  OS << llvm::json::Value(std::move(Root));
+  OS.close();
+
+  if (OS.has_error())
+    return llvm::createStringError(OS.error(),
+                                   "Could not write trace file "
+                                     + TracePath.getValue());
+
+  return llvm::Error::success();
+}
+
+TraceScope::TraceScope(llvm::StringRef Name, llvm::StringRef Category) :
+  Trace(ExecutionTrace::get()) {
+  if (not isEnabled())
+    return;
+
+  Event["name"] = Name.str();
+  Event["cat"] = Category.str();
+  Event["ph"] = "X";
+  Event["pid"] = static_cast<int64_t>(llvm::sys::Process::getProcessId());
+  Event["tid"] = 0;
+
+  ResourceUsage Usage = getResourceUsage();
+  StartCPUTime = Usage.CPUTime;
+  StartPeakRSS = Usage.PeakRSS;
+  StartTime = Trace->microsecondsSinceStart();
+}
+
+TraceScope::~TraceScope() {
+  if (not isEnabled())
+    return;
+
+  uint64_t EndTime = Trace->microsecondsSinceStart();
+  ResourceUsage Usage = getResourceUsage();
+
+  Arguments["cpu-time-us"] = Usage.CPUTime - StartCPUTime;
+  Arguments["peak-rss-delta-bytes"] = Usage.PeakRSS - StartPeakRSS;
+
+  Event["ts"] = StartTime;
+  Event["dur"] = EndTime - StartTime;
+  Event["args"] = std::move(Arguments);
+  Trace->record(std::move(Event));
+}
+
+void TraceScope::addTargets(llvm::StringRef Name,
+                            const ContainerToTargetsMap &Targets) {
+  if (not isEnabled())
+    return;
+
+  llvm::json::Object PerContainer;
+  for (const auto &Pair : Targets) {
+    llvm::json::Array Serialized;
+    for (const Target &Target : Pair.second)
+      Serialized.push_back(Target.toString());
+    PerContainer[Pair.first()] = std::move(Serialized);
+  }
+
+  Arguments[Name] = std::move(PerContainer);
+}
+
+void TraceScope::addSerializedSize(const ContainerSet &Containers,
+                                   llvm::ArrayRef<std::string>
+                                     ContainersNames) {
+  if (not isEnabled())
+    return;
+
+  llvm::json::Object Sizes;
+  for (const std::string &Name : ContainersNames) {
+    if (not Containers.contains(Name))
+      continue;
+
+    CountingOStream OS;
+    if (llvm::Error Error = Containers.at(Name).serialize(OS)) {
+      llvm::consumeError(std::move(Error));
+      continue;
+    }
+
+    Sizes[Name] = OS.size();
+  }
+
+  Arguments["serialized-bytes"] = std::move(Sizes);
+}
+
+void TraceScope::addModuleSize(llvm::StringRef Name,
+                               const llvm::Module &Module) {
+  if (not isEnabled())
+    return;
+
+  ModuleSize Size = ModuleSize::measure(Module);
+  CountingOStream OS;
+  llvm::WriteBitcodeToFile(Module, OS);
+
+  Arguments[Name] = llvm::json::Object{
+    { "functions", Size.FunctionsCount },
+    { "basic-blocks", Size.BasicBlocksCount },
+    { "instructions", Size.InstructionsCount },
+    { "metadata-nodes", Size.MetadataNodesCount },
+    { "bitcode-bytes", OS.size() }
+  };
+}
@@ -0,0 +1,136 @@
+/// \file FunctionCostReport.cpp
+/// Implementation of the recorder of the per-function cost of pipes.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <vector>
+
+#include "llvm/IR/Function.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Pipeline/FunctionCostReport.h"
+#include "revng/Support/Assert.h"
+
+using namespace pipeline;
+
+static llvm::cl::opt<std::string> ReportPath("function-cost-report",
+                                             llvm::cl::desc("Record the cost "
+                                                            "of each function "
+                                                            "in each pipe in "
+                                                            "this file, as "
+                                                            "JSON"),
+                                             llvm::cl::init(""));
+
+FunctionCostReport *FunctionCostReport::get() {
+  if (ReportPath.empty())
+    return nullptr;
+
+  static std::unique_ptr<FunctionCostReport> Report(new FunctionCostReport());
+  return Report.get();
+}
+
+llvm::Error FunctionCostReport::write() const {
+  using Entry = std::pair<const MetaAddress *, uint64_t>;
+  std::vector<Entry> Sorted;
+  for (const auto &[Address, PerPipe] : Costs) {
+    uint64_t Total = 0;
+    for (const auto &[Pipe, Cost] : PerPipe)
+      Total += Cost.WallTimeNs;
+    Sorted.emplace_back(&Address, Total);
+  }
+
+  llvm::stable_sort(Sorted, [](const Entry &LHS, const Entry &RHS) {
+    return LHS.second > RHS.second;
+  });
+
+  llvm::json::Array Functions;
+  for (const auto &[Address, Total] : Sorted) {
+    llvm::json::Object Pipes;
+    for (const auto &[Pipe, Cost] : Costs.at(*Address)) {
+      llvm::json::Object Serialized{
+        { "calls", static_cast<int64_t>(Cost.Calls) },
+        { "wall-time-ns", static_cast<int64_t>(Cost.WallTimeNs) },
+      };
+      if (Cost.InstructionsBefore != 0 or Cost.InstructionsAfter != 0) {
+        Serialized["instructions-before"] = Cost.InstructionsBefore;
+        Serialized["instructions-after"] = Cost.InstructionsAfter;
+      }
+      if (Cost.Blocks != 0)
+        Serialized["blocks"] = Cost.Blocks;
+      Pipes[Pipe] = std::move(Serialized);
+    }
+
+    Functions.push_back(llvm::json::Object{
+      { "entry", Address->toString() },
+      { "wall-time-ns", static_cast<int64_t>(Total) },
+      { "pipes", std::move(Pipes) },
+    });
+  }
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(ReportPath, EC, llvm::sys::fs::OF_Text);
+  if (EC)
+    return llvm::createStringError(EC,
+                                   "Could not open function cost report "
+                                     + ReportPath.getValue());
+
+  llvm::json::Object Root{ { "functions", std::move(Functions) } };
+  OS << llvm::json::Value(std::move(Root));
+  OS.close();
+
+  if (OS.has_error())
+    return llvm::createStringError(OS.error(),
+                                   "Could not write function cost report "
+                                     + ReportPath.getValue());
+
+  return llvm::Error::success();
+}
+
+FunctionCostPipeScope::FunctionCostPipeScope(llvm::StringRef Name) :
+  Report(FunctionCostReport::get()) {
+  if (Report == nullptr)
+    return;
+
+  PreviousPipe = std::move(Report->CurrentPipe);
+  Report->CurrentPipe = Name.str();
+}
+
+FunctionCostPipeScope::~FunctionCostPipeScope() {
+  if (Report != nullptr)
+    Report->CurrentPipe = std::move(PreviousPipe);
+}
+
+FunctionCostScope::FunctionCostScope(const MetaAddress &Entry,
+                                     const llvm::Function *F) :
+  Report(FunctionCostReport::get()), Entry(Entry), F(F) {
+  if (not isEnabled())
+    return;
+
+  if (F != nullptr)
+    InstructionsBefore = F->getInstructionCount();
+  Start = std::chrono::steady_clock::now();
+}
+
+FunctionCostScope::~FunctionCostScope() {
+  if (not isEnabled())
+    return;
+
+  using namespace std::chrono;
+  auto Elapsed = duration_cast<nanoseconds>(steady_clock::now() - Start);
+
+  FunctionCostReport::Cost &Cost = Report->costFor(Entry);
+  Cost.Calls += 1;
+  Cost.WallTimeNs += Elapsed.count();
+  if (F != nullptr) {
+    Cost.InstructionsBefore = InstructionsBefore;
+    Cost.InstructionsAfter = F->getInstructionCount();
+  }
+  if (Blocks != 0)
+    Cost.Blocks = Blocks;
+}
@@ -5,9 +5,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+
 #include "llvm/PassRegistry.h"
 #include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/CommandLine.h"
 
+#include "revng/Pipeline/ExecutionTrace.h"
 #include "revng/Pipeline/GenericLLVMPipe.h"
 #include "revng/Pipeline/LLVMContainer.h"
 #include "revng/Support/IRHelpers.h"
@@ -17,6 +21,12 @@ using namespace llvm;
 using namespace pipeline;
 using namespace cl;
 
+static opt<bool> TraceIRSize("pipeline-trace-ir-size",
+                             desc("When tracing the pipeline, record the size "
+                                  "of the module before and after each LLVM "
+                                  "pipe"),
+                             init(false));
+
 void O2Pipe::registerPasses(llvm::legacy::PassManager &Manager) {
   StringMap<llvm::cl::Option *> &Options(getRegisteredOptions());
   getOption<bool>(Options, "disable-machine-licm")->setInitialValue(true);
@@ -77,7 +87,18 @@ void GenericLLVMPipe::run(ExecutionContext &EC, LLVMContainer &Container) {
                                    EC.getCurrentRequestedTargets(),
                                    Container.name()));
   }
+
+  // Measuring the module requires serializing it, do it only upon request
+  std::optional<TraceScope> Trace;
+  if (TraceIRSize) {
+    Trace.emplace(getName(), "llvm-ir");
+    Trace->addModuleSize("ir-before", Container.getModule());
+  }
+
   Manager.run(Container.getModule());
+
+  if (Trace.has_value())
+    Trace->addModuleSize("ir-after", Container.getModule());
 }
 
 void PureLLVMPassWrapper::registerPasses(llvm::legacy::PassManager &Manager) {
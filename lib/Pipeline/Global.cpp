@@ -12,6 +12,7 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/Pipeline/Global.h"
+#include "revng/Support/Assert.h"
 
 using namespace std;
 using namespace pipeline;
@@ -49,3 +50,43 @@ Error Global::load(const revng::FilePath &Path) {
   llvm::Error DeserializeError = fromString(String);
   return DeserializeError;
 }
+
+void Global::startRecording() {
+  revng_assert(not Recording);
+  Recording = true;
+  Before.reset();
+  Journal.reset();
+}
+
+GlobalTupleTreeDiff Global::stopRecording() {
+  revng_assert(Recording);
+  Recording = false;
+
+  // First the diffs recorded as they are, then whatever changed since the copy
+  // has been taken
+  GlobalTupleTreeDiff Result = Journal ? std::move(*Journal) : emptyDiff();
+  Journal.reset();
+
+  if (Before != nullptr) {
+    Result.append(Before->diff(*this));
+    Before.reset();
+  }
+
+  return Result;
+}
+
+void Global::applyKnownDiff(const GlobalTupleTreeDiff &Diff) {
+  bool Record = Recording and Before == nullptr;
+
+  InKnownDiff = Record;
+  llvm::cantFail(applyDiff(Diff));
+  InKnownDiff = false;
+
+  if (not Record)
+    return;
+
+  if (Journal)
+    Journal->append(Diff);
+  else
+    Journal.emplace(Diff);
+}
@@ -0,0 +1,58 @@
+/// \file IRModuleCache.cpp
+/// Implementation of the cache of the IR files parsed in an LLVMContext.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "revng/Pipeline/Context.h"
+#include "revng/Pipeline/IRModuleCache.h"
+#include "revng/Support/Debug.h"
+
+using namespace pipeline;
+
+static Logger<> Log("ir-module-cache");
+
+std::unique_ptr<llvm::Module>
+IRModuleCache::parseIRFile(llvm::StringRef Path, llvm::SMDiagnostic &Error) {
+  std::lock_guard Lock(Mutex);
+
+  auto It = Modules.find(Path);
+  if (It == Modules.end()) {
+    revng_log(Log, "Parsing " << Path.str());
+    auto Parsed = llvm::parseIRFile(Path, Error, Context);
+    if (Parsed == nullptr)
+      return nullptr;
+
+    It = Modules.try_emplace(Path, std::move(Parsed)).first;
+  } else {
+    revng_log(Log, "Cloning " << Path.str());
+  }
+
+  return llvm::CloneModule(*It->second);
+}
+
+IRModuleCache *IRModuleCache::get(const pipeline::Context &PipelineContext) {
+  auto MaybeCache = PipelineContext.getExternalContext<IRModuleCache>(Name);
+  if (not MaybeCache) {
+    llvm::consumeError(MaybeCache.takeError());
+    return nullptr;
+  }
+
+  return *MaybeCache;
+}
+
+std::unique_ptr<llvm::Module>
+IRModuleCache::parseIRFile(const pipeline::Context &PipelineContext,
+                           llvm::StringRef Path,
+                           llvm::SMDiagnostic &Error,
+                           llvm::LLVMContext &Context) {
+  IRModuleCache *Cache = get(PipelineContext);
+  if (Cache == nullptr or &Cache->getContext() != &Context)
+    return llvm::parseIRFile(Path, Error, Context);
+
+  return Cache->parseIRFile(Path, Error);
+}
@@ -10,6 +10,7 @@
 #include <memory>
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugInfoMetadata.h"
@@ -32,6 +33,29 @@
 const char pipeline::LLVMContainer::ID = '0';
 using namespace pipeline;
 
+namespace {
+
+/// A ReadableFile owning a copy of a buffer handed to deserialize
+class OwnedBuffer : public revng::ReadableFile {
+private:
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+
+public:
+  OwnedBuffer(std::unique_ptr<llvm::MemoryBuffer> &&Buffer) :
+    Buffer(std::move(Buffer)) {}
+  ~OwnedBuffer() override = default;
+  llvm::MemoryBuffer &buffer() override { return *Buffer; }
+};
+
+} // namespace
+
+static bool isBitcode(const llvm::MemoryBuffer &Buffer) {
+  const auto *Start = Buffer.getBufferStart();
+  const auto *End = Buffer.getBufferEnd();
+  return llvm::isBitcode(reinterpret_cast<const unsigned char *>(Start),
+                         reinterpret_cast<const unsigned char *>(End));
+}
+
 void pipeline::makeGlobalObjectsArray(llvm::Module &Module,
                                       llvm::StringRef GlobalArrayName) {
   auto *IntegerTy = llvm::IntegerType::get(Module.getContext(),
@@ -61,6 +85,8 @@ void pipeline::makeGlobalObjectsArray(llvm::Module &Module,
 
 std::unique_ptr<ContainerBase>
 LLVMContainer::cloneFiltered(const TargetsList &Targets) const {
+  materialize();
+
   using InspectorT = LLVMKind;
   auto ToClone = InspectorT::functions(Targets, *this->self());
   auto ToClonedNotOwned = InspectorT::untrackedFunctions(*this->self());
@@ -124,6 +150,7 @@ static void fixGlobals(llvm::Module &Module,
 }
 
 void LLVMContainer::mergeBackImpl(ThisType &&OtherContainer) {
+  materialize();
   llvm::Module *ToMerge = &OtherContainer.getModule();
   revng::verify(ToMerge);
 
@@ -291,11 +318,57 @@ void LLVMContainer::mergeBackImpl(ThisType &&OtherContainer) {
   }
 }
 
+/// Erase from \p Module all the global objects that are not transitively used
+/// by \p Roots, so that the result only contains what \p Roots need.
+static void
+pruneUnusedGlobals(llvm::Module &Module,
+                   const llvm::DenseSet<const llvm::Function *> &Roots) {
+  auto IsRemovable = [&Roots](const llvm::GlobalObject &Global) {
+    if (auto *F = llvm::dyn_cast<llvm::Function>(&Global))
+      if (Roots.contains(F))
+        return false;
+
+    // Preserve llvm.used, llvm.global_ctors and the like
+    if (Global.getName().startswith("llvm.")
+        or Global.hasAppendingLinkage())
+      return false;
+
+    // Note: this does not take into account uses in metadata
+    return Global.use_empty();
+  };
+
+  // Erasing a global might drop the last use of another one, iterate until
+  // nothing changes
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+
+    llvm::SmallVector<llvm::GlobalObject *, 16> ToErase;
+    for (llvm::GlobalObject &Global : Module.global_objects())
+      if (IsRemovable(Global))
+        ToErase.push_back(&Global);
+
+    for (llvm::GlobalObject *Global : ToErase) {
+      Global->eraseFromParent();
+      Changed = true;
+    }
+  }
+}
+
 llvm::Error LLVMContainer::extractOne(llvm::raw_ostream &OS,
                                       const Target &Target) const {
   TargetsList List({ Target });
-  auto Module = cloneFiltered(List);
-  return Module->serialize(OS);
+  auto Cloned = cloneFiltered(List);
+  auto &Extracted = llvm::cast<LLVMContainer>(*Cloned);
+
+  // cloneFiltered preserves a declaration for every function and all the
+  // global variables of the module: drop what the requested target does not
+  // use, so that extracting a function costs, and weighs, in proportion to the
+  // function rather than to the whole module
+  auto Roots = LLVMKind::functions(List, Extracted);
+  pruneUnusedGlobals(Extracted.getModule(), Roots);
+
+  return Extracted.serialize(OS);
 }
 
 llvm::Error LLVMContainer::serialize(llvm::raw_ostream &OS) const {
@@ -305,6 +378,13 @@ llvm::Error LLVMContainer::serialize(llvm::raw_ostream &OS) const {
 }
 
 llvm::Error LLVMContainer::deserialize(const llvm::MemoryBuffer &Buffer) {
+  if (isBitcode(Buffer)) {
+    using llvm::MemoryBuffer;
+    auto Copy = MemoryBuffer::getMemBufferCopy(Buffer.getBuffer(),
+                                               Buffer.getBufferIdentifier());
+    return loadLazily(std::make_unique<OwnedBuffer>(std::move(Copy)));
+  }
+
   llvm::SMDiagnostic Error;
   auto M = llvm::parseIR(Buffer, Error, Module->getContext());
   std::string ErrorMessage;
@@ -325,7 +405,102 @@ llvm::Error LLVMContainer::deserialize(const llvm::MemoryBuffer &Buffer) {
                                    ErrorMessage);
   }
 
+  LazySource.reset();
+  LazyPath.reset();
   Module = std::move(M);
 
   return llvm::Error::success();
 }
+
+llvm::Error
+LLVMContainer::loadLazily(std::unique_ptr<revng::ReadableFile> &&Source) {
+  // Only the module-level records are parsed here, function bodies are
+  // materialized on first access
+  llvm::MemoryBufferRef Reference = Source->buffer().getMemBufferRef();
+  auto MaybeModule = llvm::getLazyBitcodeModule(Reference,
+                                                Module->getContext());
+  if (not MaybeModule)
+    return MaybeModule.takeError();
+
+  Module = std::move(*MaybeModule);
+  LazySource = std::move(Source);
+  LazyPath.reset();
+  return llvm::Error::success();
+}
+
+void LLVMContainer::materialize() const {
+  if (LazySource == nullptr)
+    return;
+
+  if (llvm::Error Error = Module->materializeAll()) {
+    std::string Message = "Cannot materialize LLVM module: "
+                          + llvm::toString(std::move(Error));
+    revng_abort(Message.c_str());
+  }
+
+  // The bitcode reader no longer needs the buffer
+  LazySource.reset();
+  LazyPath.reset();
+
+  std::string ErrorMessage;
+  llvm::raw_string_ostream Stream(ErrorMessage);
+  // NOLINTNEXTLINE
+  bool Failed = llvm::verifyModule(*Module, &Stream);
+  Stream.flush();
+  revng_check(not Failed, ErrorMessage.c_str());
+}
+
+uint64_t LLVMContainer::memoryUsage() const {
+  // Function bodies have not been parsed, the bitcode is the bulk of it
+  if (LazySource != nullptr)
+    return LazySource->buffer().getBufferSize();
+
+  // A rough estimate of the in-memory size of an instruction, including its
+  // operands and metadata attachments
+  constexpr uint64_t BytesPerInstruction = 128;
+  uint64_t Result = 0;
+  for (const llvm::Function &F : *Module)
+    Result += F.getInstructionCount() * BytesPerInstruction;
+  return Result;
+}
+
+llvm::Error LLVMContainer::store(const revng::FilePath &Path) const {
+  if (LazySource == nullptr)
+    return ContainerBase::store(Path);
+
+  // The module has never been accessed, it's identical to what we loaded
+  if (LazyPath.has_value() and *LazyPath == Path)
+    return llvm::Error::success();
+
+  auto MaybeWritableFile = Path.getWritableFile();
+  if (not MaybeWritableFile)
+    return MaybeWritableFile.takeError();
+
+  MaybeWritableFile.get()->os() << LazySource->buffer().getBuffer();
+  return MaybeWritableFile.get()->commit();
+}
+
+llvm::Error LLVMContainer::load(const revng::FilePath &Path) {
+  auto MaybeExists = Path.exists();
+  if (not MaybeExists)
+    return MaybeExists.takeError();
+
+  if (not MaybeExists.get()) {
+    clear();
+    return llvm::Error::success();
+  }
+
+  auto MaybeFile = Path.getReadableFile();
+  if (not MaybeFile)
+    return MaybeFile.takeError();
+
+  // Textual IR cannot be loaded lazily
+  if (not isBitcode(MaybeFile.get()->buffer()))
+    return deserialize(MaybeFile.get()->buffer());
+
+  if (auto Error = loadLazily(std::move(MaybeFile.get())))
+    return Error;
+
+  LazyPath = Path;
+  return llvm::Error::success();
+}
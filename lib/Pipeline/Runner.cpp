@@ -6,24 +6,49 @@
 //
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Progress.h"
+#include "llvm/Support/YAMLParser.h"
 
 #include "revng/Pipeline/Context.h"
 #include "revng/Pipeline/Errors.h"
+#include "revng/Pipeline/ExecutionTrace.h"
+#include "revng/Pipeline/FunctionCostReport.h"
 #include "revng/Pipeline/GlobalTupleTreeDiff.h"
 #include "revng/Pipeline/Kind.h"
+#include "revng/Pipeline/LLVMContainer.h"
 #include "revng/Pipeline/Runner.h"
 #include "revng/Pipeline/Target.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/TaskScheduler.h"
 #include "revng/TupleTree/TupleTreeReference.h"
 
 using namespace std;
 using namespace llvm;
 using namespace pipeline;
 
+static cl::opt<unsigned> MemoryBudget("pipeline-memory-budget",
+                                      cl::desc("Evict from memory the "
+                                               "containers that are stored "
+                                               "and unchanged whenever the "
+                                               "containers in memory exceed "
+                                               "this many MiB. 0 disables the "
+                                               "budget"),
+                                      cl::init(0));
+
+static cl::opt<bool> ReleaseConsumed("pipeline-release-consumed-containers",
+                                     cl::desc("Store and evict from memory "
+                                              "the containers that no step "
+                                              "left to run reads from"),
+                                     cl::init(true));
+
+static Logger<> MemoryLog("pipeline-memory");
+
 class PipelineExecutionEntry {
 public:
   Step *ToExecute = nullptr;
@@ -105,6 +130,78 @@ static void explainPipeline(const ContainerToTargetsMap &Targets,
   ExplanationLogger << DoLog;
 }
 
+static llvm::Error writeTrace() {
+  if (ExecutionTrace *Trace = ExecutionTrace::get())
+    if (llvm::Error Error = Trace->write())
+      return Error;
+
+  if (FunctionCostReport *Report = FunctionCostReport::get())
+    return Report->write();
+
+  return llvm::Error::success();
+}
+
+static Error runExecutionEntry(Runner &Runner, PipelineExecutionEntry &Entry) {
+  auto &[Step, PredictedOutput, Input, PipesInfo] = Entry;
+
+  if (Runner.getContext().isCancellationRequested())
+    return make_error<CancelledError>();
+
+  Task T(3, "Run step");
+  T.advance("Restore suspended targets", true);
+
+  // The previous step has just been run: if it produced again what some
+  // suspended targets depend on, identical, restore them and only run what's
+  // still missing
+  bool Run = true;
+  if (Step->reviveSuspended(PredictedOutput)) {
+    if (Step->containers().enumerate().contains(PredictedOutput)) {
+      Run = false;
+    } else {
+      std::tie(Input, PipesInfo) = Step->analyzeGoals(PredictedOutput);
+    }
+  }
+
+  // Run the step
+  T.advance("Run the step", true);
+  if (Run) {
+    ::Step &Parent = Step->getPredecessor();
+    ContainerSet CurrentContainer = Parent.containers().cloneFiltered(Input);
+    Step->run(std::move(CurrentContainer), PipesInfo);
+  }
+
+  // Suspended targets depending on targets that have changed can no longer be
+  // restored
+  ContainerToTargetsMap Changed = Step->settleStaleTargets();
+  if (not Changed.empty()) {
+    for (::Step &NextStep : Runner) {
+      if (NextStep.hasPredecessor() and &NextStep.getPredecessor() == Step)
+        NextStep.dropSuspended(NextStep.deduceResults(Changed));
+    }
+  }
+
+  // The step has been interrupted halfway, what it has been asked for is not
+  // available
+  if (Runner.getContext().isCancellationRequested())
+    return make_error<CancelledError>();
+
+  T.advance("Extract the requested targets", true);
+  if (VerifyLog.isEnabled()) {
+    ContainerSet Produced = Step->containers().cloneFiltered(PredictedOutput);
+
+    if (not Produced.enumerate().contains(PredictedOutput)) {
+      dbg << "PredictedOutput:\n";
+      PredictedOutput.dump(dbg, 2, false);
+      dbg << "Produced:\n";
+      Produced.enumerate().dump(dbg, 2, false);
+      revng_abort("Not all the expected targets have been produced");
+    }
+    revng_check(Step->containers().enumerate().contains(PredictedOutput));
+  }
+
+  return Error::success();
+}
+
 Error Runner::getInvalidations(TargetInStepSet &Invalidated) const {
 
   for (const Step &NextS : *this) {
@@ -136,12 +233,13 @@ Step &Runner::addStep(Step &&NewStep) {
 llvm::Error Runner::getInvalidations(const Target &Target,
                                      TargetInStepSet &Invalidations) const {
   for (const Step &Step : *this)
-    for (const auto &Container : Step.containers()) {
-      if (Container.second == nullptr)
+    for (const auto &Container : Step.containers().entries()) {
+      llvm::StringRef Name = Container.first();
+      if (not Step.containers().contains(Name))
         continue;
 
-      if (Container.second->enumerate().contains(Target)) {
-        Invalidations[Step.getName()].add(Container.first(), Target);
+      if (Step.containers().enumerate(Name).contains(Target)) {
+        Invalidations[Step.getName()].add(Name, Target);
       }
     }
   if (llvm::Error Error = getInvalidations(Invalidations); !!Error)
@@ -210,6 +308,9 @@ Error Runner::store(const revng::DirectoryPath &DirPath) const {
     }
   }
 
+  // Now everything in memory is stored and can be evicted
+  enforceMemoryBudget();
+
   revng::DirectoryPath ContextDir = DirPath.getDirectory("context");
   if (auto Error = ContextDir.create())
     return Error;
@@ -217,6 +318,106 @@ Error Runner::store(const revng::DirectoryPath &DirPath) const {
   return TheContext->store(ContextDir);
 }
 
+void Runner::enforceMemoryBudget() const {
+  if (MemoryBudget == 0)
+    return;
+
+  struct Candidate {
+    const ContainerSet *Containers;
+    llvm::StringRef Name;
+    uint64_t Size;
+    uint64_t LastAccess;
+  };
+
+  uint64_t InMemory = 0;
+  std::vector<Candidate> Candidates;
+  for (const auto &Step : Steps) {
+    const ContainerSet &Containers = Step.second.containers();
+    for (const auto &Entry : Containers.entries()) {
+      if (Entry.second == nullptr)
+        continue;
+
+      uint64_t Size = Entry.second->memoryUsage();
+      InMemory += Size;
+      if (Size != 0 and Containers.isEvictable(Entry.first()))
+        Candidates.push_back({ &Containers,
+                               Entry.first(),
+                               Size,
+                               Containers.lastAccess(Entry.first()) });
+    }
+  }
+
+  uint64_t Budget = static_cast<uint64_t>(MemoryBudget) << 20;
+  if (InMemory <= Budget)
+    return;
+
+  llvm::sort(Candidates, [](const Candidate &LHS, const Candidate &RHS) {
+    return LHS.LastAccess < RHS.LastAccess;
+  });
+
+  for (const Candidate &ToEvict : Candidates) {
+    if (InMemory <= Budget)
+      break;
+
+    revng_log(MemoryLog,
+              "Evicting " << ToEvict.Name << " (" << ToEvict.Size
+                          << " bytes)");
+    ToEvict.Containers->evict(ToEvict.Name);
+    InMemory -= ToEvict.Size;
+  }
+
+  if (InMemory > Budget)
+    revng_log(MemoryLog,
+              "Still " << InMemory
+                       << " bytes in memory, the rest cannot be evicted");
+}
+
+std::string Runner::serializeMemoryUsage() const {
+  std::string Result;
+  raw_string_ostream OS(Result);
+  uint64_t Total = 0;
+
+  auto Quote = [](StringRef Name) { return "\"" + yaml::escape(Name) + "\""; };
+
+  const GlobalsMap &Globals = TheContext->getGlobals();
+  OS << "Globals:" << (Globals.begin() == Globals.end() ? " {}\n" : "\n");
+  for (const Global *TheGlobal : Globals) {
+    uint64_t Size = TheGlobal->memoryUsage();
+    Total += Size;
+    OS << "  " << Quote(TheGlobal->getName()) << ": " << Size << "\n";
+  }
+
+  std::vector<StringRef> StepNames(Steps.keys().begin(), Steps.keys().end());
+  llvm::sort(StepNames);
+
+  OS << "Steps:\n";
+  for (StringRef StepName : StepNames) {
+    const ContainerSet &Containers = Steps.find(StepName)->second.containers();
+
+    uint64_t StepTotal = 0;
+    std::string Entries;
+    raw_string_ostream EntriesOS(Entries);
+    for (const auto &Entry : Containers.entries()) {
+      if (Entry.second == nullptr)
+        continue;
+
+      uint64_t Size = Entry.second->memoryUsage();
+      StepTotal += Size;
+      EntriesOS << "      " << Quote(Entry.first()) << ": " << Size << "\n";
+    }
+    EntriesOS.flush();
+    Total += StepTotal;
+
+    OS << "  " << Quote(StepName) << ":\n";
+    OS << "    Total: " << StepTotal << "\n";
+    OS << "    Containers:" << (Entries.empty() ? " {}\n" : "\n") << Entries;
+  }
+
+  OS << "Total: " << Total << "\n";
+  OS.flush();
+  return Result;
+}
+
 Error Runner::storeStepToDisk(llvm::StringRef StepName,
                               const revng::DirectoryPath &DirPath) const {
   auto Step = Steps.find(StepName);
@@ -235,11 +436,18 @@ Error Runner::storeStepToDisk(llvm::StringRef StepName,
   return Error::success();
 }
 
+void Runner::dropPlanTemplates() {
+  for (auto &Step : Steps)
+    Step.second.dropPlanTemplates();
+}
+
 Error Runner::load(const revng::DirectoryPath &DirPath) {
   revng::DirectoryPath ContextDir = DirPath.getDirectory("context");
   if (auto Error = TheContext->load(ContextDir); !!Error)
     return Error;
 
+  dropPlanTemplates();
+
   for (auto &Step : Steps) {
     revng::DirectoryPath StepDir = DirPath.getDirectory(Step.first());
     if (auto Error = Step.second.load(StepDir); !!Error)
@@ -249,6 +457,27 @@ Error Runner::load(const revng::DirectoryPath &DirPath) {
   return Error::success();
 }
 
+Error Runner::shareFrom(const Runner &Other) {
+  for (const Global *OtherGlobal : Other.TheContext->getGlobals()) {
+    auto MaybeGlobal = TheContext->getGlobals().get(OtherGlobal->getName());
+    if (not MaybeGlobal)
+      return MaybeGlobal.takeError();
+    **MaybeGlobal = *OtherGlobal;
+  }
+
+  dropPlanTemplates();
+
+  for (auto &Step : Steps) {
+    if (not Other.containsStep(Step.first()))
+      return createStringError(inconvertibleErrorCode(),
+                               "Step " + Step.first() + " is not in the "
+                                 + "pipeline being shared from");
+    Step.second.shareFrom(Other.getStep(Step.first()));
+  }
+
+  return Error::success();
+}
+
 std::vector<revng::FilePath>
 Runner::getWrittenFiles(const revng::DirectoryPath &DirPath) const {
   std::vector<revng::FilePath> Result;
@@ -273,9 +502,6 @@ Runner::runAnalysis(llvm::StringRef AnalysisName,
                     const ContainerToTargetsMap &Targets,
                     TargetInStepSet &InvalidationsMap,
                     const llvm::StringMap<std::string> &Options) {
-
-  GlobalsMap Before = getContext().getGlobals();
-
   auto MaybeStep = Steps.find(StepName);
 
   if (MaybeStep == Steps.end()) {
@@ -284,26 +510,36 @@ Runner::runAnalysis(llvm::StringRef AnalysisName,
                              StepName.str().c_str());
   }
 
+  // Rather than copying all the globals now, each global is copied right
+  // before it's first changed: the globals that are not changed cost nothing
+  GlobalsMap &Globals = TheContext->getGlobals();
+  Globals.startRecording();
+
   Task T(3, "Analysis execution");
   T.advance("Produce step " + StepName, true);
-  if (llvm::Error Error = run(StepName, Targets))
+  if (llvm::Error Error = run(StepName, Targets)) {
+    Globals.stopRecording();
     return std::move(Error);
+  }
 
   T.advance("Run analysis", true);
   if (llvm::Error Error = MaybeStep->second.runAnalysis(AnalysisName,
                                                         Targets,
                                                         Options);
       Error) {
+    Globals.stopRecording();
     return std::move(Error);
   }
 
   T.advance("Apply diff produced by the analysis", true);
-  const GlobalsMap &After = getContext().getGlobals();
-  DiffMap Map = Before.diff(After);
+  DiffMap Map = Globals.stopRecording();
   for (const auto &GlobalNameDiffPair : Map)
     if (llvm::Error Error = apply(GlobalNameDiffPair.second, InvalidationsMap))
       return std::move(Error);
 
+  if (llvm::Error Error = writeTrace())
+    return std::move(Error);
+
   return std::move(Map);
 }
 
@@ -312,7 +548,9 @@ llvm::Expected<DiffMap>
 Runner::runAnalyses(const AnalysesList &List,
                     TargetInStepSet &InvalidationsMap,
                     const llvm::StringMap<std::string> &Options) {
-  GlobalsMap Before = getContext().getGlobals();
+  // Compose the diffs of the single analyses, rather than recording the
+  // changes to the globals once more
+  DiffMap Result = getContext().getGlobals().emptyDiffs();
 
   Task T(List.size() + 1, "Analysis list " + List.getName());
   for (const AnalysisReference &Ref : List) {
@@ -329,31 +567,168 @@ Runner::runAnalyses(const AnalysesList &List,
     }
 
     TargetInStepSet NewInvalidationsMap;
-    auto Result = runAnalysis(Ref.getAnalysisName(),
-                              Step.getName(),
-                              Map,
-                              NewInvalidationsMap,
-                              Options);
-    if (not Result)
-      return Result.takeError();
+    auto MaybeDiffs = runAnalysis(Ref.getAnalysisName(),
+                                  Step.getName(),
+                                  Map,
+                                  NewInvalidationsMap,
+                                  Options);
+    if (not MaybeDiffs)
+      return MaybeDiffs.takeError();
     for (auto &NewEntry : NewInvalidationsMap)
       InvalidationsMap[NewEntry.first()].merge(NewEntry.second);
+
+    for (const auto &Entry : *MaybeDiffs)
+      Result.find(Entry.first())->second.append(Entry.second);
   }
 
   T.advance("Computing analysis list diff", true);
-  const GlobalsMap &After = getContext().getGlobals();
-  return Before.diff(After);
+  return std::move(Result);
+}
+
+/// Once \p ToExec[Index] has run, store and evict the containers of its
+/// predecessor that none of the following entries reads from
+///
+/// This releases, e.g., the root module as soon as all the functions requested
+/// have been isolated from it, instead of keeping it around for the rest of the
+/// run. The steps in \p Requested are left alone, their containers are what
+/// has been asked for. If \p Runner is ephemeral, the containers are dropped
+/// without storing them.
+static Error releaseConsumed(const Runner &Runner,
+                             const revng::DirectoryPath &DirPath,
+                             llvm::ArrayRef<PipelineExecutionEntry> ToExec,
+                             size_t Index,
+                             const llvm::StringSet<> &Requested) {
+  if (not ReleaseConsumed or not(DirPath.isValid() or Runner.isEphemeral()))
+    return Error::success();
+
+  const PipelineExecutionEntry &Entry = ToExec[Index];
+  if (not Entry.ToExecute->hasPredecessor())
+    return Error::success();
+
+  Step &Parent = Entry.ToExecute->getPredecessor();
+  if (Requested.contains(Parent.getName()))
+    return Error::success();
+
+  ContainerSet &Containers = Parent.containers();
+  llvm::SmallVector<llvm::StringRef, 4> ToRelease;
+  for (const auto &InMemory : Containers.entries()) {
+    llvm::StringRef Name = InMemory.first();
+    if (InMemory.second == nullptr or InMemory.second->memoryUsage() == 0)
+      continue;
+
+    auto ReadsFrom = [&Parent, Name](const PipelineExecutionEntry &Other) {
+      if (not Other.ToExecute->hasPredecessor()
+          or &Other.ToExecute->getPredecessor() != &Parent)
+        return false;
+      auto It = Other.Input.find(Name);
+      return It != Other.Input.end() and not It->second.empty();
+    };
+    if (not ReadsFrom(Entry))
+      continue;
+
+    if (llvm::any_of(ToExec.drop_front(Index + 1), ReadsFrom))
+      continue;
+
+    ToRelease.push_back(Name);
+  }
+
+  if (ToRelease.empty())
+    return Error::success();
+
+  if (Runner.isEphemeral()) {
+    for (llvm::StringRef Name : ToRelease) {
+      revng_log(MemoryLog,
+                "Dropping " << Parent.getName() << "/" << Name
+                            << ", no step left to run reads from it");
+      Containers.drop(Name);
+    }
+    return Error::success();
+  }
+
+  if (auto Error = Runner.storeStepToDisk(Parent.getName(), DirPath))
+    return Error;
+
+  for (llvm::StringRef Name : ToRelease) {
+    if (not Containers.isEvictable(Name))
+      continue;
+
+    revng_log(MemoryLog,
+              "Releasing " << Parent.getName() << "/" << Name
+                           << ", no step left to run reads from it");
+    Containers.evict(Name);
+  }
+
+  return Error::success();
 }
 
+/// Schedule all the requests at once: each step is analyzed, and then run, at
+/// most once, with the union of the targets all the requests need from it.
+/// This way, requests ending in different branches of the step tree share the
+/// execution of their common ancestors.
 Error Runner::run(const State &ToProduce) {
-  Task T(ToProduce.size(), "Multi-step pipeline run");
+  if (ToProduce.size() == 1)
+    return run(ToProduce.begin()->first(), ToProduce.begin()->second);
+
+  llvm::StringMap<ContainerToTargetsMap> Goals;
   for (const auto &Request : ToProduce) {
-    T.advance(Request.first(), true);
-    if (llvm::Error Error = run(Request.first(), Request.second))
+    revng_log(ExplanationLogger, "Running until step " << Request.first());
+    Goals[Request.first()].merge(Request.second);
+  }
+
+  // Visit the steps successors first, so that by the time we reach a step we
+  // know everything that is expected from it
+  vector<PipelineExecutionEntry> ToExec;
+  for (Step *CurrentStep : llvm::reverse(ReversePostOrderIndexes)) {
+    auto It = Goals.find(CurrentStep->getName());
+    if (It == Goals.end() or It->second.empty())
+      continue;
+
+    ContainerToTargetsMap Output = It->second;
+    auto [Required, PipesExecutionEntries] = CurrentStep->analyzeGoals(Output);
+    if (Required.empty())
+      continue;
+
+    if (not CurrentStep->hasPredecessor())
+      return make_error<UnsatisfiableRequestError>(std::move(Output),
+                                                   std::move(Required));
+
+    Goals[CurrentStep->getPredecessor().getName()].merge(Required);
+    ToExec.emplace_back(*CurrentStep,
+                        std::move(Output),
+                        std::move(Required),
+                        std::move(PipesExecutionEntries));
+  }
+  reverse(ToExec.begin(), ToExec.end());
+
+  for (PipelineExecutionEntry &Entry : ToExec) {
+    Step &Step = *Entry.ToExecute;
+    if (llvm::Error Error = Step.checkPrecondition()) {
+      return llvm::make_error<AnnotatedError>(std::move(Error),
+                                              "While scheduling step "
+                                                + Step.getName() + ":");
+    }
+  }
+
+  llvm::StringSet<> Requested;
+  for (const auto &Request : ToProduce)
+    Requested.insert(Request.first());
+
+  Task T(ToExec.size(), "Multi-step pipeline run");
+  for (size_t I = 0; I < ToExec.size(); ++I) {
+    PipelineExecutionEntry &Entry = ToExec[I];
+    T.advance(Entry.ToExecute->getName(), true);
+    if (llvm::Error Error = runExecutionEntry(*this, Entry))
+      return Error;
+
+    if (auto Error = releaseConsumed(*this,
+                                     ReleaseDirectory,
+                                     ToExec,
+                                     I,
+                                     Requested))
       return Error;
   }
 
-  return llvm::Error::success();
+  return writeTrace();
 }
 
 Error Runner::run(llvm::StringRef EndingStepName,
@@ -381,34 +756,22 @@ Error Runner::run(llvm::StringRef EndingStepName,
     }
   }
 
-  Task T(ToExec.size() - 1, "Produce steps required up to " + EndingStepName);
-  for (PipelineExecutionEntry &StepGoalsPairs : llvm::drop_begin(ToExec)) {
-    auto &[Step, PredictedOutput, Input, PipesInfo] = StepGoalsPairs;
-    T.advance(Step->getName(), true);
+  llvm::StringSet<> Requested;
+  Requested.insert(EndingStepName);
 
-    Task T2(3, "Run step");
-    T2.advance("Clone and filter input containers", true);
-
-    ::Step &Parent = Step->getPredecessor();
-    ContainerSet CurrentContainer = Parent.containers().cloneFiltered(Input);
-
-    // Run the step
-    T2.advance("Run the step", true);
-    Step->run(std::move(CurrentContainer), PipesInfo);
-
-    T2.advance("Extract the requested targets", true);
-    if (VerifyLog.isEnabled()) {
-      ContainerSet Produced = Step->containers().cloneFiltered(PredictedOutput);
+  Task T(ToExec.size() - 1, "Produce steps required up to " + EndingStepName);
+  for (size_t I = 1; I < ToExec.size(); ++I) {
+    PipelineExecutionEntry &StepGoalsPairs = ToExec[I];
+    T.advance(StepGoalsPairs.ToExecute->getName(), true);
+    if (llvm::Error Error = runExecutionEntry(*this, StepGoalsPairs))
+      return Error;
 
-      if (not Produced.enumerate().contains(PredictedOutput)) {
-        dbg << "PredictedOutput:\n";
-        PredictedOutput.dump(dbg, 2, false);
-        dbg << "Produced:\n";
-        Produced.enumerate().dump(dbg, 2, false);
-        revng_abort("Not all the expected targets have been produced");
-      }
-      revng_check(Step->containers().enumerate().contains(PredictedOutput));
-    }
+    if (auto Error = releaseConsumed(*this,
+                                     ReleaseDirectory,
+                                     ToExec,
+                                     I,
+                                     Requested))
+      return Error;
   }
 
   if (ExplanationLogger.isEnabled()) {
@@ -421,17 +784,64 @@ Error Runner::run(llvm::StringRef EndingStepName,
     ExplanationLogger << DoLog;
   }
 
-  return Error::success();
+  return writeTrace();
 }
 
-Error Runner::invalidate(const TargetInStepSet &Invalidations) {
-  for (const auto &Step : Invalidations) {
-    llvm::StringRef StepName = Step.first();
-    const ContainerToTargetsMap &ToRemove = Step.second;
-    if (llvm::Error Error = operator[](StepName).invalidate(ToRemove))
-      return Error;
+/// \returns true if \p Step has LLVM containers: all the modules share the
+///          same LLVMContext, which cannot be changed concurrently
+static bool holdsIR(const Step &Step) {
+  const ContainerSet &Containers = Step.containers();
+  for (const auto &Entry : Containers.entries())
+    if (Containers.mimeType(Entry.first()) == LLVMContainer::MIMEType)
+      return true;
+  return false;
+}
+
+/// Call \p Apply on each of \p Steps, concurrently where possible
+///
+/// Steps do not share containers, hence invalidating the targets of a step
+/// doesn't affect the others. The steps holding IR are processed, in order, on
+/// the current thread, while the others run on the workers.
+///
+/// \return the errors of all the steps, joined
+template<typename CallableT>
+static llvm::Error forEachStep(llvm::ArrayRef<Step *> Steps,
+                               CallableT &&Apply) {
+  std::vector<std::optional<llvm::Error>> Results(Steps.size());
+  {
+    revng::TaskGroup Group;
+    std::vector<size_t> OnThisThread;
+    for (size_t Index = 0; Index < Steps.size(); ++Index) {
+      if (holdsIR(*Steps[Index])) {
+        OnThisThread.push_back(Index);
+        continue;
+      }
+
+      Group.spawn([&Results, &Apply, &Steps, Index]() {
+        Results[Index].emplace(Apply(*Steps[Index]));
+      });
+    }
+
+    for (size_t Index : OnThisThread)
+      Results[Index].emplace(Apply(*Steps[Index]));
+
+    Group.wait();
   }
-  return Error::success();
+
+  llvm::Error Result = llvm::Error::success();
+  for (std::optional<llvm::Error> &Error : Results)
+    Result = llvm::joinErrors(std::move(Result), std::move(*Error));
+  return Result;
+}
+
+Error Runner::invalidate(const TargetInStepSet &Invalidations) {
+  std::vector<Step *> ToInvalidate;
+  for (const auto &Entry : Invalidations)
+    ToInvalidate.push_back(&operator[](Entry.first()));
+
+  return forEachStep(ToInvalidate, [&Invalidations](Step &Step) {
+    return Step.invalidate(Invalidations.find(Step.getName())->second);
+  });
 }
 
 void Runner::getCurrentState(State &Out) const {
@@ -457,44 +867,106 @@ const KindsRegistry &Runner::getKindsRegistry() const {
   return TheContext->getKindsRegistry();
 }
 
+/// Compute the targets of \p Step which directly depend on what changed in
+/// \p Diff, see Runner::getDiffInvalidations
+///
+/// This only reads the invalidation metadata of \p Step and enumerates its
+/// containers, hence it can run concurrently on different steps.
+static void getStepDiffInvalidations(const Step &Step,
+                                     const GlobalTupleTreeDiff &Diff,
+                                     TargetInStepSet &Map) {
+  revng_log(InvalidationLog,
+            "Computing invalidations in step " << Step.getName());
+  LoggerIndent<> I(InvalidationLog);
+
+  ContainerToTargetsMap &StepInvalidations = Map[Step.getName()];
+
+  // Iterate over each pipe and feed it the non-const containers
+  // TODO: this is misguided! The pipe are going to be looking at the
+  //       containers *at the end* of the pipe. This might mean that what
+  //       we're looking for might no longer be there!
+  Step.pipeInvalidate(Diff, StepInvalidations);
+
+  // Compute the set of things we need to invalidate by looking at all the
+  // paths changed by Diff.
+  // Also, this will invalidate all the targets depending on them and all the
+  // targets depending on stuff that's already in Map.
+  revng_log(InvalidationLog, Diff.getPaths().size() << " paths have changed");
+  for (const TupleTreePath *Path : Diff.getPaths()) {
+    revng_log(InvalidationLog, "Processing " << *Diff.pathAsString(*Path));
+    LoggerIndent<> Indent(InvalidationLog);
+    Step.registerTargetsDependingOn(Diff.getGlobalName(),
+                                    *Path,
+                                    Map,
+                                    InvalidationLog);
+  }
+}
+
 void Runner::getDiffInvalidations(const GlobalTupleTreeDiff &Diff,
                                   TargetInStepSet &Map) const {
+  // Skip the begin step
+  std::vector<const Step *> ToVisit;
+  for (const Step &Step : llvm::drop_begin(*this))
+    ToVisit.push_back(&Step);
+
+  // Keep the log readable
+  if (InvalidationLog.isEnabled()) {
+    for (const Step *Step : ToVisit)
+      getStepDiffInvalidations(*Step, Diff, Map);
+    return;
+  }
 
-  // Iterate over each step, skipping the begin step
-  for (const Step &Step : llvm::drop_begin(*this)) {
-    revng_log(InvalidationLog,
-              "Computing invalidations in step " << Step.getName());
-    LoggerIndent<> I(InvalidationLog);
-
-    ContainerToTargetsMap &StepInvalidations = Map[Step.getName()];
-
-    // Iterate over each pipe and feed it the non-const containers
-    // TODO: this is misguided! The pipe are going to be looking at the
-    //       containers *at the end* of the pipe. This might mean that what
-    //       we're looking for might no longer be there!
-    Step.pipeInvalidate(Diff, StepInvalidations);
-
-    // Compute the set of things we need to invalidate by looking at all the
-    // paths changed by Diff.
-    // Also, this will invalidate all the targets depending on them and all the
-    // targets depending on stuff that's already in Map.
-    revng_log(InvalidationLog, Diff.getPaths().size() << " paths have changed");
-    for (const TupleTreePath *Path : Diff.getPaths()) {
-      revng_log(InvalidationLog, "Processing " << *Diff.pathAsString(*Path));
-      LoggerIndent<> Indent(InvalidationLog);
-      Step.registerTargetsDependingOn(Diff.getGlobalName(),
-                                      *Path,
-                                      Map,
-                                      InvalidationLog);
+  // Each step records its invalidations in a map of its own
+  std::vector<TargetInStepSet> PerStep(ToVisit.size());
+  {
+    revng::TaskGroup Group;
+    for (size_t Index = 0; Index < ToVisit.size(); ++Index) {
+      Group.spawn([&ToVisit, &Diff, &PerStep, Index]() {
+        getStepDiffInvalidations(*ToVisit[Index], Diff, PerStep[Index]);
+      });
     }
   }
+
+  for (TargetInStepSet &Invalidations : PerStep)
+    for (auto &Entry : Invalidations)
+      Map[Entry.first()].merge(Entry.second);
 }
 
 llvm::Error Runner::apply(const GlobalTupleTreeDiff &Diff,
                           TargetInStepSet &Map) {
-  getDiffInvalidations(Diff, Map);
-  if (auto Error = getInvalidations(Map))
+  // The globals have changed, the plans of the steps might no longer hold
+  dropPlanTemplates();
+
+  TargetInStepSet Direct;
+  getDiffInvalidations(Diff, Direct);
+
+  TargetInStepSet All = Direct;
+  if (auto Error = getInvalidations(All))
     return Error;
 
-  return invalidate(Map);
+  // Targets which do not depend on what has changed, but only on other
+  // invalidated targets, are suspended
+  std::vector<Step *> ToInvalidate;
+  for (const auto &Entry : All)
+    ToInvalidate.push_back(&operator[](Entry.first()));
+
+  auto Invalidate = [&All, &Direct](Step &Step) -> llvm::Error {
+    ContainerToTargetsMap Propagated = All.find(Step.getName())->second;
+
+    auto It = Direct.find(Step.getName());
+    if (It != Direct.end()) {
+      Propagated.erase(It->second);
+      if (llvm::Error Error = Step.invalidate(It->second))
+        return Error;
+    }
+
+    return Step.suspend(Propagated);
+  };
+  if (llvm::Error Error = forEachStep(ToInvalidate, Invalidate))
+    return Error;
+
+  for (const auto &Entry : All)
+    Map[Entry.first()].merge(Entry.second);
+
+  return Error::success();
 }
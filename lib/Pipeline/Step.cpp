@@ -6,15 +6,21 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Progress.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/raw_sha1_ostream.h"
 
+#include "revng/Pipeline/ArtifactCache.h"
 #include "revng/Pipeline/ContainerSet.h"
 #include "revng/Pipeline/Context.h"
 #include "revng/Pipeline/Errors.h"
+#include "revng/Pipeline/ExecutionTrace.h"
+#include "revng/Pipeline/FunctionCostReport.h"
 #include "revng/Pipeline/Step.h"
 #include "revng/Pipeline/Target.h"
 #include "revng/Support/Assert.h"
@@ -24,6 +30,13 @@ using namespace llvm;
 using namespace std;
 using namespace pipeline;
 
+static cl::opt<bool> EarlyCutoff("pipeline-early-cutoff",
+                                 cl::desc("Do not recompute targets whose "
+                                          "inputs have been invalidated, but "
+                                          "have then been produced again "
+                                          "identical"),
+                                 cl::init(false));
+
 namespace pipeline {
 
 class TargetInPipe {
@@ -218,6 +231,291 @@ ContainerInvalidationMetadata::deserialize(const Context &Context,
   return ToReturn;
 }
 
+/// Invalidation metadata is stored in a binary format starting with this magic,
+/// files not starting with it are in the former YAML format
+static constexpr llvm::StringLiteral InvalidationMetadataMagic = "RVNGINV1";
+
+namespace {
+
+/// The invalidation metadata of a container, as stored on disk
+///
+/// All the strings (global names, serialized targets, pipe names and
+/// serialized paths) are interned in a single table, stored first. Then, for
+/// each global, the (target, pipe) entries are stored column by column: the
+/// target IDs, delta encoded, the pipe IDs, the number of paths of each entry
+/// and, finally, the path IDs of all the entries, sorted and delta encoded
+/// within each entry. All the integers are LEB128-encoded.
+class StoredInvalidationMetadata {
+public:
+  struct Section {
+    uint64_t GlobalName = 0;
+    std::vector<uint64_t> Targets;
+    std::vector<uint64_t> Pipes;
+    std::vector<uint64_t> PathCounts;
+    std::vector<uint64_t> Paths;
+  };
+
+public:
+  /// When writing, these point to the keys of Index, when reading, to the
+  /// buffer being read
+  std::vector<llvm::StringRef> Strings;
+  std::vector<Section> Sections;
+
+private:
+  llvm::StringMap<uint64_t> Index;
+
+public:
+  StoredInvalidationMetadata() = default;
+  StoredInvalidationMetadata(StoredInvalidationMetadata &&) = default;
+  StoredInvalidationMetadata &
+  operator=(StoredInvalidationMetadata &&) = default;
+
+  StoredInvalidationMetadata(const StoredInvalidationMetadata &) = delete;
+  StoredInvalidationMetadata &
+  operator=(const StoredInvalidationMetadata &) = delete;
+
+public:
+  void add(llvm::StringRef GlobalName,
+           const ContainerInvalidationMetadata &Metadata) {
+    Section &New = Sections.emplace_back();
+    New.GlobalName = intern(GlobalName);
+    for (const auto &[Target, Paths] : Metadata.Data) {
+      New.Targets.push_back(intern(Target.SerializedTarget));
+      New.Pipes.push_back(intern(Target.PipeName));
+      New.PathCounts.push_back(Paths.size());
+
+      size_t Start = New.Paths.size();
+      for (const std::string &Path : Paths)
+        New.Paths.push_back(intern(Path));
+      std::sort(New.Paths.begin() + Start, New.Paths.end());
+    }
+  }
+
+  void write(llvm::raw_ostream &OS) const {
+    OS << InvalidationMetadataMagic;
+
+    encodeULEB128(Strings.size(), OS);
+    for (llvm::StringRef String : Strings) {
+      encodeULEB128(String.size(), OS);
+      OS << String;
+    }
+
+    encodeULEB128(Sections.size(), OS);
+    for (const Section &Section : Sections) {
+      encodeULEB128(Section.GlobalName, OS);
+      encodeULEB128(Section.Targets.size(), OS);
+
+      int64_t Previous = 0;
+      for (uint64_t Target : Section.Targets) {
+        encodeSLEB128(static_cast<int64_t>(Target) - Previous, OS);
+        Previous = Target;
+      }
+
+      for (uint64_t Pipe : Section.Pipes)
+        encodeULEB128(Pipe, OS);
+
+      for (uint64_t Count : Section.PathCounts)
+        encodeULEB128(Count, OS);
+
+      auto PathIt = Section.Paths.begin();
+      for (uint64_t Count : Section.PathCounts) {
+        uint64_t PreviousPath = 0;
+        for (uint64_t I = 0; I < Count; ++I, ++PathIt) {
+          encodeULEB128(*PathIt - PreviousPath, OS);
+          PreviousPath = *PathIt;
+        }
+      }
+    }
+  }
+
+  static llvm::Expected<StoredInvalidationMetadata>
+  read(llvm::StringRef Buffer) {
+    revng_assert(Buffer.startswith(InvalidationMetadataMagic));
+    Reader Input(Buffer.drop_front(InvalidationMetadataMagic.size()));
+    StoredInvalidationMetadata Result;
+
+    uint64_t StringsCount = Input.readCount();
+    Result.Strings.reserve(StringsCount);
+    for (uint64_t I = 0; I < StringsCount and not Input.Failed; ++I)
+      Result.Strings.push_back(Input.readBytes(Input.readULEB()));
+
+    auto IsString = [&Result](uint64_t ID) {
+      return ID < Result.Strings.size();
+    };
+
+    uint64_t SectionsCount = Input.readCount();
+    for (uint64_t I = 0; I < SectionsCount and not Input.Failed; ++I) {
+      Section &New = Result.Sections.emplace_back();
+      New.GlobalName = Input.readULEB();
+      Input.check(IsString(New.GlobalName));
+
+      uint64_t EntriesCount = Input.readCount();
+      int64_t Previous = 0;
+      for (uint64_t J = 0; J < EntriesCount and not Input.Failed; ++J) {
+        Previous += Input.readSLEB();
+        Input.check(Previous >= 0 and IsString(Previous));
+        New.Targets.push_back(Previous);
+      }
+
+      for (uint64_t J = 0; J < EntriesCount and not Input.Failed; ++J) {
+        New.Pipes.push_back(Input.readULEB());
+        Input.check(IsString(New.Pipes.back()));
+      }
+
+      for (uint64_t J = 0; J < EntriesCount and not Input.Failed; ++J)
+        New.PathCounts.push_back(Input.readCount());
+
+      for (uint64_t Count : New.PathCounts) {
+        uint64_t PreviousPath = 0;
+        for (uint64_t J = 0; J < Count and not Input.Failed; ++J) {
+          PreviousPath += Input.readULEB();
+          Input.check(IsString(PreviousPath));
+          New.Paths.push_back(PreviousPath);
+        }
+      }
+    }
+
+    Input.check(Input.Data.empty());
+    if (Input.Failed)
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     "Malformed invalidation metadata");
+
+    return Result;
+  }
+
+private:
+  uint64_t intern(llvm::StringRef String) {
+    auto [It, New] = Index.try_emplace(String, Strings.size());
+    if (New)
+      Strings.push_back(It->first());
+    return It->second;
+  }
+
+  struct Reader {
+    llvm::StringRef Data;
+    bool Failed = false;
+
+    explicit Reader(llvm::StringRef Data) : Data(Data) {}
+
+    void check(bool Condition) { Failed = Failed or not Condition; }
+
+    uint64_t readULEB() {
+      if (Failed)
+        return 0;
+
+      unsigned Length = 0;
+      const char *Error = nullptr;
+      uint64_t Result = decodeULEB128(Data.bytes_begin(),
+                                      &Length,
+                                      Data.bytes_end(),
+                                      &Error);
+      check(Error == nullptr);
+      Data = Data.drop_front(Length);
+      return Failed ? 0 : Result;
+    }
+
+    int64_t readSLEB() {
+      if (Failed)
+        return 0;
+
+      unsigned Length = 0;
+      const char *Error = nullptr;
+      int64_t Result = decodeSLEB128(Data.bytes_begin(),
+                                     &Length,
+                                     Data.bytes_end(),
+                                     &Error);
+      check(Error == nullptr);
+      Data = Data.drop_front(Length);
+      return Failed ? 0 : Result;
+    }
+
+    /// Read the number of elements of a sequence, each of which takes at least
+    /// a byte, hence it cannot exceed what's left
+    uint64_t readCount() {
+      uint64_t Result = readULEB();
+      check(Result <= Data.size());
+      return Failed ? 0 : Result;
+    }
+
+    llvm::StringRef readBytes(uint64_t Size) {
+      check(Size <= Data.size());
+      if (Failed)
+        return {};
+
+      llvm::StringRef Result = Data.take_front(Size);
+      Data = Data.drop_front(Size);
+      return Result;
+    }
+  };
+};
+
+} // namespace
+
+using PathType = std::vector<std::string>;
+
+/// \return the path all the targets of \p Targets have, ignoring the ones with
+///         an empty path, nullptr if there's more than one or none
+static const PathType *getCommonPath(const ContainerToTargetsMap &Targets) {
+  const PathType *Result = nullptr;
+  for (const auto &Entry : Targets) {
+    for (const Target &Target : Entry.second) {
+      const PathType &Path = Target.getPathComponents();
+      if (Path.empty())
+        continue;
+
+      if (Result == nullptr)
+        Result = &Path;
+      else if (*Result != Path)
+        return nullptr;
+    }
+  }
+
+  return Result;
+}
+
+static bool hasOnlyPath(const ContainerToTargetsMap &Targets,
+                        const PathType &Path) {
+  for (const auto &Entry : Targets)
+    for (const Target &Target : Entry.second)
+      if (not Target.getPathComponents().empty()
+          and Target.getPathComponents() != Path)
+        return false;
+  return true;
+}
+
+/// \return \p Targets with all the non-empty paths replaced by \p Path
+static ContainerToTargetsMap replacePath(const ContainerToTargetsMap &Targets,
+                                         const PathType &Path) {
+  ContainerToTargetsMap Result;
+  for (const auto &Entry : Targets) {
+    TargetsList &List = Result[Entry.first()];
+    for (const Target &Target : Entry.second) {
+      if (Target.getPathComponents().empty())
+        List.push_back(Target);
+      else
+        List.emplace_back(Path, Target.getKind());
+    }
+  }
+  return Result;
+}
+
+/// \return a string identifying the containers and the kinds of \p Targets
+static std::string getKindsSignature(const ContainerToTargetsMap &Targets) {
+  llvm::SmallVector<std::string, 4> Containers;
+  for (const auto &Entry : Targets) {
+    std::string Signature = Entry.first().str();
+    for (const Target &Target : Entry.second)
+      Signature += "/" + Target.getKind().name().str();
+    Containers.push_back(std::move(Signature));
+  }
+  llvm::sort(Containers);
+
+  std::string Result;
+  for (const std::string &Signature : Containers)
+    Result += Signature + "\n";
+  return Result;
+}
+
 std::pair<ContainerToTargetsMap, std::vector<PipeExecutionEntry>>
 Step::analyzeGoals(const ContainerToTargetsMap &RequiredGoals) const {
 
@@ -225,6 +523,34 @@ Step::analyzeGoals(const ContainerToTargetsMap &RequiredGoals) const {
   ContainerToTargetsMap Targets = RequiredGoals;
   removeSatisfiedGoals(Targets, AlreadyAvailable);
 
+  // Contracts either preserve the path of targets or expand them to all the
+  // targets of a kind in the current globals. If the plan for a path of some
+  // kinds only ever contained that path, it holds for any other path of those
+  // kinds, until the globals change.
+  std::string Signature;
+  const PathType *RequestedPath = getCommonPath(Targets);
+  uint64_t CommitIndex = TheContext->getCommitIndex();
+  if (RequestedPath != nullptr) {
+    Signature = getKindsSignature(Targets);
+    auto It = PlanTemplates.find(Signature);
+    if (It != PlanTemplates.end() and It->second.CommitIndex == CommitIndex) {
+      const PlanTemplate &Template = It->second;
+      std::vector<PipeExecutionEntry> PipesExecutionEntries;
+      for (const PipeExecutionEntry &Entry : Template.PipesExecutionEntries)
+        PipesExecutionEntries.emplace_back(replacePath(Entry.Output,
+                                                       *RequestedPath),
+                                           replacePath(Entry.Input,
+                                                       *RequestedPath));
+      return std::make_pair(replacePath(Template.Required, *RequestedPath),
+                            std::move(PipesExecutionEntries));
+    }
+  }
+
+  // Targets is about to be overwritten
+  std::optional<PathType> Path;
+  if (RequestedPath != nullptr)
+    Path = *RequestedPath;
+
   std::vector<PipeExecutionEntry> PipesExecutionEntries;
   for (const PipeWrapper &Pipe :
        llvm::make_range(Pipes.rbegin(), Pipes.rend())) {
@@ -234,6 +560,21 @@ Step::analyzeGoals(const ContainerToTargetsMap &RequiredGoals) const {
   }
   std::reverse(PipesExecutionEntries.begin(), PipesExecutionEntries.end());
 
+  if (Path.has_value()) {
+    bool PreservesPath = hasOnlyPath(Targets, *Path);
+    for (const PipeExecutionEntry &Entry : PipesExecutionEntries)
+      PreservesPath = PreservesPath and hasOnlyPath(Entry.Input, *Path)
+                      and hasOnlyPath(Entry.Output, *Path);
+
+    if (PreservesPath)
+      PlanTemplates.insert_or_assign(Signature,
+                                     PlanTemplate{ CommitIndex,
+                                                   Targets,
+                                                   PipesExecutionEntries });
+    else
+      PlanTemplates.erase(Signature);
+  }
+
   return std::make_pair(std::move(Targets), std::move(PipesExecutionEntries));
 }
 
@@ -282,18 +623,81 @@ ContainerSet Step::run(ContainerSet &&Input,
   ContainerToTargetsMap InputEnumeration = Input.enumerate();
   explainStartStep(InputEnumeration);
 
+  TraceScope StepTrace(getName(), "step");
+
   Task T(Pipes.size() + 1, "Step " + getName());
   for (const auto &[Pipe, Info] : llvm::zip(Pipes, ExecutionInfos)) {
     T.advance(Pipe.Pipe->getName(), false);
+    if (TheContext->isCancellationRequested())
+      break;
+
     explainExecutedPipe(*Pipe.Pipe);
 
-    ExecutionContext EC(*TheContext, &Pipe, Info.Output);
+    TraceScope PipeTrace(Pipe.Pipe->getName(), "pipe");
+    FunctionCostPipeScope PipeCost(Pipe.Pipe->getName());
+    PipeTrace.addArgument("step", getName());
+    PipeTrace.addTargets("input-targets", Info.Input);
+    PipeTrace.addTargets("output-targets", Info.Output);
+
+    // Look for the results of an identical invocation in the artifact cache
+    ArtifactCache *Cache = ArtifactCache::get();
+    std::optional<std::string> CacheKey;
+    if (Cache != nullptr) {
+      CacheKey = ArtifactCache::computeKey(*TheContext,
+                                           Pipe,
+                                           Input,
+                                           Info.Output);
+      if (CacheKey.has_value()) {
+        auto MaybeRestored = Cache->restore(*CacheKey,
+                                            *TheContext,
+                                            Pipe,
+                                            Input);
+        if (not MaybeRestored) {
+          revng_log(ExplanationLogger,
+                    "Cannot restore from the artifact cache: "
+                      << toString(MaybeRestored.takeError()));
+        } else if (*MaybeRestored) {
+          llvm::cantFail(Input.verify());
+          PipeTrace.addArgument("cached", true);
+          PipeTrace.addSerializedSize(Input,
+                                      Pipe.Pipe->getRunningContainersNames());
+          continue;
+        }
+      }
+    }
+
+    {
+      ExecutionContext EC(*TheContext, &Pipe, Info.Output);
+
+      Pipe.Pipe->deduceResults(*TheContext, EC.getCurrentRequestedTargets());
 
-    Pipe.Pipe->deduceResults(*TheContext, EC.getCurrentRequestedTargets());
+      cantFail(Pipe.Pipe->run(EC, Input));
+      llvm::cantFail(Input.verify());
+      if (TheContext->isCancellationRequested())
+        break;
+      EC.verify();
+    }
+
+    PipeTrace.addSerializedSize(Input, Pipe.Pipe->getRunningContainersNames());
+
+    if (CacheKey.has_value()) {
+      if (auto Error = Cache->store(*CacheKey,
+                                    *TheContext,
+                                    Pipe,
+                                    Input,
+                                    Info.Output)) {
+        revng_log(ExplanationLogger,
+                  "Cannot store into the artifact cache: "
+                    << toString(std::move(Error)));
+      }
+    }
+  }
 
-    cantFail(Pipe.Pipe->run(EC, Input));
-    llvm::cantFail(Input.verify());
-    EC.verify();
+  // The last pipe might not have committed all the requested targets, don't
+  // merge back anything
+  if (TheContext->isCancellationRequested()) {
+    revng_log(ExplanationLogger, "Step " << getName() << " has been cancelled");
+    return Containers.cloneFiltered(ContainerToTargetsMap());
   }
 
   T.advance("Merging back", true);
@@ -328,6 +732,7 @@ llvm::Error Step::runAnalysis(llvm::StringRef AnalysisName,
 
   ContainerSet Cloned = Containers.cloneFiltered(Targets);
   ExecutionContext EC(*TheContext, nullptr);
+  FunctionCostPipeScope AnalysisCost(AnalysisName);
   return TheAnalysis->run(EC, Cloned, ExtraArgs);
 }
 
@@ -369,16 +774,230 @@ Error Step::invalidate(const ContainerToTargetsMap &ToRemove) {
   for (auto &Pipe : Pipes) {
     Pipe.InvalidationMetadata.remove(ToRemove);
   }
-  return containers().remove(ToRemove);
+
+  recordStaleHashes(ToRemove);
+
+  // Suspended targets are not in the backing containers
+  ContainerToTargetsMap FromContainers = ToRemove;
+  if (Suspended.size() != 0) {
+    ContainerToTargetsMap FromSuspended = ToRemove;
+    Suspended.intersect(FromSuspended);
+    FromContainers.erase(FromSuspended);
+    if (auto Error = Suspended.remove(FromSuspended))
+      return Error;
+  }
+
+  return containers().remove(FromContainers);
+}
+
+static std::string hashTarget(const ContainerBase &Container,
+                              const Target &Target) {
+  llvm::raw_sha1_ostream OS;
+  if (llvm::Error Error = Container.extractOne(OS, Target)) {
+    llvm::consumeError(std::move(Error));
+    return "";
+  }
+
+  return OS.sha1().str();
+}
+
+void Step::recordStaleHashes(const ContainerToTargetsMap &Targets) {
+  if (not EarlyCutoff)
+    return;
+
+  for (const auto &Entry : Targets) {
+    llvm::StringRef ContainerName = Entry.first();
+    if (not Containers.contains(ContainerName))
+      continue;
+
+    const ContainerBase &Container = Containers.at(ContainerName);
+    for (const Target &Target : Entry.second.intersect(Container.enumerate())) {
+      TargetInContainer Key(Target, ContainerName.str());
+      StaleHashes.insert_or_assign(Key, hashTarget(Container, Target));
+    }
+  }
+}
+
+bool Step::hasStaleTargets(const ContainerToTargetsMap &Targets) const {
+  for (const auto &Entry : Targets) {
+    std::string ContainerName = Entry.first().str();
+    for (const Target &Target : Entry.second)
+      if (StaleHashes.contains(TargetInContainer(Target, ContainerName)))
+        return true;
+  }
+
+  return false;
+}
+
+Error Step::suspend(const ContainerToTargetsMap &ToSuspend) {
+  if (not EarlyCutoff)
+    return invalidate(ToSuspend);
+
+  // Note: the invalidation metadata is preserved, so that suspended targets
+  //       can still be invalidated by changes to the globals
+  recordStaleHashes(ToSuspend);
+  ContainerSet Extracted = Containers.cloneFiltered(ToSuspend);
+  if (auto Error = Containers.remove(ToSuspend))
+    return Error;
+
+  if (Suspended.size() == 0)
+    Suspended = std::move(Extracted);
+  else
+    Suspended.mergeBack(std::move(Extracted));
+
+  return Error::success();
+}
+
+bool Step::reviveSuspended(const ContainerToTargetsMap &Goals) {
+  if (Suspended.size() == 0 or not hasPredecessor())
+    return false;
+
+  ContainerToTargetsMap Candidates = Goals;
+  Suspended.intersect(Candidates);
+
+  // A suspended target can be restored if everything it is produced from is
+  // available in the previous step and has not changed in the meantime
+  const Step &Previous = getPredecessor();
+  ContainerToTargetsMap PreviousContent = Previous.containers().enumerate();
+  ContainerToTargetsMap ToRevive;
+  for (const auto &Entry : Candidates) {
+    for (const Target &Target : Entry.second) {
+      ContainerToTargetsMap Goal;
+      Goal.add(Entry.first(), Target);
+      ContainerToTargetsMap Required = analyzeGoals(Goal).first;
+      if (PreviousContent.contains(Required)
+          and not Previous.hasStaleTargets(Required))
+        ToRevive.add(Entry.first(), Target);
+    }
+  }
+
+  if (ToRevive.empty())
+    return false;
+
+  revng_log(ExplanationLogger, "Restoring suspended targets in " << Name);
+  ContainerSet Revived = Suspended.cloneFiltered(ToRevive);
+  llvm::cantFail(Suspended.remove(ToRevive));
+  Containers.mergeBack(std::move(Revived));
+
+  for (const auto &Entry : ToRevive) {
+    std::string ContainerName = Entry.first().str();
+    for (const Target &Target : Entry.second)
+      StaleHashes.erase(TargetInContainer(Target, ContainerName));
+  }
+
+  return true;
+}
+
+ContainerToTargetsMap Step::settleStaleTargets() {
+  ContainerToTargetsMap Changed;
+  if (StaleHashes.empty())
+    return Changed;
+
+  ContainerToTargetsMap Available = Containers.enumerate();
+  ContainerToTargetsMap Settled;
+  for (auto It = StaleHashes.begin(); It != StaleHashes.end();) {
+    const auto &[Key, Hash] = *It;
+    llvm::StringRef ContainerName = Key.getContainerName();
+    auto AvailableIt = Available.find(ContainerName);
+    if (AvailableIt == Available.end()
+        or not AvailableIt->second.contains(Key.getTarget())) {
+      ++It;
+      continue;
+    }
+
+    const ContainerBase &Container = Containers.at(ContainerName);
+    if (Hash.empty() or hashTarget(Container, Key.getTarget()) != Hash)
+      Changed.add(ContainerName, Key.getTarget());
+    Settled.add(ContainerName, Key.getTarget());
+
+    It = StaleHashes.erase(It);
+  }
+
+  // A suspended target that has been produced again is no longer suspended
+  dropSuspended(Settled);
+
+  return Changed;
+}
+
+void Step::dropSuspended(const ContainerToTargetsMap &ToDrop) {
+  if (Suspended.size() == 0)
+    return;
+
+  ContainerToTargetsMap Present = ToDrop;
+  Suspended.intersect(Present);
+  llvm::cantFail(Suspended.remove(Present));
 }
 
 Error Step::store(const revng::DirectoryPath &DirPath) const {
+  // The targets of a container that is already stored there did not change
+  llvm::StringSet<> Unchanged;
+  for (const auto &Entry : Containers.entries())
+    if (Containers.isStored(Entry.first(), DirPath))
+      Unchanged.insert(Entry.first());
+
   if (auto Error = Containers.store(DirPath))
     return Error;
 
+  if (auto Error = storeTargets(DirPath, Unchanged))
+    return Error;
+
   return storeInvalidationMetadata(DirPath);
 }
 
+Error Step::storeTargets(const revng::DirectoryPath &DirPath,
+                         const llvm::StringSet<> &Skip) const {
+  for (const auto &Entry : Containers.enumerate()) {
+    if (Skip.contains(Entry.first()))
+      continue;
+
+    auto File = DirPath.getFile(Entry.first().str() + ".targets")
+                  .getWritableFile();
+    if (not File)
+      return File.takeError();
+
+    for (const Target &Target : Entry.second)
+      File->get()->os() << Target.toString() << "\n";
+
+    if (auto Error = File->get()->commit())
+      return Error;
+  }
+
+  return Error::success();
+}
+
+Expected<std::optional<TargetsList>>
+Step::loadTargets(const revng::DirectoryPath &DirPath,
+                  llvm::StringRef ContainerName) const {
+  auto FilePath = DirPath.getFile(ContainerName.str() + ".targets");
+  auto MaybeBool = FilePath.exists();
+  if (not MaybeBool)
+    return MaybeBool.takeError();
+
+  if (not MaybeBool.get())
+    return std::nullopt;
+
+  auto File = FilePath.getReadableFile();
+  if (not File)
+    return File.takeError();
+
+  llvm::SmallVector<llvm::StringRef> Lines;
+  File.get()->buffer().getBuffer().split(Lines, '\n', -1, false);
+
+  TargetsList Result;
+  for (llvm::StringRef Line : Lines) {
+    const auto &Registry = TheContext->getKindsRegistry();
+    if (auto Error = parseTarget(*TheContext, Line, Registry, Result)) {
+      // E.g., a kind has been renamed, the container will be loaded
+      revng_log(ExplanationLogger,
+                "Cannot parse the targets of " << ContainerName << ": "
+                                               << toString(std::move(Error)));
+      return std::nullopt;
+    }
+  }
+
+  return Result;
+}
+
 Error Step::checkPrecondition() const {
   for (const PipeWrapper &Pipe : Pipes) {
     if (llvm::Error Error = Pipe.Pipe->checkPrecondition(*TheContext)) {
@@ -398,15 +1017,40 @@ Error Step::load(const revng::DirectoryPath &DirPath) {
   if (not MaybeBool.get())
     return llvm::Error::success();
 
-  if (auto Error = Containers.load(DirPath))
+  // Containers are only deserialized when first accessed
+  auto ReadTargets = [this, &DirPath](llvm::StringRef ContainerName) {
+    return loadTargets(DirPath, ContainerName);
+  };
+  if (auto Error = Containers.loadLazily(DirPath, ReadTargets))
     return Error;
 
+  // What has been invalidated before does not relate to the loaded targets
+  Suspended = ContainerSet();
+  StaleHashes.clear();
+
   return loadInvalidationMetadata(DirPath);
 }
 
+void Step::shareFrom(const Step &Other) {
+  revng_assert(Name == Other.Name and Pipes.size() == Other.Pipes.size());
+
+  Containers.shareFrom(Other.Containers);
+  Suspended = ContainerSet();
+  Suspended.shareFrom(Other.Suspended);
+  StaleHashes = Other.StaleHashes;
+
+  // The targets depend on the globals the same way they do in Other
+  for (auto &&[Pipe, OtherPipe] : llvm::zip(Pipes, Other.Pipes)) {
+    revng_assert(Pipe.Pipe->getName() == OtherPipe.Pipe->getName());
+    Pipe.InvalidationMetadata = OtherPipe.InvalidationMetadata;
+  }
+
+  PlanTemplates.clear();
+}
+
 llvm::Error
 Step::loadInvalidationMetadataImpl(const revng::DirectoryPath &Path,
-                                   ContainerSet::value_type &Container) {
+                                   const ContainerSet::value_type &Container) {
   auto FilePath = Path.getFile(Container.first().str() + ".cache");
   auto MaybeBool = FilePath.exists();
   if (not MaybeBool)
@@ -419,8 +1063,77 @@ Step::loadInvalidationMetadataImpl(const revng::DirectoryPath &Path,
   if (not File)
     return File.takeError();
 
+  llvm::StringRef Buffer = File.get()->buffer().getBuffer();
+  if (not Buffer.startswith(InvalidationMetadataMagic))
+    return loadYAMLInvalidationMetadata(Buffer, Container);
+
+  auto MaybeStored = StoredInvalidationMetadata::read(Buffer);
+  if (not MaybeStored)
+    return MaybeStored.takeError();
+  const StoredInvalidationMetadata &Stored = *MaybeStored;
+
+  llvm::StringMap<llvm::SmallVector<PipeWrapper *, 1>> PipesByName;
+  for (PipeWrapper &Pipe : Pipes)
+    PipesByName[Pipe.Pipe->getName()].push_back(&Pipe);
+
+  // Parse each target and each path only once
+  using TargetsInContainer = llvm::SmallVector<TargetInContainer, 2>;
+  llvm::DenseMap<uint64_t, TargetsInContainer> ParsedTargets;
+  for (const auto &Section : Stored.Sections) {
+    llvm::StringRef GlobalName = Stored.Strings[Section.GlobalName];
+    Global *Global = llvm::cantFail(TheContext->getGlobals().get(GlobalName));
+    llvm::DenseMap<uint64_t, TupleTreePath> ParsedPaths;
+
+    auto PathIt = Section.Paths.begin();
+    for (size_t I = 0; I < Section.Targets.size(); ++I) {
+      auto Paths = llvm::make_range(PathIt, PathIt + Section.PathCounts[I]);
+      PathIt += Section.PathCounts[I];
+
+      auto PipesIt = PipesByName.find(Stored.Strings[Section.Pipes[I]]);
+      if (PipesIt == PipesByName.end())
+        continue;
+
+      auto TargetIt = ParsedTargets.find(Section.Targets[I]);
+      if (TargetIt == ParsedTargets.end()) {
+        TargetInPipe Target;
+        Target.SerializedTarget = Stored.Strings[Section.Targets[I]].str();
+        auto MaybeTargets = Target.deserialize(*TheContext, Container.first());
+        if (not MaybeTargets)
+          return MaybeTargets.takeError();
+        TargetIt = ParsedTargets.try_emplace(Section.Targets[I],
+                                             std::move(*MaybeTargets))
+                     .first;
+      }
+
+      for (uint64_t PathID : Paths) {
+        auto ParsedIt = ParsedPaths.find(PathID);
+        if (ParsedIt == ParsedPaths.end()) {
+          llvm::StringRef Serialized = Stored.Strings[PathID];
+          auto Path = Global->deserializePath(Serialized);
+          if (not Path)
+            return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                           "could not parse " + Serialized);
+          ParsedIt = ParsedPaths.try_emplace(PathID, std::move(*Path)).first;
+        }
+
+        for (PipeWrapper *Pipe : PipesIt->second) {
+          PathTargetBimap &Bimap = Pipe->InvalidationMetadata
+                                     .getPathCache(GlobalName);
+          for (const TargetInContainer &Target : TargetIt->second)
+            Bimap.insert(Target, ParsedIt->second);
+        }
+      }
+    }
+  }
+
+  return llvm::Error::success();
+}
+
+llvm::Error
+Step::loadYAMLInvalidationMetadata(llvm::StringRef Buffer,
+                                   const ContainerSet::value_type &Container) {
   using Type = llvm::SmallVector<NamedPathTargetBimapVector, 2>;
-  auto Parsed = ::fromString<Type>(File.get()->buffer().getBuffer());
+  auto Parsed = ::fromString<Type>(Buffer);
   if (not Parsed)
     return Parsed.takeError();
 
@@ -446,7 +1159,7 @@ llvm::Error Step::loadInvalidationMetadata(const revng::DirectoryPath &Path) {
   for (PipeWrapper &Pipe : Pipes) {
     Pipe.InvalidationMetadata = {};
   }
-  for (auto &Container : Containers) {
+  for (const auto &Container : Containers.entries()) {
     if (llvm::Error Error = loadInvalidationMetadataImpl(Path, Container))
       return Error;
   }
@@ -456,39 +1169,38 @@ llvm::Error Step::loadInvalidationMetadata(const revng::DirectoryPath &Path) {
 
 llvm::Error
 Step::storeInvalidationMetadata(const revng::DirectoryPath &Path) const {
-  for (auto &Container : Containers) {
-    if (Container.second == nullptr)
+  for (const auto &Container : Containers.entries()) {
+    if (not Containers.contains(Container.first()))
       continue;
 
-    using Type = llvm::SmallVector<NamedPathTargetBimapVector, 2>;
-    Type ToStore = {};
-
+    StoredInvalidationMetadata ToStore;
     for (const Global *Global : TheContext->getGlobals()) {
-      NamedPathTargetBimapVector Entry;
-      Entry.GlobalName = Global->getName();
+      ContainerInvalidationMetadata Metadata;
 
       for (const PipeWrapper &Pipe : Pipes) {
         auto &PathCache = Pipe.InvalidationMetadata.getPathCache();
-        if (PathCache.count(Entry.GlobalName) == 0)
+        if (PathCache.count(Global->getName()) == 0)
           continue;
 
         using MetadataType = ContainerInvalidationMetadata;
         auto Serialize = MetadataType::serialize;
         MetadataType Serialized = Serialize(Pipe.InvalidationMetadata
-                                              .getPathCache(Entry.GlobalName),
+                                              .getPathCache(Global->getName()),
                                             *Global,
                                             Pipe.Pipe->getName(),
                                             Container.first());
-        Entry.Map.merge(std::move(Serialized));
+        Metadata.merge(std::move(Serialized));
       }
-      ToStore.emplace_back(std::move(Entry));
+
+      if (not Metadata.Data.empty())
+        ToStore.add(Global->getName(), Metadata);
     }
 
     auto File = Path.getFile(Container.first().str() + ".cache")
                   .getWritableFile();
     if (not File)
       return File.takeError();
-    ::serialize(File->get()->os(), ToStore);
+    ToStore.write(File->get()->os());
     if (auto Error = File->get()->commit())
       return Error;
   }
@@ -499,7 +1211,9 @@ Step::storeInvalidationMetadata(const revng::DirectoryPath &Path) const {
 std::vector<revng::FilePath>
 Step::getWrittenFiles(const revng::DirectoryPath &DirPath) const {
   std::vector<revng::FilePath> Result = Containers.getWrittenFiles(DirPath);
-  for (auto &Container : Containers)
+  for (const auto &Container : Containers.entries()) {
     Result.push_back(DirPath.getFile(Container.first().str() + ".cache"));
+    Result.push_back(DirPath.getFile(Container.first().str() + ".targets"));
+  }
   return Result;
 }
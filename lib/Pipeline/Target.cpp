@@ -21,7 +21,7 @@ using namespace std;
 using namespace llvm;
 
 bool TargetsList::contains(const Target &Target) const {
-  return find(*this, Target) != end();
+  return std::binary_search(begin(), end(), Target);
 }
 
 void TargetsList::merge(const TargetsList &Source) {
@@ -133,23 +133,23 @@ llvm::Error pipeline::parseTarget(const Context &Context,
   llvm::SmallVector<llvm::StringRef, 4> Path;
   Name.split(Path, '/');
 
-  auto It = llvm::find_if(Dict, [&](Kind &K) { return KindName == K.name(); });
-  if (It == Dict.end())
+  const Kind *TheKind = Dict.find(KindName);
+  if (TheKind == nullptr)
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "No known Kind '%s' in dictionary",
                                    KindName.str().c_str());
 
   if (AsString[0] == ':') {
-    Out.push_back(Target({}, *It));
+    Out.push_back(Target({}, *TheKind));
     return llvm::Error::success();
   }
 
   if (find(AsString, '*') != AsString.end()) {
-    It->appendAllTargets(Context, Out);
+    TheKind->appendAllTargets(Context, Out);
     return llvm::Error::success();
   }
 
-  Out.push_back(Target(std::move(Path), *It));
+  Out.push_back(Target(std::move(Path), *TheKind));
   return llvm::Error::success();
 }
 
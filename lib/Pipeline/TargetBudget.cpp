@@ -0,0 +1,46 @@
+/// \file TargetBudget.cpp
+/// Implementation of the per-target time budget of pipes.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/Support/CommandLine.h"
+
+#include "revng/Pipeline/TargetBudget.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/Statistics.h"
+
+using namespace pipeline;
+
+static llvm::cl::opt<unsigned> TimeBudget("target-time-budget-ms",
+                                          llvm::cl::desc("Time, in "
+                                                         "milliseconds, after "
+                                                         "which pipes degrade "
+                                                         "the results of a "
+                                                         "function, 0 means no "
+                                                         "limit"),
+                                          llvm::cl::init(0));
+
+static Logger<> Log("target-budget");
+
+static CounterMap<std::string> OverBudget("target-budget");
+
+static std::chrono::milliseconds budget() {
+  return std::chrono::milliseconds(TimeBudget);
+}
+
+TargetBudgetScope::TargetBudgetScope(const MetaAddress &Entry) :
+  Entry(Entry), Deadline(budget()) {
+}
+
+TargetBudgetScope::~TargetBudgetScope() {
+  if (not revng::DeadlineScope::expired())
+    return;
+
+  revng_log(Log,
+            Entry.toString() << " exceeded its time budget of "
+                             << TimeBudget.getValue()
+                             << " ms, its results have been degraded");
+  OverBudget.push(Entry.toString());
+}
@@ -30,6 +30,7 @@
 #include "revng/Pipes/PipelineManager.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/InitRevng.h"
+#include "revng/Support/Statistics.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 
 #include "Tracing/Wrapper.h"
@@ -245,6 +246,19 @@ static void _rp_manager_destroy(rp_manager *manager) {
   delete manager;
 }
 
+static rp_manager *_rp_manager_fork(const rp_manager *manager) {
+  revng_check(manager != nullptr);
+
+  auto MaybeFork = manager->fork();
+  if (auto Error = MaybeFork.takeError()) {
+    llvm::errs() << "Pipeline fork failed: " << Error << "\n";
+    llvm::consumeError(std::move(Error));
+    return nullptr;
+  }
+
+  return new PipelineManager(std::move(*MaybeFork));
+}
+
 static rp_step *_rp_manager_get_step_from_name(rp_manager *manager,
                                                const char *name) {
   revng_check(manager != nullptr);
@@ -257,9 +271,16 @@ _rp_step_get_container(rp_step *step, rp_container_identifier *container) {
   revng_check(step != nullptr);
   revng_check(container != nullptr);
 
-  if (step->containers().isContainerRegistered(container->first())) {
-    step->containers()[container->first()];
-    return &*step->containers().find(container->first());
+  llvm::StringRef Name = container->first();
+  pipeline::ContainerSet &Containers = step->containers();
+  if (Containers.isContainerRegistered(Name)) {
+    if (not Containers.contains(Name))
+      Containers[Name];
+
+    // The container is only going to be read: don't count this as a change,
+    // which would copy a container shared with a fork
+    const pipeline::ContainerSet &AsConst = Containers;
+    return const_cast<rp_container *>(&*AsConst.find(Name));
   } else {
     return nullptr;
   }
@@ -362,6 +383,37 @@ static rp_buffer *_rp_manager_produce_targets(rp_manager *manager,
   return Out;
 }
 
+static bool
+_rp_manager_produce_targets_batch(rp_manager *manager,
+                                  uint64_t requests_count,
+                                  const rp_step *steps[],
+                                  const rp_container_targets_map *targets[],
+                                  rp_error *error) {
+  revng_check(manager != nullptr);
+  revng_check(requests_count != 0);
+  revng_check(steps != nullptr);
+  revng_check(targets != nullptr);
+
+  Runner::State Requests;
+  for (size_t I = 0; I < requests_count; I++) {
+    revng_check(steps[I] != nullptr);
+    revng_check(targets[I] != nullptr);
+    Requests[steps[I]->getName()].merge(*targets[I]);
+  }
+
+  if (auto Error = manager->materializeTargets(Requests)) {
+    llvmErrorToRpError(std::move(Error), error);
+    return false;
+  }
+
+  return true;
+}
+
+static void _rp_manager_request_cancellation(rp_manager *manager) {
+  revng_check(manager != nullptr);
+  manager->context().requestCancellation();
+}
+
 static rp_target *_rp_target_create(const rp_kind *kind,
                                     uint64_t path_components_count,
                                     const char *path_components[]) {
@@ -451,6 +503,10 @@ static void _rp_string_destroy(char *string) {
   free(string);
 }
 
+static char *_rp_get_statistics() {
+  return copyString(serializeStatistics());
+}
+
 static const rp_container_identifier *
 _rp_manager_get_container_identifier_from_name(const rp_manager *manager,
                                                const char *name) {
@@ -722,6 +778,11 @@ static uint64_t _rp_manager_get_context_commit_index(rp_manager *manager) {
   return manager->context().getCommitIndex();
 }
 
+static char *_rp_manager_get_memory_usage(const rp_manager *manager) {
+  revng_check(manager != nullptr);
+  return copyString(manager->getRunner().serializeMemoryUsage());
+}
+
 // NOLINTEND
 
 // Import the autogenerated wrappers, these will contains calls to the
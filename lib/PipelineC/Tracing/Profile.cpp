@@ -0,0 +1,150 @@
+/// \file Profile.cpp
+/// Implements the aggregation and reporting of the timings collected while
+/// replaying a trace.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+
+#include "revng/PipelineC/Tracing/Profile.h"
+#include "revng/Support/Assert.h"
+
+using namespace revng::tracing;
+
+namespace {
+
+struct Statistics {
+  double Mean = 0;
+  double StandardDeviation = 0;
+  uint64_t Min = 0;
+  uint64_t Max = 0;
+};
+
+} // namespace
+
+/// Compute the statistics over \p Runs runs, where the missing ones (i.e., the
+/// runs where the entry was never recorded) count as zero
+static Statistics computeStatistics(const std::vector<uint64_t> &RunTimes,
+                                    size_t Runs) {
+  revng_assert(Runs > 0);
+  std::vector<uint64_t> Values(RunTimes);
+  Values.resize(Runs, 0);
+
+  Statistics Result;
+  Result.Min = *std::min_element(Values.begin(), Values.end());
+  Result.Max = *std::max_element(Values.begin(), Values.end());
+
+  for (uint64_t Value : Values)
+    Result.Mean += Value;
+  Result.Mean /= Runs;
+
+  double SquaredDeviations = 0;
+  for (uint64_t Value : Values)
+    SquaredDeviations += std::pow(Value - Result.Mean, 2);
+  Result.StandardDeviation = std::sqrt(SquaredDeviations / Runs);
+
+  return Result;
+}
+
+void TraceProfile::recordIn(Entry &Target, uint64_t Nanoseconds) {
+  revng_assert(not RunTimes.empty(), "beginRun has not been called");
+  Target.Calls += 1;
+  Target.RunTimes.resize(RunTimes.size(), 0);
+  Target.RunTimes.back() += Nanoseconds;
+}
+
+void TraceProfile::record(llvm::StringRef Function,
+                          llvm::StringRef Step,
+                          uint64_t Nanoseconds) {
+  recordIn(Functions[Function.str()], Nanoseconds);
+  if (not Step.empty())
+    recordIn(Steps[Step.str()], Nanoseconds);
+  RunTimes.back() += Nanoseconds;
+}
+
+static void printTable(llvm::raw_ostream &Output,
+                       llvm::StringRef Title,
+                       const std::map<std::string, TraceProfile::Entry> &Map,
+                       size_t Runs) {
+  using Row = std::pair<std::string, Statistics>;
+  std::vector<Row> Rows;
+  for (const auto &[Name, Entry] : Map)
+    Rows.emplace_back(Name, computeStatistics(Entry.RunTimes, Runs));
+
+  llvm::sort(Rows, [](const Row &LHS, const Row &RHS) {
+    return LHS.second.Mean > RHS.second.Mean;
+  });
+
+  Output << llvm::format("%-48s", Title.str().c_str())
+         << "    calls    mean (ms)  stddev (ms)     min (ms)     max (ms)\n";
+  for (const auto &[Name, Stats] : Rows) {
+    Output << llvm::format("%-48s %8llu %12.3f %12.3f %12.3f %12.3f\n",
+                           Name.c_str(),
+                           static_cast<unsigned long long>(Map.at(Name).Calls
+                                                           / Runs),
+                           Stats.Mean / 1e6,
+                           Stats.StandardDeviation / 1e6,
+                           Stats.Min / 1e6,
+                           Stats.Max / 1e6);
+  }
+  Output << "\n";
+}
+
+void TraceProfile::print(llvm::raw_ostream &Output) const {
+  if (RunTimes.empty())
+    return;
+
+  printTable(Output, "Function", Functions, runs());
+  printTable(Output, "Step", Steps, runs());
+
+  Statistics Total = computeStatistics(RunTimes, runs());
+  Output << llvm::format("Total over %zu runs: mean %.3f ms, stddev %.3f ms, "
+                         "min %.3f ms, max %.3f ms\n",
+                         runs(),
+                         Total.Mean / 1e6,
+                         Total.StandardDeviation / 1e6,
+                         Total.Min / 1e6,
+                         Total.Max / 1e6);
+}
+
+static llvm::json::Object toJSON(const Statistics &Stats) {
+  return llvm::json::Object{ { "mean-ns", Stats.Mean },
+                             { "stddev-ns", Stats.StandardDeviation },
+                             { "min-ns", static_cast<int64_t>(Stats.Min) },
+                             { "max-ns", static_cast<int64_t>(Stats.Max) } };
+}
+
+static llvm::json::Object
+toJSON(const std::map<std::string, TraceProfile::Entry> &Map, size_t Runs) {
+  llvm::json::Object Result;
+  for (const auto &[Name, Entry] : Map) {
+    llvm::json::Object Object = toJSON(computeStatistics(Entry.RunTimes,
+                                                         Runs));
+    Object["calls"] = static_cast<int64_t>(Entry.Calls / Runs);
+    Result[Name] = std::move(Object);
+  }
+  return Result;
+}
+
+void TraceProfile::toJSON(llvm::raw_ostream &Output) const {
+  if (RunTimes.empty()) {
+    Output << "{}\n";
+    return;
+  }
+
+  llvm::json::Object Result{
+    { "runs", static_cast<int64_t>(runs()) },
+    { "total", ::toJSON(computeStatistics(RunTimes, runs())) },
+    { "functions", ::toJSON(Functions, runs()) },
+    { "steps", ::toJSON(Steps, runs()) },
+  };
+  Output << llvm::formatv("{0:2}", llvm::json::Value(std::move(Result)))
+         << "\n";
+}
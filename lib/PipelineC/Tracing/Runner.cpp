@@ -6,6 +6,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <chrono>
 #include <csignal>
 
 #include "llvm/Support/Base64.h"
@@ -121,6 +122,8 @@ class RunnerContext {
 private:
   llvm::StringMap<uintptr_t> Pointers;
   bool ResumeDirectoryUsed = false;
+  /// Name of the step each rp_step pointer of the trace refers to
+  llvm::StringMap<std::string> StepNames;
 
 public:
   const revng::tracing::RunTraceOptions Options;
@@ -181,6 +184,41 @@ public:
 
   void invalidatePointer(const llvm::StringRef Name) { Pointers.erase(Name); }
 
+  /// Record the name of the steps returned by the commands of the trace, so
+  /// that they can be looked up by stepsOf
+  void recordSteps(const revng::tracing::Command &Command) {
+    if (Command.Name == "rp_manager_get_step_from_name"
+        and Command.Result != NullPointer)
+      StepNames[Command.Result] = Command.Arguments[1].getScalar();
+  }
+
+  /// Return the comma-separated names of the steps \p Command targets, if any
+  std::string stepsOf(const revng::tracing::Command &Command) const {
+    if (Command.Name == "rp_manager_run_analysis")
+      return Command.Arguments[1].getScalar();
+
+    std::string Result;
+    auto Append = [&](const std::string &PointerName) {
+      auto It = StepNames.find(PointerName);
+      if (It == StepNames.end())
+        return;
+      if (not Result.empty())
+        Result += ",";
+      Result += It->second;
+    };
+
+    for (const revng::tracing::Argument &Argument : Command.Arguments) {
+      if (Argument.isScalar()) {
+        Append(Argument.getScalar());
+      } else {
+        for (const std::string &Element : Argument.getSequence())
+          Append(Element);
+      }
+    }
+
+    return Result;
+  }
+
 private:
   template<ConstexprString Name, typename ArgT, size_t I>
     requires(anyOf<ArgT, char *, const char *>())
@@ -454,6 +492,9 @@ llvm::Error Trace::run(const revng::tracing::RunTraceOptions Options) const {
   const tracing::Command &FirstCommand = this->Commands.front();
   const tracing::Command &LastCommand = this->Commands.back();
 
+  if (Options.Profile != nullptr)
+    Options.Profile->beginRun();
+
   // Allow rp_initialize as first command and rp_shutdown as last, in all other
   // cases the trace is malformed and needs to be aborted
   const size_t FirstCommandI = FirstCommand.Name == "rp_initialize" ? 1 : 0;
@@ -469,7 +510,20 @@ llvm::Error Trace::run(const revng::tracing::RunTraceOptions Options) const {
     if (Options.BreakAt.contains(CommandI))
       raise(SIGTRAP);
 
+    if (Options.Profile == nullptr) {
+      CommandHandler[Command.Name](Context, Arguments, Command.Result);
+      continue;
+    }
+
+    using namespace std::chrono;
+    auto Start = steady_clock::now();
     CommandHandler[Command.Name](Context, Arguments, Command.Result);
+    auto Elapsed = duration_cast<nanoseconds>(steady_clock::now() - Start);
+
+    Context.recordSteps(Command);
+    Options.Profile->record(Command.Name,
+                            Context.stepsOf(Command),
+                            Elapsed.count());
   }
 
   return llvm::Error::success();
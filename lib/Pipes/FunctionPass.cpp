@@ -11,7 +11,9 @@
 #include "revng/Model/LoadModelPass.h"
 #include "revng/Pipeline/Context.h"
 #include "revng/Pipeline/ExecutionContext.h"
+#include "revng/Pipeline/FunctionCostReport.h"
 #include "revng/Pipeline/LLVMKind.h"
+#include "revng/Pipeline/TargetBudget.h"
 #include "revng/Pipes/FunctionPass.h"
 #include "revng/Pipes/TaggedFunctionKind.h"
 #include "revng/Support/FunctionTags.h"
@@ -35,6 +37,8 @@ bool pipeline::detail::runOnModule(llvm::Module &Module,
   llvm::Task T(Analysis.getRequestedTargets().size(), "Running FunctionPass");
   for (const auto &[ModelFunction, LLVMFunction] : ToIterOn) {
     T.advance(ModelFunction->Entry().toString(), true);
+    FunctionCostScope Cost(ModelFunction->Entry(), LLVMFunction);
+    TargetBudgetScope Budget(ModelFunction->Entry());
     Result = Pipe.runOnFunction(*ModelFunction, *LLVMFunction) or Result;
   }
 
@@ -41,14 +41,18 @@ static llvm::Error applyDiffImpl(pipeline::ExecutionContext &EC,
   if (auto ApplyError = GlobalClone->applyDiff(Diff); ApplyError)
     return ApplyError;
 
-  if (not GlobalClone->verify()) {
+  // The global verified before applying the diff, only check what changed
+  if (not GlobalClone->verify(Diff)) {
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "could not verify %s",
                                    DiffGlobalName.c_str());
   }
 
+  // The diff applies cleanly, since it did on the clone: apply it again, rather
+  // than copying the clone back, so that the pipeline can record the diff as
+  // it is
   if constexpr (commit) {
-    *Global = *GlobalClone;
+    Global->applyKnownDiff(Diff);
   }
 
   return llvm::Error::success();
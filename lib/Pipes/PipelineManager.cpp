@@ -12,9 +12,13 @@
 #include <string>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Support/raw_ostream.h"
@@ -26,6 +30,7 @@
 #include "revng/Pipeline/Runner.h"
 #include "revng/Pipeline/Target.h"
 #include "revng/Pipes/PipelineManager.h"
+#include "revng/Support/Debug.h"
 #include "revng/Support/ResourceFinder.h"
 
 using namespace pipeline;
@@ -38,6 +43,43 @@ static cl::opt<bool> CheckComponentsVersion("check-components-version",
                                                      "don't match"),
                                             cl::init(false));
 
+static cl::opt<std::string> DescriptionCache("pipeline-description-cache",
+                                             cl::desc("Local directory where "
+                                                      "to cache the pipeline "
+                                                      "description across "
+                                                      "runs"),
+                                             cl::init(""));
+
+static Logger<> DescriptionCacheLog("pipeline-description-cache");
+
+/// Hash everything the pipeline description depends upon: the installed
+/// components (i.e., the pipes, kinds and containers they register), the
+/// pipelines and the enabling flags
+static std::string
+computeConfigurationHash(llvm::ArrayRef<std::string> PipelineContent,
+                         llvm::ArrayRef<std::string> EnablingFlags) {
+  llvm::SHA1 Hasher;
+  auto Update = [&Hasher](llvm::StringRef Data) {
+    // Include the size, so that the boundaries between strings are unambiguous
+    uint64_t Size = Data.size();
+    Hasher.update(llvm::StringRef(reinterpret_cast<const char *>(&Size),
+                                  sizeof(Size)));
+    Hasher.update(Data);
+  };
+
+  Update(revng::getComponentsHash());
+
+  Update("pipelines");
+  for (const std::string &Pipeline : PipelineContent)
+    Update(Pipeline);
+
+  Update("flags");
+  for (const std::string &Flag : EnablingFlags)
+    Update(Flag);
+
+  return llvm::toHex(Hasher.final(), true);
+}
+
 class LoadModelPipePass {
 private:
   ModelWrapper Wrapper;
@@ -55,11 +97,12 @@ public:
   }
 };
 
-static Context setUpContext(LLVMContext &Context) {
+static Context setUpContext(SharedLLVMContext &LLVM) {
   const auto &ModelName = revng::ModelGlobalName;
   pipeline::Context TheContext;
   TheContext.addGlobal<revng::ModelGlobal>(ModelName);
-  TheContext.addExternalContext("LLVMContext", Context);
+  TheContext.addExternalContext("LLVMContext", LLVM.Context);
+  TheContext.addExternalContext(IRModuleCache::Name, LLVM.ModuleCache);
   return TheContext;
 }
 
@@ -182,7 +225,8 @@ setUpPipeline(pipeline::Context &PipelineContext,
 llvm::Expected<PipelineManager>
 PipelineManager::create(llvm::ArrayRef<std::string> Pipelines,
                         llvm::ArrayRef<std::string> EnablingFlags,
-                        llvm::StringRef ExecutionDirectory) {
+                        llvm::StringRef ExecutionDirectory,
+                        std::shared_ptr<SharedLLVMContext> LLVM) {
   std::vector<std::string> LoadedPipelines;
 
   std::vector<std::string> OrderedPipelines(Pipelines.begin(), Pipelines.end());
@@ -197,16 +241,22 @@ PipelineManager::create(llvm::ArrayRef<std::string> Pipelines,
     LoadedPipelines.emplace_back((*MaybeBuffer)->getBuffer().str());
   }
 
-  return createFromMemory(LoadedPipelines, EnablingFlags, ExecutionDirectory);
+  return createFromMemory(LoadedPipelines,
+                          EnablingFlags,
+                          ExecutionDirectory,
+                          std::move(LLVM));
 }
 
 PipelineManager::PipelineManager(llvm::ArrayRef<std::string> EnablingFlags,
                                  std::unique_ptr<revng::StorageClient>
-                                   &&Client) :
+                                   &&Client,
+                                 std::shared_ptr<SharedLLVMContext> LLVM) :
   StorageClient(std::move(Client)),
-  ExecutionDirectory(StorageClient.get(), "") {
-  LLVMContext = std::make_unique<llvm::LLVMContext>();
-  auto Context = setUpContext(*LLVMContext);
+  ExecutionDirectory(StorageClient.get(), ""),
+  LLVM(std::move(LLVM)) {
+  if (this->LLVM == nullptr)
+    this->LLVM = std::make_shared<SharedLLVMContext>();
+  auto Context = setUpContext(*this->LLVM);
   PipelineContext = make_unique<pipeline::Context>(std::move(Context));
 
   auto Loader = setupLoader(*PipelineContext, EnablingFlags);
@@ -216,7 +266,8 @@ PipelineManager::PipelineManager(llvm::ArrayRef<std::string> EnablingFlags,
 llvm::Expected<PipelineManager>
 PipelineManager::createFromMemory(llvm::ArrayRef<std::string> PipelineContent,
                                   llvm::ArrayRef<std::string> EnablingFlags,
-                                  llvm::StringRef ExecutionDirectory) {
+                                  llvm::StringRef ExecutionDirectory,
+                                  std::shared_ptr<SharedLLVMContext> LLVM) {
   std::unique_ptr<revng::StorageClient> Client;
   if (not ExecutionDirectory.empty()) {
     auto MaybeClient = revng::StorageClient::fromPathOrURL(ExecutionDirectory);
@@ -225,15 +276,24 @@ PipelineManager::createFromMemory(llvm::ArrayRef<std::string> PipelineContent,
     Client = std::move(MaybeClient.get());
   }
 
-  return createFromMemory(PipelineContent, EnablingFlags, std::move(Client));
+  return createFromMemory(PipelineContent,
+                          EnablingFlags,
+                          std::move(Client),
+                          std::move(LLVM));
 }
 
 llvm::Expected<PipelineManager>
 PipelineManager::createFromMemory(llvm::ArrayRef<std::string> PipelineContent,
                                   llvm::ArrayRef<std::string> EnablingFlags,
                                   std::unique_ptr<revng::StorageClient>
-                                    &&Client) {
-  PipelineManager Manager(EnablingFlags, std::move(Client));
+                                    &&Client,
+                                  std::shared_ptr<SharedLLVMContext> LLVM) {
+  PipelineManager Manager(EnablingFlags, std::move(Client), std::move(LLVM));
+  Manager.PipelineContent = PipelineContent.vec();
+  Manager.EnablingFlags = EnablingFlags.vec();
+  if (not DescriptionCache.empty())
+    Manager.ConfigurationHash = computeConfigurationHash(PipelineContent,
+                                                         EnablingFlags);
 
   auto MaybePipeline = setUpPipeline(*Manager.PipelineContext,
                                      *Manager.Loader,
@@ -243,6 +303,7 @@ PipelineManager::createFromMemory(llvm::ArrayRef<std::string> PipelineContent,
     return Error;
 
   Manager.Runner = make_unique<pipeline::Runner>(std::move(*MaybePipeline));
+  Manager.Runner->setReleaseDirectory(Manager.ExecutionDirectory);
 
   Manager.recalculateAllPossibleTargets();
 
@@ -257,10 +318,31 @@ PipelineManager::createFromMemory(llvm::ArrayRef<std::string> PipelineContent,
   return std::move(Manager);
 }
 
+llvm::Expected<PipelineManager> PipelineManager::fork() const {
+  auto MaybeFork = createFromMemory(PipelineContent,
+                                    EnablingFlags,
+                                    std::unique_ptr<revng::StorageClient>(),
+                                    LLVM);
+  if (not MaybeFork)
+    return MaybeFork.takeError();
+
+  PipelineManager &Fork = *MaybeFork;
+  if (auto Error = Fork.Runner->shareFrom(*Runner))
+    return Error;
+
+  if (Runner->isEphemeral()) {
+    if (auto Error = Fork.makeEphemeral())
+      return Error;
+  }
+
+  Fork.recalculateAllPossibleTargets();
+  return MaybeFork;
+}
+
 void PipelineManager::recalculateCache() {
   ContainerToEnumeration.clear();
   for (const auto &Step : *Runner) {
-    for (const auto &Container : Step.containers()) {
+    for (const auto &Container : Step.containers().entries()) {
       const auto &StepName = Step.getName();
       if (CurrentState.find(StepName) == CurrentState.end())
         continue;
@@ -289,25 +371,11 @@ void PipelineManager::recalculateCurrentState() {
 
 void PipelineManager::getCurrentState(Runner::State &State) const {
   Runner->getCurrentState(State);
-  for (auto &Step : State) {
-    for (auto &Container : Step.second) {
-      State[Step.first()][Container.first()] = Container.second;
-    }
-  }
 }
 
 void PipelineManager::getAllPossibleTargets(Runner::State &State,
                                             bool ExpandTargets) const {
   Runner->deduceAllPossibleTargets(State);
-  for (auto &Step : State) {
-    for (auto &Container : Step.second) {
-      TargetsList Expansions;
-      for (auto &Target : Container.second) {
-        Expansions.push_back(Target);
-      }
-      State[Step.first()][Container.first()] = std::move(Expansions);
-    }
-  }
 }
 
 void PipelineManager::writeAllPossibleTargets(llvm::raw_ostream &OS) const {
@@ -339,6 +407,17 @@ llvm::Error PipelineManager::store() {
   return StorageClient->commit();
 }
 
+llvm::Error PipelineManager::makeEphemeral() {
+  if (StorageClient != nullptr)
+    return createStringError(inconvertibleErrorCode(),
+                             "An ephemeral run cannot have an execution "
+                             "directory");
+
+  PipelineContext->disableReadTracking();
+  Runner->setEphemeral();
+  return llvm::Error::success();
+}
+
 llvm::Error PipelineManager::storeStepToDisk(llvm::StringRef StepName) {
   if (StorageClient == nullptr)
     return llvm::Error::success();
@@ -401,70 +480,60 @@ PipelineManager::invalidateAllPossibleTargets() {
   auto Stream = ExplanationLogger.getAsLLVMStream();
   recalculateAllPossibleTargets();
 
+  // Collect all the targets to invalidate first, so that their closure is
+  // computed, and they are removed, in a single pass over the pipeline
   Task T(CurrentState.size(), "invalidateAllPossibleTargets");
   for (const auto &Step : CurrentState) {
     T.advance(Step.first(), true);
     if (Step.first() == Runner->begin()->getName())
       continue;
 
-    Task T2(Step.second.size(), "Containers");
+    auto &Containers = getRunner()[Step.first()].containers();
     for (const auto &Container : Step.second) {
-      T2.advance(Container.first(), true);
-
-      for (const auto &Target : Container.second) {
-        auto &Containers = getRunner()[Step.first()].containers();
-        if (not Containers.contains(Container.first()))
-          continue;
-
-        if (not Containers[Container.first()].enumerate().contains(Target))
-          continue;
+      if (not Containers.contains(Container.first()))
+        continue;
 
+      TargetsList Available = Containers[Container.first()].enumerate();
+      TargetsList ToInvalidate = Available.intersect(Container.second);
+      for (const auto &Target : ToInvalidate) {
         *Stream << "Invalidating: ";
         *Stream << Step.first() << "/" << Container.first() << "/";
         Target.dump(*Stream);
-
-        TargetInStepSet Map;
-        Map[Step.first()][Container.first()].push_back(Target);
-        if (auto Error = Runner->getInvalidations(Map))
-          return std::move(Error);
-        if (auto Error = Runner->invalidate(Map))
-          return std::move(Error);
-
-        for (const auto &First : Map) {
-          for (const auto &Second : First.second) {
-            *Stream << "\t" << First.first() << " " << Second.first() << " ";
-            Target.dump(*Stream);
-          }
-        }
-
-        pipeline::merge(ResultMap, Map);
       }
+
+      if (not ToInvalidate.empty())
+        ResultMap[Step.first()][Container.first()].merge(ToInvalidate);
     }
   }
 
+  if (ResultMap.empty())
+    return ResultMap;
+
+  if (auto Error = Runner->getInvalidations(ResultMap))
+    return std::move(Error);
+  if (auto Error = Runner->invalidate(ResultMap))
+    return std::move(Error);
+
   return ResultMap;
 }
 
 llvm::Error PipelineManager::produceAllPossibleTargets(bool ExpandTargets) {
   recalculateAllPossibleTargets(ExpandTargets);
 
+  Runner::State ToProduce;
   for (const auto &Step : CurrentState) {
     for (const auto &Container : Step.second) {
       for (const auto &Target : Container.second) {
-        ContainerToTargetsMap ToProduce;
-        ToProduce.add(Container.first(), Target);
+        ToProduce[Step.first()].add(Container.first(), Target);
         ExplanationLogger << Step.first() << "/" << Container.first() << "/";
         auto Logger = ExplanationLogger.getAsLLVMStream();
         Target.dump(*Logger);
         ExplanationLogger << DoLog;
-
-        if (auto Error = Runner->run(Step.first(), ToProduce))
-          return Error;
       }
     }
   }
 
-  return llvm::Error::success();
+  return Runner->run(ToProduce);
 }
 
 const pipeline::Step::AnalysisValueType &
@@ -478,6 +547,15 @@ PipelineManager::getAnalysis(const AnalysisReference &Reference) const {
   return *Analysis;
 }
 
+/// Analyses only change globals: if none of them has changed, neither have the
+/// targets that can be produced
+static bool isEmpty(const DiffMap &Diffs) {
+  for (const auto &Entry : Diffs)
+    if (not Entry.second.isEmpty())
+      return false;
+  return true;
+}
+
 llvm::Expected<DiffMap>
 PipelineManager::runAnalyses(const pipeline::AnalysesList &List,
                              TargetInStepSet &Map,
@@ -488,7 +566,8 @@ PipelineManager::runAnalyses(const pipeline::AnalysesList &List,
   if (not Result)
     return Result.takeError();
 
-  recalculateAllPossibleTargets();
+  if (not isEmpty(*Result))
+    recalculateAllPossibleTargets();
 
   PipelineContext->bumpCommitIndex();
   return Result;
@@ -509,7 +588,8 @@ PipelineManager::runAnalysis(llvm::StringRef AnalysisName,
   if (not Result)
     return Result.takeError();
 
-  recalculateAllPossibleTargets();
+  if (not isEmpty(*Result))
+    recalculateAllPossibleTargets();
 
   PipelineContext->bumpCommitIndex();
   return Result;
@@ -526,9 +606,9 @@ PipelineManager::invalidateFromDiff(const llvm::StringRef Name,
   return invalidateAllPossibleTargets();
 }
 
-llvm::Error
-PipelineManager::materializeTargets(const llvm::StringRef StepName,
-                                    const ContainerToTargetsMap &Map) {
+static llvm::Error checkTargetsCanBeProduced(Runner::State &CurrentState,
+                                             const llvm::StringRef StepName,
+                                             const ContainerToTargetsMap &Map) {
   if (CurrentState.count(StepName) == 0)
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "Step %s does not have any targets",
@@ -550,12 +630,35 @@ PipelineManager::materializeTargets(const llvm::StringRef StepName,
     }
   }
 
+  return Error::success();
+}
+
+llvm::Error
+PipelineManager::materializeTargets(const llvm::StringRef StepName,
+                                    const ContainerToTargetsMap &Map) {
+  if (auto Error = checkTargetsCanBeProduced(CurrentState, StepName, Map))
+    return Error;
+
+  // Only the productions in progress can be cancelled
+  PipelineContext->resetCancellation();
   if (auto Error = getRunner().run(StepName, Map))
     return Error;
 
   return Error::success();
 }
 
+llvm::Error PipelineManager::materializeTargets(const Runner::State &Requests) {
+  for (const auto &Request : Requests) {
+    if (auto Error = checkTargetsCanBeProduced(CurrentState,
+                                               Request.first(),
+                                               Request.second))
+      return Error;
+  }
+
+  PipelineContext->resetCancellation();
+  return getRunner().run(Requests);
+}
+
 llvm::Expected<std::unique_ptr<pipeline::ContainerBase>>
 PipelineManager::produceTargets(const llvm::StringRef StepName,
                                 const Container &TheContainer,
@@ -571,14 +674,84 @@ PipelineManager::produceTargets(const llvm::StringRef StepName,
   return TheContainer.second->cloneFiltered(ToFilter);
 }
 
-llvm::Error PipelineManager::computeDescription() {
-  using pipeline::description::PipelineDescription;
-  PipelineDescription Description = getRunner().description();
+static std::string getCachedDescriptionPath(llvm::StringRef Hash) {
+  llvm::SmallString<128> Path(DescriptionCache.getValue());
+  llvm::sys::path::append(Path, Hash + ".yml");
+  return Path.str().str();
+}
+
+bool PipelineManager::loadCachedDescription() {
+  if (ConfigurationHash.empty())
+    return false;
+
+  std::string Path = getCachedDescriptionPath(ConfigurationHash);
+  auto MaybeBuffer = llvm::MemoryBuffer::getFile(Path);
+  if (not MaybeBuffer) {
+    revng_log(DescriptionCacheLog, "Cache miss: " << Path);
+    return false;
+  }
+
+  revng_log(DescriptionCacheLog, "Cache hit: " << Path);
+  this->Description = MaybeBuffer.get()->getBuffer().str();
+  return true;
+}
+
+void PipelineManager::storeCachedDescription() const {
+  if (ConfigurationHash.empty())
+    return;
+
+  // The cache is an optimization: failing to populate it is not an error
+  auto Fail = [](llvm::StringRef Reason, std::error_code EC) {
+    revng_log(DescriptionCacheLog, Reason << ": " << EC.message());
+  };
+
+  if (auto EC = llvm::sys::fs::create_directories(DescriptionCache)) {
+    Fail("Cannot create the cache directory", EC);
+    return;
+  }
+
+  // Write to a temporary file and then rename it, so that concurrent runs
+  // never observe a partially written description
+  std::string Path = getCachedDescriptionPath(ConfigurationHash);
+  int FD = -1;
+  llvm::SmallString<128> TemporaryPath;
+  auto EC = llvm::sys::fs::createUniqueFile(Path + ".%%%%%%%%", FD,
+                                            TemporaryPath);
+  if (EC) {
+    Fail("Cannot create a temporary file", EC);
+    return;
+  }
 
   {
-    llvm::raw_string_ostream OS(this->Description);
-    yaml::Output YAMLOutput(OS);
-    YAMLOutput << Description;
+    llvm::raw_fd_ostream OS(FD, /* shouldClose */ true);
+    OS << this->Description;
+    OS.close();
+    if (OS.has_error()) {
+      Fail("Cannot write the cached description", OS.error());
+      OS.clear_error();
+      llvm::sys::fs::remove(TemporaryPath);
+      return;
+    }
+  }
+
+  if (auto EC = llvm::sys::fs::rename(TemporaryPath, Path)) {
+    Fail("Cannot rename the cached description", EC);
+    llvm::sys::fs::remove(TemporaryPath);
+  }
+}
+
+llvm::Error PipelineManager::computeDescription() {
+  if (not loadCachedDescription()) {
+    using pipeline::description::PipelineDescription;
+    PipelineDescription Description = getRunner().description();
+
+    {
+      llvm::raw_string_ostream OS(this->Description);
+      yaml::Output YAMLOutput(OS);
+      YAMLOutput << Description;
+    }
+
+    storeCachedDescription();
   }
 
   if (StorageClient == nullptr)
@@ -6,16 +6,20 @@
 //
 
 #include <memory>
+#include <optional>
 
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/CodeGen.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_os_ostream.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 
 #include "revng/Pipeline/AllRegistries.h"
@@ -23,10 +27,14 @@
 #include "revng/Pipeline/Target.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Recompile/CompileModulePipe.h"
+#include "revng/Recompile/IncrementalCompilation.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/IRAnnotators.h"
 #include "revng/Support/IRHelpers.h"
+#include "revng/Support/InstructionAnnotations.h"
 #include "revng/Support/OriginalAssemblyAnnotationWriter.h"
+#include "revng/Support/ProgramRunner.h"
+#include "revng/Support/TemporaryFile.h"
 
 using namespace llvm;
 using namespace llvm::codegen;
@@ -44,6 +52,65 @@ static cl::opt<char> OptLevel("compile-opt-level",
                               cl::ZeroOrMore,
                               cl::init(' '));
 
+static cl::opt<unsigned> CompileJobs("compile-jobs",
+                                     cl::desc("Split the module in this many "
+                                              "partitions and compile them in "
+                                              "parallel (default = 1)"),
+                                     cl::init(1));
+
+static cl::opt<std::string> CompileCache("compile-cache",
+                                         cl::desc("Directory where to cache "
+                                                  "the object of each "
+                                                  "function, so that only the "
+                                                  "changed ones are compiled "
+                                                  "again"),
+                                         cl::init(""));
+
+static cl::opt<std::string> DebugSource("self-referencing-debug-info-source",
+                                        cl::desc("Print the annotated IR to "
+                                                 "this file and have the "
+                                                 "debug info of the compiled "
+                                                 "binary point to its lines. "
+                                                 "Otherwise, lines are "
+                                                 "assigned without printing "
+                                                 "the module."),
+                                        cl::value_desc("path"),
+                                        cl::init(""));
+
+/// Compile \p M into \p Jobs objects in parallel, see llvm::splitCodeGen, and
+/// merge them in a single relocatable object at \p OutputPath
+static void compileInParallel(llvm::Module &M,
+                              unsigned Jobs,
+                              const TargetMachineFactory &Factory,
+                              StringRef OutputPath) {
+  std::vector<TemporaryFile> Parts;
+  std::vector<unique_ptr<raw_fd_ostream>> Streams;
+  std::vector<raw_pwrite_stream *> OutputStreams;
+  Parts.reserve(Jobs);
+  for (unsigned I = 0; I < Jobs; ++I) {
+    Parts.emplace_back("revng-compile-module", "o");
+
+    std::error_code EC;
+    Streams.push_back(make_unique<raw_fd_ostream>(Parts.back().path(), EC));
+    revng_assert(!EC);
+    OutputStreams.push_back(Streams.back().get());
+  }
+
+  // Local symbols are preserved: each one ends up in the same partition as
+  // all of its users, so the module in the container keeps its linkages.
+  splitCodeGen(M, OutputStreams, {}, Factory, CGFT_ObjectFile, true);
+
+  // Flush and close the objects
+  Streams.clear();
+
+  std::vector<std::string> Arguments = { "-r", "-o", OutputPath.str() };
+  for (const TemporaryFile &Part : Parts)
+    Arguments.push_back(Part.path().str());
+
+  int ExitCode = ::Runner.run("ld.bfd", Arguments);
+  revng_check(ExitCode == 0);
+}
+
 static void compileModuleRunImpl(const Context &Context,
                                  LLVMContainer &Module,
                                  ObjectFileContainer &TargetBinary) {
@@ -63,8 +130,28 @@ static void compileModuleRunImpl(const Context &Context,
 
   llvm::Module *M = &Module.getModule();
 
-  OriginalAssemblyAnnotationWriter OAAW(M->getContext());
-  createSelfReferencingDebugInfo(M, Module.name(), &OAAW);
+  // Self-referencing debug info points to lines of the whole module, so any
+  // change would affect the IR of all the functions: don't emit it when
+  // caching.
+  if (CompileCache.empty()) {
+    if (DebugSource.empty()) {
+      createSequentialDebugInfo(M, Module.name());
+    } else {
+      std::error_code EC;
+      raw_fd_ostream Source(DebugSource, EC, sys::fs::OF_Text);
+      revng_check(not EC, "Cannot open the debug info source file");
+
+      // Join the annotations recorded out of the IR, if any
+      std::optional<InstructionAnnotations> Annotations;
+      if (not AnnotationsPath.empty())
+        Annotations = cantFail(InstructionAnnotations::load(AnnotationsPath));
+
+      OriginalAssemblyAnnotationWriter OAAW(M->getContext(),
+                                            Annotations ? &*Annotations :
+                                                          nullptr);
+      createSelfReferencingDebugInfo(M, DebugSource, &OAAW, Source);
+    }
+  }
 
   // Get the target specific parser.
   std::string Error;
@@ -95,14 +182,17 @@ static void compileModuleRunImpl(const Context &Context,
     return;
   }
 
-  auto Ptr = TheTarget->createTargetMachine(TheTriple.getTriple(),
-                                            "",
-                                            "",
-                                            Options,
-                                            getRelocModel(),
-                                            M->getCodeModel(),
-                                            OLvl);
-  unique_ptr<TargetMachine> Target(Ptr);
+  auto CreateTargetMachine = [&]() {
+    auto *Ptr = TheTarget->createTargetMachine(TheTriple.getTriple(),
+                                               "",
+                                               "",
+                                               Options,
+                                               getRelocModel(),
+                                               M->getCodeModel(),
+                                               OLvl);
+    return unique_ptr<TargetMachine>(Ptr);
+  };
+  unique_ptr<TargetMachine> Target = CreateTargetMachine();
 
   // Add the target data from the target machine, if it exists, or the module.
   M->setDataLayout(Target->createDataLayout());
@@ -111,30 +201,46 @@ static void compileModuleRunImpl(const Context &Context,
   // to check debug info whereas verifier relies on correct datalayout.
   UpgradeDebugInfo(*M);
 
-  LLVMTargetMachine &LLVMTM = static_cast<LLVMTargetMachine &>(*Target);
-  auto *MMIWP = new MachineModuleInfoWrapperPass(&LLVMTM);
-
-  std::error_code EC;
-  raw_fd_ostream OutputStream(TargetBinary.getOrCreatePath(), EC);
-  revng_assert(!EC);
-
-  // Create pass manager
-  legacy::PassManager PM;
-
-  // Add an appropriate TargetLibraryInfo pass for the module's triple.
-  TargetLibraryInfoImpl TLII(Triple(M->getTargetTriple()));
-  PM.add(new TargetLibraryInfoWrapperPass(TLII));
-
-  bool Err = Target->addPassesToEmitFile(PM,
-                                         OutputStream,
-                                         nullptr,
-                                         CGFT_ObjectFile,
-                                         true,
-                                         MMIWP);
-  revng_assert(not Err);
-  revng::verify(M);
-  PM.run(*M);
-  revng::verify(M);
+  if (not CompileCache.empty()) {
+    revng::verify(M);
+    compileIncrementally(*M,
+                         CreateTargetMachine,
+                         CompileJobs,
+                         CompileCache,
+                         TargetBinary.getOrCreatePath());
+  } else if (CompileJobs > 1) {
+    revng::verify(M);
+    compileInParallel(*M,
+                      CompileJobs,
+                      CreateTargetMachine,
+                      TargetBinary.getOrCreatePath());
+    revng::verify(M);
+  } else {
+    LLVMTargetMachine &LLVMTM = static_cast<LLVMTargetMachine &>(*Target);
+    auto *MMIWP = new MachineModuleInfoWrapperPass(&LLVMTM);
+
+    std::error_code EC;
+    raw_fd_ostream OutputStream(TargetBinary.getOrCreatePath(), EC);
+    revng_assert(!EC);
+
+    // Create pass manager
+    legacy::PassManager PM;
+
+    // Add an appropriate TargetLibraryInfo pass for the module's triple.
+    TargetLibraryInfoImpl TLII(Triple(M->getTargetTriple()));
+    PM.add(new TargetLibraryInfoWrapperPass(TLII));
+
+    bool Err = Target->addPassesToEmitFile(PM,
+                                           OutputStream,
+                                           nullptr,
+                                           CGFT_ObjectFile,
+                                           true,
+                                           MMIWP);
+    revng_assert(not Err);
+    revng::verify(M);
+    PM.run(*M);
+    revng::verify(M);
+  }
 
   auto Path = TargetBinary.path();
 
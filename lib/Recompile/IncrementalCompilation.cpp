@@ -0,0 +1,195 @@
+/// \file IncrementalCompilation.cpp
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "revng/Recompile/IncrementalCompilation.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/ProgramRunner.h"
+#include "revng/Support/TemporaryFile.h"
+
+using namespace llvm;
+
+static Logger<> Log("incremental-compilation");
+
+/// A module to compile into an object of its own
+struct Part {
+  SmallString<0> Bitcode;
+  std::string ObjectPath;
+};
+
+/// Give hidden visibility to all the local definitions of \p M, so that they
+/// can be referenced from other objects
+static void externalizeLocals(Module &M) {
+  for (GlobalValue &GV : M.global_values()) {
+    if (GV.isDeclaration() or not GV.hasLocalLinkage())
+      continue;
+
+    GV.setLinkage(GlobalValue::ExternalLinkage);
+    GV.setVisibility(GlobalValue::HiddenVisibility);
+    if (not GV.hasName())
+      GV.setName("revng_anonymous");
+  }
+}
+
+/// Drop the declarations of \p M which are not used, so that a part does not
+/// change when unrelated symbols are added to or removed from the module
+static void dropUnusedDeclarations(Module &M) {
+  for (Function &F : llvm::make_early_inc_range(M.functions()))
+    if (F.isDeclaration() and F.use_empty())
+      F.eraseFromParent();
+
+  for (GlobalVariable &GV : llvm::make_early_inc_range(M.globals()))
+    if (GV.isDeclaration() and GV.use_empty())
+      GV.eraseFromParent();
+}
+
+static SmallString<0> emitObject(Module &M, TargetMachine &TM) {
+  SmallString<0> Result;
+  raw_svector_ostream Stream(Result);
+
+  legacy::PassManager PM;
+  TargetLibraryInfoImpl TLII(Triple(M.getTargetTriple()));
+  PM.add(new TargetLibraryInfoWrapperPass(TLII));
+
+  bool Err = TM.addPassesToEmitFile(PM,
+                                    Stream,
+                                    nullptr,
+                                    CGFT_ObjectFile,
+                                    true);
+  revng_assert(not Err);
+  PM.run(M);
+
+  return Result;
+}
+
+void compileIncrementally(const llvm::Module &M,
+                          const TargetMachineFactory &CreateTargetMachine,
+                          unsigned Jobs,
+                          llvm::StringRef CacheDirectory,
+                          llvm::StringRef OutputPath) {
+  std::error_code EC = sys::fs::create_directories(CacheDirectory);
+  revng_check(not EC, "Cannot create the compilation cache directory");
+
+  // Everything affecting the code generation, other than the IR itself
+  std::string Configuration;
+  {
+    std::unique_ptr<TargetMachine> TM = CreateTargetMachine();
+    raw_string_ostream Stream(Configuration);
+    Stream << TM->getTargetTriple().str() << "\n"
+           << TM->getTargetCPU() << "\n"
+           << TM->getTargetFeatureString() << "\n"
+           << static_cast<int>(TM->getOptLevel()) << "\n";
+  }
+
+  std::unique_ptr<Module> Copy = CloneModule(M);
+  externalizeLocals(*Copy);
+
+  // Aliases and ifuncs need their targets to be defined in the same module:
+  // in their presence, don't split the module at all
+  bool Split = Copy->alias_empty() and Copy->ifunc_empty();
+
+  std::vector<Part> Parts;
+  auto AddPart = [&](function_ref<bool(const GlobalValue *)> Belongs) {
+    ValueToValueMapTy Map;
+    std::unique_ptr<Module> PartModule = CloneModule(*Copy, Map, Belongs);
+    dropUnusedDeclarations(*PartModule);
+    PartModule->setModuleIdentifier("revng-incremental-compilation");
+    PartModule->setSourceFileName("");
+
+    Part &New = Parts.emplace_back();
+    raw_svector_ostream Stream(New.Bitcode);
+    WriteBitcodeToFile(*PartModule, Stream);
+
+    SHA1 Hasher;
+    Hasher.update(Configuration);
+    Hasher.update(New.Bitcode);
+    std::string Key = toHex(Hasher.final(), true);
+
+    SmallString<128> ObjectPath(CacheDirectory);
+    sys::path::append(ObjectPath, Key + ".o");
+    New.ObjectPath = ObjectPath.str().str();
+  };
+
+  if (Split) {
+    for (const Function &F : *Copy)
+      if (not F.isDeclaration())
+        AddPart([&F](const GlobalValue *GV) { return GV == &F; });
+
+    AddPart([](const GlobalValue *GV) { return not isa<Function>(GV); });
+  } else {
+    AddPart([](const GlobalValue *) { return true; });
+  }
+  Copy.reset();
+
+  // Compile the parts that are not in the cache
+  unsigned Misses = 0;
+  {
+    ThreadPool Pool(hardware_concurrency(Jobs));
+    for (Part &P : Parts) {
+      if (sys::fs::exists(P.ObjectPath)) {
+        P.Bitcode.clear();
+        continue;
+      }
+
+      ++Misses;
+      Pool.async([&P, &CreateTargetMachine]() {
+        LLVMContext Context;
+        MemoryBufferRef Buffer(P.Bitcode, "part");
+        auto PartModule = cantFail(parseBitcodeFile(Buffer, Context));
+
+        std::unique_ptr<TargetMachine> TM = CreateTargetMachine();
+        PartModule->setDataLayout(TM->createDataLayout());
+        SmallString<0> Object = emitObject(*PartModule, *TM);
+
+        // Write atomically, in case the cache directory is shared
+        cantFail(writeFileAtomically(P.ObjectPath + ".tmp-%%%%%%%%",
+                                     P.ObjectPath,
+                                     Object));
+        P.Bitcode.clear();
+      });
+    }
+    Pool.wait();
+  }
+
+  revng_log(Log,
+            "Compiled " << Misses << " parts out of " << Parts.size()
+                        << ", the others were cached");
+
+  // Merge all the objects, listing them in a response file, since there might
+  // be many
+  TemporaryFile ResponseFile("revng-incremental-compilation", "rsp");
+  {
+    raw_fd_ostream Stream(ResponseFile.path(), EC);
+    revng_assert(not EC);
+    for (const Part &P : Parts)
+      Stream << P.ObjectPath << "\n";
+  }
+
+  std::vector<std::string> Arguments = { "-r",
+                                         "-o",
+                                         OutputPath.str(),
+                                         "@" + ResponseFile.path().str() };
+  int ExitCode = ::Runner.run("ld.bfd", Arguments);
+  revng_check(ExitCode == 0);
+}
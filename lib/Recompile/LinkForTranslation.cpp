@@ -4,18 +4,25 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <future>
 #include <string>
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -32,6 +39,14 @@
 using namespace llvm;
 using namespace llvm::sys;
 
+static cl::opt<std::string> SegmentsCache("link-for-translation-cache",
+                                          cl::desc("Directory where to keep "
+                                                   "the objects containing "
+                                                   "the segments of the input "
+                                                   "binary, so that they can "
+                                                   "be reused across links"),
+                                          cl::init(""));
+
 static std::string linkFunctionArgument(llvm::StringRef Lib) {
   auto LastSlash = Lib.rfind('/');
   if (LastSlash != llvm::StringRef::npos)
@@ -92,11 +107,20 @@ public:
 
 class CommandList {
 private:
+  /// Commands that do not depend on anything, run concurrently before the
+  /// others
+  std::vector<Command> IndependentCommands;
   std::vector<Command> Commands;
   std::vector<std::unique_ptr<TemporaryFile>> Temporaries;
 
 public:
   void run() const {
+    std::vector<std::shared_future<ProgramRunner::Result>> Pending;
+    for (const Command &C : IndependentCommands)
+      Pending.push_back(::Runner.runAsync(C.CommandName, C.Arguments));
+    for (const std::shared_future<ProgramRunner::Result> &Result : Pending)
+      revng_check(Result.get().ExitCode == 0);
+
     for (const Command &C : Commands) {
       auto ExitCode = ::Runner.run(C.CommandName, C.Arguments);
       revng_check(ExitCode == 0);
@@ -105,6 +129,9 @@ public:
 
 public:
   void enqueueCommand(Command C) { Commands.push_back(std::move(C)); }
+  void enqueueIndependentCommand(Command C) {
+    IndependentCommands.push_back(std::move(C));
+  }
 
   TemporaryFile &createTemporary(std::string Prefix, std::string Suffix) {
     Temporaries.emplace_back(std::make_unique<TemporaryFile>(Prefix, Suffix));
@@ -128,6 +155,101 @@ public:
   }
 };
 
+/// Write \p Data to \p Path, padding it with zeros or truncating it to \p Size
+static void
+writeRawSegment(StringRef Path, ArrayRef<uint8_t> Data, uint64_t Size) {
+  int FD = -1;
+  std::error_code EC = sys::fs::openFileForWrite(Path, FD);
+  revng_assert(not EC);
+
+  {
+    raw_fd_ostream Stream(FD, false);
+    Stream.write(reinterpret_cast<const char *>(Data.data()),
+                 std::min<uint64_t>(Data.size(), Size));
+  }
+
+  // Padding is sparse
+  EC = sys::fs::resize_file(FD, Size);
+  revng_assert(not EC);
+  sys::Process::SafelyCloseFileDescriptor(FD);
+}
+
+/// \returns the path of an object file containing a section named
+///          \p SectionName with \p Data, padded to \p Size
+///
+/// If a cache directory is available, the object is reused across runs,
+/// otherwise it's created in a temporary file of \p Commands, to which the
+/// objcopy invocation producing it is added: all those invocations are run
+/// concurrently.
+static std::string segmentObject(CommandList &Commands,
+                                 ArrayRef<uint8_t> Data,
+                                 uint64_t Size,
+                                 StringRef SectionName,
+                                 StringRef SectionFlags) {
+  auto ObjCopyArguments = [&](StringRef Input, StringRef Output) {
+    return std::vector<std::string>{ "-Ibinary",
+                                     "-Oelf64-x86-64",
+                                     "--add-section=.note.GNU-stack=/dev/null",
+                                     ("--rename-section=.data=." + SectionName)
+                                       .str(),
+                                     ("--set-section-flags=.data="
+                                      + SectionFlags)
+                                       .str(),
+                                     Input.str(),
+                                     Output.str() };
+  };
+
+  if (SegmentsCache.empty()) {
+    TemporaryFile &RawSegment = Commands.createTemporary("revng-link-for-"
+                                                         "translation",
+                                                         "raw");
+    writeRawSegment(RawSegment.path(), Data, Size);
+
+    // Create an object file we can later link
+    TemporaryFile &SegmentELF = Commands.createTemporary("revng-link-for-"
+                                                         "translation",
+                                                         "o");
+    Command ObjCopy("objcopy");
+    ObjCopy.Arguments = ObjCopyArguments(RawSegment.path(), SegmentELF.path());
+    Commands.enqueueIndependentCommand(std::move(ObjCopy));
+
+    return SegmentELF.path().str();
+  }
+
+  // Identify the object by its content
+  SHA1 Hasher;
+  Hasher.update(Data.take_front(std::min<uint64_t>(Data.size(), Size)));
+  Hasher.update((Twine(Size) + "\n" + SectionName + "\n" + SectionFlags)
+                  .str());
+  std::string Key = toHex(Hasher.final(), true);
+
+  SmallString<128> CachedPath(SegmentsCache);
+  sys::path::append(CachedPath, Key + ".o");
+  if (sys::fs::exists(CachedPath))
+    return CachedPath.str().str();
+
+  std::error_code EC = sys::fs::create_directories(SegmentsCache);
+  revng_assert(not EC);
+
+  // Produce the object right away, and then move it in place atomically
+  TemporaryFile RawSegment("revng-link-for-translation", "raw");
+  writeRawSegment(RawSegment.path(), Data, Size);
+
+  SmallString<128> TemporaryPath;
+  EC = sys::fs::createUniqueFile(Twine(CachedPath) + ".tmp-%%%%%%%%",
+                                 TemporaryPath);
+  revng_assert(not EC);
+  int ExitCode = ::Runner.run("objcopy",
+                              ObjCopyArguments(RawSegment.path(),
+                                               TemporaryPath));
+  revng_check(ExitCode == 0);
+
+  EC = sys::fs::rename(TemporaryPath, CachedPath);
+  revng_assert(not EC);
+
+  return CachedPath.str().str();
+}
+
 template<typename T = std::string,
          typename Container = std::initializer_list<T>>
 void appendTo(Container &&Range, auto &Destination) {
@@ -149,7 +271,7 @@ static CommandList linkingArgs(const model::Binary &Model,
                                                        "translation",
                                                        "");
 
-  auto MaybeBuffer = llvm::MemoryBuffer::getFileOrSTDIN(InputBinary);
+  auto MaybeBuffer = mapBinary(InputBinary);
   revng_assert(MaybeBuffer);
   llvm::MemoryBuffer &Buffer = **MaybeBuffer;
   RawBinaryView BinaryView(Model, Buffer.getBuffer());
@@ -194,51 +316,21 @@ static CommandList linkingArgs(const model::Binary &Model,
                  << Segment.endAddress().toString();
     }
 
-    TemporaryFile &RawSegment = Result.createTemporary("revng-link-for-"
-                                                       "translation",
-                                                       "raw");
-
-    Command DD("dd");
-    DD.Arguments = { { "status=none",
-                       "bs=1",
-                       ("skip=" + Twine(Segment.StartOffset())).str(),
-                       ("if=" + InputBinary).str(),
-                       ("count=" + Twine(Segment.FileSize())).str(),
-                       ("of=" + RawSegment.path()).str() } };
-    Result.enqueueCommand(std::move(DD));
-
-    Command Truncate("truncate");
-    Truncate.Arguments = { { ("--size=" + Twine(Segment.VirtualSize())).str(),
-                             RawSegment.path().str() } };
-    Result.enqueueCommand(std::move(Truncate));
-
-    Command ObjCopy("objcopy");
-
-    // Create an object file we can later link
-    TemporaryFile &SegmentELF = Result.createTemporary("revng-link-for-"
-                                                       "translation",
-                                                       "o");
-
     std::string SectionFlags = "alloc";
     if (not Segment.IsWriteable())
       SectionFlags += ",readonly";
 
-    ObjCopy.Arguments = { "-Ibinary",
-                          "-Oelf64-x86-64",
-                          "--add-section=.note.GNU-stack=/dev/null",
-                          "--rename-section=.data=." + SectionName,
-                          "--set-section-flags=.data=" + SectionFlags,
-                          RawSegment.path().str(),
-                          SegmentELF.path().str() };
-
-    // Register the objcopy invocation
-    Result.enqueueCommand(ObjCopy);
+    std::string SegmentELF = segmentObject(Result,
+                                           Data,
+                                           Segment.VirtualSize(),
+                                           SectionName,
+                                           SectionFlags);
 
     Min = std::min(Min, Segment.StartAddress().address());
     Max = std::max(Max, Segment.endAddress().address());
 
     // Add to linker command line
-    Linker.Arguments.push_back(SegmentELF.path().str());
+    Linker.Arguments.push_back(SegmentELF);
 
     // Force section address at link-time
     const auto &StartAddr = Segment.StartAddress().address();
@@ -5,27 +5,36 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <fstream>
+#include <mutex>
 
 #include "aws/core/Aws.h"
 #include "aws/core/auth/AWSCredentials.h"
 #include "aws/core/auth/AWSCredentialsProvider.h"
 #include "aws/core/utils/logging/FormattedLogSystem.h"
+#include "aws/core/utils/stream/PreallocatedStreamBuf.h"
 #include "aws/s3/S3Client.h"
+#include "aws/s3/model/AbortMultipartUploadRequest.h"
+#include "aws/s3/model/CompleteMultipartUploadRequest.h"
+#include "aws/s3/model/CompletedMultipartUpload.h"
+#include "aws/s3/model/CompletedPart.h"
 #include "aws/s3/model/CopyObjectRequest.h"
+#include "aws/s3/model/CreateMultipartUploadRequest.h"
 #include "aws/s3/model/DeleteObjectRequest.h"
 #include "aws/s3/model/GetObjectRequest.h"
 #include "aws/s3/model/HeadObjectRequest.h"
 #include "aws/s3/model/PutObjectRequest.h"
+#include "aws/s3/model/UploadPartRequest.h"
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/SmallVectorMemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/YAMLTraits.h"
 
 #include "revng/Storage/Path.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/OnQuit.h"
 #include "revng/Support/PathList.h"
-#include "revng/Support/TemporaryFile.h"
 
 #include "S3StorageClient.h"
 #include "Utils.h"
@@ -70,6 +79,23 @@ public:
   }
 };
 
+using namespace llvm::cl;
+
+opt<uint64_t> PartSize("s3-part-size",
+                       desc("Size, in bytes, of the parts in which files are "
+                            "uploaded to and downloaded from S3. Files "
+                            "smaller than this are transferred with a single "
+                            "request."),
+                       init(64 * 1024 * 1024));
+
+opt<unsigned> Concurrency("s3-concurrency",
+                          desc("Maximum number of parts, or of files, "
+                               "transferred concurrently to and from S3"),
+                          init(8));
+
+// S3 rejects multipart uploads with parts smaller than 5 MiB (except the last)
+constexpr uint64_t MinimumPartSize = 5 * 1024 * 1024;
+
 bool SDKIsInitialized = false;
 
 void initializeSDK() {
@@ -106,6 +132,57 @@ toError(const Aws::Utils::Outcome<T, Aws::S3::S3Error> &Request) {
                                  Request.GetError().GetMessage());
 }
 
+static uint64_t getPartSize() {
+  return std::max<uint64_t>(PartSize, MinimumPartSize);
+}
+
+/// Invoke \p Transfer on each of the parts in which a file of size \p Size is
+/// split, running up to `--s3-concurrency` of them at the same time.
+/// Aws::S3::S3Client is thread-safe, so all the parts can share it.
+template<typename F>
+static llvm::Error forEachPart(uint64_t Size, F &&Transfer) {
+  const uint64_t Part = getPartSize();
+  const uint64_t PartsCount = (Size + Part - 1) / Part;
+
+  std::mutex ErrorMutex;
+  llvm::Error Result = llvm::Error::success();
+  auto TransferPart = [&](uint64_t Index) {
+    uint64_t Offset = Index * Part;
+    uint64_t Length = std::min(Part, Size - Offset);
+    llvm::Error Error = Transfer(Index, Offset, Length);
+    if (Error) {
+      std::lock_guard Guard(ErrorMutex);
+      Result = llvm::joinErrors(std::move(Result), std::move(Error));
+    }
+  };
+
+  unsigned Threads = std::max(1U, Concurrency.getValue());
+  if (Threads == 1 or PartsCount == 1) {
+    for (uint64_t Index = 0; Index < PartsCount; ++Index)
+      TransferPart(Index);
+  } else {
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(Threads));
+    for (uint64_t Index = 0; Index < PartsCount; ++Index)
+      Pool.async(TransferPart, Index);
+    Pool.wait();
+  }
+
+  return Result;
+}
+
+/// A stream reading from, or writing to, a region of memory owned by someone
+/// else, used to hand buffers to the SDK without copying them
+class MemoryStream : public Aws::IOStream {
+private:
+  Aws::Utils::Stream::PreallocatedStreamBuf Buffer;
+
+public:
+  MemoryStream(char *Start, uint64_t Length) :
+    Aws::IOStream(&Buffer),
+    Buffer(reinterpret_cast<unsigned char *>(Start), Length) {}
+  ~MemoryStream() override = default;
+};
+
 std::string S3StorageClient::resolvePath(llvm::StringRef Path) {
   if (Path.empty()) {
     return SubPath;
@@ -146,67 +223,206 @@ static Aws::Auth::AWSCredentials readCredentials(llvm::StringRef Credentials) {
 
 class S3ReadableFile : public ReadableFile {
 private:
-  TemporaryFile TempFile;
   std::unique_ptr<llvm::MemoryBuffer> Buffer;
 
 public:
-  S3ReadableFile(TemporaryFile &&TempFile,
-                 std::unique_ptr<llvm::MemoryBuffer> &&Buffer) :
-    TempFile(std::move(TempFile)), Buffer(std::move(Buffer)) {}
+  S3ReadableFile(std::unique_ptr<llvm::MemoryBuffer> &&Buffer) :
+    Buffer(std::move(Buffer)) {}
   ~S3ReadableFile() override = default;
   llvm::MemoryBuffer &buffer() override { return *Buffer; };
 };
 
+struct S3StorageClient::PendingUpload {
+  std::string Path;
+  std::string NewFilename;
+  std::unique_ptr<llvm::MemoryBuffer> Content;
+  ContentEncoding Encoding;
+  llvm::Error Result = llvm::Error::success();
+};
+
+/// Collects the content of the file in memory, ready to be handed to the SDK
+/// without going through the file system
 class S3WritableFile : public WritableFile {
 private:
-  TemporaryFile TempFile;
-  std::unique_ptr<llvm::raw_fd_ostream> OS;
+  llvm::SmallVector<char, 0> Content;
+  llvm::raw_svector_ostream OS;
   std::string Path;
   ContentEncoding Encoding;
   S3StorageClient &Client;
 
 public:
-  S3WritableFile(TemporaryFile &&TempFile,
-                 std::unique_ptr<llvm::raw_fd_ostream> &&OS,
-                 llvm::StringRef Path,
+  S3WritableFile(llvm::StringRef Path,
                  ContentEncoding Encoding,
                  S3StorageClient &Client) :
-    TempFile(std::move(TempFile)),
-    OS(std::move(OS)),
-    Path(Path.str()),
-    Encoding(Encoding),
-    Client(Client) {}
+    OS(Content), Path(Path.str()), Encoding(Encoding), Client(Client) {}
 
-  llvm::raw_pwrite_stream &os() override { return *OS; }
+  llvm::raw_pwrite_stream &os() override { return OS; }
   llvm::Error commit() override {
-    OS->flush();
+    // The buffer is only uploaded, it doesn't need a null terminator
+    using llvm::SmallVectorMemoryBuffer;
+    auto Buffer = std::make_unique<SmallVectorMemoryBuffer>(std::move(Content),
+                                                            Path,
+                                                            false);
+
+    // Only schedule the upload, the client waits for it when needed
+    Client.enqueueUpload({ Path,
+                           generateNewFilename(Path),
+                           std::move(Buffer),
+                           Encoding });
+    return llvm::Error::success();
+  }
+};
 
-    Aws::S3::Model::PutObjectRequest Request;
-    Request.SetBucket(Client.Bucket);
+void S3StorageClient::enqueueUpload(PendingUpload &&Upload) {
+  if (UploadPool == nullptr) {
+    unsigned Threads = std::max(1U, Concurrency.getValue());
+    UploadPool = std::make_unique<llvm::ThreadPool>(
+      llvm::hardware_concurrency(Threads));
+  }
 
-    if (Encoding == ContentEncoding::Gzip)
-      Request.SetContentEncoding("gzip");
+  // std::list never moves its elements, the task can keep a reference
+  PendingUpload &Pending = PendingUploads.emplace_back(std::move(Upload));
+  UploadPool->async([this, &Pending]() {
+    Pending.Result = upload(resolvePath(Pending.NewFilename),
+                            *Pending.Content,
+                            Pending.Encoding);
 
-    std::string NewFilename = generateNewFilename(Path);
-    Request.SetKey(Client.resolvePath(NewFilename));
+    // The content is not needed anymore, don't wait for the flush to free it
+    Pending.Content.reset();
+  });
+}
 
-    auto File = std::make_shared<Aws::FStream>(TempFile.path().str(),
-                                               std::ios_base::in
-                                                 | std::ios_base::binary);
-    if (File->fail()) {
-      return llvm::createStringError(llvm::inconvertibleErrorCode(),
-                                     "Could not open temporary file");
+/// Wait for all the pending uploads, and record the ones that succeeded in
+/// FilenameMap, in the order in which they have been committed
+llvm::Error S3StorageClient::flushUploads() {
+  if (PendingUploads.empty())
+    return llvm::Error::success();
+
+  UploadPool->wait();
+
+  llvm::Error Result = llvm::Error::success();
+  for (PendingUpload &Upload : PendingUploads) {
+    if (Upload.Result) {
+      Result = llvm::joinErrors(std::move(Result), std::move(Upload.Result));
+      continue;
     }
 
-    Request.SetBody(File);
-    Aws::S3::Model::PutObjectOutcome Result = Client.Client.PutObject(Request);
+    invalidate(Upload.Path);
+    FilenameMap[Upload.Path] = Upload.NewFilename;
+    KnownFiles.insert(Upload.Path);
+  }
+
+  PendingUploads.clear();
+  return Result;
+}
+
+void S3StorageClient::invalidate(llvm::StringRef Path) {
+  KnownFiles.erase(Path);
+  DirectoriesAreValid = false;
+}
+
+llvm::Error S3StorageClient::upload(const std::string &Key,
+                                    const llvm::MemoryBuffer &Buffer,
+                                    ContentEncoding Encoding) {
+  if (Buffer.getBufferSize() <= getPartSize())
+    return putObject(Key, Buffer, Encoding);
+  else
+    return putMultipartObject(Key, Buffer, Encoding);
+}
+
+// The SDK wants mutable streams, but it only reads from upload bodies
+static std::shared_ptr<MemoryStream>
+makeBody(const llvm::MemoryBuffer &Buffer, uint64_t Offset, uint64_t Size) {
+  char *Start = const_cast<char *>(Buffer.getBufferStart()) + Offset;
+  return std::make_shared<MemoryStream>(Start, Size);
+}
+
+llvm::Error S3StorageClient::putObject(const std::string &Key,
+                                       const llvm::MemoryBuffer &Buffer,
+                                       ContentEncoding Encoding) {
+  Aws::S3::Model::PutObjectRequest Request;
+  Request.SetBucket(Bucket);
+  Request.SetKey(Key);
+
+  if (Encoding == ContentEncoding::Gzip)
+    Request.SetContentEncoding("gzip");
+
+  Request.SetBody(makeBody(Buffer, 0, Buffer.getBufferSize()));
+  Request.SetContentLength(Buffer.getBufferSize());
+  Aws::S3::Model::PutObjectOutcome Result = Client.PutObject(Request);
+  if (not Result.IsSuccess())
+    return toError(Result);
+
+  return llvm::Error::success();
+}
+
+llvm::Error
+S3StorageClient::putMultipartObject(const std::string &Key,
+                                    const llvm::MemoryBuffer &Buffer,
+                                    ContentEncoding Encoding) {
+  using namespace Aws::S3::Model;
+
+  CreateMultipartUploadRequest CreateRequest;
+  CreateRequest.SetBucket(Bucket);
+  CreateRequest.SetKey(Key);
+
+  if (Encoding == ContentEncoding::Gzip)
+    CreateRequest.SetContentEncoding("gzip");
+
+  auto CreateResult = Client.CreateMultipartUpload(CreateRequest);
+  if (not CreateResult.IsSuccess())
+    return toError(CreateResult);
+  const Aws::String &UploadID = CreateResult.GetResult().GetUploadId();
+
+  uint64_t Size = Buffer.getBufferSize();
+  uint64_t PartsCount = (Size + getPartSize() - 1) / getPartSize();
+  std::vector<CompletedPart> Parts(PartsCount);
+  auto UploadPart = [&](uint64_t Index, uint64_t Offset, uint64_t Length) {
+    UploadPartRequest Request;
+    Request.SetBucket(Bucket);
+    Request.SetKey(Key);
+    Request.SetUploadId(UploadID);
+    // Part numbers start from 1
+    Request.SetPartNumber(Index + 1);
+    Request.SetBody(makeBody(Buffer, Offset, Length));
+    Request.SetContentLength(Length);
+
+    UploadPartOutcome Result = Client.UploadPart(Request);
     if (not Result.IsSuccess())
       return toError(Result);
 
-    Client.FilenameMap[Path] = NewFilename;
+    Parts[Index].SetPartNumber(Index + 1);
+    Parts[Index].SetETag(Result.GetResult().GetETag());
     return llvm::Error::success();
+  };
+
+  if (llvm::Error Error = forEachPart(Size, UploadPart)) {
+    // Do not leave the parts dangling in the bucket
+    AbortMultipartUploadRequest AbortRequest;
+    AbortRequest.SetBucket(Bucket);
+    AbortRequest.SetKey(Key);
+    AbortRequest.SetUploadId(UploadID);
+    auto AbortResult = Client.AbortMultipartUpload(AbortRequest);
+    if (not AbortResult.IsSuccess())
+      return llvm::joinErrors(std::move(Error), toError(AbortResult));
+    return Error;
   }
-};
+
+  CompletedMultipartUpload Upload;
+  Upload.SetParts(Aws::Vector<CompletedPart>(Parts.begin(), Parts.end()));
+
+  CompleteMultipartUploadRequest CompleteRequest;
+  CompleteRequest.SetBucket(Bucket);
+  CompleteRequest.SetKey(Key);
+  CompleteRequest.SetUploadId(UploadID);
+  CompleteRequest.SetMultipartUpload(std::move(Upload));
+
+  auto CompleteResult = Client.CompleteMultipartUpload(CompleteRequest);
+  if (not CompleteResult.IsSuccess())
+    return toError(CompleteResult);
+
+  return llvm::Error::success();
+}
 
 class S3CredentialsProvider : public Aws::Auth::AWSCredentialsProvider {
 private:
@@ -263,6 +479,14 @@ S3StorageClient::S3StorageClient(llvm::StringRef RawURL) {
   RedactedURL += Bucket + '/' + SubPath;
 }
 
+S3StorageClient::~S3StorageClient() {
+  // The uploads reference this object, they must be done before destroying it
+  if (llvm::Error Error = flushUploads()) {
+    revng_log(Logger,
+              "Pending uploads failed: " << llvm::toString(std::move(Error)));
+  }
+}
+
 llvm::Expected<std::unique_ptr<S3StorageClient>>
 S3StorageClient::fromURL(llvm::StringRef URL) {
   if (not SDKIsInitialized)
@@ -307,29 +531,86 @@ std::string S3StorageClient::dumpString() const {
 }
 
 llvm::Expected<PathType> S3StorageClient::type(llvm::StringRef Path) {
-  if (FilenameMap.count(Path) > 0) {
+  auto MaybeTypes = types({ Path.str() });
+  if (not MaybeTypes)
+    return MaybeTypes.takeError();
+  return MaybeTypes->front();
+}
+
+llvm::Expected<std::vector<PathType>>
+S3StorageClient::types(llvm::ArrayRef<std::string> Paths) {
+  if (llvm::Error Error = flushUploads())
+    return Error;
+
+  if (not DirectoriesAreValid) {
+    Directories.clear();
+    for (auto &[MapPath, _] : FilenameMap) {
+      llvm::StringRef Parent = MapPath;
+      while (Parent.contains('/')) {
+        Parent = Parent.rsplit('/').first;
+        Directories.insert(Parent.str() + "/");
+      }
+    }
+    DirectoriesAreValid = true;
+  }
+
+  // Check that the files in the index are actually in the bucket, unless we
+  // have already seen them there, sending the requests concurrently
+  std::vector<PathType> Result(Paths.size(), PathType::Missing);
+  std::vector<size_t> ToCheck;
+  for (const auto &[Index, Path] : llvm::enumerate(Paths)) {
+    if (FilenameMap.count(Path) > 0) {
+      if (KnownFiles.contains(Path))
+        Result[Index] = PathType::File;
+      else
+        ToCheck.push_back(Index);
+    } else {
+      std::string Prefix = llvm::StringRef(Path).ends_with("/") ? Path :
+                                                                  Path + "/";
+      if (Directories.contains(Prefix))
+        Result[Index] = PathType::Directory;
+    }
+  }
+
+  std::mutex ErrorMutex;
+  llvm::Error Error = llvm::Error::success();
+  auto Check = [&](size_t Index) {
     Aws::S3::Model::HeadObjectRequest Request;
     Request.SetBucket(Bucket);
-    Request.SetKey(resolvePath(FilenameMap[Path]));
+    Request.SetKey(resolvePath(FilenameMap.find(Paths[Index])->second));
 
-    Aws::S3::Model::HeadObjectOutcome Result = Client.HeadObject(Request);
-    if (not Result.IsSuccess()) {
-      using Aws::Http::HttpResponseCode::NOT_FOUND;
-      if (Result.GetError().GetResponseCode() == NOT_FOUND)
-        return PathType::Missing;
-      else
-        return toError(Result);
+    Aws::S3::Model::HeadObjectOutcome Outcome = Client.HeadObject(Request);
+    if (Outcome.IsSuccess()) {
+      Result[Index] = PathType::File;
+      return;
     }
 
-    return PathType::File;
-  } else {
-    std::string Prefix = Path.endswith("/") ? Path.str() : (Path.str() + "/");
-    for (auto &[MapPath, _] : FilenameMap) {
-      if (MapPath.startswith(Prefix))
-        return PathType::Directory;
+    using Aws::Http::HttpResponseCode::NOT_FOUND;
+    if (Outcome.GetError().GetResponseCode() != NOT_FOUND) {
+      std::lock_guard Guard(ErrorMutex);
+      Error = llvm::joinErrors(std::move(Error), toError(Outcome));
     }
-    return PathType::Missing;
+  };
+
+  unsigned Threads = std::max(1U, Concurrency.getValue());
+  if (Threads == 1 or ToCheck.size() <= 1) {
+    for (size_t Index : ToCheck)
+      Check(Index);
+  } else {
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(Threads));
+    for (size_t Index : ToCheck)
+      Pool.async(Check, Index);
+    Pool.wait();
   }
+
+  if (Error)
+    return Error;
+
+  for (size_t Index : ToCheck)
+    if (Result[Index] == PathType::File)
+      KnownFiles.insert(Paths[Index]);
+
+  return Result;
 }
 
 llvm::Error S3StorageClient::createDirectory(llvm::StringRef Path) {
@@ -337,6 +618,10 @@ llvm::Error S3StorageClient::createDirectory(llvm::StringRef Path) {
 }
 
 llvm::Error S3StorageClient::remove(llvm::StringRef Path) {
+  if (llvm::Error Error = flushUploads())
+    return Error;
+
+  invalidate(Path);
   revng_assert(FilenameMap.count(Path) != 0);
   FilenameMap.erase(Path);
   return llvm::Error::success();
@@ -348,90 +633,92 @@ llvm::sys::path::Style S3StorageClient::getStyle() const {
 
 llvm::Error S3StorageClient::copy(llvm::StringRef Source,
                                   llvm::StringRef Destination) {
+  if (llvm::Error Error = flushUploads())
+    return Error;
+
   if (FilenameMap.count(Source) == 0) {
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "Source file %s does not exist",
                                    Source.str().c_str());
   }
 
+  invalidate(Destination);
   FilenameMap[Destination] = FilenameMap[Source];
+  if (KnownFiles.contains(Source))
+    KnownFiles.insert(Destination);
   return llvm::Error::success();
 }
 
 llvm::Expected<std::unique_ptr<ReadableFile>>
 S3StorageClient::getReadableFile(llvm::StringRef Path) {
-  using llvm::MemoryBuffer;
+  if (llvm::Error Error = flushUploads())
+    return Error;
+
   if (FilenameMap.count(Path) == 0) {
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "File %s does not exist",
                                    Path.str().c_str());
   }
 
-  Aws::S3::Model::GetObjectRequest Request;
-  Request.SetBucket(Bucket);
-  Request.SetKey(resolvePath(FilenameMap[Path]));
+  std::string Key = resolvePath(FilenameMap[Path]);
 
-  Aws::S3::Model::GetObjectOutcome Result = Client.GetObject(Request);
-  if (not Result.IsSuccess())
-    return toError(Result);
+  Aws::S3::Model::HeadObjectRequest HeadRequest;
+  HeadRequest.SetBucket(Bucket);
+  HeadRequest.SetKey(Key);
 
-  auto MaybeTemporary = TemporaryFile::make("revng-s3-storage");
-  if (!MaybeTemporary) {
-    return llvm::createStringError(MaybeTemporary.getError(),
-                                   "Could not create temporary file");
-  }
+  Aws::S3::Model::HeadObjectOutcome HeadResult = Client.HeadObject(HeadRequest);
+  if (not HeadResult.IsSuccess())
+    return toError(HeadResult);
 
-  std::ofstream OS(MaybeTemporary->path().str(), std::ios::binary);
-  if (OS.fail()) {
+  // Download straight into memory, in parallel ranges for large files
+  uint64_t Size = HeadResult.GetResult().GetContentLength();
+  auto Buffer = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(Size, Path);
+  if (Buffer == nullptr) {
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
-                                   "Could not open temporary file");
+                                   "Could not allocate a buffer for %s",
+                                   Path.str().c_str());
   }
 
-  constexpr size_t BufSize = 4096;
-  llvm::SmallVector<char> Buffer;
-  Buffer.resize_for_overwrite(BufSize);
-  auto &Body = Result.GetResult().GetBody();
+  auto GetPart = [&](uint64_t Index, uint64_t Offset, uint64_t Length) {
+    Aws::S3::Model::GetObjectRequest Request;
+    Request.SetBucket(Bucket);
+    Request.SetKey(Key);
+    Request.SetRange("bytes=" + std::to_string(Offset) + "-"
+                     + std::to_string(Offset + Length - 1));
+
+    char *Start = Buffer->getBufferStart() + Offset;
+    Request.SetResponseStreamFactory([Start, Length]() -> Aws::IOStream * {
+      return Aws::New<MemoryStream>("revng-s3-storage", Start, Length);
+    });
 
-  while (!Body.eof()) {
-    Body.read(Buffer.data(), BufSize);
-    OS.write(Buffer.data(), Body.gcount());
-  }
+    Aws::S3::Model::GetObjectOutcome Result = Client.GetObject(Request);
+    if (not Result.IsSuccess())
+      return toError(Result);
 
-  OS.flush();
-  OS.close();
+    if (static_cast<uint64_t>(Result.GetResult().GetContentLength()) != Length)
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     "Short read while downloading %s",
+                                     Path.str().c_str());
 
-  auto MaybeReadableStream = MemoryBuffer::getFile(MaybeTemporary->path());
-  if (not MaybeReadableStream) {
-    return llvm::createStringError(MaybeReadableStream.getError(),
-                                   "Failed to open the file for reading");
-  }
+    return llvm::Error::success();
+  };
 
-  return std::make_unique<S3ReadableFile>(std::move(MaybeTemporary.get()),
-                                          std::move(MaybeReadableStream.get()));
+  if (llvm::Error Error = forEachPart(Size, GetPart))
+    return Error;
+
+  return std::make_unique<S3ReadableFile>(std::move(Buffer));
 }
 
 llvm::Expected<std::unique_ptr<WritableFile>>
 S3StorageClient::getWritableFile(llvm::StringRef Path,
                                  ContentEncoding Encoding) {
-  auto MaybeTemporary = TemporaryFile::make("revng-s3-storage");
-  if (!MaybeTemporary) {
-    return llvm::createStringError(MaybeTemporary.getError(),
-                                   "Could not create temporary file");
-  }
-
-  std::error_code EC;
-  auto OS = std::make_unique<llvm::raw_fd_ostream>(MaybeTemporary->path(), EC);
-  if (EC)
-    return llvm::createStringError(EC, "Could not open temporary file");
-
-  return std::make_unique<S3WritableFile>(std::move(MaybeTemporary.get()),
-                                          std::move(OS),
-                                          Path,
-                                          Encoding,
-                                          *this);
+  return std::make_unique<S3WritableFile>(Path, Encoding, *this);
 }
 
 llvm::Error S3StorageClient::commit() {
+  if (llvm::Error Error = flushUploads())
+    return Error;
+
   std::string SerializedIndex;
 
   {
@@ -4,14 +4,22 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <list>
+#include <memory>
+
 #include "aws/core/auth/AWSCredentials.h"
 #include "aws/s3/S3Client.h"
 
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 
 #include "revng/Storage/StorageClient.h"
 
+namespace llvm {
+class ThreadPool;
+} // namespace llvm
+
 namespace revng {
 
 class S3WritableFile;
@@ -26,9 +34,21 @@ private:
   llvm::StringMap<std::string> FilenameMap;
   static constexpr auto IndexName = "index.yml";
 
+  /// Files that have been committed, but are still being uploaded in the
+  /// background. They're added to FilenameMap by flushUploads.
+  struct PendingUpload;
+  std::list<PendingUpload> PendingUploads;
+  std::unique_ptr<llvm::ThreadPool> UploadPool;
+
+  /// Files of FilenameMap whose object is known to be in the bucket
+  llvm::StringSet<> KnownFiles;
+  /// All the parent directories of the files in FilenameMap, rebuilt on demand
+  llvm::StringSet<> Directories;
+  bool DirectoriesAreValid = false;
+
 public:
   S3StorageClient(llvm::StringRef URL);
-  ~S3StorageClient() override = default;
+  ~S3StorageClient() override;
 
   static llvm::Expected<std::unique_ptr<S3StorageClient>>
   fromURL(llvm::StringRef URL);
@@ -38,6 +58,8 @@ public:
   }
 
   llvm::Expected<PathType> type(llvm::StringRef Path) override;
+  llvm::Expected<std::vector<PathType>>
+  types(llvm::ArrayRef<std::string> Paths) override;
   llvm::Error createDirectory(llvm::StringRef Path) override;
   llvm::Error remove(llvm::StringRef Path) override;
   llvm::sys::path::Style getStyle() const override;
@@ -60,6 +82,21 @@ public:
 private:
   std::string dumpString() const override;
   std::string resolvePath(llvm::StringRef Path);
+
+  void enqueueUpload(PendingUpload &&Upload);
+  llvm::Error flushUploads();
+  void invalidate(llvm::StringRef Path);
+
+  llvm::Error upload(const std::string &Key,
+                     const llvm::MemoryBuffer &Buffer,
+                     ContentEncoding Encoding);
+  llvm::Error putObject(const std::string &Key,
+                        const llvm::MemoryBuffer &Buffer,
+                        ContentEncoding Encoding);
+  llvm::Error putMultipartObject(const std::string &Key,
+                                 const llvm::MemoryBuffer &Buffer,
+                                 ContentEncoding Encoding);
+
   friend class S3WritableFile;
 };
 
@@ -11,3 +11,12 @@ using namespace llvm;
 cl::opt<bool> DebugNames("debug-names",
                          cl::desc("Use friendly names in non-user artifacts"),
                          cl::init(false));
+
+cl::opt<unsigned> Jobs("jobs",
+                       cl::desc("Number of threads to use, 0 means as many as "
+                                "the available cores"),
+                       cl::init(0));
+
+static cl::alias JobsAlias("j",
+                           cl::desc("Alias for --jobs"),
+                           cl::aliasopt(Jobs));
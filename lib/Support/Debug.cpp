@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -88,12 +89,17 @@ ScopedDebugFeature::~ScopedDebugFeature() {
 std::ostream &dbg(std::cerr);
 
 Logger<> PassesLog("passes");
-Logger<> ReleaseLog("release");
-Logger<> VerifyLog("verify");
+Logger<true> ReleaseLog("release");
+Logger<true> VerifyLog("verify");
+
+/// Serializes the writes of complete lines to dbg
+static std::mutex FlushMutex;
 
 template<bool X>
 void Logger<X>::flush(const LogTerminator &LineInfo) {
   if (X && Enabled) {
+    std::stringstream &Buffer = buffer();
+    std::lock_guard Lock(FlushMutex);
     std::string Pad;
 
     if (MaxLocationLength != 0) {
@@ -180,7 +186,7 @@ void Logger<false>::init() {
 }
 
 template<bool X>
-unsigned Logger<X>::IndentLevel;
+thread_local unsigned Logger<X>::IndentLevel;
 
 template<bool X>
 void Logger<X>::indent(unsigned Level) {
@@ -6,7 +6,9 @@
 
 #include <map>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Metadata.h"
@@ -32,22 +34,85 @@ llvm::MDNode *TagsSet::getMetadata(LLVMContext &C) const {
   return MDTuple::get(C, MDTags);
 }
 
-TagsSet TagsSet::from(const MDNode *MD) {
-  TagsSet Result;
+namespace {
+
+/// Per-thread cache of the parsed tag metadata of a single LLVMContext
+struct TagsCache {
+  const LLVMContext *Context = nullptr;
+  unsigned KindID = 0;
+  DenseMap<const MDNode *, SmallBitVector> Bits;
+
+  /// Drop everything if we're now dealing with a different context, in which
+  /// the kind ID is different and the nodes might have been freed
+  void switchTo(const LLVMContext &NewContext, StringRef MetadataName) {
+    if (Context == &NewContext)
+      return;
+
+    Context = &NewContext;
+    KindID = NewContext.getMDKindID(MetadataName);
+    Bits.clear();
+  }
+};
+
+} // namespace
+
+static thread_local TagsCache Cache;
+
+/// \returns the tags, indexed by Tag::id()
+static const std::vector<const Tag *> &tagsByID() {
+  static const std::vector<const Tag *> Result = [] {
+    std::vector<const Tag *> ByID(Tag::getAll().size(), nullptr);
+    for (const Tag *T : Tag::getAll())
+      ByID.at(T->id()) = T;
+    return ByID;
+  }();
+  return Result;
+}
 
+static const StringMap<const Tag *> &tagsByName() {
+  static const StringMap<const Tag *> Result = [] {
+    StringMap<const Tag *> ByName;
+    for (const Tag *T : Tag::getAll())
+      ByName[T->name()] = T;
+    return ByName;
+  }();
+  return Result;
+}
+
+const SmallBitVector &TagsSet::bitsOf(const GlobalObject *V) {
+  Cache.switchTo(V->getContext(), TagsMetadataName);
+  return bitsOf(V->getMetadata(Cache.KindID));
+}
+
+const SmallBitVector &TagsSet::bitsOf(const MDNode *MD) {
+  static const SmallBitVector Empty(Tag::getAll().size());
   if (MD == nullptr)
-    return Result;
+    return Empty;
 
+  Cache.switchTo(MD->getContext(), TagsMetadataName);
+  auto [It, New] = Cache.Bits.try_emplace(MD);
+  if (not New)
+    return It->second;
+
+  SmallBitVector &Result = It->second;
+  Result.resize(Tag::getAll().size());
   for (const MDOperand &Op : cast<MDTuple>(MD)->operands()) {
     StringRef Name = cast<MDString>(Op.get())->getString();
-    Tag *T = Tag::findByName(Name);
-    revng_assert(T != nullptr);
-    Result.Tags.insert(T);
+    auto TagIt = tagsByName().find(Name);
+    revng_assert(TagIt != tagsByName().end());
+    Result.set(TagIt->second->id());
   }
 
   return Result;
 }
 
+TagsSet TagsSet::from(const SmallBitVector &Bits) {
+  TagsSet Result;
+  for (unsigned ID : Bits.set_bits())
+    Result.Tags.insert(tagsByID()[ID]);
+  return Result;
+}
+
 } // namespace FunctionTags
 
 const llvm::CallInst *getCallToTagged(const llvm::Value *V,
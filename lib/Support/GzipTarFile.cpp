@@ -7,17 +7,43 @@
 
 // Some snippets of code were adapted from llvm/llvm/lib/Support/TarWriter.cpp
 
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <mutex>
+#include <optional>
+
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/GzipStream.h"
 #include "revng/Support/GzipTarFile.h"
 
 #include "archive.h"
 #include "archive_entry.h"
+#include "zlib.h"
+
+namespace cl = llvm::cl;
+
+static cl::opt<unsigned> CompressionLevel("archive-compression-level",
+                                          cl::desc("gzip compression level "
+                                                   "(1-9) of the files stored "
+                                                   "in archives, higher is "
+                                                   "slower but smaller"),
+                                          cl::cat(MainCategory),
+                                          cl::init(3));
+
+static int compressionLevel() {
+  return std::clamp<unsigned>(CompressionLevel, 1, 9);
+}
 
 // Each file in an archive must be aligned to this block size.
 static constexpr size_t BlockSize = 512;
@@ -136,10 +162,153 @@ writeFileHeader(llvm::raw_ostream &OS, llvm::StringRef Path, size_t Size) {
 }
 
 static void compressedPadding(llvm::raw_ostream &OS, size_t Size) {
+  // Paddings are shorter than a block and always compress the same way, so
+  // compress each size only once
+  if (Size < BlockSize) {
+    static std::mutex Mutex;
+    static std::array<llvm::SmallVector<char, 0>, BlockSize> Cache;
+
+    std::lock_guard Lock(Mutex);
+    llvm::SmallVector<char, 0> &Compressed = Cache[Size];
+    if (Compressed.empty()) {
+      llvm::SmallVector<char> Buffer(Size, '\0');
+      llvm::raw_svector_ostream CompressedOS(Compressed);
+      gzipCompress(CompressedOS, { Buffer.data(), Buffer.size() });
+    }
+
+    OS.write(Compressed.data(), Compressed.size());
+    return;
+  }
+
   llvm::SmallVector<char> Buffer(Size, '\0');
   return gzipCompress(OS, { Buffer.data(), Buffer.size() });
 }
 
+static llvm::Error createIndexError(const llvm::Twine &Message) {
+  return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                 "Cannot index archive: " + Message);
+}
+
+/// Decompress the gzip stream at the beginning of \p Input, which can be
+/// followed by other data, appending its contents to \p Output, or discarding
+/// them if \p Output is nullptr.
+/// \returns the size of the compressed stream
+static llvm::Expected<size_t>
+inflateStream(llvm::ArrayRef<char> Input, llvm::SmallVectorImpl<char> *Output) {
+  z_stream Stream = { .zalloc = Z_NULL, .zfree = Z_NULL, .opaque = Z_NULL };
+  constexpr int WindowBits = 15 + 16; // 32k of window, gzip header
+  revng_assert(inflateInit2(&Stream, WindowBits) == Z_OK);
+
+  std::array<char, 16 * 1024> Scratch;
+  auto *ScratchBegin = reinterpret_cast<Bytef *>(Scratch.data());
+
+  // See zlibCopyStream for the const_cast
+  const char *InputData = Input.data();
+  Stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(InputData));
+  Stream.avail_in = 0;
+  size_t NotProvided = Input.size();
+
+  int RC = Z_OK;
+  while (RC != Z_STREAM_END) {
+    if (Stream.avail_in == 0) {
+      // Truncated stream
+      if (NotProvided == 0)
+        break;
+
+      size_t Chunk = std::min<size_t>(NotProvided, UINT_MAX);
+      Stream.avail_in = Chunk;
+      NotProvided -= Chunk;
+    }
+
+    Stream.next_out = ScratchBegin;
+    Stream.avail_out = Scratch.size();
+    RC = inflate(&Stream, Z_NO_FLUSH);
+    if (RC != Z_OK and RC != Z_STREAM_END)
+      break;
+
+    if (Output != nullptr) {
+      size_t Produced = Scratch.size() - Stream.avail_out;
+      Output->append(Scratch.data(), Scratch.data() + Produced);
+    }
+  }
+
+  size_t Consumed = Stream.total_in;
+  revng_assert(inflateEnd(&Stream) == Z_OK);
+
+  if (RC != Z_STREAM_END)
+    return createIndexError("invalid or truncated gzip stream");
+
+  return Consumed;
+}
+
+struct ParsedHeader {
+  std::string Path;
+  size_t Size = 0;
+};
+
+/// Parse a header produced by writePaxHeader, if \p Header is the trailing
+/// padding of the archive, returns std::nullopt
+static llvm::Expected<std::optional<ParsedHeader>>
+parsePaxHeader(llvm::ArrayRef<char> Header) {
+  if (Header.size() < BlockSize)
+    return createIndexError("header too short");
+
+  auto IsZero = [](char C) { return C == '\0'; };
+  if (llvm::all_of(Header, IsZero))
+    return std::nullopt;
+
+  StructUstarHeader Pax;
+  std::memcpy(&Pax, Header.data(), BlockSize);
+  if (Pax.TypeFlag != 'x')
+    return createIndexError("not a PAX header");
+
+  size_t AttributesSize = 0;
+  llvm::StringRef SizeField(Pax.Size, sizeof(Pax.Size));
+  SizeField = SizeField.take_until(IsZero).trim();
+  if (SizeField.getAsInteger(8, AttributesSize))
+    return createIndexError("invalid PAX header size");
+
+  size_t ExpectedSize = BlockSize + AttributesSize
+                        + computePadding(AttributesSize) + BlockSize;
+  if (Header.size() != ExpectedSize)
+    return createIndexError("unexpected header layout");
+
+  // Each attribute is '<size> <key>=<value>\n', see formatPax
+  ParsedHeader Result;
+  bool HasPath = false;
+  bool HasSize = false;
+  llvm::StringRef Attributes(Header.data() + BlockSize, AttributesSize);
+  while (not Attributes.empty()) {
+    size_t RecordSize = 0;
+    llvm::StringRef SizeString = Attributes.split(' ').first;
+    if (SizeString.getAsInteger(10, RecordSize)
+        or RecordSize > Attributes.size()
+        or RecordSize <= SizeString.size() + 1)
+      return createIndexError("invalid PAX record");
+
+    llvm::StringRef Record = Attributes.take_front(RecordSize);
+    Attributes = Attributes.drop_front(RecordSize);
+    if (not Record.consume_back("\n"))
+      return createIndexError("invalid PAX record");
+    Record = Record.drop_front(SizeString.size() + 1);
+
+    auto [Key, Value] = Record.split('=');
+    if (Key == "path") {
+      Result.Path = Value.str();
+      HasPath = true;
+    } else if (Key == "size") {
+      if (Value.getAsInteger(10, Result.Size))
+        return createIndexError("invalid file size");
+      HasSize = true;
+    }
+  }
+
+  if (not HasPath or not HasSize)
+    return createIndexError("missing path or size");
+
+  return Result;
+}
+
 namespace revng {
 
 // Append a given file to an archive.
@@ -152,7 +321,7 @@ OffsetDescriptor GzipTarWriter::append(llvm::StringRef Path,
   writeFileHeader(*OS, Path, Data.size());
 
   Result.DataStart = OS->tell();
-  gzipCompress(*OS, { Data.data(), Data.size() });
+  gzipCompress(*OS, { Data.data(), Data.size() }, compressionLevel());
 
   Result.PaddingStart = OS->tell();
   if (size_t Padding = computePadding(Data.size()); Padding % BlockSize != 0)
@@ -163,6 +332,67 @@ OffsetDescriptor GzipTarWriter::append(llvm::StringRef Path,
   return Result;
 }
 
+llvm::SmallVector<char, 0>
+GzipTarWriter::compress(llvm::ArrayRef<char> Data) {
+  llvm::SmallVector<char, 0> Result;
+  llvm::raw_svector_ostream CompressedOS(Result);
+  gzipCompress(CompressedOS, Data, compressionLevel());
+  return Result;
+}
+
+PreparedArchiveMember GzipTarWriter::prepare(llvm::StringRef Path,
+                                             llvm::ArrayRef<char> Data) {
+  PreparedArchiveMember Result;
+  llvm::raw_svector_ostream MemberOS(Result.Bytes);
+  writeFileHeader(MemberOS, Path, Data.size());
+
+  Result.DataStart = MemberOS.tell();
+  gzipCompress(MemberOS, { Data.data(), Data.size() }, compressionLevel());
+
+  Result.PaddingStart = MemberOS.tell();
+  if (size_t Padding = computePadding(Data.size()); Padding % BlockSize != 0)
+    compressedPadding(MemberOS, Padding);
+
+  return Result;
+}
+
+OffsetDescriptor
+GzipTarWriter::appendPrepared(llvm::StringRef Path,
+                              const PreparedArchiveMember &Member) {
+  revng_assert(OS != nullptr);
+  revng_assert(not Filenames.contains(Path));
+
+  size_t Start = OS->tell();
+  OS->write(Member.Bytes.data(), Member.Bytes.size());
+
+  Filenames.insert(Path);
+  return { .Start = Start,
+           .DataStart = Start + Member.DataStart,
+           .PaddingStart = Start + Member.PaddingStart,
+           .End = Start + Member.Bytes.size() };
+}
+
+OffsetDescriptor GzipTarWriter::appendCompressed(llvm::StringRef Path,
+                                                 llvm::ArrayRef<char> Compressed,
+                                                 size_t Size) {
+  revng_assert(OS != nullptr);
+  revng_assert(not Filenames.contains(Path));
+
+  OffsetDescriptor Result = { .Start = OS->tell() };
+  writeFileHeader(*OS, Path, Size);
+
+  Result.DataStart = OS->tell();
+  OS->write(Compressed.data(), Compressed.size());
+
+  Result.PaddingStart = OS->tell();
+  if (size_t Padding = computePadding(Size); Padding % BlockSize != 0)
+    compressedPadding(*OS, Padding);
+
+  Result.End = OS->tell();
+  Filenames.insert(Path);
+  return Result;
+}
+
 void GzipTarWriter::close() {
   revng_assert(OS != nullptr);
   // The tar archive needs to be ended with two blocks of zeros
@@ -208,4 +438,93 @@ cppcoro::generator<ArchiveEntry> GzipTarReader::entries() {
   }
 }
 
+llvm::Expected<GzipTarIndex>
+GzipTarIndex::create(llvm::ArrayRef<char> Archive) {
+  GzipTarIndex Result(Archive);
+
+  // Each entry is made of a header stream, a data stream, and, if the size is
+  // not a multiple of BlockSize, a padding stream. The archive is terminated
+  // by a stream of zeros.
+  size_t Offset = 0;
+  while (true) {
+    if (Offset >= Archive.size())
+      return createIndexError("missing end of archive");
+
+    IndexedArchiveEntry Entry;
+    Entry.Offsets.Start = Offset;
+
+    llvm::SmallVector<char, BlockSize * 3> Header;
+    auto MaybeHeaderSize = inflateStream(Archive.drop_front(Offset), &Header);
+    if (not MaybeHeaderSize)
+      return MaybeHeaderSize.takeError();
+    Offset += *MaybeHeaderSize;
+
+    auto MaybeHeader = parsePaxHeader(Header);
+    if (not MaybeHeader)
+      return MaybeHeader.takeError();
+
+    // End of archive
+    if (not MaybeHeader->has_value())
+      break;
+
+    Entry.Filename = std::move(MaybeHeader->value().Path);
+    Entry.Size = MaybeHeader->value().Size;
+
+    // Find where the data ends, without keeping it
+    Entry.Offsets.DataStart = Offset;
+    auto MaybeDataSize = inflateStream(Archive.drop_front(Offset), nullptr);
+    if (not MaybeDataSize)
+      return MaybeDataSize.takeError();
+    Offset += *MaybeDataSize;
+
+    Entry.Offsets.PaddingStart = Offset;
+    if (computePadding(Entry.Size) % BlockSize != 0) {
+      auto MaybePaddingSize = inflateStream(Archive.drop_front(Offset),
+                                            nullptr);
+      if (not MaybePaddingSize)
+        return MaybePaddingSize.takeError();
+      Offset += *MaybePaddingSize;
+    }
+
+    Entry.Offsets.End = Offset;
+    Result.Entries.push_back(std::move(Entry));
+  }
+
+  return Result;
+}
+
+llvm::SmallVector<char, 0>
+GzipTarIndex::read(const IndexedArchiveEntry &Entry) const {
+  OffsetDescriptor Offsets = Entry.Offsets;
+  revng_assert(Offsets.PaddingStart <= Archive.size());
+
+  llvm::SmallVector<char, 0> Result;
+  Result.reserve(Entry.Size);
+  llvm::raw_svector_ostream OS(Result);
+  gzipDecompress(OS, Archive.slice(Offsets.DataStart, Offsets.dataSize()));
+  revng_assert(Result.size() == Entry.Size);
+
+  return Result;
+}
+
+std::vector<ArchiveEntry> GzipTarIndex::readAll() const {
+  std::vector<ArchiveEntry> Result(Entries.size());
+  auto ReadEntry = [this, &Result](size_t Index) {
+    const IndexedArchiveEntry &Entry = Entries[Index];
+    Result[Index] = ArchiveEntry{ Entry.Filename, read(Entry) };
+  };
+
+  if (Entries.size() <= 1) {
+    for (size_t Index = 0; Index < Entries.size(); ++Index)
+      ReadEntry(Index);
+  } else {
+    llvm::ThreadPool Pool(llvm::hardware_concurrency());
+    for (size_t Index = 0; Index < Entries.size(); ++Index)
+      Pool.async(ReadEntry, Index);
+    Pool.wait();
+  }
+
+  return Result;
+}
+
 } // namespace revng
@@ -76,13 +76,40 @@ static void createModuleDebugInfo(Module *M, llvm::StringRef SourcePath) {
 
 void createSelfReferencingDebugInfo(Module *M,
                                     StringRef SourcePath,
-                                    AssemblyAnnotationWriter *InnerAAW) {
+                                    AssemblyAnnotationWriter *InnerAAW,
+                                    raw_ostream &Output) {
   createModuleDebugInfo(M, SourcePath);
 
   SelfReferencingDbgAnnotationWriter Annotator(M->getContext(), InnerAAW);
 
-  raw_null_ostream NullStream;
-  M->print(NullStream, &Annotator);
+  M->print(Output, &Annotator);
+}
+
+void createSequentialDebugInfo(Module *M, StringRef SourcePath) {
+  createModuleDebugInfo(M, SourcePath);
+
+  unsigned DbgKind = M->getContext().getMDKindID("dbg");
+  unsigned Line = 1;
+  for (Function &F : M->functions()) {
+    // Ignore whatever is outside the root and the isolated functions
+    DISubprogram *Subprogram = F.getSubprogram();
+    if (Subprogram == nullptr or not isRootOrLifted(&F))
+      continue;
+
+    // The line of the function definition
+    ++Line;
+
+    for (BasicBlock &Block : F) {
+      // The line of the label
+      ++Line;
+
+      for (Instruction &I : Block) {
+        auto *Location = DILocation::get(M->getContext(), Line, 0, Subprogram);
+        I.setMetadata(DbgKind, Location);
+        ++Line;
+      }
+    }
+  }
 }
 
 static void createDebugInfoFromMetadata(Module *M,
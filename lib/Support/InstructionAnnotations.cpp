@@ -0,0 +1,249 @@
+/// \file InstructionAnnotations.cpp
+/// Side table of the textual annotations of the input instructions.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <limits>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/InstructionAnnotations.h"
+
+using namespace llvm;
+
+cl::opt<std::string> AnnotationsPath("record-annotations-to",
+                                     cl::desc("Store the annotations of "
+                                              "-record-asm and -record-ptc in "
+                                              "this file, instead of "
+                                              "attaching them to the IR"),
+                                     cl::value_desc("path"),
+                                     cl::init(""));
+
+static const char Magic[] = "RVNGANN1";
+
+static Error createError(const Twine &Message) {
+  return createStringError(inconvertibleErrorCode(),
+                           "Invalid instruction annotations: " + Message);
+}
+
+void InstructionAnnotations::record(Kind K,
+                                    const MetaAddress &Address,
+                                    StringRef NewText) {
+  revng_assert(K < KindsCount);
+  revng_assert(Address.isValid());
+
+  size_t Limit = std::numeric_limits<uint32_t>::max();
+  revng_check(Text.size() + NewText.size() <= Limit);
+
+  Entry NewEntry{ Address,
+                  static_cast<uint32_t>(Text.size()),
+                  static_cast<uint32_t>(NewText.size()) };
+  Text.append(NewText.begin(), NewText.end());
+
+  std::vector<Entry> &KindEntries = Entries[K];
+  if (not KindEntries.empty()
+      and not(KindEntries.back().Address < Address))
+    Sorted = false;
+  KindEntries.push_back(NewEntry);
+}
+
+StringRef InstructionAnnotations::get(Kind K,
+                                      const MetaAddress &Address) const {
+  revng_assert(K < KindsCount);
+  revng_assert(Sorted);
+
+  const std::vector<Entry> &KindEntries = Entries[K];
+  auto It = std::lower_bound(KindEntries.begin(),
+                             KindEntries.end(),
+                             Address,
+                             [](const Entry &LHS, const MetaAddress &RHS) {
+                               return LHS.Address < RHS;
+                             });
+  if (It == KindEntries.end() or It->Address != Address)
+    return {};
+
+  return StringRef(Text).substr(It->Offset, It->Size);
+}
+
+void InstructionAnnotations::sort() {
+  if (Sorted)
+    return;
+
+  for (std::vector<Entry> &KindEntries : Entries) {
+    auto Compare = [](const Entry &LHS, const Entry &RHS) {
+      return LHS.Address < RHS.Address;
+    };
+    std::stable_sort(KindEntries.begin(), KindEntries.end(), Compare);
+
+    auto SameAddress = [](const Entry &LHS, const Entry &RHS) {
+      return LHS.Address == RHS.Address;
+    };
+    auto NewEnd = std::unique(KindEntries.begin(),
+                              KindEntries.end(),
+                              SameAddress);
+    KindEntries.erase(NewEnd, KindEntries.end());
+  }
+
+  Sorted = true;
+}
+
+//
+// Serialization
+//
+// The format is the following:
+//
+//   magic        "RVNGANN1"
+//   text         ULEB128 size, then the bytes of all the annotations
+//   for each kind:
+//     count      ULEB128
+//     entries    the address as a ULEB128-prefixed string, then the offset
+//                and the size of the annotation in text, as ULEB128
+//
+// Entries are sorted by address and unique.
+//
+
+static void writeString(raw_ostream &OS, StringRef String) {
+  encodeULEB128(String.size(), OS);
+  OS << String;
+}
+
+void InstructionAnnotations::serialize(raw_ostream &OS) {
+  sort();
+
+  OS << Magic;
+  writeString(OS, Text);
+
+  for (const std::vector<Entry> &KindEntries : Entries) {
+    encodeULEB128(KindEntries.size(), OS);
+    for (const Entry &TheEntry : KindEntries) {
+      writeString(OS, TheEntry.Address.toString());
+      encodeULEB128(TheEntry.Offset, OS);
+      encodeULEB128(TheEntry.Size, OS);
+    }
+  }
+}
+
+namespace {
+
+class Reader {
+private:
+  const uint8_t *Cursor = nullptr;
+  const uint8_t *End = nullptr;
+
+public:
+  explicit Reader(StringRef Buffer) :
+    Cursor(Buffer.bytes_begin()), End(Buffer.bytes_end()) {}
+
+public:
+  bool atEnd() const { return Cursor == End; }
+
+  Expected<uint64_t> readULEB() {
+    unsigned Length = 0;
+    const char *Error = nullptr;
+    uint64_t Result = decodeULEB128(Cursor, &Length, End, &Error);
+    if (Error != nullptr)
+      return createError(Error);
+    Cursor += Length;
+    return Result;
+  }
+
+  Expected<StringRef> readString() {
+    auto MaybeSize = readULEB();
+    if (not MaybeSize)
+      return MaybeSize.takeError();
+
+    if (*MaybeSize > static_cast<uint64_t>(End - Cursor))
+      return createError("truncated string");
+
+    StringRef Result(reinterpret_cast<const char *>(Cursor), *MaybeSize);
+    Cursor += *MaybeSize;
+    return Result;
+  }
+};
+
+} // namespace
+
+Expected<InstructionAnnotations>
+InstructionAnnotations::deserialize(StringRef Buffer) {
+  if (not Buffer.consume_front(Magic))
+    return createError("unexpected header");
+
+  InstructionAnnotations Result;
+  Reader TheReader(Buffer);
+
+  auto MaybeText = TheReader.readString();
+  if (not MaybeText)
+    return MaybeText.takeError();
+  Result.Text = MaybeText->str();
+
+  for (std::vector<Entry> &KindEntries : Result.Entries) {
+    auto MaybeCount = TheReader.readULEB();
+    if (not MaybeCount)
+      return MaybeCount.takeError();
+
+    for (uint64_t I = 0; I < *MaybeCount; ++I) {
+      auto MaybeAddress = TheReader.readString();
+      if (not MaybeAddress)
+        return MaybeAddress.takeError();
+
+      auto MaybeOffset = TheReader.readULEB();
+      if (not MaybeOffset)
+        return MaybeOffset.takeError();
+
+      auto MaybeSize = TheReader.readULEB();
+      if (not MaybeSize)
+        return MaybeSize.takeError();
+
+      MetaAddress Address = MetaAddress::fromString(*MaybeAddress);
+      if (Address.isInvalid())
+        return createError("invalid address " + *MaybeAddress);
+
+      uint64_t TextSize = Result.Text.size();
+      if (*MaybeOffset > TextSize or *MaybeSize > TextSize - *MaybeOffset)
+        return createError("annotation out of bounds");
+
+      if (not KindEntries.empty()
+          and not(KindEntries.back().Address < Address))
+        return createError("entries are not sorted");
+
+      KindEntries.push_back({ Address,
+                              static_cast<uint32_t>(*MaybeOffset),
+                              static_cast<uint32_t>(*MaybeSize) });
+    }
+  }
+
+  if (not TheReader.atEnd())
+    return createError("trailing data");
+
+  return Result;
+}
+
+Error InstructionAnnotations::save(StringRef Path) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::OF_None);
+  if (EC)
+    return createStringError(EC, "Cannot open " + Path);
+
+  serialize(OS);
+  OS.close();
+
+  if (OS.has_error())
+    return createStringError(OS.error(), "Cannot write " + Path);
+
+  return Error::success();
+}
+
+Expected<InstructionAnnotations> InstructionAnnotations::load(StringRef Path) {
+  auto MaybeBuffer = MemoryBuffer::getFile(Path);
+  if (not MaybeBuffer)
+    return createStringError(MaybeBuffer.getError(), "Cannot read " + Path);
+
+  return deserialize((*MaybeBuffer)->getBuffer());
+}
@@ -9,9 +9,13 @@ extern "C" {
 #include "glob.h"
 }
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <vector>
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/ELFObjectFile.h"
@@ -19,10 +23,12 @@ extern "C" {
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 
-#include "revng/ADT/RecursiveCoroutine.h"
 #include "revng/ADT/STLExtras.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/FileParseCache.h"
 #include "revng/Support/Generator.h"
 #include "revng/Support/LDDTree.h"
 #include "revng/Support/OverflowSafeInt.h"
@@ -155,6 +161,49 @@ private:
   }
 };
 
+/// \returns the search paths listed in /etc/ld.so.conf
+///
+/// The file is parsed again only if it has been modified since the last time.
+static SmallVector<std::string, 16> ldSoConfSearchPaths() {
+  static std::mutex Mutex;
+  static std::optional<sys::TimePoint<>> CachedModificationTime;
+  static SmallVector<std::string, 16> CachedSearchPaths;
+
+  sys::TimePoint<> ModificationTime;
+  sys::fs::file_status Status;
+  if (not sys::fs::status("/etc/ld.so.conf", Status))
+    ModificationTime = Status.getLastModificationTime();
+
+  std::lock_guard Lock(Mutex);
+  if (CachedModificationTime != ModificationTime) {
+    CachedSearchPaths.clear();
+    LdSoConfParser(CachedSearchPaths).parse();
+    CachedModificationTime = ModificationTime;
+  }
+
+  return CachedSearchPaths;
+}
+
+/// What's relevant about an ELF to resolve its dependencies
+struct LibraryInfo {
+  bool IsELF = false;
+  bool Is64 = false;
+  bool NoDefault = false;
+  uint16_t EMachine = 0;
+  std::optional<std::string> RPath;
+  std::optional<std::string> RunPath;
+  std::vector<std::string> Needed;
+};
+
+static LibraryInfo parseLibraryInfo(StringRef Path);
+
+/// \returns the information about the ELF at \p Path, or nullptr if it
+///          cannot be accessed
+static std::shared_ptr<const LibraryInfo> getLibraryInfo(StringRef Path) {
+  static FileParseCache<LibraryInfo> Cache;
+  return Cache.get(Path, parseLibraryInfo);
+}
+
 /// \see man ld.so
 static std::optional<std::string>
 findLibrary(StringRef ToImport,
@@ -195,7 +244,7 @@ findLibrary(StringRef ToImport,
   }
 
   if (not NoDefault) {
-    LdSoConfParser(SearchPaths).parse();
+    llvm::append_range(SearchPaths, ldSoConfSearchPaths());
     SearchPaths.push_back("/" + LibName);
     SearchPaths.push_back("/usr/" + LibName);
   }
@@ -217,27 +266,18 @@ findLibrary(StringRef ToImport,
     }
 
     // Parse the binary
-    auto MaybeBinary = object::createBinary(Candidate);
-    if (auto Error = MaybeBinary.takeError()) {
-      revng_log(Log, "Can't create binary: " << Error);
-      llvm::consumeError(std::move(Error));
-      continue;
-    }
-
-    // Ensure it's an ELF
-    using namespace object;
-    auto *Elf = dyn_cast<ELFObjectFileBase>(MaybeBinary->getBinary());
-    if (Elf == nullptr) {
+    std::shared_ptr<const LibraryInfo> Info = getLibraryInfo(Candidate);
+    if (not Info or not Info->IsELF) {
       revng_log(Log, "Found " << Candidate.str() << " but it's not an ELF.");
       continue;
     }
 
     // Ensure it's the right machine
-    if (Elf->getEMachine() != EMachine) {
+    if (Info->EMachine != EMachine) {
       revng_log(Log,
                 "Found " << Candidate.str()
                          << " but it has the wrong e_machine: "
-                         << Elf->getEMachine() << " (expected " << EMachine
+                         << Info->EMachine << " (expected " << EMachine
                          << ").");
       continue;
     }
@@ -337,10 +377,12 @@ getDynamicStringTable(const ELFT &ELFObjectFile,
 }
 
 template<class ELFT>
-void lddtreeResolve(LDDTree &Dependencies,
-                    StringRef FileName,
-                    const ELFT &ELFObjectFile) {
+static void parseLibraryInfo(LibraryInfo &Info, const ELFT &ELFObjectFile) {
   const auto &TheELF = ELFObjectFile.getELFFile();
+  Info.IsELF = true;
+  Info.EMachine = TheELF.getHeader().e_machine;
+  Info.Is64 = (std::is_same_v<ELFT, object::ELF64LEObjectFile>
+               or std::is_same_v<ELFT, object::ELF64BEObjectFile>);
 
   auto MaybeDynamicEntries = TheELF.dynamicEntries();
 
@@ -353,10 +395,6 @@ void lddtreeResolve(LDDTree &Dependencies,
   using Elf_Dyn_Range = ELFT::Elf_Dyn_Range;
   Elf_Dyn_Range DynamicEntries = *MaybeDynamicEntries;
 
-  std::optional<StringRef> RunPath;
-  std::optional<StringRef> RPath;
-  bool NoDefault = false;
-
   // Look for .dynstr
   StringRef DynamicStringTable;
   if (auto MaybeDynamicStringTable = getDynamicStringTable(ELFObjectFile,
@@ -368,87 +406,125 @@ void lddtreeResolve(LDDTree &Dependencies,
     return;
   }
 
-  // Look for DT_RPATH and DT_RUNPATH
+  auto GetString = [&](uint64_t Value) -> std::optional<std::string> {
+    if (auto String = getDynamicString(TheELF, DynamicStringTable, Value))
+      return String->str();
+    return std::nullopt;
+  };
+
+  // Look for DT_RPATH, DT_RUNPATH and DT_NEEDED
   using Elf_Dyn = ELFT::Elf_Dyn;
   for (const Elf_Dyn &DynamicTag : DynamicEntries) {
     auto TheTag = DynamicTag.getTag();
     auto TheVal = DynamicTag.getVal();
     if (TheTag == llvm::ELF::DT_RUNPATH) {
-      RunPath = getDynamicString(TheELF, DynamicStringTable, TheVal);
+      Info.RunPath = GetString(TheVal);
     } else if (TheTag == llvm::ELF::DT_RPATH) {
-      RPath = getDynamicString(TheELF, DynamicStringTable, TheVal);
+      Info.RPath = GetString(TheVal);
     } else if (TheTag == llvm::ELF::DT_FLAGS_1) {
-      NoDefault = (TheVal & llvm::ELF::DF_1_NODEFLIB) != 0;
-    }
-  }
-
-  bool Is64 = (std::is_same_v<ELFT, object::ELF64LEObjectFile>
-               or std::is_same_v<ELFT, object::ELF64BEObjectFile>);
-
-  for (const Elf_Dyn &DynamicTag : DynamicEntries) {
-    auto TheTag = DynamicTag.getTag();
-    auto TheVal = DynamicTag.getVal();
-    if (TheTag == llvm::ELF::DT_NEEDED) {
-      auto LibName = getDynamicString(TheELF, DynamicStringTable, TheVal);
-      if (!LibName) {
+      Info.NoDefault = (TheVal & llvm::ELF::DF_1_NODEFLIB) != 0;
+    } else if (TheTag == llvm::ELF::DT_NEEDED) {
+      if (auto LibName = GetString(TheVal))
+        Info.Needed.push_back(std::move(*LibName));
+      else
         revng_log(Log, "Unable to parse needed library name");
-        continue;
-      }
-
-      if (auto LocOfLib = findLibrary(*LibName,
-                                      FileName,
-                                      Is64,
-                                      NoDefault,
-                                      TheELF.getHeader().e_machine,
-                                      RPath,
-                                      RunPath))
-        Dependencies[FileName.str()].push_back(*LocOfLib);
     }
   }
 }
 
-static RecursiveCoroutine<void> lddtreeHelper(LDDTree &Dependencies,
-                                              const std::string &Path,
-                                              unsigned CurrentLevel,
-                                              unsigned DepthLevel) {
-  revng_log(Log, "lddtree for " << Path << "\n");
-  LoggerIndent<> Ident(Log);
+static LibraryInfo parseLibraryInfo(StringRef Path) {
+  LibraryInfo Result;
 
   using namespace object;
   auto MaybeBinary = createBinary(Path);
   if (auto Error = MaybeBinary.takeError()) {
     revng_log(Log, "Can't create binary: " << Error);
     llvm::consumeError(std::move(Error));
-    rc_return;
+    return Result;
   }
 
   auto *Binary = MaybeBinary->getBinary();
   if (auto *ELFObjectFile = dyn_cast<ELF32LEObjectFile>(Binary))
-    lddtreeResolve(Dependencies, Path, *ELFObjectFile);
+    parseLibraryInfo(Result, *ELFObjectFile);
   else if (auto *ELFObjectFile = dyn_cast<ELF32BEObjectFile>(Binary))
-    lddtreeResolve(Dependencies, Path, *ELFObjectFile);
+    parseLibraryInfo(Result, *ELFObjectFile);
   else if (auto *ELFObjectFile = dyn_cast<ELF64LEObjectFile>(Binary))
-    lddtreeResolve(Dependencies, Path, *ELFObjectFile);
+    parseLibraryInfo(Result, *ELFObjectFile);
   else if (auto *ELFObjectFile = dyn_cast<ELF64BEObjectFile>(Binary))
-    lddtreeResolve(Dependencies, Path, *ELFObjectFile);
+    parseLibraryInfo(Result, *ELFObjectFile);
   else
     revng_log(Log, "Not an ELF.");
 
-  if (CurrentLevel == DepthLevel)
-    rc_return;
+  return Result;
+}
+
+/// \returns the paths of the libraries directly required by \p Path
+static SmallVector<std::string, 10> resolveDependencies(StringRef Path) {
+  revng_log(Log, "lddtree for " << Path << "\n");
+  LoggerIndent<> Ident(Log);
+
+  SmallVector<std::string, 10> Result;
+  std::shared_ptr<const LibraryInfo> Info = getLibraryInfo(Path);
+  if (not Info or not Info->IsELF)
+    return Result;
 
-  ++CurrentLevel;
-  for (auto &I : Dependencies) {
-    revng_log(Log, "Dependencies for " << I.first << ":\n");
-    for (auto &J : I.second)
-      if (!Dependencies.contains(J))
-        rc_recur lddtreeHelper(Dependencies, J, CurrentLevel, DepthLevel);
+  auto AsOptionalRef = [](const std::optional<std::string> &String) {
+    return String ? std::optional<StringRef>(*String) : std::nullopt;
+  };
+
+  for (const std::string &LibName : Info->Needed) {
+    if (auto LocOfLib = findLibrary(LibName,
+                                    Path,
+                                    Info->Is64,
+                                    Info->NoDefault,
+                                    Info->EMachine,
+                                    AsOptionalRef(Info->RPath),
+                                    AsOptionalRef(Info->RunPath)))
+      Result.push_back(*LocOfLib);
   }
+
+  return Result;
 }
 
 void lddtree(LDDTree &Dependencies,
              const std::string &Path,
              unsigned DepthLevel) {
-  if (DepthLevel > 0)
-    lddtreeHelper(Dependencies, Path, 1, DepthLevel);
+  std::set<std::string> Visited = { Path };
+  for (const auto &[Library, _] : Dependencies)
+    Visited.insert(Library);
+
+  // Visit the tree one level at a time, resolving the dependencies of the
+  // libraries at the same level in parallel. The logger is not thread safe,
+  // so don't use multiple threads if it's enabled.
+  std::vector<std::string> Frontier = { Path };
+  for (unsigned Level = 1; Level <= DepthLevel and not Frontier.empty();
+       ++Level) {
+    std::vector<SmallVector<std::string, 10>> Resolved(Frontier.size());
+    if (Frontier.size() == 1 or Log.isEnabled()) {
+      for (size_t I = 0; I < Frontier.size(); ++I)
+        Resolved[I] = resolveDependencies(Frontier[I]);
+    } else {
+      llvm::ThreadPool Pool(llvm::hardware_concurrency());
+      for (size_t I = 0; I < Frontier.size(); ++I)
+        Pool.async([&Resolved, &Frontier, I]() {
+          Resolved[I] = resolveDependencies(Frontier[I]);
+        });
+      Pool.wait();
+    }
+
+    std::vector<std::string> NextFrontier;
+    for (size_t I = 0; I < Frontier.size(); ++I) {
+      if (Resolved[I].empty())
+        continue;
+
+      auto &Entry = Dependencies[Frontier[I]];
+      for (std::string &Dependency : Resolved[I]) {
+        if (Visited.insert(Dependency).second)
+          NextFrontier.push_back(Dependency);
+        Entry.push_back(std::move(Dependency));
+      }
+    }
+
+    Frontier = std::move(NextFrontier);
+  }
 }
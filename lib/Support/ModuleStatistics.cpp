@@ -4,7 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/TypeFinder.h"
 
 #include "revng/ADT/ZipMapIterator.h"
@@ -205,3 +208,59 @@ ModuleStatistics ModuleStatistics::analyze(const llvm::Module &M) {
 
   return Result;
 }
+
+ModuleSize ModuleSize::measure(const llvm::Module &M) {
+  ModuleSize Result;
+
+  llvm::DenseSet<const MDNode *> Visited;
+  llvm::SmallVector<const MDNode *, 16> Worklist;
+  auto Enqueue = [&Visited, &Worklist](const Metadata *MD) {
+    if (auto *Node = dyn_cast_or_null<MDNode>(MD))
+      if (Visited.insert(Node).second)
+        Worklist.push_back(Node);
+  };
+
+  SmallVector<std::pair<unsigned, MDNode *>, 4> Attachments;
+  auto EnqueueAttachments = [&](const auto &Object) {
+    Attachments.clear();
+    Object.getAllMetadata(Attachments);
+    for (const auto &[Kind, Node] : Attachments)
+      Enqueue(Node);
+  };
+
+  for (const NamedMDNode &Named : M.named_metadata())
+    for (const MDNode *Node : Named.operands())
+      Enqueue(Node);
+
+  for (const GlobalVariable &Global : M.globals())
+    EnqueueAttachments(Global);
+
+  for (const Function &F : M) {
+    EnqueueAttachments(F);
+    if (F.isDeclaration())
+      continue;
+
+    ++Result.FunctionsCount;
+    for (const BasicBlock &BB : F) {
+      ++Result.BasicBlocksCount;
+      for (const Instruction &I : BB) {
+        ++Result.InstructionsCount;
+
+        // getAllMetadata includes the debug location
+        EnqueueAttachments(I);
+        for (const Use &Operand : I.operands())
+          if (auto *Wrapper = dyn_cast<MetadataAsValue>(Operand.get()))
+            Enqueue(Wrapper->getMetadata());
+      }
+    }
+  }
+
+  while (not Worklist.empty()) {
+    const MDNode *Node = Worklist.pop_back_val();
+    for (const MDOperand &Operand : Node->operands())
+      Enqueue(Operand.get());
+  }
+
+  Result.MetadataNodesCount = Visited.size();
+  return Result;
+}
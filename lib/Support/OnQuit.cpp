@@ -59,6 +59,7 @@ void OnQuitRegistry::install() {
 }
 
 void OnQuitRegistry::quit() {
+  std::lock_guard Lock(Mutex);
   for (std::function<void()> &Handler : Registry)
     Handler();
 }
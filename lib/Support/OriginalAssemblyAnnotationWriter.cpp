@@ -12,6 +12,7 @@
 
 #include "revng/ADT/STLExtras.h"
 #include "revng/Support/IRHelpers.h"
+#include "revng/Support/InstructionAnnotations.h"
 #include "revng/Support/OriginalAssemblyAnnotationWriter.h"
 
 using namespace llvm;
@@ -45,6 +46,14 @@ static void writeMetadataIfNew(const Instruction *I,
   }
 }
 
+/// Writes each line of \p Text as a comment
+static void writeLines(StringRef Text, formatted_raw_ostream &Output) {
+  SmallVector<StringRef, 8> Lines;
+  Text.split(Lines, '\n', -1, false);
+  for (StringRef Line : Lines)
+    Output << "\n  ; " << Line << "\n";
+}
+
 using OAAW = OriginalAssemblyAnnotationWriter;
 void OAAW::emitInstructionAnnot(const Instruction *I,
                                 formatted_raw_ostream &Output) {
@@ -53,5 +62,12 @@ void OAAW::emitInstructionAnnot(const Instruction *I,
   if (isRootOrLifted(I->getParent()->getParent())) {
     writeMetadataIfNew(I, OriginalInstrMDKind, Output, "\n  ; ");
     writeMetadataIfNew(I, PTCInstrMDKind, Output, "\n  ; ");
+
+    if (Annotations != nullptr and isCallTo(I, "newpc")) {
+      MetaAddress Address = blockIDFromNewPC(I).start();
+      using IA = InstructionAnnotations;
+      writeLines(Annotations->get(IA::Assembly, Address), Output);
+      writeLines(Annotations->get(IA::PTC, Address), Output);
+    }
   }
 }
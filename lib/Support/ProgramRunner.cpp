@@ -9,19 +9,33 @@
 #include <cstdlib>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
 
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/PathList.h"
 #include "revng/Support/ProgramRunner.h"
+#include "revng/Support/TemporaryFile.h"
 
 using namespace llvm;
 
 static Logger<> Log("program-runner");
 
+static cl::opt<unsigned> Jobs("program-runner-jobs",
+                              cl::desc("Maximum number of programs to run "
+                                       "concurrently in the background (0 "
+                                       "means one per hardware thread)"),
+                              cl::init(0));
+
+/// Programs might be run from multiple threads, serialize the logging
+static std::mutex LogMutex;
+
 ProgramRunner Runner;
 
 ProgramRunner::ProgramRunner() {
@@ -40,6 +54,8 @@ ProgramRunner::ProgramRunner() {
     Paths.push_back(BasePath.str());
 }
 
+ProgramRunner::~ProgramRunner() = default;
+
 bool ProgramRunner::isProgramAvailable(llvm::StringRef ProgramName) {
   llvm::SmallVector<llvm::StringRef, 64> PathsRef;
   for (const std::string &Path : Paths)
@@ -53,6 +69,36 @@ bool ProgramRunner::isProgramAvailable(llvm::StringRef ProgramName) {
 
 int ProgramRunner::run(llvm::StringRef ProgramName,
                        ArrayRef<std::string> Args) {
+  return runImpl(ProgramName, Args, false).ExitCode;
+}
+
+std::shared_future<ProgramRunner::Result>
+ProgramRunner::runAsync(llvm::StringRef ProgramName,
+                        ArrayRef<std::string> Args,
+                        bool CaptureOutput) {
+  {
+    std::lock_guard Lock(PoolMutex);
+    if (not Pool)
+      Pool = std::make_unique<ThreadPool>(hardware_concurrency(Jobs));
+  }
+
+  return Pool->async([this,
+                      ProgramName = ProgramName.str(),
+                      Args = std::vector<std::string>(Args.begin(), Args.end()),
+                      CaptureOutput]() {
+    return runImpl(ProgramName, Args, CaptureOutput);
+  });
+}
+
+static std::string readAll(StringRef Path) {
+  auto MaybeBuffer = MemoryBuffer::getFile(Path);
+  revng_assert(MaybeBuffer);
+  return MaybeBuffer->get()->getBuffer().str();
+}
+
+ProgramRunner::Result ProgramRunner::runImpl(llvm::StringRef ProgramName,
+                                             ArrayRef<std::string> Args,
+                                             bool CaptureOutput) {
   llvm::SmallVector<llvm::StringRef, 64> PathsRef;
   for (const std::string &Path : Paths)
     PathsRef.push_back(llvm::StringRef(Path));
@@ -66,15 +112,32 @@ int ProgramRunner::run(llvm::StringRef ProgramName,
 
   // Prepare actual arguments
   std::vector<StringRef> StringRefs{ *MaybeProgramPath };
-  Log << "Running " << StringRefs[0].str()
-      << " with the following arguments:\n";
-  for (const std::string &Arg : Args) {
-    StringRefs.push_back(Arg);
-    Log << "  " << Arg << "\n";
+  {
+    std::lock_guard Lock(LogMutex);
+    Log << "Running " << StringRefs[0].str()
+        << " with the following arguments:\n";
+    for (const std::string &Arg : Args) {
+      StringRefs.push_back(Arg);
+      Log << "  " << Arg << "\n";
+    }
+    Log << DoLog;
   }
-  Log << DoLog;
 
-  int ExitCode = llvm::sys::ExecuteAndWait(StringRefs[0], StringRefs);
+  Result Result;
+  if (not CaptureOutput) {
+    Result.ExitCode = llvm::sys::ExecuteAndWait(StringRefs[0], StringRefs);
+    return Result;
+  }
 
-  return ExitCode;
+  TemporaryFile Stdout("revng-program-runner", "stdout");
+  TemporaryFile Stderr("revng-program-runner", "stderr");
+  Optional<StringRef> Redirects[] = { None, Stdout.path(), Stderr.path() };
+  Result.ExitCode = llvm::sys::ExecuteAndWait(StringRefs[0],
+                                              StringRefs,
+                                              None,
+                                              Redirects);
+  Result.Stdout = readAll(Stdout.path());
+  Result.Stderr = readAll(Stderr.path());
+
+  return Result;
 }
@@ -21,7 +21,7 @@ PathList ResourceFinder({
 
 });
 
-std::string getComponentsHash() {
+static std::string computeComponentsHash() {
   std::string Directory = "share/revng/component-hashes";
   std::vector<std::string> Files = ResourceFinder.list(Directory, "");
   llvm::sort(Files);
@@ -37,4 +37,10 @@ std::string getComponentsHash() {
   return Result;
 }
 
+std::string getComponentsHash() {
+  // The installed components can't change while we're running
+  static const std::string Hash = computeComponentsHash();
+  return Hash;
+}
+
 } // namespace revng
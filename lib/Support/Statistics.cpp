@@ -5,6 +5,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/ManagedStatic.h"
+
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/Statistics.h"
 
@@ -15,3 +20,59 @@ cl::opt<bool> Statistics("statistics",
                                   "SIGINT. Use "
                                   "this argument, ignore -stats."),
                          cl::cat(MainCategory));
+
+namespace {
+
+struct StatisticsRegistry {
+  std::mutex Mutex;
+  std::vector<NamedStatistic *> Statistics;
+};
+
+} // namespace
+
+static llvm::ManagedStatic<StatisticsRegistry> Registry;
+
+NamedStatistic::NamedStatistic(llvm::StringRef Name) : Name(Name.str()) {
+  if (this->Name.empty())
+    return;
+
+  std::lock_guard Lock(Registry->Mutex);
+  Registry->Statistics.push_back(this);
+}
+
+NamedStatistic::~NamedStatistic() {
+  if (Name.empty())
+    return;
+
+  std::lock_guard Lock(Registry->Mutex);
+  std::erase(Registry->Statistics, this);
+}
+
+std::string serializeStatistics() {
+  std::string Result;
+  llvm::raw_string_ostream OS(Result);
+
+  std::lock_guard Lock(Registry->Mutex);
+  std::vector<NamedStatistic *> Sorted = Registry->Statistics;
+  llvm::sort(Sorted, [](NamedStatistic *LHS, NamedStatistic *RHS) {
+    return LHS->name() < RHS->name();
+  });
+
+  for (NamedStatistic *Statistic : Sorted) {
+    OS << "\"" << llvm::yaml::escape(Statistic->name()) << "\":\n";
+    Statistic->serialize(OS);
+  }
+
+  OS.flush();
+  return Result;
+}
+
+size_t detail::allocateStatisticSlot() {
+  static std::atomic<size_t> NextSlot = 0;
+  return NextSlot.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<void *> &detail::localStatisticShards() {
+  thread_local std::vector<void *> Shards;
+  return Shards;
+}
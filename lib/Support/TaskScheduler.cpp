@@ -0,0 +1,145 @@
+/// \file TaskScheduler.cpp
+/// Implementation of the process-wide pool of threads running TaskGroups.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <thread>
+#include <vector>
+
+#include "llvm/Support/Threading.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/CommonOptions.h"
+#include "revng/Support/TaskScheduler.h"
+
+using namespace revng;
+using detail::TaskGroupState;
+
+unsigned revng::jobs() {
+  if (Jobs != 0)
+    return Jobs;
+  return llvm::hardware_concurrency().compute_thread_count();
+}
+
+namespace {
+
+/// The workers and the queue of the groups with tasks to run
+///
+/// There's an entry in the queue for each spawned task. An entry might refer to
+/// a group whose tasks have already been run by the thread waiting for it, in
+/// which case it is simply dropped.
+class Scheduler {
+private:
+  std::mutex Mutex;
+  std::condition_variable HasWork;
+  std::deque<std::shared_ptr<TaskGroupState>> Ready;
+  std::vector<std::thread> Workers;
+  bool Quit = false;
+
+public:
+  explicit Scheduler(unsigned WorkersCount) {
+    for (unsigned I = 0; I < WorkersCount; ++I)
+      Workers.emplace_back([this] { work(); });
+  }
+
+  ~Scheduler() {
+    {
+      std::lock_guard Lock(Mutex);
+      Quit = true;
+    }
+    HasWork.notify_all();
+
+    for (std::thread &Worker : Workers)
+      Worker.join();
+  }
+
+public:
+  static Scheduler &get() {
+    static Scheduler TheScheduler(jobs() - 1);
+    return TheScheduler;
+  }
+
+public:
+  bool hasWorkers() const { return not Workers.empty(); }
+
+  void push(std::shared_ptr<TaskGroupState> State) {
+    {
+      std::lock_guard Lock(Mutex);
+      Ready.push_back(std::move(State));
+    }
+    HasWork.notify_one();
+  }
+
+private:
+  void work() {
+    while (true) {
+      std::shared_ptr<TaskGroupState> State;
+      {
+        std::unique_lock Lock(Mutex);
+        HasWork.wait(Lock, [this] { return Quit or not Ready.empty(); });
+        if (Ready.empty())
+          return;
+
+        State = std::move(Ready.front());
+        Ready.pop_front();
+      }
+
+      State->runOne();
+    }
+  }
+};
+
+} // namespace
+
+bool TaskGroupState::runOne() {
+  std::function<void()> Task;
+  {
+    std::lock_guard Lock(Mutex);
+    if (Queue.empty())
+      return false;
+    Task = std::move(Queue.front());
+    Queue.pop_front();
+  }
+
+  Task();
+
+  {
+    std::lock_guard Lock(Mutex);
+    revng_assert(Pending > 0);
+    --Pending;
+    if (Pending == 0)
+      Done.notify_all();
+  }
+
+  return true;
+}
+
+void TaskGroup::spawn(std::function<void()> Task) {
+  Scheduler &TheScheduler = Scheduler::get();
+
+  // Without workers, run the task right away
+  if (not TheScheduler.hasWorkers()) {
+    Task();
+    return;
+  }
+
+  {
+    std::lock_guard Lock(State->Mutex);
+    State->Queue.push_back(std::move(Task));
+    ++State->Pending;
+  }
+
+  TheScheduler.push(State);
+}
+
+void TaskGroup::wait() {
+  // Help running the tasks nobody picked up yet
+  while (State->runOne())
+    ;
+
+  // Wait for the tasks running on the workers
+  std::unique_lock Lock(State->Mutex);
+  State->Done.wait(Lock, [this] { return State->Pending == 0; });
+}
@@ -0,0 +1,90 @@
+/// \file TemporaryFile.cpp
+/// Creation of temporary files, preferably on a memory-backed file system.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdlib>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+
+#include "revng/Support/TemporaryFile.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> InMemoryDirectory("in-memory-temporary-directory",
+                                              cl::desc("Create the temporary "
+                                                       "files in this "
+                                                       "memory-backed "
+                                                       "directory, if "
+                                                       "TMPDIR is not set. "
+                                                       "Empty to disable."),
+                                              cl::value_desc("path"),
+                                              cl::init("/dev/shm"));
+
+static cl::opt<unsigned> InMemoryMinimumFree("in-memory-temporary-min-free",
+                                             cl::desc("Create temporary files "
+                                                      "in memory only if at "
+                                                      "least this many MiB "
+                                                      "are available there"),
+                                             cl::value_desc("MiB"),
+                                             cl::init(256));
+
+static Logger<> Log("temporary-file");
+
+/// \return true if a new temporary file should go in InMemoryDirectory
+static bool useInMemoryDirectory() {
+  if (InMemoryDirectory.empty())
+    return false;
+
+  // The user explicitly chose where temporary files should go
+  if (sys::Process::GetEnv("TMPDIR"))
+    return false;
+
+  if (not sys::fs::is_directory(InMemoryDirectory)
+      or sys::fs::access(InMemoryDirectory, sys::fs::AccessMode::Write))
+    return false;
+
+  // Memory-backed file systems are usually small, e.g., /dev/shm in a
+  // container: don't fill them up, or whoever is writing will fail halfway
+  ErrorOr<sys::fs::space_info> Space = sys::fs::disk_space(InMemoryDirectory);
+  if (not Space)
+    return false;
+
+  uint64_t MinimumFree = uint64_t(InMemoryMinimumFree) * 1024 * 1024;
+  return Space->available >= MinimumFree;
+}
+
+std::error_code TemporaryFile::create(const Twine &Prefix,
+                                      StringRef Suffix,
+                                      SmallVectorImpl<char> &Path) {
+  int FD = -1;
+  std::error_code EC;
+  if (useInMemoryDirectory()) {
+    // Same naming scheme as llvm::sys::fs::createTemporaryFile
+    SmallString<128> Model(InMemoryDirectory.getValue());
+    sys::path::append(Model, Prefix + "-%%%%%%");
+    if (not Suffix.empty())
+      Model += "." + Suffix.str();
+
+    EC = sys::fs::createUniqueFile(Model, FD, Path);
+    if (EC) {
+      revng_log(Log,
+                "Cannot create a temporary file in "
+                  << InMemoryDirectory.getValue() << ": " << EC.message());
+    }
+  }
+
+  // Fall back to the system temporary directory
+  if (FD == -1)
+    EC = sys::fs::createTemporaryFile(Prefix, Suffix, FD, Path);
+
+  if (EC)
+    return EC;
+
+  revng_log(Log, "Created " << StringRef(Path.data(), Path.size()));
+  return sys::Process::SafelyCloseFileDescriptor(FD);
+}
@@ -67,6 +67,13 @@ struct BitLivenessAnalysis {
     return std::max(LHS, RHS);
   }
 
+  bool combineValuesInPlace(uint32_t &Target, const uint32_t &Value) const {
+    if (Value <= Target)
+      return false;
+    Target = Value;
+    return true;
+  }
+
   bool isLessOrEqual(const uint32_t &LHS, const uint32_t &RHS) const {
     return LHS <= RHS;
   }
@@ -282,11 +289,17 @@ BitLivenessPass::Result BitLivenessPass::run(llvm::Function &F,
                                                                0,
                                                                Top,
                                                                ExtremalLabels);
+  // Nodes are in the same order as the instructions of the function
   BitLivenessPass::Result Result;
-  for (auto &[Label, MFPResult] : MFPRes) {
-    auto &Entry = Result[Label->Instruction];
-    Entry.Result = MFPResult.InValue;
-    Entry.Operands = MFPResult.OutValue;
+  Result.reserve(DataFlowGraph.size());
+  for (DataFlowNode *Node : DataFlowGraph.nodes()) {
+    auto It = MFPRes.find(Node);
+    if (It == MFPRes.end())
+      continue;
+
+    auto &Entry = Result[Node->Instruction];
+    Entry.Result = It->second.InValue;
+    Entry.Operands = It->second.OutValue;
   }
 
   revng_assert(not DataFlowGraph.verify());
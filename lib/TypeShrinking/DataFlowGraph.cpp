@@ -4,10 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <unordered_map>
-
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/InstIterator.h"
 
+#include "revng/Support/Assert.h"
 #include "revng/TypeShrinking/DataFlowGraph.h"
 
 using namespace llvm;
@@ -16,8 +16,12 @@ namespace TypeShrinking {
 GenericGraph<DataFlowNode> buildDataFlowGraph(Function &F) {
   GenericGraph<DataFlowNode> DataFlowGraph;
 
+  size_t InstructionsCount = F.getInstructionCount();
   std::vector<DataFlowNode *> Worklist;
-  std::unordered_map<Instruction *, DataFlowNode *> InstructionNodeMap;
+  Worklist.reserve(InstructionsCount);
+  llvm::DenseMap<Instruction *, DataFlowNode *> InstructionNodeMap;
+  InstructionNodeMap.reserve(InstructionsCount);
+  DataFlowGraph.reserve(InstructionsCount);
   // Initialization
   for (Instruction &I : instructions(F)) {
     DataFlowNode Node{ &I };
@@ -29,8 +33,9 @@ GenericGraph<DataFlowNode> buildDataFlowGraph(Function &F) {
   for (auto *DefNode : Worklist) {
     auto *Ins = DefNode->Instruction;
     for (auto &Use : Ins->uses()) {
-      auto *UseNode = InstructionNodeMap.at(cast<Instruction>(Use.getUser()));
-      UseNode->addSuccessor(DefNode);
+      auto It = InstructionNodeMap.find(cast<Instruction>(Use.getUser()));
+      revng_assert(It != InstructionNodeMap.end());
+      It->second->addSuccessor(DefNode);
     }
   }
 
@@ -160,6 +160,7 @@ static bool runTypeShrinking(Function &F,
 
         // Drop the original instruction
         eraseFromParent(I);
+        HasChanges = true;
       }
     }
   }
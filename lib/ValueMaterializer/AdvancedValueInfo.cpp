@@ -35,6 +35,28 @@ AdvancedValueInfoMFI::combineValues(const LatticeElement &LHS,
   return Result;
 }
 
+bool AdvancedValueInfoMFI::combineValuesInPlace(LatticeElement &Target,
+                                                const LatticeElement &Value)
+  const {
+  bool Changed = false;
+
+  for (auto &[Key, Range] : Value) {
+    auto [It, New] = Target.try_emplace(Key, Range);
+    if (New) {
+      Changed = true;
+      continue;
+    }
+
+    ConstantRangeSet Union = It->second.unionWith(Range);
+    if (Union != It->second) {
+      It->second = std::move(Union);
+      Changed = true;
+    }
+  }
+
+  return Changed;
+}
+
 bool AdvancedValueInfoMFI::isLessOrEqual(const LatticeElement &LHS,
                                          const LatticeElement &RHS) const {
   for (const auto &[LeftEntry, RightEntry] : zipmap_range(LHS, RHS)) {
@@ -18,8 +18,6 @@ using range_size_t = uint64_t;
 
 Logger<> &Log = ValueMaterializerLogger;
 
-const range_size_t MaxMaterializedValues = (1 << 16);
-
 template<typename Range>
 using RangeValueType = std::decay_t<decltype(*std::declval<Range>().begin())>;
 
@@ -220,7 +218,7 @@ std::string DataFlowNode::valueToString() const {
   }
 }
 
-static MaterializedValues materialize(const ConstantRangeSet &Range) {
+MaterializedValues materializeRange(const ConstantRangeSet &Range) {
   MaterializedValues Result;
   for (const APInt &Value : Range)
     Result.push_back(MaterializedValue::fromConstant(Value));
@@ -282,6 +280,7 @@ materialize(MemoryOracle &MO,
 RecursiveCoroutine<std::optional<MaterializedValues>>
 DataFlowGraph::materializeImpl(DataFlowGraph::Node *N,
                                MemoryOracle &MO,
+                               MaterializationBudget &Budget,
                                NodeValuesMap &Results) const {
   using namespace llvm;
   using Node = DataFlowGraph::Node;
@@ -293,16 +292,22 @@ DataFlowGraph::materializeImpl(DataFlowGraph::Node *N,
   revng_log(Log, "Materializing " << N->valueToString());
   LoggerIndent<> Indent(Log);
 
-  // Prevent attempting to materialize more than MaxMaterializedValues
-  if (N->SizeLowerBound > MaxMaterializedValues) {
+  if (not Budget.checkTime()) {
+    revng_log(Log, "Out of time. Bailing out.");
+    rc_return std::nullopt;
+  }
+
+  // Prevent attempting to materialize more than MaxValues
+  if (N->SizeLowerBound > Budget.MaxValues) {
     revng_log(Log,
               "Too many values to materialize: " << N->SizeLowerBound
                                                  << ". Bailing out.");
+    Budget.exhaustValues();
     rc_return std::nullopt;
   }
 
   if (N->UseOracle)
-    rc_return{ { ::materialize(*N->OracleRange), {} } };
+    rc_return{ { materializeRange(*N->OracleRange), {} } };
 
   MaterializedValues Result;
 
@@ -312,7 +317,10 @@ DataFlowGraph::materializeImpl(DataFlowGraph::Node *N,
 
     // For phi-likes, merge all the results of the successors
     for (Node *Successor : N->successors()) {
-      auto MaybeMaterialized = rc_recur materializeImpl(Successor, MO, Results);
+      auto MaybeMaterialized = rc_recur materializeImpl(Successor,
+                                                        MO,
+                                                        Budget,
+                                                        Results);
       if (not MaybeMaterialized)
         rc_return std::nullopt;
 
@@ -332,7 +340,10 @@ DataFlowGraph::materializeImpl(DataFlowGraph::Node *N,
 
     // Build vector of ranges
     for (Node *Successor : N->successors()) {
-      auto MaybeMaterialized = rc_recur materializeImpl(Successor, MO, Results);
+      auto MaybeMaterialized = rc_recur materializeImpl(Successor,
+                                                        MO,
+                                                        Budget,
+                                                        Results);
 
       if (not MaybeMaterialized)
         rc_return std::nullopt;
@@ -346,7 +357,8 @@ DataFlowGraph::materializeImpl(DataFlowGraph::Node *N,
     for (auto &MaterializedValues : MaterializedValuesVector)
       ToMaterialize *= MaterializedValues.size();
 
-    if (not ToMaterialize or *ToMaterialize > MaxMaterializedValues) {
+    if (not ToMaterialize or *ToMaterialize > Budget.MaxValues) {
+      Budget.exhaustValues();
       if (Log.isEnabled()) {
         Log << "Too many combinations to materialize:\n";
         unsigned OperandIndex = 0;
@@ -356,7 +368,7 @@ DataFlowGraph::materializeImpl(DataFlowGraph::Node *N,
           ++OperandIndex;
         }
 
-        Log << "Bailing out." << DoLog;
+        revng_log(Log, "Bailing out.");
       }
 
       rc_return{};
@@ -365,6 +377,9 @@ DataFlowGraph::materializeImpl(DataFlowGraph::Node *N,
     for (SmallVector<MaterializedValue, 2> &Operands :
          allCombinations(Ranges)) {
 
+      if (not Budget.checkTime())
+        rc_return std::nullopt;
+
       auto Value = ::materialize(MO, N->Value, Operands);
 
       if (not Value.isValid())
@@ -388,10 +403,11 @@ DataFlowGraph::materializeImpl(DataFlowGraph::Node *N,
                                                         "duplicates");
   }
 
-  if (Result.size() > MaxMaterializedValues) {
+  if (Result.size() > Budget.MaxValues) {
     revng_log(Log,
               "Too many values materialized: " << Result.size()
                                                << ". Bailing out.");
+    Budget.exhaustValues();
     rc_return std::nullopt;
   } else {
     revng_log(Log, Result.size() << " values have been materialized");
@@ -4,16 +4,56 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/GenericDomTreeConstruction.h"
 
+#include "revng/Support/Deadline.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/Statistics.h"
 #include "revng/ValueMaterializer/ValueMaterializer.h"
 
+using namespace llvm;
+
+static cl::opt<unsigned> MaxDFGNodes("vm-max-dfg-nodes",
+                                     cl::desc("Maximum number of nodes of the "
+                                              "data-flow graph of a "
+                                              "ValueMaterializer query, 0 "
+                                              "means no limit"),
+                                     cl::init(0));
+
+static cl::opt<uint64_t> MaxValues("vm-max-values",
+                                   cl::desc("Maximum number of values each "
+                                            "node of the data-flow graph of a "
+                                            "ValueMaterializer query can "
+                                            "materialize"),
+                                   cl::init(1 << 16));
+
+static cl::opt<unsigned> TimeBudget("vm-time-budget-ms",
+                                    cl::desc("Maximum time, in milliseconds, "
+                                             "a ValueMaterializer query can "
+                                             "take, 0 means no limit"),
+                                    cl::init(0));
+
+static CounterMap<std::string> BudgetStatistics("vm-budget");
+
 void ValueMaterializer::run() {
   revng_log(ValueMaterializerLogger,
             "Evaluating " << getName(V) << " using " << getName(Context)
                           << " as context");
 
+  Budget.MaxValues = MaxValues;
+  if (TimeBudget != 0) {
+    using namespace std::chrono;
+    Budget.Deadline = MaterializationBudget::Clock::now()
+                      + milliseconds(TimeBudget);
+  }
+
+  // Honor the deadline of the function being processed, if any
+  Budget.Deadline = std::min(Budget.Deadline, revng::DeadlineScope::current());
+
+  // Allocate the nodes of the graphs we build in our arena
+  NodeArena::Scope ArenaScope(Arena);
+
   DataFlowGraph = DataFlowGraph::fromValue(V, TheLimits);
 
   revng_log(ValueMaterializerLogger,
@@ -33,15 +73,72 @@ void ValueMaterializer::run() {
 
   DataFlowGraph.purgeUnreachable();
 
+  if (MaxDFGNodes != 0 and DataFlowGraph.size() > MaxDFGNodes) {
+    revng_log(ValueMaterializerLogger,
+              "The data-flow graph exceeds the budget of "
+                << MaxDFGNodes.getValue() << " nodes");
+    BudgetStatistics.push("dfg-nodes");
+    degrade();
+    return;
+  }
+
   computeOracleConstraints();
 
+  if (not Budget.checkTime()) {
+    revng_log(ValueMaterializerLogger, "Out of time after running the oracle");
+    BudgetStatistics.push("time");
+    degrade();
+    return;
+  }
+
   applyOracleResultsToDataFlowGraph();
 
   computeSizeLowerBound();
 
   electMaterializationStartingPoints();
 
-  Values = DataFlowGraph.materialize(DataFlowGraph.getEntryNode(), MO);
+  Values = DataFlowGraph.materialize(DataFlowGraph.getEntryNode(),
+                                     MO,
+                                     Budget);
+
+  if (Budget.valuesExhausted())
+    BudgetStatistics.push("values");
+
+  if (not Values and Budget.timeExhausted()) {
+    revng_log(ValueMaterializerLogger, "Out of time while materializing");
+    BudgetStatistics.push("time");
+    degrade();
+  }
+}
+
+void ValueMaterializer::degrade() {
+  OutOfBudget = true;
+
+  if (Oracle == Oracle::None)
+    return;
+
+  auto *I = dyn_cast<Instruction>(V);
+  if (I == nullptr or not I->getType()->isIntegerTy())
+    return;
+
+  // Use the range the oracle computed for V, if any, or ask LVI, which is
+  // cheaper than the other oracles
+  ConstantRangeSet Range;
+  auto It = OracleConstraints.find(I);
+  if (It != OracleConstraints.end())
+    Range = It->second;
+  else
+    Range = LVI.getConstantRange(I, Context);
+
+  if (Range.isFullSet() or Range.size().ugt(Budget.MaxValues))
+    return;
+
+  revng_log(ValueMaterializerLogger,
+            "Falling back to the " << Range.size().getLimitedValue()
+                                   << " values of the oracle range");
+  BudgetStatistics.push("degraded");
+  Values = materializeRange(Range);
+  Degraded = true;
 }
 
 void ValueMaterializer::computeOracleConstraints() {
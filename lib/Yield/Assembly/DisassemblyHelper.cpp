@@ -159,9 +159,11 @@ yield::Function DH::disassemble(const model::Function &Function,
         InstructionWithTheDelaySlot = Disassembled.Address;
       }
 
-      auto Bytes = BinaryView.getByAddress(CurrentAddress, Disassembled.Size);
-      revng_assert(Bytes.has_value());
-      Result.RawBytes() = yield::ByteContainer(Bytes->begin(), Bytes->end());
+      // The bytes of the instruction are a prefix of the bytes of the rest of
+      // the block, there's no need to look up the segment again
+      revng_assert(Disassembled.Size <= InstructionBytes.size());
+      auto Bytes = InstructionBytes.take_front(Disassembled.Size);
+      Result.RawBytes() = yield::ByteContainer(Bytes.begin(), Bytes.end());
 
       CurrentAddress += Disassembled.Size;
       revng_assert(CurrentAddress.isValid());
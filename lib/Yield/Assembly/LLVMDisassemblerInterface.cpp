@@ -5,9 +5,12 @@
 //
 
 #include <map>
+#include <mutex>
+#include <set>
 #include <string>
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/MC/MCInst.h"
 #include "llvm/MC/MCTargetOptions.h"
 #include "llvm/MC/TargetRegistry.h"
@@ -17,26 +20,94 @@
 #include "revng/Yield/Assembly/LLVMDisassemblerInterface.h"
 #include "revng/Yield/Function.h"
 
-/// \note: this might cause multithreading problems.
-static void ensureDisassemblersWereInitializedOnce() {
-  static bool WereTheyInitialized = false;
-  if (!WereTheyInitialized) {
+namespace {
+
+/// The functions registering the components of an LLVM target
+struct TargetInitializers {
+  void (*TargetInfo)() = nullptr;
+  void (*TargetMC)() = nullptr;
+  void (*Disassembler)() = nullptr;
+};
+
+} // namespace
+
+static std::map<std::string, TargetInitializers> collectInitializers() {
+  std::map<std::string, TargetInitializers> Result;
+
+#define LLVM_TARGET(TargetName)                                                \
+  Result[#TargetName].TargetInfo = LLVMInitialize##TargetName##TargetInfo;     \
+  Result[#TargetName].TargetMC = LLVMInitialize##TargetName##TargetMC;
+#include "llvm/Config/Targets.def"
+
+#define LLVM_DISASSEMBLER(TargetName)                                          \
+  Result[#TargetName].Disassembler = LLVMInitialize##TargetName##Disassembler;
+#include "llvm/Config/Disassemblers.def"
+
+  return Result;
+}
+
+/// \returns the name LLVM registers the target of \p Architecture with, an
+///          empty string if unknown
+static llvm::StringRef targetName(llvm::Triple::ArchType Architecture) {
+  switch (Architecture) {
+  case llvm::Triple::x86:
+  case llvm::Triple::x86_64:
+    return "X86";
+  case llvm::Triple::arm:
+    return "ARM";
+  case llvm::Triple::aarch64:
+    return "AArch64";
+  case llvm::Triple::mips:
+  case llvm::Triple::mipsel:
+    return "Mips";
+  case llvm::Triple::systemz:
+    return "SystemZ";
+  default:
+    return "";
+  }
+}
+
+/// Register only the LLVM target, and its disassembler, that \p Architecture
+/// needs, the first time it's needed
+///
+/// Initializing all the targets LLVM has been built with takes a significant
+/// portion of the startup time of short-lived tools, while a binary only ever
+/// needs one or two of them.
+static void ensureDisassemblerWasInitialized(llvm::Triple::ArchType
+                                               Architecture) {
+  static std::mutex Mutex;
+  static std::set<llvm::Triple::ArchType> Initialized;
+  static bool AllInitialized = false;
+
+  std::lock_guard Lock(Mutex);
+  if (AllInitialized or not Initialized.insert(Architecture).second)
+    return;
+
+  static const std::map<std::string, TargetInitializers>
+    Initializers = collectInitializers();
+  auto It = Initializers.find(targetName(Architecture).str());
+  if (It == Initializers.end() or It->second.Disassembler == nullptr) {
+    // Unknown architecture, fall back to initializing everything
     llvm::InitializeAllTargetInfos();
     llvm::InitializeAllTargetMCs();
     llvm::InitializeAllDisassemblers();
-
-    WereTheyInitialized = true;
+    AllInitialized = true;
+    return;
   }
+
+  const TargetInitializers &Target = It->second;
+  Target.TargetInfo();
+  Target.TargetMC();
+  Target.Disassembler();
 }
 
 using DI = LLVMDisassemblerInterface;
 DI::LLVMDisassemblerInterface(MetaAddressType::Values AddrType,
                               const model::DisassemblyConfiguration &Config) {
-  ensureDisassemblersWereInitializedOnce();
-
   auto LLVMArchitecture = MetaAddressType::arch(AddrType);
   revng_assert(LLVMArchitecture.has_value(),
                "Impossible to create a disassembler for a non-code section");
+  ensureDisassemblerWasInitialized(*LLVMArchitecture);
   auto Architecture = llvm::Triple::getArchTypeName(*LLVMArchitecture);
 
   // Workaround for ARM
@@ -83,6 +154,13 @@ DI::LLVMDisassemblerInterface(MetaAddressType::Values AddrType,
 
   InstructionInformation.reset(LLVMTarget->createMCInstrInfo());
 
+  // Not all the targets provide an analysis, the default one only relies on
+  // the description of the instructions
+  const llvm::MCInstrInfo *Info = InstructionInformation.get();
+  InstructionAnalysis.reset(LLVMTarget->createMCInstrAnalysis(Info));
+  if (InstructionAnalysis == nullptr)
+    InstructionAnalysis = std::make_unique<llvm::MCInstrAnalysis>(Info);
+
   unsigned AssemblyDialect = 0;
   if (*LLVMArchitecture == llvm::Triple::ArchType::x86
       || *LLVMArchitecture == llvm::Triple::ArchType::x86_64) {
@@ -389,6 +467,15 @@ DI::Disassembled DI::instruction(const MetaAddress &Where,
                                  llvm::ArrayRef<uint8_t> RawBytes) {
   revng_assert(Where.isValid() && !RawBytes.empty());
 
+  // Reuse the previous result, as long as it has been decoded from the same
+  // bytes
+  if (auto It = Cache.find(Where); It != Cache.end()) {
+    const auto &[Bytes, Cached] = It->second;
+    if (Bytes.size() <= RawBytes.size()
+        and RawBytes.take_front(Bytes.size()) == llvm::ArrayRef(Bytes))
+      return Cached;
+  }
+
   auto [Instruction, Size] = disassemble(Where, RawBytes, *Disassembler);
   if (Instruction.has_value()) {
     revng_assert(Size != 0);
@@ -398,6 +485,11 @@ DI::Disassembled DI::instruction(const MetaAddress &Where,
     const auto &Info = InstructionInformation->get(Instruction->getOpcode());
     Result.HasDelaySlot = Info.hasDelaySlot();
 
+    llvm::ArrayRef<uint8_t> Bytes = RawBytes.take_front(Size);
+    Cache.insert_or_assign(Where,
+                           CachedInstruction{ { Bytes.begin(), Bytes.end() },
+                                              Result });
+
     return Result;
   } else {
     if (Size == 0)
@@ -405,3 +497,32 @@ DI::Disassembled DI::instruction(const MetaAddress &Where,
     return makeInvalidInstruction(Where, Size, "MCDisassembler failed");
   }
 }
+
+DI::ControlFlowInformation DI::controlFlow(const MetaAddress &Where,
+                                           llvm::ArrayRef<uint8_t> RawBytes) {
+  revng_assert(Where.isValid() && !RawBytes.empty());
+
+  ControlFlowInformation Result;
+  auto [Instruction, Size] = disassemble(Where, RawBytes, *Disassembler);
+  if (not Instruction.has_value())
+    return Result;
+
+  revng_assert(Size != 0);
+  Result.Size = Size;
+
+  const llvm::MCInstrAnalysis &Analysis = *InstructionAnalysis;
+  const auto &Info = InstructionInformation->get(Instruction->getOpcode());
+  Result.HasDelaySlot = Info.hasDelaySlot();
+  Result.IsReturn = Analysis.isReturn(*Instruction);
+  Result.IsCall = Analysis.isCall(*Instruction);
+  Result.IsBranch = Analysis.isBranch(*Instruction);
+  Result.IsConditional = Analysis.isConditionalBranch(*Instruction);
+
+  uint64_t Target = 0;
+  if ((Result.IsBranch or Result.IsCall)
+      and not Analysis.isIndirectBranch(*Instruction)
+      and Analysis.evaluateBranch(*Instruction, Where.asPC(), Size, Target))
+    Result.Target = MetaAddress::fromPC(Where, Target);
+
+  return Result;
+}
@@ -89,10 +89,11 @@ Graph makeTreeImpl(const Graph &Input, std::string_view SlicePointLocation) {
 
   // Fill in the `Result` graph.
   for (const Node *Node : llvm::breadth_first(NV{ *Entry })) {
+    const auto *RealNeighbour = RealEdges.at(Node);
     for (auto Neighbour : llvm::children<INV>(Node)) {
       if (Ranks.contains(Neighbour)) {
         auto *NewNeighbour = FindOrAddHelper(Neighbour);
-        if (RealEdges.at(Node) == Neighbour) {
+        if (RealNeighbour == Neighbour) {
           // Emit a real edge, if this is the neighbour selected earlier.
           NewNeighbour->addSuccessor(FindOrAddHelper(Node));
         } else {
@@ -0,0 +1,36 @@
+/// \file ControlFlowCache.cpp
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/Support/Casting.h"
+
+#include "revng/Model/Binary.h"
+#include "revng/TupleTree/StructuralHash.h"
+#include "revng/Yield/Function.h"
+
+#include "ControlFlowCache.h"
+
+uint64_t yield::cfg::controlFlowFingerprint(const yield::Function &Function,
+                                            const model::Binary &Binary) {
+  using revng::detail::combineHash;
+
+  uint64_t Result = structuralHash(Function.Entry());
+  for (const yield::BasicBlock &BasicBlock : Function.Blocks()) {
+    Result = combineHash(Result, structuralHash(BasicBlock.ID()));
+    Result = combineHash(Result, structuralHash(BasicBlock.End()));
+    Result = combineHash(Result, BasicBlock.IsLabelAlwaysRequired());
+    Result = combineHash(Result, structuralHash(BasicBlock.Successors()));
+
+    // Whether a call falls through depends on the callee
+    for (const auto &Edge : BasicBlock.Successors()) {
+      if (auto *Call = llvm::dyn_cast<yield::CallEdge>(Edge.get())) {
+        using model::FunctionAttribute::NoReturn;
+        Result = combineHash(Result, Call->hasAttribute(Binary, NoReturn));
+      }
+    }
+  }
+
+  return Result;
+}
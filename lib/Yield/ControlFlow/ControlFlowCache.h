@@ -0,0 +1,65 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace model {
+class Binary;
+}
+namespace yield {
+class Function;
+}
+
+namespace yield::cfg {
+
+/// \returns a hash of everything in \p Function, and in \p Binary, its control
+///          flow depends on: the blocks, their successors and whether each
+///          callee returns
+///
+/// Instructions and labels are not included, they don't affect the shape of
+/// the graph.
+uint64_t controlFlowFingerprint(const yield::Function &Function,
+                                const model::Binary &Binary);
+
+/// What has been computed from the control flow of each function, by
+/// controlFlowFingerprint, shared by all the artifacts
+///
+/// A function whose control flow did not change, e.g., after a rename, or
+/// when both its assembly and its graph are requested, gets it back without
+/// going through its edges again.
+template<typename ValueT>
+class ControlFlowCache {
+private:
+  static constexpr size_t MaxEntries = 1 << 14;
+
+private:
+  std::mutex Mutex;
+  std::unordered_map<uint64_t, std::shared_ptr<const ValueT>> Entries;
+
+public:
+  template<typename CallableT>
+  std::shared_ptr<const ValueT> get(uint64_t Key, CallableT &&Compute) {
+    {
+      std::lock_guard Lock(Mutex);
+      auto It = Entries.find(Key);
+      if (It != Entries.end())
+        return It->second;
+    }
+
+    auto Result = std::make_shared<const ValueT>(Compute());
+
+    std::lock_guard Lock(Mutex);
+    if (Entries.size() >= MaxEntries)
+      Entries.clear();
+    Entries.try_emplace(Key, Result);
+    return Result;
+  }
+};
+
+} // namespace yield::cfg
@@ -4,6 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <optional>
+#include <vector>
+
 #include "revng/EarlyFunctionAnalysis/CFGHelpers.h"
 #include "revng/EarlyFunctionAnalysis/FunctionEdgeType.h"
 #include "revng/Model/Binary.h"
@@ -11,12 +15,36 @@
 #include "revng/Yield/ControlFlow/Extraction.h"
 #include "revng/Yield/ControlFlow/FallthroughDetection.h"
 #include "revng/Yield/ControlFlow/Graph.h"
+#include "revng/TupleTree/StructuralHash.h"
 #include "revng/Yield/Function.h"
 
-yield::cfg::PreLayoutGraph
-yield::cfg::extractFromInternal(const yield::Function &Function,
-                                const model::Binary &Binary,
-                                const Configuration &Configuration) {
+#include "ControlFlowCache.h"
+
+using yield::cfg::PreLayoutGraph;
+using yield::cfg::PreLayoutNode;
+
+namespace {
+
+/// The graph extractFromInternal builds, in a form that can be cached and
+/// turned into a graph again without looking at the function
+struct ExtractedGraph {
+  struct Edge {
+    size_t From = 0;
+    size_t To = 0;
+    yield::cfg::EdgeType Type = yield::cfg::EdgeType::Unconditional;
+  };
+
+  /// The basic block of each node, std::nullopt for the empty entry node
+  std::vector<std::optional<BasicBlockID>> Nodes;
+  std::vector<Edge> Edges;
+  size_t EntryNode = 0;
+};
+
+} // namespace
+
+static ExtractedGraph extract(const yield::Function &Function,
+                              const model::Binary &Binary,
+                              const yield::cfg::Configuration &Configuration) {
   using PLG = PreLayoutGraph;
   const auto &ControlFlowGraph = Function.Blocks();
   auto [Result, Lookup] = efa::buildControlFlowGraph<PLG>(ControlFlowGraph,
@@ -25,8 +53,10 @@ yield::cfg::extractFromInternal(const yield::Function &Function,
 
   if (!Configuration.AddExitNode) {
     auto ExitNodeIterator = Lookup.find(BasicBlockID::invalid());
-    if (ExitNodeIterator != Lookup.end())
+    if (ExitNodeIterator != Lookup.end()) {
       Result.removeNode(ExitNodeIterator->second);
+      Lookup.erase(ExitNodeIterator);
+    }
   }
 
   if (Configuration.AddEntryNode) {
@@ -57,7 +87,7 @@ yield::cfg::extractFromInternal(const yield::Function &Function,
         }
       } else if (CurrentNode.successorCount() == 1) {
         for (const auto &Successor : BasicBlock.Successors())
-          if (FunctionEdgeType::isCall(Successor->Type()))
+          if (yield::FunctionEdgeType::isCall(Successor->Type()))
             continue;
 
         auto Edge = *CurrentNode.successor_edges_begin();
@@ -67,5 +97,63 @@ yield::cfg::extractFromInternal(const yield::Function &Function,
     }
   }
 
-  return std::move(Result);
+  // Flatten the graph, preserving the order of the nodes and of the edges
+  std::map<const PreLayoutNode *, BasicBlockID> Blocks;
+  for (const auto &[ID, Node] : Lookup)
+    Blocks.try_emplace(Node, ID);
+
+  ExtractedGraph Extracted;
+  std::map<const PreLayoutNode *, size_t> Indices;
+  for (const PreLayoutNode *Node : Result.nodes()) {
+    if (Node == Result.getEntryNode())
+      Extracted.EntryNode = Extracted.Nodes.size();
+    Indices.try_emplace(Node, Extracted.Nodes.size());
+
+    auto It = Blocks.find(Node);
+    if (It != Blocks.end())
+      Extracted.Nodes.emplace_back(It->second);
+    else
+      Extracted.Nodes.emplace_back(std::nullopt);
+  }
+
+  for (const PreLayoutNode *Node : Result.nodes())
+    for (const auto &Edge : Node->successor_edges())
+      Extracted.Edges.push_back({ .From = Indices.at(Node),
+                                  .To = Indices.at(Edge.Neighbor),
+                                  .Type = Edge.Label->Type });
+
+  return Extracted;
+}
+
+static yield::cfg::ControlFlowCache<ExtractedGraph> Cache;
+
+PreLayoutGraph
+yield::cfg::extractFromInternal(const yield::Function &Function,
+                                const model::Binary &Binary,
+                                const Configuration &Configuration) {
+  using revng::detail::combineHash;
+  uint64_t Key = controlFlowFingerprint(Function, Binary);
+  Key = combineHash(Key, Configuration.AddEntryNode);
+  Key = combineHash(Key, Configuration.AddExitNode);
+  auto Extracted = Cache.get(Key, [&]() {
+    return extract(Function, Binary, Configuration);
+  });
+
+  PreLayoutGraph Result;
+  std::vector<PreLayoutNode *> Nodes;
+  Nodes.reserve(Extracted->Nodes.size());
+  for (const std::optional<BasicBlockID> &BasicBlock : Extracted->Nodes) {
+    if (BasicBlock.has_value())
+      Nodes.push_back(Result.addNode(*BasicBlock, Function.Entry()));
+    else
+      Nodes.push_back(Result.addNode());
+  }
+
+  for (const ExtractedGraph::Edge &Edge : Extracted->Edges) {
+    yield::cfg::Edge Label{ .Type = Edge.Type };
+    Nodes[Edge.From]->addSuccessor(Nodes[Edge.To], Label);
+  }
+
+  Result.setEntryNode(Nodes[Extracted->EntryNode]);
+  return Result;
 }
@@ -10,6 +10,8 @@
 #include "revng/Yield/ControlFlow/FallthroughDetection.h"
 #include "revng/Yield/Function.h"
 
+#include "ControlFlowCache.h"
+
 const yield::BasicBlock *
 yield::cfg::detectFallthrough(const yield::BasicBlock &BasicBlock,
                               const yield::Function &Function,
@@ -50,3 +52,38 @@ yield::cfg::labeledBlock(const yield::BasicBlock &BasicBlock,
 
   return Result;
 }
+
+static yield::cfg::ControlFlowCache<yield::cfg::FallthroughMap> Cache;
+
+std::shared_ptr<const yield::cfg::FallthroughMap>
+yield::cfg::detectFallthroughs(const yield::Function &Function,
+                               const model::Binary &Binary) {
+  uint64_t Key = controlFlowFingerprint(Function, Binary);
+  return Cache.get(Key, [&]() {
+    FallthroughMap Result;
+    for (const yield::BasicBlock &BasicBlock : Function.Blocks())
+      if (auto *Next = detectFallthrough(BasicBlock, Function, Binary))
+        Result.try_emplace(BasicBlock.ID(), Next->ID());
+    return Result;
+  });
+}
+
+llvm::SmallVector<const yield::BasicBlock *, 8>
+yield::cfg::labeledBlock(const yield::BasicBlock &BasicBlock,
+                         const yield::Function &Function,
+                         const FallthroughMap &Fallthroughs) {
+  if (BasicBlock.IsLabelAlwaysRequired() == false)
+    return {};
+
+  llvm::SmallVector<const yield::BasicBlock *, 8> Result = { &BasicBlock };
+
+  auto It = Fallthroughs.find(BasicBlock.ID());
+  while (It != Fallthroughs.end()) {
+    auto Next = Function.Blocks().find(It->second);
+    revng_assert(Next != Function.Blocks().end());
+    Result.push_back(&*Next);
+    It = Fallthroughs.find(It->second);
+  }
+
+  return Result;
+}
@@ -56,7 +56,7 @@ textSize(const SortedVector<yield::TaggedString> &Tagged) {
   revng_assert(!Tagged.empty());
 
   size_t LineLength = 0;
-  for (yield::TaggedString String : Tagged)
+  for (const yield::TaggedString &String : Tagged)
     LineLength += textSize(String).W;
 
   return yield::layout::Size(LineLength, 1);
@@ -6,6 +6,8 @@
 
 #include <unordered_map>
 
+#include "llvm/ADT/DenseSet.h"
+
 #include "revng/ADT/STLExtras.h"
 #include "revng/Model/Binary.h"
 #include "revng/Pipeline/Location.h"
@@ -15,11 +17,8 @@
 
 namespace CR = yield::crossrelations;
 
-using MetadataContainer = SortedVector<efa::ControlFlowGraph>;
-CR::CrossRelations::CrossRelations(const MetadataContainer &Metadata,
+CR::CrossRelations::CrossRelations(CFGGenerator Metadata,
                                    const model::Binary &Binary) {
-  revng_assert(Metadata.size() == Binary.Functions().size());
-
   namespace ranks = revng::ranks;
   using pipeline::toString;
 
@@ -37,7 +36,19 @@ CR::CrossRelations::CrossRelations(const MetadataContainer &Metadata,
     Inserter.insert(CR::RelationDescription(std::move(Location), {}));
   }
 
+  // Collect the call sites of each function first: inserting them one at a
+  // time into `IsCalledFrom` is quadratic for functions with many callers.
+  std::unordered_map<CR::RelationDescription *, std::vector<std::string>>
+    CallSites;
+  auto RecordCallSite = [this, &CallSites](const std::string &Callee,
+                                           const std::string &CallLocation) {
+    if (auto It = Relations().find(Callee); It != Relations().end())
+      CallSites[&*It].push_back(CallLocation);
+  };
+
+  size_t FunctionsCount = 0;
   for (const auto &[EntryAddress, _, ControlFlowGraph] : Metadata) {
+    ++FunctionsCount;
     for (const auto &BasicBlock : ControlFlowGraph) {
       auto CallLocation = toString(ranks::BasicBlock,
                                    EntryAddress,
@@ -49,15 +60,13 @@ CR::CrossRelations::CrossRelations(const MetadataContainer &Metadata,
             if (const auto &Callee = Edge->Destination(); Callee.isValid()) {
               // TODO: embed information about the call instruction into
               //       `CallLocation` after metadata starts providing it.
-              const auto L = toString(ranks::Function,
-                                      Callee.notInlinedAddress());
-              if (auto It = Relations().find(L); It != Relations().end())
-                It->IsCalledFrom().emplace(std::move(CallLocation));
+              RecordCallSite(toString(ranks::Function,
+                                      Callee.notInlinedAddress()),
+                             CallLocation);
             } else if (!CallEdge->DynamicFunction().empty()) {
-              const auto L = toString(ranks::DynamicFunction,
-                                      CallEdge->DynamicFunction());
-              if (auto It = Relations().find(L); It != Relations().end())
-                It->IsCalledFrom().emplace(std::move(CallLocation));
+              RecordCallSite(toString(ranks::DynamicFunction,
+                                      CallEdge->DynamicFunction()),
+                             CallLocation);
             } else {
               // Ignore indirect calls.
             }
@@ -68,6 +77,13 @@ CR::CrossRelations::CrossRelations(const MetadataContainer &Metadata,
       }
     }
   }
+
+  revng_assert(FunctionsCount == Binary.Functions().size());
+
+  for (auto &[Relation, Callers] : CallSites)
+    for (auto Inserter = Relation->IsCalledFrom().batch_insert_or_assign();
+         std::string &Caller : Callers)
+      Inserter.emplace_or_assign(std::move(Caller));
 }
 
 template<typename AddNodeCallable, typename AddEdgeCallable>
@@ -93,8 +109,9 @@ CR::CrossRelations::toCallGraph() const {
     auto [Iterator, Success] = LookupHelper.try_emplace(Location, Node);
     revng_assert(Success);
   };
-  auto AddEdge = [&LookupHelper](std::string_view Callee,
-                                 std::string_view Caller) {
+  llvm::DenseSet<std::pair<NodeView, NodeView>> Edges;
+  auto AddEdge = [&LookupHelper, &Edges](std::string_view Callee,
+                                         std::string_view Caller) {
     // This assumes all the call sites are represented as basic block
     // locations for all the relations covered by these two kinds.
     using namespace pipeline;
@@ -104,7 +121,7 @@ CR::CrossRelations::toCallGraph() const {
     auto *CallerNode = LookupHelper.at(CallerFunction.toString());
     auto *CalleeNode = LookupHelper.at(Callee);
 
-    if (!llvm::is_contained(CallerNode->successors(), CalleeNode))
+    if (Edges.insert({ CallerNode, CalleeNode }).second)
       CallerNode->addSuccessor(CalleeNode);
   };
   conversionHelper(*this, AddNode, AddEdge);
@@ -132,8 +149,9 @@ yield::calls::PreLayoutGraph CR::CrossRelations::toYieldGraph() const {
     auto [Iterator, Success] = LookupHelper.try_emplace(Location, Node);
     revng_assert(Success);
   };
-  auto AddEdge = [&LookupHelper](std::string_view Callee,
-                                 std::string_view Caller) {
+  llvm::DenseSet<std::pair<GraphNode *, GraphNode *>> Edges;
+  auto AddEdge = [&LookupHelper, &Edges](std::string_view Callee,
+                                         std::string_view Caller) {
     // This assumes all the call sites are represented as basic block
     // locations for all the relations covered by these two kinds.
     auto CallerLocation = *locationFromString(ranks::BasicBlock, Caller);
@@ -141,7 +159,7 @@ yield::calls::PreLayoutGraph CR::CrossRelations::toYieldGraph() const {
     auto *CallerNode = LookupHelper.at(CallerFunction.toString());
     auto *CalleeNode = LookupHelper.at(Callee);
 
-    if (!llvm::is_contained(CallerNode->successors(), CalleeNode))
+    if (Edges.insert({ CallerNode, CalleeNode }).second)
       CallerNode->addSuccessor(CalleeNode);
   };
   conversionHelper(*this, AddNode, AddEdge);
@@ -29,6 +29,8 @@ namespace revng::pipes {
 
 static const size_t BytesInLine = 16;
 
+static constexpr char HexDigits[] = "0123456789abcdef";
+
 static FormattedNumber formatNumber(uint64_t Number, unsigned Width = 8) {
   return FormattedNumber(Number, 0, Width, true, false, false);
 };
@@ -38,7 +40,7 @@ static void outputHexDump(const TupleTree<model::Binary> &Binary,
                           const CFGMap &CFGMap,
                           const BinaryFileContainer &SourceBinary,
                           StringRef OutputPath) {
-  auto BufferOrError = MemoryBuffer::getFileOrSTDIN(*SourceBinary.path());
+  auto BufferOrError = mapBinary(*SourceBinary.path());
   auto Buffer = cantFail(errorOrToExpected(std::move(BufferOrError)));
   RawBinaryView BinaryView(*Binary.get(), Buffer->getBuffer());
 
@@ -112,7 +114,15 @@ static void outputHexDump(const TupleTree<model::Binary> &Binary,
   Map::const_iterator Next = std::next(Current);
   const Map::const_iterator End = Instructions.end();
 
-  std::stack<ptml::Tag> OpenedTags;
+  // The location tags of an interval are reopened at the beginning of each
+  // line: serialize them once per interval.
+  Map::const_iterator SerializedInterval = End;
+  std::string IntervalOpenTags;
+  std::string IntervalCloseTags;
+
+  // Closing tags of all the tags that are currently open
+  std::string PendingCloseTags;
+
   for (const auto &[Segment, SegmentBinary] : BinaryView.segments()) {
     MetaAddress CurrentAddress = Segment.StartAddress();
     size_t Counter = 0;
@@ -156,16 +166,24 @@ static void outputHexDump(const TupleTree<model::Binary> &Binary,
       //  2. new line begins and previously opened (and closed on line end)
       //     interval is continued.
       if (IsStartOfInterval or (LineBegins and IsInsideInterval)) {
-        for (const std::string &Tag : Current->second) {
-          auto PTMLTag = CreateTag(Tag);
-          OpenedTags.push(PTMLTag);
-          Output << PTMLTag.open();
+        if (SerializedInterval != Current) {
+          IntervalOpenTags.clear();
+          IntervalCloseTags.clear();
+          for (const std::string &Tag : Current->second) {
+            auto PTMLTag = CreateTag(Tag);
+            IntervalOpenTags += PTMLTag.open();
+            IntervalCloseTags.insert(0, PTMLTag.close());
+          }
+          SerializedInterval = Current;
         }
+
+        Output << IntervalOpenTags;
+        PendingCloseTags.insert(0, IntervalCloseTags);
       }
 
       // Format number and put it to the output
       const uint64_t &B = SegmentBinary[Index];
-      Output << formatNumber(B, 2);
+      Output << HexDigits[B >> 4] << HexDigits[B & 0xF];
 
       // Increment counter of bytes printed in current line.
       ++Counter;
@@ -192,21 +210,17 @@ static void outputHexDump(const TupleTree<model::Binary> &Binary,
       //  1. next byte is not in current interval (end of interval) OR
       //  2. after just printed by there is end of line
       if (IsInsideInterval and (EndOfInterval or EndOfLine)) {
-        while (not OpenedTags.empty()) {
-          auto &PTMLTag = OpenedTags.top();
-          Output << PTMLTag.close();
-          OpenedTags.pop();
-        }
+        Output << PendingCloseTags;
+        PendingCloseTags.clear();
       }
 
       // At the end of each printed line of bytes in hex format (with location
       // tags), ASCII representation of current line is printed.
       if (EndOfLine) {
         // Output ASCII representation at the end of the line
-        std::string Temp;
-        raw_string_ostream Printable(Temp);
-        printHTMLEscaped(PrintableChars, Printable);
-        Output << "   | " << Printable.str() << " |\n";
+        Output << "   | ";
+        printHTMLEscaped(PrintableChars, Output);
+        Output << " |\n";
         PrintableChars.clear();
 
         // At the end of line, Counter is set to 0.
@@ -366,6 +366,7 @@ static std::string labeledBlock(const PTMLBuilder &B,
                                 const yield::BasicBlock &FirstBlock,
                                 const yield::Function &Function,
                                 const model::Binary &Binary,
+                                const yield::cfg::FallthroughMap *Fallthroughs,
                                 InstructionPrefixManager &&Prefixes = {}) {
   std::string Result;
   std::string Label = emitTagged(B, std::move(FirstBlock.Label()));
@@ -385,7 +386,10 @@ static std::string labeledBlock(const PTMLBuilder &B,
                         std::move(Prefixes))
              + "\n";
   } else {
-    auto BasicBlocks = yield::cfg::labeledBlock(FirstBlock, Function, Binary);
+    revng_assert(Fallthroughs != nullptr);
+    auto BasicBlocks = yield::cfg::labeledBlock(FirstBlock,
+                                                Function,
+                                                *Fallthroughs);
     if (BasicBlocks.empty())
       return "";
 
@@ -411,8 +415,14 @@ std::string yield::ptml::functionAssembly(const PTMLBuilder &B,
   std::string Result;
 
   InstructionPrefixManager P(Function, Binary);
+  auto Fallthroughs = yield::cfg::detectFallthroughs(Function, Binary);
   for (const auto &BasicBlock : Function.Blocks())
-    Result += labeledBlock<true>(B, BasicBlock, Function, Binary, std::move(P));
+    Result += labeledBlock<true>(B,
+                                 BasicBlock,
+                                 Function,
+                                 Binary,
+                                 Fallthroughs.get(),
+                                 std::move(P));
 
   return B.getTag(tags::Div, Result)
     .addAttribute(attributes::Scope, scopes::Function)
@@ -426,7 +436,7 @@ std::string yield::ptml::controlFlowNode(const PTMLBuilder &B,
   auto Iterator = Function.Blocks().find(BasicBlock);
   revng_assert(Iterator != Function.Blocks().end());
 
-  auto Result = labeledBlock<false>(B, *Iterator, Function, Binary);
+  auto Result = labeledBlock<false>(B, *Iterator, Function, Binary, nullptr);
   revng_assert(!Result.empty());
 
   return Result;
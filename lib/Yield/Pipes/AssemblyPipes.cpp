@@ -12,8 +12,10 @@
 #include "revng/PTML/Doxygen.h"
 #include "revng/PTML/Tag.h"
 #include "revng/Pipeline/AllRegistries.h"
+#include "revng/Pipeline/FunctionCostReport.h"
 #include "revng/Pipeline/Pipe.h"
 #include "revng/Pipeline/RegisterPipe.h"
+#include "revng/Pipeline/TargetBudget.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Support/YAMLTraits.h"
@@ -50,8 +52,11 @@ void ProcessAssembly::run(pipeline::ExecutionContext &Context,
 
   for (const model::Function &Function :
        getFunctionsAndCommit(Context, Output.name())) {
+    pipeline::FunctionCostScope Cost(Function.Entry());
+    pipeline::TargetBudgetScope Budget(Function.Entry());
 
     const auto &Metadata = Cache.getControlFlowGraph(Function.Entry());
+    Cost.setBlocks(Metadata.Blocks().size());
 
     auto Disassembled = Helper.disassemble(Function,
                                            Metadata,
@@ -2,12 +2,18 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <ranges>
+#include <string>
+#include <vector>
+
 #include "revng/Model/Binary.h"
 #include "revng/Pipeline/Pipe.h"
 #include "revng/Pipeline/RegisterContainerFactory.h"
 #include "revng/Pipeline/RegisterPipe.h"
+#include "revng/Pipeline/TargetBudget.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
+#include "revng/Support/TaskScheduler.h"
 #include "revng/Yield/Function.h"
 #include "revng/Yield/Pipes/YieldControlFlow.h"
 #include "revng/Yield/SVG.h"
@@ -23,6 +29,12 @@ void YieldControlFlow::run(pipeline::ExecutionContext &Context,
   const auto &Model = revng::getModelFromContext(Context);
   ptml::PTMLBuilder B;
 
+  // Reading the model is tracked per target, hence it must happen while the
+  // target is being committed, on this thread. Collect what the graphs need
+  // from the model first, then lay them out, which takes most of the time and
+  // doesn't touch the model, in parallel.
+  std::vector<MetaAddress> Entries;
+  std::vector<yield::svg::ControlFlowGraphInputs> Graphs;
   for (const model::Function &Function :
        getFunctionsAndCommit(Context, Output.name())) {
     MetaAddress Address = Function.Entry();
@@ -32,11 +44,24 @@ void YieldControlFlow::run(pipeline::ExecutionContext &Context,
     revng_assert(MaybeFunction && MaybeFunction->verify());
     revng_assert((*MaybeFunction)->Entry() == Address);
 
-    Output.insert_or_assign((*MaybeFunction)->Entry(),
-                            yield::svg::controlFlowGraph(B,
+    Entries.push_back(Address);
+    Graphs.push_back(yield::svg::prepareControlFlowGraph(B,
                                                          **MaybeFunction,
                                                          *Model));
   }
+
+  std::vector<std::string> Results(Graphs.size());
+  auto LayOut = [&](size_t Index) {
+    pipeline::TargetBudgetScope Budget(Entries[Index]);
+    Results[Index] = yield::svg::controlFlowGraph(B, Graphs[Index]);
+
+    // Release the graph as soon as possible, the batch can be large
+    Graphs[Index] = {};
+  };
+  revng::parallelForEach(std::views::iota(size_t(0), Graphs.size()), LayOut);
+
+  for (size_t Index = 0; Index < Entries.size(); ++Index)
+    Output.insert_or_assign(Entries[Index], std::move(Results[Index]));
 }
 
 } // end namespace revng::pipes
@@ -27,6 +27,23 @@ using ptml::PTMLBuilder;
 
 namespace revng::pipes {
 
+using CFGGenerator = yield::crossrelations::CrossRelations::CFGGenerator;
+
+/// Parse the CFGs of the functions of \p Binary one at a time: each one is
+/// released as soon as the next one is requested, rather than keeping the
+/// objects of all of them alive until the end
+static CFGGenerator parseCFGs(const CFGMap &CFGMap,
+                              const model::Binary &Binary) {
+  for (const auto &[Address, CFGString] : CFGMap) {
+    if (not Binary.Functions().contains(Address))
+      continue;
+
+    auto MaybeCFG = TupleTree<efa::ControlFlowGraph>::fromString(CFGString);
+    TupleTree<efa::ControlFlowGraph> CFG = llvm::cantFail(std::move(MaybeCFG));
+    co_yield *CFG;
+  }
+}
+
 void ProcessCallGraph::run(pipeline::ExecutionContext &Context,
                            const CFGMap &CFGMap,
                            CrossRelationsFileContainer &OutputFile) {
@@ -36,18 +53,12 @@ void ProcessCallGraph::run(pipeline::ExecutionContext &Context,
   // Access the model
   const auto &Model = getModelFromContext(Context);
 
-  // Gather function metadata
-  SortedVector<efa::ControlFlowGraph> Metadata;
-  for (const auto &[Address, CFGString] : CFGMap) {
-    auto MaybeCFG = TupleTree<efa::ControlFlowGraph>::fromString(CFGString);
-    Metadata.insert(*llvm::cantFail(std::move(MaybeCFG)));
-  }
-
   // If some functions are missing, do not output anything
-  if (Metadata.size() != Model->Functions().size())
-    return;
+  for (const model::Function &Function : Model->Functions())
+    if (not CFGMap.contains(Function.Entry()))
+      return;
 
-  OutputFile.emplace(Metadata, *Model);
+  OutputFile.emplace(parseCFGs(CFGMap, *Model), *Model);
 
   Context.commitUniqueTarget(OutputFile);
 }
@@ -0,0 +1,327 @@
+/// \file PreviewPipes.cpp
+/// Recover an approximated CFG of each function by decoding its instructions.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+#include "llvm/Support/Error.h"
+
+#include "revng/EarlyFunctionAnalysis/ControlFlowGraph.h"
+#include "revng/Lift/LoadBinaryPass.h"
+#include "revng/Model/Binary.h"
+#include "revng/Model/RawBinaryView.h"
+#include "revng/Pipeline/FunctionCostReport.h"
+#include "revng/Pipeline/RegisterPipe.h"
+#include "revng/Pipeline/TargetBudget.h"
+#include "revng/Pipes/ModelGlobal.h"
+#include "revng/Support/CommonOptions.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/Yield/Assembly/DisassemblyHelper.h"
+#include "revng/Yield/Assembly/LLVMDisassemblerInterface.h"
+#include "revng/Yield/Pipes/PreviewCFG.h"
+
+static Logger<> Log("preview-cfg");
+
+using Edge = UpcastablePointer<efa::FunctionEdgeBase>;
+
+static Edge makeEdge(const MetaAddress &Destination,
+                     efa::FunctionEdgeType::Values Type) {
+  BasicBlockID ID = Destination.isValid() ? BasicBlockID(Destination) :
+                                            BasicBlockID::invalid();
+  return Edge::make<efa::FunctionEdge>(ID, Type);
+}
+
+/// Builds the CFG of a function through a recursive descent over its
+/// instructions, starting from the entry point
+class PreviewCFGBuilder {
+private:
+  struct Instruction {
+    LLVMDisassemblerInterface::ControlFlowInformation Flow;
+
+    /// The size of the instruction, including its delay slot, if any
+    uint64_t Size = 0;
+  };
+
+private:
+  LLVMDisassemblerInterface &Disassembler;
+  const RawBinaryView &BinaryView;
+  const model::Binary &Binary;
+  MetaAddress Entry;
+
+  std::map<MetaAddress, Instruction> Instructions;
+  std::set<MetaAddress> Leaders;
+  std::vector<MetaAddress> Worklist;
+
+public:
+  PreviewCFGBuilder(LLVMDisassemblerInterface &Disassembler,
+                    const RawBinaryView &BinaryView,
+                    const model::Binary &Binary,
+                    const MetaAddress &Entry) :
+    Disassembler(Disassembler),
+    BinaryView(BinaryView),
+    Binary(Binary),
+    Entry(Entry) {}
+
+public:
+  /// \returns the CFG of the function, or nullopt if there's no code at its
+  ///          entry point
+  std::optional<efa::ControlFlowGraph> build() {
+    if (not isMapped(Entry))
+      return std::nullopt;
+
+    addLeader(Entry);
+    while (not Worklist.empty()) {
+      MetaAddress Address = Worklist.back();
+      Worklist.pop_back();
+      explore(Address);
+    }
+
+    efa::ControlFlowGraph Result;
+    Result.Entry() = Entry;
+    for (const MetaAddress &Leader : Leaders)
+      Result.Blocks().insert(makeBlock(Leader));
+
+    return Result;
+  }
+
+private:
+  bool isMapped(const MetaAddress &Address) const {
+    if (not Address.isValid())
+      return false;
+
+    auto MaybeBytes = BinaryView.getFromAddressOn(Address);
+    return MaybeBytes.has_value() and MaybeBytes->size() >= Address.alignment();
+  }
+
+  bool isOtherFunction(const MetaAddress &Address) const {
+    return Address != Entry and Binary.Functions().contains(Address);
+  }
+
+  void addLeader(const MetaAddress &Address) {
+    if (Leaders.insert(Address).second)
+      Worklist.push_back(Address);
+  }
+
+  /// Decode the instruction at \p Address, which must be mapped
+  Instruction decode(const MetaAddress &Address) {
+    auto Bytes = *BinaryView.getFromAddressOn(Address);
+
+    Instruction Result;
+    Result.Flow = Disassembler.controlFlow(Address, Bytes);
+    if (Result.Flow.Size == 0) {
+      // Skip an instruction-sized chunk, the block will end here
+      Result.Size = Address.alignment();
+      return Result;
+    }
+
+    Result.Size = Result.Flow.Size;
+    if (Result.Flow.HasDelaySlot) {
+      MetaAddress Slot = Address + Result.Size;
+      uint64_t SlotSize = 0;
+      if (isMapped(Slot)) {
+        auto SlotBytes = *BinaryView.getFromAddressOn(Slot);
+        SlotSize = Disassembler.controlFlow(Slot, SlotBytes).Size;
+      }
+      Result.Size += SlotSize != 0 ? SlotSize : Slot.alignment();
+    }
+
+    return Result;
+  }
+
+  static bool isTerminator(const Instruction &Instruction) {
+    const auto &Flow = Instruction.Flow;
+    return Flow.Size == 0 or Flow.IsReturn or Flow.IsCall or Flow.IsBranch;
+  }
+
+  bool fallsThrough(const Instruction &Instruction) const {
+    const auto &Flow = Instruction.Flow;
+    if (Flow.IsCall) {
+      if (Flow.Target.isValid()) {
+        auto It = Binary.Functions().find(Flow.Target);
+        if (It != Binary.Functions().end()
+            and It->Attributes().contains(model::FunctionAttribute::NoReturn))
+          return false;
+      }
+      return true;
+    }
+
+    return Flow.IsConditional;
+  }
+
+  /// Decode the instructions starting from \p Address, until the end of the
+  /// basic block, registering the leaders that are met along the way
+  void explore(MetaAddress Address) {
+    while (true) {
+      auto [It, New] = Instructions.try_emplace(Address);
+      if (not New) {
+        // We met code which has already been decoded, it has to start a new
+        // block so that the blocks we emit don't overlap
+        addLeader(Address);
+        return;
+      }
+
+      It->second = decode(Address);
+      const Instruction &Current = It->second;
+      const auto &Flow = Current.Flow;
+      MetaAddress Next = Address + Current.Size;
+
+      if (Flow.Size == 0 or Flow.IsReturn)
+        return;
+
+      if (Flow.IsBranch) {
+        const MetaAddress &Target = Flow.Target;
+        if (isMapped(Target) and not isOtherFunction(Target))
+          addLeader(Target);
+      }
+
+      if (isTerminator(Current)) {
+        if (fallsThrough(Current) and isMapped(Next))
+          addLeader(Next);
+        return;
+      }
+
+      if (not isMapped(Next))
+        return;
+
+      Address = Next;
+    }
+  }
+
+  efa::BasicBlock makeBlock(const MetaAddress &Start) const {
+    using namespace efa::FunctionEdgeType;
+
+    efa::BasicBlock Result;
+    Result.ID() = BasicBlockID(Start);
+
+    MetaAddress Address = Start;
+    while (true) {
+      const Instruction &Current = Instructions.at(Address);
+      const auto &Flow = Current.Flow;
+      MetaAddress Next = Address + Current.Size;
+      Result.End() = Next;
+
+      if (Flow.Size == 0) {
+        Result.Successors().insert(makeEdge(MetaAddress::invalid(),
+                                            Unreachable));
+        return Result;
+      }
+
+      if (Flow.IsReturn) {
+        Result.Successors().insert(makeEdge(MetaAddress::invalid(), Return));
+        return Result;
+      }
+
+      if (Flow.IsCall) {
+        auto Call = Edge::make<efa::CallEdge>();
+        auto &TheCall = *llvm::cast<efa::CallEdge>(Call.get());
+        if (Binary.Functions().contains(Flow.Target))
+          TheCall.Destination() = BasicBlockID(Flow.Target);
+        if (fallsThrough(Current) and not Leaders.contains(Next))
+          TheCall.Attributes().insert(model::FunctionAttribute::NoReturn);
+        Result.Successors().insert(std::move(Call));
+
+        if (Leaders.contains(Next))
+          Result.Successors().insert(makeEdge(Next, DirectBranch));
+        return Result;
+      }
+
+      if (Flow.IsBranch) {
+        const MetaAddress &Target = Flow.Target;
+        if (isOtherFunction(Target)) {
+          auto Call = Edge::make<efa::CallEdge>();
+          auto &TheCall = *llvm::cast<efa::CallEdge>(Call.get());
+          TheCall.Destination() = BasicBlockID(Target);
+          TheCall.IsTailCall() = true;
+          Result.Successors().insert(std::move(Call));
+        } else if (Leaders.contains(Target)) {
+          Result.Successors().insert(makeEdge(Target, DirectBranch));
+        } else {
+          // Indirect or out of the binary: we cannot tell where it goes
+          Result.Successors().insert(makeEdge(MetaAddress::invalid(),
+                                              LongJmp));
+        }
+
+        if (Flow.IsConditional and Leaders.contains(Next))
+          Result.Successors().insert(makeEdge(Next, DirectBranch));
+        return Result;
+      }
+
+      if (Leaders.contains(Next)) {
+        Result.Successors().insert(makeEdge(Next, DirectBranch));
+        return Result;
+      }
+
+      if (not Instructions.contains(Next)) {
+        // We run out of the mapped code
+        Result.Successors().insert(makeEdge(MetaAddress::invalid(),
+                                            Unreachable));
+        return Result;
+      }
+
+      Address = Next;
+    }
+  }
+};
+
+namespace revng::pipes {
+
+void PreviewCFG::run(pipeline::ExecutionContext &Context,
+                     const BinaryFileContainer &SourceBinary,
+                     CFGMap &Output) {
+  if (not SourceBinary.exists())
+    return;
+
+  const auto &Model = getModelFromContext(Context);
+
+  revng_assert(SourceBinary.path().has_value());
+  auto MaybeBinary = cantFail(loadBinary(*Model, *SourceBinary.path()));
+  const RawBinaryView &BinaryView = MaybeBinary.first;
+
+  DissassemblyHelper Helper;
+  const auto &Configuration = Model->Configuration().Disassembly();
+
+  for (const model::Function &Function :
+       getFunctionsAndCommit(Context, Output.name())) {
+    MetaAddress Entry = Function.Entry();
+    pipeline::FunctionCostScope Cost(Entry);
+    pipeline::TargetBudgetScope Budget(Entry);
+
+    auto &Disassembler = Helper.getDisassemblerFor(Entry.type(),
+                                                   Configuration);
+    PreviewCFGBuilder Builder(Disassembler, BinaryView, *Model, Entry);
+    std::optional<efa::ControlFlowGraph> CFG = Builder.build();
+
+    if (not CFG.has_value()) {
+      // Emit a placeholder, consumers expect the entry block to exist
+      revng_log(Log, "No code at the entry of " << Entry.toString());
+      CFG.emplace();
+      CFG->Entry() = Entry;
+      efa::BasicBlock Block;
+      Block.ID() = BasicBlockID(Entry);
+      Block.End() = Entry + Entry.alignment();
+      Block.Successors().insert(makeEdge(MetaAddress::invalid(),
+                                         efa::FunctionEdgeType::Unreachable));
+      CFG->Blocks().insert(std::move(Block));
+    }
+
+    if (DebugNames)
+      CFG->OriginalName() = Function.OriginalName();
+
+    Cost.setBlocks(CFG->Blocks().size());
+    revng_log(Log,
+              Entry.toString() << ": " << CFG->Blocks().size() << " blocks");
+
+    Output[Entry] = toString(*CFG);
+  }
+}
+
+} // namespace revng::pipes
+
+static pipeline::RegisterPipe<revng::pipes::PreviewCFG> X;
@@ -7,6 +7,7 @@
 #include <unordered_map>
 
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormatVariadic.h"
 
 #include "revng/GraphLayout/SugiyamaStyle/Compute.h"
@@ -24,6 +25,13 @@
 using ptml::PTMLBuilder;
 using ptml::Tag;
 
+static llvm::cl::opt<unsigned>
+  SimpleRankingThreshold("cfg-simple-ranking-threshold",
+                         llvm::cl::desc("Rank the nodes of the control flow "
+                                        "graphs larger than this with a "
+                                        "plain BFS, which is cheaper"),
+                         llvm::cl::init(5000));
+
 namespace tags {
 
 static constexpr auto UnconditionalEdge = "unconditional";
@@ -85,11 +93,12 @@ static std::string cubicBend(const yield::layout::Point &From,
                        -To.Y);
 }
 
-static std::string edge(const PTMLBuilder &B,
-                        const yield::layout::Path &Path,
-                        const std::string_view Type,
-                        bool UseOrthogonalBends = true,
-                        bool UseVerticalCurves = false) {
+static void edge(llvm::raw_ostream &OS,
+                 const PTMLBuilder &B,
+                 const yield::layout::Path &Path,
+                 const std::string_view Type,
+                 bool UseOrthogonalBends = true,
+                 bool UseVerticalCurves = false) {
   std::string Points;
 
   revng_assert(!Path.empty());
@@ -110,33 +119,39 @@ static std::string edge(const PTMLBuilder &B,
   Points.pop_back(); // Remove an extra space at the end.
 
   std::string Marker = llvm::formatv("url(#{0}-arrow-head)", Type);
-  return B.getTag("path")
-    .addAttribute("class", std::string(Type) += "-edge")
-    .addAttribute("d", std::move(Points))
-    .addAttribute("marker-end", std::move(Marker))
-    .addAttribute("fill", "none")
-    .toString();
+  OS << B.getTag("path")
+          .addAttribute("class", std::string(Type) += "-edge")
+          .addAttribute("d", std::move(Points))
+          .addAttribute("marker-end", std::move(Marker))
+          .addAttribute("fill", "none");
 }
 
 template<typename NodeData, typename EdgeData = Empty>
-std::string node(const PTMLBuilder &B,
-                 const yield::layout::OutputNode<NodeData, EdgeData> *Node,
-                 std::string &&Content,
-                 const yield::cfg::Configuration &Configuration) {
+void node(llvm::raw_ostream &OS,
+          const PTMLBuilder &B,
+          const yield::layout::OutputNode<NodeData, EdgeData> *Node,
+          llvm::StringRef Content,
+          const yield::cfg::Configuration &Configuration) {
   yield::layout::Size HalfSize{ Node->Size.W / 2, Node->Size.H / 2 };
   yield::layout::Point TopLeft{ Node->Center.X - HalfSize.W,
                                 -Node->Center.Y - HalfSize.H };
 
-  Tag Body = B.getTag("body", std::move(Content));
-  Body.addAttribute("xmlns", R"(http://www.w3.org/1999/xhtml)");
-
-  Tag Text = B.getTag("foreignObject", Body.toString());
+  Tag Text = B.getTag("foreignObject");
   Text.addAttribute("class", ::tags::NodeContents)
     .addAttribute("x", std::to_string(TopLeft.X))
     .addAttribute("y", std::to_string(TopLeft.Y))
     .addAttribute("width", std::to_string(Node->Size.W))
     .addAttribute("height", std::to_string(Node->Size.H));
 
+  Tag Body = B.getTag("body");
+  Body.addAttribute("xmlns", R"(http://www.w3.org/1999/xhtml)");
+
+  {
+    auto TextScope = Text.scope(OS);
+    auto BodyScope = Body.scope(OS);
+    OS << Content;
+  }
+
   Tag Border = B.getTag("rect");
   Border.addAttribute("class", ::tags::NodeBody)
     .addAttribute("x", std::to_string(TopLeft.X))
@@ -146,7 +161,7 @@ std::string node(const PTMLBuilder &B,
     .addAttribute("width", std::to_string(Node->Size.W))
     .addAttribute("height", std::to_string(Node->Size.H));
 
-  return Text.toString() + Border.toString();
+  OS << Border;
 }
 
 struct Viewbox {
@@ -292,27 +307,6 @@ static std::string exportGraph(const PTMLBuilder &B,
   if (Graph.size() == 0)
     return Result;
 
-  // Export all the edges.
-  for (const auto *From : Graph.nodes()) {
-    if (ShouldEmitEmptyNodes || !From->isEmpty()) {
-      for (const auto [To, Edge] : From->successor_edges()) {
-        if (ShouldEmitEmptyNodes || !To->isEmpty()) {
-          revng_assert(Edge != nullptr);
-          Result += edge(B,
-                         Edge->Path,
-                         edgeTypeAsString(*Edge),
-                         Configuration.UseOrthogonalBends,
-                         isVertical(Orientation));
-        }
-      }
-    }
-  }
-
-  // Export all the nodes.
-  for (const auto *Node : Graph.nodes())
-    if (ShouldEmitEmptyNodes || !Node->isEmpty())
-      Result += node(B, Node, NodeContents(*Node), Configuration);
-
   Viewbox Box = calculateViewbox(Graph);
   std::string SerializedBox = llvm::formatv("{0} {1} {2} {3}",
                                             Box.TopLeft.X,
@@ -320,13 +314,45 @@ static std::string exportGraph(const PTMLBuilder &B,
                                             Box.BottomRight.X - Box.TopLeft.X,
                                             Box.BottomRight.Y - Box.TopLeft.Y);
 
-  Tag ArrowHeads = B.getTag("defs", defaultArrowHeads(B, Configuration));
-  return B.getTag("svg", ArrowHeads.toString() + std::move(Result))
-    .addAttribute("xmlns", R"(http://www.w3.org/2000/svg)")
-    .addAttribute("viewbox", std::move(SerializedBox))
-    .addAttribute("width", std::to_string(Box.BottomRight.X - Box.TopLeft.X))
-    .addAttribute("height", std::to_string(Box.BottomRight.Y - Box.TopLeft.Y))
-    .toString();
+  // Emit everything directly into the result, as opposed to building each
+  // of the enclosing tags around a copy of its contents.
+  llvm::raw_string_ostream OS(Result);
+  {
+    Tag SVG = B.getTag("svg");
+    SVG.addAttribute("xmlns", R"(http://www.w3.org/2000/svg)")
+      .addAttribute("viewbox", std::move(SerializedBox))
+      .addAttribute("width", std::to_string(Box.BottomRight.X - Box.TopLeft.X))
+      .addAttribute("height",
+                    std::to_string(Box.BottomRight.Y - Box.TopLeft.Y));
+    auto SVGScope = SVG.scope(OS);
+
+    OS << B.getTag("defs", defaultArrowHeads(B, Configuration));
+
+    // Export all the edges.
+    for (const auto *From : Graph.nodes()) {
+      if (ShouldEmitEmptyNodes || !From->isEmpty()) {
+        for (const auto [To, Edge] : From->successor_edges()) {
+          if (ShouldEmitEmptyNodes || !To->isEmpty()) {
+            revng_assert(Edge != nullptr);
+            edge(OS,
+                 B,
+                 Edge->Path,
+                 edgeTypeAsString(*Edge),
+                 Configuration.UseOrthogonalBends,
+                 isVertical(Orientation));
+          }
+        }
+      }
+    }
+
+    // Export all the nodes.
+    for (const auto *Node : Graph.nodes())
+      if (ShouldEmitEmptyNodes || !Node->isEmpty())
+        node(OS, B, Node, NodeContents(*Node), Configuration);
+  }
+
+  OS.flush();
+  return Result;
 }
 
 namespace yield::layout::sugiyama {
@@ -366,35 +392,74 @@ compute(const InputGraph<Node, Edge> &Graph,
 
 } // namespace yield::layout::sugiyama
 
-std::string
-yield::svg::controlFlowGraph(const PTMLBuilder &B,
-                             const yield::Function &InternalFunction,
-                             const model::Binary &Binary) {
+yield::svg::ControlFlowGraphInputs
+yield::svg::prepareControlFlowGraph(const PTMLBuilder &B,
+                                    const yield::Function &InternalFunction,
+                                    const model::Binary &Binary) {
   constexpr auto Configuration = cfg::Configuration::getDefault();
 
-  using Pre = cfg::PreLayoutGraph;
-  Pre Graph = cfg::extractFromInternal(InternalFunction, Binary, Configuration);
+  ControlFlowGraphInputs Result;
+  Result.Graph = cfg::extractFromInternal(InternalFunction,
+                                          Binary,
+                                          Configuration);
+
+  cfg::calculateNodeSizes(Result.Graph,
+                          InternalFunction,
+                          Binary,
+                          Configuration);
+
+  for (const cfg::PreLayoutNode *Node : Result.Graph.nodes()) {
+    if (Node->isEmpty())
+      continue;
+
+    BasicBlockID BasicBlock = Node->getBasicBlock();
+    auto [It, New] = Result.Contents.try_emplace(BasicBlock);
+    if (New)
+      It->second = yield::ptml::controlFlowNode(B,
+                                                BasicBlock,
+                                                InternalFunction,
+                                                Binary);
+  }
 
-  cfg::calculateNodeSizes(Graph, InternalFunction, Binary, Configuration);
+  return Result;
+}
 
+std::string
+yield::svg::controlFlowGraph(const PTMLBuilder &B,
+                             const ControlFlowGraphInputs &Inputs) {
+  constexpr auto Configuration = cfg::Configuration::getDefault();
   constexpr auto TopToBottom = layout::sugiyama::Orientation::TopToBottom;
 
+  // Huge graphs are unreadable anyway, rank them in the cheapest way
+  using layout::sugiyama::RankingStrategy;
+  RankingStrategy Ranking = RankingStrategy::DisjointDepthFirstSearch;
+  if (Inputs.Graph.size() > SimpleRankingThreshold)
+    Ranking = RankingStrategy::BreadthFirstSearch;
+
   using Post = std::optional<cfg::PostLayoutGraph>;
-  Post Result = layout::sugiyama::compute(Graph, Configuration, TopToBottom);
+  Post Result = layout::sugiyama::compute(Inputs.Graph,
+                                          Configuration,
+                                          TopToBottom,
+                                          Ranking);
   revng_assert(Result.has_value());
 
   auto Content = [&](const yield::cfg::PostLayoutNode &Node) {
     if (!Node.isEmpty())
-      return yield::ptml::controlFlowNode(B,
-                                          Node.getBasicBlock(),
-                                          InternalFunction,
-                                          Binary);
+      return Inputs.Contents.at(Node.getBasicBlock());
     else
       return std::string{};
   };
   return exportGraph<true>(B, *Result, Configuration, TopToBottom, Content);
 }
 
+std::string
+yield::svg::controlFlowGraph(const PTMLBuilder &B,
+                             const yield::Function &InternalFunction,
+                             const model::Binary &Binary) {
+  return controlFlowGraph(B,
+                          prepareControlFlowGraph(B, InternalFunction, Binary));
+}
+
 struct LabelNodeHelper {
   const PTMLBuilder &B;
   const model::Binary &Binary;
@@ -581,8 +646,11 @@ std::string yield::svg::callGraphSlice(const PTMLBuilder &B,
 
   LabelNodeHelper Helper{ B, Binary, Configuration, SlicePoint };
 
+  // Both halves of the slice are extracted from the same graph
+  const calls::PreLayoutGraph CallGraph = Relations.toYieldGraph();
+
   // Ready the forwards facing part of the slice
-  auto Forward = calls::makeCalleeTree(Relations.toYieldGraph(), SlicePoint);
+  auto Forward = calls::makeCalleeTree(CallGraph, SlicePoint);
   for (auto *From : Forward.nodes())
     for (auto [To, Label] : From->successor_edges())
       Label->IsBackwards = false;
@@ -595,7 +663,7 @@ std::string yield::svg::callGraphSlice(const PTMLBuilder &B,
   revng_assert(LaidOutForwardsGraph.has_value());
 
   // Ready the backwards facing part of the slice
-  auto Backwards = calls::makeCallerTree(Relations.toYieldGraph(), SlicePoint);
+  auto Backwards = calls::makeCallerTree(CallGraph, SlicePoint);
   for (auto *From : Backwards.nodes())
     for (auto [To, Label] : From->successor_edges())
       Label->IsBackwards = true;
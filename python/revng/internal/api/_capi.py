@@ -4,9 +4,10 @@
 
 import faulthandler
 import re
+from contextlib import contextmanager
 from functools import wraps
 from pathlib import Path
-from threading import Lock
+from threading import Condition, Lock, local
 from typing import Any, Callable, Dict, Iterable, Optional
 
 from cffi import FFI
@@ -49,16 +50,103 @@ class AtomicCounterWithCallback:
                 self.callback()
 
 
+class ReadWriteLock:
+    """A lock that can be held by many readers or by a single writer. Writers
+    take precedence: once a writer is waiting no new reader is let in, so that
+    a steady stream of readers cannot starve it. A thread holding the lock for
+    reading can acquire it for reading again, but not for writing."""
+
+    def __init__(self):
+        self.condition = Condition(Lock())
+        self.readers = 0
+        self.writer = False
+        self.waiting_writers = 0
+        self.local = local()
+
+    def acquire_read(self):
+        depth = getattr(self.local, "depth", 0)
+        self.local.depth = depth + 1
+        if depth > 0:
+            return
+
+        with self.condition:
+            while self.writer or self.waiting_writers > 0:
+                self.condition.wait()
+            self.readers += 1
+
+    def release_read(self):
+        self.local.depth -= 1
+        if self.local.depth > 0:
+            return
+
+        with self.condition:
+            self.readers -= 1
+            if self.readers == 0:
+                self.condition.notify_all()
+
+    def acquire_write(self):
+        assert getattr(self.local, "depth", 0) == 0, "Cannot write while reading"
+        with self.condition:
+            self.waiting_writers += 1
+            while self.writer or self.readers > 0:
+                self.condition.wait()
+            self.waiting_writers -= 1
+            self.writer = True
+
+    def release_write(self):
+        with self.condition:
+            self.writer = False
+            self.condition.notify_all()
+
+    @contextmanager
+    def read(self):
+        self.acquire_read()
+        try:
+            yield
+        finally:
+            self.release_read()
+
+
 class ApiWrapper:
     function_matcher = re.compile(
         r"(?P<return_type>[\w_]+)\s*\*\s*\/\*\s*owning\s*\*\/\s*(?P<function_name>[\w_]+)",
         re.M | re.S,
     )
 
+    # Functions which are meant to be called while another thread is inside
+    # PipelineC, hence must not take the lock
+    lock_free_functions = frozenset({"rp_manager_request_cancellation", "rp_get_statistics"})
+
+    # Functions which only read the state of the manager and can run
+    # concurrently with each other, all the others get exclusive access.
+    # rp_container_extract_one is not here since extracting from LLVM
+    # containers makes use of the shared LLVMContext. rp_step_get_container is
+    # not here since it creates missing containers and loads pending ones.
+    read_only_functions = frozenset(
+        {
+            "rp_manager_get_step_from_name",
+            "rp_manager_get_kind_from_name",
+            "rp_manager_get_container_identifier_from_name",
+            "rp_manager_get_container_targets_list",
+            "rp_manager_get_pipeline_description",
+            "rp_manager_get_context_commit_index",
+            "rp_manager_get_memory_usage",
+            "rp_manager_create_global_copy",
+            "rp_container_get_mime",
+            "rp_targets_list_targets_count",
+            "rp_targets_list_get_target",
+            "rp_target_get_kind",
+            "rp_target_path_components_count",
+            "rp_target_get_path_component",
+            "rp_target_create_serialized_string",
+            "rp_target_is_ready",
+        }
+    )
+
     def __init__(self, api, ffi: FFI):
         self.__api = api
         self.__ffi = ffi
-        self.__lock = Lock()
+        self.__lock = ReadWriteLock()
         self.__counter = AtomicCounterWithCallback(self.__api.rp_shutdown)
         self.__proxy: Dict[str, Callable[..., Any]] = {}
 
@@ -73,18 +161,40 @@ class ApiWrapper:
             else:
                 raise ValueError(f"Could not find suitable destructor for {return_type}")
 
-            self.__proxy[function_name] = self.__wrap_lock(self.__wrap_gc(function, destructor))
+            # Objects owned by the caller can be destroyed concurrently, the
+            # manager itself cannot
+            destructor_read_only = return_type != "rp_manager"
+            if function_name in self.lock_free_functions:
+                # Neither the function nor the destructor of its result can
+                # wait for other functions to finish
+                self.__proxy[function_name] = self.__wrap_gc(function, destructor, None)
+                continue
+
+            self.__proxy[function_name] = self.__wrap_lock(
+                self.__wrap_gc(function, destructor, destructor_read_only),
+                function_name in self.read_only_functions,
+            )
 
         for attribute_name in dir(self.__api):
             if attribute_name.startswith("RP_") or attribute_name in self.__proxy:
                 continue
             function = getattr(self.__api, attribute_name)
-            self.__proxy[attribute_name] = self.__wrap_lock(function)
+            if attribute_name in self.lock_free_functions:
+                self.__proxy[attribute_name] = function
+            else:
+                self.__proxy[attribute_name] = self.__wrap_lock(
+                    function, attribute_name in self.read_only_functions
+                )
+
+    def __wrap_gc(self, function, destructor, destructor_read_only: Optional[bool]):
+        # If destructor_read_only is None the destructor does not take the lock
+        if destructor_read_only is None:
+            locked_destructor = destructor
+        else:
+            locked_destructor = self.__wrap_lock(destructor, destructor_read_only)
 
-    def __wrap_gc(self, function, destructor):
         def wrapped_destructor(ptr):
-            with self.__lock:
-                destructor(ptr)
+            locked_destructor(ptr)
             self.__counter.decrement()
 
         @wraps(function)
@@ -101,11 +211,24 @@ class ApiWrapper:
     def close(self):
         self.__counter.mark_end()
 
-    def __wrap_lock(self, function):
+    def read_transaction(self):
+        """Context manager keeping the state of the manager frozen across
+        several read-only calls, e.g. while walking a list of targets"""
+        return self.__lock.read()
+
+    def __wrap_lock(self, function, read_only: bool):
+        if read_only:
+            acquire, release = self.__lock.acquire_read, self.__lock.release_read
+        else:
+            acquire, release = self.__lock.acquire_write, self.__lock.release_write
+
         @wraps(function)
         def new_function(*args):
-            with self.__lock:
+            acquire()
+            try:
                 return function(*args)
+            finally:
+                release()
 
         return new_function
 
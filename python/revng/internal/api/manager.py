@@ -3,7 +3,7 @@
 #
 
 from tempfile import TemporaryDirectory
-from typing import Dict, Iterable, List, Mapping, Optional
+from typing import Dict, Iterable, List, Mapping, Optional, Tuple
 
 import yaml
 
@@ -122,7 +122,74 @@ class Manager:
         target: None | str | List[str],
         container_name: Optional[str] = None,
         only_if_ready=False,
-    ) -> Dict[str, str | bytes] | Error:
+    ) -> Dict[str, str | memoryview] | Error:
+        result = self.produce_targets_batch([(step_name, container_name, target)], only_if_ready)
+        if isinstance(result, Error):
+            return result
+        return next(iter(result.values()))
+
+    def produce_targets_batch(
+        self,
+        requests: List[Tuple[str, Optional[str], None | str | List[str]]],
+        only_if_ready=False,
+    ) -> Dict[Tuple[str, str], Dict[str, str | memoryview]] | Error:
+        """Produce several (step, container, targets) requests at once, so that
+        the pipeline is planned and run only once for all of them. A container
+        of None means the artifacts container of the step."""
+        steps = []
+        maps = []
+        requested_targets: List[Tuple[str, str, List[Target]]] = []
+        for step_name, container_name, target in requests:
+            container, targets = self._create_request_targets(step_name, target, container_name)
+            if only_if_ready and any(not t.is_ready for t in targets):
+                raise RevngException("Requested production of unready targets")
+
+            _step, _container = self._get_step_container_ptr(step_name, container)
+            target_map = ContainerToTargetsMap()
+            for t in targets:
+                target_map.add(_container, t)
+
+            steps.append(_step)
+            maps.append(target_map)
+            requested_targets.append((step_name, container, targets))
+
+        error = Error()
+        success = _api.rp_manager_produce_targets_batch(
+            self._manager,
+            len(steps),
+            steps,
+            [m._map for m in maps],
+            error._error,
+        )
+
+        if not success:
+            return error
+
+        result: Dict[Tuple[str, str], Dict[str, str | memoryview]] = {}
+        for step_name, container, targets in requested_targets:
+            result.setdefault((step_name, container), {}).update(self._extract_targets(targets))
+        return result
+
+    def request_cancellation(self):
+        """Ask the production in progress, if any, to stop as soon as possible,
+        can be called from any thread"""
+        _api.rp_manager_request_cancellation(self._manager)
+
+    def _extract_targets(self, targets: List[Target]) -> Dict[str, str | memoryview]:
+        result = {}
+        for produced_target in targets:
+            extracted_target = produced_target.extract()
+            if extracted_target is None:
+                raise RevngException(f"Target {produced_target.serialize()} extraction failed")
+            result[produced_target.serialize()] = extracted_target
+        return result
+
+    def _create_request_targets(
+        self,
+        step_name: str,
+        target: None | str | List[str],
+        container_name: Optional[str],
+    ) -> Tuple[str, List[Target]]:
         step = self.step_from_name(step_name)
         if step is None:
             raise RevngException(f"Invalid step {step_name}")
@@ -146,31 +213,7 @@ class Manager:
             targets.append(
                 self.create_target(step_name, container, _target_elem, container_name is None)
             )
-
-        if only_if_ready and any(not t.is_ready for t in targets):
-            raise RevngException("Requested production of unready targets")
-
-        _step, _container = self._get_step_container_ptr(step_name, container)
-        error = Error()
-        product = _api.rp_manager_produce_targets(
-            self._manager,
-            _step,
-            _container,
-            len(targets),
-            [t._target for t in targets],
-            error._error,
-        )
-
-        if product == ffi.NULL:
-            return error
-
-        result = {}
-        for produced_target in targets:
-            extracted_target = produced_target.extract()
-            if extracted_target is None:
-                raise RevngException(f"Target {produced_target.serialize()} extraction failed")
-            result[produced_target.serialize()] = extracted_target
-        return result
+        return container, targets
 
     def create_target(
         self, step_name: str, container_name: str, target_path: str, use_artifact_kind: bool
@@ -214,12 +257,14 @@ class Manager:
     def get_targets(self, step_name: str, container_name: str) -> List[Target]:
         _, container_ptr = self._get_step_container_ptr(step_name, container_name)
 
-        targets_list = _api.rp_manager_get_container_targets_list(self._manager, container_ptr)
+        # The list is owned by the manager, it must not be recomputed while walking it
+        with _api.read_transaction():
+            targets_list = _api.rp_manager_get_container_targets_list(self._manager, container_ptr)
 
-        if targets_list != ffi.NULL:
-            return list(TargetsList(targets_list, container_ptr))
-        else:
-            return []
+            if targets_list != ffi.NULL:
+                return list(TargetsList(targets_list, container_ptr))
+            else:
+                return []
 
     # Analysis handling
 
@@ -363,3 +408,9 @@ class Manager:
 
     def get_context_commit_index(self) -> int:
         return _api.rp_manager_get_context_commit_index(self._manager)
+
+    def get_statistics(self) -> str:
+        return make_python_string(_api.rp_get_statistics())
+
+    def get_memory_usage(self) -> str:
+        return make_python_string(_api.rp_manager_get_memory_usage(self._manager))
@@ -53,14 +53,12 @@ class Target:
         _serialized = _api.rp_target_create_serialized_string(self._target)
         return make_python_string(_serialized)
 
-    def extract(self) -> str | bytes | None:
+    def extract(self) -> str | memoryview | None:
         _buffer = _api.rp_container_extract_one(self._container, self._target)
         if _buffer == ffi.NULL:
             return None
-        size = _api.rp_buffer_size(_buffer)
-        data = _api.rp_buffer_data(_buffer)
         _mime = _api.rp_container_get_mime(self._container)
-        return convert_buffer(data, size, make_python_string(_mime))
+        return convert_buffer(_buffer, make_python_string(_mime))
 
     def as_dict(self):
         return {
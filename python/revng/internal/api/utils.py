@@ -4,7 +4,7 @@
 
 from pathlib import Path
 
-from ._capi import ffi
+from ._capi import _api, ffi
 
 
 def make_python_string(s: ffi.CData) -> str:
@@ -31,12 +31,20 @@ def save_file(path: Path, content: bytes | str):
             bytes_f.write(content)
 
 
-def convert_buffer(ptr: ffi.CData, size: int, mime: str) -> str | bytes:
-    if ptr == ffi.NULL:
-        return b""
+def convert_buffer(buffer: ffi.CData, mime: str) -> str | memoryview:
+    """Convert the content of an rp_buffer. Binary content is not copied: the
+    returned memoryview refers to the memory of the rp_buffer, which is kept
+    alive as long as the view is."""
+    size = _api.rp_buffer_size(buffer)
+    if size == 0:
+        data = memoryview(b"")
+    else:
+        # The destructor holds a reference to the rp_buffer, and the cffi
+        # buffer holds a reference to the pointer it is created from
+        pointer = ffi.gc(_api.rp_buffer_data(buffer), lambda _, owner=buffer: None)
+        data = memoryview(ffi.buffer(pointer, size))
 
-    data = ffi.unpack(ptr, size)
     if mime.startswith("text/") or mime == "image/svg":
-        return data.decode("utf-8")
+        return str(data, "utf-8")
     else:
         return data
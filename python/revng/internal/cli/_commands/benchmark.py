@@ -0,0 +1,183 @@
+#
+# This file is distributed under the MIT License. See LICENSE.md for details.
+#
+
+# This command runs the main steps of the pipeline on a binary, one process per
+# step, recording the wall time, the peak RSS and the cost of each pipe (through
+# --pipeline-trace). The results are emitted as JSON and can be compared
+# against a baseline produced by a previous run.
+
+import json
+import os
+import sys
+import time
+from collections import defaultdict
+from tempfile import TemporaryDirectory
+from typing import Dict, List, Tuple
+
+from revng.internal.cli.commands_registry import Command, CommandsRegistry, Options
+from revng.internal.cli.support import build_command_with_loads, interleave, log_error
+from revng.internal.cli.support import popen
+from revng.internal.support.collect import collect_pipelines
+
+# (name, tool, step or analysis), run in this order on the same resume directory
+STAGES: List[Tuple[str, str, str]] = [
+    ("import-binary", "analyze", "import-binary"),
+    ("lift", "artifact", "lift"),
+    ("detect-abi", "analyze", "detect-abi"),
+    ("collect-cfg", "artifact", "emit-cfg"),
+    ("isolate", "artifact", "isolate"),
+    ("yield-assembly", "artifact", "disassemble"),
+    ("yield-cfg", "artifact", "render-svg-cfg"),
+]
+
+# Metrics compared against the baseline
+METRICS = ("wall-time-s", "peak-rss-bytes")
+
+
+def pipe_costs(trace_path: str) -> Dict[str, Dict[str, int]]:
+    """Sum the duration and CPU time of each pipe in a Chrome trace"""
+    result: Dict[str, Dict[str, int]] = defaultdict(lambda: {"dur-us": 0, "cpu-time-us": 0})
+    if not os.path.exists(trace_path):
+        return {}
+
+    with open(trace_path, encoding="utf-8") as trace_file:
+        trace = json.load(trace_file)
+
+    for event in trace.get("traceEvents", []):
+        if event.get("cat") != "pipe":
+            continue
+        entry = result[event["name"]]
+        entry["dur-us"] += event.get("dur", 0)
+        entry["cpu-time-us"] += event.get("args", {}).get("cpu-time-us", 0)
+
+    return dict(result)
+
+
+def run_stage(
+    options: Options, tool: str, name: str, binary: str, resume: str, trace: str
+) -> Tuple[int, float, int]:
+    pipelines = collect_pipelines(options.search_prefixes)
+    arguments = [
+        *interleave(pipelines, "-P"),
+        "--resume",
+        resume,
+        f"--pipeline-trace={trace}",
+        name,
+        binary,
+        "-o",
+        os.devnull,
+        *options.remaining_args,
+    ]
+    command = build_command_with_loads(tool, arguments, options)
+
+    start = time.monotonic()
+    process = popen(command, options)
+    if isinstance(process, int):
+        return process, 0.0, 0
+
+    # Use wait4 to get the resource usage of this specific child
+    _, status, usage = os.wait4(process.pid, 0)
+    process.returncode = os.waitstatus_to_exitcode(status)
+    elapsed = time.monotonic() - start
+
+    # ru_maxrss is in kilobytes on Linux
+    return process.returncode, elapsed, usage.ru_maxrss * 1024
+
+
+def compare(results, baseline, tolerance: float) -> List[str]:
+    regressions = []
+    for stage, measured in results["stages"].items():
+        reference = baseline.get("stages", {}).get(stage)
+        if reference is None:
+            continue
+
+        for metric in METRICS:
+            if metric not in reference or reference[metric] == 0:
+                continue
+            ratio = measured[metric] / reference[metric]
+            if ratio > 1 + tolerance:
+                regressions.append(
+                    f"{stage}: {metric} went from {reference[metric]} to "
+                    + f"{measured[metric]} (+{(ratio - 1) * 100:.1f}%)"
+                )
+
+    return regressions
+
+
+class BenchmarkCommand(Command):
+    def __init__(self):
+        super().__init__(("benchmark",), "Measure the cost of the main pipeline steps")
+
+    def register_arguments(self, parser):
+        parser.add_argument("input", type=str, help="Input binary")
+        parser.add_argument(
+            "-o", "--output", type=str, default="-", help="Where to write the results as JSON"
+        )
+        parser.add_argument(
+            "--baseline", type=str, help="Compare the results against this JSON file"
+        )
+        parser.add_argument(
+            "--tolerance",
+            type=float,
+            default=0.1,
+            help="Relative increase over the baseline considered a regression (default: 0.1)",
+        )
+        parser.add_argument(
+            "--stages",
+            type=str,
+            default=",".join(name for name, _, _ in STAGES),
+            help="Comma-separated list of the stages to run, in the default order",
+        )
+
+    def run(self, options: Options):
+        args = options.parsed_args
+        selected = set(args.stages.split(","))
+        unknown = selected - {name for name, _, _ in STAGES}
+        if unknown:
+            log_error(f"Unknown stages: {', '.join(sorted(unknown))}")
+            return 1
+
+        results = {"binary": os.path.basename(args.input), "stages": {}}
+        with TemporaryDirectory(prefix="revng-benchmark-") as temporary:
+            resume = os.path.join(temporary, "resume")
+            for stage, tool, name in STAGES:
+                if stage not in selected:
+                    continue
+
+                trace = os.path.join(temporary, f"{stage}.json")
+                code, elapsed, peak_rss = run_stage(
+                    options, tool, name, args.input, resume, trace
+                )
+                if code != 0:
+                    log_error(f"Stage {stage} failed with exit code {code}")
+                    return code
+
+                results["stages"][stage] = {
+                    "wall-time-s": elapsed,
+                    "peak-rss-bytes": peak_rss,
+                    "pipes": pipe_costs(trace),
+                }
+
+        serialized = json.dumps(results, indent=2, sort_keys=True) + "\n"
+        if args.output == "-":
+            sys.stdout.write(serialized)
+        else:
+            with open(args.output, "w", encoding="utf-8") as output_file:
+                output_file.write(serialized)
+
+        if args.baseline is None:
+            return 0
+
+        with open(args.baseline, encoding="utf-8") as baseline_file:
+            baseline = json.load(baseline_file)
+
+        regressions = compare(results, baseline, args.tolerance)
+        for regression in regressions:
+            log_error(regression)
+
+        return 1 if regressions else 0
+
+
+def setup(commands_registry: CommandsRegistry):
+    commands_registry.register_command(BenchmarkCommand())
@@ -0,0 +1,56 @@
+#
+# This file is distributed under the MIT License. See LICENSE.md for details.
+#
+
+from collections import deque
+from dataclasses import dataclass
+from typing import Deque, Dict, List, Optional
+
+# Number of commits whose diffs are kept, clients lagging more than this have to download the
+# globals again
+MAX_RECORDED_COMMITS = 64
+
+
+@dataclass
+class Commit:
+    from_index: int
+    to_index: int
+    # Serialized diff of each global changed by the commit
+    diffs: Dict[str, str]
+
+
+class DiffHistory:
+    """Keeps the diffs of the globals produced by the last commits, so that a client holding the
+    version of a global at a given commit index can catch up by applying them, instead of
+    downloading the whole global again."""
+
+    def __init__(self, max_commits: int = MAX_RECORDED_COMMITS):
+        self.commits: Deque[Commit] = deque(maxlen=max_commits)
+
+    def record(self, from_index: int, to_index: int, diffs: Optional[Dict[str, str]]):
+        if from_index == to_index:
+            return
+        self.commits.append(Commit(from_index, to_index, diffs or {}))
+
+    def diffs_since(self, name: str, index: int, current_index: int) -> Optional[List[str]]:
+        """The diffs of global name to apply, in order, to go from commit index to the current
+        one, None if the history does not cover the whole range"""
+        if index == current_index:
+            return []
+
+        result: List[str] = []
+        expected_index = index
+        for commit in self.commits:
+            if commit.to_index <= expected_index:
+                continue
+            if commit.from_index != expected_index:
+                return None
+
+            diff = commit.diffs.get(name)
+            if diff is not None:
+                result.append(diff)
+            expected_index = commit.to_index
+
+        if expected_index != current_index:
+            return None
+        return result
@@ -10,19 +10,23 @@ from concurrent.futures import ThreadPoolExecutor
 from dataclasses import dataclass
 from functools import partial
 from pathlib import Path
-from typing import AsyncGenerator, Awaitable, Callable, Optional, ParamSpec, TypeVar
+from typing import AsyncGenerator, Awaitable, Callable, Dict, List, Optional, ParamSpec, TypeVar
 
 from starlette.datastructures import UploadFile
 
-from ariadne import MutationType, ObjectType, QueryType, ScalarType, SubscriptionType, UnionType
+from ariadne import EnumType, MutationType, ObjectType, QueryType, ScalarType, SubscriptionType
+from ariadne import UnionType
 from ariadne import make_executable_schema, upload_scalar
 
 from revng.internal.api.errors import DocumentError, Error, SimpleError
 from revng.internal.api.manager import Manager
 from revng.internal.api.target import Target
 
+from .diff_history import DiffHistory
 from .event_manager import EventType, emit_event
 from .multiqueue import MultiQueue
+from .prefetch import Prefetcher
+from .priority_executor import Priority, PriorityExecutor
 from .util import produce_serializer
 
 
@@ -32,8 +36,27 @@ class Invalidation:
     invalidations: str
 
 
-executor = ThreadPoolExecutor(1)
+@dataclass
+class Production:
+    commitIndex: int  # noqa: N815
+    step: str
+    container: Optional[str]
+    targets: List[str]
+
+
+# All the functions using the manager run on this thread, interactive requests first
+executor = PriorityExecutor()
+# Produces the artifacts of the neighbors of the functions the user looks at, when idle
+prefetcher = Prefetcher(executor)
+# Queries only reading the state of the manager can run concurrently with each other, the locking
+# in the API wrapper makes them wait for the functions that modify it
+read_only_executor = ThreadPoolExecutor(8)
 invalidation_queue: MultiQueue[Invalidation] = MultiQueue()
+# Tells clients which targets have just been produced, so they can mark them as ready without
+# querying the state of the whole container again
+production_queue: MultiQueue[Production] = MultiQueue()
+# Diffs of the globals of the last commits, see the getGlobalDiffs query
+diff_history = DiffHistory()
 
 T = TypeVar("T")
 P = ParamSpec("P")
@@ -50,11 +73,44 @@ def run_in_executor(function: Callable[P, T], *args: P.args, **kwargs: P.kwargs)
     return loop.run_in_executor(executor, partial(function, *args, **kwargs))
 
 
+def run_read_only_in_executor(
+    function: Callable[P, T], *args: P.args, **kwargs: P.kwargs
+) -> Awaitable[T]:
+    loop = asyncio.get_event_loop()
+    return loop.run_in_executor(read_only_executor, partial(function, *args, **kwargs))
+
+
+# Same as run_in_executor, but with the given priority and if the awaiting coroutine is cancelled
+# (e.g. because the client went away) the production is cancelled as well, so that it does not hold
+# the executor any further
+async def run_production_in_executor(
+    manager: Manager,
+    priority: Priority,
+    function: Callable[P, T],
+    *args: P.args,
+    **kwargs: P.kwargs,
+) -> T:
+    future = executor.submit_with_priority(priority, partial(function, *args, **kwargs))
+    try:
+        return await asyncio.wrap_future(future)
+    except asyncio.CancelledError:
+        # If it's still waiting in the queue, it's enough to drop it
+        if not future.cancel():
+            manager.request_cancellation()
+        raise
+
+
 @dataclass
 class Diff:
     diff: str
 
 
+@dataclass
+class GlobalDiffs:
+    commitIndex: int  # noqa: N815
+    diffs: List[str]
+
+
 @dataclass
 class Produced:
     result: str
@@ -65,11 +121,70 @@ class CommitIndexError:
     expectedIndex: int  # noqa: N815
 
 
+# Number of targets produced at once by the requests that are not interactive. Between one group
+# and the next, the interactive requests that came in the meantime run first.
+NON_INTERACTIVE_GROUP_SIZE = 16
+
+
+def produce_if_unchanged(
+    manager: Manager, index: int, *args, **kwargs
+) -> Dict[str, str | memoryview] | Error | CommitIndexError:
+    current_index = manager.get_context_commit_index()
+    if current_index != index:
+        return CommitIndexError(current_index)
+    return manager.produce_target(*args, **kwargs)
+
+
+async def produce_with_priority(
+    manager: Manager,
+    priority: Priority,
+    index: int,
+    step: str,
+    targets: Optional[List[str]],
+    container: Optional[str],
+    only_if_ready: bool,
+):
+    if priority == Priority.INTERACTIVE or targets is None:
+        groups = [targets]
+    else:
+        groups = [
+            targets[start : start + NON_INTERACTIVE_GROUP_SIZE]
+            for start in range(0, len(targets), NON_INTERACTIVE_GROUP_SIZE)
+        ]
+
+    # The index is checked again before each group, in case an interactive request changed the
+    # context in between
+    result: Dict[str, str | memoryview] = {}
+    for group in groups:
+        partial_result = await run_production_in_executor(
+            manager,
+            priority,
+            produce_if_unchanged,
+            manager,
+            index,
+            step,
+            group,
+            container,
+            only_if_ready,
+        )
+        if isinstance(partial_result, CommitIndexError):
+            return partial_result
+        if isinstance(partial_result, Error):
+            return partial_result.unwrap()
+        result.update(partial_result)
+
+    if len(result) > 0:
+        await production_queue.send(Production(index, step, container, list(result.keys())))
+
+    return Produced(produce_serializer(result))
+
+
 query = QueryType()
 mutation = MutationType()
 subscription = SubscriptionType()
 
 analysis_result_type = UnionType("AnalysisResult")
+global_diffs_result_type = UnionType("GlobalDiffsResult")
 produce_result_type = UnionType("ProduceResult")
 
 simple_error_type = ObjectType("SimpleError")
@@ -81,6 +196,8 @@ document_error_type.set_alias("locationType", "location_type")
 
 bigint_scalar = ScalarType("BigInt", serializer=str, value_parser=int)
 
+priority_enum = EnumType("Priority", Priority)
+
 
 @query.field("produce")
 async def resolve_produce(
@@ -92,22 +209,15 @@ async def resolve_produce(
     targetList: str,  # noqa: N803
     onlyIfReady=False,  # noqa: N803
     index: int,
+    priority: Priority = Priority.INTERACTIVE,
 ):
     manager: Manager = info.context["manager"]
     index_lock: asyncio.Lock = info.context["index_lock"]
     async with index_lock:
-        current_index = await run_in_executor(manager.get_context_commit_index)
-        if current_index != index:
-            return CommitIndexError(current_index)
-
         targets = targetList.split(",")
-        result = await run_in_executor(
-            manager.produce_target, step, targets, container, onlyIfReady
+        return await produce_with_priority(
+            manager, priority, index, step, targets, container, onlyIfReady
         )
-        if isinstance(result, Error):
-            return result.unwrap()
-        else:
-            return Produced(produce_serializer(result))
 
 
 @query.field("produceArtifacts")
@@ -119,54 +229,83 @@ async def resolve_produce_artifacts(
     paths: Optional[str] = None,
     onlyIfReady=False,  # noqa: N803
     index: int,
+    priority: Priority = Priority.INTERACTIVE,
 ):
     manager: Manager = info.context["manager"]
     index_lock: asyncio.Lock = info.context["index_lock"]
     async with index_lock:
-        current_index = await run_in_executor(manager.get_context_commit_index)
-        if current_index != index:
-            return CommitIndexError(current_index)
-
         targets = paths.split(",") if paths is not None else None
-        result = await run_in_executor(
-            manager.produce_target, step, targets, only_if_ready=onlyIfReady
+        # The user navigated somewhere else, what we were prefetching is no longer relevant
+        if priority == Priority.INTERACTIVE:
+            prefetcher.cancel()
+
+        result = await produce_with_priority(
+            manager, priority, index, step, targets, None, onlyIfReady
         )
-        if isinstance(result, Error):
-            return result.unwrap()
-        else:
-            return Produced(produce_serializer(result))
+
+        produced = isinstance(result, Produced)
+        if priority == Priority.INTERACTIVE and targets is not None and produced:
+            prefetcher.schedule(manager, index, step, targets)
+
+        return result
 
 
 @query.field("targets")
 async def resolve_targets(_, info, *, step: str, container: str):
     manager: Manager = info.context["manager"]
-    targets = await run_in_executor(manager.get_targets, step, container)
-    return await run_in_executor(lambda: [t.as_dict() for t in targets])
+    targets = await run_read_only_in_executor(manager.get_targets, step, container)
+    return await run_read_only_in_executor(lambda: [t.as_dict() for t in targets])
 
 
 @query.field("target")
 async def resolve_target(_, info, *, step: str, container: str, target: str) -> Optional[Target]:
     manager: Manager = info.context["manager"]
-    result = await run_in_executor(manager.deserialize_target, f"{step}/{container}/{target}")
+    result = await run_read_only_in_executor(
+        manager.deserialize_target, f"{step}/{container}/{target}"
+    )
     return result.as_dict() if result is not None else None
 
 
 @query.field("getGlobal")
 async def resolve_get_global(_, info, *, name: str) -> str:
     manager: Manager = info.context["manager"]
-    return await run_in_executor(manager.get_global, name)
+    return await run_read_only_in_executor(manager.get_global, name)
+
+
+@query.field("getGlobalDiffs")
+async def resolve_get_global_diffs(_, info, *, name: str, index: int):
+    manager: Manager = info.context["manager"]
+    index_lock: asyncio.Lock = info.context["index_lock"]
+    async with index_lock:
+        current_index = await run_in_executor(manager.get_context_commit_index)
+        diffs = diff_history.diffs_since(name, index, current_index)
+        if diffs is None:
+            return CommitIndexError(current_index)
+        return GlobalDiffs(current_index, diffs)
 
 
 @query.field("pipelineDescription")
 async def resolve_pipeline_description(_, info) -> str:
     manager: Manager = info.context["manager"]
-    return await run_in_executor(manager.get_pipeline_description)
+    return await run_read_only_in_executor(manager.get_pipeline_description)
 
 
 @query.field("contextCommitIndex")
 async def resolve_context_commit_index(_, info) -> int:
     manager: Manager = info.context["manager"]
-    return await run_in_executor(manager.get_context_commit_index)
+    return await run_read_only_in_executor(manager.get_context_commit_index)
+
+
+@query.field("statistics")
+async def resolve_statistics(_, info) -> str:
+    manager: Manager = info.context["manager"]
+    return await run_read_only_in_executor(manager.get_statistics)
+
+
+@query.field("memoryUsage")
+async def resolve_memory_usage(_, info) -> str:
+    manager: Manager = info.context["manager"]
+    return await run_read_only_in_executor(manager.get_memory_usage)
 
 
 @mutation.field("uploadB64")
@@ -175,8 +314,10 @@ async def resolve_upload_b64(_, info, *, input: str, container: str):  # noqa: A
     manager: Manager = info.context["manager"]
     index_lock: asyncio.Lock = info.context["index_lock"]
     async with index_lock:
+        old_index = await run_in_executor(manager.get_context_commit_index)
         invalidations = await run_in_executor(manager.set_input, container, b64decode(input))
         index = await run_in_executor(manager.get_context_commit_index)
+        diff_history.record(old_index, index, None)
         await invalidation_queue.send(Invalidation(index, str(invalidations)))
         logging.info(f"Saved file for container {container}")
         return True
@@ -189,8 +330,10 @@ async def resolve_upload_file(_, info, *, file: UploadFile, container: str):
     index_lock: asyncio.Lock = info.context["index_lock"]
     async with index_lock:
         contents = await file.read()
+        old_index = await run_in_executor(manager.get_context_commit_index)
         invalidations = await run_in_executor(manager.set_input, container, contents)
         index = await run_in_executor(manager.get_context_commit_index)
+        diff_history.record(old_index, index, None)
         await invalidation_queue.send(Invalidation(index, str(invalidations)))
         logging.info(f"Saved file for container {container}")
         return True
@@ -224,6 +367,7 @@ async def resolve_run_analysis(
         if result:
             real_result = result.unwrap()
             new_index = await run_in_executor(manager.get_context_commit_index)
+            diff_history.record(current_index, new_index, real_result.result)
             await invalidation_queue.send(Invalidation(new_index, str(real_result.invalidations)))
             return Diff(json.dumps(real_result.result))
         else:
@@ -246,6 +390,7 @@ async def resolve_run_analyses_list(_, info, *, name: str, options: str | None =
         if result:
             real_result = result.unwrap()
             new_index = await run_in_executor(manager.get_context_commit_index)
+            diff_history.record(current_index, new_index, real_result.result)
             await invalidation_queue.send(Invalidation(new_index, str(real_result.invalidations)))
             return Diff(json.dumps(real_result.result))
         else:
@@ -266,6 +411,16 @@ def resolve_analysis_result(obj, *_):
         raise ValueError("Unknown Analysis result")
 
 
+@global_diffs_result_type.type_resolver
+def resolve_global_diffs_result(obj, *_):
+    if isinstance(obj, CommitIndexError):
+        return "IndexError"
+    elif isinstance(obj, GlobalDiffs):
+        return "GlobalDiffs"
+    else:
+        raise ValueError("Unknown GlobalDiffs result")
+
+
 @produce_result_type.type_resolver
 def resolve_produce_result(obj, *_):
     if isinstance(obj, SimpleError):
@@ -292,6 +447,18 @@ async def invalidations(message: Invalidation, info):
     return message
 
 
+@subscription.source("productions")
+async def productions_generator(_, info) -> AsyncGenerator[Production, None]:
+    with production_queue.stream() as stream:
+        async for message in stream:
+            yield message
+
+
+@subscription.field("productions")
+async def productions(message: Production, info):
+    return message
+
+
 def get_schema():
     schema_file = (Path(__file__).parent.resolve()) / "schema.graphql"
     return make_executable_schema(
@@ -301,7 +468,9 @@ def get_schema():
         subscription,
         upload_scalar,
         bigint_scalar,
+        priority_enum,
         analysis_result_type,
+        global_diffs_result_type,
         produce_result_type,
         simple_error_type,
         document_error_type,
@@ -0,0 +1,131 @@
+#
+# This file is distributed under the MIT License. See LICENSE.md for details.
+#
+
+import logging
+import threading
+from collections import defaultdict
+from concurrent.futures import Future
+from typing import Dict, List, Optional, Set
+
+import yaml
+
+from revng.internal.api.errors import Error
+from revng.internal.api.manager import Manager
+
+from .priority_executor import Priority, PriorityExecutor
+
+try:
+    from yaml import CSafeLoader as SafeLoader
+except ImportError:
+    from yaml import SafeLoader  # type: ignore
+
+# Where the call graph of the binary lives, see the `process-call-graph` pipe
+CROSS_RELATIONS_STEP = "isolate"
+CROSS_RELATIONS_CONTAINER = "cross-relations.yml"
+CROSS_RELATIONS_TARGET = ":binary-cross-relations"
+
+# Maximum number of neighbors prefetched after each request
+MAX_PREFETCHED_NEIGHBORS = 16
+
+
+def parse_call_graph(text: str) -> Dict[str, Set[str]]:
+    """Map each function to its callers and callees, as function target paths (i.e.,
+    the entry address), from the serialized CrossRelations"""
+    neighbors: Dict[str, Set[str]] = defaultdict(set)
+    relations = yaml.load(text, Loader=SafeLoader) or {}
+    for relation in relations.get("Relations", []):
+        callee = relation["Location"].split("/")
+        if len(callee) < 3 or callee[1] != "function":
+            continue
+
+        for call_site in relation.get("IsCalledFrom", []):
+            # Call sites are basic blocks: /basic-block/<caller>/<block>
+            caller = call_site.split("/")
+            if len(caller) < 3 or caller[2] == callee[2]:
+                continue
+            neighbors[callee[2]].add(caller[2])
+            neighbors[caller[2]].add(callee[2])
+
+    return neighbors
+
+
+class Prefetcher:
+    """Produces, at PREFETCH priority, the artifacts of the callers and callees of the functions
+    whose artifacts have been requested, since that's where the user usually navigates next.
+
+    A new request cancels the prefetches which did not start yet. All the interactions with the
+    manager happen on the executor thread."""
+
+    def __init__(self, executor: PriorityExecutor):
+        self.executor = executor
+        # Guards pending, which is accessed both from the event loop and the executor
+        self.lock = threading.Lock()
+        self.pending: List[Future] = []
+        # Call graph, valid for the context commit index it has been computed at
+        self.call_graph: Optional[Dict[str, Set[str]]] = None
+        self.call_graph_index: Optional[int] = None
+
+    def cancel(self):
+        with self.lock:
+            for future in self.pending:
+                future.cancel()
+            self.pending = []
+
+    def schedule(self, manager: Manager, index: int, step: str, paths: List[str]):
+        self.cancel()
+        self._submit(self._prefetch_neighbors, manager, index, step, paths)
+
+    def _submit(self, function, *args):
+        with self.lock:
+            self.pending = [future for future in self.pending if not future.done()]
+            future = self.executor.submit_with_priority(Priority.PREFETCH, function, *args)
+            self.pending.append(future)
+
+    def _get_call_graph(self, manager: Manager, index: int) -> Optional[Dict[str, Set[str]]]:
+        if self.call_graph_index == index:
+            return self.call_graph
+
+        result = manager.produce_target(
+            CROSS_RELATIONS_STEP, CROSS_RELATIONS_TARGET, CROSS_RELATIONS_CONTAINER
+        )
+        if isinstance(result, Error):
+            return None
+
+        text = next(iter(result.values()))
+        if not isinstance(text, str):
+            text = bytes(text).decode("utf-8")
+
+        self.call_graph = parse_call_graph(text)
+        self.call_graph_index = index
+        return self.call_graph
+
+    def _prefetch_neighbors(self, manager: Manager, index: int, step: str, paths: List[str]):
+        # The prefetch is stale, the user will ask for artifacts of a different context
+        if manager.get_context_commit_index() != index:
+            return
+
+        try:
+            call_graph = self._get_call_graph(manager, index)
+        except Exception:  # noqa: B902
+            logging.debug("Cannot compute the call graph, prefetching is disabled", exc_info=True)
+            return
+
+        if call_graph is None:
+            return
+
+        requested = set(paths)
+        neighbors = sorted({n for path in paths for n in call_graph.get(path, ())} - requested)
+        for neighbor in neighbors[:MAX_PREFETCHED_NEIGHBORS]:
+            self._submit(self._prefetch_one, manager, index, step, neighbor)
+
+    @staticmethod
+    def _prefetch_one(manager: Manager, index: int, step: str, path: str):
+        if manager.get_context_commit_index() != index:
+            return
+
+        # Failures are not interesting, the user will get them when asking for the artifact
+        try:
+            manager.produce_target(step, path)
+        except Exception:  # noqa: B902
+            logging.debug(f"Prefetching {step}/{path} failed", exc_info=True)
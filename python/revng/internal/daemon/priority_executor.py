@@ -0,0 +1,62 @@
+#
+# This file is distributed under the MIT License. See LICENSE.md for details.
+#
+
+import heapq
+import itertools
+import threading
+from concurrent.futures import Executor, Future
+from enum import IntEnum
+from typing import Callable, List, Tuple
+
+
+class Priority(IntEnum):
+    """Priority classes of the requests, the lower the value the sooner they run"""
+
+    # Requests the user is waiting for, e.g. the artifact of the function the UI just opened
+    INTERACTIVE = 0
+    # Speculative requests, e.g. the artifacts of the functions near to the one being viewed
+    PREFETCH = 1
+    # Bulk requests, e.g. all the CFGs of the binary
+    BATCH = 2
+
+
+class PriorityExecutor(Executor):
+    """Executor running the submitted functions on a single thread, the ones with the highest
+    priority first and, for the same priority, in order of submission.
+
+    Functions submitted through the plain `submit` are INTERACTIVE."""
+
+    def __init__(self):
+        self._condition = threading.Condition()
+        self._queue: List[Tuple[Priority, int, Future, Callable]] = []
+        self._counter = itertools.count()
+        self._thread = threading.Thread(target=self._work, daemon=True)
+        self._thread.start()
+
+    def submit(self, fn, /, *args, **kwargs) -> Future:
+        return self.submit_with_priority(Priority.INTERACTIVE, fn, *args, **kwargs)
+
+    def submit_with_priority(self, priority: Priority, fn, /, *args, **kwargs) -> Future:
+        future: Future = Future()
+        with self._condition:
+            entry = (priority, next(self._counter), future, lambda: fn(*args, **kwargs))
+            heapq.heappush(self._queue, entry)
+            self._condition.notify()
+        return future
+
+    def _work(self):
+        while True:
+            with self._condition:
+                while len(self._queue) == 0:
+                    self._condition.wait()
+                _, _, future, function = heapq.heappop(self._queue)
+
+            # Skip the functions that have been cancelled while waiting
+            if not future.set_running_or_notify_cancel():
+                continue
+
+            try:
+                future.set_result(function())
+            except BaseException as exception:  # noqa: B036
+                future.set_exception(exception)
@@ -264,6 +264,9 @@ private:
   /** endif -**/
 public:
   bool localCompare(const /*= struct | user_fullname =*/ &Other) const;
+  /// \returns a hash of the fields considered by localCompare: objects for
+  ///          which localCompare holds have the same localHash
+  uint64_t localHash() const;
   void dump(llvm::raw_ostream &Stream) const;
   void dump(std::ostream &Stream) const {
     llvm::raw_os_ostream LLVMStreamAdapter(Stream);
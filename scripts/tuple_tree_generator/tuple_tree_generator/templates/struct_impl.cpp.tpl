@@ -12,6 +12,7 @@ The notice below applies to the generated files.
 #include "revng/TupleTree/VisitsImpl.h"
 #include "revng/TupleTree/TupleTreeImpl.h"
 #include "revng/TupleTree/TrackingImpl.h"
+#include "revng/TupleTree/StructuralHash.h"
 
 /**- for child_type in upcastable **/
 #include "/*= user_include_path =*//*= child_type.name =*/.h"
@@ -141,6 +142,59 @@ bool /*= struct | fullname =*/::localCompare(const /*= struct | user_fullname =*
   /**- endif -**/
 }
 
+uint64_t /*= struct | fullname =*/::localHash() const {
+  /**- if struct.abstract **/
+
+  auto *This = static_cast<const /*= struct | user_fullname =*/ *>(this);
+  return upcast(This, [](const auto &Upcasted) -> uint64_t {
+    return Upcasted.localHash();
+  }, uint64_t(0));
+
+  /**- else -**/
+
+  using namespace revng::detail;
+  uint64_t Result = mixHash(/*= struct.all_fields | length =*/);
+
+  /** for field in struct.all_fields if not field.is_guid and field.__class__.__name__ != "ReferenceStructField" **/
+
+  /**- if field.__class__.__name__ == "SimpleStructField" **/
+
+  /**- if schema.get_definition_for(field.type).__class__.__name__ == "StructDefinition" -**/
+  /**- if field.upcastable -**/
+  if (this->/*= field.name =*/().isEmpty())
+    Result = combineHash(Result, mixHash(0));
+  else
+    Result = combineHash(Result, this->/*= field.name =*/()->localHash());
+  /**- else -**/
+  Result = combineHash(Result, this->/*= field.name =*/().localHash());
+  /**- endif -**/
+  /**- else -**/
+  Result = combineHash(Result, structuralHash(this->/*= field.name =*/()));
+  /**- endif -**/
+
+  /**- elif field.__class__.__name__ == "SequenceStructField" -**/
+
+  /**- if schema.get_definition_for(field.element_type).__class__.__name__ == "StructDefinition" -**/
+  Result = combineHash(Result, mixHash(this->/*= field.name =*/().size()));
+  for (const auto &Element : this->/*= field.name =*/()) {
+    /** if field.upcastable **/
+    Result = combineHash(Result, Element->localHash());
+    /** else **/
+    Result = combineHash(Result, Element.localHash());
+    /** endif **/
+  }
+  /**- else -**/
+  Result = combineHash(Result, structuralHash(this->/*= field.name =*/()));
+  /**- endif -**/
+
+  /** else **//*= ERROR("unexpected field type") =*//** endif **/
+
+  /** endfor **/
+
+  return Result;
+  /**- endif -**/
+}
+
 void /*= struct | fullname =*/::dump(llvm::raw_ostream &Stream) const {
   auto *This = static_cast<const /*= struct | user_fullname =*/ *>(this);
 
@@ -217,6 +271,9 @@ void revng::Tracking::pop(const /*= base_namespace =*/::/*= struct.name =*/ &LHS
 template
 void revng::Tracking::stop(const /*= base_namespace =*/::/*= struct.name =*/ &LHS);
 
+template
+bool revng::Tracking::isActive(const /*= base_namespace =*/::/*= struct.name =*/ &LHS);
+
 /** endif **/
 
 /**- for field in struct.fields **/
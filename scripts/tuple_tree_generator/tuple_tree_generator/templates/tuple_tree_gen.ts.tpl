@@ -6,7 +6,7 @@
 import * as yaml from "yaml";
 import { deepEqual } from "fast-equals";
 import { yamlParseOptions, yamlOutParseOptions, yamlToStringOptions } from "./tuple_tree";
-import { _getElementByPath, _setElementByPath, _getTypeInfo, _makeDiff, _validateDiff, _applyDiff, BigIntBuilder, DiffSet, TypeInfo, TypeHints, IReference, Reference } from "./tuple_tree";
+import { _getElementByPath, _setElementByPath, _getTypeInfo, _makeDiff, _validateDiff, _applyDiff, _applyDiffs, BigIntBuilder, DiffSet, TypeInfo, TypeHints, IReference, Reference } from "./tuple_tree";
 export { DiffSet, IReference, Reference };
 
 /** for file_name in external_files **/
@@ -234,6 +234,10 @@ export function applyDiff(obj: /*= global_name =*/, diffs: DiffSet): [false] | [
   return _applyDiff(obj, diffs, validateDiff, getTypeInfo, clone);
 }
 
+export function applyDiffs(obj: /*= global_name =*/, diffs: DiffSet[]): [false] | [true, /*= global_name =*/] {
+  return _applyDiffs(obj, diffs, validateDiff, getTypeInfo, clone);
+}
+
 export function getElementByPath<T>(path: string, tree: /*= global_name =*/): T | undefined {
   return _getElementByPath(path, tree);
 }
@@ -0,0 +1,356 @@
+/// \file ADT.cpp
+/// Microbenchmarks for the containers and algorithms in revng/ADT.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/ConstantRange.h"
+
+#include "revng/ADT/ConstantRangeSet.h"
+#include "revng/ADT/GenericGraph.h"
+#include "revng/ADT/LazySmallBitVector.h"
+#include "revng/ADT/RecursiveCoroutine.h"
+#include "revng/ADT/SmallMap.h"
+#include "revng/ADT/SortedVector.h"
+#include "revng/ADT/ZipMapIterator.h"
+
+#include "Benchmark.h"
+
+using namespace benchmark;
+
+/// Generate \p Count distinct keys, in random order, using a fixed seed
+static std::vector<uint64_t> randomKeys(uint64_t Count) {
+  std::vector<uint64_t> Result(Count);
+  for (uint64_t I = 0; I < Count; ++I)
+    Result[I] = 0x1000 + I * 0x10;
+
+  std::mt19937_64 Generator(42);
+  std::shuffle(Result.begin(), Result.end(), Generator);
+  return Result;
+}
+
+static SortedVector<uint64_t> sortedVectorOf(const std::vector<uint64_t> &K) {
+  SortedVector<uint64_t> Result;
+  {
+    auto Inserter = Result.batch_insert();
+    for (uint64_t Key : K)
+      Inserter.insert(Key);
+  }
+  return Result;
+}
+
+//
+// SortedVector
+//
+
+REVNG_BENCHMARK("SortedVector/insert", 100000, [](BenchmarkState &State) {
+  std::vector<uint64_t> Keys = randomKeys(State.size());
+  State.measure([&] {
+    SortedVector<uint64_t> Set;
+    for (uint64_t Key : Keys)
+      Set.insert(Key);
+    doNotOptimize(Set.size());
+  });
+});
+
+REVNG_BENCHMARK("SortedVector/batch-insert", 1000000, [](BenchmarkState &S) {
+  std::vector<uint64_t> Keys = randomKeys(S.size());
+  S.measure([&] { doNotOptimize(sortedVectorOf(Keys).size()); });
+});
+
+REVNG_BENCHMARK("SortedVector/find", 1000000, [](BenchmarkState &State) {
+  std::vector<uint64_t> Keys = randomKeys(State.size());
+  SortedVector<uint64_t> Set = sortedVectorOf(Keys);
+  State.measure([&] {
+    uint64_t Found = 0;
+    for (uint64_t Key : Keys)
+      Found += Set.count(Key);
+    revng_check(Found == Keys.size());
+  });
+});
+
+REVNG_BENCHMARK("SortedVector/iterate", 1000000, [](BenchmarkState &State) {
+  SortedVector<uint64_t> Set = sortedVectorOf(randomKeys(State.size()));
+  State.measure([&] {
+    uint64_t Sum = 0;
+    for (uint64_t Key : Set)
+      Sum += Key;
+    doNotOptimize(Sum);
+  });
+});
+
+//
+// SmallMap
+//
+
+template<unsigned N>
+static void smallMapInsertAndFind(BenchmarkState &State) {
+  std::vector<uint64_t> Keys = randomKeys(N);
+  State.setItems(State.size() * N);
+  State.measure([&] {
+    uint64_t Found = 0;
+    for (uint64_t I = 0; I < State.size(); ++I) {
+      SmallMap<uint64_t, uint64_t, N> Map;
+      for (uint64_t Key : Keys)
+        Map[Key] = I;
+      for (uint64_t Key : Keys)
+        Found += Map.count(Key);
+    }
+    revng_check(Found == State.size() * N);
+  });
+}
+
+REVNG_BENCHMARK("SmallMap/insert-find-small", 100000, smallMapInsertAndFind<4>);
+REVNG_BENCHMARK("SmallMap/insert-find-full", 100000, smallMapInsertAndFind<16>);
+
+REVNG_BENCHMARK("SmallMap/insert-find-large", 10, [](BenchmarkState &State) {
+  std::vector<uint64_t> Keys = randomKeys(100000);
+  State.setItems(State.size() * Keys.size());
+  State.measure([&] {
+    for (uint64_t I = 0; I < State.size(); ++I) {
+      SmallMap<uint64_t, uint64_t, 16> Map;
+      for (uint64_t Key : Keys)
+        Map[Key] = I;
+      uint64_t Found = 0;
+      for (uint64_t Key : Keys)
+        Found += Map.count(Key);
+      revng_check(Found == Keys.size());
+    }
+  });
+});
+
+//
+// ConstantRangeSet
+//
+
+/// Build a set made of \p Count disjoint ranges, starting from \p Offset
+static ConstantRangeSet disjointRanges(uint64_t Count,
+                                       uint64_t Offset,
+                                       unsigned BitWidth) {
+  ConstantRangeSet Result(BitWidth, false);
+  for (uint64_t I = 0; I < Count; ++I) {
+    llvm::APInt Lower(BitWidth, Offset + I * 16);
+    llvm::APInt Upper(BitWidth, Offset + I * 16 + 8);
+    Result = Result.unionWith(llvm::ConstantRange(Lower, Upper));
+  }
+  return Result;
+}
+
+template<unsigned BitWidth>
+static void constantRangeSetAlgebra(BenchmarkState &State) {
+  ConstantRangeSet Left = disjointRanges(State.size(), 0, BitWidth);
+  ConstantRangeSet Right = disjointRanges(State.size(), 4, BitWidth);
+  State.measure([&] {
+    ConstantRangeSet Union = Left.unionWith(Right);
+    ConstantRangeSet Intersection = Left.intersectWith(Right);
+    revng_check(Union.contains(Intersection));
+    doNotOptimize(Union);
+    doNotOptimize(Intersection);
+  });
+}
+
+REVNG_BENCHMARK("ConstantRangeSet/algebra-64",
+                100000,
+                constantRangeSetAlgebra<64>);
+REVNG_BENCHMARK("ConstantRangeSet/algebra-128",
+                100000,
+                constantRangeSetAlgebra<128>);
+
+REVNG_BENCHMARK("ConstantRangeSet/build", 2000, [](BenchmarkState &State) {
+  State.measure([&] {
+    ConstantRangeSet Result = disjointRanges(State.size(), 0, 64);
+    doNotOptimize(Result);
+  });
+});
+
+//
+// LazySmallBitVector
+//
+
+REVNG_BENCHMARK("LazySmallBitVector/set-test", 1000000, [](BenchmarkState &S) {
+  std::vector<uint64_t> Indices = randomKeys(S.size());
+  for (uint64_t &Index : Indices)
+    Index = (Index / 0x10) % 4096;
+
+  S.measure([&] {
+    LazySmallBitVector Bits;
+    for (uint64_t Index : Indices)
+      Bits.set(Index);
+    uint64_t Set = 0;
+    for (uint64_t Index : Indices)
+      Set += Bits[Index];
+    revng_check(Set == Indices.size());
+  });
+});
+
+REVNG_BENCHMARK("LazySmallBitVector/union", 100000, [](BenchmarkState &State) {
+  LazySmallBitVector Left;
+  LazySmallBitVector Right;
+  for (unsigned I = 0; I < 1024; I += 3)
+    Left.set(I);
+  for (unsigned I = 0; I < 1024; I += 5)
+    Right.set(I);
+
+  State.measure([&] {
+    for (uint64_t I = 0; I < State.size(); ++I) {
+      LazySmallBitVector Result = Left;
+      Result |= Right;
+      doNotOptimize(Result.requiredBits());
+    }
+  });
+});
+
+REVNG_BENCHMARK("LazySmallBitVector/iterate", 10000, [](BenchmarkState &S) {
+  LazySmallBitVector Bits;
+  for (unsigned I = 0; I < 4096; I += 7)
+    Bits.set(I);
+
+  S.measure([&] {
+    uint64_t Sum = 0;
+    for (uint64_t I = 0; I < S.size(); ++I)
+      for (unsigned Index : Bits)
+        Sum += Index;
+    doNotOptimize(Sum);
+  });
+});
+
+//
+// GenericGraph
+//
+
+struct BlockData {
+  BlockData(uint64_t Index) : Index(Index) {}
+  uint64_t Index;
+};
+
+using BlockNode = BidirectionalNode<BlockData>;
+using BlockGraph = GenericGraph<BlockNode>;
+
+/// Build a CFG-like graph: a chain of blocks with a few forward branches and
+/// some backedges
+static void populateGraph(BlockGraph &Graph, uint64_t Size) {
+  std::vector<BlockNode *> Nodes;
+  Nodes.reserve(Size);
+  for (uint64_t I = 0; I < Size; ++I)
+    Nodes.push_back(Graph.addNode(I));
+  Graph.setEntryNode(Nodes.front());
+
+  std::mt19937_64 Generator(42);
+  for (uint64_t I = 0; I + 1 < Size; ++I) {
+    Nodes[I]->addSuccessor(Nodes[I + 1]);
+    uint64_t Target = Generator() % Size;
+    if (Generator() % 4 == 0)
+      Nodes[I]->addSuccessor(Nodes[Target]);
+  }
+}
+
+REVNG_BENCHMARK("GenericGraph/build", 1000000, [](BenchmarkState &State) {
+  State.measure([&] {
+    BlockGraph Graph;
+    populateGraph(Graph, State.size());
+    doNotOptimize(Graph.size());
+  });
+});
+
+REVNG_BENCHMARK("GenericGraph/depth-first", 1000000, [](BenchmarkState &S) {
+  BlockGraph Graph;
+  populateGraph(Graph, S.size());
+  S.measure([&] {
+    uint64_t Visited = 0;
+    for (BlockNode *Node : llvm::depth_first(Graph.getEntryNode()))
+      Visited += Node->Index != 0;
+    doNotOptimize(Visited);
+  });
+});
+
+REVNG_BENCHMARK("GenericGraph/post-order", 1000000, [](BenchmarkState &S) {
+  BlockGraph Graph;
+  populateGraph(Graph, S.size());
+  S.measure([&] {
+    uint64_t Visited = 0;
+    for (BlockNode *Node : llvm::post_order(Graph.getEntryNode()))
+      Visited += Node->Index != 0;
+    doNotOptimize(Visited);
+  });
+});
+
+//
+// ZipMapIterator
+//
+
+template<typename T>
+static uint64_t countCommonKeys(T &Left, T &Right) {
+  uint64_t Result = 0;
+  for (auto [LeftIt, RightIt] : zipmap_range(Left, Right))
+    Result += LeftIt != nullptr and RightIt != nullptr;
+  return Result;
+}
+
+static void zipStdMaps(BenchmarkState &State) {
+  std::vector<uint64_t> Keys = randomKeys(State.size());
+  std::map<uint64_t, uint64_t> Left;
+  std::map<uint64_t, uint64_t> Right;
+  for (uint64_t I = 0; I < Keys.size(); ++I) {
+    if (I % 3 != 0)
+      Left[Keys[I]] = I;
+    if (I % 3 != 1)
+      Right[Keys[I]] = I;
+  }
+
+  State.measure([&] { doNotOptimize(countCommonKeys(Left, Right)); });
+}
+
+static void zipSortedVectors(BenchmarkState &State) {
+  std::vector<uint64_t> Keys = randomKeys(State.size());
+  std::vector<uint64_t> LeftKeys;
+  std::vector<uint64_t> RightKeys;
+  for (uint64_t I = 0; I < Keys.size(); ++I) {
+    if (I % 3 != 0)
+      LeftKeys.push_back(Keys[I]);
+    if (I % 3 != 1)
+      RightKeys.push_back(Keys[I]);
+  }
+  SortedVector<uint64_t> Left = sortedVectorOf(LeftKeys);
+  SortedVector<uint64_t> Right = sortedVectorOf(RightKeys);
+
+  State.measure([&] { doNotOptimize(countCommonKeys(Left, Right)); });
+}
+
+REVNG_BENCHMARK("ZipMapIterator/std-map", 1000000, zipStdMaps);
+REVNG_BENCHMARK("ZipMapIterator/sorted-vector", 1000000, zipSortedVectors);
+
+//
+// RecursiveCoroutine
+//
+
+static RecursiveCoroutine<uint64_t> sumDown(uint64_t Depth) {
+  if (Depth == 0)
+    rc_return 0;
+  rc_return Depth + rc_recur sumDown(Depth - 1);
+}
+
+REVNG_BENCHMARK("RecursiveCoroutine/deep", 10000, [](BenchmarkState &State) {
+  State.measure([&] {
+    uint64_t Result = sumDown(State.size());
+    revng_check(Result == State.size() * (State.size() + 1) / 2);
+  });
+});
+
+REVNG_BENCHMARK("RecursiveCoroutine/shallow", 100000, [](BenchmarkState &S) {
+  S.setItems(S.size() * 16);
+  S.measure([&] {
+    uint64_t Sum = 0;
+    for (uint64_t I = 0; I < S.size(); ++I)
+      Sum += sumDown(16);
+    doNotOptimize(Sum);
+  });
+});
@@ -0,0 +1,83 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "revng/Support/Assert.h"
+
+/// A minimal microbenchmarking harness
+///
+/// Each benchmark is a function registered through REVNG_BENCHMARK, along with
+/// its nominal problem size. The function is in charge of the setup and must
+/// wrap the code to measure in BenchmarkState::measure, so that the setup is
+/// not accounted for. Each benchmark is run several times and the fastest and
+/// the median run are reported.
+namespace benchmark {
+
+class BenchmarkState {
+private:
+  uint64_t Size = 0;
+  uint64_t Items = 0;
+  std::chrono::nanoseconds Elapsed{ 0 };
+
+public:
+  explicit BenchmarkState(uint64_t Size) : Size(Size), Items(Size) {}
+
+public:
+  /// The problem size, already scaled according to -benchmark-scale
+  uint64_t size() const { return Size; }
+
+  /// Set how many items are processed by a run, by default size()
+  void setItems(uint64_t NewItems) { Items = NewItems; }
+  uint64_t items() const { return Items; }
+
+  std::chrono::nanoseconds elapsed() const { return Elapsed; }
+
+  /// Measure the time taken by \p Body, can be invoked multiple times
+  template<typename F>
+  void measure(F &&Body) {
+    auto Start = std::chrono::steady_clock::now();
+    Body();
+    Elapsed += std::chrono::steady_clock::now() - Start;
+  }
+};
+
+/// Prevent the compiler from optimizing away the computation of \p Value
+template<typename T>
+inline void doNotOptimize(const T &Value) {
+  asm volatile("" : : "r,m"(Value) : "memory");
+}
+
+using BenchmarkFunction = std::function<void(BenchmarkState &)>;
+
+struct BenchmarkDescriptor {
+  std::string Name;
+  uint64_t Size;
+  BenchmarkFunction Function;
+};
+
+std::vector<BenchmarkDescriptor> &registry();
+
+struct Registration {
+  Registration(const char *Name, uint64_t Size, BenchmarkFunction Function) {
+    registry().push_back({ Name, Size, std::move(Function) });
+  }
+};
+
+} // namespace benchmark
+
+#define REVNG_BENCHMARK_CONCAT_IMPL(A, B) A##B
+#define REVNG_BENCHMARK_CONCAT(A, B) REVNG_BENCHMARK_CONCAT_IMPL(A, B)
+
+/// Register \p Function as a benchmark named \p Name with size \p Size
+#define REVNG_BENCHMARK(Name, Size, Function)               \
+  static benchmark::Registration REVNG_BENCHMARK_CONCAT(    \
+    BenchmarkRegistration,                                  \
+    __LINE__)(Name, Size, Function)
@@ -0,0 +1,112 @@
+/// \file Main.cpp
+/// Driver for the microbenchmarks of the core data structures.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/InitRevng.h"
+
+#include "Benchmark.h"
+
+using namespace llvm;
+
+static cl::OptionCategory BenchmarkCategory("Benchmark options");
+
+static cl::opt<std::string> Filter("benchmark-filter",
+                                   cl::desc("Only run the benchmarks whose "
+                                            "name matches this regex"),
+                                   cl::cat(BenchmarkCategory),
+                                   cl::init(".*"));
+
+static cl::opt<double> Scale("benchmark-scale",
+                             cl::desc("Multiply the size of each benchmark by "
+                                      "this factor"),
+                             cl::cat(BenchmarkCategory),
+                             cl::init(1.0));
+
+static cl::opt<unsigned> Repetitions("benchmark-repetitions",
+                                     cl::desc("How many times each benchmark "
+                                              "is run"),
+                                     cl::cat(BenchmarkCategory),
+                                     cl::init(5));
+
+static cl::opt<std::string> OutputPath("benchmark-output",
+                                       cl::desc("Write the results as JSON to "
+                                                "this file"),
+                                       cl::cat(BenchmarkCategory),
+                                       cl::init(""));
+
+std::vector<benchmark::BenchmarkDescriptor> &benchmark::registry() {
+  static std::vector<BenchmarkDescriptor> Registry;
+  return Registry;
+}
+
+int main(int Argc, char *Argv[]) {
+  using namespace benchmark;
+  using std::chrono::nanoseconds;
+
+  revng::InitRevng X(Argc, Argv, "", { &BenchmarkCategory });
+
+  revng_check(Repetitions > 0);
+  Regex Matcher(Filter);
+  std::string Error;
+  revng_check(Matcher.isValid(Error), Error.c_str());
+
+  std::string JSON;
+  raw_string_ostream JSONStream(JSON);
+  JSONStream << "{\n  \"benchmarks\": [";
+
+  bool First = true;
+  for (const BenchmarkDescriptor &Descriptor : registry()) {
+    if (not Matcher.match(Descriptor.Name))
+      continue;
+
+    auto Size = std::max<uint64_t>(1, Descriptor.Size * Scale);
+    std::vector<nanoseconds> Runs;
+    uint64_t Items = Size;
+    for (unsigned I = 0; I < Repetitions; ++I) {
+      BenchmarkState State(Size);
+      Descriptor.Function(State);
+      Runs.push_back(State.elapsed());
+      Items = State.items();
+    }
+
+    llvm::sort(Runs);
+    double Min = Runs.front().count();
+    double Median = Runs[Runs.size() / 2].count();
+    double PerItem = Median / std::max<uint64_t>(1, Items);
+
+    outs() << format("%-48s %10llu %12.3f ms %12.3f ms %10.2f ns/item\n",
+                     Descriptor.Name.c_str(),
+                     static_cast<unsigned long long>(Size),
+                     Min / 1e6,
+                     Median / 1e6,
+                     PerItem);
+
+    JSONStream << (First ? "\n" : ",\n") << "    { \"name\": \""
+               << Descriptor.Name << "\", \"size\": " << Size
+               << ", \"items\": " << Items << ", \"min-ns\": " << Min
+               << ", \"median-ns\": " << Median << " }";
+    First = false;
+  }
+
+  JSONStream << "\n  ]\n}\n";
+
+  if (not OutputPath.empty()) {
+    std::error_code EC;
+    raw_fd_ostream Output(OutputPath, EC, sys::fs::OF_Text);
+    revng_check(not EC, "Cannot open the output file");
+    Output << JSONStream.str();
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+/// \file TupleTree.cpp
+/// Microbenchmarks for the serialization, diffing and hashing of TupleTrees,
+/// using the model as a realistic instance.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Model/Binary.h"
+#include "revng/Support/MetaAddress.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/StructuralHash.h"
+#include "revng/TupleTree/TupleTree.h"
+#include "revng/TupleTree/TupleTreeDiff.h"
+
+#include "Benchmark.h"
+
+using namespace benchmark;
+
+/// Build a model with \p Count functions, each with a name, a comment and an
+/// exported name, and ten extra code addresses per function
+static TupleTree<model::Binary> createModel(uint64_t Count) {
+  TupleTree<model::Binary> Model;
+  Model->Architecture() = model::Architecture::x86_64;
+
+  {
+    auto Inserter = Model->Functions().batch_insert();
+    for (uint64_t I = 0; I < Count; ++I) {
+      MetaAddress Entry(0x400000 + I * 0x100, MetaAddressType::Code_x86_64);
+      model::Function Function(Entry);
+      Function.CustomName() = "function_" + std::to_string(I);
+      Function.Comment() = "A comment for function " + std::to_string(I);
+      Function.ExportedNames().insert("exported_" + std::to_string(I));
+      Inserter.insert(std::move(Function));
+    }
+  }
+
+  {
+    auto Inserter = Model->ExtraCodeAddresses().batch_insert();
+    for (uint64_t I = 0; I < Count * 10; ++I)
+      Inserter.insert(MetaAddress(0x400000 + I * 0x10,
+                                  MetaAddressType::Code_x86_64));
+  }
+
+  Model.initializeReferences();
+  return Model;
+}
+
+/// Rename one function every \p Stride
+static void renameSome(TupleTree<model::Binary> &Model, uint64_t Stride) {
+  uint64_t I = 0;
+  for (model::Function &Function : Model->Functions())
+    if (I++ % Stride == 0)
+      Function.CustomName() = Function.CustomName().str().str() + "_renamed";
+}
+
+static std::string serializeModel(const TupleTree<model::Binary> &Model) {
+  std::string Result;
+  Model.serialize(Result);
+  return Result;
+}
+
+REVNG_BENCHMARK("TupleTree/build", 100000, [](BenchmarkState &State) {
+  State.measure([&] {
+    TupleTree<model::Binary> Model = createModel(State.size());
+    doNotOptimize(Model->Functions().size());
+  });
+});
+
+REVNG_BENCHMARK("TupleTree/yaml-serialize", 100000, [](BenchmarkState &S) {
+  TupleTree<model::Binary> Model = createModel(S.size());
+  S.measure([&] { doNotOptimize(serializeModel(Model).size()); });
+});
+
+REVNG_BENCHMARK("TupleTree/yaml-parse", 100000, [](BenchmarkState &State) {
+  std::string YAML = serializeModel(createModel(State.size()));
+  State.measure([&] {
+    auto MaybeModel = TupleTree<model::Binary>::fromString(YAML);
+    revng_check(MaybeModel);
+    revng_check((*MaybeModel)->Functions().size() == State.size());
+  });
+});
+
+REVNG_BENCHMARK("TupleTree/binary-round-trip", 100000, [](BenchmarkState &S) {
+  TupleTree<model::Binary> Model = createModel(S.size());
+  S.measure([&] {
+    std::string Buffer;
+    llvm::raw_string_ostream Stream(Buffer);
+    Model.serializeBinary(Stream);
+    Stream.flush();
+
+    auto MaybeModel = TupleTree<model::Binary>::fromString(Buffer);
+    revng_check(MaybeModel);
+    revng_check((*MaybeModel)->Functions().size() == S.size());
+  });
+});
+
+REVNG_BENCHMARK("TupleTree/diff-sparse", 100000, [](BenchmarkState &State) {
+  TupleTree<model::Binary> Left = createModel(State.size());
+  TupleTree<model::Binary> Right = createModel(State.size());
+  renameSome(Right, 100);
+  State.measure([&] {
+    auto Diff = diff(*Left, *Right);
+    revng_check(not Diff.Changes.empty());
+  });
+});
+
+REVNG_BENCHMARK("TupleTree/diff-apply", 100000, [](BenchmarkState &State) {
+  TupleTree<model::Binary> Left = createModel(State.size());
+  TupleTree<model::Binary> Right = createModel(State.size());
+  renameSome(Right, 10);
+  auto Diff = diff(*Left, *Right);
+  State.measure([&] { llvm::cantFail(Diff.apply(Left)); });
+});
+
+REVNG_BENCHMARK("TupleTree/structural-hash", 100000, [](BenchmarkState &S) {
+  TupleTree<model::Binary> Model = createModel(S.size());
+  S.measure([&] { doNotOptimize(structuralHash(*Model)); });
+});
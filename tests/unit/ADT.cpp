@@ -11,6 +11,8 @@ bool init_unit_test();
 #include "revng/ADT/CompilationTime.h"
 #include "revng/ADT/Concepts.h"
 #include "revng/ADT/ConstexprString.h"
+#include "revng/ADT/DenseWorklist.h"
+#include "revng/ADT/Queue.h"
 #include "revng/ADT/STLExtras.h"
 
 //
@@ -83,6 +85,83 @@ static_assert(StringParametrizedTrait<"value">::value == "value");
 BOOST_AUTO_TEST_CASE(ReachingDefinitionsTest) {
 }
 
+//
+// DenseWorklist.h
+//
+
+BOOST_AUTO_TEST_CASE(DenseWorklistTest) {
+  DenseWorklist Worklist;
+  BOOST_TEST(Worklist.insert(3));
+  BOOST_TEST(Worklist.insert(0));
+  BOOST_TEST(not Worklist.insert(3));
+  BOOST_TEST(Worklist.size() == 2U);
+
+  BOOST_TEST(Worklist.pop() == 3U);
+  BOOST_TEST(Worklist.insert(3));
+  BOOST_TEST(Worklist.pop() == 0U);
+  BOOST_TEST(Worklist.pop() == 3U);
+  BOOST_TEST(Worklist.empty());
+
+  // Wrap around the ring buffer and then grow it
+  for (unsigned Round = 0; Round < 3; ++Round)
+    for (unsigned I = 0; I < 4; ++I)
+      Worklist.insert(I);
+  Worklist.pop();
+  Worklist.pop();
+  Worklist.insert(0);
+  for (unsigned I = 4; I < 100; ++I)
+    Worklist.insert(I);
+
+  std::vector<unsigned> Order;
+  while (not Worklist.empty())
+    Order.push_back(Worklist.pop());
+
+  std::vector<unsigned> Expected = { 2, 3, 0 };
+  for (unsigned I = 4; I < 100; ++I)
+    Expected.push_back(I);
+  BOOST_TEST(Order == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(DenseOnceWorklistTest) {
+  DenseOnceWorklist Worklist(2);
+  BOOST_TEST(Worklist.insert(1));
+  BOOST_TEST(Worklist.pop() == 1U);
+  BOOST_TEST(not Worklist.insert(1));
+  BOOST_TEST(Worklist.contains(1));
+  BOOST_TEST(not Worklist.contains(0));
+  BOOST_TEST(Worklist.empty());
+}
+
+BOOST_AUTO_TEST_CASE(DenseStackTest) {
+  DenseWorklistImpl<false, true> Stack;
+  for (unsigned I = 0; I < 5; ++I)
+    Stack.insert(I);
+
+  BOOST_TEST(Stack.pop() == 4U);
+  Stack.reverse();
+  BOOST_TEST(Stack.pop() == 0U);
+  BOOST_TEST(Stack.pop() == 1U);
+  BOOST_TEST(Stack.size() == 2U);
+}
+
+BOOST_AUTO_TEST_CASE(QueueTest) {
+  int Nodes[3] = { 0, 0, 0 };
+
+  OnceQueue<int *> Queue;
+  Queue.insert(&Nodes[2]);
+  Queue.insert(&Nodes[0]);
+  Queue.insert(&Nodes[2]);
+  BOOST_TEST(Queue.size() == 2U);
+  BOOST_TEST(Queue.head() == &Nodes[2]);
+
+  Queue.insert(&Nodes[1]);
+  while (not Queue.empty())
+    Queue.insert(Queue.pop());
+
+  std::set<int *> Visited = Queue.visited();
+  BOOST_TEST(Visited.size() == 3U);
+}
+
 //
 // STLExtras.h
 //
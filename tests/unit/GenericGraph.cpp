@@ -16,6 +16,7 @@ bool init_unit_test();
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "revng/ADT/CompactGraph.h"
 #include "revng/ADT/FilteredGraphTraits.h"
 #include "revng/ADT/GenericGraph.h"
 #include "revng/ADT/SerializableGraph.h"
@@ -370,6 +371,48 @@ BOOST_AUTO_TEST_CASE(TestSCC) {
   revng_check(SCCCount == 4);
 }
 
+BOOST_AUTO_TEST_CASE(TestCompactGraph) {
+  auto DG = createGraph<BidirectionalTestNode>();
+  using Node = typename decltype(DG)::Node;
+  auto Compact = CompactGraph<Node *>::fromGraph(&DG.Graph);
+
+  revng_check(Compact.size() == DG.Graph.size());
+  revng_check(Compact.getEntryNode()->original() == DG.Root);
+
+  // Successors are preserved in order
+  auto *Root = Compact.at(DG.Root);
+  revng_check(Root->successorCount() == 2);
+  revng_check(Root->successors()[0]->original() == DG.Then);
+  revng_check(Root->successors()[1]->original() == DG.Else);
+  revng_check(not Root->hasPredecessors());
+
+  auto *Final = Compact.at(DG.Final);
+  revng_check(Final->predecessorCount() == 2);
+  revng_check(not Final->hasSuccessors());
+
+  // Visits match the ones on the original graph
+  std::vector<Node *> Visited;
+  for (auto *CompactNode : depth_first(&Compact))
+    Visited.push_back(CompactNode->original());
+
+  std::vector<Node *> Expected;
+  for (Node *OriginalNode : depth_first(&DG.Graph))
+    Expected.push_back(OriginalNode);
+  revng_check(Visited == Expected);
+
+  Visited.clear();
+  for (auto *CompactNode : inverse_depth_first(Final))
+    Visited.push_back(CompactNode->original());
+  revng_check(Visited.size() == 4);
+
+  unsigned SCCCount = 0;
+  for (auto &SCC : make_range(scc_begin(&Compact), scc_end(&Compact))) {
+    revng_check(SCC.size() == 1);
+    ++SCCCount;
+  }
+  revng_check(SCCCount == 4);
+}
+
 BOOST_AUTO_TEST_CASE(TestFilterGraphTraits) {
   auto DG = createGraph<BidirectionalTestNode>();
 
@@ -507,6 +550,38 @@ BOOST_AUTO_TEST_CASE(BasicMutableEdgeNodeTest) {
   revng_check(B->predecessorCount() == 1);
 }
 
+BOOST_AUTO_TEST_CASE(RemoveMutableEdgeNodesTest) {
+  using Graph = GenericGraph<MutableEdgeNode<SomeNode, SomeEdge>>;
+
+  Graph G;
+  auto *A = G.addNode("A");
+  auto *B = G.addNode("B");
+  auto *C = G.addNode("C");
+  auto *D = G.addNode("D");
+
+  A->addSuccessor(B);
+  B->addSuccessor(C);
+  C->addSuccessor(B);
+  C->addSuccessor(C);
+  C->addSuccessor(D);
+  D->addSuccessor(A);
+
+  // Remove two nodes connected to each other, and to the remaining ones
+  std::vector<Graph::Node *> ToRemove = { C, B };
+  revng_check(G.removeNodes(ToRemove) == 2);
+  revng_check(G.size() == 2);
+  revng_check(*G.nodes().begin() == A);
+  revng_check(*std::next(G.nodes().begin()) == D);
+  revng_check(A->successorCount() == 0 && A->predecessorCount() == 1);
+  revng_check(D->successorCount() == 1 && D->predecessorCount() == 0);
+  llvm::cantFail(G.verify());
+
+  auto IsD = [D](const Graph::Node *Node) { return Node == D; };
+  revng_check(G.removeNodesIf(IsD) == 1);
+  revng_check(G.removeNodesIf(IsD) == 0);
+  revng_check(G.size() == 1 && A->predecessorCount() == 0);
+}
+
 using TestMutableEdgeNode = MutableEdgeNode<TestNodeData, TestEdgeLabel>;
 
 BOOST_AUTO_TEST_CASE(MutableEdgeNodeFilterGraphTraitsTest) {
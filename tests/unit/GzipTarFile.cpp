@@ -68,3 +68,184 @@ BOOST_AUTO_TEST_CASE(GzipTarFileTest) {
   checkOffset(Buffer, Offset1.DataStart, Offset1.dataSize(), "foo2");
   checkOffset(Buffer, Offset2.DataStart, Offset2.dataSize(), "bar2");
 }
+
+BOOST_AUTO_TEST_CASE(GzipTarFileAppendCompressedTest) {
+  using revng::ArchiveEntry;
+  using revng::OffsetDescriptor;
+
+  llvm::SmallVector<char> Compressed;
+  llvm::raw_svector_ostream CompressedOS(Compressed);
+  const char Data[5] = "foo2";
+  gzipCompress(CompressedOS, llvm::ArrayRef<char>{ Data, 4 });
+
+  llvm::SmallVector<char> Buffer;
+  llvm::raw_svector_ostream OS(Buffer);
+
+  revng::GzipTarWriter Writer(OS);
+  OffsetDescriptor Offset = Writer.appendCompressed("foo",
+                                                    { Compressed.data(),
+                                                      Compressed.size() },
+                                                    4);
+  Writer.close();
+
+  {
+    revng::GzipTarReader Reader({ Buffer.data(), Buffer.size() });
+
+    cppcoro::generator<ArchiveEntry> Gen = Reader.entries();
+    std::vector<ArchiveEntry> Entries(Gen.begin(), Gen.end());
+    BOOST_TEST(Entries.size() == 1ULL);
+
+    llvm::StringRef RefData(Entries[0].Data.data(), Entries[0].Data.size());
+    BOOST_TEST(Entries[0].Filename == "foo");
+    BOOST_TEST(RefData.str() == "foo2");
+  }
+
+  BOOST_TEST(Offset.dataSize() == Compressed.size());
+  checkOffset(Buffer, Offset.DataStart, Offset.dataSize(), "foo2");
+}
+
+BOOST_AUTO_TEST_CASE(GzipTarIndexTest) {
+  using revng::ArchiveEntry;
+  using revng::IndexedArchiveEntry;
+  using revng::OffsetDescriptor;
+
+  llvm::SmallVector<char> Buffer;
+  llvm::raw_svector_ostream OS(Buffer);
+
+  revng::GzipTarWriter Writer(OS);
+
+  const char Data1[5] = "foo2";
+  OffsetDescriptor Offset1 = Writer.append("foo", { Data1, 4 });
+
+  // A file whose size is a multiple of the block size, hence without padding
+  std::string Data2(512, 'b');
+  OffsetDescriptor Offset2 = Writer.append("bar", { Data2.data(), 512 });
+
+  OffsetDescriptor Offset3 = Writer.append("empty", {});
+
+  Writer.close();
+
+  auto MaybeIndex = revng::GzipTarIndex::create({ Buffer.data(),
+                                                  Buffer.size() });
+  BOOST_REQUIRE(static_cast<bool>(MaybeIndex));
+
+  llvm::ArrayRef<IndexedArchiveEntry> Entries = MaybeIndex->entries();
+  BOOST_TEST(Entries.size() == 3ULL);
+
+  auto CheckEntry = [&](const IndexedArchiveEntry &Entry,
+                        llvm::StringRef Name,
+                        const OffsetDescriptor &Expected,
+                        llvm::StringRef ExpectedData) {
+    BOOST_TEST(Entry.Filename == Name.str());
+    BOOST_TEST(Entry.Size == ExpectedData.size());
+    BOOST_TEST(Entry.Offsets.Start == Expected.Start);
+    BOOST_TEST(Entry.Offsets.DataStart == Expected.DataStart);
+    BOOST_TEST(Entry.Offsets.PaddingStart == Expected.PaddingStart);
+    BOOST_TEST(Entry.Offsets.End == Expected.End);
+
+    llvm::SmallVector<char, 0> Data = MaybeIndex->read(Entry);
+    std::string Decompressed(Data.data(), Data.size());
+    BOOST_TEST(Decompressed == ExpectedData.str());
+  };
+  CheckEntry(Entries[0], "foo", Offset1, "foo2");
+  CheckEntry(Entries[1], "bar", Offset2, Data2);
+  CheckEntry(Entries[2], "empty", Offset3, "");
+
+  std::vector<ArchiveEntry> All = MaybeIndex->readAll();
+  BOOST_TEST(All.size() == 3ULL);
+  BOOST_TEST(All[0].Filename == "foo");
+  BOOST_TEST(std::string(All[0].Data.data(), All[0].Data.size()) == "foo2");
+  BOOST_TEST(All[1].Filename == "bar");
+  BOOST_TEST(All[1].Data.size() == 512ULL);
+  BOOST_TEST(All[2].Filename == "empty");
+  BOOST_TEST(All[2].Data.empty());
+
+  // Something that is not an archive is rejected
+  const char Garbage[] = "not an archive";
+  auto MaybeGarbage = revng::GzipTarIndex::create({ Garbage, sizeof(Garbage) });
+  BOOST_TEST(not static_cast<bool>(MaybeGarbage));
+  llvm::consumeError(MaybeGarbage.takeError());
+}
+
+BOOST_AUTO_TEST_CASE(GzipTarWriterCompressTest) {
+  const char Data[5] = "foo2";
+
+  llvm::SmallVector<char> Appended;
+  {
+    llvm::raw_svector_ostream OS(Appended);
+    revng::GzipTarWriter Writer(OS);
+    Writer.append("foo", { Data, 4 });
+    Writer.close();
+  }
+
+  llvm::SmallVector<char> CompressedFirst;
+  {
+    using revng::GzipTarWriter;
+    auto Compressed = GzipTarWriter::compress({ Data, 4 });
+    llvm::raw_svector_ostream OS(CompressedFirst);
+    revng::GzipTarWriter Writer(OS);
+    Writer.appendCompressed("foo",
+                            { Compressed.data(), Compressed.size() },
+                            4);
+    Writer.close();
+  }
+
+  std::string AppendedString(Appended.data(), Appended.size());
+  std::string CompressedFirstString(CompressedFirst.data(),
+                                    CompressedFirst.size());
+  BOOST_TEST(AppendedString == CompressedFirstString);
+}
+
+BOOST_AUTO_TEST_CASE(GzipTarWriterPrepareTest) {
+  using revng::OffsetDescriptor;
+
+  const char Data[5] = "foo2";
+  std::string Large(1000, 'a');
+
+  llvm::SmallVector<char> Appended;
+  std::vector<OffsetDescriptor> AppendedOffsets;
+  {
+    llvm::raw_svector_ostream OS(Appended);
+    revng::GzipTarWriter Writer(OS);
+    AppendedOffsets.push_back(Writer.append("foo", { Data, 4 }));
+    AppendedOffsets.push_back(Writer.append("large",
+                                            { Large.data(), Large.size() }));
+    AppendedOffsets.push_back(Writer.append("empty", {}));
+    Writer.close();
+  }
+
+  llvm::SmallVector<char> Prepared;
+  std::vector<OffsetDescriptor> PreparedOffsets;
+  {
+    using revng::GzipTarWriter;
+    auto Foo = GzipTarWriter::prepare("foo", { Data, 4 });
+    auto LargeMember = GzipTarWriter::prepare("large",
+                                              { Large.data(), Large.size() });
+    auto Empty = GzipTarWriter::prepare("empty", {});
+
+    llvm::raw_svector_ostream OS(Prepared);
+    revng::GzipTarWriter Writer(OS);
+    PreparedOffsets.push_back(Writer.appendPrepared("foo", Foo));
+    PreparedOffsets.push_back(Writer.appendPrepared("large", LargeMember));
+    PreparedOffsets.push_back(Writer.appendPrepared("empty", Empty));
+    Writer.close();
+  }
+
+  std::string AppendedString(Appended.data(), Appended.size());
+  std::string PreparedString(Prepared.data(), Prepared.size());
+  BOOST_TEST(AppendedString == PreparedString);
+
+  BOOST_TEST(AppendedOffsets.size() == PreparedOffsets.size());
+  for (size_t I = 0; I < AppendedOffsets.size(); ++I) {
+    BOOST_TEST(AppendedOffsets[I].Start == PreparedOffsets[I].Start);
+    BOOST_TEST(AppendedOffsets[I].DataStart == PreparedOffsets[I].DataStart);
+    BOOST_TEST(AppendedOffsets[I].PaddingStart
+               == PreparedOffsets[I].PaddingStart);
+    BOOST_TEST(AppendedOffsets[I].End == PreparedOffsets[I].End);
+  }
+
+  checkOffset(Prepared,
+              PreparedOffsets[1].DataStart,
+              PreparedOffsets[1].dataSize(),
+              Large);
+}
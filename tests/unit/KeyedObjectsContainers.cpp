@@ -204,6 +204,39 @@ BOOST_AUTO_TEST_CASE(TestUniqueLast) {
   revng_check(TheVector == Expected);
 }
 
+/// Checks the lookups in \p Set, holding the multiples of 3 up to \p Last
+static void checkLookups(const SortedVector<int> &Set, int Last) {
+  for (int Key = -1; Key <= Last + 1; ++Key) {
+    auto Expected = std::lower_bound(Set.begin(), Set.end(), Key);
+    revng_check(Set.lower_bound(Key) == Expected);
+    bool IsExpected = Key >= 0 and Key <= Last and Key % 3 == 0;
+    revng_check(Set.contains(Key) == IsExpected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestSortedVectorLookups) {
+  // Cover sizes around the one at which the key index kicks in
+  for (int Size : { 0, 1, 7, 255, 256, 257, 1000 }) {
+    SortedVector<int> Set;
+    {
+      auto Inserter = Set.batch_insert_or_assign();
+      for (int I = Size - 1; I >= 0; --I)
+        Inserter.insert_or_assign(3 * I);
+    }
+    checkLookups(Set, 3 * (Size - 1));
+
+    // Lookups have to keep working after the keys change
+    SortedVector<int> Copy = Set;
+    Set.insert(3 * Size);
+    checkLookups(Set, 3 * Size);
+    checkLookups(Copy, 3 * (Size - 1));
+
+    Set.erase(0);
+    revng_check(not Set.contains(0));
+    revng_check(Set.contains(3 * Size));
+  }
+}
+
 template<template<typename...> class T>
 static void testAt() {
   revng::TrackingContainer<T<int>> Vector;
@@ -158,6 +158,67 @@ BOOST_AUTO_TEST_CASE(TestBitwiseOperators) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(TestMixedBitwiseOperators) {
+  // A large bit vector whose bits all fit in the small representation
+  LazySmallBitVector Large;
+  Large.set(1000);
+  Large.unset(1000);
+  Large.set(1);
+  BOOST_TEST(not Large.isSmall());
+
+  LazySmallBitVector Small;
+  Small.set(2);
+
+  Small |= Large;
+  BOOST_TEST(Small.isSmall());
+  BOOST_TEST(Small.count() == 2U);
+  BOOST_TEST(Small[1] == true);
+  BOOST_TEST(Small[2] == true);
+
+  Small ^= Large;
+  BOOST_TEST(Small.isSmall());
+  BOOST_TEST(Small.count() == 1U);
+  BOOST_TEST(Small[2] == true);
+
+  // Operations with self
+  Large |= Large;
+  BOOST_TEST(Large.count() == 1U);
+  Large &= Large;
+  BOOST_TEST(Large.count() == 1U);
+  Large ^= Large;
+  BOOST_TEST(Large.isZero());
+
+  // Large vectors of different capacities
+  LazySmallBitVector A;
+  A.set(FirstLargeBit);
+  LazySmallBitVector B;
+  B.set(10 * FirstLargeBit);
+  B.set(FirstLargeBit + 1);
+
+  A |= B;
+  BOOST_TEST(A.count() == 3U);
+  BOOST_TEST(A[10 * FirstLargeBit] == true);
+
+  A &= B;
+  BOOST_REQUIRE_EQUAL(A, B);
+
+  A ^= B;
+  BOOST_TEST(A.isZero());
+}
+
+BOOST_AUTO_TEST_CASE(TestCount) {
+  LazySmallBitVector A;
+  BOOST_TEST(A.count() == 0U);
+
+  A.set(0);
+  A.set(10);
+  BOOST_TEST(A.count() == 2U);
+
+  for (unsigned I = 0; I < 1000; I += 3)
+    A.set(I);
+  BOOST_TEST(A.count() == 335U);
+}
+
 BOOST_AUTO_TEST_CASE(TestCopy) {
   for (unsigned Start = 0; Start <= FirstLargeBit; Start += FirstLargeBit) {
     LazySmallBitVector A;
@@ -169,6 +230,22 @@ BOOST_AUTO_TEST_CASE(TestCopy) {
     LazySmallBitVector C = A;
     BOOST_TEST(C[Start + 1] == true);
   }
+
+  // Assigning a smaller bit vector must not leave stale bits around
+  LazySmallBitVector Large;
+  Large.set(10 * FirstLargeBit);
+
+  LazySmallBitVector Medium;
+  Medium.set(FirstLargeBit);
+  Large = Medium;
+  BOOST_REQUIRE_EQUAL(Large, Medium);
+  BOOST_TEST(Large[10 * FirstLargeBit] == false);
+
+  LazySmallBitVector Small;
+  Small.set(3);
+  Large = Small;
+  BOOST_REQUIRE_EQUAL(Large, Small);
+  BOOST_TEST(Large.count() == 1U);
 }
 
 BOOST_AUTO_TEST_CASE(TestComparison) {
@@ -11,6 +11,8 @@ bool init_unit_test();
 #include "boost/test/execution_monitor.hpp"
 #include "boost/test/unit_test.hpp"
 
+#include "llvm/ADT/DenseMap.h"
+
 #include "revng/Support/MetaAddress.h"
 #include "revng/UnitTestHelpers/UnitTestHelpers.h"
 
@@ -183,3 +185,33 @@ BOOST_AUTO_TEST_CASE(Map) {
 
   BOOST_TEST(Map.size() == size_t(5));
 }
+
+BOOST_AUTO_TEST_CASE(Ordering) {
+  // Epoch, then address space, then type, then address
+  auto Base = MetaAddress::fromPC(Triple::x86_64, 0x2000, 1, 1);
+  BOOST_TEST(MetaAddress::fromPC(Triple::x86_64, 0x3000, 0, 1) < Base);
+  BOOST_TEST(MetaAddress::fromPC(Triple::x86_64, 0x3000, 1, 0) < Base);
+  BOOST_TEST(MetaAddress::fromGeneric(Triple::x86_64, 0x3000, 1, 1) < Base);
+  BOOST_TEST(MetaAddress::fromPC(Triple::x86_64, 0x1000, 1, 1) < Base);
+  BOOST_TEST(Base < MetaAddress::fromPC(Triple::x86_64, 0x1000, 2, 0));
+  BOOST_TEST(MetaAddress::invalid() < generic64(0));
+}
+
+BOOST_AUTO_TEST_CASE(DenseMap) {
+  llvm::DenseMap<MetaAddress, int> Map;
+
+  Map[generic64(0)] = 1;
+  Map[MetaAddress::invalid()] = 2;
+  Map[pc(0)] = 3;
+  Map[MetaAddress::fromPC(Triple::arm, 0)] = 4;
+  Map[MetaAddress::fromPC(Triple::arm, 1)] = 5;
+
+  BOOST_TEST(Map.size() == size_t(5));
+  BOOST_TEST(Map.lookup(pc(0)) == 3);
+  BOOST_TEST(Map.lookup(MetaAddress::fromPC(Triple::arm, 1)) == 5);
+  BOOST_TEST(Map.count(generic64(1)) == size_t(0));
+
+  auto Empty = llvm::DenseMapInfo<MetaAddress>::getEmptyKey();
+  BOOST_TEST(Empty != MetaAddress::invalid());
+  BOOST_TEST(not Empty.isValid());
+}
@@ -11,11 +11,17 @@ bool init_unit_test();
 #include "revng/Model/Binary.h"
 #include "revng/Model/Pass/AllPasses.h"
 #include "revng/Model/Processing.h"
+#include "revng/Model/RawBinaryView.h"
+#include "revng/Model/Transaction.h"
+#include "revng/Model/TypeDependencyIndex.h"
 #include "revng/Support/MetaAddress.h"
 #include "revng/Support/MetaAddress/YAMLTraits.h"
 #include "revng/Support/YAMLTraits.h"
 #include "revng/TupleTree/DiffError.h"
 #include "revng/TupleTree/Introspection.h"
+#include "revng/TupleTree/MemoryUsage.h"
+#include "revng/TupleTree/ParallelYAML.h"
+#include "revng/TupleTree/StructuralHash.h"
 #include "revng/TupleTree/Tracking.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 #include "revng/TupleTree/VisitsImpl.h"
@@ -123,6 +129,38 @@ BOOST_AUTO_TEST_CASE(TestStringPathConversion) {
   CheckRoundTrip("/Functions/0x1000:Code_arm/Entry");
 }
 
+BOOST_AUTO_TEST_CASE(TestPathCopyAndHash) {
+  // Mix inline keys (field indices and MetaAddresses) with keys that don't
+  // fit inline, and exceed the number of keys stored inline in the path
+  using LargeKey = std::tuple<MetaAddress, MetaAddress>;
+  TupleTreePath Path;
+  for (size_t I = 0; I < 3; ++I) {
+    Path.push_back(I);
+    Path.push_back(MetaAddress::fromString("0x1000:Generic64"));
+    Path.push_back(LargeKey(ARM2000, ARM2000));
+  }
+
+  TupleTreePath Copy = Path;
+  revng_check(Copy == Path);
+  revng_check(Copy.hash() == Path.hash());
+  revng_check(std::get<0>(Copy[8].get<LargeKey>()) == ARM2000);
+
+  TupleTreePath Moved = std::move(Copy);
+  revng_check(Moved == Path);
+  revng_check(Moved[3].get<size_t>() == 1);
+
+  Moved.pop_back();
+  revng_check(Moved != Path);
+  revng_check(Moved.isPrefixOf(Path));
+  revng_check(Moved.hash() != Path.hash());
+
+  TupleTreePath Other;
+  Other.push_back(size_t(1));
+  TupleTreePath OtherKey;
+  OtherKey.push_back(size_t(2));
+  revng_check(Other.hash() != OtherKey.hash());
+}
+
 BOOST_AUTO_TEST_CASE(TestPathMatcher) {
   //
   // Test regular matcher
@@ -249,12 +287,206 @@ BOOST_AUTO_TEST_CASE(TestModelDeduplication) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(TestTypeDependencyIndex) {
+  TupleTree<model::Binary> Model;
+  auto UInt32 = model::PrimitiveType::makeGeneric(4);
+
+  auto [Typedef, TypedefType] = Model->makeTypedefDefinition(UInt32.copy());
+  auto [Struct, StructType] = Model->makeStructDefinition();
+  Struct.Fields()[0].Type() = TypedefType.copy();
+  Struct.Fields()[4].Type() = model::PointerType::make(TypedefType.copy(), 8);
+  auto [Outer, OuterType] = Model->makeStructDefinition();
+  Outer.Fields()[0].Type() = StructType.copy();
+
+  model::TypeDependencyIndex Index(*Model);
+  BOOST_TEST(Index.size() == 3);
+
+  // Multiple edges to the same definition are recorded once
+  BOOST_TEST(Index.dependencies(Struct).size() == 1);
+  BOOST_TEST(Index.dependents(Typedef).size() == 1);
+  BOOST_TEST(Index.dependents(Typedef)[0] == &Struct);
+  BOOST_TEST(Index.transitiveDependents({ &Typedef }).size() == 3);
+
+  std::vector Order = Index.topologicalOrder();
+  auto Position = [&Order](const model::TypeDefinition &D) {
+    return llvm::find(Order, &D) - Order.begin();
+  };
+  BOOST_TEST(Order.size() == 3);
+  BOOST_TEST(Position(Typedef) < Position(Struct));
+  BOOST_TEST(Position(Struct) < Position(Outer));
+
+  // Reflect an edit
+  Outer.Fields()[0].Type() = UInt32.copy();
+  Index.update(Outer);
+  BOOST_TEST(Index.dependencies(Outer).empty());
+  BOOST_TEST(Index.dependents(Struct).empty());
+
+  Index.erase(Typedef);
+  BOOST_TEST(not Index.contains(Typedef));
+  BOOST_TEST(Index.dependencies(Struct).empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestPurgeUnreachableCandidates) {
+  TupleTree<model::Binary> Model;
+  auto UInt32 = model::PrimitiveType::makeGeneric(4);
+
+  auto [Typedef, TypedefType] = Model->makeTypedefDefinition(UInt32.copy());
+  auto [Struct, StructType] = Model->makeStructDefinition();
+  Struct.Fields()[0].Type() = TypedefType.copy();
+  auto [Named, NamedType] = Model->makeStructDefinition();
+  Named.OriginalName() = "named";
+  Named.Fields()[0].Type() = TypedefType.copy();
+  auto [Outer, OuterType] = Model->makeStructDefinition();
+  Outer.Fields()[0].Type() = StructType.copy();
+
+  model::TypeDependencyIndex Index(*Model);
+
+  // Drop the only use of Struct
+  Outer.Fields()[0].Type() = UInt32.copy();
+  Index.update(Outer);
+
+  // Struct is purged, while Typedef is still used by Named. Outer is not a
+  // candidate, so it's not purged, even if it's unreachable.
+  const model::TypeDefinition *Dropped = &Struct;
+  BOOST_TEST(purgeUnreachableCandidates(Model, Index, { Dropped }) == 1);
+  BOOST_TEST(Model->TypeDefinitions().size() == 3);
+  BOOST_TEST(Index.size() == 3);
+  BOOST_TEST(Index.dependents(Typedef).size() == 1);
+  BOOST_TEST(Index.dependents(Typedef)[0] == &Named);
+}
+
+BOOST_AUTO_TEST_CASE(TestModelTransaction) {
+  TupleTree<model::Binary> Model;
+  Model->Architecture() = model::Architecture::x86_64;
+
+  {
+    model::Transaction Transaction(Model);
+    auto UInt32 = model::PrimitiveType::makeGeneric(4);
+    for (unsigned I = 0; I < 16; ++I)
+      auto _ = Transaction.types().makeTypedefDefinition(UInt32.copy());
+
+    MetaAddress Address(0x1000, MetaAddressType::Code_x86_64);
+    Transaction.recordFunction(model::Function(Address));
+
+    auto Diff = llvm::cantFail(Transaction.commit());
+    BOOST_TEST(Model->TypeDefinitions().size() == 16);
+    BOOST_TEST(Model->Functions().size() == 1);
+    BOOST_TEST(Diff.Changes.size() == 17);
+  }
+
+  // A transaction that breaks the model is rolled back
+  {
+    model::Transaction Transaction(Model);
+    auto _ = Transaction.types().makeTypedefDefinition();
+    auto MaybeDiff = Transaction.commit();
+    BOOST_TEST(not MaybeDiff);
+    llvm::consumeError(MaybeDiff.takeError());
+    BOOST_TEST(Model->TypeDefinitions().size() == 16);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(TestTupleTreeDiff) {
   model::Binary Left;
   model::Binary Right;
   diff(Left, Right).dump();
 }
 
+BOOST_AUTO_TEST_CASE(TestTupleTreeDiffStreaming) {
+  model::Binary Left;
+  for (uint64_t I = 0; I < 100; ++I) {
+    MetaAddress Address(0x1000 + I, MetaAddressType::Code_aarch64);
+    Left.Functions()[Address].CustomName() = "function_" + std::to_string(I);
+  }
+
+  model::Binary Right = Left;
+  MetaAddress Changed(0x1000 + 42, MetaAddressType::Code_aarch64);
+  Right.Functions()[Changed].CustomName() = "renamed";
+
+  // Only the renamed function has to be reported
+  auto Diff = diff(Left, Right);
+  BOOST_TEST(Diff.Changes.size() == 1U);
+  auto Path = pathAsString<model::Binary>(Diff.Changes[0].Path);
+  BOOST_TEST(llvm::StringRef(*Path).endswith("/CustomName"));
+
+  size_t Streamed = 0;
+  diff(Left, Right, [&Streamed](Change<model::Binary> &&) { ++Streamed; });
+  BOOST_TEST(Streamed == Diff.Changes.size());
+
+  BOOST_TEST(diff(Left, Left).Changes.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestStructuralHash) {
+  model::Binary Left;
+  MetaAddress Address(0x1000, MetaAddressType::Code_aarch64);
+  Left.Functions()[Address].CustomName() = "function";
+
+  model::Binary Right = Left;
+  BOOST_TEST(structuralHash(Left) == structuralHash(Right));
+
+  // A change that doesn't affect the key has to be reflected in the hash
+  Right.Functions()[Address].CustomName() = "renamed";
+  BOOST_TEST(structuralHash(Left.Functions().at(Address))
+             != structuralHash(Right.Functions().at(Address)));
+  BOOST_TEST(structuralHash(Left) != structuralHash(Right));
+}
+
+BOOST_AUTO_TEST_CASE(TestMemoryUsage) {
+  TupleTree<model::Binary> Model;
+  uint64_t Empty = memoryUsage(Model);
+  BOOST_TEST(Empty >= sizeof(model::Binary));
+
+  MetaAddress Address(0x1000, MetaAddressType::Code_aarch64);
+  Model->Functions()[Address];
+  uint64_t OneFunction = memoryUsage(Model);
+  BOOST_TEST(OneFunction >= Empty + sizeof(model::Function));
+
+  // Strings count only when they don't fit inline
+  Model->Functions()[Address].CustomName() = std::string(1024, 'a');
+  BOOST_TEST(memoryUsage(Model) > OneFunction + 1024);
+}
+
+BOOST_AUTO_TEST_CASE(TestParallelYAMLParsing) {
+  model::Binary Original;
+  for (uint64_t I = 0; I < 4096; ++I) {
+    MetaAddress Address(0x1000 + I * 0x10, MetaAddressType::Code_aarch64);
+    auto &Function = Original.Functions()[Address];
+    Function.CustomName() = "function_" + std::to_string(I);
+  }
+  std::string YAML = toString(Original);
+
+  auto MaybeParsed = revng::detail::parallelFromYAML<model::Binary>(YAML, 0);
+  BOOST_REQUIRE(MaybeParsed.has_value());
+  model::Binary Parsed = llvm::cantFail(std::move(*MaybeParsed));
+  BOOST_TEST(Parsed.Functions().size() == Original.Functions().size());
+  BOOST_TEST(toString(Parsed) == YAML);
+
+  // Documents in an unexpected layout are left to the sequential parser
+  std::string Flow = "Functions: [ { Entry: \"0x1000:Code_aarch64\" } ]\n";
+  BOOST_TEST(not revng::detail::parallelFromYAML<model::Binary>(Flow, 0));
+}
+
+BOOST_AUTO_TEST_CASE(TestParallelVerification) {
+  model::Binary Model;
+  for (uint64_t I = 0; I < 4096; ++I) {
+    MetaAddress Address(0x1000 + I * 0x10, MetaAddressType::Code_aarch64);
+    Model.Functions()[Address].CustomName() = "function_" + std::to_string(I);
+    Model.ImportedDynamicFunctions()["dynamic_" + std::to_string(I)];
+  }
+  BOOST_TEST(not revng::Tracking::isActive(Model));
+  BOOST_TEST(Model.verify());
+
+  // The failure of a single object is reported, whichever task verifies it
+  Model.ImportedDynamicFunctions()["dynamic/4096"];
+  BOOST_TEST(not Model.verify());
+
+  // While tracking, the model is verified serially
+  revng::Tracking::clearAndResume(Model);
+  BOOST_TEST(revng::Tracking::isActive(Model));
+  BOOST_TEST(not Model.verify());
+  revng::Tracking::stop(Model);
+  BOOST_TEST(not revng::Tracking::isActive(Model));
+}
+
 BOOST_AUTO_TEST_CASE(TestTupleTreeDiffSerialization) {
   model::Binary Left;
   model::Binary Right;
@@ -406,3 +638,52 @@ BOOST_AUTO_TEST_CASE(CollectReadFieldsShouldCollectAllSegments) {
   };
   BOOST_TEST(Collected.ExactVectors == Paths);
 }
+
+BOOST_AUTO_TEST_CASE(RawBinaryViewAddressTranslation) {
+  using llvm::Triple;
+  auto Address = [](uint64_t Value) {
+    return MetaAddress::fromGeneric(Triple::x86_64, Value);
+  };
+
+  auto MakeSegment = [&Address](uint64_t Start,
+                                uint64_t Size,
+                                uint64_t Offset) {
+    Segment Result(Address(Start), Size);
+    Result.StartOffset() = Offset;
+    Result.FileSize() = Size;
+    return Result;
+  };
+
+  model::Binary Model;
+  Model.Segments().insert(MakeSegment(0x1000, 0x100, 0x0));
+  Model.Segments().insert(MakeSegment(0x2000, 0x100, 0x100));
+
+  // Overlaps with the second half of the first segment
+  Model.Segments().insert(MakeSegment(0x1080, 0x100, 0x200));
+
+  std::vector<uint8_t> Data(0x400, 0);
+  RawBinaryView View(Model, llvm::ArrayRef<uint8_t>(Data));
+
+  // Returns -1 if the address cannot be translated
+  auto Offset = [&View, &Address](uint64_t Start, uint64_t Size = 0) {
+    auto Result = View.addressToOffset(Address(Start), Size);
+    return Result.has_value() ? static_cast<int64_t>(*Result) : -1;
+  };
+
+  BOOST_TEST(Offset(0x1010) == 0x10);
+  BOOST_TEST(Offset(0x2010) == 0x110);
+  BOOST_TEST(Offset(0x1170) == 0x2F0);
+
+  // Not mapped
+  BOOST_TEST(Offset(0x500) == -1);
+  BOOST_TEST(Offset(0x1F00) == -1);
+  BOOST_TEST(Offset(0x3000) == -1);
+
+  // Ambiguous, unless only one of the segments contains the whole range
+  BOOST_TEST(Offset(0x1090) == -1);
+  BOOST_TEST(Offset(0x1090, 0x80) == 0x210);
+
+  // Segments added after the creation of the view are taken into account
+  Model.Segments().insert(MakeSegment(0x3000, 0x100, 0x300));
+  BOOST_TEST(Offset(0x3010) == 0x310);
+}
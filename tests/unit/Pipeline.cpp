@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <utility>
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
@@ -220,6 +221,20 @@ BOOST_AUTO_TEST_CASE(ContainerIsa) {
   BOOST_TEST(Ptr->get(ExampleTarget) == 1);
 }
 
+BOOST_AUTO_TEST_CASE(TargetsListStaysSortedAndUnique) {
+  TargetsList List;
+  List.push_back(Target("f3", FunctionKind));
+  List.push_back(Target("f1", FunctionKind));
+  List.push_back(Target("f2", FunctionKind));
+  List.push_back(Target("f1", FunctionKind));
+  List.emplace_back("f4", FunctionKind);
+
+  BOOST_TEST(List.size() == 4);
+  BOOST_TEST(std::is_sorted(List.begin(), List.end()));
+  BOOST_TEST(List.contains(Target("f2", FunctionKind)));
+  BOOST_TEST(not List.contains(Target("f5", FunctionKind)));
+}
+
 static ContainerFactory getMapFactoryContainer() {
   return ContainerFactory::create<MapContainer>();
 }
@@ -234,6 +249,31 @@ BOOST_AUTO_TEST_CASE(ContainersCanBeCreated) {
   BOOST_TEST(cast<MapContainer>(Containers.at(CName)).get(ExampleTarget) == 1);
 }
 
+BOOST_AUTO_TEST_CASE(SharedContainersAreCopiedOnWrite) {
+  auto Factory = getMapFactoryContainer();
+  ContainerSet Original;
+  Original.add(CName, Factory, Factory(CName));
+  cast<MapContainer>(Original[CName]).get(ExampleTarget) = 1;
+
+  ContainerSet Fork;
+  Fork.add(CName, Factory);
+  Fork.shareFrom(Original);
+  BOOST_TEST(Fork.isShared(CName));
+
+  // Reading does not copy
+  const ContainerSet &ConstFork = Fork;
+  const auto &Read = cast<MapContainer>(ConstFork.at(CName));
+  BOOST_TEST(&Read == &std::as_const(Original).at(CName));
+  BOOST_TEST(Fork.isShared(CName));
+
+  // Writing does, and the original is not affected
+  cast<MapContainer>(Fork.at(CName)).get(ExampleTarget) = 2;
+  BOOST_TEST(not Fork.isShared(CName));
+  BOOST_TEST(not Original.isShared(CName));
+  BOOST_TEST(cast<MapContainer>(Original.at(CName)).get(ExampleTarget) == 1);
+  BOOST_TEST(cast<MapContainer>(Fork.at(CName)).get(ExampleTarget) == 2);
+}
+
 class TestPipe {
 
 public:
@@ -619,6 +659,37 @@ BOOST_AUTO_TEST_CASE(SingleElementPipelineBackwardFinedGrained) {
   BOOST_TEST(Val == 1);
 }
 
+BOOST_AUTO_TEST_CASE(PlansAreReusedForOtherPaths) {
+  Context Context;
+  Runner Pipeline(Context);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+
+  const std::string Name = "first-step";
+  Pipeline.emplaceStep("", Name, "");
+  Pipeline.emplaceStep(Name,
+                       "end",
+                       "",
+                       PipeWrapper::bind<FineGrainPipe>(CName, CName));
+
+  auto &Container(Pipeline[Name].containers().getOrCreate<MapContainer>(CName));
+  Container.get(Target(RootKind)) = 1;
+
+  ContainerToTargetsMap ExpectedRequired;
+  ExpectedRequired.add(CName, {}, RootKind);
+
+  // The second request for f1 and the one for f2 reuse the plan of the first
+  const Step &End = Pipeline["end"];
+  for (const char *Function : { "f1", "f2", "f1" }) {
+    ContainerToTargetsMap Targets;
+    Targets.add(CName, { Function }, FunctionKind);
+
+    auto [Required, PipesExecutionEntries] = End.analyzeGoals(Targets);
+    BOOST_TEST((Required == ExpectedRequired));
+    BOOST_TEST(PipesExecutionEntries.size() == 1);
+    BOOST_TEST((PipesExecutionEntries[0].Output == Targets));
+  }
+}
+
 BOOST_AUTO_TEST_CASE(DifferentNamesAreNotCompatible) {
   Target Target1({ "f1-wrong" }, FunctionKind);
   Target Target2({ "f1" }, FunctionKind);
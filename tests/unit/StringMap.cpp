@@ -0,0 +1,74 @@
+/// \file StringMap.cpp
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+
+#include "llvm/Support/FileSystem.h"
+
+#include "revng/Pipes/Kinds.h"
+#include "revng/Pipes/StringMap.h"
+#include "revng/Storage/Path.h"
+#include "revng/Support/MetaAddress.h"
+#include "revng/Support/TemporaryFile.h"
+
+#define BOOST_TEST_MODULE StringMap
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+inline constexpr char TestMapName[] = "test-string-map";
+inline constexpr char TestMapMIMEType[] = "text/plain";
+inline constexpr char TestMapSuffix[] = ".txt";
+using TestMap = revng::pipes::FunctionStringMap<&revng::kinds::CFG,
+                                                TestMapName,
+                                                TestMapMIMEType,
+                                                TestMapSuffix>;
+
+/// A value that does not compress, so that the archive is large enough to be
+/// memory-mapped when it's loaded
+static std::string incompressible(size_t Size) {
+  std::string Result;
+  Result.reserve(Size);
+  uint32_t State = 1;
+  for (size_t I = 0; I < Size; ++I) {
+    State = State * 1103515245 + 12345;
+    Result.push_back(static_cast<char>(State >> 24));
+  }
+  return Result;
+}
+
+BOOST_AUTO_TEST_CASE(StoreOverTheLoadedArchive) {
+  TemporaryFile Archive("revng-test-string-map", "tar.gz");
+  revng::FilePath Path = revng::FilePath::fromLocalStorage(Archive.path());
+  std::string IndexPath = Archive.path().str() + ".idx";
+
+  auto First = MetaAddress::fromString("0x1000:Code_x86_64");
+  auto Second = MetaAddress::fromString("0x2000:Code_x86_64");
+  const std::string Large = incompressible(1 << 20);
+
+  {
+    TestMap Map(TestMapName);
+    Map[First] = Large;
+    Map[Second] = "second";
+    BOOST_TEST((!Map.store(Path)));
+  }
+
+  // Only Second is decompressed, First is copied from the archive being
+  // overwritten
+  TestMap Map(TestMapName);
+  BOOST_TEST((!Map.load(Path)));
+  Map[Second] = "changed";
+  BOOST_TEST((!Map.store(Path)));
+  BOOST_TEST(Map.at(First) == Large);
+
+  TestMap Reloaded(TestMapName);
+  BOOST_TEST((!Reloaded.load(Path)));
+  BOOST_TEST(Reloaded.at(First) == Large);
+  BOOST_TEST(Reloaded.at(Second) == "changed");
+
+  llvm::sys::fs::remove(IndexPath);
+}
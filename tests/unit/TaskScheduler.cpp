@@ -0,0 +1,61 @@
+/// \file TaskScheduler.cpp
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+#define BOOST_TEST_MODULE TaskScheduler
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/Support/ParallelMap.h"
+#include "revng/Support/TaskScheduler.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+BOOST_AUTO_TEST_CASE(AllTasksRun) {
+  std::atomic<unsigned> Counter = 0;
+  {
+    revng::TaskGroup Group;
+    for (unsigned I = 0; I < 1000; ++I)
+      Group.spawn([&Counter]() { ++Counter; });
+    Group.wait();
+    BOOST_TEST(Counter == 1000);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(NestedGroups) {
+  std::atomic<unsigned> Counter = 0;
+  {
+    revng::TaskGroup Outer;
+    for (unsigned I = 0; I < 64; ++I) {
+      Outer.spawn([&Counter]() {
+        revng::TaskGroup Inner;
+        for (unsigned J = 0; J < 64; ++J)
+          Inner.spawn([&Counter]() { ++Counter; });
+      });
+    }
+  }
+  BOOST_TEST(Counter == 64 * 64);
+}
+
+BOOST_AUTO_TEST_CASE(ParallelForEach) {
+  std::vector<unsigned> Values(10000);
+  std::iota(Values.begin(), Values.end(), 0);
+  revng::parallelForEach(Values, [](unsigned &Value) { Value *= 2; });
+  for (unsigned I = 0; I < Values.size(); ++I)
+    BOOST_TEST(Values[I] == 2 * I);
+}
+
+BOOST_AUTO_TEST_CASE(ParallelMapPreservesOrder) {
+  std::vector<unsigned> Inputs(10000);
+  std::iota(Inputs.begin(), Inputs.end(), 0);
+  auto Result = parallelMap(llvm::ArrayRef<unsigned>(Inputs),
+                            [](const unsigned &Value) { return Value + 1; });
+  BOOST_TEST(Result.size() == Inputs.size());
+  for (unsigned I = 0; I < Result.size(); ++I)
+    BOOST_TEST(Result[I] == I + 1);
+}
@@ -9,6 +9,7 @@ bool init_unit_test();
 
 #include "llvm/Support/YAMLTraits.h"
 
+#include "revng/TupleTree/BinarySerialization.h"
 #include "revng/TupleTree/VisitsImpl.h"
 #include "revng/UnitTestHelpers/UnitTestHelpers.h"
 
@@ -43,3 +44,37 @@ BOOST_AUTO_TEST_CASE(YAMLSerializationRoundTripTest) {
 
   revng_assert(ReferenceInstance == DeserializedInstance);
 }
+
+/// Ensures that TestClass can be serialized and deserialized in binary form
+BOOST_AUTO_TEST_CASE(BinarySerializationRoundTripTest) {
+  using namespace ttgtest;
+  TestClass ReferenceInstance;
+  ReferenceInstance.RequiredField() = 1;
+  ReferenceInstance.OptionalField() = 2;
+  ReferenceInstance.EnumField() = ttgtest::TestEnum::MemberOne;
+  ReferenceInstance.SequenceField() = { 1, 2, 3, 4, 5 };
+  using RefType = TupleTreeReference<uint64_t, TestClass>;
+  ReferenceInstance.ReferenceField() = RefType::fromString(&ReferenceInstance,
+                                                           "/SequenceField/1");
+
+  std::string Buffer;
+  llvm::raw_string_ostream OutputStream(Buffer);
+  tupletree::binary::serialize(OutputStream, ReferenceInstance);
+  OutputStream.flush();
+
+  revng_check(tupletree::binary::isBinaryTupleTree(Buffer));
+
+  TestClass DeserializedInstance;
+  llvm::Error Error = tupletree::binary::deserialize(Buffer,
+                                                     DeserializedInstance);
+  revng_check(not Error);
+  revng_check(ReferenceInstance == DeserializedInstance);
+
+  // A truncated buffer must be rejected, not misread
+  TestClass TruncatedInstance;
+  llvm::StringRef Truncated = llvm::StringRef(Buffer).drop_back();
+  using tupletree::binary::deserialize;
+  llvm::Error TruncatedError = deserialize(Truncated, TruncatedInstance);
+  revng_check(static_cast<bool>(TruncatedError));
+  llvm::consumeError(std::move(TruncatedError));
+}
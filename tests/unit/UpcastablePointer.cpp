@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/Support/Error.h"
+
 #include "revng/ADT/UpcastablePointer.h"
 
 template<typename T>
@@ -44,6 +46,98 @@ static_assert(std::is_copy_constructible_v<UpcastablePointer<TestClass>>);
 static_assert(std::is_move_assignable_v<UpcastablePointer<TestClass>>);
 static_assert(std::is_move_constructible_v<UpcastablePointer<TestClass>>);
 
+// A hierarchy shaped like the ones emitted by the TupleTree generator, so that
+// upcast dispatches through revng::detail::makeKindTable
+namespace ShapeKind {
+enum Values {
+  Invalid,
+  Circle,
+  Square,
+  Triangle,
+  Count
+};
+} // namespace ShapeKind
+
+class Shape {
+public:
+  static constexpr ShapeKind::Values AssociatedKind = ShapeKind::Invalid;
+
+private:
+  ShapeKind::Values TheKind;
+
+public:
+  explicit Shape(ShapeKind::Values Kind) : TheKind(Kind) {}
+  const ShapeKind::Values &Kind() const { return TheKind; }
+  static bool classof(const Shape *) { return true; }
+};
+
+template<ShapeKind::Values K>
+class ShapeWithKind : public Shape {
+public:
+  static constexpr ShapeKind::Values AssociatedKind = K;
+
+public:
+  ShapeWithKind() : Shape(K) {}
+  static bool classof(const Shape *S) { return S->Kind() == K; }
+};
+
+using Circle = ShapeWithKind<ShapeKind::Circle>;
+using Square = ShapeWithKind<ShapeKind::Square>;
+using Triangle = ShapeWithKind<ShapeKind::Triangle>;
+
+template<>
+struct concrete_types_traits<Shape> {
+  using type = std::tuple<Circle, Square, Triangle>;
+};
+
+template<>
+struct concrete_types_traits<const Shape> {
+  using type = std::tuple<const Circle, const Square, const Triangle>;
+};
+
+static_assert(revng::detail::KindDispatchable<Shape>);
+static_assert(not revng::detail::KindDispatchable<TestClass>);
+
+constexpr auto ShapeTable = revng::detail::makeKindTable<Shape>();
+static_assert(ShapeTable[ShapeKind::Invalid] == 3);
+static_assert(ShapeTable[ShapeKind::Circle] == 0);
+static_assert(ShapeTable[ShapeKind::Square] == 1);
+static_assert(ShapeTable[ShapeKind::Triangle] == 2);
+static_assert(ShapeTable[ShapeKind::Count] == 3);
+
+template<typename T>
+static ShapeKind::Values kindOf(const T &) {
+  return T::AssociatedKind;
+}
+
 int main() {
+  UpcastablePointer<Shape> Pointers[] = {
+    UpcastablePointer<Shape>::make<Circle>(),
+    UpcastablePointer<Shape>::make<Square>(),
+    UpcastablePointer<Shape>::make<Triangle>(),
+  };
+
+  for (const UpcastablePointer<Shape> &Pointer : Pointers) {
+    ShapeKind::Values Visited = ShapeKind::Invalid;
+    Pointer.upcast([&Visited](const auto &Upcasted) {
+      Visited = kindOf(Upcasted);
+    });
+    revng_check(Visited == Pointer->Kind());
+
+    // Copying goes through upcast too
+    UpcastablePointer<Shape> Copy = Pointer;
+    revng_check(Copy->Kind() == Pointer->Kind());
+
+    auto Check = [&Pointer](const auto &Upcasted) -> llvm::Error {
+      revng_check(kindOf(Upcasted) == Pointer->Kind());
+      return llvm::Error::success();
+    };
+    llvm::Error IfNull = llvm::Error::success();
+    revng_check(not upcast(Pointer, Check, std::move(IfNull)));
+  }
+
+  UpcastablePointer<Shape> Empty;
+  revng_check(upcast(Empty, [](const auto &) { return 1; }, 0) == 0);
+
   return 0;
 }
@@ -5,7 +5,9 @@
 //
 
 #include <string>
+#include <vector>
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
@@ -25,11 +27,23 @@ static cl::opt<std::string> PathModel(cl::Positional,
                                       cl::desc("<input model>"),
                                       cl::value_desc("model"));
 
-static cl::opt<std::string> DiffPath(cl::Positional,
+static cl::list<std::string> DiffPaths(cl::Positional,
+                                      cl::cat(ThisToolCategory),
+                                      cl::desc("<model diffs>"),
+                                      cl::value_desc("diff"));
+
+static cl::opt<std::string> DiffList("diff-list",
                                      cl::cat(ThisToolCategory),
-                                     cl::desc("<model diff>"),
-                                     cl::init("-"),
-                                     cl::value_desc("model"));
+                                     cl::desc("apply, after the positional "
+                                              "ones, the diffs whose paths "
+                                              "are listed, one per line, in "
+                                              "this file"),
+                                     cl::value_desc("filename"));
+
+static cl::opt<bool> Verify("verify",
+                            cl::cat(ThisToolCategory),
+                            cl::desc("verify the changes introduced by each "
+                                     "diff"));
 
 static ModelOutputOptions<false> Options(ThisToolCategory);
 
@@ -43,12 +57,21 @@ int main(int Argc, char *Argv[]) {
   if (not Model)
     ExitOnError(Model.takeError());
 
-  using TypeDiff = TupleTreeDiff<model::Binary>;
-  auto Diff = ExitOnError(fromFileOrSTDIN<TypeDiff>(DiffPath));
+  // All the diffs are applied to the model in memory, which is serialized
+  // only once at the end
+  std::vector<std::string> Diffs(DiffPaths.begin(), DiffPaths.end());
+  if (DiffList.getNumOccurrences() > 0) {
+    std::vector<std::string> Listed = ExitOnError(readNonEmptyLines(DiffList));
+    llvm::append_range(Diffs, Listed);
+  }
+
+  if (Diffs.empty())
+    Diffs.push_back("-");
 
-  ExitOnError(Diff.apply(*Model));
+  model::VerifyHelper VH;
+  for (const std::string &DiffPath : Diffs)
+    ExitOnError(applyDiff(*Model, DiffPath, Verify ? &VH : nullptr));
 
-  auto DesiredOutput = Options.getDesiredOutput();
   ExitOnError(Model->toFile(Options.getPath()));
 
   return EXIT_SUCCESS;
@@ -56,6 +56,20 @@ struct OptionValue<PassName> final
 static cl::list<PassName> PassesList(cl::desc("Optimizations available:"),
                                      cl::cat(ThisToolCategory));
 
+static cl::opt<std::string> BatchPath("batch",
+                                      cl::desc("after the passes on the "
+                                               "command line, run the steps "
+                                               "listed, one per line, in this "
+                                               "file: either the name of a "
+                                               "pass or `apply <diff>`"),
+                                      cl::value_desc("filename"),
+                                      cl::cat(ThisToolCategory));
+
+static cl::opt<bool> VerifyDiffs("verify-diffs",
+                                 cl::desc("verify the changes introduced by "
+                                          "each diff applied in batch mode"),
+                                 cl::cat(ThisToolCategory));
+
 static void loadPassesList() {
   for (const auto &[Name, Description, _] : RegisterModelPass::passes())
     PassesList.getParser().addLiteralOption(Name, PassName(Name), Description);
@@ -71,15 +85,31 @@ int main(int Argc, char *Argv[]) {
   auto ParsedModel = Model::fromFileOrSTDIN(InputFilename);
   auto MaybeModel = ExitOnError(std::move(ParsedModel));
 
-  for (const PassName &PassName : PassesList) {
-    const RegisterModelPass::ModelPass *Pass = RegisterModelPass::get(PassName);
+  auto RunPass = [&ExitOnError, &MaybeModel](llvm::StringRef Name) {
+    const RegisterModelPass::ModelPass *Pass = RegisterModelPass::get(Name);
     if (Pass == nullptr) {
       ExitOnError(llvm::createStringError(llvm::inconvertibleErrorCode(),
-                                          "Pass not found: " + PassName));
+                                          "Pass not found: " + Name));
     }
 
     // Run pass
     (*Pass)(MaybeModel);
+  };
+
+  for (const PassName &PassName : PassesList)
+    RunPass(PassName);
+
+  // In batch mode, keep the model in memory across all the steps
+  if (BatchPath.getNumOccurrences() > 0) {
+    model::VerifyHelper VH;
+    for (llvm::StringRef Step : ExitOnError(readNonEmptyLines(BatchPath))) {
+      if (Step.consume_front("apply "))
+        ExitOnError(applyDiff(MaybeModel,
+                              Step.trim(),
+                              VerifyDiffs ? &VH : nullptr));
+      else
+        RunPass(Step);
+    }
   }
 
   // Serialize
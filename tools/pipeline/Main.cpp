@@ -13,6 +13,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_os_ostream.h"
 
 #include "revng/Model/LoadModelPass.h"
@@ -107,6 +108,29 @@ static alias A2("t",
                 aliasopt(PrintBuildableTargets),
                 cat(MainCategory));
 
+static opt<string> Shard("shard",
+                         desc("Only produce the shard <index>/<count> of the "
+                              "requested targets, e.g. 0/4. Targets at the "
+                              "root rank are produced by all the shards"),
+                         cat(MainCategory),
+                         init(""));
+
+static opt<string> Batch("batch",
+                         desc("Analyze, in the same process, the binaries "
+                              "listed in this file. Each line contains the "
+                              "directory to resume from and to store to, "
+                              "followed by the -i overrides for that binary, "
+                              "separated by spaces"),
+                         cat(MainCategory),
+                         init(""));
+
+static opt<unsigned> BatchContextReuse("batch-context-reuse",
+                                       desc("Number of binaries analyzed in "
+                                            "--batch mode in the same LLVM "
+                                            "context, 0 means all of them"),
+                                       cat(MainCategory),
+                                       init(64));
+
 static ToolCLOptions BaseOptions(MainCategory);
 
 static ExitOnError AbortOnError;
@@ -126,6 +150,41 @@ parseProductionRequest(Runner &Pipeline,
   return ToProduce;
 }
 
+/// Drop from \p ToProduce the targets that do not belong to the shard
+/// requested with --shard
+///
+/// The targets of each container are assigned to the shards in a round robin
+/// fashion, so that each process running the same request with a different
+/// shard index gets about the same number of, e.g., functions. Since the
+/// targets are enumerated in a deterministic order, the shards are disjoint.
+static void applyShard(Runner::State &ToProduce) {
+  if (Shard.empty())
+    return;
+
+  auto [IndexString, CountString] = StringRef(Shard).split("/");
+  unsigned Index = 0;
+  unsigned Count = 0;
+  if (IndexString.getAsInteger(10, Index) or CountString.getAsInteger(10, Count)
+      or Count == 0 or Index >= Count) {
+    AbortOnError(createStringError(inconvertibleErrorCode(),
+                                   "invalid shard %s, expected "
+                                   "<index>/<count>",
+                                   Shard.c_str()));
+  }
+
+  for (auto &StepEntry : ToProduce) {
+    for (auto &ContainerEntry : StepEntry.second) {
+      TargetsList::List InShard;
+      unsigned Position = 0;
+      for (const pipeline::Target &T : ContainerEntry.second) {
+        if (T.getKind().depth() == 0 or Position++ % Count == Index)
+          InShard.push_back(T);
+      }
+      ContainerEntry.second = TargetsList(std::move(InShard));
+    }
+  }
+}
+
 static void runAnalysis(Runner &Pipeline, llvm::StringRef Target) {
   const auto &Registry = Pipeline.getKindsRegistry();
 
@@ -154,30 +213,15 @@ static void runPipeline(Runner &Pipeline) {
     T.advance(Entry, true);
     llvm::SmallVector<llvm::StringRef, 3> Targets;
     Entry.split(Targets, ",");
-    AbortOnError(Pipeline.run(parseProductionRequest(Pipeline, Targets)));
+    Runner::State ToProduce = parseProductionRequest(Pipeline, Targets);
+    applyShard(ToProduce);
+    AbortOnError(Pipeline.run(ToProduce));
   }
 }
 
-int main(int argc, char *argv[]) {
-  revng::InitRevng X(argc, argv, "", { &MainCategory });
-
-  Registry::runAllInitializationRoutines();
-
-  auto Manager = AbortOnError(BaseOptions.makeManager());
-
-  for (const auto &Override : ContainerOverrides)
-    AbortOnError(Manager.overrideContainer(Override));
-
-  if (DumpPipeline) {
-    Manager.dump();
-    return EXIT_SUCCESS;
-  }
-  if (PrintBuildableTargets) {
-    llvm::raw_os_ostream OS(dbg);
-    Manager.writeAllPossibleTargets(OS);
-    return EXIT_SUCCESS;
-  }
-
+/// Run everything that has been requested on the command line, apart from
+/// the options which only make sense for a single binary
+static void analyze(PipelineManager &Manager) {
   if (not ApplyModelDiff.empty()) {
     using Type = TupleTreeDiff<model::Binary>;
     auto Diff = AbortOnError(fromFileOrSTDIN<Type>(ApplyModelDiff));
@@ -215,6 +259,91 @@ int main(int argc, char *argv[]) {
 
   AbortOnError(Manager.store(StoresOverrides));
   AbortOnError(Manager.store());
+}
+
+/// Analyze all the binaries listed in the --batch file
+///
+/// The fixed cost of each binary is reduced by sharing the LLVM context among
+/// them: the QEMU helpers and the support modules are parsed only once, and
+/// then cloned in the module of each binary. The ABI definitions and the
+/// well-known models are already parsed once per process. Each binary still
+/// gets its own PipelineManager, and hence its own pipeline::Context and model.
+///
+/// Since an LLVM context never frees its types and constants, it is recycled
+/// after --batch-context-reuse binaries.
+static int runBatch() {
+  if (not StoresOverrides.empty() or SaveModel.hasValue() or DumpPipeline
+      or PrintBuildableTargets) {
+    AbortOnError(createStringError(inconvertibleErrorCode(),
+                                   "-o, --save-model, -d and -t are not "
+                                   "supported in --batch mode"));
+  }
+
+  auto MaybeBuffer = MemoryBuffer::getFileOrSTDIN(Batch);
+  auto Buffer = AbortOnError(errorOrToExpected(std::move(MaybeBuffer)));
+
+  llvm::SmallVector<llvm::StringRef, 16> Entries;
+  llvm::SmallVector<llvm::StringRef, 16> Lines;
+  Buffer->getBuffer().split(Lines, '\n', -1, false);
+  for (llvm::StringRef Line : Lines) {
+    Line = Line.trim();
+    if (not Line.empty() and not Line.startswith("#"))
+      Entries.push_back(Line);
+  }
+
+  std::shared_ptr<SharedLLVMContext> LLVM;
+  unsigned Analyzed = 0;
+  Task T(Entries.size(), "revng-pipeline batch");
+  for (llvm::StringRef Entry : Entries) {
+    llvm::SmallVector<llvm::StringRef, 4> Fields;
+    Entry.split(Fields, ' ', -1, false);
+    llvm::StringRef Directory = Fields.front();
+    T.advance(Directory, true);
+
+    bool Recycle = BatchContextReuse != 0
+                   and Analyzed % BatchContextReuse == 0;
+    if (LLVM == nullptr or Recycle)
+      LLVM = std::make_shared<SharedLLVMContext>();
+    ++Analyzed;
+
+    auto Manager = AbortOnError(BaseOptions.makeManager(Directory, LLVM));
+
+    for (const auto &Override : ContainerOverrides)
+      AbortOnError(Manager.overrideContainer(Override));
+
+    for (llvm::StringRef Override : llvm::drop_begin(Fields))
+      AbortOnError(Manager.overrideContainer(Override));
+
+    analyze(Manager);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  revng::InitRevng X(argc, argv, "", { &MainCategory });
+
+  Registry::runAllInitializationRoutines();
+
+  if (not Batch.empty())
+    return runBatch();
+
+  auto Manager = AbortOnError(BaseOptions.makeManager());
+
+  for (const auto &Override : ContainerOverrides)
+    AbortOnError(Manager.overrideContainer(Override));
+
+  if (DumpPipeline) {
+    Manager.dump();
+    return EXIT_SUCCESS;
+  }
+  if (PrintBuildableTargets) {
+    llvm::raw_os_ostream OS(dbg);
+    Manager.writeAllPossibleTargets(OS);
+    return EXIT_SUCCESS;
+  }
+
+  analyze(Manager);
 
   if (SaveModel.hasValue()) {
     auto Context = Manager.context();
@@ -7,8 +7,11 @@
 
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "revng/PipelineC/PipelineC.h"
+#include "revng/PipelineC/Tracing/Profile.h"
 #include "revng/PipelineC/Tracing/Trace.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/CommandLine.h"
@@ -71,6 +74,21 @@ static opt<std::string> Resume("trace-resume",
                                cat(TraceRunToolCategory),
                                desc("Use the provided directory as a resume "
                                     "directory"));
+static opt<bool> Profile("profile",
+                         init(false),
+                         cat(TraceRunToolCategory),
+                         desc("Time each replayed command and print the time "
+                              "spent in each function and step"));
+static opt<unsigned> Repetitions("profile-repetitions",
+                                 init(1),
+                                 cat(TraceRunToolCategory),
+                                 desc("Replay the trace this many times, to "
+                                      "measure the variance. Implies "
+                                      "-profile."));
+static opt<std::string> ProfileOutput("profile-output",
+                                      cat(TraceRunToolCategory),
+                                      desc("Write the profile as JSON to this "
+                                           "file. Implies -profile."));
 
 static alias SoftAssertsA("s",
                           desc("Alias for --soft-asserts"),
@@ -114,13 +132,37 @@ int main(int argc, const char *argv[]) {
     }
   }
 
+  bool Profiling = Options::Profile or Options::Repetitions > 1
+                   or not Options::ProfileOutput.empty();
+  revng_check(Options::Repetitions > 0);
+  revng_check(Options::Repetitions == 1 or Options::Resume.empty(),
+              "-trace-resume cannot be used with multiple repetitions, the "
+              "runs after the first would find the results of the previous "
+              "ones");
+
+  revng::tracing::TraceProfile TheProfile;
   revng::tracing::RunTraceOptions Options = {
     .SoftAsserts = Options::SoftAsserts,
     .BreakAt = { Options::BreakAt.begin(), Options::BreakAt.end() },
     .TemporaryRoot = TemporaryRoot,
     .ResumeDirectory = Options::Resume,
+    .Profile = Profiling ? &TheProfile : nullptr,
   };
-  AbortOnError(TheTrace.run(Options));
+  for (unsigned I = 0; I < Options::Repetitions; ++I)
+    AbortOnError(TheTrace.run(Options));
+
+  if (Profiling) {
+    TheProfile.print(llvm::outs());
+
+    if (not Options::ProfileOutput.empty()) {
+      std::error_code EC;
+      llvm::raw_fd_ostream Output(Options::ProfileOutput,
+                                  EC,
+                                  llvm::sys::fs::OF_Text);
+      revng_check(not EC, "Cannot open the profile output file");
+      TheProfile.toJSON(Output);
+    }
+  }
 
   rp_shutdown();
   return EXIT_SUCCESS;
@@ -538,6 +538,30 @@ export function _applyDiff<T>(
         return [false];
     }
     const new_obj = clone(obj);
+    applyDiffInPlace(new_obj, diffs, getTypeInfo);
+    return [true, new_obj];
+}
+
+// Applies, in order, a sequence of diffs (e.g., the ones the daemon returns to catch up with the
+// latest version of a global), cloning the object only once
+export function _applyDiffs<T>(
+    obj: T,
+    diffs: DiffSet[],
+    validateDiff: (obj: T, diffs: DiffSet) => boolean,
+    getTypeInfo: getTypeInfoType,
+    clone: (obj: T) => T
+): [false] | [true, T] {
+    const new_obj = clone(obj);
+    for (const diff of diffs) {
+        if (!validateDiff(new_obj, diff)) {
+            return [false];
+        }
+        applyDiffInPlace(new_obj, diff, getTypeInfo);
+    }
+    return [true, new_obj];
+}
+
+function applyDiffInPlace<T>(new_obj: T, diffs: DiffSet, getTypeInfo: getTypeInfoType) {
     for (const diff of diffs.Changes) {
         let target = _getElementByPath(diff.Path, new_obj);
         const info = getTypeInfo(diff.Path);
@@ -571,8 +595,6 @@ export function _applyDiff<T>(
             }
         }
     }
-
-    return [true, new_obj];
 }
 
 // Type Hinting